@@ -0,0 +1,583 @@
+#include "core/core.h"
+#include "core/logger.h"
+#include "cmdlineshell/cmdlineshell.h"
+#include "os/atomics.h"
+#include "os/file.h"
+#include "os/filesystem.h"
+#include "os/threadpool.h"
+#include "tinystl/string.h"
+#include "tinystl/vector.h"
+#include "vfile/vfile.hpp"
+#include "image/image.h"
+#include "image/format.h"
+#include "image/format_cracker.h"
+#include "image/block.h"
+#include "image/io.h"
+#include "image/utils.h"
+#include "lz4/xxhash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+// Cooks source images to block compressed, mip mapped DDS files.
+// Each texture is a job on the global thread pool, the mip and block
+// compression stages inside a texture are parallel for's of their own so a
+// few large textures still use every core.
+// Cooked outputs are cached by a hash of the source bytes and the cook
+// settings, so a re-cook only converts sources that have changed. A cache
+// hit costs hashing the mapped source and mapping the cached output.
+
+namespace {
+
+// bump when cooking changes, so cache entries from older cooks miss
+#define COOK_VERSION 1
+
+enum Stage {
+  Stage_Hash,
+  Stage_Load,
+  Stage_Convert,
+  Stage_MipMap,
+  Stage_Compress,
+  Stage_Save,
+  Stage_Count
+};
+
+char const *const StageNames[Stage_Count] = {
+    "hash",
+    "load",
+    "convert",
+    "mipmap",
+    "compress",
+    "save",
+};
+
+struct CookSettings {
+  Image_Format blockFormat; // UNDEFINED for uncompressed
+  Image_Format sourceFormat; // what the block encoder wants to be given
+  Image_BlockEncodeQuality quality;
+  bool mipMaps;
+  char const *outDir;
+  // seeds the source hash so each setting gets its own cache entries
+  uint64_t settingsHash;
+};
+
+// cached outputs are <dir>/<key>.dds, index.txt lists the keys and which
+// source made them. New entries are appended after each cook. Identical
+// sources share a key, so an entry is cooked to a file of its own and
+// renamed into place once complete
+struct CookCache {
+  tinystl::string dir;
+  // sorted
+  tinystl::vector<uint64_t> keys;
+
+  tinystl::string PathOf(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.dds", (unsigned long long) key);
+    return dir + name;
+  }
+
+  bool Contains(uint64_t key) const {
+    size_t lo = 0;
+    size_t hi = keys.size();
+    while (lo < hi) {
+      size_t const mid = (lo + hi) / 2;
+      if (keys[mid] < key) { lo = mid + 1; } else { hi = mid; }
+    }
+    return lo < keys.size() && keys[lo] == key;
+  }
+};
+
+struct Texture {
+  tinystl::string src;
+  tinystl::string dst;
+  bool ok;
+  bool cacheHit;
+  uint64_t key;
+  uint64_t pixelCount;
+  uint64_t byteCount;
+};
+
+struct CookJob {
+  CookSettings const *settings;
+  Texture *textures;
+  CookCache const *cache; // null if caching is off
+  Os_atomic64_t stageUSecs[Stage_Count];
+};
+
+// os only has a high res timer on apple, the tool builds everywhere
+int64_t NowUSec() {
+  using namespace std::chrono;
+  return (int64_t) duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+struct StageTimer {
+  explicit StageTimer(CookJob *job_) : job(job_), start(NowUSec()) {}
+
+  void Stamp(Stage stage) {
+    int64_t const now = NowUSec();
+    Os_AtomicAdd64(&job->stageUSecs[stage], (uint64_t) (now - start));
+    start = now;
+  }
+
+  CookJob *job;
+  int64_t start;
+};
+
+struct FormatName {
+  char const *name;
+  Image_Format format;
+};
+
+FormatName const FormatNames[] = {
+    {"bc1", Image_Format_BC1_RGBA_UNORM_BLOCK},
+    {"bc3", Image_Format_BC3_UNORM_BLOCK},
+    {"bc4", Image_Format_BC4_UNORM_BLOCK},
+    {"bc5", Image_Format_BC5_UNORM_BLOCK},
+    {"bc6h", Image_Format_BC6H_UFLOAT_BLOCK},
+    {"bc7", Image_Format_BC7_UNORM_BLOCK},
+    {"none", Image_Format_UNDEFINED},
+};
+
+char const *const SourceExtensions[] = {
+    "png", "jpg", "jpeg", "tga", "bmp", "gif", "psd", "hdr", "exr", "dds", "ktx2", "pvr",
+};
+
+Image_Format SourceFormatOf(Image_Format blockFormat) {
+  if (blockFormat == Image_Format_BC6H_UFLOAT_BLOCK) { return Image_Format_R16G16B16_SFLOAT; }
+  if (blockFormat == Image_Format_UNDEFINED) { return Image_Format_R8G8B8A8_UNORM; }
+  switch (Image_Format_ChannelCount(blockFormat)) {
+    case 1: return Image_Format_R8_UNORM;
+    case 2: return Image_Format_R8G8_UNORM;
+    case 3: return Image_Format_R8G8B8_UNORM;
+    default: return Image_Format_R8G8B8A8_UNORM;
+  }
+}
+
+bool IsSourceImage(char const *name) {
+  size_t extension = 0;
+  if (!Os_SplitPath(name, nullptr, &extension) || extension == 0) { return false; }
+  for (auto ext : SourceExtensions) {
+    if (stricmp(name + extension, ext) == 0) { return true; }
+  }
+  return false;
+}
+
+bool IsPowerOf2(uint32_t v) { return v && (v & (v - 1)) == 0; }
+
+struct DirScan {
+  tinystl::string dir;
+  tinystl::vector<tinystl::string> *files;
+};
+
+void AddDirEntry(char const *name, bool isDir, void *userData) {
+  DirScan *scan = (DirScan *) userData;
+  if (!isDir && IsSourceImage(name)) {
+    scan->files->push_back(scan->dir + name);
+  }
+}
+
+// blank lines and lines starting with # are skipped
+bool ReadLines(char const *fileName, tinystl::vector<tinystl::string> *lines) {
+  VFile::ScopedFile file = VFile::File::FromFile(fileName, Os_FM_ReadBinary);
+  if (!file) {
+    return false;
+  }
+  size_t const size = file->Size();
+  tinystl::string text;
+  text.resize(size);
+  if (file->Read(text.data(), size) != size) { return false; }
+
+  char const *line = text.c_str();
+  char const *const end = line + size;
+  while (line < end) {
+    char const *eol = line;
+    while (eol < end && *eol != '\n') { ++eol; }
+    char const *last = eol;
+    while (last > line && (last[-1] == '\r' || last[-1] == ' ' || last[-1] == '\t')) { --last; }
+    if (last > line && *line != '#') {
+      lines->push_back(tinystl::string(line, last - line));
+    }
+    line = eol + 1;
+  }
+  return true;
+}
+
+int CompareKeys(void const *a, void const *b) {
+  uint64_t const ka = *(uint64_t const *) a;
+  uint64_t const kb = *(uint64_t const *) b;
+  return (ka < kb) ? -1 : (ka > kb) ? 1 : 0;
+}
+
+void OpenCache(char const *dir, CookCache *cache) {
+  cache->dir = dir;
+  if (cache->dir.back() != '/') { cache->dir.append('/'); }
+
+  tinystl::vector<tinystl::string> lines;
+  ReadLines((cache->dir + "index.txt").c_str(), &lines);
+  for (auto const &line : lines) {
+    char *end = nullptr;
+    uint64_t const key = strtoull(line.c_str(), &end, 16);
+    if (end != line.c_str()) { cache->keys.push_back(key); }
+  }
+  qsort(cache->keys.data(), cache->keys.size(), sizeof(uint64_t), &CompareKeys);
+}
+
+int CompareTextureKeys(void const *a, void const *b) {
+  return CompareKeys(&(*(Texture const *const *) a)->key, &(*(Texture const *const *) b)->key);
+}
+
+// adds the entries of this cook that weren't in the cache already. Stale
+// entries that were cooked again and sources that share a key are already
+// listed, or listed once
+void UpdateCacheIndex(CookCache const *cache, Texture const *textures, size_t count) {
+  tinystl::vector<Texture const *> added;
+  for (size_t i = 0; i < count; ++i) {
+    if (textures[i].ok && !textures[i].cacheHit && !cache->Contains(textures[i].key)) {
+      added.push_back(textures + i);
+    }
+  }
+  if (added.empty()) { return; }
+  qsort(added.data(), added.size(), sizeof(Texture const *), &CompareTextureKeys);
+
+  VFile::ScopedFile file = VFile::File::FromFile((cache->dir + "index.txt").c_str(),
+                                                 (Os_FileMode) (Os_FM_Append | Os_FM_Binary));
+  if (!file) {
+    LOGWARNINGF("Can't write the cook cache index in %s", cache->dir.c_str());
+    return;
+  }
+  for (size_t i = 0; i < added.size(); ++i) {
+    if (i > 0 && added[i]->key == added[i - 1]->key) { continue; }
+    char line[2048];
+    int const size = snprintf(line, sizeof(line), "%016llx %s\n",
+                              (unsigned long long) added[i]->key, added[i]->src.c_str());
+    if (size > 0 && size < (int) sizeof(line)) { file->Write(line, (size_t) size); }
+  }
+}
+
+uint64_t HashSettings(CookSettings const *settings) {
+  uint32_t const fields[] = {
+      COOK_VERSION,
+      (uint32_t) settings->blockFormat,
+      (uint32_t) settings->quality,
+      settings->mipMaps ? 1u : 0u,
+  };
+  return XXH64(fields, sizeof(fields), 0);
+}
+
+// copies a cooked file to where it's wanted
+bool Publish(char const *from, char const *to, uint64_t *byteCount) {
+  size_t size = 0;
+  void const *data = Os_FileMapReadOnly(from, &size);
+  if (!data) { return false; }
+  VFile_Handle handle = VFile_FromFile(to, Os_FM_WriteBinary);
+  bool const ok = handle && VFile_Write(handle, data, size) == size;
+  if (handle) { VFile_Close(handle); }
+  Os_FileUnmap(data, size);
+  *byteCount = size;
+  return ok;
+}
+
+Image_ImageHeader *CompressChain(Image_ImageHeader const *image, CookSettings const *settings) {
+  Image_ImageHeader *top = nullptr;
+  Image_ImageHeader *prev = nullptr;
+  for (size_t i = 0; i < Image_LinkedImageCountOf(image); ++i) {
+    Image_ImageHeader const *level = Image_LinkedImageOf(image, i);
+    // block compressed images must be at least a block, so the chain stops
+    // at the last 4x4 level
+    if (top && (level->width < 4 || level->height < 4)) { break; }
+    Image_ImageHeader *packed = Image_CreateNoClear(level->width, level->height, level->depth, level->slices,
+                                                    settings->blockFormat);
+    if (!packed) {
+      if (top) { Image_Destroy(top); }
+      return nullptr;
+    }
+    size_t const srcPageBytes = Image_ByteCountPerPageOf(level);
+    size_t const dstPageBytes = Image_ByteCountPerPageOf(packed);
+    for (uint32_t page = 0; page < level->depth * level->slices; ++page) {
+      uint8_t *dst = (uint8_t *) Image_RawDataPtr(packed) + page * dstPageBytes;
+      uint8_t const *src = (uint8_t const *) Image_RawDataPtr(level) + page * srcPageBytes;
+      if (Image_IsTiled(level)) {
+        Image_BlockEncodeTiledCompressedData(dst, src, (int) level->width, (int) level->height,
+                                             settings->blockFormat, settings->quality);
+      } else {
+        Image_BlockEncodeCompressedData(dst, src, (int) level->width, (int) level->height,
+                                        settings->blockFormat, settings->quality);
+      }
+    }
+    if (prev) {
+      prev->nextImage = packed;
+      prev->nextType = Image_IT_MipMaps;
+    } else {
+      top = packed;
+      top->flags |= image->flags & Image_Flag_Cubemap;
+    }
+    prev = packed;
+  }
+  return top;
+}
+
+void CookTexture(void *data, uint32_t index) {
+  CookJob *job = (CookJob *) data;
+  CookSettings const *settings = job->settings;
+  Texture *texture = job->textures + index;
+  StageTimer timer(job);
+
+  // the source is mapped once, for the hash and if needed the load
+  size_t srcSize = 0;
+  void const *src = Os_FileMapReadOnly(texture->src.c_str(), &srcSize);
+  if (!src) {
+    LOGERRORF("Can't load %s", texture->src.c_str());
+    return;
+  }
+  texture->key = XXH64(src, srcSize, settings->settingsHash);
+  timer.Stamp(Stage_Hash);
+
+  tinystl::string const cachePath = job->cache ? job->cache->PathOf(texture->key) : tinystl::string();
+  if (job->cache && job->cache->Contains(texture->key)) {
+    Os_FileUnmap(src, srcSize);
+    texture->ok = Publish(cachePath.c_str(), texture->dst.c_str(), &texture->byteCount);
+    texture->cacheHit = texture->ok;
+    timer.Stamp(Stage_Save);
+    if (texture->ok) { return; }
+    // the entry is stale so cook it again
+    src = Os_FileMapReadOnly(texture->src.c_str(), &srcSize);
+    if (!src) { return; }
+    timer.Stamp(Stage_Hash);
+  }
+
+  VFile_Handle srcFile = VFile_FromMemory((void *) src, srcSize, false);
+  Image_ImageHeader *image = srcFile ? Image_Load(srcFile) : nullptr;
+  if (srcFile) { VFile_Close(srcFile); }
+  Os_FileUnmap(src, srcSize);
+  timer.Stamp(Stage_Load);
+  if (!image) {
+    LOGERRORF("Can't load %s", texture->src.c_str());
+    return;
+  }
+  if (Image_Format_IsCompressed(image->format) || image->nextType != Image_IT_None) {
+    LOGWARNINGF("%s is already cooked, skipping", texture->src.c_str());
+    Image_Destroy(image);
+    return;
+  }
+  texture->pixelCount = Image_PixelCountOf(image);
+
+  Image_ImageHeader *converted = Image_FastConvert(image, settings->sourceFormat, true);
+  if (!converted) { converted = Image_PreciseConvert(image, settings->sourceFormat); }
+  if (converted != image) { Image_Destroy(image); }
+  image = converted;
+  timer.Stamp(Stage_Convert);
+  if (!image) {
+    LOGERRORF("Can't convert %s to %s", texture->src.c_str(), Image_Format_Name(settings->sourceFormat));
+    return;
+  }
+
+  // large images are tiled so mip generation and block encoding work a tile
+  // at a time, the cooked output is linear either way
+  if (image->width > IMAGE_TILE_DIM || image->height > IMAGE_TILE_DIM) {
+    Image_ConvertToTiled(image);
+  }
+
+  if (settings->mipMaps) {
+    if (image->depth == 1 && IsPowerOf2(image->width) && IsPowerOf2(image->height)) {
+      Image_CreateMipMapChain(image, true);
+    } else {
+      LOGWARNINGF("%s isn't a power of 2 2D image so has no mip maps", texture->src.c_str());
+    }
+  }
+  timer.Stamp(Stage_MipMap);
+
+  if (settings->blockFormat != Image_Format_UNDEFINED) {
+    Image_ImageHeader *packed = CompressChain(image, settings);
+    Image_Destroy(image);
+    image = packed;
+  } else {
+    for (size_t i = 0; i < Image_LinkedImageCountOf(image); ++i) {
+      Image_ConvertToLinear((Image_ImageHeader *) Image_LinkedImageOf(image, i));
+    }
+  }
+  timer.Stamp(Stage_Compress);
+  if (!image) {
+    LOGERRORF("Can't compress %s", texture->src.c_str());
+    return;
+  }
+
+  // Image_SaveDDS closes the file. With a cache the output is cooked into a
+  // file only this job writes, copied out and then renamed into the cache.
+  // If the rename fails another job has the entry (identical source) in use
+  tinystl::string savePath = texture->dst;
+  if (job->cache) {
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%u.tmp", index);
+    savePath = cachePath + suffix;
+  }
+  texture->ok = Image_SaveDDS(image, VFile_FromFile(savePath.c_str(), Os_FM_WriteBinary));
+  texture->byteCount = Image_ByteCountOfImageChainOf(image);
+  Image_Destroy(image);
+  if (job->cache) {
+    texture->ok = texture->ok && Publish(savePath.c_str(), texture->dst.c_str(), &texture->byteCount);
+    if (!texture->ok || !Os_FileRename(savePath.c_str(), cachePath.c_str())) {
+      Os_FileDelete(savePath.c_str());
+    }
+  }
+  timer.Stamp(Stage_Save);
+  if (!texture->ok) {
+    LOGERRORF("Can't save %s", texture->dst.c_str());
+  }
+}
+
+void PrintUsage() {
+  printf("texture_cooker <source dir | manifest> <output dir> [options]\n"
+         "  -format bc1|bc3|bc4|bc5|bc6h|bc7|none  (default bc7)\n"
+         "  -quality fast|normal|slow             (default normal)\n"
+         "  -nomips\n"
+         "  -cache <dir>                          (default <output dir>/cookcache)\n"
+         "  -nocache\n");
+}
+
+} // end anon namespace
+
+EXTERN_C int Main(int argc, char const *argv[]) {
+  if (argc < 3) {
+    PrintUsage();
+    return 10;
+  }
+
+  CookSettings settings;
+  settings.blockFormat = Image_Format_BC7_UNORM_BLOCK;
+  settings.quality = Image_BEQ_Normal;
+  settings.mipMaps = true;
+  settings.outDir = argv[2];
+  bool useCache = true;
+  tinystl::string cacheDir = tinystl::string(argv[2]) + "/cookcache";
+
+  for (int i = 3; i < argc; ++i) {
+    if (strcmp(argv[i], "-nomips") == 0) {
+      settings.mipMaps = false;
+    } else if (strcmp(argv[i], "-nocache") == 0) {
+      useCache = false;
+    } else if (strcmp(argv[i], "-cache") == 0 && i + 1 < argc) {
+      cacheDir = argv[++i];
+    } else if (strcmp(argv[i], "-format") == 0 && i + 1 < argc) {
+      char const *name = argv[++i];
+      bool found = false;
+      for (auto const &fn : FormatNames) {
+        if (strcmp(fn.name, name) == 0) {
+          settings.blockFormat = fn.format;
+          found = true;
+        }
+      }
+      if (!found) {
+        PrintUsage();
+        return 10;
+      }
+    } else if (strcmp(argv[i], "-quality") == 0 && i + 1 < argc) {
+      char const *name = argv[++i];
+      if (strcmp(name, "fast") == 0) { settings.quality = Image_BEQ_Fast; }
+      else if (strcmp(name, "normal") == 0) { settings.quality = Image_BEQ_Normal; }
+      else if (strcmp(name, "slow") == 0) { settings.quality = Image_BEQ_Slow; }
+      else {
+        PrintUsage();
+        return 10;
+      }
+    } else {
+      PrintUsage();
+      return 10;
+    }
+  }
+  settings.sourceFormat = SourceFormatOf(settings.blockFormat);
+  settings.settingsHash = HashSettings(&settings);
+
+  tinystl::vector<tinystl::string> sources;
+  if (Os_DirExists(argv[1])) {
+    DirScan scan;
+    scan.dir = argv[1];
+    if (scan.dir.back() != '/') { scan.dir.append('/'); }
+    scan.files = &sources;
+    Os_EnumerateDir(argv[1], &AddDirEntry, &scan);
+  } else if (!ReadLines(argv[1], &sources)) {
+    LOGERRORF("Can't open manifest %s", argv[1]);
+    return 10;
+  }
+  if (sources.empty()) {
+    printf("Nothing to cook in %s\n", argv[1]);
+    return 0;
+  }
+  if (!Os_DirExists(settings.outDir) && !Os_CreateDir(settings.outDir)) {
+    LOGERRORF("Can't create %s", settings.outDir);
+    return 10;
+  }
+  CookCache cache;
+  if (useCache) {
+    if (!Os_DirExists(cacheDir.c_str()) && !Os_CreateDir(cacheDir.c_str())) {
+      LOGWARNINGF("Can't create %s, cooking without a cache", cacheDir.c_str());
+      useCache = false;
+    } else {
+      OpenCache(cacheDir.c_str(), &cache);
+    }
+  }
+
+  tinystl::vector<Texture> textures(sources.size());
+  for (size_t i = 0; i < sources.size(); ++i) {
+    Texture &texture = textures[i];
+    size_t fileName = 0;
+    Os_SplitPath(sources[i].c_str(), &fileName, nullptr);
+    char ddsName[2048];
+    Os_ReplaceExtension(sources[i].c_str() + fileName, "dds", ddsName, sizeof(ddsName));
+    texture.src = sources[i];
+    texture.dst = tinystl::string(settings.outDir);
+    if (texture.dst.back() != '/') { texture.dst.append('/'); }
+    texture.dst += ddsName;
+    texture.ok = false;
+    texture.cacheHit = false;
+    texture.key = 0;
+    texture.pixelCount = 0;
+    texture.byteCount = 0;
+  }
+
+  CookJob job;
+  memset(&job, 0, sizeof(job));
+  job.settings = &settings;
+  job.textures = textures.data();
+  job.cache = useCache ? &cache : nullptr;
+
+  int64_t const start = NowUSec();
+  Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &CookTexture, &job, (uint32_t) textures.size());
+  double const wallSecs = (double) (NowUSec() - start) / 1e6;
+  if (useCache) {
+    UpdateCacheIndex(&cache, textures.data(), textures.size());
+  }
+
+  uint32_t cooked = 0;
+  uint32_t cacheHits = 0;
+  uint64_t pixelCount = 0;
+  uint64_t byteCount = 0;
+  for (auto const &texture : textures) {
+    if (!texture.ok) { continue; }
+    cooked++;
+    cacheHits += texture.cacheHit ? 1 : 0;
+    pixelCount += texture.pixelCount;
+    byteCount += texture.byteCount;
+  }
+
+  // stage times are summed over every texture job so can add up to more
+  // than the wall time
+  printf("cooked %u of %u textures (%u from the cache) on %u threads in %.3fs\n",
+         cooked, (uint32_t) textures.size(), cacheHits,
+         Os_ThreadPoolWorkerCount(Os_ThreadPoolGlobal()) + 1, wallSecs);
+  uint64_t totalUSecs = 0;
+  for (uint32_t i = 0; i < Stage_Count; ++i) {
+    totalUSecs += job.stageUSecs[i];
+  }
+  for (uint32_t i = 0; i < Stage_Count; ++i) {
+    printf("  %-9s %10.3fs %5.1f%%\n", StageNames[i], (double) job.stageUSecs[i] / 1e6,
+           totalUSecs ? 100.0 * (double) job.stageUSecs[i] / (double) totalUSecs : 0.0);
+  }
+  if (wallSecs > 0.0) {
+    printf("  %.2f textures/s, %.2f MPixels/s, %.2f MB/s written\n",
+           (double) cooked / wallSecs,
+           (double) pixelCount / 1e6 / wallSecs,
+           (double) byteCount / (1024.0 * 1024.0) / wallSecs);
+  }
+
+  return cooked == textures.size() ? 0 : 10;
+}
@@ -607,8 +607,8 @@ static const flex_int16_t yy_rule_linenum[35] =
                     return yy::parser::token::T_##tok;
 
     #define YY_TXT                  std::string(yytext, yyleng)
-    #define YY_FNUM					std::stod(std::string(yytext, yyleng))
-    #define YY_INUM(base)           std::stoull(std::string(yytext, yyleng), 0, base)    
+    #define YY_FNUM					[&] { double d = 0.0; Core_ParseDouble(yytext, yytext + yyleng, &d); return d; }()
+    #define YY_INUM(base)           [&] { uint64_t i = 0; Core_ParseUInt64(yytext, yytext + yyleng, base, &i); return i; }()
 
     #define INT_TOKEN(base)     	YIELD_TOKEN(INTNUM, YY_INUM(base), int64_t)
     #define FLT_TOKEN()          	YIELD_TOKEN(FPNUM, YY_FNUM, double)
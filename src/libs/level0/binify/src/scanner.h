@@ -8,6 +8,7 @@
 # undef yyFlexLexer
 # include "FlexLexer.h"
 # include "parser.hxx"
+# include "core/parse_number.h"
 
 // Tell flex which function to define
 # undef YY_DECL
@@ -1,6 +1,7 @@
 #include "core/core.h"
 #include "catch/catch.hpp"
 #include "binify/binify_c.h"
+#include <cstring>
 
 TEST_CASE( "Alloc and Free", "[Binify_C]" )
 {
@@ -16,4 +17,27 @@ TEST_CASE( "Empty Parse", "[Binify_C]" )
 	REQUIRE(result);
 	size_t size = BINIFY_BinarySize(handle);
 	REQUIRE(size == 0);
-}
\ No newline at end of file
+}
+TEST_CASE( "Numeric Literals", "[Binify_C]" )
+{
+	BINIFY_HANDLE const * handle = BINIFY_Alloc();
+	int result = BINIFY_Parse(handle, "(u32)0b101, (u32)0x1F, (u32)42, (double)0.1, (float)3.4028235e+38, (double)-2.5e-3\n");
+	REQUIRE(result);
+	size_t size = BINIFY_BinarySize(handle);
+	REQUIRE(size == 3 * 4 + 8 + 4 + 8);
+	uint8_t const* data = BINIFY_BinaryData(handle);
+	uint32_t u[3];
+	double d[2];
+	float f;
+	memcpy(u, data, sizeof(u));
+	memcpy(&d[0], data + 12, sizeof(double));
+	memcpy(&f, data + 20, sizeof(float));
+	memcpy(&d[1], data + 24, sizeof(double));
+	REQUIRE(u[0] == 5);
+	REQUIRE(u[1] == 0x1F);
+	REQUIRE(u[2] == 42);
+	REQUIRE(d[0] == 0.1);
+	REQUIRE(f == 3.4028235e38f);
+	REQUIRE(d[1] == -2.5e-3);
+	BINIFY_Free(handle);
+}
@@ -26,6 +26,7 @@ fn main() {
     let mut bindings = bindgen::Builder::default()
         .header(String::new() + &libinc + &libname + "/" + "core.h")
         .header(String::new() + &libinc + &libname + "/" + "logger.h")
+        .header(String::new() + &libinc + &libname + "/" + "parse_number.h")
         .clang_arg(String::new() + "-I" + &libinc)
         .clang_arg("-D_RUST_BINDGEN_");
 
@@ -18,7 +18,13 @@ typedef struct Core_Logger_t {
 
 } Core_Logger;
 
+// declared extern in C too, a bare declaration there is a tentative
+// definition that clashes with logger.c when built with -fno-common
+#ifdef __cplusplus
 EXTERN_C Core_Logger Core_Log;
+#else
+extern Core_Logger Core_Log;
+#endif
 
 EXTERN_C void OutputDebug(char const *msg);
 
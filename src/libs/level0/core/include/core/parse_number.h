@@ -0,0 +1,27 @@
+#pragma once
+#ifndef WYRD_CORE_PARSE_NUMBER_H
+#define WYRD_CORE_PARSE_NUMBER_H
+
+#include "core/core.h"
+
+// Number parsing for text formats. Parses from s up to (not including) end,
+// no null terminator is needed. Returns one past the last character used or
+// s if there isn't a number at s, out is only written on success.
+// Unlike strtod these never skip leading white space and ignore the locale.
+
+// [+-] digits [. digits] [(e|E) [+-] digits], either the integer or fraction
+// digits may be empty but not both, or [+-] inf, infinity or nan in any case.
+// Correctly rounded (round to nearest, ties to even) so bit exact with
+// strtod and strtof, out of range values give +-inf or +-0
+EXTERN_C char const *Core_ParseDouble(char const *s, char const *end, double *out);
+EXTERN_C char const *Core_ParseFloat(char const *s, char const *end, float *out);
+
+// [+-] digits in base 10, wraps on overflow like the usual atoi loops
+EXTERN_C char const *Core_ParseInt32(char const *s, char const *end, int32_t *out);
+EXTERN_C char const *Core_ParseInt64(char const *s, char const *end, int64_t *out);
+
+// [+-] [0x|0b] digits in base 2, 8, 10 or 16, the prefix only for base 16 or 2.
+// A leading - negates the result modulo 2^64 like strtoull
+EXTERN_C char const *Core_ParseUInt64(char const *s, char const *end, int base, uint64_t *out);
+
+#endif //WYRD_CORE_PARSE_NUMBER_H
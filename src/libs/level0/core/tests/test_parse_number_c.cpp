@@ -0,0 +1,203 @@
+#include "core/core.h"
+#include "cmdlineshell/cmdlineshell.h"
+
+#define CATCH_CONFIG_RUNNER
+#include "catch/catch.hpp"
+
+int Main(int argc, char const *argv[]) {
+  return Catch::Session().run(argc, (char**)argv);
+}
+
+#include "core/parse_number.h"
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+static uint64_t DoubleBits(double d) {
+  uint64_t bits;
+  memcpy(&bits, &d, sizeof(double));
+  return bits;
+}
+
+static uint32_t FloatBits(float f) {
+  uint32_t bits;
+  memcpy(&bits, &f, sizeof(float));
+  return bits;
+}
+
+// compares against strtod/strtof including how much of the string is used
+static bool MatchesLibC(char const *str) {
+  size_t const len = strlen(str);
+  char *libcEnd = nullptr;
+  double const expectedD = strtod(str, &libcEnd);
+  float const expectedF = strtof(str, nullptr);
+  double d = 0.0;
+  float f = 0.0f;
+
+  char const *end = Core_ParseDouble(str, str + len, &d);
+  if (end != libcEnd || DoubleBits(d) != DoubleBits(expectedD)) {
+    WARN(str << " double " << d << " expected " << expectedD);
+    return false;
+  }
+  end = Core_ParseFloat(str, str + len, &f);
+  if (end != libcEnd || FloatBits(f) != FloatBits(expectedF)) {
+    WARN(str << " float " << f << " expected " << expectedF);
+    return false;
+  }
+  return true;
+}
+
+TEST_CASE("Parse number simple (C)", "[Core]") {
+  char const *const strings[] = {
+      "0", "-0", "+0", "1", "-1", "0.5", ".5", "5.", "-.25e2", "3.1417e+2", "-0.0E-3", "1.0324", "-1.41",
+      "11e2", "1e", "1e+", "2.5e-x", "0.1", "0.2", "0.3", "123456789", "1e22", "1e23", "9007199254740993",
+      "1.7976931348623157e308", "1.7976931348623159e308", "2e308", "4.9406564584124654e-324",
+      "2.4703282292062327e-324", "2.4703282292062328e-324", "1e-400", "2.2250738585072011e-308",
+      "2.2250738585072014e-308", "3.4028235e38", "3.4028236e38", "1.17549435e-38", "1.4e-45", "7e-46",
+      "0.000000000000000000000000000000000000000000000000001", "00000000000000000000000000000000012.5",
+      "1.00000000000000011102230246251565404236316680908203125",
+      "1.00000000000000011102230246251565404236316680908203124",
+      "1.00000000000000011102230246251565404236316680908203126",
+      "16777217", "16777216.000000000001", "33554435", "1.000000059604644775390625",
+      "1.000000059604644775390624", "123456789012345678901234567890", "0.1234567890123456789012345678",
+      "7.038531e-26", "inf", "-Infinity", "INFINITY", "nan", "-NaN", "infinit", "1.5 2.5", "1/2/3",
+  };
+  for (char const *str : strings) {
+    REQUIRE(MatchesLibC(str));
+  }
+}
+
+TEST_CASE("Parse number failures and bounds (C)", "[Core]") {
+  char const *const strings[] = {"", "+", "-", ".", "+.", "e5", "x", "-x", " 1"};
+  for (char const *str : strings) {
+    double d = 42.0;
+    float f = 42.0f;
+    int64_t i = 42;
+    REQUIRE(Core_ParseDouble(str, str + strlen(str), &d) == str);
+    REQUIRE(Core_ParseFloat(str, str + strlen(str), &f) == str);
+    REQUIRE(Core_ParseInt64(str, str + strlen(str), &i) == str);
+    REQUIRE(d == 42.0);
+    REQUIRE(f == 42.0f);
+    REQUIRE(i == 42);
+  }
+
+  // nothing at or past end is looked at
+  char const buffer[] = "12345678901234567890.25e3";
+  double d = 0.0;
+  REQUIRE(Core_ParseDouble(buffer, buffer + 3, &d) == buffer + 3);
+  REQUIRE(d == 123.0);
+  REQUIRE(Core_ParseDouble(buffer, buffer + 24, &d) == buffer + 23);
+  REQUIRE(d == 12345678901234567890.25);
+  int64_t i = 0;
+  REQUIRE(Core_ParseInt64(buffer, buffer + 9, &i) == buffer + 9);
+  REQUIRE(i == 123456789);
+}
+
+TEST_CASE("Parse number integers (C)", "[Core]") {
+  char const *str = "-123456789012 rest";
+  int64_t i64 = 0;
+  REQUIRE(Core_ParseInt64(str, str + strlen(str), &i64) == str + 13);
+  REQUIRE(i64 == -123456789012LL);
+
+  int32_t i32 = 0;
+  str = "+2147483647";
+  REQUIRE(Core_ParseInt32(str, str + strlen(str), &i32) == str + strlen(str));
+  REQUIRE(i32 == 2147483647);
+  str = "-17/4/2";
+  REQUIRE(Core_ParseInt32(str, str + strlen(str), &i32) == str + 3);
+  REQUIRE(i32 == -17);
+
+  uint64_t u = 0;
+  str = "18446744073709551615";
+  REQUIRE(Core_ParseUInt64(str, str + strlen(str), 10, &u) == str + strlen(str));
+  REQUIRE(u == UINT64_MAX);
+  str = "0xDeadBeef";
+  REQUIRE(Core_ParseUInt64(str, str + strlen(str), 16, &u) == str + strlen(str));
+  REQUIRE(u == 0xDEADBEEFull);
+  str = "-0x10";
+  REQUIRE(Core_ParseUInt64(str, str + strlen(str), 16, &u) == str + strlen(str));
+  REQUIRE((int64_t) u == -16);
+  str = "0b1011";
+  REQUIRE(Core_ParseUInt64(str, str + strlen(str), 2, &u) == str + strlen(str));
+  REQUIRE(u == 11);
+  str = "0x";
+  REQUIRE(Core_ParseUInt64(str, str + strlen(str), 16, &u) == str + 1);
+  REQUIRE(u == 0);
+  str = "0777";
+  REQUIRE(Core_ParseUInt64(str, str + strlen(str), 8, &u) == str + strlen(str));
+  REQUIRE(u == 0777);
+  REQUIRE(Core_ParseUInt64(str, str + strlen(str), 7, &u) == str);
+
+  // digit runs long enough for the 8 and 16 wide paths
+  char digits[64];
+  for (int n = 1; n <= 19; n++) {
+    uint64_t expected = 0;
+    for (int c = 0; c < n; c++) {
+      digits[c] = (char) ('1' + (c % 9));
+      expected = expected * 10 + (uint64_t) (1 + (c % 9));
+    }
+    strcpy(digits + n, "                ");
+    REQUIRE(Core_ParseUInt64(digits, digits + strlen(digits), 10, &u) == digits + n);
+    REQUIRE(u == expected);
+  }
+}
+
+TEST_CASE("Parse number matches strtod (C)", "[Core]") {
+  std::mt19937_64 rng(0x5eed);
+  char str[512];
+  int failures = 0;
+
+  for (int i = 0; i < 200000; i++) {
+    uint64_t bits = rng();
+    double d;
+    memcpy(&d, &bits, sizeof(double));
+    if (!std::isfinite(d)) continue;
+    snprintf(str, sizeof(str), "%.17g", d);
+    failures += MatchesLibC(str) ? 0 : 1;
+    snprintf(str, sizeof(str), "%.*g", (int) (rng() % 17) + 1, d);
+    failures += MatchesLibC(str) ? 0 : 1;
+
+    float f;
+    uint32_t const fbits = (uint32_t) bits;
+    memcpy(&f, &fbits, sizeof(float));
+    if (!std::isfinite(f)) continue;
+    snprintf(str, sizeof(str), "%.9g", (double) f);
+    failures += MatchesLibC(str) ? 0 : 1;
+  }
+
+  // random digits of random lengths, many past 19 digits
+  for (int i = 0; i < 200000; i++) {
+    int const intDigits = (int) (rng() % 25);
+    int const fracDigits = (int) (rng() % 25);
+    int n = 0;
+    if (rng() & 1) str[n++] = '-';
+    for (int c = 0; c < intDigits; c++) str[n++] = (char) ('0' + rng() % 10);
+    str[n++] = '.';
+    for (int c = 0; c < fracDigits; c++) str[n++] = (char) ('0' + rng() % 10);
+    if (intDigits + fracDigits == 0) str[n++] = '7';
+    if (rng() & 1) n += snprintf(str + n, sizeof(str) - n, "e%d", (int) (rng() % 700) - 350);
+    str[n] = 0;
+    failures += MatchesLibC(str) ? 0 : 1;
+  }
+
+  // exactly half way between two doubles, which must round to even. Short
+  // integers take the fast path, the rest are too many digits
+  for (int i = 0; i < 100000 && LDBL_MANT_DIG >= 64; i++) {
+    uint64_t const mantissa = (rng() >> 11) | (UINT64_C(1) << 52);
+    bool const shortTie = (i & 1) != 0;
+    int const exponent = shortTie ? (int) (rng() % 11) : (int) (rng() % 200) - 100;
+    double const below = std::ldexp((double) mantissa, exponent);
+    double const above = std::nextafter(below, (double) INFINITY);
+    long double const tie = ((long double) below + (long double) above) / 2;
+    if (shortTie) {
+      snprintf(str, sizeof(str), "%.0Lf", tie);
+    } else {
+      snprintf(str, sizeof(str), "%.200Le", tie);
+    }
+    failures += MatchesLibC(str) ? 0 : 1;
+  }
+  REQUIRE(failures == 0);
+}
@@ -115,7 +115,11 @@ EXTERN_C inline uint64_t Math_GetClosestPowerOfTwoU64(const uint64_t x) {
 }
 
 
+#ifdef __cplusplus
 EXTERN_C uint8_t Math_LogTable256[256];
+#else
+extern uint8_t Math_LogTable256[256];
+#endif
 
 /// \brief	return Log2 of v.
 /// return log2 of an int. this is equivalent to finding the highest bit that has been set
@@ -163,7 +167,11 @@ EXTERN_C inline float Math_SRGB2FloatInexact(float val) {
   return val;
 }
 
+#ifdef __cplusplus
 EXTERN_C uint32_t Math_SRGBTable[256];
+#else
+extern uint32_t Math_SRGBTable[256];
+#endif
 
 EXTERN_C inline float Math_SRGB2Float(uint32_t val) {
   ASSERT(val <= 255);
@@ -31,6 +31,7 @@ struct ConditionalVariable {
     Os_ConditionalVariableWait(&handle, &mutex.handle, waitms);
   }
   void Set() { Os_ConditionalVariableSet(&handle); };
+  void Broadcast() { Os_ConditionalVariableBroadcast(&handle); };
 
   Os_ConditionalVariable_t handle;
 };
@@ -0,0 +1,47 @@
+#pragma once
+#ifndef WYRD_OS_THREADPOOL_HPP
+#define WYRD_OS_THREADPOOL_HPP
+
+#include "core/core.h"
+#include "os/threadpool.h"
+
+namespace Os {
+
+struct ThreadPool {
+  explicit ThreadPool(uint32_t workerCount) : handle(Os_ThreadPoolCreate(workerCount)), owned(true) {}
+  ~ThreadPool() { if (owned) { Os_ThreadPoolDestroy(handle); } }
+
+  /// Prevent copy construction.
+  ThreadPool(const ThreadPool& rhs) = delete;
+  /// Prevent assignment.
+  ThreadPool& operator=(const ThreadPool& rhs) = delete;
+
+  static ThreadPool& Global() {
+    static ThreadPool global(Os_ThreadPoolGlobal());
+    return global;
+  }
+
+  uint32_t WorkerCount() const { return Os_ThreadPoolWorkerCount(handle); }
+
+  // func is any callable taking a uint32_t index
+  template<typename F>
+  void ParallelFor(uint32_t count, F const& func) {
+    Os_ThreadPoolParallelFor(handle, &Trampoline<F>, (void *) &func, count);
+  }
+
+  Os_ThreadPoolHandle handle;
+
+private:
+  explicit ThreadPool(Os_ThreadPoolHandle pool) : handle(pool), owned(false) {}
+
+  template<typename F>
+  static void Trampoline(void *data, uint32_t index) {
+    (*(F const *) data)(index);
+  }
+
+  bool owned;
+};
+
+} // end Os namespace
+
+#endif //WYRD_OS_THREADPOOL_HPP
@@ -41,6 +41,12 @@ EXTERN_C int64_t Os_FileTell(Os_FileHandle handle);
 EXTERN_C size_t Os_FileSize(Os_FileHandle handle);
 EXTERN_C bool Os_FileIsEOF(Os_FileHandle handle);
 
+/// Maps the whole of a file into memory read only, size is set to the file
+/// size. Returns NULL if the file can't be opened or is empty.
+/// The mapping stays valid until unmapped, even if the file is deleted
+EXTERN_C void const *Os_FileMapReadOnly(char const *filename, size_t *size);
+EXTERN_C void Os_FileUnmap(void const *memory, size_t size);
+
 #endif //WYRD_OS_FILE_H
 
 /*
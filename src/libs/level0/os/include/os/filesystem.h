@@ -29,7 +29,15 @@ EXTERN_C bool Os_DirExists(char const *pathName);
 
 EXTERN_C bool Os_FileCopy(char const *src, char const *dst);
 EXTERN_C bool Os_FileDelete(char const *fileName);
+// replaces dst if it exists, readers of dst see the old or the new file
+// never a partial one (src and dst must be on the same volume)
+EXTERN_C bool Os_FileRename(char const *src, char const *dst);
 EXTERN_C bool Os_CreateDir(char const *pathName);
+
+// called for each entry of a directory except . and .., name has no path
+typedef void (*Os_EnumerateDirFunc_t)(char const *name, bool isDir, void *userData);
+// not recursive, false if the directory can't be opened
+EXTERN_C bool Os_EnumerateDir(char const *pathName, Os_EnumerateDirFunc_t func, void *userData);
 EXTERN_C int Os_SystemRun(char const *fileName, int argc, const char **argv);
 
 
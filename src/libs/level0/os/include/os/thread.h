@@ -46,6 +46,7 @@ EXTERN_C bool Os_ConditionalVariableCreate(Os_ConditionalVariable_t *cd);
 EXTERN_C void Os_ConditionalVariableDestroy(Os_ConditionalVariable_t *cd);
 EXTERN_C void Os_ConditionalVariableWait(Os_ConditionalVariable_t *cd, Os_Mutex_t *mutex, uint64_t waitms);
 EXTERN_C void Os_ConditionalVariableSet(Os_ConditionalVariable_t *cd);
+EXTERN_C void Os_ConditionalVariableBroadcast(Os_ConditionalVariable_t *cd);
 
 EXTERN_C bool Os_ThreadCreate(Os_Thread_t *thread, Os_JobFunction_t func, void *data);
 EXTERN_C void Os_ThreadDestroy(Os_Thread_t *thread);
@@ -0,0 +1,34 @@
+#pragma once
+#ifndef WYRD_OS_THREADPOOL_H
+#define WYRD_OS_THREADPOOL_H
+
+#include "core/core.h"
+
+// A simple fixed size pool of worker threads for data parallel work.
+// The thread calling Os_ThreadPoolParallelFor also processes items of its own
+// job, so parallel fors can be nested (called from inside a task) without
+// deadlocking even when every worker is busy.
+
+typedef struct Os_ThreadPool_t *Os_ThreadPoolHandle;
+
+// called once for each index in [0, count), possibly from several threads
+typedef void (*Os_ThreadPoolTaskFunction_t)(void *data, uint32_t index);
+
+// workerCount 0 is valid, all work will then run on the calling thread
+EXTERN_C Os_ThreadPoolHandle Os_ThreadPoolCreate(uint32_t workerCount);
+EXTERN_C void Os_ThreadPoolDestroy(Os_ThreadPoolHandle pool);
+
+EXTERN_C uint32_t Os_ThreadPoolWorkerCount(Os_ThreadPoolHandle pool);
+
+// runs func(data, index) for every index in [0, count) and returns when all
+// have completed. pool may be NULL in which case it runs serially.
+EXTERN_C void Os_ThreadPoolParallelFor(Os_ThreadPoolHandle pool,
+                                       Os_ThreadPoolTaskFunction_t func,
+                                       void *data,
+                                       uint32_t count);
+
+// process wide pool with a worker for each core except the calling one.
+// created on first use and lives until process exit
+EXTERN_C Os_ThreadPoolHandle Os_ThreadPoolGlobal(void);
+
+#endif //WYRD_OS_THREADPOOL_H
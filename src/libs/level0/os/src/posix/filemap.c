@@ -0,0 +1,39 @@
+#include "core/core.h"
+#include "core/logger.h"
+#include "os/file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+EXTERN_C void const *Os_FileMapReadOnly(char const *filename, size_t *size) {
+  ASSERT(filename);
+  ASSERT(size);
+  *size = 0;
+
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) { return NULL; }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return NULL;
+  }
+
+  // the mapping keeps the file alive so the descriptor isn't needed after
+  void *memory = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED) {
+    LOGERRORF("Unable to map %s", filename);
+    return NULL;
+  }
+
+  *size = (size_t) st.st_size;
+  return memory;
+}
+
+EXTERN_C void Os_FileUnmap(void const *memory, size_t size) {
+  if (!memory) { return; }
+  munmap((void *) memory, size);
+}
@@ -6,6 +6,7 @@
 #include <errno.h>        // errno
 #include <sys/stat.h>     // stat
 #include <stdio.h>        // remove
+#include <dirent.h>       // opendir
 
 // internal and platform path are the same on posix
 EXTERN_C bool Os_IsInternalPath(char const *path) {
@@ -89,6 +90,14 @@ bool Os_FileDelete(char const *fileName) {
 #endif
 }
 
+bool Os_FileRename(char const *src, char const *dst) {
+  char srcBuffer[2048];
+  char dstBuffer[2048];
+  if (!Os_GetPlatformPath(src, srcBuffer, sizeof(srcBuffer))) { return false; }
+  if (!Os_GetPlatformPath(dst, dstBuffer, sizeof(dstBuffer))) { return false; }
+  return rename(srcBuffer, dstBuffer) == 0;
+}
+
 bool Os_CreateDir(char const *pathName) {
   using namespace Os::FileSystem;
 
@@ -197,3 +206,27 @@ int Os_SystemRun(char const *fileName, int argc, const char **argv) {
   }
 #endif
 }
+
+EXTERN_C bool Os_EnumerateDir(char const *pathName, Os_EnumerateDirFunc_t func, void *userData) {
+  char buffer[2048];
+  if (!Os_GetPlatformPath(pathName, buffer, sizeof(buffer))) { return false; }
+  DIR *dir = opendir(buffer);
+  if (!dir) { return false; }
+
+  dirent *entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) { continue; }
+    bool isDir = entry->d_type == DT_DIR;
+    if (entry->d_type == DT_UNKNOWN) {
+      // some filesystems don't fill in d_type, ask stat instead
+      char entryPath[2048];
+      struct stat st;
+      int const len = snprintf(entryPath, sizeof(entryPath), "%s/%s", buffer, entry->d_name);
+      isDir = len > 0 && (size_t) len < sizeof(entryPath) &&
+          stat(entryPath, &st) == 0 && S_ISDIR(st.st_mode);
+    }
+    func(entry->d_name, isDir, userData);
+  }
+  closedir(dir);
+  return true;
+}
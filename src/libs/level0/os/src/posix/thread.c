@@ -5,6 +5,7 @@
 //#include "../Interfaces/IMemoryManager.h"
 
 #include <unistd.h>
+#include <time.h>
 #include <sys/sysctl.h>
 
 EXTERN_C bool Os_MutexCreate(Os_Mutex_t *mutex) {
@@ -42,9 +43,12 @@ EXTERN_C void Os_ConditionalVariableWait(Os_ConditionalVariable_t *cv, Os_Mutex_
   ASSERT(cv);
   ASSERT(mutex);
 
+  // pthread_cond_timedwait takes an absolute time not a duration
   struct timespec ts;
-  ts.tv_sec = 0;
-  ts.tv_nsec = (long) waitms * 1000;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  uint64_t const nsec = (uint64_t) ts.tv_nsec + (waitms % 1000) * 1000000ull;
+  ts.tv_sec += (time_t) (waitms / 1000 + nsec / 1000000000ull);
+  ts.tv_nsec = (long) (nsec % 1000000000ull);
 
   pthread_mutex_t *mutexHandle = mutex;
   pthread_cond_timedwait(cv, mutexHandle, &ts);
@@ -56,6 +60,11 @@ EXTERN_C void Os_ConditionalVariableSet(Os_ConditionalVariable_t *cv) {
   pthread_cond_signal(cv);
 }
 
+EXTERN_C void Os_ConditionalVariableBroadcast(Os_ConditionalVariable_t *cv) {
+  ASSERT(cv);
+  pthread_cond_broadcast(cv);
+}
+
 struct TrampParam {
   Os_JobFunction_t func;
   void *param;
@@ -0,0 +1,168 @@
+#include "core/core.h"
+#include "core/logger.h"
+#include "os/thread.hpp"
+#include "os/atomics.h"
+#include "os/threadpool.h"
+
+namespace {
+
+struct Job {
+  Os_ThreadPoolTaskFunction_t func;
+  void *data;
+  uint32_t count;
+  uint32_t nextIndex;
+  uint32_t completed;
+  Job *next;
+};
+
+// idle waits are bounded so a missed wake up only costs a little latency
+static const uint64_t IdleWaitMs = 50;
+
+} // end anon namespace
+
+struct Os_ThreadPool_t {
+  Os::Mutex mutex;
+  Os::ConditionalVariable workCv;
+  Os::ConditionalVariable doneCv;
+
+  // jobs are pushed at the head, so nested parallel fors are serviced first
+  Job *jobs;
+  bool quit;
+
+  uint32_t workerCount;
+  Os_Thread_t *threads;
+};
+
+static Job *FindWork(Os_ThreadPool_t *pool) {
+  for (Job *job = pool->jobs; job != nullptr; job = job->next) {
+    if (job->nextIndex < job->count) { return job; }
+  }
+  return nullptr;
+}
+
+// mutex must be held on entry and is held on exit
+static void RunOneItem(Os_ThreadPool_t *pool, Job *job) {
+  uint32_t const index = job->nextIndex++;
+  pool->mutex.Release();
+  job->func(job->data, index);
+  pool->mutex.Acquire();
+  job->completed++;
+  if (job->completed == job->count) {
+    pool->doneCv.Broadcast();
+  }
+}
+
+static void WorkerThread(void *data) {
+  Os_ThreadPool_t *pool = (Os_ThreadPool_t *) data;
+
+  pool->mutex.Acquire();
+  while (!pool->quit) {
+    Job *job = FindWork(pool);
+    if (job == nullptr) {
+      pool->workCv.Wait(pool->mutex, IdleWaitMs);
+      continue;
+    }
+    RunOneItem(pool, job);
+  }
+  pool->mutex.Release();
+}
+
+EXTERN_C Os_ThreadPoolHandle Os_ThreadPoolCreate(uint32_t workerCount) {
+  Os_ThreadPool_t *pool = new Os_ThreadPool_t;
+  pool->jobs = nullptr;
+  pool->quit = false;
+  pool->workerCount = 0;
+  pool->threads = nullptr;
+
+  if (workerCount == 0) { return pool; }
+
+  pool->threads = (Os_Thread_t *) malloc(sizeof(Os_Thread_t) * workerCount);
+  for (uint32_t i = 0; i < workerCount; ++i) {
+    if (!Os_ThreadCreate(&pool->threads[i], &WorkerThread, pool)) {
+      LOGERRORF("Os_ThreadPoolCreate failed to create worker %u", i);
+      break;
+    }
+    pool->workerCount++;
+  }
+
+  return pool;
+}
+
+EXTERN_C void Os_ThreadPoolDestroy(Os_ThreadPoolHandle pool) {
+  if (!pool) { return; }
+
+  pool->mutex.Acquire();
+  ASSERT(pool->jobs == nullptr);
+  pool->quit = true;
+  pool->workCv.Broadcast();
+  pool->mutex.Release();
+
+  for (uint32_t i = 0; i < pool->workerCount; ++i) {
+    Os_ThreadJoin(&pool->threads[i]);
+  }
+
+  free(pool->threads);
+  delete pool;
+}
+
+EXTERN_C uint32_t Os_ThreadPoolWorkerCount(Os_ThreadPoolHandle pool) {
+  return pool ? pool->workerCount : 0;
+}
+
+EXTERN_C void Os_ThreadPoolParallelFor(Os_ThreadPoolHandle pool,
+                                       Os_ThreadPoolTaskFunction_t func,
+                                       void *data,
+                                       uint32_t count) {
+  ASSERT(func);
+  if (count == 0) { return; }
+
+  if (pool == nullptr || pool->workerCount == 0 || count == 1) {
+    for (uint32_t i = 0; i < count; ++i) {
+      func(data, i);
+    }
+    return;
+  }
+
+  Job job;
+  job.func = func;
+  job.data = data;
+  job.count = count;
+  job.nextIndex = 0;
+  job.completed = 0;
+
+  pool->mutex.Acquire();
+  job.next = pool->jobs;
+  pool->jobs = &job;
+  pool->workCv.Broadcast();
+
+  // the caller works on its own job, never others, so its stack stays bounded
+  while (job.nextIndex < job.count) {
+    RunOneItem(pool, &job);
+  }
+  while (job.completed != job.count) {
+    pool->doneCv.Wait(pool->mutex, IdleWaitMs);
+  }
+
+  // unlink, the job is usually but not always at the head
+  Job **prev = &pool->jobs;
+  while (*prev != &job) { prev = &(*prev)->next; }
+  *prev = job.next;
+  pool->mutex.Release();
+}
+
+EXTERN_C Os_ThreadPoolHandle Os_ThreadPoolGlobal(void) {
+  static void *volatile global = nullptr;
+
+  void *pool = global;
+  if (pool != nullptr) { return (Os_ThreadPoolHandle) pool; }
+
+  uint32_t const cores = Os_CPUCoreCount();
+  Os_ThreadPoolHandle newPool = Os_ThreadPoolCreate(cores > 1 ? cores - 1 : 0);
+  pool = Os_AtomicCompareAndSwapPtr(&global, newPool, nullptr);
+  if (pool != nullptr) {
+    // another thread won the race
+    Os_ThreadPoolDestroy(newPool);
+    return (Os_ThreadPoolHandle) pool;
+  }
+  return newPool;
+}
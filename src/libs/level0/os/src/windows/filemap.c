@@ -0,0 +1,43 @@
+#include "core/windows.h"
+#include "core/core.h"
+#include "core/logger.h"
+#include "os/file.h"
+
+EXTERN_C void const *Os_FileMapReadOnly(char const *filename, size_t *size) {
+  ASSERT(filename);
+  ASSERT(size);
+  *size = 0;
+
+  HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) { return NULL; }
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+    CloseHandle(file);
+    return NULL;
+  }
+
+  // the view keeps the mapping and file alive so the handles aren't needed after
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (mapping == NULL) {
+    LOGERRORF("Unable to map %s", filename);
+    return NULL;
+  }
+
+  void const *memory = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (memory == NULL) {
+    LOGERRORF("Unable to map %s", filename);
+    return NULL;
+  }
+
+  *size = (size_t) fileSize.QuadPart;
+  return memory;
+}
+
+EXTERN_C void Os_FileUnmap(void const *memory, size_t size) {
+  if (!memory) { return; }
+  UnmapViewOfFile(memory);
+}
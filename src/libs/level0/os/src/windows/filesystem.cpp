@@ -115,6 +115,30 @@ EXTERN_C bool Os_FileDelete(char const *fileName) {
   return DeleteFileA(tmp) != 0;
 }
 
+EXTERN_C bool Os_FileRename(char const *src, char const *dst) {
+  char srctmp[2048];
+  char dsttmp[2048];
+  if (!Os_GetPlatformPath(src, srctmp, sizeof(srctmp))) { return false; }
+  if (!Os_GetPlatformPath(dst, dsttmp, sizeof(dsttmp))) { return false; }
+  return MoveFileExA(srctmp, dsttmp, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+EXTERN_C bool Os_EnumerateDir(char const *pathName, Os_EnumerateDirFunc_t func, void *userData) {
+  char tmp[2048];
+  if (!Os_GetPlatformPath(pathName, tmp, sizeof(tmp) - 2)) { return false; }
+  strcat(tmp, "\\*");
+
+  WIN32_FIND_DATAA fd;
+  HANDLE find = FindFirstFileA(tmp, &fd);
+  if (find == INVALID_HANDLE_VALUE) { return false; }
+  do {
+    if (strcmp(fd.cFileName, ".") == 0 || strcmp(fd.cFileName, "..") == 0) { continue; }
+    func(fd.cFileName, (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0, userData);
+  } while (FindNextFileA(find, &fd));
+  FindClose(find);
+  return true;
+}
+
 EXTERN_C bool Os_GetExePath(char *dirOut, int maxSize) {
   dirOut[0] = 0;
   GetModuleFileNameA(nullptr, dirOut, maxSize);
@@ -36,6 +36,9 @@ EXTERN_C void Os_ConditionalVariableWait(Os_ConditionalVariable_t *cv, Os_Mutex_
 EXTERN_C void Os_ConditionalVariableSet(Os_ConditionalVariable_t *cv) {
   WakeConditionVariable((CONDITION_VARIABLE *) cv);
 }
+EXTERN_C void Os_ConditionalVariableBroadcast(Os_ConditionalVariable_t *cv) {
+  WakeAllConditionVariable((CONDITION_VARIABLE *) cv);
+}
 
 struct TrampParam {
   Os_JobFunction_t func;
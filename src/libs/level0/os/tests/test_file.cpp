@@ -101,4 +101,15 @@ TEST_CASE("Size (C)", "[OS File]") {
 
   bool closeOk = Os_FileClose(fh);
   REQUIRE(closeOk);
-}
\ No newline at end of file
+}
+TEST_CASE("Map read only (C)", "[OS File]") {
+  size_t size = 0;
+  void const *memory = Os_FileMapReadOnly("test_data/test.txt", &size);
+  REQUIRE(memory != NULL);
+  REQUIRE(size == 15);
+  REQUIRE(memcmp(memory, "Testing 1, 2, 3", 15) == 0);
+  Os_FileUnmap(memory, size);
+
+  REQUIRE(Os_FileMapReadOnly("test_data/does_not_exist.txt", &size) == NULL);
+  REQUIRE(size == 0);
+}
@@ -187,6 +187,21 @@ TEST_CASE("File Delete (C)", "[OS  FileSystem]") {
   REQUIRE(existOk == false);
 }
 
+TEST_CASE("File Rename (C)", "[OS  FileSystem]") {
+  char const testFilePath0[] = "test_data/test.txt";
+  char const testFilePath1[] = "test_data/testrename0.txt";
+  char const testFilePath2[] = "test_data/testrename1.txt";
+  REQUIRE(Os_FileCopy(testFilePath0, testFilePath1));
+  REQUIRE(Os_FileCopy(testFilePath0, testFilePath2));
+
+  // replaces an existing file
+  REQUIRE(Os_FileRename(testFilePath1, testFilePath2));
+  REQUIRE(Os_FileExists(testFilePath1) == false);
+  REQUIRE(Os_FileExists(testFilePath2));
+  REQUIRE(Os_FileRename(testFilePath1, testFilePath2) == false);
+  REQUIRE(Os_FileDelete(testFilePath2));
+}
+
 TEST_CASE("GetExePath (C)", "[OS  FileSystem]") {
 
   char buffer[2048];
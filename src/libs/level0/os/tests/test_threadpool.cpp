@@ -0,0 +1,51 @@
+#include "core/core.h"
+#include "catch/catch.hpp"
+#include "os/atomics.h"
+#include "os/threadpool.hpp"
+
+static void SquareIndex(void *data, uint32_t index) {
+  uint32_t *out = (uint32_t *) data;
+  out[index] = index * index;
+}
+
+TEST_CASE("Thread Pool Parallel For (C)", "[OS Thread Pool]") {
+  Os_ThreadPoolHandle pool = Os_ThreadPoolCreate(3);
+  REQUIRE(pool);
+  REQUIRE(Os_ThreadPoolWorkerCount(pool) == 3);
+
+  uint32_t out[1000];
+  memset(out, 0xFF, sizeof(out));
+  Os_ThreadPoolParallelFor(pool, &SquareIndex, out, 1000);
+  for (uint32_t i = 0; i < 1000; ++i) {
+    REQUIRE(out[i] == i * i);
+  }
+
+  Os_ThreadPoolDestroy(pool);
+}
+
+TEST_CASE("Thread Pool without workers (C)", "[OS Thread Pool]") {
+  Os_ThreadPoolHandle pool = Os_ThreadPoolCreate(0);
+  REQUIRE(pool);
+  REQUIRE(Os_ThreadPoolWorkerCount(pool) == 0);
+
+  uint32_t out[10];
+  Os_ThreadPoolParallelFor(pool, &SquareIndex, out, 10);
+  Os_ThreadPoolParallelFor(nullptr, &SquareIndex, out, 10);
+  for (uint32_t i = 0; i < 10; ++i) {
+    REQUIRE(out[i] == i * i);
+  }
+
+  Os_ThreadPoolDestroy(pool);
+}
+
+TEST_CASE("Thread Pool nested Parallel For (C++)", "[OS Thread Pool]") {
+  Os::ThreadPool &pool = Os::ThreadPool::Global();
+
+  volatile uint32_t total = 0;
+  pool.ParallelFor(16, [&pool, &total](uint32_t) {
+    pool.ParallelFor(64, [&total](uint32_t i) {
+      Os_AtomicAdd32(&total, i);
+    });
+  });
+  REQUIRE(total == 16 * (63 * 64 / 2));
+}
@@ -51,12 +51,17 @@ struct Image : public Image_ImageHeader {
   bool Is3D() const { return Image_Is3D(this); }
   bool IsArray() const { return Image_IsArray(this); }
   bool IsCubemap() const { return Image_IsCubemap(this); }
+  bool IsTiled() const { return Image_IsTiled(this); }
+
+  bool ConvertToTiled() { return Image_ConvertToTiled(this); }
+  bool ConvertToLinear() { return Image_ConvertToLinear(this); }
 
   bool HasMipmaps() const { return flags & Image_IT_MipMaps; }
   bool HasLayers() const { return flags & IMAGE_IT_Layers; }
 
   size_t LinkedCount() const { return Image_LinkedImageCountOf(this); }
   Image *LinkedImageAt(size_t const index) const { return (Image *) Image_LinkedImageOf(this, index); }
+  Image_PackedChain const *PackedChain() const { return Image_PackedChainOf(this); }
 
   template<typename T = void>
   T const *Data() const { return (T const *) Image_RawDataPtr(this); }
@@ -28,7 +28,7 @@ EXTERN_C void Image_BlockDecodeInterpolateAlpha(uint8_t *dest,
                                                 uint8_t const *src);
 
 // these decode a 8/16 byte block in src to 4x4 pixels
-// BC1 = 8 bytes in 48 bytes out (TODO alpha)
+// BC1 = 8 bytes in 48 bytes out (RGB, Image_BlockDecodeCompressedData does BC1 alpha)
 // BC2/BC3 = 16 bytes in 64 bytes out
 // BC4 = 8 bytes in 16 bytes out
 // BC5 = 16 bytes in 32 bytes out
@@ -37,7 +37,33 @@ EXTERN_C void Image_BlockDecodeBC2(uint8_t *dest, uint8_t const *src);
 EXTERN_C void Image_BlockDecodeBC3(uint8_t *dest, uint8_t const *src);
 EXTERN_C void Image_BlockDecodeBC4(uint8_t *dest, uint8_t const *src);
 EXTERN_C void Image_BlockDecodeBC5(uint8_t *dest, uint8_t const *src);
+// BC6H = 16 bytes in 48 half floats (RGB) out
+// BC7 = 16 bytes in 64 bytes out
+EXTERN_C void Image_BlockDecodeBC6H(uint16_t *dest, uint8_t const *src, bool isSigned);
+EXTERN_C void Image_BlockDecodeBC7(uint8_t *dest, uint8_t const *src);
 
+// How hard the encoders search for the best encoding of each block.
+// Mostly matters for BC6H and BC7 where it sets how many modes, partitions
+// and endpoint refinement passes are tried
+typedef enum Image_BlockEncodeQuality {
+  Image_BEQ_Fast,   // single subset modes only
+  Image_BEQ_Normal, // common modes, best few partitions, one refinement
+  Image_BEQ_Slow,   // every mode, rotation and more partitions
+} Image_BlockEncodeQuality;
+
+// these encode 4x4 pixels in src to an 8/16 byte block, src layout matches
+// what the decoder of the same format outputs
+EXTERN_C void Image_BlockEncodeBC6H(uint8_t *dest,
+                                    uint16_t const *src,
+                                    bool isSigned,
+                                    Image_BlockEncodeQuality quality);
+EXTERN_C void Image_BlockEncodeBC7(uint8_t *dest, uint8_t const *src, Image_BlockEncodeQuality quality);
+
+// whole image decode and encode, split into rows of blocks across the
+// global thread pool.
+// The uncompressed side is 8 bits per channel with ChannelCount(format)
+// channels, except BC6H which is 3 channel 16 bit half floats. BC4/BC5 SNORM
+// channels are int8 and BC1 RGBA alpha is 1 bit, under 128 is transparent
 EXTERN_C void Image_BlockDecodeCompressedData(uint8_t *dest,
                                               uint8_t const *src,
                                               const int width,
@@ -45,4 +71,22 @@ EXTERN_C void Image_BlockDecodeCompressedData(uint8_t *dest,
                                               const Image_Format format);
 
 EXTERN_C bool Image_BlockDecodeIsSupported(const Image_Format format);
+
+EXTERN_C void Image_BlockEncodeCompressedData(uint8_t *dest,
+                                              uint8_t const *src,
+                                              const int width,
+                                              const int height,
+                                              const Image_Format format,
+                                              const Image_BlockEncodeQuality quality);
+// as Image_BlockEncodeCompressedData with src in the tiled layout of a page
+// of an Image_Flag_Tiled image, encoded a tile at a time. The output is the
+// usual linear rows of blocks
+EXTERN_C void Image_BlockEncodeTiledCompressedData(uint8_t *dest,
+                                                   uint8_t const *src,
+                                                   const int width,
+                                                   const int height,
+                                                   const Image_Format format,
+                                                   const Image_BlockEncodeQuality quality);
+
+EXTERN_C bool Image_BlockEncodeIsSupported(const Image_Format format);
 #endif //WYRD_IMAGE_BLOCK_H
@@ -800,22 +800,22 @@ EXTERN_C inline uint32_t Image_Format_BitWidth(Image_Format const fmt) {
     case Image_Format_BC6H_SFLOAT_BLOCK:
     case Image_Format_BC7_UNORM_BLOCK:
     case Image_Format_BC7_SRGB_BLOCK:
-    case Image_Format_S8_UINT:
+    case Image_Format_S8_UINT:return 8;
 
-    case Image_Format_PVR_2BPP_BLOCK:
-    case Image_Format_PVR_2BPPA_BLOCK:
     case Image_Format_PVR_4BPP_BLOCK:
     case Image_Format_PVR_4BPPA_BLOCK:
-    case Image_Format_PVR_2BPP_SRGB_BLOCK:
-    case Image_Format_PVR_2BPPA_SRGB_BLOCK:
     case Image_Format_PVR_4BPP_SRGB_BLOCK:
-    case Image_Format_PVR_4BPPA_SRGB_BLOCK:return 8;
+    case Image_Format_PVR_4BPPA_SRGB_BLOCK:
     case Image_Format_BC1_RGB_UNORM_BLOCK:
     case Image_Format_BC1_RGB_SRGB_BLOCK:
     case Image_Format_BC1_RGBA_UNORM_BLOCK:
     case Image_Format_BC1_RGBA_SRGB_BLOCK:
     case Image_Format_BC4_UNORM_BLOCK:
     case Image_Format_BC4_SNORM_BLOCK:return 4;
+    case Image_Format_PVR_2BPP_BLOCK:
+    case Image_Format_PVR_2BPPA_BLOCK:
+    case Image_Format_PVR_2BPP_SRGB_BLOCK:
+    case Image_Format_PVR_2BPPA_SRGB_BLOCK:return 2;
 
     default: LOGWARNINGF("bitWidth: %s not handled", Image_Format_Name(fmt));
       return 0;
@@ -1240,10 +1240,17 @@ EXTERN_C inline bool Image_Format_IsPVR(Image_Format fmt) {
   }
 }
 typedef uint8_t *Image_Swizzle;
+#ifdef __cplusplus
 EXTERN_C Image_Swizzle Image_Format_Swizzle_RGBA;
 EXTERN_C Image_Swizzle Image_Format_Swizzle_ARGB;
 EXTERN_C Image_Swizzle Image_Format_Swizzle_BGRA;
 EXTERN_C Image_Swizzle Image_Format_Swizzle_ABGR;
+#else
+extern Image_Swizzle Image_Format_Swizzle_RGBA;
+extern Image_Swizzle Image_Format_Swizzle_ARGB;
+extern Image_Swizzle Image_Format_Swizzle_BGRA;
+extern Image_Swizzle Image_Format_Swizzle_ABGR;
+#endif
 
 EXTERN_C inline Image_Swizzle Image_Format_Swizzle(enum Image_Format fmt_) {
   switch (fmt_) {
@@ -30,8 +30,11 @@ typedef enum Image_NextType {
 } Image_NextType;
 
 typedef enum Image_FlagBits {
-  Image_Flag_Cubemap = 0x0,
   Image_Flag_HeaderOnly = 0x1,
+  Image_Flag_Tiled = 0x2,
+  Image_Flag_ExternalData = 0x4,
+  Image_Flag_Cubemap = 0x8,
+  Image_Flag_PackedChain = 0x10,
 } Image_FlagBits;
 typedef uint16_t Image_Flags;
 
@@ -69,6 +72,49 @@ typedef struct Image_ImageHeader {
 
 } Image_ImageHeader;
 
+// pixel data (Image_RawDataPtr) always starts on this boundary
+#define IMAGE_DATA_ALIGNMENT 64
+
+// Tiled images (Image_Flag_Tiled) store each page as IMAGE_TILE_DIM square
+// tiles, tiles are in row order and pixels within a tile are in row order.
+// Tiles on the right and bottom edges are cut down to fit so a tiled image is
+// exactly the same size as a linear one. Each tile is a small linear image
+// so 2D filters that work tile by tile stay in cache.
+// Block compressed formats are already stored in blocks and can't be tiled
+#define IMAGE_TILE_DIM 64
+
+// all image memory goes through an allocator, size is passed back to free so
+// pools don't have to track it. Each image remembers the allocator it was
+// created with, so changing the allocator doesn't affect existing images
+typedef struct Image_Allocator {
+  void *(*allocate)(void *user, size_t size, size_t alignment);
+  void (*free)(void *user, void *ptr, size_t size);
+  void *user;
+} Image_Allocator;
+
+// NULL restores the default (malloc based) allocator. Not thread safe with
+// respect to image creation, set it up front
+EXTERN_C void Image_SetAllocator(Image_Allocator const *allocator);
+EXTERN_C Image_Allocator const *Image_GetAllocator(void);
+
+// A pool recycles the memory of same sized transient images (scratch buffers
+// etc.). Image_Destroy on a pool image returns its memory to the pool, up to
+// maxCachedBytes are kept for reuse. All images acquired from a pool must be
+// destroyed before the pool is.
+typedef struct Image_Pool_t *Image_PoolHandle;
+EXTERN_C Image_PoolHandle Image_PoolCreate(size_t maxCachedBytes);
+EXTERN_C void Image_PoolDestroy(Image_PoolHandle pool);
+EXTERN_C Image_ImageHeader *Image_PoolAcquire(Image_PoolHandle pool,
+                                              uint32_t width,
+                                              uint32_t height,
+                                              uint32_t depth,
+                                              uint32_t slices,
+                                              enum Image_Format format);
+// frees all cached memory, images in use are unaffected
+EXTERN_C void Image_PoolTrim(Image_PoolHandle pool);
+// shared pool used for internal scratch images
+EXTERN_C Image_PoolHandle Image_PoolGlobal(void);
+
 // Image are fundamentally 4D arrays
 // 'helper' functions in create.h let you
 // create and use them in more familar texture terms
@@ -84,6 +130,58 @@ EXTERN_C Image_ImageHeader *Image_CreateNoClear(uint32_t width,
                                                 enum Image_Format format);
 EXTERN_C void Image_Destroy(Image_ImageHeader *image);
 
+// An image whose pixel data lives elsewhere (i.e. a mapped file). Only the
+// header is allocated, release(user) is called when the image is destroyed
+// so the owner of data can reference count it. External data only has the
+// alignment the owner gives it, not IMAGE_DATA_ALIGNMENT
+typedef void (*Image_ExternalDataReleaseFunc)(void *user);
+EXTERN_C Image_ImageHeader *Image_CreateExternal(uint32_t width,
+                                                 uint32_t height,
+                                                 uint32_t depth,
+                                                 uint32_t slices,
+                                                 enum Image_Format format,
+                                                 void *data,
+                                                 Image_ExternalDataReleaseFunc release,
+                                                 void *user);
+
+// where the pixel data would be, external images hold this instead
+typedef struct Image_ExternalData {
+  void *data;
+  Image_ExternalDataReleaseFunc release;
+  void *user;
+} Image_ExternalData;
+
+// A packed chain holds every image of a mip or layer chain in one
+// allocation, the pixel data of all the levels is in a single blob so the
+// whole texture can be uploaded with one copy or mapping. The headers still
+// link through nextImage so everything that walks a chain works as is.
+// Each level starts on alignment bytes into the blob (never less than
+// IMAGE_DATA_ALIGNMENT, i.e. a copy engines placement alignment), slices
+// within a level are packed as usual. Every level has Image_Flag_PackedChain
+// set, only the first level can be destroyed and frees them all
+typedef struct Image_PackedChain {
+  uint8_t *blob;
+  uint64_t blobSize;
+  uint32_t alignment;
+  uint32_t levelCount;
+  uint64_t const *levelOffsets; ///< levelCount offsets from blob
+} Image_PackedChain;
+
+// uninitialised mip chain, mipCount 0 is down to 1x1. Alignment 0 is
+// IMAGE_DATA_ALIGNMENT, otherwise it must be a power of 2.
+// Block compressed chains can't go below 4x4, asking for it fails
+EXTERN_C Image_ImageHeader *Image_CreatePackedMipMaps(uint32_t width,
+                                                      uint32_t height,
+                                                      uint32_t depth,
+                                                      uint32_t slices,
+                                                      enum Image_Format format,
+                                                      uint32_t mipCount,
+                                                      uint32_t alignment);
+// a packed copy of image and its whole chain (mips or layers)
+EXTERN_C Image_ImageHeader *Image_PackChain(Image_ImageHeader const *image, uint32_t alignment);
+// NULL if the image isn't part of a packed chain
+EXTERN_C Image_PackedChain const *Image_PackedChainOf(Image_ImageHeader const *image);
+
 // if you want to use the calculation fields without an actual image
 // this will fill in a valid header with no data or allocation
 EXTERN_C void Image_FillHeader(uint32_t width,
@@ -97,6 +195,10 @@ EXTERN_C void Image_FillHeader(uint32_t width,
 EXTERN_C inline void *Image_RawDataPtr(Image_ImageHeader const *image) {
   ASSERT(image != NULL);
   ASSERT((image->flags & Image_Flag_HeaderOnly) == 0)
+  // packed chain levels point into the blob the same way external data does
+  if (image->flags & (Image_Flag_ExternalData | Image_Flag_PackedChain)) {
+    return ((Image_ExternalData const *) (image + 1))->data;
+  }
   return (void *) (image + 1);
 }
 
@@ -158,10 +260,37 @@ EXTERN_C inline size_t Image_CalculateIndex(Image_ImageHeader const *image,
   size_t const size1D = Image_PixelCountPerRowOf(image);
   size_t const size2D = Image_PixelCountPerPageOf(image);
   size_t const size3D = Image_PixelCountPerSliceOf(image);
+  if (image->flags & Image_Flag_Tiled) {
+    // tile origin, the full tile rows above, then the tiles to the left
+    // (which are as tall as this one) then the position in this tile
+    uint32_t const tx = x & ~(IMAGE_TILE_DIM - 1);
+    uint32_t const ty = y & ~(IMAGE_TILE_DIM - 1);
+    uint32_t const tileWidth = (image->width - tx) < IMAGE_TILE_DIM ? (image->width - tx) : IMAGE_TILE_DIM;
+    uint32_t const tileHeight = (image->height - ty) < IMAGE_TILE_DIM ? (image->height - ty) : IMAGE_TILE_DIM;
+    return (slice * size3D) + (z * size2D) +
+        ((size_t) ty * size1D) + ((size_t) tx * tileHeight) +
+        ((size_t) (y - ty) * tileWidth) + (x - tx);
+  }
   size_t const index = (slice * size3D) + (z * size2D) + (y * size1D) + x;
   return index;
 }
 
+EXTERN_C inline bool Image_IsTiled(Image_ImageHeader const *image) {
+  return image->flags & Image_Flag_Tiled;
+}
+EXTERN_C inline uint32_t Image_TileCountXOf(Image_ImageHeader const *image) {
+  return (image->width + IMAGE_TILE_DIM - 1) / IMAGE_TILE_DIM;
+}
+EXTERN_C inline uint32_t Image_TileCountYOf(Image_ImageHeader const *image) {
+  return (image->height + IMAGE_TILE_DIM - 1) / IMAGE_TILE_DIM;
+}
+
+// rearranges the pixel data in place and sets/clears Image_Flag_Tiled.
+// Only this image is converted, not any linked images. Returns false for
+// block compressed formats
+EXTERN_C bool Image_ConvertToTiled(Image_ImageHeader *image);
+EXTERN_C bool Image_ConvertToLinear(Image_ImageHeader *image);
+
 EXTERN_C inline size_t Image_ByteCountPerRowOf(Image_ImageHeader const *image) {
   return (Image_PixelCountPerRowOf(image) * Image_Format_BitWidth(image->format)) / 8;
 }
@@ -4,22 +4,112 @@
 
 #include "core/core.h"
 #include "image/image.h"
+#include "image/view.h"
 #include "vfile/vfile.h"
 
+// DDS and PVR load the mip levels stored in the file. Block compressed
+// chains stop before the first level smaller than a block
 EXTERN_C Image_ImageHeader *Image_LoadDDS(VFile_Handle handle);
+// maps the file and returns images that point directly into the mapping,
+// no pixel data is read or copied until it is touched. The image data is
+// read only and the mapping is released when the last image using it is
+// destroyed. Files with several slices and mip levels can't be pointed into
+// directly (DDS stores them slice by slice) so are copied out of the mapping.
+// See Image_LoadDDS for how mip levels are handled
+EXTERN_C Image_ImageHeader *Image_LoadDDSMapped(char const *filename);
 EXTERN_C Image_ImageHeader *Image_LoadPVR(VFile_Handle handle);
+
+// load just some of the mip levels and slices of a DDS or PVR, for texture
+// streaming. Only the requested subresources are read. The returned mip
+// chain starts at firstMip, counts are clamped to what is in the file so ~0u
+// loads everything from first on. Returns NULL if first is past the end
+EXTERN_C Image_ImageHeader *Image_LoadDDSRange(VFile_Handle handle,
+                                               uint32_t firstMip, uint32_t mipCount,
+                                               uint32_t firstSlice, uint32_t sliceCount);
+EXTERN_C Image_ImageHeader *Image_LoadPVRRange(VFile_Handle handle,
+                                               uint32_t firstMip, uint32_t mipCount,
+                                               uint32_t firstSlice, uint32_t sliceCount);
+// KTX2 levels are stored smallest first with an index, so a range of mip
+// levels is read without touching the rest. Supercompressed levels are
+// unpacked in parallel
+EXTERN_C Image_ImageHeader *Image_LoadKTX2(VFile_Handle handle);
+EXTERN_C Image_ImageHeader *Image_LoadKTX2Range(VFile_Handle handle, uint32_t firstMip, uint32_t mipCount);
 EXTERN_C Image_ImageHeader *Image_LoadLDR(VFile_Handle handle);
 EXTERN_C Image_ImageHeader *Image_LoadHDR(VFile_Handle handle);
 EXTERN_C Image_ImageHeader *Image_LoadEXR(VFile_Handle handle);
+// decodes just width x height pixels at x, y (relative to the data window)
+// of a scanline or tiled EXR. Only the scanline blocks or tiles overlapping
+// the region are read, so huge images can be loaded a window at a time. For
+// tiled files level picks the mip level (0 for single level files), the
+// region is in that level's pixels. Rows are in file order, so unlike
+// Image_LoadEXR decreasing Y files aren't flipped and y counts from the first
+// row stored. Returns NULL if the region is outside the image
+EXTERN_C Image_ImageHeader *Image_LoadEXRRegion(VFile_Handle handle,
+                                                uint32_t x, uint32_t y,
+                                                uint32_t width, uint32_t height,
+                                                uint32_t level);
+
+// each mip level of a KTX2 is supercompressed on its own. Deflate is the
+// standard KTX2 zlib scheme, LZ4 decodes much faster but is a vendor scheme
+// other KTX2 readers won't understand
+typedef enum Image_KTX2Supercompression {
+  Image_KTX2_None,
+  Image_KTX2_Deflate,
+  Image_KTX2_LZ4,
+} Image_KTX2Supercompression;
+
+// PNG row filters, adaptive picks the best filter for each row
+typedef enum Image_PNGFilter {
+  Image_PNGFilter_Adaptive,
+  Image_PNGFilter_None,
+  Image_PNGFilter_Sub,
+  Image_PNGFilter_Up,
+  Image_PNGFilter_Average,
+  Image_PNGFilter_Paeth,
+} Image_PNGFilter;
+
+#define IMAGE_PNG_DEFAULT_COMPRESSION 6
+
+// compressionLevel is the zlib level, 0 (stored) to 9 (smallest). Rows are
+// filtered and deflated in stripes across the thread pool
+typedef struct Image_PNGSaveOptions {
+  int32_t compressionLevel;
+  Image_PNGFilter filter;
+} Image_PNGSaveOptions;
 
 EXTERN_C bool Image_SaveDDS(Image_ImageHeader *image, VFile_Handle handle);
+EXTERN_C bool Image_SaveKTX2(Image_ImageHeader *image,
+                             VFile_Handle handle,
+                             enum Image_KTX2Supercompression supercompression);
 EXTERN_C bool Image_SaveTGA(Image_ImageHeader *image, VFile_Handle handle);
 EXTERN_C bool Image_SaveBMP(Image_ImageHeader *image, VFile_Handle handle);
 EXTERN_C bool Image_SavePNG(Image_ImageHeader *image, VFile_Handle handle);
+// options may be NULL for the defaults Image_SavePNG uses
+EXTERN_C bool Image_SavePNGWithOptions(Image_ImageHeader *image,
+                                       VFile_Handle handle,
+                                       Image_PNGSaveOptions const *options);
 EXTERN_C bool Image_SaveJPG(Image_ImageHeader *image, VFile_Handle handle);
 EXTERN_C bool Image_SaveHDR(Image_ImageHeader *image, VFile_Handle handle);
 
-// try to figure out which format the file is in and load it
+// save the first page of a view, the image versions above save the first page
+// of slice 0
+EXTERN_C bool Image_SaveViewTGA(Image_View const *view, VFile_Handle handle);
+EXTERN_C bool Image_SaveViewBMP(Image_View const *view, VFile_Handle handle);
+EXTERN_C bool Image_SaveViewPNG(Image_View const *view, VFile_Handle handle);
+EXTERN_C bool Image_SaveViewPNGWithOptions(Image_View const *view,
+                                           VFile_Handle handle,
+                                           Image_PNGSaveOptions const *options);
+EXTERN_C bool Image_SaveViewJPG(Image_View const *view, VFile_Handle handle);
+EXTERN_C bool Image_SaveViewHDR(Image_View const *view, VFile_Handle handle);
+
+// try to figure out which format the file is in and load it. The format is
+// sniffed from the first bytes of the file, not the name
 EXTERN_C Image_ImageHeader *Image_Load(VFile_Handle handle);
 
+// fills out with what Image_Load would return for the top image without
+// decoding any pixels, only the header bytes are read. out is flagged
+// Image_Flag_HeaderOnly and mipCount (may be NULL) is the length of the mip
+// chain. The file is left where it was so it can be loaded afterwards
+EXTERN_C bool Image_LoadHeader(VFile_Handle handle, Image_ImageHeader *out, uint32_t *mipCount);
+
 #endif //WYRD_IMAGE_IO_HPP
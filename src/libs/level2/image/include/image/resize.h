@@ -0,0 +1,43 @@
+#pragma once
+#ifndef WYRD_IMAGE_RESIZE_H
+#define WYRD_IMAGE_RESIZE_H
+
+#include "core/core.h"
+#include "image/image.h"
+
+typedef enum Image_ResizeFilter {
+  Image_RF_Default,     // Mitchell when shrinking, Catmull-Rom when growing
+  Image_RF_Box,
+  Image_RF_Triangle,    // bilinear when growing
+  Image_RF_CubicBSpline,
+  Image_RF_CatmullRom,
+  Image_RF_Mitchell,
+} Image_ResizeFilter;
+
+typedef enum Image_ResizeFlagBits {
+  // colour is already multiplied by alpha. Otherwise colour is weighted by
+  // alpha while filtering so transparent pixels don't bleed
+  Image_RF_Flag_AlphaPremultiplied = 0x1,
+  // the 4th channel is filtered like the others, not as alpha
+  Image_RF_Flag_NoAlpha = 0x2,
+  // filter across the edges as if the image tiles, otherwise edges clamp
+  Image_RF_Flag_Wrap = 0x4,
+  // filter sRGB formats without converting to linear first
+  Image_RF_Flag_IgnoreSRGB = 0x8,
+} Image_ResizeFlagBits;
+typedef uint32_t Image_ResizeFlags;
+
+// a new width x height image of every page and slice of the top level of src,
+// src's format is kept. sRGB formats are filtered in linear space.
+// Works directly on 8 and 16 bit UNORM, sRGB and 32 bit float formats with
+// 1 to 4 channels, returns NULL for anything else. Rows of the result are
+// split across the global thread pool.
+EXTERN_C Image_ImageHeader *Image_Resize(Image_ImageHeader const *src,
+                                         uint32_t width,
+                                         uint32_t height,
+                                         Image_ResizeFilter filter,
+                                         Image_ResizeFlags flags);
+
+EXTERN_C bool Image_ResizeIsSupported(Image_Format format);
+
+#endif //WYRD_IMAGE_RESIZE_H
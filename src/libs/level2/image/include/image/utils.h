@@ -3,6 +3,49 @@
 #define WYRD_IMAGE_UTILS_H
 
 #include "core/core.h"
+#include "image/image.h"
+#include "image/view.h"
+
+// per channel statistics of every pixel in an image (not the chain)
+// variance is the population variance. Channels beyond the formats channel
+// count are left as 0
+typedef struct Image_Statistics {
+  Image_PixelD min;
+  Image_PixelD max;
+  Image_PixelD mean;
+  Image_PixelD variance;
+  uint64_t pixelCount;
+} Image_Statistics;
+
+// optional histogram gathered in the same pass as the statistics.
+// bins are caller owned, binCount entries per channel, NULL skips a channel.
+// values outside of range are counted in the first/last bin.
+// if rangeMin >= rangeMax the images min/max is used (costs a second pass)
+typedef struct Image_Histogram {
+  uint32_t binCount;
+  double rangeMin;
+  double rangeMax;
+  uint64_t *bins[4];
+} Image_Histogram;
+
+// single pass over the image data, split across the os thread pool.
+// common 8/16/32 bit formats are reduced directly from their native encoding
+// histogram can be NULL
+EXTERN_C bool Image_CalculateStatisticsOf(Image_ImageHeader const *image,
+                                          Image_Statistics *stats,
+                                          Image_Histogram *histogram);
+
+EXTERN_C bool Image_CalculateStatisticsOfView(Image_View const *view,
+                                              Image_Statistics *stats,
+                                              Image_Histogram *histogram);
+
+// pixel = pixel * scale + bias per channel, in place in the native format
+EXTERN_C bool Image_ScaleAndBiasOf(Image_ImageHeader const *image,
+                                   Image_PixelD const *scale,
+                                   Image_PixelD const *bias);
+EXTERN_C bool Image_ScaleAndBiasOfView(Image_View const *view,
+                                       Image_PixelD const *scale,
+                                       Image_PixelD const *bias);
 
 EXTERN_C bool Image_GetColorRangeOf(Image_ImageHeader const * src, Image_PixelD* omin, Image_PixelD* omax);
 EXTERN_C bool Image_GetColorRangeOfF(Image_ImageHeader const * image, float* omin, float* omax);
@@ -12,6 +55,11 @@ EXTERN_C bool Image_NormalizeEachChannelOf(Image_ImageHeader const * src);
 EXTERN_C bool Image_NormalizeAcrossChannelsOf(Image_ImageHeader const * src);
 
 EXTERN_C void Image_CreateMipMapChain(Image_ImageHeader *image, bool generateFromImage);
+// as Image_CreateMipMapChain but returns a packed copy of image with its
+// mips (see Image_PackedChain), image is left as is
+EXTERN_C Image_ImageHeader *Image_CreatePackedMipMapChain(Image_ImageHeader const *image,
+                                                          bool generateFromImage,
+                                                          uint32_t alignment);
 EXTERN_C Image_ImageHeader* Image_Clone(Image_ImageHeader* image);
 EXTERN_C Image_ImageHeader *Image_CloneStructure(Image_ImageHeader *image);
 
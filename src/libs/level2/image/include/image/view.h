@@ -0,0 +1,76 @@
+#pragma once
+#ifndef WYRD_IMAGE_VIEW_H
+#define WYRD_IMAGE_VIEW_H
+
+#include "core/core.h"
+#include "image/image.h"
+
+// A non owning window onto image data, for working on crops, single slices
+// or mip levels and atlas regions without copying.
+// Pixels are packed within a row, rows are rowStride bytes apart and pages
+// (z) are pageStride bytes apart. A view doesn't keep its image alive.
+// Views of block compressed images must be block aligned, rows are then rows
+// of blocks and per pixel functions don't accept them.
+typedef struct Image_View {
+  uint8_t *data;
+  size_t rowStride;
+  size_t pageStride;
+  uint32_t width;
+  uint32_t height;
+  uint32_t depth;
+  union {
+    uint32_t fmtSizer;
+    Image_Format format; //< type Image_Format
+  };
+} Image_View;
+
+// all pixels of the image, slices are folded into pages (depth * slices)
+EXTERN_C bool Image_ViewOf(Image_ImageHeader const *image, Image_View *view);
+EXTERN_C bool Image_ViewOfSlice(Image_ImageHeader const *image, uint32_t slice, Image_View *view);
+// level 0 is the image itself, then down the linked mipmap chain
+EXTERN_C bool Image_ViewOfMipLevel(Image_ImageHeader const *image, uint32_t level, uint32_t slice, Image_View *view);
+EXTERN_C bool Image_ViewOfRegion(Image_ImageHeader const *image,
+                                 uint32_t x, uint32_t y, uint32_t z, uint32_t slice,
+                                 uint32_t width, uint32_t height, uint32_t depth,
+                                 Image_View *view);
+// a tile of a tiled image, tiles are the only views of tiled images as
+// rows aren't contiguous across tiles. Edge tiles are smaller
+EXTERN_C bool Image_ViewOfTile(Image_ImageHeader const *image,
+                               uint32_t tileX, uint32_t tileY, uint32_t z, uint32_t slice,
+                               Image_View *view);
+EXTERN_C bool Image_SubView(Image_View const *src,
+                            uint32_t x, uint32_t y, uint32_t z,
+                            uint32_t width, uint32_t height, uint32_t depth,
+                            Image_View *view);
+
+EXTERN_C inline uint8_t *Image_ViewPixelPtr(Image_View const *view, uint32_t x, uint32_t y, uint32_t z) {
+  ASSERT(view);
+  ASSERT(x < view->width);
+  ASSERT(y < view->height);
+  ASSERT(z < view->depth);
+  return view->data +
+      (z * view->pageStride) +
+      (y * view->rowStride) +
+      ((x * Image_Format_BitWidth(view->format)) / 8);
+}
+
+EXTERN_C inline size_t Image_ViewByteCountPerRowOf(Image_View const *view) {
+  return (view->width * Image_Format_BitWidth(view->format)) / 8;
+}
+
+// true if the rows and pages follow each other with no gaps
+EXTERN_C inline bool Image_ViewIsContiguous(Image_View const *view) {
+  return view->rowStride == Image_ViewByteCountPerRowOf(view) &&
+      (view->depth == 1 || view->pageStride == view->rowStride * view->height);
+}
+
+EXTERN_C void Image_ViewGetPixelAt(Image_View const *view, Image_PixelD *pixel, uint32_t x, uint32_t y, uint32_t z);
+EXTERN_C void Image_ViewSetPixelAt(Image_View const *view, Image_PixelD const *pixel, uint32_t x, uint32_t y, uint32_t z);
+
+// copy src into dst converting the format if they differ. extents must match
+EXTERN_C bool Image_ViewCopy(Image_View const *dst, Image_View const *src);
+
+// filtered resize of each page of src into dst. depths must match
+EXTERN_C bool Image_ViewResample(Image_View const *dst, Image_View const *src);
+
+#endif //WYRD_IMAGE_VIEW_H
@@ -0,0 +1,22 @@
+#pragma once
+#ifndef WYRD_IMAGE_ALLOCATOR_HPP
+#define WYRD_IMAGE_ALLOCATOR_HPP
+
+#include "core/core.h"
+#include "image/image.h"
+
+namespace Image {
+
+// total bytes handed to the allocator for an image with dataSize of pixels
+size_t AllocationSizeOf(uint64_t dataSize);
+
+Image_ImageHeader *CreateNoClearWith(Image_Allocator const *allocator,
+                                     uint32_t width,
+                                     uint32_t height,
+                                     uint32_t depth,
+                                     uint32_t slices,
+                                     enum Image_Format format);
+
+} // end Image namespace
+
+#endif //WYRD_IMAGE_ALLOCATOR_HPP
@@ -1,6 +1,10 @@
 #include "core/core.h"
 #include "image/block.h"
 #include "image/format_cracker.h"
+#include "image/image.h"
+#include "os/threadpool.h"
+#include "stb/stb_dxt.h"
+#include <string.h>
 
 EXTERN_C void Image_BlockDecodeColor(
     uint8_t *dest,
@@ -20,7 +24,9 @@ EXTERN_C void Image_BlockDecodeColor(
   colors[1][2] = (c1 & 0x1F) << 3;
 
   if (c0 > c1 ||
-      ((format == Image_Format_BC3_SRGB_BLOCK) ||
+      ((format == Image_Format_BC2_SRGB_BLOCK) ||
+          (format == Image_Format_BC2_UNORM_BLOCK) ||
+          (format == Image_Format_BC3_SRGB_BLOCK) ||
           (format == Image_Format_BC3_UNORM_BLOCK))) {
     for (int i = 0; i < 3; i++) {
       colors[2][i] = (2 * colors[0][i] + colors[1][i] + 1) / 3;
@@ -33,6 +39,11 @@ EXTERN_C void Image_BlockDecodeColor(
     }
   }
 
+  // BC1 with alpha has one bit of it, the 3 colour mode's black is transparent
+  bool const hasAlpha = (format == Image_Format_BC1_RGBA_UNORM_BLOCK) ||
+      (format == Image_Format_BC1_RGBA_SRGB_BLOCK);
+  bool const punchThrough = hasAlpha && c0 <= c1;
+
   src += 4;
   for (int y = 0; y < blockHeight; y++) {
     uint8_t *dst = dest + rowPitch * y;
@@ -42,6 +53,9 @@ EXTERN_C void Image_BlockDecodeColor(
       dst[red] = colors[index][0];
       dst[1] = colors[index][1];
       dst[blue] = colors[index][2];
+      if (hasAlpha) {
+        dst[3] = (punchThrough && index == 3) ? 0 : 255;
+      }
       indexes >>= 2;
 
       dst += pixelPitch;
@@ -97,86 +111,425 @@ EXTERN_C void Image_BlockDecodeInterpolateAlpha(uint8_t *dest,
   }
 }
 
+// BC4/BC5 SNORM are the unsigned blocks with the endpoints stored as int8,
+// flipping the top bit maps them onto the unsigned ones keeping the order so
+// decoding biased values and removing the bias gives the same palette
+static void DecodeInterpolateSigned(uint8_t *dest,
+    int blockWidth, int blockHeight,
+    int pixelPitch, int rowPitch,
+    uint8_t const *src) {
+  uint8_t biased[8];
+  memcpy(biased, src, 8);
+  biased[0] ^= 0x80;
+  biased[1] ^= 0x80;
+  Image_BlockDecodeInterpolateAlpha(dest, blockWidth, blockHeight, pixelPitch, rowPitch, biased);
+
+  int8_t const a0 = (int8_t) src[0];
+  int8_t const a1 = (int8_t) src[1];
+  uint64_t indices = 0;
+  memcpy(&indices, src, 8);
+  indices >>= 16;
+  for (int y = 0; y < blockHeight; y++) {
+    uint8_t *dst = dest + rowPitch * y;
+    for (int x = 0; x < blockWidth; x++) {
+      unsigned int const k = ((unsigned int) indices) & 0x7;
+      int8_t v = (int8_t) (*dst ^ 0x80);
+      // the 6 value mode's extremes are -1 and +1 rather than 0 and 255
+      if (a0 <= a1 && k >= 6) {
+        v = (k == 6) ? -127 : 127;
+      }
+      *dst = (uint8_t) (v == -128 ? -127 : v);
+      indices >>= 3;
+      dst += pixelPitch;
+    }
+    if (blockWidth < 4) {
+      indices >>= (3 * (4 - blockWidth));
+    }
+  }
+}
+
 EXTERN_C void Image_BlockDecodeBC1(uint8_t *dest, uint8_t const *src) {
   Image_BlockDecodeColor(dest, 4, 4, 3, 3 * 4, Image_Format_BC1_RGB_UNORM_BLOCK, 0, 2, src);
 }
 
+// BC2 and BC3 store the alpha block first and the color block second
 EXTERN_C void Image_BlockDecodeBC2(uint8_t *dest, uint8_t const *src) {
-  Image_BlockDecodeColor(dest, 4, 4, 4, 4 * 4, Image_Format_BC2_UNORM_BLOCK, 0, 2, src);
-  Image_BlockDecodeExplicitAlpha(dest + 3, 4, 4, 4, 4 * 4, src + 8);
+  Image_BlockDecodeColor(dest, 4, 4, 4, 4 * 4, Image_Format_BC2_UNORM_BLOCK, 0, 2, src + 8);
+  Image_BlockDecodeExplicitAlpha(dest + 3, 4, 4, 4, 4 * 4, src);
 }
 
 EXTERN_C void Image_BlockDecodeBC3(uint8_t *dest, uint8_t const *src) {
-  Image_BlockDecodeColor(dest, 4, 4, 4, 4 * 4, Image_Format_BC3_UNORM_BLOCK, 0, 2, src);
-  Image_BlockDecodeInterpolateAlpha(dest + 3, 4, 4, 4, 4 * 4, src + 8);
+  Image_BlockDecodeColor(dest, 4, 4, 4, 4 * 4, Image_Format_BC3_UNORM_BLOCK, 0, 2, src + 8);
+  Image_BlockDecodeInterpolateAlpha(dest + 3, 4, 4, 4, 4 * 4, src);
 }
 
 EXTERN_C void Image_BlockDecodeBC4(uint8_t *dest, uint8_t const *src) {
   Image_BlockDecodeInterpolateAlpha(dest, 4, 4, 1, 1 * 4, src);
 }
 
+// BC5 is red block then green block
 EXTERN_C void Image_BlockDecodeBC5(uint8_t *dest, uint8_t const *src) {
-  Image_BlockDecodeInterpolateAlpha(dest, 4, 4, 2, 2 * 4, src + 8);
-  Image_BlockDecodeInterpolateAlpha(dest + 1, 4, 4, 2, 2 * 4, src);
+  Image_BlockDecodeInterpolateAlpha(dest, 4, 4, 2, 2 * 4, src);
+  Image_BlockDecodeInterpolateAlpha(dest + 1, 4, 4, 2, 2 * 4, src + 8);
 }
 
-EXTERN_C void Image_BlockDecodeCompressedData(uint8_t *dest,
-                                              uint8_t const *src,
-                                              const int width,
-                                              const int height,
-                                              const Image_Format format) {
-  ASSERT(Image_Format_IsCompressed(format));
+static int BlockByteCount(Image_Format format) {
+  switch (format) {
+    case Image_Format_BC1_RGB_SRGB_BLOCK:
+    case Image_Format_BC1_RGB_UNORM_BLOCK:
+    case Image_Format_BC1_RGBA_SRGB_BLOCK:
+    case Image_Format_BC1_RGBA_UNORM_BLOCK:
+    case Image_Format_BC4_SNORM_BLOCK:
+    case Image_Format_BC4_UNORM_BLOCK: return 8;
+    default: return 16;
+  }
+}
 
-  int blockWidth = (width < 4) ? width : 4;
-  int blockHeight = (height < 4) ? height : 4;
-
-  int nChannels = Image_Format_ChannelCount(format);
-
-  for (int y = 0; y < height; y += 4) {
-    for (int x = 0; x < width; x += 4) {
-      unsigned char *dst = dest + (y * width + x) * nChannels;
-      switch (format) {
-        case Image_Format_BC1_RGB_SRGB_BLOCK:
-        case Image_Format_BC1_RGB_UNORM_BLOCK:
-        case Image_Format_BC1_RGBA_SRGB_BLOCK:
-        case Image_Format_BC1_RGBA_UNORM_BLOCK: {
-          Image_BlockDecodeColor(dst, blockWidth, blockHeight, nChannels, width * nChannels, format, 0, 2, src);
-          src += 8;
-          break;
+// bytes per pixel on the uncompressed side
+static int BlockPixelSize(Image_Format format) {
+  switch (format) {
+    case Image_Format_BC6H_UFLOAT_BLOCK:
+    case Image_Format_BC6H_SFLOAT_BLOCK: return 3 * sizeof(uint16_t);
+    default: return (int) Image_Format_ChannelCount(format);
+  }
+}
+
+typedef struct BlockRowJob {
+  uint8_t *uncompressed;
+  uint8_t *compressed;
+  int width;
+  int height;
+  Image_Format format;
+  Image_BlockEncodeQuality quality;
+  bool tiled; // encode source only
+} BlockRowJob;
+
+static void DecodeBlockRow(void *data, uint32_t row) {
+  BlockRowJob const *job = (BlockRowJob const *) data;
+  Image_Format const format = job->format;
+  int const width = job->width;
+  int const nChannels = (int) Image_Format_ChannelCount(format);
+  int const pixelSize = BlockPixelSize(format);
+  int const blockBytes = BlockByteCount(format);
+  int const blocksPerRow = (width + 3) / 4;
+
+  int const y = (int) row * 4;
+  int const blockHeight = (job->height - y < 4) ? job->height - y : 4;
+  uint8_t const *src = job->compressed + (size_t) row * blocksPerRow * blockBytes;
+
+  for (int x = 0; x < width; x += 4) {
+    int const blockWidth = (width - x < 4) ? width - x : 4;
+    uint8_t *dst = job->uncompressed + ((size_t) y * width + x) * pixelSize;
+    switch (format) {
+      case Image_Format_BC1_RGB_SRGB_BLOCK:
+      case Image_Format_BC1_RGB_UNORM_BLOCK:
+      case Image_Format_BC1_RGBA_SRGB_BLOCK:
+      case Image_Format_BC1_RGBA_UNORM_BLOCK: {
+        Image_BlockDecodeColor(dst, blockWidth, blockHeight, nChannels, width * nChannels, format, 0, 2, src);
+        break;
+      }
+      case Image_Format_BC2_SRGB_BLOCK:
+      case Image_Format_BC2_UNORM_BLOCK: {
+        Image_BlockDecodeColor(dst, blockWidth, blockHeight, nChannels, width * nChannels, format, 0, 2, src + 8);
+        Image_BlockDecodeExplicitAlpha(dst + 3, blockWidth, blockHeight, nChannels, width * nChannels, src);
+        break;
+      }
+      case Image_Format_BC3_SRGB_BLOCK:
+      case Image_Format_BC3_UNORM_BLOCK: {
+        Image_BlockDecodeColor(dst, blockWidth, blockHeight, nChannels, width * nChannels, format, 0, 2, src + 8);
+        Image_BlockDecodeInterpolateAlpha(dst + 3, blockWidth, blockHeight, nChannels, width * nChannels, src);
+        break;
+      }
+      case Image_Format_BC4_UNORM_BLOCK: {
+        Image_BlockDecodeInterpolateAlpha(dst, blockWidth, blockHeight, 1, width, src);
+        break;
+      }
+      case Image_Format_BC4_SNORM_BLOCK: {
+        DecodeInterpolateSigned(dst, blockWidth, blockHeight, 1, width, src);
+        break;
+      }
+      case Image_Format_BC5_UNORM_BLOCK: {
+        Image_BlockDecodeInterpolateAlpha(dst, blockWidth, blockHeight, 2, width * 2, src);
+        Image_BlockDecodeInterpolateAlpha(dst + 1, blockWidth, blockHeight, 2, width * 2, src + 8);
+        break;
+      }
+      case Image_Format_BC5_SNORM_BLOCK: {
+        DecodeInterpolateSigned(dst, blockWidth, blockHeight, 2, width * 2, src);
+        DecodeInterpolateSigned(dst + 1, blockWidth, blockHeight, 2, width * 2, src + 8);
+        break;
+      }
+      case Image_Format_BC6H_UFLOAT_BLOCK:
+      case Image_Format_BC6H_SFLOAT_BLOCK: {
+        uint16_t block[16 * 3];
+        Image_BlockDecodeBC6H(block, src, format == Image_Format_BC6H_SFLOAT_BLOCK);
+        for (int by = 0; by < blockHeight; ++by) {
+          memcpy(dst + (size_t) by * width * pixelSize, block + by * 4 * 3, (size_t) blockWidth * pixelSize);
         }
-        case Image_Format_BC2_SRGB_BLOCK:
-        case Image_Format_BC2_UNORM_BLOCK: {
-          Image_BlockDecodeColor(dst, blockWidth, blockHeight, nChannels, width * nChannels, format, 0, 2, src);
-          Image_BlockDecodeExplicitAlpha(dst + 3, blockWidth, blockHeight, nChannels, width * nChannels, src + 8);
-          src += 16;
-          break;
+        break;
+      }
+      case Image_Format_BC7_UNORM_BLOCK:
+      case Image_Format_BC7_SRGB_BLOCK: {
+        uint8_t block[16 * 4];
+        Image_BlockDecodeBC7(block, src);
+        for (int by = 0; by < blockHeight; ++by) {
+          memcpy(dst + (size_t) by * width * pixelSize, block + by * 4 * 4, (size_t) blockWidth * pixelSize);
         }
-        case Image_Format_BC3_SRGB_BLOCK:
-        case Image_Format_BC3_UNORM_BLOCK: {
-          Image_BlockDecodeColor(dst, blockWidth, blockHeight, nChannels, width * nChannels, format, 0, 2, src);
-          Image_BlockDecodeInterpolateAlpha(dst + 3, blockWidth, blockHeight, nChannels, width * nChannels, src + 8);
-          src += 16;
-          break;
+        break;
+      }
+      default:ASSERT(false);
+        return;
+    }
+    src += blockBytes;
+  }
+}
+
+// int8 to the unsigned value with the same order, -128 is -1 like -127 so
+// is clamped to keep it out of the endpoints
+static uint8_t BiasSigned(uint8_t v) {
+  return (uint8_t) ((v == 0x80 ? 0x81 : v) ^ 0x80);
+}
+
+// stb always picks the 8 value mode (or equal endpoints) so flipping the
+// endpoints back is all it takes, see DecodeInterpolateSigned
+static void UnbiasSignedEndpoints(uint8_t *block) {
+  block[0] ^= 0x80;
+  block[1] ^= 0x80;
+}
+
+// stb only does 4 colour blocks, when any pixel has alpha under 128 this
+// keeps stb's endpoints but swaps them into 3 colour mode order and picks
+// from the 2 endpoints and their midpoint, index 3 is transparent black
+static void EncodeBC1PunchThrough(uint8_t *dst, uint8_t const *block, int stbMode) {
+  uint8_t opaque[16 * 4];
+  int firstOpaque = -1;
+  bool anyTransparent = false;
+  for (int i = 0; i < 16; ++i) {
+    if (block[i * 4 + 3] < 128) {
+      anyTransparent = true;
+    } else if (firstOpaque < 0) {
+      firstOpaque = i;
+    }
+  }
+  if (!anyTransparent) {
+    stb_compress_dxt_block(dst, block, 0, stbMode);
+    return;
+  }
+  if (firstOpaque < 0) {
+    memset(dst, 0, 4);
+    memset(dst + 4, 0xFF, 4);
+    return;
+  }
+
+  // transparent pixels take an opaque colour so they don't pull the endpoints
+  memcpy(opaque, block, sizeof(opaque));
+  for (int i = 0; i < 16; ++i) {
+    if (block[i * 4 + 3] < 128) {
+      memcpy(opaque + i * 4, block + firstOpaque * 4, 4);
+    }
+  }
+  stb_compress_dxt_block(dst, opaque, 0, stbMode);
+
+  uint16_t c0 = (uint16_t) (dst[0] | (dst[1] << 8));
+  uint16_t c1 = (uint16_t) (dst[2] | (dst[3] << 8));
+  if (c0 > c1) {
+    uint16_t const t = c0;
+    c0 = c1;
+    c1 = t;
+  }
+  int colors[3][3];
+  colors[0][0] = ((c0 >> 11) & 0x1F) << 3;
+  colors[0][1] = ((c0 >> 5) & 0x3F) << 2;
+  colors[0][2] = (c0 & 0x1F) << 3;
+  colors[1][0] = ((c1 >> 11) & 0x1F) << 3;
+  colors[1][1] = ((c1 >> 5) & 0x3F) << 2;
+  colors[1][2] = (c1 & 0x1F) << 3;
+  for (int c = 0; c < 3; ++c) {
+    colors[2][c] = (colors[0][c] + colors[1][c] + 1) >> 1;
+  }
+
+  uint32_t indices = 0;
+  for (int i = 0; i < 16; ++i) {
+    uint32_t best = 3;
+    if (block[i * 4 + 3] >= 128) {
+      int bestError = INT32_MAX;
+      for (uint32_t p = 0; p < 3; ++p) {
+        int error = 0;
+        for (int c = 0; c < 3; ++c) {
+          int const d = colors[p][c] - block[i * 4 + c];
+          error += d * d;
         }
-        case Image_Format_BC4_SNORM_BLOCK:
-        case Image_Format_BC4_UNORM_BLOCK: {
-          Image_BlockDecodeInterpolateAlpha(dst, blockWidth, blockHeight, 1, width, src);
-          src += 8;
-          break;
+        if (error < bestError) {
+          bestError = error;
+          best = p;
         }
-        case Image_Format_BC5_SNORM_BLOCK:
-        case Image_Format_BC5_UNORM_BLOCK: {
-          Image_BlockDecodeInterpolateAlpha(dst, blockWidth, blockHeight, 2, width * 2, src + 8);
-          Image_BlockDecodeInterpolateAlpha(dst + 1, blockWidth, blockHeight, 2, width * 2, src);
-          src += 16;
-          break;
+      }
+    }
+    indices |= best << (i * 2);
+  }
+  dst[0] = (uint8_t) (c0 & 0xFF);
+  dst[1] = (uint8_t) (c0 >> 8);
+  dst[2] = (uint8_t) (c1 & 0xFF);
+  dst[3] = (uint8_t) (c1 >> 8);
+  for (int i = 0; i < 4; ++i) {
+    dst[4 + i] = (uint8_t) (indices >> (i * 8));
+  }
+}
+
+// a pixel of the uncompressed source, linear or in image.h's tiled layout
+static uint8_t const *SourcePixel(BlockRowJob const *job, int x, int y, int pixelSize) {
+  size_t index;
+  if (job->tiled) {
+    int const tx = x & ~(IMAGE_TILE_DIM - 1);
+    int const ty = y & ~(IMAGE_TILE_DIM - 1);
+    int const tileWidth = (job->width - tx) < IMAGE_TILE_DIM ? (job->width - tx) : IMAGE_TILE_DIM;
+    int const tileHeight = (job->height - ty) < IMAGE_TILE_DIM ? (job->height - ty) : IMAGE_TILE_DIM;
+    index = (size_t) ty * job->width + (size_t) tx * tileHeight + (size_t) (y - ty) * tileWidth + (x - tx);
+  } else {
+    index = (size_t) y * job->width + x;
+  }
+  return job->uncompressed + index * pixelSize;
+}
+
+// encodes the block with its top left pixel at x,y
+static void EncodeBlock(BlockRowJob const *job, int x, int y, uint8_t *dst) {
+  Image_Format const format = job->format;
+  int const width = job->width;
+  int const height = job->height;
+  int const pixelSize = BlockPixelSize(format);
+  int const stbMode = (job->quality == Image_BEQ_Fast) ? STB_DXT_NORMAL : STB_DXT_HIGHQUAL;
+
+  // gather the block, partial blocks at the edges repeat the last pixel
+  uint8_t block[16 * 4 * 2];
+  memset(block, 0xFF, sizeof(block));
+  for (int by = 0; by < 4; ++by) {
+    int const sy = (y + by < height) ? y + by : height - 1;
+    for (int bx = 0; bx < 4; ++bx) {
+      int const sx = (x + bx < width) ? x + bx : width - 1;
+      int const stride = (pixelSize == 6) ? 6 : 4;
+      memcpy(block + (by * 4 + bx) * stride, SourcePixel(job, sx, sy, pixelSize), (size_t) pixelSize);
+    }
+  }
+
+  switch (format) {
+    case Image_Format_BC1_RGB_SRGB_BLOCK:
+    case Image_Format_BC1_RGB_UNORM_BLOCK:
+      stb_compress_dxt_block(dst, block, 0, stbMode);
+      break;
+    case Image_Format_BC1_RGBA_SRGB_BLOCK:
+    case Image_Format_BC1_RGBA_UNORM_BLOCK:
+      EncodeBC1PunchThrough(dst, block, stbMode);
+      break;
+    case Image_Format_BC2_SRGB_BLOCK:
+    case Image_Format_BC2_UNORM_BLOCK: {
+      for (int by = 0; by < 4; ++by) {
+        uint16_t alpha = 0;
+        for (int bx = 0; bx < 4; ++bx) {
+          uint16_t const a = (uint16_t) ((block[(by * 4 + bx) * 4 + 3] * 15 + 127) / 255);
+          alpha |= (uint16_t) (a << (bx * 4));
         }
-        default:ASSERT(false);
-          return;
+        dst[by * 2 + 0] = (uint8_t) (alpha & 0xFF);
+        dst[by * 2 + 1] = (uint8_t) (alpha >> 8);
+      }
+      stb_compress_dxt_block(dst + 8, block, 0, stbMode);
+      break;
+    }
+    case Image_Format_BC3_SRGB_BLOCK:
+    case Image_Format_BC3_UNORM_BLOCK:
+      stb_compress_dxt_block(dst, block, 1, stbMode);
+      break;
+    case Image_Format_BC4_SNORM_BLOCK:
+    case Image_Format_BC4_UNORM_BLOCK: {
+      bool const isSigned = (format == Image_Format_BC4_SNORM_BLOCK);
+      uint8_t r[16];
+      for (int i = 0; i < 16; ++i) { r[i] = isSigned ? BiasSigned(block[i * 4]) : block[i * 4]; }
+      stb_compress_bc4_block(dst, r);
+      if (isSigned) {
+        UnbiasSignedEndpoints(dst);
+      }
+      break;
+    }
+    case Image_Format_BC5_SNORM_BLOCK:
+    case Image_Format_BC5_UNORM_BLOCK: {
+      bool const isSigned = (format == Image_Format_BC5_SNORM_BLOCK);
+      uint8_t rg[32];
+      for (int i = 0; i < 16; ++i) {
+        rg[i * 2 + 0] = isSigned ? BiasSigned(block[i * 4 + 0]) : block[i * 4 + 0];
+        rg[i * 2 + 1] = isSigned ? BiasSigned(block[i * 4 + 1]) : block[i * 4 + 1];
+      }
+      stb_compress_bc5_block(dst, rg);
+      if (isSigned) {
+        UnbiasSignedEndpoints(dst);
+        UnbiasSignedEndpoints(dst + 8);
       }
+      break;
     }
+    case Image_Format_BC6H_UFLOAT_BLOCK:
+    case Image_Format_BC6H_SFLOAT_BLOCK:
+      Image_BlockEncodeBC6H(dst, (uint16_t const *) block,
+                            format == Image_Format_BC6H_SFLOAT_BLOCK, job->quality);
+      break;
+    case Image_Format_BC7_UNORM_BLOCK:
+    case Image_Format_BC7_SRGB_BLOCK:
+      Image_BlockEncodeBC7(dst, block, job->quality);
+      break;
+    default:ASSERT(false);
+      return;
   }
 }
+
+static void EncodeBlockRow(void *data, uint32_t row) {
+  BlockRowJob const *job = (BlockRowJob const *) data;
+  int const blockBytes = BlockByteCount(job->format);
+  int const blocksPerRow = (job->width + 3) / 4;
+
+  uint8_t *dst = job->compressed + (size_t) row * blocksPerRow * blockBytes;
+  for (int x = 0; x < job->width; x += 4) {
+    EncodeBlock(job, x, (int) row * 4, dst);
+    dst += blockBytes;
+  }
+}
+
+// the blocks of one source tile, tiles are a whole number of blocks so
+// every block reads from just the one tile
+static void EncodeBlockTile(void *data, uint32_t tile) {
+  BlockRowJob const *job = (BlockRowJob const *) data;
+  int const blockBytes = BlockByteCount(job->format);
+  int const blocksPerRow = (job->width + 3) / 4;
+  int const tilesPerRow = (job->width + IMAGE_TILE_DIM - 1) / IMAGE_TILE_DIM;
+  int const tx = ((int) tile % tilesPerRow) * IMAGE_TILE_DIM;
+  int const ty = ((int) tile / tilesPerRow) * IMAGE_TILE_DIM;
+  int const xEnd = (tx + IMAGE_TILE_DIM < job->width) ? tx + IMAGE_TILE_DIM : job->width;
+  int const yEnd = (ty + IMAGE_TILE_DIM < job->height) ? ty + IMAGE_TILE_DIM : job->height;
+
+  for (int y = ty; y < yEnd; y += 4) {
+    uint8_t *dst = job->compressed + ((size_t) (y / 4) * blocksPerRow + tx / 4) * blockBytes;
+    for (int x = tx; x < xEnd; x += 4) {
+      EncodeBlock(job, x, y, dst);
+      dst += blockBytes;
+    }
+  }
+}
+
+EXTERN_C void Image_BlockDecodeCompressedData(uint8_t *dest,
+                                              uint8_t const *src,
+                                              const int width,
+                                              const int height,
+                                              const Image_Format format) {
+  ASSERT(Image_Format_IsCompressed(format));
+  ASSERT(Image_BlockDecodeIsSupported(format));
+
+  BlockRowJob job;
+  job.uncompressed = dest;
+  job.compressed = (uint8_t *) src;
+  job.width = width;
+  job.height = height;
+  job.format = format;
+  job.quality = Image_BEQ_Normal;
+  job.tiled = false;
+
+  Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &DecodeBlockRow, &job, (uint32_t) (height + 3) / 4);
+}
+
 EXTERN_C bool Image_BlockDecodeIsSupported(Image_Format format) {
   switch (format) {
     case Image_Format_BC1_RGB_SRGB_BLOCK:
@@ -191,10 +544,61 @@ EXTERN_C bool Image_BlockDecodeIsSupported(Image_Format format) {
     case Image_Format_BC4_UNORM_BLOCK:
     case Image_Format_BC5_SNORM_BLOCK:
     case Image_Format_BC5_UNORM_BLOCK:
+    case Image_Format_BC6H_UFLOAT_BLOCK:
+    case Image_Format_BC6H_SFLOAT_BLOCK:
+    case Image_Format_BC7_UNORM_BLOCK:
+    case Image_Format_BC7_SRGB_BLOCK:
       return true;
     default: return false;
   }
 
 }
 
+EXTERN_C void Image_BlockEncodeCompressedData(uint8_t *dest,
+                                              uint8_t const *src,
+                                              const int width,
+                                              const int height,
+                                              const Image_Format format,
+                                              const Image_BlockEncodeQuality quality) {
+  ASSERT(Image_Format_IsCompressed(format));
+  ASSERT(Image_BlockEncodeIsSupported(format));
+
+  BlockRowJob job;
+  job.uncompressed = (uint8_t *) src;
+  job.compressed = dest;
+  job.width = width;
+  job.height = height;
+  job.format = format;
+  job.quality = quality;
+  job.tiled = false;
+
+  Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &EncodeBlockRow, &job, (uint32_t) (height + 3) / 4);
+}
+
+EXTERN_C void Image_BlockEncodeTiledCompressedData(uint8_t *dest,
+                                                   uint8_t const *src,
+                                                   const int width,
+                                                   const int height,
+                                                   const Image_Format format,
+                                                   const Image_BlockEncodeQuality quality) {
+  ASSERT(Image_Format_IsCompressed(format));
+  ASSERT(Image_BlockEncodeIsSupported(format));
+
+  BlockRowJob job;
+  job.uncompressed = (uint8_t *) src;
+  job.compressed = dest;
+  job.width = width;
+  job.height = height;
+  job.format = format;
+  job.quality = quality;
+  job.tiled = true;
+
+  uint32_t const tileCount = (uint32_t) (((width + IMAGE_TILE_DIM - 1) / IMAGE_TILE_DIM) *
+      ((height + IMAGE_TILE_DIM - 1) / IMAGE_TILE_DIM));
+  Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &EncodeBlockTile, &job, tileCount);
+}
 
+EXTERN_C bool Image_BlockEncodeIsSupported(const Image_Format format) {
+  // the encoders cover everything the decoders do
+  return Image_BlockDecodeIsSupported(format);
+}
@@ -0,0 +1,1361 @@
+#include "core/core.h"
+#include "core/logger.h"
+#include "image/block.h"
+#include <string.h>
+#include <float.h>
+
+// BC6H and BC7 (aka BPTC) block decoders and encoders.
+// Decoding follows the D3D11 functional spec bit for bit.
+// Encoding fits each subset with its principal axis, then optionally refines
+// the endpoints with a least squares solve against the chosen indices. How
+// many modes, partitions and refinement passes are tried is set by the
+// Image_BlockEncodeQuality passed in.
+
+static const uint8_t Bc7Partition2[64][16] = {
+    {0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1},
+    {0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1},
+    {0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1},
+    {0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 1, 1},
+    {0, 0, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1},
+    {0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1},
+    {0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1},
+    {0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 1, 1},
+    {0, 1, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0},
+    {0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0},
+    {0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0},
+    {0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 1},
+    {0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0},
+    {0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0},
+    {0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0},
+    {0, 0, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 1, 0, 0},
+    {0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 0, 1, 0, 0, 0},
+    {0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0},
+    {0, 1, 1, 1, 0, 0, 0, 1, 1, 0, 0, 0, 1, 1, 1, 0},
+    {0, 0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0, 0},
+    {0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1},
+    {0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1},
+    {0, 1, 0, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0},
+    {0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0},
+    {0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0},
+    {0, 1, 0, 1, 0, 1, 0, 1, 1, 0, 1, 0, 1, 0, 1, 0},
+    {0, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0, 0, 1},
+    {0, 1, 0, 1, 1, 0, 1, 0, 1, 0, 1, 0, 0, 1, 0, 1},
+    {0, 1, 1, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 1, 0},
+    {0, 0, 0, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 0, 0, 0},
+    {0, 0, 1, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 1, 0, 0},
+    {0, 0, 1, 1, 1, 0, 1, 1, 1, 1, 0, 1, 1, 1, 0, 0},
+    {0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0},
+    {0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 1, 1},
+    {0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1},
+    {0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0},
+    {0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0, 0, 0, 0, 0},
+    {0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0},
+    {0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0},
+    {0, 1, 1, 0, 1, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 1},
+    {0, 0, 1, 1, 0, 1, 1, 0, 1, 1, 0, 0, 1, 0, 0, 1},
+    {0, 1, 1, 0, 0, 0, 1, 1, 1, 0, 0, 1, 1, 1, 0, 0},
+    {0, 0, 1, 1, 1, 0, 0, 1, 1, 1, 0, 0, 0, 1, 1, 0},
+    {0, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 0, 0, 1},
+    {0, 1, 1, 0, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0, 0, 1},
+    {0, 1, 1, 1, 1, 1, 1, 0, 1, 0, 0, 0, 0, 0, 0, 1},
+    {0, 0, 0, 1, 1, 0, 0, 0, 1, 1, 1, 0, 0, 1, 1, 1},
+    {0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1},
+    {0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0},
+    {0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0},
+    {0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 1},
+};
+
+static const uint8_t Bc7Partition3[64][16] = {
+    {0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2},
+    {0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1},
+    {0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1},
+    {0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2},
+    {0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2},
+    {0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1},
+    {0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2},
+    {0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2},
+    {0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2},
+    {0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2},
+    {0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2},
+    {0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2},
+    {0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2},
+    {0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0},
+    {0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2},
+    {0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0},
+    {0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2},
+    {0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1},
+    {0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2},
+    {0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1},
+    {0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2},
+    {0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0},
+    {0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0},
+    {0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2},
+    {0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0},
+    {0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1},
+    {0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2},
+    {0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2},
+    {0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1},
+    {0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1},
+    {0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2},
+    {0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1},
+    {0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2},
+    {0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0},
+    {0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0},
+    {0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0},
+    {0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0},
+    {0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1},
+    {0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1},
+    {0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2},
+    {0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1},
+    {0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2},
+    {0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1},
+    {0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1},
+    {0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1},
+    {0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1},
+    {0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2},
+    {0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1},
+    {0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2},
+    {0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2},
+    {0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2},
+    {0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2},
+    {0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2},
+    {0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2},
+    {0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2},
+    {0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2},
+    {0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2},
+    {0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1},
+    {0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2},
+    {0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2},
+    {0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0},
+};
+
+static const uint8_t Bc7Anchor2[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+    15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+     6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15,
+};
+
+static const uint8_t Bc7Anchor3a[64] = {
+     3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+     3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+     8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+     3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3,
+};
+
+static const uint8_t Bc7Anchor3b[64] = {
+    15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+    15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+    15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+    15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8,
+};
+
+static const uint8_t BptcWeights2[4] = {0, 21, 43, 64};
+static const uint8_t BptcWeights3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+static const uint8_t BptcWeights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+static uint8_t const *BptcWeights(int bits) {
+  switch (bits) {
+    case 2: return BptcWeights2;
+    case 3: return BptcWeights3;
+    default: return BptcWeights4;
+  }
+}
+
+static uint8_t const *BptcPartition(int subsets, int partition) {
+  static const uint8_t single[16] = {0};
+  switch (subsets) {
+    case 2: return Bc7Partition2[partition];
+    case 3: return Bc7Partition3[partition];
+    default: return single;
+  }
+}
+
+static bool BptcIsAnchor(int subsets, int partition, int pixel) {
+  if (pixel == 0) { return true; }
+  switch (subsets) {
+    case 2: return pixel == Bc7Anchor2[partition];
+    case 3: return pixel == Bc7Anchor3a[partition] || pixel == Bc7Anchor3b[partition];
+    default: return false;
+  }
+}
+
+static int BptcAnchorOf(int subsets, int partition, int subset) {
+  if (subset == 0) { return 0; }
+  if (subsets == 2) { return Bc7Anchor2[partition]; }
+  return (subset == 1) ? Bc7Anchor3a[partition] : Bc7Anchor3b[partition];
+}
+
+static int BptcInterpolate(int e0, int e1, int weight) {
+  return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+}
+
+// LSB first bit access over a 16 byte block
+typedef struct BptcBits {
+  uint8_t *data;
+  uint32_t pos;
+} BptcBits;
+
+static uint32_t BptcReadBits(BptcBits *bits, uint32_t count) {
+  uint32_t v = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t const p = bits->pos++;
+    v |= (uint32_t) ((bits->data[p >> 3] >> (p & 7)) & 1) << i;
+  }
+  return v;
+}
+
+static void BptcWriteBits(BptcBits *bits, uint32_t v, uint32_t count) {
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t const p = bits->pos++;
+    bits->data[p >> 3] |= (uint8_t) (((v >> i) & 1) << (p & 7));
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Shared encoder helpers
+//-----------------------------------------------------------------------------
+
+// principal axis of a set of points of up to 4 channels, returns false if
+// all the points are identical. mean is always written
+static bool BptcPrincipalAxis(float const (*points)[4], int count, int channels, float mean[4], float axis[4]) {
+  for (int c = 0; c < 4; ++c) {
+    mean[c] = 0.0f;
+    axis[c] = 0.0f;
+  }
+  if (count == 0) { return false; }
+
+  for (int i = 0; i < count; ++i) {
+    for (int c = 0; c < channels; ++c) { mean[c] += points[i][c]; }
+  }
+  for (int c = 0; c < channels; ++c) { mean[c] /= (float) count; }
+
+  float cov[4][4] = {0};
+  for (int i = 0; i < count; ++i) {
+    float d[4];
+    for (int c = 0; c < channels; ++c) { d[c] = points[i][c] - mean[c]; }
+    for (int r = 0; r < channels; ++r) {
+      for (int c = r; c < channels; ++c) { cov[r][c] += d[r] * d[c]; }
+    }
+  }
+  for (int r = 0; r < channels; ++r) {
+    for (int c = 0; c < r; ++c) { cov[r][c] = cov[c][r]; }
+  }
+
+  // power iteration starting from the largest variance channel
+  int start = 0;
+  for (int c = 1; c < channels; ++c) {
+    if (cov[c][c] > cov[start][start]) { start = c; }
+  }
+  if (cov[start][start] <= 0.0f) { return false; }
+  for (int c = 0; c < channels; ++c) { axis[c] = cov[start][c]; }
+
+  for (int iter = 0; iter < 8; ++iter) {
+    float next[4] = {0};
+    float len = 0.0f;
+    for (int r = 0; r < channels; ++r) {
+      for (int c = 0; c < channels; ++c) { next[r] += cov[r][c] * axis[c]; }
+      len = next[r] * next[r] > len ? next[r] * next[r] : len;
+    }
+    if (len <= 0.0f) { return false; }
+    // normalise by the largest component, cheaper than a sqrt and as stable
+    float maxc = 0.0f;
+    for (int c = 0; c < channels; ++c) {
+      float const a = next[c] < 0.0f ? -next[c] : next[c];
+      maxc = a > maxc ? a : maxc;
+    }
+    for (int c = 0; c < channels; ++c) { axis[c] = next[c] / maxc; }
+  }
+  return true;
+}
+
+// fits endpoints to the extent of the points along the principal axis
+static void BptcFitLine(float const (*points)[4], int count, int channels, float lo[4], float hi[4]) {
+  float mean[4], axis[4];
+  if (!BptcPrincipalAxis(points, count, channels, mean, axis)) {
+    for (int c = 0; c < 4; ++c) { lo[c] = hi[c] = mean[c]; }
+    return;
+  }
+
+  float len2 = 0.0f;
+  for (int c = 0; c < channels; ++c) { len2 += axis[c] * axis[c]; }
+
+  float tmin = FLT_MAX, tmax = -FLT_MAX;
+  for (int i = 0; i < count; ++i) {
+    float t = 0.0f;
+    for (int c = 0; c < channels; ++c) { t += (points[i][c] - mean[c]) * axis[c]; }
+    t /= len2;
+    tmin = t < tmin ? t : tmin;
+    tmax = t > tmax ? t : tmax;
+  }
+  for (int c = 0; c < 4; ++c) {
+    lo[c] = mean[c] + axis[c] * tmin;
+    hi[c] = mean[c] + axis[c] * tmax;
+  }
+}
+
+// residual error of the points after projection onto their principal axis
+// used to rank partitions before doing a full encode of the best few
+static float BptcLineResidual(float const (*points)[4], int count, int channels) {
+  float mean[4], axis[4];
+  if (!BptcPrincipalAxis(points, count, channels, mean, axis)) { return 0.0f; }
+
+  float len2 = 0.0f;
+  for (int c = 0; c < channels; ++c) { len2 += axis[c] * axis[c]; }
+
+  float err = 0.0f;
+  for (int i = 0; i < count; ++i) {
+    float d[4];
+    float t = 0.0f;
+    for (int c = 0; c < channels; ++c) {
+      d[c] = points[i][c] - mean[c];
+      t += d[c] * axis[c];
+    }
+    t /= len2;
+    for (int c = 0; c < channels; ++c) {
+      float const r = d[c] - axis[c] * t;
+      err += r * r;
+    }
+  }
+  return err;
+}
+
+// least squares endpoints for fixed interpolation weights (0-64)
+static bool BptcLeastSquares(float const (*points)[4], uint8_t const *weights, int count, int channels,
+                             float lo[4], float hi[4]) {
+  float a = 0.0f, b = 0.0f, c = 0.0f;
+  float x0[4] = {0}, x1[4] = {0};
+  for (int i = 0; i < count; ++i) {
+    float const t = (float) weights[i] / 64.0f;
+    float const s = 1.0f - t;
+    a += s * s;
+    b += s * t;
+    c += t * t;
+    for (int ch = 0; ch < channels; ++ch) {
+      x0[ch] += s * points[i][ch];
+      x1[ch] += t * points[i][ch];
+    }
+  }
+  float const det = a * c - b * b;
+  if (det < 1e-6f && det > -1e-6f) { return false; }
+  for (int ch = 0; ch < channels; ++ch) {
+    lo[ch] = (c * x0[ch] - b * x1[ch]) / det;
+    hi[ch] = (a * x1[ch] - b * x0[ch]) / det;
+  }
+  return true;
+}
+
+typedef struct BptcRankedPartition {
+  float error;
+  int partition;
+} BptcRankedPartition;
+
+// returns the count best partitions for the subset count by line residual
+static int BptcRankPartitions(float const (*pixels)[4], int channels,
+                              int subsets, int partitionCount,
+                              BptcRankedPartition *out, int count) {
+  int used = 0;
+  for (int p = 0; p < partitionCount; ++p) {
+    uint8_t const *table = BptcPartition(subsets, p);
+    float err = 0.0f;
+    for (int s = 0; s < subsets; ++s) {
+      float points[16][4];
+      int n = 0;
+      for (int i = 0; i < 16; ++i) {
+        if (table[i] != s) { continue; }
+        memcpy(points[n++], pixels[i], sizeof(float) * 4);
+      }
+      err += BptcLineResidual((float const (*)[4]) points, n, channels);
+    }
+
+    // insertion into a small sorted list
+    int slot = used < count ? used++ : count;
+    while (slot > 0 && out[slot - 1].error > err) {
+      if (slot < count) { out[slot] = out[slot - 1]; }
+      slot--;
+    }
+    if (slot < count) {
+      out[slot].error = err;
+      out[slot].partition = p;
+    }
+  }
+  return used;
+}
+
+static int BptcQuality(Image_BlockEncodeQuality quality, int fast, int normal, int slow) {
+  switch (quality) {
+    case Image_BEQ_Fast: return fast;
+    case Image_BEQ_Normal: return normal;
+    default: return slow;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// BC7
+//-----------------------------------------------------------------------------
+
+typedef struct Bc7ModeInfo {
+  uint8_t subsets;
+  uint8_t partitionBits;
+  uint8_t rotationBits;
+  uint8_t indexSelectionBits;
+  uint8_t colorBits;
+  uint8_t alphaBits;
+  uint8_t endpointPBits;
+  uint8_t sharedPBits;
+  uint8_t indexBits;
+  uint8_t index2Bits;
+} Bc7ModeInfo;
+
+static const Bc7ModeInfo Bc7Modes[8] = {
+    {3, 4, 0, 0, 4, 0, 1, 0, 3, 0},
+    {2, 6, 0, 0, 6, 0, 0, 1, 3, 0},
+    {3, 6, 0, 0, 5, 0, 0, 0, 2, 0},
+    {2, 6, 0, 0, 7, 0, 1, 0, 2, 0},
+    {1, 0, 2, 1, 5, 6, 0, 0, 2, 3},
+    {1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+    {1, 0, 0, 0, 7, 7, 1, 0, 4, 0},
+    {2, 6, 0, 0, 5, 5, 1, 0, 2, 0},
+};
+
+// bits is the stored precision, pbit < 0 for no p bit
+static int Bc7Unquantize(int q, int bits, int pbit) {
+  if (pbit >= 0) {
+    q = (q << 1) | pbit;
+    bits++;
+  }
+  if (bits >= 8) { return q; }
+  return (q << (8 - bits)) | (q >> (2 * bits - 8));
+}
+
+static int Bc7QuantizeChannel(float v, int bits, int pbit) {
+  int const maxq = (1 << bits) - 1;
+  int const totalBits = pbit >= 0 ? bits + 1 : bits;
+  float const scaled = v * (float) ((1 << totalBits) - 1) / 255.0f;
+  int const guess = (int) ((pbit >= 0 ? (scaled - (float) pbit) * 0.5f : scaled) + 0.5f);
+
+  int best = 0;
+  float bestErr = FLT_MAX;
+  for (int q = guess - 1; q <= guess + 1; ++q) {
+    if (q < 0 || q > maxq) { continue; }
+    float const d = (float) Bc7Unquantize(q, bits, pbit) - v;
+    if (d * d < bestErr) {
+      bestErr = d * d;
+      best = q;
+    }
+  }
+  return best;
+}
+
+typedef struct Bc7Encoding {
+  int mode;
+  int partition;
+  int rotation;
+  int indexSelection;
+  uint8_t endpoints[3][2][4];
+  uint8_t pbits[3][2];
+  uint8_t indices[16];
+  uint8_t indices2[16];
+  uint32_t error;
+} Bc7Encoding;
+
+EXTERN_C void Image_BlockDecodeBC7(uint8_t *dest, uint8_t const *src) {
+  BptcBits bits = {(uint8_t *) src, 0};
+
+  int mode = 0;
+  while (mode < 8 && BptcReadBits(&bits, 1) == 0) { mode++; }
+  if (mode == 8) {
+    // reserved mode decodes to transparent black
+    memset(dest, 0, 16 * 4);
+    return;
+  }
+
+  Bc7ModeInfo const *info = &Bc7Modes[mode];
+  int const partition = (int) BptcReadBits(&bits, info->partitionBits);
+  int const rotation = (int) BptcReadBits(&bits, info->rotationBits);
+  int const indexSelection = (int) BptcReadBits(&bits, info->indexSelectionBits);
+
+  int endpoints[3][2][4];
+  for (int c = 0; c < 3; ++c) {
+    for (int s = 0; s < info->subsets; ++s) {
+      endpoints[s][0][c] = (int) BptcReadBits(&bits, info->colorBits);
+      endpoints[s][1][c] = (int) BptcReadBits(&bits, info->colorBits);
+    }
+  }
+  for (int s = 0; s < info->subsets; ++s) {
+    endpoints[s][0][3] = (int) BptcReadBits(&bits, info->alphaBits);
+    endpoints[s][1][3] = (int) BptcReadBits(&bits, info->alphaBits);
+  }
+
+  int pbits[3][2] = {{-1, -1}, {-1, -1}, {-1, -1}};
+  for (int s = 0; s < info->subsets; ++s) {
+    if (info->endpointPBits) {
+      pbits[s][0] = (int) BptcReadBits(&bits, 1);
+      pbits[s][1] = (int) BptcReadBits(&bits, 1);
+    } else if (info->sharedPBits) {
+      pbits[s][0] = pbits[s][1] = (int) BptcReadBits(&bits, 1);
+    }
+  }
+
+  for (int s = 0; s < info->subsets; ++s) {
+    for (int e = 0; e < 2; ++e) {
+      for (int c = 0; c < 3; ++c) {
+        endpoints[s][e][c] = Bc7Unquantize(endpoints[s][e][c], info->colorBits, pbits[s][e]);
+      }
+      endpoints[s][e][3] = info->alphaBits ?
+                           Bc7Unquantize(endpoints[s][e][3], info->alphaBits, pbits[s][e]) : 255;
+    }
+  }
+
+  uint8_t indices[16];
+  uint8_t indices2[16];
+  for (int i = 0; i < 16; ++i) {
+    bool const anchor = BptcIsAnchor(info->subsets, partition, i);
+    indices[i] = (uint8_t) BptcReadBits(&bits, info->indexBits - (anchor ? 1 : 0));
+  }
+  for (int i = 0; info->index2Bits && i < 16; ++i) {
+    indices2[i] = (uint8_t) BptcReadBits(&bits, info->index2Bits - (i == 0 ? 1 : 0));
+  }
+
+  uint8_t const *table = BptcPartition(info->subsets, partition);
+  for (int i = 0; i < 16; ++i) {
+    int const s = table[i];
+    int colorWeight, alphaWeight;
+    if (info->index2Bits == 0) {
+      colorWeight = alphaWeight = BptcWeights(info->indexBits)[indices[i]];
+    } else if (indexSelection == 0) {
+      colorWeight = BptcWeights(info->indexBits)[indices[i]];
+      alphaWeight = BptcWeights(info->index2Bits)[indices2[i]];
+    } else {
+      colorWeight = BptcWeights(info->index2Bits)[indices2[i]];
+      alphaWeight = BptcWeights(info->indexBits)[indices[i]];
+    }
+
+    uint8_t px[4];
+    for (int c = 0; c < 3; ++c) {
+      px[c] = (uint8_t) BptcInterpolate(endpoints[s][0][c], endpoints[s][1][c], colorWeight);
+    }
+    px[3] = (uint8_t) BptcInterpolate(endpoints[s][0][3], endpoints[s][1][3], alphaWeight);
+
+    if (rotation) {
+      uint8_t const t = px[3];
+      px[3] = px[rotation - 1];
+      px[rotation - 1] = t;
+    }
+    memcpy(dest + i * 4, px, 4);
+  }
+}
+
+static void Bc7Pack(uint8_t *dest, Bc7Encoding const *enc) {
+  Bc7ModeInfo const *info = &Bc7Modes[enc->mode];
+  memset(dest, 0, 16);
+  BptcBits bits = {dest, 0};
+
+  BptcWriteBits(&bits, 1u << enc->mode, enc->mode + 1);
+  BptcWriteBits(&bits, (uint32_t) enc->partition, info->partitionBits);
+  BptcWriteBits(&bits, (uint32_t) enc->rotation, info->rotationBits);
+  BptcWriteBits(&bits, (uint32_t) enc->indexSelection, info->indexSelectionBits);
+  for (int c = 0; c < 3; ++c) {
+    for (int s = 0; s < info->subsets; ++s) {
+      BptcWriteBits(&bits, enc->endpoints[s][0][c], info->colorBits);
+      BptcWriteBits(&bits, enc->endpoints[s][1][c], info->colorBits);
+    }
+  }
+  for (int s = 0; s < info->subsets; ++s) {
+    BptcWriteBits(&bits, enc->endpoints[s][0][3], info->alphaBits);
+    BptcWriteBits(&bits, enc->endpoints[s][1][3], info->alphaBits);
+  }
+  for (int s = 0; s < info->subsets; ++s) {
+    if (info->endpointPBits) {
+      BptcWriteBits(&bits, enc->pbits[s][0], 1);
+      BptcWriteBits(&bits, enc->pbits[s][1], 1);
+    } else if (info->sharedPBits) {
+      BptcWriteBits(&bits, enc->pbits[s][0], 1);
+    }
+  }
+  for (int i = 0; i < 16; ++i) {
+    bool const anchor = BptcIsAnchor(info->subsets, enc->partition, i);
+    BptcWriteBits(&bits, enc->indices[i], info->indexBits - (anchor ? 1 : 0));
+  }
+  for (int i = 0; info->index2Bits && i < 16; ++i) {
+    BptcWriteBits(&bits, enc->indices2[i], info->index2Bits - (i == 0 ? 1 : 0));
+  }
+  ASSERT(bits.pos == 128);
+}
+
+// the anchor pixel of each subset and index set has its top index bit implied
+// zero, flip endpoints and indices where that isn't already the case
+static void Bc7FixAnchors(Bc7Encoding *enc) {
+  Bc7ModeInfo const *info = &Bc7Modes[enc->mode];
+  uint8_t const *table = BptcPartition(info->subsets, enc->partition);
+
+  // which channels each index set controls
+  int primaryFirst = 0, primaryLast = 3;
+  if (info->index2Bits) {
+    primaryFirst = enc->indexSelection ? 3 : 0;
+    primaryLast = enc->indexSelection ? 3 : 2;
+  }
+
+  for (int s = 0; s < info->subsets; ++s) {
+    int const anchor = BptcAnchorOf(info->subsets, enc->partition, s);
+    int const maxIndex = (1 << info->indexBits) - 1;
+    if (enc->indices[anchor] > (maxIndex >> 1)) {
+      for (int c = primaryFirst; c <= primaryLast; ++c) {
+        uint8_t const t = enc->endpoints[s][0][c];
+        enc->endpoints[s][0][c] = enc->endpoints[s][1][c];
+        enc->endpoints[s][1][c] = t;
+      }
+      uint8_t const t = enc->pbits[s][0];
+      enc->pbits[s][0] = enc->pbits[s][1];
+      enc->pbits[s][1] = t;
+      for (int i = 0; i < 16; ++i) {
+        if (table[i] == s) { enc->indices[i] = (uint8_t) (maxIndex - enc->indices[i]); }
+      }
+    }
+  }
+
+  if (info->index2Bits) {
+    int const maxIndex = (1 << info->index2Bits) - 1;
+    if (enc->indices2[0] > (maxIndex >> 1)) {
+      int const first = enc->indexSelection ? 0 : 3;
+      int const last = enc->indexSelection ? 2 : 3;
+      for (int c = first; c <= last; ++c) {
+        uint8_t const t = enc->endpoints[0][0][c];
+        enc->endpoints[0][0][c] = enc->endpoints[0][1][c];
+        enc->endpoints[0][1][c] = t;
+      }
+      for (int i = 0; i < 16; ++i) {
+        enc->indices2[i] = (uint8_t) (maxIndex - enc->indices2[i]);
+      }
+    }
+  }
+}
+
+// picks the best index for each pixel of a subset, for channels [first, last]
+// and returns the squared error over those channels
+static uint32_t Bc7SelectIndices(float const (*px)[4], uint8_t const *table, int subset,
+                                 int const lo[4], int const hi[4],
+                                 int first, int last, int indexBits, uint8_t *indices) {
+  int const count = 1 << indexBits;
+  uint8_t const *weights = BptcWeights(indexBits);
+  int palette[16][4];
+  for (int k = 0; k < count; ++k) {
+    for (int c = first; c <= last; ++c) {
+      palette[k][c] = BptcInterpolate(lo[c], hi[c], weights[k]);
+    }
+  }
+
+  uint32_t total = 0;
+  for (int i = 0; i < 16; ++i) {
+    if (table[i] != subset) { continue; }
+    uint32_t bestErr = UINT32_MAX;
+    int best = 0;
+    for (int k = 0; k < count; ++k) {
+      uint32_t err = 0;
+      for (int c = first; c <= last; ++c) {
+        int const d = palette[k][c] - (int) (px[i][c] + 0.5f);
+        err += (uint32_t) (d * d);
+      }
+      if (err < bestErr) {
+        bestErr = err;
+        best = k;
+      }
+    }
+    indices[i] = (uint8_t) best;
+    total += bestErr;
+  }
+  return total;
+}
+
+// quantizes a channel group of float endpoints trying each p bit choice,
+// keeping whichever gives the lowest error once indices are selected
+static uint32_t Bc7QuantizeGroup(float const (*px)[4], uint8_t const *table, int subset,
+                                 Bc7ModeInfo const *info, float const lo[4], float const hi[4],
+                                 int first, int last, int bits, int indexBits,
+                                 Bc7Encoding *enc, uint8_t *indices) {
+  int const pbitCombos = info->endpointPBits ? 4 : info->sharedPBits ? 2 : 1;
+
+  uint32_t bestErr = UINT32_MAX;
+  for (int combo = 0; combo < pbitCombos; ++combo) {
+    int p0 = -1, p1 = -1;
+    if (info->endpointPBits) {
+      p0 = combo & 1;
+      p1 = combo >> 1;
+    } else if (info->sharedPBits) {
+      p0 = p1 = combo;
+    }
+
+    uint8_t q[2][4];
+    int ulo[4], uhi[4];
+    for (int c = first; c <= last; ++c) {
+      int const cb = (c == 3 && info->alphaBits) ? info->alphaBits : bits;
+      q[0][c] = (uint8_t) Bc7QuantizeChannel(lo[c], cb, p0);
+      q[1][c] = (uint8_t) Bc7QuantizeChannel(hi[c], cb, p1);
+      ulo[c] = Bc7Unquantize(q[0][c], cb, p0);
+      uhi[c] = Bc7Unquantize(q[1][c], cb, p1);
+    }
+
+    uint8_t trial[16];
+    uint32_t const err = Bc7SelectIndices(px, table, subset, ulo, uhi, first, last, indexBits, trial);
+    if (err < bestErr) {
+      bestErr = err;
+      for (int c = first; c <= last; ++c) {
+        enc->endpoints[subset][0][c] = q[0][c];
+        enc->endpoints[subset][1][c] = q[1][c];
+      }
+      enc->pbits[subset][0] = (uint8_t) (p0 < 0 ? 0 : p0);
+      enc->pbits[subset][1] = (uint8_t) (p1 < 0 ? 0 : p1);
+      for (int i = 0; i < 16; ++i) {
+        if (table[i] == subset) { indices[i] = trial[i]; }
+      }
+    }
+  }
+  return bestErr;
+}
+
+static void Bc7GatherSubset(float const (*px)[4], uint8_t const *table, int subset,
+                            int first, int channels, float (*points)[4], int *count) {
+  int n = 0;
+  for (int i = 0; i < 16; ++i) {
+    if (table[i] != subset) { continue; }
+    for (int c = 0; c < channels; ++c) { points[n][c] = px[i][first + c]; }
+    n++;
+  }
+  *count = n;
+}
+
+static void Bc7EncodeConfiguration(float const (*pixels)[4],
+                                   int mode, int partition, int rotation, int indexSelection,
+                                   int refinements, Bc7Encoding *best) {
+  Bc7ModeInfo const *info = &Bc7Modes[mode];
+  uint8_t const *table = BptcPartition(info->subsets, partition);
+
+  float px[16][4];
+  memcpy(px, pixels, sizeof(px));
+  if (rotation) {
+    for (int i = 0; i < 16; ++i) {
+      float const t = px[i][3];
+      px[i][3] = px[i][rotation - 1];
+      px[i][rotation - 1] = t;
+    }
+  }
+
+  bool const separateAlpha = info->index2Bits != 0;
+  int const colorLast = (!separateAlpha && info->alphaBits) ? 3 : 2;
+  int const colorIndexBits = (separateAlpha && indexSelection) ? info->index2Bits : info->indexBits;
+  int const alphaIndexBits = (separateAlpha && indexSelection) ? info->indexBits : info->index2Bits;
+
+  // alpha is a constant 255 in modes without it
+  uint32_t fixedError = 0;
+  if (info->alphaBits == 0) {
+    for (int i = 0; i < 16; ++i) {
+      int const d = 255 - (int) (px[i][3] + 0.5f);
+      fixedError += (uint32_t) (d * d);
+    }
+  }
+
+  float lo[3][4], hi[3][4];
+  for (int s = 0; s < info->subsets; ++s) {
+    float points[16][4];
+    int count;
+    Bc7GatherSubset((float const (*)[4]) px, table, s, 0, colorLast + 1, points, &count);
+    BptcFitLine((float const (*)[4]) points, count, colorLast + 1, lo[s], hi[s]);
+    if (separateAlpha) {
+      lo[s][3] = 255.0f;
+      hi[s][3] = 0.0f;
+      for (int i = 0; i < 16; ++i) {
+        lo[s][3] = px[i][3] < lo[s][3] ? px[i][3] : lo[s][3];
+        hi[s][3] = px[i][3] > hi[s][3] ? px[i][3] : hi[s][3];
+      }
+    }
+  }
+
+  for (int pass = 0; pass <= refinements; ++pass) {
+    Bc7Encoding enc;
+    memset(&enc, 0, sizeof(enc));
+    enc.mode = mode;
+    enc.partition = partition;
+    enc.rotation = rotation;
+    enc.indexSelection = indexSelection;
+    enc.error = fixedError;
+
+    uint8_t colorIndices[16], alphaIndices[16];
+    for (int s = 0; s < info->subsets; ++s) {
+      enc.error += Bc7QuantizeGroup((float const (*)[4]) px, table, s, info, lo[s], hi[s],
+                                    0, colorLast, info->colorBits, colorIndexBits, &enc, colorIndices);
+      if (separateAlpha) {
+        enc.error += Bc7QuantizeGroup((float const (*)[4]) px, table, s, info, lo[s], hi[s],
+                                      3, 3, info->alphaBits, alphaIndexBits, &enc, alphaIndices);
+      }
+    }
+
+    if (separateAlpha && indexSelection) {
+      memcpy(enc.indices, alphaIndices, 16);
+      memcpy(enc.indices2, colorIndices, 16);
+    } else {
+      memcpy(enc.indices, colorIndices, 16);
+      if (separateAlpha) { memcpy(enc.indices2, alphaIndices, 16); }
+    }
+
+    if (enc.error < best->error) { *best = enc; }
+    if (enc.error == 0 || pass == refinements) { break; }
+
+    // refine the float endpoints against the indices just chosen
+    for (int s = 0; s < info->subsets; ++s) {
+      float points[16][4];
+      uint8_t weights[16];
+      int count;
+      Bc7GatherSubset((float const (*)[4]) px, table, s, 0, 4, points, &count);
+      int n = 0;
+      for (int i = 0; i < 16; ++i) {
+        if (table[i] == s) { weights[n++] = BptcWeights(colorIndexBits)[colorIndices[i]]; }
+      }
+      BptcLeastSquares((float const (*)[4]) points, weights, count, colorLast + 1, lo[s], hi[s]);
+
+      if (separateAlpha) {
+        float alphas[16][4];
+        for (int i = 0; i < 16; ++i) {
+          alphas[i][0] = px[i][3];
+          weights[i] = BptcWeights(alphaIndexBits)[alphaIndices[i]];
+        }
+        float alo[4], ahi[4];
+        if (BptcLeastSquares((float const (*)[4]) alphas, weights, 16, 1, alo, ahi)) {
+          lo[s][3] = alo[0];
+          hi[s][3] = ahi[0];
+        }
+      }
+      for (int c = 0; c < 4; ++c) {
+        lo[s][c] = lo[s][c] < 0.0f ? 0.0f : lo[s][c] > 255.0f ? 255.0f : lo[s][c];
+        hi[s][c] = hi[s][c] < 0.0f ? 0.0f : hi[s][c] > 255.0f ? 255.0f : hi[s][c];
+      }
+    }
+  }
+}
+
+EXTERN_C void Image_BlockEncodeBC7(uint8_t *dest, uint8_t const *src, Image_BlockEncodeQuality quality) {
+  float pixels[16][4];
+  bool hasAlpha = false;
+  for (int i = 0; i < 16; ++i) {
+    for (int c = 0; c < 4; ++c) { pixels[i][c] = (float) src[i * 4 + c]; }
+    hasAlpha |= src[i * 4 + 3] != 255;
+  }
+
+  static const int fastModes[] = {6};
+  static const int normalModes[] = {6, 1, 3, 5, 7};
+  static const int slowModes[] = {6, 5, 4, 1, 3, 7, 0, 2};
+
+  int const *modes = fastModes;
+  int modeCount = 1;
+  if (quality == Image_BEQ_Normal) {
+    modes = normalModes;
+    // the alpha specific modes are only worth a look when there is alpha
+    modeCount = hasAlpha ? 5 : 3;
+  } else if (quality != Image_BEQ_Fast) {
+    modes = slowModes;
+    modeCount = 8;
+  }
+  int const partitionsToTry = BptcQuality(quality, 1, 4, 16);
+  int const refinements = BptcQuality(quality, 1, 1, 2);
+  bool const allRotations = quality == Image_BEQ_Slow;
+
+  Bc7Encoding best;
+  memset(&best, 0, sizeof(best));
+  best.error = UINT32_MAX;
+
+  for (int m = 0; m < modeCount && best.error != 0; ++m) {
+    int const mode = modes[m];
+    Bc7ModeInfo const *info = &Bc7Modes[mode];
+
+    if (info->subsets > 1) {
+      BptcRankedPartition ranked[64];
+      int const count = BptcRankPartitions((float const (*)[4]) pixels, info->alphaBits ? 4 : 3,
+                                           info->subsets, 1 << info->partitionBits,
+                                           ranked, partitionsToTry);
+      for (int p = 0; p < count && best.error != 0; ++p) {
+        Bc7EncodeConfiguration((float const (*)[4]) pixels, mode, ranked[p].partition, 0, 0, refinements, &best);
+      }
+    } else {
+      int const rotations = (info->rotationBits && allRotations) ? 4 : 1;
+      int const selections = (info->indexSelectionBits && allRotations) ? 2 : 1;
+      for (int r = 0; r < rotations; ++r) {
+        for (int is = 0; is < selections; ++is) {
+          Bc7EncodeConfiguration((float const (*)[4]) pixels, mode, 0, r, is, refinements, &best);
+        }
+      }
+    }
+  }
+
+  Bc7FixAnchors(&best);
+  Bc7Pack(dest, &best);
+}
+
+//-----------------------------------------------------------------------------
+// BC6H
+//-----------------------------------------------------------------------------
+
+// endpoint fields, w and x are region 0 endpoints, y and z region 1
+enum {
+  BC6H_RW, BC6H_GW, BC6H_BW,
+  BC6H_RX, BC6H_GX, BC6H_BX,
+  BC6H_RY, BC6H_GY, BC6H_BY,
+  BC6H_RZ, BC6H_GZ, BC6H_BZ,
+  BC6H_END
+};
+
+// a run of bits of one field in stream order from first to last, the spec
+// stores the high base bits of modes 13 and 14 reversed so runs can go down
+typedef struct Bc6hRun {
+  uint8_t field;
+  uint8_t first;
+  uint8_t last;
+} Bc6hRun;
+
+typedef struct Bc6hModeInfo {
+  uint8_t value;
+  uint8_t modeBits;
+  uint8_t regions;
+  uint8_t transformed;
+  uint8_t endpointBits;
+  uint8_t deltaBits[3];
+  Bc6hRun layout[24];
+} Bc6hModeInfo;
+
+#define R(f, a, b) {BC6H_##f, a, b}
+#define END {BC6H_END, 0, 0}
+static const Bc6hModeInfo Bc6hModes[14] = {
+    {0x00, 2, 2, 1, 10, {5, 5, 5},
+     {R(GY, 4, 4), R(BY, 4, 4), R(BZ, 4, 4), R(RW, 0, 9), R(GW, 0, 9), R(BW, 0, 9),
+      R(RX, 0, 4), R(GZ, 4, 4), R(GY, 0, 3), R(GX, 0, 4), R(BZ, 0, 0), R(GZ, 0, 3),
+      R(BX, 0, 4), R(BZ, 1, 1), R(BY, 0, 3), R(RY, 0, 4), R(BZ, 2, 2), R(RZ, 0, 4),
+      R(BZ, 3, 3), END}},
+    {0x01, 2, 2, 1, 7, {6, 6, 6},
+     {R(GY, 5, 5), R(GZ, 4, 5), R(RW, 0, 6), R(BZ, 0, 1), R(BY, 4, 4), R(GW, 0, 6),
+      R(BY, 5, 5), R(BZ, 2, 2), R(GY, 4, 4), R(BW, 0, 6), R(BZ, 3, 3), R(BZ, 5, 5),
+      R(BZ, 4, 4), R(RX, 0, 5), R(GY, 0, 3), R(GX, 0, 5), R(GZ, 0, 3), R(BX, 0, 5),
+      R(BY, 0, 3), R(RY, 0, 5), R(RZ, 0, 5), END}},
+    {0x02, 5, 2, 1, 11, {5, 4, 4},
+     {R(RW, 0, 9), R(GW, 0, 9), R(BW, 0, 9), R(RX, 0, 4), R(RW, 10, 10), R(GY, 0, 3),
+      R(GX, 0, 3), R(GW, 10, 10), R(BZ, 0, 0), R(GZ, 0, 3), R(BX, 0, 3), R(BW, 10, 10),
+      R(BZ, 1, 1), R(BY, 0, 3), R(RY, 0, 4), R(BZ, 2, 2), R(RZ, 0, 4), R(BZ, 3, 3), END}},
+    {0x06, 5, 2, 1, 11, {4, 5, 4},
+     {R(RW, 0, 9), R(GW, 0, 9), R(BW, 0, 9), R(RX, 0, 3), R(RW, 10, 10), R(GZ, 4, 4),
+      R(GY, 0, 3), R(GX, 0, 4), R(GW, 10, 10), R(GZ, 0, 3), R(BX, 0, 3), R(BW, 10, 10),
+      R(BZ, 1, 1), R(BY, 0, 3), R(RY, 0, 3), R(BZ, 0, 0), R(BZ, 2, 2), R(RZ, 0, 3),
+      R(GY, 4, 4), R(BZ, 3, 3), END}},
+    {0x0A, 5, 2, 1, 11, {4, 4, 5},
+     {R(RW, 0, 9), R(GW, 0, 9), R(BW, 0, 9), R(RX, 0, 3), R(RW, 10, 10), R(BY, 4, 4),
+      R(GY, 0, 3), R(GX, 0, 3), R(GW, 10, 10), R(BZ, 0, 0), R(GZ, 0, 3), R(BX, 0, 4),
+      R(BW, 10, 10), R(BY, 0, 3), R(RY, 0, 3), R(BZ, 1, 2), R(RZ, 0, 3), R(BZ, 4, 4),
+      R(BZ, 3, 3), END}},
+    {0x0E, 5, 2, 1, 9, {5, 5, 5},
+     {R(RW, 0, 8), R(BY, 4, 4), R(GW, 0, 8), R(GY, 4, 4), R(BW, 0, 8), R(BZ, 4, 4),
+      R(RX, 0, 4), R(GZ, 4, 4), R(GY, 0, 3), R(GX, 0, 4), R(BZ, 0, 0), R(GZ, 0, 3),
+      R(BX, 0, 4), R(BZ, 1, 1), R(BY, 0, 3), R(RY, 0, 4), R(BZ, 2, 2), R(RZ, 0, 4),
+      R(BZ, 3, 3), END}},
+    {0x12, 5, 2, 1, 8, {6, 5, 5},
+     {R(RW, 0, 7), R(GZ, 4, 4), R(BY, 4, 4), R(GW, 0, 7), R(BZ, 2, 2), R(GY, 4, 4),
+      R(BW, 0, 7), R(BZ, 3, 4), R(RX, 0, 5), R(GY, 0, 3), R(GX, 0, 4), R(BZ, 0, 0),
+      R(GZ, 0, 3), R(BX, 0, 4), R(BZ, 1, 1), R(BY, 0, 3), R(RY, 0, 5), R(RZ, 0, 5), END}},
+    {0x16, 5, 2, 1, 8, {5, 6, 5},
+     {R(RW, 0, 7), R(BZ, 0, 0), R(BY, 4, 4), R(GW, 0, 7), R(GY, 5, 5), R(GY, 4, 4),
+      R(BW, 0, 7), R(GZ, 5, 5), R(BZ, 4, 4), R(RX, 0, 4), R(GZ, 4, 4), R(GY, 0, 3),
+      R(GX, 0, 5), R(GZ, 0, 3), R(BX, 0, 4), R(BZ, 1, 1), R(BY, 0, 3), R(RY, 0, 4),
+      R(BZ, 2, 2), R(RZ, 0, 4), R(BZ, 3, 3), END}},
+    {0x1A, 5, 2, 1, 8, {5, 5, 6},
+     {R(RW, 0, 7), R(BZ, 1, 1), R(BY, 4, 4), R(GW, 0, 7), R(BY, 5, 5), R(GY, 4, 4),
+      R(BW, 0, 7), R(BZ, 5, 5), R(BZ, 4, 4), R(RX, 0, 4), R(GZ, 4, 4), R(GY, 0, 3),
+      R(GX, 0, 4), R(BZ, 0, 0), R(GZ, 0, 3), R(BX, 0, 5), R(BY, 0, 3), R(RY, 0, 4),
+      R(BZ, 2, 2), R(RZ, 0, 4), R(BZ, 3, 3), END}},
+    {0x1E, 5, 2, 0, 6, {6, 6, 6},
+     {R(RW, 0, 5), R(GZ, 4, 4), R(BZ, 0, 1), R(BY, 4, 4), R(GW, 0, 5), R(GY, 5, 5),
+      R(BY, 5, 5), R(BZ, 2, 2), R(GY, 4, 4), R(BW, 0, 5), R(GZ, 5, 5), R(BZ, 3, 3),
+      R(BZ, 5, 5), R(BZ, 4, 4), R(RX, 0, 5), R(GY, 0, 3), R(GX, 0, 5), R(GZ, 0, 3),
+      R(BX, 0, 5), R(BY, 0, 3), R(RY, 0, 5), R(RZ, 0, 5), END}},
+    {0x03, 5, 1, 0, 10, {10, 10, 10},
+     {R(RW, 0, 9), R(GW, 0, 9), R(BW, 0, 9), R(RX, 0, 9), R(GX, 0, 9), R(BX, 0, 9), END}},
+    {0x07, 5, 1, 1, 11, {9, 9, 9},
+     {R(RW, 0, 9), R(GW, 0, 9), R(BW, 0, 9), R(RX, 0, 8), R(RW, 10, 10), R(GX, 0, 8),
+      R(GW, 10, 10), R(BX, 0, 8), R(BW, 10, 10), END}},
+    {0x0B, 5, 1, 1, 12, {8, 8, 8},
+     {R(RW, 0, 9), R(GW, 0, 9), R(BW, 0, 9), R(RX, 0, 7), R(RW, 11, 10), R(GX, 0, 7),
+      R(GW, 11, 10), R(BX, 0, 7), R(BW, 11, 10), END}},
+    {0x0F, 5, 1, 1, 16, {4, 4, 4},
+     {R(RW, 0, 9), R(GW, 0, 9), R(BW, 0, 9), R(RX, 0, 3), R(RW, 15, 10), R(GX, 0, 3),
+      R(GW, 15, 10), R(BX, 0, 3), R(BW, 15, 10), END}},
+};
+#undef R
+#undef END
+
+static int Bc6hSignExtend(int v, int bits) {
+  int const shift = 32 - bits;
+  return (int) ((uint32_t) v << shift) >> shift;
+}
+
+static int Bc6hUnquantize(int v, int bits, bool isSigned) {
+  if (!isSigned) {
+    if (bits >= 15) { return v; }
+    if (v == 0) { return 0; }
+    if (v == (1 << bits) - 1) { return 0xFFFF; }
+    return ((v << 16) + 0x8000) >> bits;
+  }
+
+  if (bits >= 16) { return v; }
+  bool const negative = v < 0;
+  if (negative) { v = -v; }
+  int u;
+  if (v == 0) { u = 0; }
+  else if (v >= (1 << (bits - 1)) - 1) { u = 0x7FFF; }
+  else { u = ((v << 15) + 0x4000) >> (bits - 1); }
+  return negative ? -u : u;
+}
+
+// scales an interpolated value to the final half, returned as a signed integer
+// magnitude so errors can be measured linearly in 'half bit' space
+static int Bc6hFinish(int v, bool isSigned) {
+  if (!isSigned) { return (v * 31) >> 6; }
+  return v < 0 ? -(((-v) * 31) >> 5) : (v * 31) >> 5;
+}
+
+// negative values keep their sign even if the magnitude rounds to zero
+static uint16_t Bc6hFinishToHalf(int v, bool isSigned) {
+  if (isSigned && v < 0) { return (uint16_t) (0x8000 | (((-v) * 31) >> 5)); }
+  return (uint16_t) Bc6hFinish(v, isSigned);
+}
+
+static int Bc6hFromHalf(uint16_t h, bool isSigned) {
+  int mag = h & 0x7FFF;
+  // infinities and nans clamp to the largest finite half
+  if (mag > 0x7BFF) { mag = 0x7BFF; }
+  if (h & 0x8000) { return isSigned ? -mag : 0; }
+  return mag;
+}
+
+static Bc6hModeInfo const *Bc6hFindMode(int value) {
+  for (int m = 0; m < 14; ++m) {
+    if (Bc6hModes[m].value == value) { return &Bc6hModes[m]; }
+  }
+  return NULL;
+}
+
+static int Bc6hFieldBits(Bc6hModeInfo const *info, int slot, int channel) {
+  if (slot == 0 || !info->transformed) { return info->endpointBits; }
+  return info->deltaBits[channel];
+}
+
+EXTERN_C void Image_BlockDecodeBC6H(uint16_t *dest, uint8_t const *src, bool isSigned) {
+  BptcBits bits = {(uint8_t *) src, 0};
+
+  int value = (int) BptcReadBits(&bits, 2);
+  if (value > 1) { value |= (int) BptcReadBits(&bits, 3) << 2; }
+
+  Bc6hModeInfo const *info = Bc6hFindMode(value);
+  if (info == NULL) {
+    // reserved modes decode to black
+    memset(dest, 0, 16 * 3 * sizeof(uint16_t));
+    return;
+  }
+
+  int endpoints[4][3] = {{0}};
+  for (Bc6hRun const *run = info->layout; run->field != BC6H_END; ++run) {
+    int const step = run->first <= run->last ? 1 : -1;
+    for (int b = run->first;; b += step) {
+      endpoints[run->field / 3][run->field % 3] |= (int) BptcReadBits(&bits, 1) << b;
+      if (b == run->last) { break; }
+    }
+  }
+  int const partition = info->regions == 2 ? (int) BptcReadBits(&bits, 5) : 0;
+  int const slots = info->regions * 2;
+
+  for (int c = 0; c < 3; ++c) {
+    if (isSigned) {
+      endpoints[0][c] = Bc6hSignExtend(endpoints[0][c], info->endpointBits);
+    }
+    for (int s = 1; s < slots; ++s) {
+      if (info->transformed) {
+        int const delta = Bc6hSignExtend(endpoints[s][c], info->deltaBits[c]);
+        endpoints[s][c] = (endpoints[0][c] + delta) & ((1 << info->endpointBits) - 1);
+      }
+      if (isSigned) {
+        endpoints[s][c] = Bc6hSignExtend(endpoints[s][c], info->endpointBits);
+      }
+    }
+    for (int s = 0; s < slots; ++s) {
+      endpoints[s][c] = Bc6hUnquantize(endpoints[s][c], info->endpointBits, isSigned);
+    }
+  }
+
+  int const indexBits = info->regions == 2 ? 3 : 4;
+  uint8_t const *weights = BptcWeights(indexBits);
+  uint8_t const *table = BptcPartition(info->regions, partition);
+  for (int i = 0; i < 16; ++i) {
+    bool const anchor = BptcIsAnchor(info->regions, partition, i);
+    int const index = (int) BptcReadBits(&bits, indexBits - (anchor ? 1 : 0));
+    int const s = table[i] * 2;
+    for (int c = 0; c < 3; ++c) {
+      int const v = BptcInterpolate(endpoints[s][c], endpoints[s + 1][c], weights[index]);
+      dest[i * 3 + c] = Bc6hFinishToHalf(v, isSigned);
+    }
+  }
+}
+
+typedef struct Bc6hEncoding {
+  Bc6hModeInfo const *info;
+  int partition;
+  int endpoints[4][3]; // quantized, after any delta clamping
+  uint8_t indices[16];
+  uint64_t error;
+} Bc6hEncoding;
+
+static void Bc6hPack(uint8_t *dest, Bc6hEncoding const *enc) {
+  Bc6hModeInfo const *info = enc->info;
+  memset(dest, 0, 16);
+  BptcBits bits = {dest, 0};
+
+  BptcWriteBits(&bits, info->value, info->modeBits);
+
+  int fields[4][3];
+  for (int s = 0; s < 4; ++s) {
+    for (int c = 0; c < 3; ++c) {
+      int v = enc->endpoints[s][c];
+      if (s > 0 && info->transformed) { v -= enc->endpoints[0][c]; }
+      fields[s][c] = v & ((1 << Bc6hFieldBits(info, s, c)) - 1);
+    }
+  }
+  for (Bc6hRun const *run = info->layout; run->field != BC6H_END; ++run) {
+    int const step = run->first <= run->last ? 1 : -1;
+    for (int b = run->first;; b += step) {
+      BptcWriteBits(&bits, (uint32_t) (fields[run->field / 3][run->field % 3] >> b) & 1, 1);
+      if (b == run->last) { break; }
+    }
+  }
+  if (info->regions == 2) {
+    BptcWriteBits(&bits, (uint32_t) enc->partition, 5);
+  }
+
+  int const indexBits = info->regions == 2 ? 3 : 4;
+  for (int i = 0; i < 16; ++i) {
+    bool const anchor = BptcIsAnchor(info->regions, enc->partition, i);
+    BptcWriteBits(&bits, enc->indices[i], indexBits - (anchor ? 1 : 0));
+  }
+  ASSERT(bits.pos == 128);
+}
+
+static int Bc6hQuantize(float v, int bits, bool isSigned) {
+  int lo, hi, guess;
+  if (isSigned) {
+    hi = (1 << (bits - 1)) - 1;
+    lo = -hi;
+    guess = (int) (v * (float) (1 << (bits - 1)) / 32768.0f);
+  } else {
+    hi = (1 << bits) - 1;
+    lo = 0;
+    guess = (int) (v * (float) (1 << bits) / 65536.0f);
+  }
+
+  int best = 0;
+  float bestErr = FLT_MAX;
+  for (int q = guess - 1; q <= guess + 1; ++q) {
+    int const cq = q < lo ? lo : q > hi ? hi : q;
+    float const d = (float) Bc6hUnquantize(cq, bits, isSigned) - v;
+    if (d * d < bestErr) {
+      bestErr = d * d;
+      best = cq;
+    }
+  }
+  return best;
+}
+
+// selects indices for the pixels of every region, anchors are limited to
+// the low half of the palette when constrainAnchors is set
+static uint64_t Bc6hSelectIndices(int const (*target)[3], Bc6hModeInfo const *info, int partition,
+                                  int const (*endpoints)[3], bool isSigned, bool constrainAnchors,
+                                  uint8_t *indices) {
+  int const indexBits = info->regions == 2 ? 3 : 4;
+  int const count = 1 << indexBits;
+  uint8_t const *weights = BptcWeights(indexBits);
+  uint8_t const *table = BptcPartition(info->regions, partition);
+
+  int palette[2][16][3];
+  for (int r = 0; r < info->regions; ++r) {
+    int u0[3], u1[3];
+    for (int c = 0; c < 3; ++c) {
+      u0[c] = Bc6hUnquantize(endpoints[r * 2][c], info->endpointBits, isSigned);
+      u1[c] = Bc6hUnquantize(endpoints[r * 2 + 1][c], info->endpointBits, isSigned);
+    }
+    for (int k = 0; k < count; ++k) {
+      for (int c = 0; c < 3; ++c) {
+        palette[r][k][c] = Bc6hFinish(BptcInterpolate(u0[c], u1[c], weights[k]), isSigned);
+      }
+    }
+  }
+
+  uint64_t total = 0;
+  for (int i = 0; i < 16; ++i) {
+    int const r = table[i];
+    int const limit = (constrainAnchors && BptcIsAnchor(info->regions, partition, i)) ? count / 2 : count;
+    uint64_t bestErr = UINT64_MAX;
+    int best = 0;
+    for (int k = 0; k < limit; ++k) {
+      uint64_t err = 0;
+      for (int c = 0; c < 3; ++c) {
+        int64_t const d = palette[r][k][c] - target[i][c];
+        err += (uint64_t) (d * d);
+      }
+      if (err < bestErr) {
+        bestErr = err;
+        best = k;
+      }
+    }
+    indices[i] = (uint8_t) best;
+    total += bestErr;
+  }
+  return total;
+}
+
+static void Bc6hEncodeConfiguration(int const (*target)[3], float const (*unquantized)[4],
+                                    Bc6hModeInfo const *info, int partition, bool isSigned,
+                                    int refinements, Bc6hEncoding *best) {
+  uint8_t const *table = BptcPartition(info->regions, partition);
+  int const indexBits = info->regions == 2 ? 3 : 4;
+  int const half = 1 << (indexBits - 1);
+
+  float lo[2][4], hi[2][4];
+  for (int r = 0; r < info->regions; ++r) {
+    float points[16][4];
+    int count = 0;
+    for (int i = 0; i < 16; ++i) {
+      if (table[i] == r) { memcpy(points[count++], unquantized[i], sizeof(float) * 4); }
+    }
+    BptcFitLine((float const (*)[4]) points, count, 3, lo[r], hi[r]);
+  }
+
+  for (int pass = 0; pass <= refinements; ++pass) {
+    Bc6hEncoding enc;
+    enc.info = info;
+    enc.partition = partition;
+    for (int r = 0; r < info->regions; ++r) {
+      for (int c = 0; c < 3; ++c) {
+        enc.endpoints[r * 2][c] = Bc6hQuantize(lo[r][c], info->endpointBits, isSigned);
+        enc.endpoints[r * 2 + 1][c] = Bc6hQuantize(hi[r][c], info->endpointBits, isSigned);
+      }
+    }
+    for (int s = info->regions * 2; s < 4; ++s) {
+      for (int c = 0; c < 3; ++c) { enc.endpoints[s][c] = 0; }
+    }
+
+    // orient each region so its anchor wants a low index, this has to happen
+    // before delta clamping as the base endpoint may swap
+    Bc6hSelectIndices(target, info, partition, (int const (*)[3]) enc.endpoints, isSigned, false, enc.indices);
+    for (int r = 0; r < info->regions; ++r) {
+      if (enc.indices[BptcAnchorOf(info->regions, partition, r)] >= half) {
+        for (int c = 0; c < 3; ++c) {
+          int const t = enc.endpoints[r * 2][c];
+          enc.endpoints[r * 2][c] = enc.endpoints[r * 2 + 1][c];
+          enc.endpoints[r * 2 + 1][c] = t;
+        }
+      }
+    }
+
+    if (info->transformed) {
+      for (int s = 1; s < info->regions * 2; ++s) {
+        for (int c = 0; c < 3; ++c) {
+          int const range = 1 << (info->deltaBits[c] - 1);
+          int delta = enc.endpoints[s][c] - enc.endpoints[0][c];
+          delta = delta < -range ? -range : delta > range - 1 ? range - 1 : delta;
+          enc.endpoints[s][c] = enc.endpoints[0][c] + delta;
+        }
+      }
+    }
+
+    enc.error = Bc6hSelectIndices(target, info, partition, (int const (*)[3]) enc.endpoints,
+                                  isSigned, true, enc.indices);
+    if (enc.error < best->error) { *best = enc; }
+    if (enc.error == 0 || pass == refinements) { break; }
+
+    for (int r = 0; r < info->regions; ++r) {
+      float points[16][4];
+      uint8_t weights[16];
+      int count = 0;
+      for (int i = 0; i < 16; ++i) {
+        if (table[i] != r) { continue; }
+        memcpy(points[count], unquantized[i], sizeof(float) * 4);
+        weights[count++] = BptcWeights(indexBits)[enc.indices[i]];
+      }
+      // the next pass re-orients the region so a swap here doesn't matter
+      BptcLeastSquares((float const (*)[4]) points, weights, count, 3, lo[r], hi[r]);
+    }
+  }
+}
+
+EXTERN_C void Image_BlockEncodeBC6H(uint8_t *dest, uint16_t const *src, bool isSigned,
+                                    Image_BlockEncodeQuality quality) {
+  int target[16][3];
+  float unquantized[16][4];
+  float const scale = isSigned ? 32.0f / 31.0f : 64.0f / 31.0f;
+  for (int i = 0; i < 16; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      target[i][c] = Bc6hFromHalf(src[i * 3 + c], isSigned);
+      unquantized[i][c] = (float) target[i][c] * scale;
+    }
+    unquantized[i][3] = 0.0f;
+  }
+
+  // indices into Bc6hModes, single region modes first as they're cheapest
+  static const int fastModes[] = {10};
+  static const int normalModes[] = {10, 11, 12, 13, 0, 5, 9};
+  static const int slowModes[] = {10, 11, 12, 13, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+  int const *modes = fastModes;
+  int modeCount = 1;
+  if (quality == Image_BEQ_Normal) {
+    modes = normalModes;
+    modeCount = 7;
+  } else if (quality != Image_BEQ_Fast) {
+    modes = slowModes;
+    modeCount = 14;
+  }
+  int const partitionsToTry = BptcQuality(quality, 1, 4, 16);
+  int const refinements = BptcQuality(quality, 1, 1, 2);
+
+  Bc6hEncoding best;
+  memset(&best, 0, sizeof(best));
+  best.error = UINT64_MAX;
+
+  BptcRankedPartition ranked[32];
+  int rankedCount = 0;
+
+  for (int m = 0; m < modeCount && best.error != 0; ++m) {
+    Bc6hModeInfo const *info = &Bc6hModes[modes[m]];
+    if (info->regions == 1) {
+      Bc6hEncodeConfiguration((int const (*)[3]) target, (float const (*)[4]) unquantized,
+                              info, 0, isSigned, refinements, &best);
+      continue;
+    }
+
+    if (rankedCount == 0) {
+      rankedCount = BptcRankPartitions((float const (*)[4]) unquantized, 3, 2, 32, ranked, partitionsToTry);
+    }
+    for (int p = 0; p < rankedCount && best.error != 0; ++p) {
+      Bc6hEncodeConfiguration((int const (*)[3]) target, (float const (*)[4]) unquantized,
+                              info, ranked[p].partition, isSigned, refinements, &best);
+    }
+  }
+
+  Bc6hPack(dest, &best);
+}
@@ -33,6 +33,38 @@ void hq_resample(const unsigned int _channelCount,
                  const real _clampLow = real(0),
                  const real _clampHigh = real(1));
 
+// the first and last source pixel the taps of dst pixels
+// [_dstFirst, _dstFirst + _dstCount) reach along one axis
+template<typename real = float>
+void hq_resample_window(unsigned int _dstFirst, unsigned int _dstCount,
+                               unsigned int _srcSize, unsigned int _dstSize,
+                               unsigned int *_srcFirst, unsigned int *_srcLast);
+
+// as hq_resample for the _dstRegionWidth x _dstRegionHeight part of the dest
+// at _dstX,_dstY. _srcWindow holds the source pixels from _srcX,_srcY in rows
+// _srcWindowWidth pixels long and must cover the hq_resample_window ranges.
+// _dstData is packed to the region's width. The results are the same as the
+// same pixels of a whole image hq_resample
+template<typename real = float>
+void hq_resample_region(const unsigned int _channelCount,
+                        const real *_srcWindow,
+                        const unsigned int _srcX,
+                        const unsigned int _srcY,
+                        const unsigned int _srcWindowWidth,
+                        const unsigned int _srcWidth,
+                        const unsigned int _srcHeight,
+                        real *_dstData,
+                        const unsigned int _dstX,
+                        const unsigned int _dstY,
+                        const unsigned int _dstRegionWidth,
+                        const unsigned int _dstRegionHeight,
+                        const unsigned int _dstWidth,
+                        const unsigned int _dstHeight,
+                        const real _b = real(1) / real(3),
+                        const real _c = real(1) / real(3),
+                        const real _clampLow = real(0),
+                        const real _clampHigh = real(1));
+
 // ------------------------------------------------------ MitchellNetravali ---
 // Mitchell Netravali reconstruction filter
 template<typename real>
@@ -73,17 +105,48 @@ void hq_resample(const unsigned int _channelCount,
                  const real *_srcData, const unsigned int _srcWidth, const unsigned int _srcHeight,
                  real *_dstData, const unsigned int _dstWidth, const unsigned int _dstHeight,
                  const real _b, const real _c, const real _clampLow, const real _clampHigh) {
-  using namespace std;
-
   if ((_srcWidth == _dstWidth) && (_srcHeight == _dstHeight)) {
     memcpy(_dstData, _srcData, _srcWidth * _srcHeight * sizeof(real) * _channelCount);
     return;
   }
+  hq_resample_region<real>(_channelCount,
+                           _srcData, 0, 0, _srcWidth, _srcWidth, _srcHeight,
+                           _dstData, 0, 0, _dstWidth, _dstHeight, _dstWidth, _dstHeight,
+                           _b, _c, _clampLow, _clampHigh);
+}
+
+// ---------------------------------------------------------------- window ---
+template<typename real>
+void hq_resample_window(unsigned int _dstFirst, unsigned int _dstCount,
+                               unsigned int _srcSize, unsigned int _dstSize,
+                               unsigned int *_srcFirst, unsigned int *_srcLast) {
+  // the same sums as hq_resample_region so the floors agree
+  const real scale = _srcSize / (real) _dstSize;
+  const int first = (int) std::floor(((real) _dstFirst) * scale) - 2;
+  const int last = (int) std::floor(((real) (_dstFirst + _dstCount - 1)) * scale) + 1;
+  *_srcFirst = (unsigned int) std::min(std::max(0, first), (int) _srcSize - 1);
+  *_srcLast = (unsigned int) std::min(std::max(0, last), (int) _srcSize - 1);
+}
+
+// ---------------------------------------------------------- scale region ---
+template<typename real>
+void hq_resample_region(const unsigned int _channelCount,
+                        const real *_srcWindow, const unsigned int _srcX, const unsigned int _srcY,
+                        const unsigned int _srcWindowWidth,
+                        const unsigned int _srcWidth, const unsigned int _srcHeight,
+                        real *_dstData, const unsigned int _dstX, const unsigned int _dstY,
+                        const unsigned int _dstRegionWidth, const unsigned int _dstRegionHeight,
+                        const unsigned int _dstWidth, const unsigned int _dstHeight,
+                        const real _b, const real _c, const real _clampLow, const real _clampHigh) {
+  using namespace std;
+
   const real xscale = _srcWidth / (real) _dstWidth;
   const real yscale = _srcHeight / (real) _dstHeight;
+  // window relative source pixel
+#define HQ_SRC(jj, ii) _srcWindow[((((jj) - (int) _srcY) * (int) _srcWindowWidth) + ((ii) - (int) _srcX)) * _channelCount + c]
 
-  for (unsigned int j = 0; j < _dstHeight; ++j) {
-    for (unsigned int i = 0; i < _dstWidth; ++i) {
+  for (unsigned int j = _dstY; j < _dstY + _dstRegionHeight; ++j) {
+    for (unsigned int i = _dstX; i < _dstX + _dstRegionWidth; ++i) {
       // genereate indices
       const real rSrcI = ((real) i) * xscale;
       const real rSrcJ = ((real) j) * yscale;
@@ -100,28 +163,16 @@ void hq_resample(const unsigned int _channelCount,
 
       for (unsigned int c = 0; c < _channelCount; ++c) {
         real t0 = hq_interpolate<real>((real) i / (real) _dstWidth,
-                                       _srcData[(((j0 * _srcWidth) + i0) * _channelCount) + c],
-                                       _srcData[(((j0 * _srcWidth) + i1) * _channelCount) + c],
-                                       _srcData[(((j0 * _srcWidth) + i2) * _channelCount) + c],
-                                       _srcData[(((j0 * _srcWidth) + i3) * _channelCount) + c],
+                                       HQ_SRC(j0, i0), HQ_SRC(j0, i1), HQ_SRC(j0, i2), HQ_SRC(j0, i3),
                                        _b, _c);
         real t1 = hq_interpolate<real>((real) i / (real) _dstWidth,
-                                       _srcData[(((j1 * _srcWidth) + i0) * _channelCount) + c],
-                                       _srcData[(((j1 * _srcWidth) + i1) * _channelCount) + c],
-                                       _srcData[(((j1 * _srcWidth) + i2) * _channelCount) + c],
-                                       _srcData[(((j1 * _srcWidth) + i3) * _channelCount) + c],
+                                       HQ_SRC(j1, i0), HQ_SRC(j1, i1), HQ_SRC(j1, i2), HQ_SRC(j1, i3),
                                        _b, _c);
         real t2 = hq_interpolate<real>((real) i / (real) _dstWidth,
-                                       _srcData[(((j2 * _srcWidth) + i0) * _channelCount) + c],
-                                       _srcData[(((j2 * _srcWidth) + i1) * _channelCount) + c],
-                                       _srcData[(((j2 * _srcWidth) + i2) * _channelCount) + c],
-                                       _srcData[(((j2 * _srcWidth) + i3) * _channelCount) + c],
+                                       HQ_SRC(j2, i0), HQ_SRC(j2, i1), HQ_SRC(j2, i2), HQ_SRC(j2, i3),
                                        _b, _c);
         real t3 = hq_interpolate<real>((real) i / (real) _dstWidth,
-                                       _srcData[(((j3 * _srcWidth) + i0) * _channelCount) + c],
-                                       _srcData[(((j3 * _srcWidth) + i1) * _channelCount) + c],
-                                       _srcData[(((j3 * _srcWidth) + i2) * _channelCount) + c],
-                                       _srcData[(((j3 * _srcWidth) + i3) * _channelCount) + c],
+                                       HQ_SRC(j3, i0), HQ_SRC(j3, i1), HQ_SRC(j3, i2), HQ_SRC(j3, i3),
                                        _b, _c);
         // this will pass unless _clampLow is a NAN
         if (_clampLow == _clampLow) {
@@ -146,10 +197,11 @@ void hq_resample(const unsigned int _channelCount,
         if (_clampHigh == _clampHigh) {
           y = std::min(y, _clampHigh);
         }
-        _dstData[(((j * _dstWidth) + i) * _channelCount) + c] = y;
+        _dstData[((((j - _dstY) * _dstRegionWidth) + (i - _dstX)) * _channelCount) + c] = y;
       }
     }
   }
+#undef HQ_SRC
 }
 }
 
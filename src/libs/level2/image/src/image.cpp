@@ -1,7 +1,11 @@
 #include "core/core.h"
+#include "core/logger.h"
 #include "image/format.h"
 #include "image/format_cracker.h"
 #include "image/image.h"
+#include "image/view.h"
+#include "allocator.hpp"
+#include <cstddef>
 
 EXTERN_C Image_ImageHeader *Image_Create(uint32_t width,
                                          uint32_t height,
@@ -16,29 +20,250 @@ EXTERN_C Image_ImageHeader *Image_Create(uint32_t width,
   return image;
 }
 
-EXTERN_C Image_ImageHeader *Image_CreateNoClear(uint32_t width,
-                                                uint32_t height,
-                                                uint32_t depth,
-                                                uint32_t slices,
-                                                enum Image_Format format) {
+namespace {
+
+void *DefaultAllocate(void *, size_t size, size_t alignment) {
+  // over allocate and stash the real pointer just before the aligned block
+  uint8_t *raw = (uint8_t *) malloc(size + alignment + sizeof(void *));
+  if (!raw) { return nullptr; }
+  uintptr_t const start = (uintptr_t) (raw + sizeof(void *));
+  uint8_t *aligned = (uint8_t *) ((start + alignment - 1) & ~((uintptr_t) alignment - 1));
+  ((void **) aligned)[-1] = raw;
+  return aligned;
+}
+
+void DefaultFree(void *, void *ptr, size_t) {
+  if (!ptr) { return; }
+  free(((void **) ptr)[-1]);
+}
+
+Image_Allocator const DefaultAllocator = {&DefaultAllocate, &DefaultFree, nullptr};
+Image_Allocator CurrentAllocator = DefaultAllocator;
+
+// the header sits just before the aligned pixel data, the allocator used is
+// stored in the gap between the start of the allocation and the header
+constexpr size_t HeaderOffset = IMAGE_DATA_ALIGNMENT - sizeof(Image_ImageHeader);
+static_assert(sizeof(Image_ImageHeader) <= IMAGE_DATA_ALIGNMENT, "Image header must fit in the alignment");
+static_assert(sizeof(Image_Allocator) <= HeaderOffset, "Image allocator must fit before the header");
+
+// a packed chain allocation is the allocator, an array of headers each
+// followed by its data pointer (the first header is where a normal images
+// is), the chain table and level offsets and then the blob
+struct PackedLevel {
+  Image_ImageHeader header;
+  Image_ExternalData data;
+};
+static_assert(offsetof(PackedLevel, data) == sizeof(Image_ImageHeader), "Packed level data must follow the header");
+
+struct PackedChainStorage {
+  Image_PackedChain chain;
+  Image_ImageHeader const *first;
+  size_t allocationSize;
+};
+
+size_t AlignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// allocates a packed chain with the same shape as the layout chain, the
+// layout can be plain headers (no data needed)
+Image_ImageHeader *CreatePackedChain(Image_ImageHeader const *layout, uint32_t alignment) {
+  if (alignment == 0) { alignment = IMAGE_DATA_ALIGNMENT; }
+  if (!Math_IsPowerOf2U32(alignment)) {
+    LOGERRORF("Packed chain alignment %u isn't a power of 2", alignment);
+    return nullptr;
+  }
+  alignment = alignment < IMAGE_DATA_ALIGNMENT ? IMAGE_DATA_ALIGNMENT : alignment;
+
+  uint32_t const levelCount = (uint32_t) Image_LinkedImageCountOf(layout);
+  uint64_t blobSize = 0;
+  for (Image_ImageHeader const *level = layout; level; level = level->nextImage) {
+    // block compression can't be less than 4x4
+    if ((level->width < 4 || level->height < 4) && Image_Format_IsCompressed(level->format)) {
+      return nullptr;
+    }
+    blobSize = AlignUp((size_t) blobSize, alignment) + Image_ByteCountOf(level);
+  }
+
+  size_t const storageOffset = HeaderOffset + levelCount * sizeof(PackedLevel);
+  size_t const offsetsOffset = storageOffset + sizeof(PackedChainStorage);
+  size_t const blobOffset = AlignUp(offsetsOffset + levelCount * sizeof(uint64_t), alignment);
+  size_t const allocationSize = blobOffset + (size_t) blobSize;
+
+  auto *base = (uint8_t *) CurrentAllocator.allocate(CurrentAllocator.user, allocationSize, alignment);
+  if (!base) { return nullptr; }
+  memcpy(base, &CurrentAllocator, sizeof(Image_Allocator));
+
+  auto *levels = (PackedLevel *) (base + HeaderOffset);
+  auto *storage = (PackedChainStorage *) (base + storageOffset);
+  auto *offsets = (uint64_t *) (base + offsetsOffset);
+  storage->chain.blob = base + blobOffset;
+  storage->chain.blobSize = blobSize;
+  storage->chain.alignment = alignment;
+  storage->chain.levelCount = levelCount;
+  storage->chain.levelOffsets = offsets;
+  storage->first = &levels[0].header;
+  storage->allocationSize = allocationSize;
+
+  uint64_t offset = 0;
+  uint32_t index = 0;
+  for (Image_ImageHeader const *level = layout; level; level = level->nextImage, ++index) {
+    offset = AlignUp((size_t) offset, alignment);
+    offsets[index] = offset;
+
+    Image_ImageHeader *image = &levels[index].header;
+    Image_FillHeader(level->width, level->height, level->depth, level->slices, level->format, image);
+    image->dataSize = Image_ByteCountOf(image);
+    image->flags = (level->flags & (Image_Flag_Tiled | Image_Flag_Cubemap)) | Image_Flag_PackedChain;
+    if (level->nextImage) {
+      image->nextType = level->nextType;
+      image->nextImage = &levels[index + 1].header;
+    }
+    levels[index].data.data = storage->chain.blob + offset;
+    levels[index].data.release = nullptr;
+    levels[index].data.user = storage;
+
+    offset += image->dataSize;
+  }
+  return &levels[0].header;
+}
+
+} // end anon namespace
+
+EXTERN_C void Image_SetAllocator(Image_Allocator const *allocator) {
+  CurrentAllocator = allocator ? *allocator : DefaultAllocator;
+}
+
+EXTERN_C Image_Allocator const *Image_GetAllocator(void) {
+  return &CurrentAllocator;
+}
+
+namespace Image {
+
+size_t AllocationSizeOf(uint64_t dataSize) {
+  return HeaderOffset + sizeof(Image_ImageHeader) + (size_t) dataSize;
+}
+
+Image_ImageHeader *CreateNoClearWith(Image_Allocator const *allocator,
+                                     uint32_t width,
+                                     uint32_t height,
+                                     uint32_t depth,
+                                     uint32_t slices,
+                                     enum Image_Format format) {
   // block compression can't be less than 4x4
   if ((width < 4 || height < 4) && Image_Format_IsCompressed(format)) {
     return nullptr;
   }
 
-  uint64_t const dataSize = (width *
+  uint64_t const dataSize = ((uint64_t) width *
                             height *
                             depth *
                             slices *
                             Image_Format_BitWidth(format)) / 8;
 
-  auto *image = (Image_ImageHeader *) malloc(sizeof(Image_ImageHeader) + dataSize);
-  if (!image) { return image; }
+  auto *base = (uint8_t *) allocator->allocate(allocator->user, AllocationSizeOf(dataSize), IMAGE_DATA_ALIGNMENT);
+  if (!base) { return nullptr; }
+  ASSERT(((uintptr_t) base & (IMAGE_DATA_ALIGNMENT - 1)) == 0);
+  memcpy(base, allocator, sizeof(Image_Allocator));
+
+  auto *image = (Image_ImageHeader *) (base + HeaderOffset);
   Image_FillHeader(width, height, depth, slices, format, image);
   image->dataSize = dataSize;
 
   return image;
 }
+
+} // end Image namespace
+
+EXTERN_C Image_ImageHeader *Image_CreateNoClear(uint32_t width,
+                                                uint32_t height,
+                                                uint32_t depth,
+                                                uint32_t slices,
+                                                enum Image_Format format) {
+  return Image::CreateNoClearWith(&CurrentAllocator, width, height, depth, slices, format);
+}
+
+EXTERN_C Image_ImageHeader *Image_CreateExternal(uint32_t width,
+                                                 uint32_t height,
+                                                 uint32_t depth,
+                                                 uint32_t slices,
+                                                 enum Image_Format format,
+                                                 void *data,
+                                                 Image_ExternalDataReleaseFunc release,
+                                                 void *user) {
+  ASSERT(data);
+  if ((width < 4 || height < 4) && Image_Format_IsCompressed(format)) {
+    return nullptr;
+  }
+
+  auto *base = (uint8_t *) CurrentAllocator.allocate(CurrentAllocator.user,
+                                                      Image::AllocationSizeOf(sizeof(Image_ExternalData)),
+                                                      IMAGE_DATA_ALIGNMENT);
+  if (!base) { return nullptr; }
+  memcpy(base, &CurrentAllocator, sizeof(Image_Allocator));
+
+  auto *image = (Image_ImageHeader *) (base + HeaderOffset);
+  Image_FillHeader(width, height, depth, slices, format, image);
+  image->dataSize = Image_ByteCountOf(image);
+  image->flags = Image_Flag_ExternalData;
+
+  auto *external = (Image_ExternalData *) (image + 1);
+  external->data = data;
+  external->release = release;
+  external->user = user;
+  return image;
+}
+
+EXTERN_C Image_ImageHeader *Image_CreatePackedMipMaps(uint32_t width,
+                                                      uint32_t height,
+                                                      uint32_t depth,
+                                                      uint32_t slices,
+                                                      enum Image_Format format,
+                                                      uint32_t mipCount,
+                                                      uint32_t alignment) {
+  // a 32 bit dimension has at most 32 levels
+  Image_ImageHeader layout[32];
+  uint32_t count = 0;
+  do {
+    Image_FillHeader(width, height, depth, slices, format, &layout[count]);
+    if (count > 0) {
+      layout[count - 1].nextType = Image_IT_MipMaps;
+      layout[count - 1].nextImage = &layout[count];
+    }
+    ++count;
+    if (width == 1 && height == 1 && depth == 1) { break; }
+    width = width > 1 ? width / 2 : 1;
+    height = height > 1 ? height / 2 : 1;
+    depth = depth > 1 ? depth / 2 : 1;
+  } while (count != mipCount && count < 32);
+
+  if (mipCount != 0 && count != mipCount) {
+    LOGERRORF("%u mip levels asked for but there are only %u", mipCount, count);
+    return nullptr;
+  }
+  return CreatePackedChain(layout, alignment);
+}
+
+EXTERN_C Image_ImageHeader *Image_PackChain(Image_ImageHeader const *image, uint32_t alignment) {
+  ASSERT(image);
+  Image_ImageHeader *packed = CreatePackedChain(image, alignment);
+  if (!packed) { return nullptr; }
+
+  Image_ImageHeader *dst = packed;
+  for (Image_ImageHeader const *src = image; src; src = src->nextImage) {
+    memcpy(Image_RawDataPtr(dst), Image_RawDataPtr(src), Image_ByteCountOf(src));
+    dst = dst->nextImage;
+  }
+  return packed;
+}
+
+EXTERN_C Image_PackedChain const *Image_PackedChainOf(Image_ImageHeader const *image) {
+  ASSERT(image);
+  if ((image->flags & Image_Flag_PackedChain) == 0) { return nullptr; }
+  auto const *data = (Image_ExternalData const *) (image + 1);
+  return &((PackedChainStorage const *) data->user)->chain;
+}
+
 EXTERN_C void Image_FillHeader(uint32_t width,
                                uint32_t height,
                                uint32_t depth,
@@ -57,6 +282,17 @@ EXTERN_C void Image_FillHeader(uint32_t width,
 }
 
 EXTERN_C void Image_Destroy(Image_ImageHeader *image) {
+  // a packed chain is a single allocation
+  if (image->flags & Image_Flag_PackedChain) {
+    auto const *storage = (PackedChainStorage const *) ((Image_ExternalData const *) (image + 1))->user;
+    ASSERT(storage->first == image);
+    uint8_t *base = ((uint8_t *) image) - HeaderOffset;
+    Image_Allocator allocator;
+    memcpy(&allocator, base, sizeof(Image_Allocator));
+    allocator.free(allocator.user, base, storage->allocationSize);
+    return;
+  }
+
   // recursively free next chain
   switch (image->nextType) {
     case Image_IT_MipMaps:
@@ -69,7 +305,20 @@ EXTERN_C void Image_Destroy(Image_ImageHeader *image) {
     default:
     case Image_IT_None:break;
   }
-  free(image);
+
+  uint64_t allocatedSize = image->dataSize;
+  if (image->flags & Image_Flag_ExternalData) {
+    auto const *external = (Image_ExternalData const *) (image + 1);
+    if (external->release) {
+      external->release(external->user);
+    }
+    allocatedSize = sizeof(Image_ExternalData);
+  }
+
+  uint8_t *base = ((uint8_t *) image) - HeaderOffset;
+  Image_Allocator allocator;
+  memcpy(&allocator, base, sizeof(Image_Allocator));
+  allocator.free(allocator.user, base, Image::AllocationSizeOf(allocatedSize));
 }
 
 // we include fetch after swizzle so hopefully the compiler will inline it...
@@ -81,10 +330,62 @@ EXTERN_C inline enum Image_Channel Image_Channel_Swizzle(enum Image_Format forma
 #include "fetch.hpp"
 #include "put.hpp"
 
+namespace {
+
+double ChannelAtPtr(enum Image_Channel channel, enum Image_Format format, uint8_t const *pixelPtr) {
+  using namespace Image;
+
+  switch (Image_Format_BitWidth(format)) {
+    case 256:return BitWidth256ChannelAt(channel, format, pixelPtr);
+    case 192:return BitWidth192ChannelAt(channel, format, pixelPtr);
+    case 128:return BitWidth128ChannelAt(channel, format, pixelPtr);
+    case 96:return BitWidth96ChannelAt(channel, format, pixelPtr);
+    case 64:return BitWidth64ChannelAt(channel, format, pixelPtr);
+    case 48:return BitWidth48ChannelAt(channel, format, pixelPtr);
+    case 32:return BitWidth32ChannelAt(channel, format, pixelPtr);
+    case 24:return BitWidth24ChannelAt(channel, format, pixelPtr);
+    case 16:return BitWidth16ChannelAt(channel, format, pixelPtr);
+    case 8:return BitWidth8ChannelAt(channel, format, pixelPtr);
+    default:LOGERROR("Bitwidth of format not supported");
+      return 0.0;
+  }
+}
+
+void SetChannelAtPtr(enum Image_Channel channel, enum Image_Format format, uint8_t *pixelPtr, double value) {
+  using namespace Image;
+
+  switch (Image_Format_BitWidth(format)) {
+    case 256:BitWidth256SetChannelAt(channel, format, pixelPtr, value);
+      break;
+    case 192:BitWidth192SetChannelAt(channel, format, pixelPtr, value);
+      break;
+    case 128:BitWidth128SetChannelAt(channel, format, pixelPtr, value);
+      break;
+    case 96:BitWidth96SetChannelAt(channel, format, pixelPtr, value);
+      break;
+    case 64:BitWidth64SetChannelAt(channel, format, pixelPtr, value);
+      break;
+    case 48:BitWidth48SetChannelAt(channel, format, pixelPtr, value);
+      break;
+    case 32:BitWidth32SetChannelAt(channel, format, pixelPtr, value);
+      break;
+    case 24:BitWidth24SetChannelAt(channel, format, pixelPtr, value);
+      break;
+    case 16:BitWidth16SetChannelAt(channel, format, pixelPtr, value);
+      break;
+    case 8:BitWidth8SetChannelAt(channel, format, pixelPtr, value);
+      break;
+    default:LOGERRORF("Bitwidth %i from %s not supported",
+                      Image_Format_BitWidth(format),
+                      Image_Format_Name(format));
+  }
+}
+
+} // end anon namespace
+
 EXTERN_C double Image_GetChannelAt(Image_ImageHeader const *image, enum Image_Channel channel, size_t index) {
   ASSERT(image);
 
-  using namespace Image;
   // seperate out the block compressed format first
   if (Image_Format_IsCompressed(image->format)) {
     return Image::CompressedChannelAt(image, channel, index);
@@ -96,21 +397,7 @@ EXTERN_C double Image_GetChannelAt(Image_ImageHeader const *image, enum Image_Ch
   uint8_t *pixelPtr = ((uint8_t *) Image_RawDataPtr(image)) +
       index * (Image_Format_BitWidth(image->format) / 8);
 
-  switch (Image_Format_BitWidth(image->format)) {
-    case 256:return BitWidth256ChannelAt(channel, image->format, pixelPtr);
-    case 192:return BitWidth192ChannelAt(channel, image->format, pixelPtr);
-    case 128:return BitWidth128ChannelAt(channel, image->format, pixelPtr);
-    case 96:return BitWidth96ChannelAt(channel, image->format, pixelPtr);
-    case 64:return BitWidth64ChannelAt(channel, image->format, pixelPtr);
-    case 48:return BitWidth48ChannelAt(channel, image->format, pixelPtr);
-    case 32:return BitWidth32ChannelAt(channel, image->format, pixelPtr);
-    case 24:return BitWidth24ChannelAt(channel, image->format, pixelPtr);
-    case 16:return BitWidth16ChannelAt(channel, image->format, pixelPtr);
-    case 8:return BitWidth8ChannelAt(channel, image->format, pixelPtr);
-    default:LOGERROR("Bitwidth of format not supported");
-      return 0.0;
-  }
-
+  return ChannelAtPtr(channel, image->format, pixelPtr);
 }
 EXTERN_C size_t Image_LinkedImageCountOf(Image_ImageHeader const *image) {
   size_t count = 1;
@@ -125,7 +412,7 @@ EXTERN_C size_t Image_LinkedImageCountOf(Image_ImageHeader const *image) {
 
 EXTERN_C Image_ImageHeader const *Image_LinkedImageOf(Image_ImageHeader const *image, size_t const index) {
   size_t count = 0;
-  while (image && image->nextImage != nullptr) {
+  while (image) {
     if (count == index) {
       return image;
     }
@@ -140,8 +427,6 @@ EXTERN_C void Image_SetChannelAt(Image_ImageHeader const *image,
                                  enum Image_Channel channel,
                                  size_t index,
                                  double value) {
-  using namespace Image;
-
   // block compressed not handled ye
   ASSERT(!Image_Format_IsCompressed(image->format));
 
@@ -150,32 +435,7 @@ EXTERN_C void Image_SetChannelAt(Image_ImageHeader const *image,
   ASSERT(pixelSize >= 8);
   uint8_t *pixelPtr = (uint8_t *) Image_RawDataPtr(image) + (index * pixelSize / 8);
 
-  switch (pixelSize) {
-    case 256:BitWidth256SetChannelAt(channel, image->format, pixelPtr, value);
-      break;
-    case 192:BitWidth192SetChannelAt(channel, image->format, pixelPtr, value);
-      break;
-    case 128:BitWidth128SetChannelAt(channel, image->format, pixelPtr, value);
-      break;
-    case 96:BitWidth96SetChannelAt(channel, image->format, pixelPtr, value);
-      break;
-    case 64:BitWidth64SetChannelAt(channel, image->format, pixelPtr, value);
-      break;
-    case 48:BitWidth48SetChannelAt(channel, image->format, pixelPtr, value);
-      break;
-    case 32:BitWidth32SetChannelAt(channel, image->format, pixelPtr, value);
-      break;
-    case 24:BitWidth24SetChannelAt(channel, image->format, pixelPtr, value);
-      break;
-    case 16:BitWidth16SetChannelAt(channel, image->format, pixelPtr, value);
-      break;
-    case 8:BitWidth8SetChannelAt(channel, image->format, pixelPtr, value);
-      break;
-    default:LOGERRORF("Bitwidth %i from %s not supported",
-                      Image_Format_BitWidth(image->format),
-                      Image_Format_Name(image->format));
-  }
-
+  SetChannelAtPtr(channel, image->format, pixelPtr, value);
 }
 
 EXTERN_C void Image_GetPixelAt(Image_ImageHeader const *image, Image_PixelD *pixel, size_t index) {
@@ -210,6 +470,44 @@ EXTERN_C void Image_SetPixelAt(Image_ImageHeader const *image, Image_PixelD cons
   }
 }
 
+EXTERN_C void Image_ViewGetPixelAt(Image_View const *view, Image_PixelD *pixel, uint32_t x, uint32_t y, uint32_t z) {
+  ASSERT(view);
+  ASSERT(pixel);
+  ASSERT(!Image_Format_IsCompressed(view->format));
+
+  uint8_t const *pixelPtr = Image_ViewPixelPtr(view, x, y, z);
+
+  // intentional fallthrough on this switch statement
+  switch (Image_Format_ChannelCount(view->format)) {
+    case 4:pixel->a = ChannelAtPtr(Image_Alpha, view->format, pixelPtr);
+    case 3:pixel->b = ChannelAtPtr(Image_Blue, view->format, pixelPtr);
+    case 2:pixel->g = ChannelAtPtr(Image_Green, view->format, pixelPtr);
+    case 1:pixel->r = ChannelAtPtr(Image_Red, view->format, pixelPtr);
+      break;
+    default:ASSERT(Image_Format_ChannelCount(view->format) <= 4);
+      break;
+  }
+}
+
+EXTERN_C void Image_ViewSetPixelAt(Image_View const *view, Image_PixelD const *pixel, uint32_t x, uint32_t y, uint32_t z) {
+  ASSERT(view);
+  ASSERT(pixel);
+  ASSERT(!Image_Format_IsCompressed(view->format));
+
+  uint8_t *pixelPtr = Image_ViewPixelPtr(view, x, y, z);
+
+  // intentional fallthrough on this switch statement
+  switch (Image_Format_ChannelCount(view->format)) {
+    case 4: SetChannelAtPtr(Image_Alpha, view->format, pixelPtr, pixel->a);
+    case 3: SetChannelAtPtr(Image_Blue, view->format, pixelPtr, pixel->b);
+    case 2: SetChannelAtPtr(Image_Green, view->format, pixelPtr, pixel->g);
+    case 1: SetChannelAtPtr(Image_Red, view->format, pixelPtr, pixel->r);
+      break;
+    default:ASSERT(Image_Format_ChannelCount(view->format) <= 4);
+      break;
+  }
+}
+
 
 /*
 
@@ -0,0 +1,116 @@
+#pragma once
+#ifndef WYRD_IMAGE_KTX2_HPP
+#define WYRD_IMAGE_KTX2_HPP
+
+#include "core/core.h"
+#include "image/format.h"
+
+namespace Image {
+
+// --- KTX2 HEADERS ---
+#pragma pack(push, 1)
+
+static uint8_t const KTX2Identifier[12] = {
+    0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+
+// supercompressionScheme values, the KTX2 spec puts vendor schemes at
+// 0x10000 and up
+#define KTX2_SUPERCOMPRESSION_NONE 0
+#define KTX2_SUPERCOMPRESSION_ZLIB 3
+#define KTX2_SUPERCOMPRESSION_WYRD_LZ4 0x10000
+
+// basic data format descriptor layout, a 24 byte block header followed by
+// 16 bytes per sample. The qualifiers sit above the channel id in the
+// sample's channel type byte
+#define KTX2_DFD_BASIC_BLOCK_SIZE 24
+#define KTX2_DFD_SAMPLE_SIZE 16
+#define KTX2_DFD_MAX_SAMPLES 8
+#define KTX2_DFD_LINEAR 0x10
+#define KTX2_DFD_SIGNED 0x40
+#define KTX2_DFD_FLOAT 0x80
+
+struct KTX2Header {
+  uint8_t identifier[12];
+  uint32_t vkFormat;
+  uint32_t typeSize;
+  uint32_t pixelWidth;
+  uint32_t pixelHeight;
+  uint32_t pixelDepth;
+  uint32_t layerCount;
+  uint32_t faceCount;
+  uint32_t levelCount;
+  uint32_t supercompressionScheme;
+
+  uint32_t dfdByteOffset;
+  uint32_t dfdByteLength;
+  uint32_t kvdByteOffset;
+  uint32_t kvdByteLength;
+  uint64_t sgdByteOffset;
+  uint64_t sgdByteLength;
+};
+
+struct KTX2LevelIndex {
+  uint64_t byteOffset;
+  uint64_t byteLength;
+  uint64_t uncompressedByteLength;
+};
+
+#pragma pack(pop)
+
+#define VK_FORMAT_PVRTC1_2BPP_UNORM_BLOCK_IMG 1000054000
+#define VK_FORMAT_PVRTC1_4BPP_UNORM_BLOCK_IMG 1000054001
+#define VK_FORMAT_PVRTC1_2BPP_SRGB_BLOCK_IMG 1000054004
+#define VK_FORMAT_PVRTC1_4BPP_SRGB_BLOCK_IMG 1000054005
+
+// Image_Format follows VkFormat except that it has no SNORM, SSCALED or SINT
+// versions of the A2R10G10B10 and A2B10G10R10 packed formats
+inline uint32_t KTX2VkFormatOf(Image_Format format) {
+  switch (format) {
+    case Image_Format_A2R10G10B10_UNORM_PACK32: return 58;
+    case Image_Format_A2R10G10B10_USCALED_PACK32: return 60;
+    case Image_Format_A2R10G10B10_UINT_PACK32: return 62;
+    case Image_Format_A2B10G10R10_UNORM_PACK32: return 64;
+    case Image_Format_A2B10G10R10_USCALED_PACK32: return 66;
+    case Image_Format_A2B10G10R10_UINT_PACK32: return 68;
+    case Image_Format_PVR_2BPP_BLOCK:
+    case Image_Format_PVR_2BPPA_BLOCK: return VK_FORMAT_PVRTC1_2BPP_UNORM_BLOCK_IMG;
+    case Image_Format_PVR_4BPP_BLOCK:
+    case Image_Format_PVR_4BPPA_BLOCK: return VK_FORMAT_PVRTC1_4BPP_UNORM_BLOCK_IMG;
+    case Image_Format_PVR_2BPP_SRGB_BLOCK:
+    case Image_Format_PVR_2BPPA_SRGB_BLOCK: return VK_FORMAT_PVRTC1_2BPP_SRGB_BLOCK_IMG;
+    case Image_Format_PVR_4BPP_SRGB_BLOCK:
+    case Image_Format_PVR_4BPPA_SRGB_BLOCK: return VK_FORMAT_PVRTC1_4BPP_SRGB_BLOCK_IMG;
+    default: break;
+  }
+  if (format <= Image_Format_A8B8G8R8_SRGB_PACK32) { return (uint32_t) format; }
+  if (format >= Image_Format_R16_UNORM && format <= Image_Format_BC7_SRGB_BLOCK) {
+    return (uint32_t) format + 6;
+  }
+  return 0;
+}
+
+inline Image_Format KTX2FormatOf(uint32_t vkFormat) {
+  switch (vkFormat) {
+    case 58: return Image_Format_A2R10G10B10_UNORM_PACK32;
+    case 60: return Image_Format_A2R10G10B10_USCALED_PACK32;
+    case 62: return Image_Format_A2R10G10B10_UINT_PACK32;
+    case 64: return Image_Format_A2B10G10R10_UNORM_PACK32;
+    case 66: return Image_Format_A2B10G10R10_USCALED_PACK32;
+    case 68: return Image_Format_A2B10G10R10_UINT_PACK32;
+    case VK_FORMAT_PVRTC1_2BPP_UNORM_BLOCK_IMG: return Image_Format_PVR_2BPP_BLOCK;
+    case VK_FORMAT_PVRTC1_4BPP_UNORM_BLOCK_IMG: return Image_Format_PVR_4BPP_BLOCK;
+    case VK_FORMAT_PVRTC1_2BPP_SRGB_BLOCK_IMG: return Image_Format_PVR_2BPP_SRGB_BLOCK;
+    case VK_FORMAT_PVRTC1_4BPP_SRGB_BLOCK_IMG: return Image_Format_PVR_4BPP_SRGB_BLOCK;
+    default: break;
+  }
+  if (vkFormat <= (uint32_t) Image_Format_A8B8G8R8_SRGB_PACK32) { return (Image_Format) vkFormat; }
+  if (vkFormat >= 70 && vkFormat <= (uint32_t) Image_Format_BC7_SRGB_BLOCK + 6) {
+    return (Image_Format) (vkFormat - 6);
+  }
+  return Image_Format_UNDEFINED;
+}
+
+} // end Image namespace
+
+#endif //WYRD_IMAGE_KTX2_HPP
@@ -2,15 +2,23 @@
 #include "core/logger.h"
 #include "math/math.h"
 #include "stb/stb_image.h"
-#include "core/quick_hash.hpp"
+#include "tinystl/vector.h"
 #include "vfile/vfile.hpp"
 #include "image/format.h"
 #include "image/format_cracker.h"
 #include "image/image.h"
 #include "image/utils.h"
+#include "image/io.h"
+#include "os/file.h"
+#include "os/atomics.h"
+#include "os/threadpool.h"
 #include "syoyo/tiny_exr.hpp"
 #include "dds.hpp"
+#include "ktx2.hpp"
+#include "miniz/miniz.h"
+#include "lz4/lz4.h"
 #include <float.h>
+#include <stddef.h>
 
 // Describes the header of a PVR header-texture
 typedef struct PVR_Header_Texture_TAG {
@@ -33,23 +41,38 @@ const unsigned int gPvrtexV3HeaderVersion = 0x03525650;
 
 // Load Image Data form mData functions
 
-EXTERN_C Image_ImageHeader *Image_LoadDDS(VFile_Handle handle) {
+namespace {
+
+struct DDSInfo {
+  uint32_t width;
+  uint32_t height;
+  uint32_t depth;
+  uint32_t slices;
+  uint32_t mipMapCount;
+  Image_Format format;
+  bool cubemap;
+};
+
+// reads the DDS header(s) leaving the file at the start of the pixel data
+bool ReadDDSInfo(VFile::File *file, DDSInfo *info) {
   using namespace Image;
   DDSHeader header;
 
-  VFile::File *file = VFile::File::FromHandle(handle);
-  file->Read(&header, sizeof(header));
+  if (file->Read(&header, sizeof(header)) != sizeof(header)) {
+    return false;
+  }
 
   if (header.mDWMagic != MAKE_CHAR4('D', 'D', 'S', ' ')) {
-    return nullptr;
+    return false;
   }
 
-  Image_ImageHeader *image = nullptr;
   Image_Format format = Image_Format_UNDEFINED;
+  uint32_t arraySize = 1;
 
   if (header.mPixelFormat.mDWFourCC == MAKE_CHAR4('D', 'X', '1', '0')) {
     DDSHeaderDX10 dx10Header;
     file->Read(&dx10Header, sizeof(dx10Header));
+    arraySize = dx10Header.mArraySize ? dx10Header.mArraySize : 1;
 
     switch (dx10Header.mDXGIFormat) {
       case DDS_DXGI_FORMAT_R32G32B32A32_FLOAT: format = Image_Format_R32G32B32A32_SFLOAT;
@@ -144,7 +167,7 @@ EXTERN_C Image_ImageHeader *Image_LoadDDS(VFile_Handle handle) {
         break;
       case DDS_DXGI_FORMAT_BC1_UNORM: format = Image_Format_BC1_RGB_UNORM_BLOCK;
         break;
-      case DDS_DXGI_FORMAT_BC1_UNORM_SRGB: format = Image_Format_BC1_RGBA_UNORM_BLOCK;
+      case DDS_DXGI_FORMAT_BC1_UNORM_SRGB: format = Image_Format_BC1_RGBA_SRGB_BLOCK;
         break;
       case DDS_DXGI_FORMAT_BC2_UNORM: format = Image_Format_BC2_UNORM_BLOCK;
         break;
@@ -152,7 +175,7 @@ EXTERN_C Image_ImageHeader *Image_LoadDDS(VFile_Handle handle) {
         break;
       case DDS_DXGI_FORMAT_BC3_UNORM: format = Image_Format_BC3_UNORM_BLOCK;
         break;
-      case DDS_DXGI_FORMAT_BC3_UNORM_SRGB: format = Image_Format_BC2_SRGB_BLOCK;
+      case DDS_DXGI_FORMAT_BC3_UNORM_SRGB: format = Image_Format_BC3_SRGB_BLOCK;
         break;
       case DDS_DXGI_FORMAT_BC4_UNORM: format = Image_Format_BC4_UNORM_BLOCK;
         break;
@@ -186,7 +209,7 @@ EXTERN_C Image_ImageHeader *Image_LoadDDS(VFile_Handle handle) {
         break;
       case DDS_DXGI_FORMAT_B4G4R4A4_UNORM: format = Image_Format_B4G4R4A4_UNORM_PACK16;
         break;
-      default: return nullptr;
+      default: return false;
     }
   } else {
     switch (header.mPixelFormat.mDWFourCC) {
@@ -213,17 +236,19 @@ EXTERN_C Image_ImageHeader *Image_LoadDDS(VFile_Handle handle) {
         break;
       case MAKE_CHAR4('A', 'T', 'C', 'I'): format = ATCI;
         break;
-      case MAKE_CHAR4('A', 'T', 'I', '1'): format = ATI1N;
-        break;
-      case MAKE_CHAR4('A', 'T', 'I', '2'): format = ATI2N;
-        break;
       case MAKE_CHAR4('E', 'T', 'C', ' '): format = ETC1;
         break; */ //TODO
       case MAKE_CHAR4('D', 'X', 'T', '1'): format = Image_Format_BC1_RGBA_UNORM_BLOCK;
         break;
       case MAKE_CHAR4('D', 'X', 'T', '3'): format = Image_Format_BC2_UNORM_BLOCK;
         break;
-      case MAKE_CHAR4('D', 'X', 'T', '5'): format = Image_Format_BC5_UNORM_BLOCK;
+      case MAKE_CHAR4('D', 'X', 'T', '5'): format = Image_Format_BC3_UNORM_BLOCK;
+        break;
+      case MAKE_CHAR4('A', 'T', 'I', '1'):
+      case MAKE_CHAR4('B', 'C', '4', 'U'): format = Image_Format_BC4_UNORM_BLOCK;
+        break;
+      case MAKE_CHAR4('A', 'T', 'I', '2'):
+      case MAKE_CHAR4('B', 'C', '5', 'U'): format = Image_Format_BC5_UNORM_BLOCK;
         break;
       default:
         switch (header.mPixelFormat.mDWRGBBitCount) {
@@ -246,48 +271,202 @@ EXTERN_C Image_ImageHeader *Image_LoadDDS(VFile_Handle handle) {
                      Image_Format_A2R10G10B10_UNORM_PACK32 :
                      Image_Format_R8G8B8A8_UNORM;
             break;
-          default:return nullptr;
+          default:return false;
         }
     }
   }
-  if (format == Image_Format_UNDEFINED) { return nullptr; }
+  if (format == Image_Format_UNDEFINED) { return false; }
+
+  info->width = header.mDWWidth;
+  info->height = header.mDWHeight;
+  info->depth = (header.mDWDepth == 0) ? 1 : header.mDWDepth;
+  info->slices = arraySize * ((header.mCaps.mDWCaps2 & DDSCAPS2_CUBEMAP) ? 6 : 1);
+  info->mipMapCount = (header.mDWMipMapCount == 0) ? 1 : header.mDWMipMapCount;
+  info->format = format;
+  info->cubemap = (header.mCaps.mDWCaps2 & DDSCAPS2_CUBEMAP) != 0;
+  return true;
+}
+
+// bytes a mip level takes in a DDS file, block compressed levels are
+// rounded up to whole blocks
+size_t DDSLevelByteCount(Image_Format format, uint32_t width, uint32_t height, uint32_t depth) {
+  if (Image_Format_IsCompressed(format)) {
+    uint32_t const bw = Image_Format_WidthOfBlock(format);
+    uint32_t const bh = Image_Format_HeightOfBlock(format);
+    size_t const blockBytes = (Image_Format_BitWidth(format) * bw * bh) / 8;
+    return ((width + bw - 1) / bw) * ((height + bh - 1) / bh) * depth * blockBytes;
+  }
+  return ((size_t) width * height * depth * Image_Format_BitWidth(format)) / 8;
+}
 
-  image = Image_Create(header.mDWWidth,
-                       header.mDWHeight,
-                       (header.mDWDepth == 0) ? 1 : header.mDWDepth,
-                       (header.mCaps.mDWCaps2 & DDSCAPS2_CUBEMAP) ? 6 : 1,
-                       format);
-  file->Read(Image_RawDataPtr(image), Image_ByteCountOf(image));
+// bytes a mip level takes in a PVR file, PVRTC data is never smaller than
+// 2x2 blocks (16x8 pixels for 2bpp and 8x8 for 4bpp)
+size_t PVRLevelByteCount(Image_Format format, uint32_t width, uint32_t height, uint32_t depth) {
+  uint32_t const bpp = Image_Format_BitWidth(format);
+  uint32_t const minWidth = (bpp == 2) ? 16 : 8;
+  width = width < minWidth ? minWidth : width;
+  height = height < 8 ? 8 : height;
+  return ((size_t) width * height * depth * bpp) / 8;
+}
+
+typedef size_t (*LevelByteCountFunc)(Image_Format format, uint32_t width, uint32_t height, uint32_t depth);
 
-  if (header.mDWMipMapCount != 1) {
-    Image_CreateMipMapChain(image, true);
+uint32_t MipDim(uint32_t dim, uint32_t level) {
+  uint32_t const d = dim >> level;
+  return d ? d : 1;
+}
+
+// how many levels can be images. Block compressed images can't be smaller
+// than a block or have partial or padded blocks, which the tail of a mip
+// chain in a file often does, so the chain stops there
+uint32_t UsableMipCount(Image_Format format,
+                        uint32_t width, uint32_t height, uint32_t depth,
+                        uint32_t mipMapCount,
+                        LevelByteCountFunc levelByteCount) {
+  for (uint32_t level = 0; level < mipMapCount; ++level) {
+    uint32_t const w = MipDim(width, level);
+    uint32_t const h = MipDim(height, level);
+    uint32_t const d = MipDim(depth, level);
+    if (Image_Format_IsCompressed(format) && (w < 4 || h < 4)) {
+      return level;
+    }
+    Image_ImageHeader header;
+    Image_FillHeader(w, h, d, 1, format, &header);
+    if (levelByteCount(format, w, h, d) != Image_ByteCountOf(&header)) {
+      return level;
+    }
+  }
+  return mipMapCount;
+}
+
+// when not even level 0 is usable the range check would blame the request,
+// so say what is actually wrong with the file
+void LogUnusableLevel0(char const *container, Image_Format format, uint32_t width, uint32_t height) {
+  if (Image_Format_IsCompressed(format)) {
+    LOGERRORF("%s level 0 %ux%u isn't a whole number of %s blocks",
+              container, width, height, Image_Format_Name(format));
+  } else {
+    LOGERRORF("%s level 0 %ux%u of %s doesn't match its stored size",
+              container, width, height, Image_Format_Name(format));
   }
+}
 
-  /*TODO Deano use DDS mipmaps if store in file!
-  size_t size = Image_BytesForImageAndMipMaps(image);
-  if (header.mCaps.mDWCaps2 & DDSCAPS2_CUBEMAP) {
-    for (int face = 0; face < 6; face++) {
-      for (uint32_t mipMapLevel = 0; mipMapLevel < mMipMapCount; mipMapLevel++) {
-        int faceSize = GetMipMappedSize(mipMapLevel, 1) / 6;
-        unsigned char *src = GetPixels(pData, mipMapLevel) + face * faceSize;
+// offset of a level from the start of a slice's mip chain, the offset of
+// level mipMapCount is the size of the whole chain
+size_t DDSLevelOffset(DDSInfo const *info, uint32_t level) {
+  size_t offset = 0;
+  for (uint32_t i = 0; i < level; ++i) {
+    offset += DDSLevelByteCount(info->format,
+                                MipDim(info->width, i),
+                                MipDim(info->height, i),
+                                MipDim(info->depth, i));
+  }
+  return offset;
+}
+
+void AppendMip(Image_ImageHeader **image, Image_ImageHeader **prev, Image_ImageHeader *level) {
+  if (*prev) {
+    (*prev)->nextImage = level;
+    (*prev)->nextType = Image_IT_MipMaps;
+  } else {
+    *image = level;
+  }
+  *prev = level;
+}
+
+// clamps a requested range to what exists, false if it starts past the end
+bool ClampRange(uint32_t first, uint32_t *count, uint32_t available) {
+  if (first >= available || *count == 0) {
+    return false;
+  }
+  if (*count > available - first) {
+    *count = available - first;
+  }
+  return true;
+}
+
+struct MappedFile {
+  void const *memory;
+  size_t size;
+  volatile uint32_t refCount;
+};
+
+void MappedFileRelease(void *user) {
+  auto *mapped = (MappedFile *) user;
+  if (Os_AtomicAdd32(&mapped->refCount, (uint32_t) -1) == 1) {
+    Os_FileUnmap(mapped->memory, mapped->size);
+    free(mapped);
+  }
+}
 
-        file->Read(src, faceSize);
-        //MemFopen::FileRead(src, 1, faceSize, file);
+// builds the mip chain out of the mapping. DDS files store each slice's
+// whole mip chain in turn, a level is only contiguous (as an image needs) if
+// there is one slice or one level, those point straight at the mapping.
+// Anything else is copied out of the mapping into a packed chain
+Image_ImageHeader *DDSLevelsFromMapping(DDSInfo const *info, MappedFile *mapped, size_t dataOffset) {
+  uint8_t const *data = ((uint8_t const *) mapped->memory) + dataOffset;
+
+  size_t const sliceStride = DDSLevelOffset(info, info->mipMapCount);
+  if (dataOffset + sliceStride * info->slices > mapped->size) {
+    LOGERROR("DDS file is smaller than its header says");
+    return nullptr;
+  }
+
+  bool const zeroCopy = info->slices == 1 || info->mipMapCount == 1;
+  uint32_t const levelCount = UsableMipCount(info->format, info->width, info->height, info->depth,
+                                             info->mipMapCount, &DDSLevelByteCount);
+
+  if (!zeroCopy) {
+    Image_ImageHeader *image = Image_CreatePackedMipMaps(info->width, info->height, info->depth,
+                                                         info->slices, info->format, levelCount, 0);
+    if (!image) { return nullptr; }
+    Image_ImageHeader *levelImage = image;
+    for (uint32_t level = 0; level < levelCount; ++level, levelImage = levelImage->nextImage) {
+      size_t const levelOffset = DDSLevelOffset(info, level);
+      uint8_t *dst = (uint8_t *) Image_RawDataPtr(levelImage);
+      for (uint32_t slice = 0; slice < info->slices; ++slice) {
+        memcpy(dst + slice * Image_ByteCountPerSliceOf(levelImage),
+               data + slice * sliceStride + levelOffset,
+               Image_ByteCountPerSliceOf(levelImage));
       }
     }
-  } else {
-    file->Read(pData, size);
+    return image;
   }
 
-  if ((mFormat == RGB8 || mFormat == RGBA8) && header.mPixelFormat.mDWBBitMask == 0xFF) {
-    int nChannels = GetChannelCount(mFormat);
-    swapPixelChannels(pData, size / nChannels, nChannels, 0, 2);
+  Image_ImageHeader *image = nullptr;
+  Image_ImageHeader *prev = nullptr;
+  for (uint32_t level = 0; level < levelCount; ++level) {
+    Image_ImageHeader *levelImage = Image_CreateExternal(MipDim(info->width, level),
+                                                         MipDim(info->height, level),
+                                                         MipDim(info->depth, level),
+                                                         info->slices, info->format,
+                                                         (void *) (data + DDSLevelOffset(info, level)),
+                                                         &MappedFileRelease, mapped);
+    if (!levelImage) {
+      if (image) { Image_Destroy(image); }
+      return nullptr;
+    }
+    Os_AtomicAdd32(&mapped->refCount, 1);
+    AppendMip(&image, &prev, levelImage);
   }
-*/
   return image;
 }
 
-EXTERN_C Image_ImageHeader *Image_LoadPVR(VFile_Handle handle) {
+struct PVRInfo {
+  uint32_t width;
+  uint32_t height;
+  uint32_t depth;
+  uint32_t slices;
+  uint32_t mipMapCount;
+  Image_Format format;
+};
+
+// the header is 52 bytes on disk, the struct is padded to 56
+size_t const PVRHeaderSize = offsetof(PVR_Texture_Header, mMetaDataSize) + sizeof(uint32_t);
+
+// reads the PVR header and skips the meta data, leaving the file at the
+// start of the pixel data
+bool ReadPVRInfo(VFile::File *file, PVRInfo *info) {
   // TODO: Image
   // - no support for PVRTC2 at the moment since it isn't supported on iOS devices.
   // - only new PVR header V3 is supported at the moment.  Should we add legacy for V2 and V1?
@@ -298,60 +477,431 @@ EXTERN_C Image_ImageHeader *Image_LoadPVR(VFile_Handle handle) {
   // - it's assumed that the texture is already twiddled (ie. Morton).  This should always be the case for PVRTC V3.
 
   PVR_Texture_Header header;
-  VFile::File *file = VFile::File::FromHandle(handle);
-  file->Read(&header, sizeof(header));
+  if (file->Read(&header, PVRHeaderSize) != PVRHeaderSize) {
+    return false;
+  }
 
   if (header.mVersion != gPvrtexV3HeaderVersion) {
     LOGERRORF("Load PVR failed: Not a valid PVR V3 header.");
-    return nullptr;
+    return false;
   }
 
   if (header.mPixelFormat > 3) {
     LOGERRORF("Load PVR failed: Not a supported PVR pixel format.  Only PVRTC is supported at the moment.");
-    return nullptr;
+    return false;
   }
 
   if (header.mNumSurfaces > 1 && header.mNumFaces > 1) {
     LOGERRORF("Load PVR failed: Loading arrays of cubemaps isn't supported.");
-    return nullptr;
+    return false;
   }
 
-  uint32_t width = header.mWidth;
-  uint32_t height = header.mHeight;
-  uint32_t depth = header.mDepth;
-  uint32_t slices = header.mNumSurfaces * header.mNumFaces;
-  uint32_t mipMapCount = header.mNumMipMaps;
-  Image_Format format = Image_Format_UNDEFINED;
-
   bool isSrgb = (header.mColorSpace == 1);
 
   switch (header.mPixelFormat) {
-    case 0:format = isSrgb ? Image_Format_PVR_2BPP_SRGB_BLOCK : Image_Format_PVR_2BPP_BLOCK;
+    case 0:info->format = isSrgb ? Image_Format_PVR_2BPP_SRGB_BLOCK : Image_Format_PVR_2BPP_BLOCK;
       break;
-    case 1:format = isSrgb ? Image_Format_PVR_2BPPA_SRGB_BLOCK : Image_Format_PVR_2BPPA_BLOCK;
+    case 1:info->format = isSrgb ? Image_Format_PVR_2BPPA_SRGB_BLOCK : Image_Format_PVR_2BPPA_BLOCK;
       break;
-    case 2:format = isSrgb ? Image_Format_PVR_4BPP_SRGB_BLOCK : Image_Format_PVR_4BPP_BLOCK;
+    case 2:info->format = isSrgb ? Image_Format_PVR_4BPP_SRGB_BLOCK : Image_Format_PVR_4BPP_BLOCK;
       break;
-    case 3:format = isSrgb ? Image_Format_PVR_4BPPA_SRGB_BLOCK : Image_Format_PVR_4BPPA_BLOCK;
+    case 3:info->format = isSrgb ? Image_Format_PVR_4BPPA_SRGB_BLOCK : Image_Format_PVR_4BPPA_BLOCK;
       break;
     default:    // NOT SUPPORTED
       LOGERRORF("Load PVR failed: pixel type not supported. ");
-      return nullptr;
+      return false;
   }
 
-  // TODO Dean load mipmaps
-  // TODO read pvr data so no mipmaps at all for now :(
+  info->width = header.mWidth;
+  info->height = header.mHeight;
+  info->depth = header.mDepth ? header.mDepth : 1;
+  info->slices = (header.mNumSurfaces ? header.mNumSurfaces : 1) * (header.mNumFaces ? header.mNumFaces : 1);
+  info->mipMapCount = header.mNumMipMaps ? header.mNumMipMaps : 1;
 
   // skip the meta data
   file->Seek(header.mMetaDataSize, VFile_SD_Current);
+  return true;
+}
 
-  // Create and extract the pixel data
-  Image_ImageHeader *image = Image_Create(width, height, depth, slices, format);
+} // end anon namespace
+
+EXTERN_C Image_ImageHeader *Image_LoadDDS(VFile_Handle handle) {
+  return Image_LoadDDSRange(handle, 0, ~0u, 0, ~0u);
+}
+
+EXTERN_C Image_ImageHeader *Image_LoadDDSRange(VFile_Handle handle,
+                                               uint32_t firstMip, uint32_t mipCount,
+                                               uint32_t firstSlice, uint32_t sliceCount) {
+  DDSInfo info;
+  VFile::File *file = VFile::File::FromHandle(handle);
+  if (!ReadDDSInfo(file, &info)) {
+    return nullptr;
+  }
+  int64_t const dataOffset = file->Tell();
+
+  uint32_t const levelCount = UsableMipCount(info.format, info.width, info.height, info.depth,
+                                             info.mipMapCount, &DDSLevelByteCount);
+  if (levelCount == 0) {
+    LogUnusableLevel0("DDS", info.format, info.width, info.height);
+    return nullptr;
+  }
+  if (!ClampRange(firstMip, &mipCount, levelCount) ||
+      !ClampRange(firstSlice, &sliceCount, info.slices)) {
+    LOGERROR("Requested DDS mip levels or slices aren't in the file");
+    return nullptr;
+  }
+
+  // all the levels go into one packed allocation, each slice has its own
+  // mip chain in the file so each subresource is a seek + read
+  size_t const sliceStride = DDSLevelOffset(&info, info.mipMapCount);
+  Image_ImageHeader *image = Image_CreatePackedMipMaps(MipDim(info.width, firstMip),
+                                                       MipDim(info.height, firstMip),
+                                                       MipDim(info.depth, firstMip),
+                                                       sliceCount,
+                                                       info.format,
+                                                       mipCount,
+                                                       0);
+  if (!image) {
+    return nullptr;
+  }
+  Image_ImageHeader *levelImage = image;
+  for (uint32_t level = firstMip; level < firstMip + mipCount; ++level, levelImage = levelImage->nextImage) {
+    size_t const sliceBytes = Image_ByteCountPerSliceOf(levelImage);
+    size_t const levelOffset = DDSLevelOffset(&info, level);
+    uint8_t *dst = (uint8_t *) Image_RawDataPtr(levelImage);
+    for (uint32_t slice = 0; slice < sliceCount; ++slice) {
+      file->Seek(dataOffset + (firstSlice + slice) * sliceStride + levelOffset, VFile_SD_Begin);
+      if (file->Read(dst + slice * sliceBytes, sliceBytes) != sliceBytes) {
+        LOGERROR("DDS file is smaller than its header says");
+        Image_Destroy(image);
+        return nullptr;
+      }
+    }
+  }
 
-  file->Read(Image_RawDataPtr(image), Image_ByteCountOf(image));
-  // TODO we should skip to the end here, but we
-  // don't have pack or streams files so no harm yet
+  // only still a cubemap if whole cubes were loaded
+  if (info.cubemap && (firstSlice % 6) == 0 && (sliceCount % 6) == 0) {
+    image->flags |= Image_Flag_Cubemap;
+  }
+  return image;
+}
+
+EXTERN_C Image_ImageHeader *Image_LoadDDSMapped(char const *filename) {
+  ASSERT(filename);
+  size_t size = 0;
+  void const *memory = Os_FileMapReadOnly(filename, &size);
+  if (!memory) {
+    return nullptr;
+  }
+
+  // the loader holds a reference until all the levels have theirs
+  auto *mapped = (MappedFile *) malloc(sizeof(MappedFile));
+  if (!mapped) {
+    Os_FileUnmap(memory, size);
+    return nullptr;
+  }
+  mapped->memory = memory;
+  mapped->size = size;
+  mapped->refCount = 1;
+
+  Image_ImageHeader *image = nullptr;
+  VFile_Handle handle = VFile_FromMemory((void *) memory, size, false);
+  DDSInfo info;
+  if (ReadDDSInfo(VFile::File::FromHandle(handle), &info)) {
+    image = DDSLevelsFromMapping(&info, mapped, (size_t) VFile_Tell(handle));
+    if (image && info.cubemap) { image->flags |= Image_Flag_Cubemap; }
+  }
+  VFile_Close(handle);
 
+  MappedFileRelease(mapped);
+  return image;
+}
+
+EXTERN_C Image_ImageHeader *Image_LoadPVR(VFile_Handle handle) {
+  return Image_LoadPVRRange(handle, 0, ~0u, 0, ~0u);
+}
+
+EXTERN_C Image_ImageHeader *Image_LoadPVRRange(VFile_Handle handle,
+                                               uint32_t firstMip, uint32_t mipCount,
+                                               uint32_t firstSlice, uint32_t sliceCount) {
+  PVRInfo info;
+  VFile::File *file = VFile::File::FromHandle(handle);
+  if (!ReadPVRInfo(file, &info)) {
+    return nullptr;
+  }
+  int64_t const dataOffset = file->Tell();
+
+  uint32_t const levelCount = UsableMipCount(info.format, info.width, info.height, info.depth,
+                                             info.mipMapCount, &PVRLevelByteCount);
+  if (levelCount == 0) {
+    LogUnusableLevel0("PVR", info.format, info.width, info.height);
+    return nullptr;
+  }
+  if (!ClampRange(firstMip, &mipCount, levelCount) ||
+      !ClampRange(firstSlice, &sliceCount, info.slices)) {
+    LOGERROR("Requested PVR mip levels or slices aren't in the file");
+    return nullptr;
+  }
+
+  // PVR stores all the slices of a level together, in the same order as an
+  // image so a range of slices is a single seek + read
+  size_t levelOffset = 0;
+  for (uint32_t level = 0; level < firstMip; ++level) {
+    levelOffset += PVRLevelByteCount(info.format,
+                                     MipDim(info.width, level),
+                                     MipDim(info.height, level),
+                                     MipDim(info.depth, level)) * info.slices;
+  }
+
+  Image_ImageHeader *image = nullptr;
+  Image_ImageHeader *prev = nullptr;
+  for (uint32_t level = firstMip; level < firstMip + mipCount; ++level) {
+    Image_ImageHeader *levelImage = Image_CreateNoClear(MipDim(info.width, level),
+                                                        MipDim(info.height, level),
+                                                        MipDim(info.depth, level),
+                                                        sliceCount,
+                                                        info.format);
+    if (!levelImage) {
+      if (image) { Image_Destroy(image); }
+      return nullptr;
+    }
+    AppendMip(&image, &prev, levelImage);
+
+    size_t const sliceBytes = Image_ByteCountPerSliceOf(levelImage);
+    file->Seek(dataOffset + levelOffset + firstSlice * sliceBytes, VFile_SD_Begin);
+    if (file->Read(Image_RawDataPtr(levelImage), Image_ByteCountOf(levelImage)) != Image_ByteCountOf(levelImage)) {
+      LOGERROR("PVR file is smaller than its header says");
+      Image_Destroy(image);
+      return nullptr;
+    }
+    levelOffset += sliceBytes * info.slices;
+  }
+
+  return image;
+}
+
+namespace {
+
+// a KTX2 level can't have more mips than there are bits in a dimension
+#define KTX2_MAX_LEVELS 32
+
+struct KTX2Info {
+  Image::KTX2Header header;
+  uint32_t width;
+  uint32_t height;
+  uint32_t depth;
+  uint32_t slices;
+  uint32_t levelCount;
+  Image_Format format;
+};
+
+// reads and checks the KTX2 header, leaving the file at the level index
+bool ReadKTX2Info(VFile::File *file, KTX2Info *info) {
+  using namespace Image;
+  KTX2Header &header = info->header;
+  if (file->Read(&header, sizeof(header)) != sizeof(header) ||
+      memcmp(header.identifier, KTX2Identifier, sizeof(KTX2Identifier)) != 0) {
+    LOGERROR("Not a KTX2 file");
+    return false;
+  }
+
+  info->format = KTX2FormatOf(header.vkFormat);
+  if (info->format == Image_Format_UNDEFINED) {
+    LOGERRORF("KTX2 vkFormat %u isn't supported", header.vkFormat);
+    return false;
+  }
+  if (header.supercompressionScheme != KTX2_SUPERCOMPRESSION_NONE &&
+      header.supercompressionScheme != KTX2_SUPERCOMPRESSION_ZLIB &&
+      header.supercompressionScheme != KTX2_SUPERCOMPRESSION_WYRD_LZ4) {
+    LOGERRORF("KTX2 supercompression scheme %u isn't supported", header.supercompressionScheme);
+    return false;
+  }
+  if ((header.faceCount != 1 && header.faceCount != 6) || header.levelCount > KTX2_MAX_LEVELS) {
+    LOGERROR("KTX2 header is invalid");
+    return false;
+  }
+
+  // 0 means not present (or for levels, generate them), either way there is one
+  info->width = header.pixelWidth;
+  info->height = header.pixelHeight ? header.pixelHeight : 1;
+  info->depth = header.pixelDepth ? header.pixelDepth : 1;
+  info->slices = (header.layerCount ? header.layerCount : 1) * header.faceCount;
+  info->levelCount = header.levelCount ? header.levelCount : 1;
+  return true;
+}
+
+// the vkFormat says how to read the texels, but the data format descriptor
+// still has to be a well formed basic descriptor whose samples fit the block
+bool CheckKTX2DFD(VFile::File *file, Image::KTX2Header const &header) {
+  using namespace Image;
+  uint32_t dfd[1 + (KTX2_DFD_BASIC_BLOCK_SIZE + KTX2_DFD_SAMPLE_SIZE * KTX2_DFD_MAX_SAMPLES) / 4];
+  uint32_t const minSize = 4 + KTX2_DFD_BASIC_BLOCK_SIZE + KTX2_DFD_SAMPLE_SIZE;
+  if (header.dfdByteLength < minSize || header.dfdByteLength > sizeof(dfd) ||
+      !file->Seek((int64_t) header.dfdByteOffset, VFile_SD_Begin) ||
+      file->Read(dfd, header.dfdByteLength) != header.dfdByteLength) {
+    LOGERROR("KTX2 data format descriptor is missing or too large");
+    return false;
+  }
+
+  uint32_t const blockSize = dfd[2] >> 16;
+  if (dfd[0] != header.dfdByteLength || dfd[1] != 0 || (dfd[2] & 0xFFFF) != 2 ||
+      blockSize + 4 > dfd[0] || blockSize < KTX2_DFD_BASIC_BLOCK_SIZE + KTX2_DFD_SAMPLE_SIZE ||
+      (blockSize - KTX2_DFD_BASIC_BLOCK_SIZE) % KTX2_DFD_SAMPLE_SIZE != 0) {
+    LOGERROR("KTX2 data format descriptor isn't a basic descriptor with samples");
+    return false;
+  }
+
+  // bytesPlane0 is 0 when supercompressed
+  uint32_t const blockBits = (dfd[5] & 0xFF) * 8;
+  uint32_t const sampleCount = (blockSize - KTX2_DFD_BASIC_BLOCK_SIZE) / KTX2_DFD_SAMPLE_SIZE;
+  for (uint32_t i = 0; i < sampleCount; ++i) {
+    uint32_t const *sample = dfd + 7 + i * 4;
+    uint32_t const bitOffset = sample[0] & 0xFFFF;
+    uint32_t const bitLength = ((sample[0] >> 16) & 0xFF) + 1;
+    if (blockBits != 0 && bitOffset + bitLength > blockBits) {
+      LOGERROR("KTX2 data format descriptor sample is outside the texel block");
+      return false;
+    }
+  }
+  return true;
+}
+
+struct KTX2Level {
+  Image_ImageHeader *image;
+  uint8_t *packed;
+  size_t packedSize;
+  bool ok;
+};
+
+struct KTX2DecompressJob {
+  KTX2Level *levels;
+  uint32_t supercompression;
+};
+
+// each level is compressed on its own so they can be unpacked in parallel
+void KTX2DecompressLevel(void *data, uint32_t index) {
+  KTX2DecompressJob const *job = (KTX2DecompressJob const *) data;
+  KTX2Level *level = job->levels + index;
+  size_t const size = Image_ByteCountOf(level->image);
+
+  if (job->supercompression == KTX2_SUPERCOMPRESSION_ZLIB) {
+    mz_ulong unpackedSize = (mz_ulong) size;
+    level->ok = mz_uncompress((unsigned char *) Image_RawDataPtr(level->image), &unpackedSize,
+                              level->packed, (mz_ulong) level->packedSize) == MZ_OK &&
+        unpackedSize == size;
+  } else {
+    level->ok = size <= LZ4_MAX_INPUT_SIZE &&
+        LZ4_decompress_safe((char const *) level->packed, (char *) Image_RawDataPtr(level->image),
+                            (int) level->packedSize, (int) size) == (int) size;
+  }
+}
+
+void KTX2FreeLevels(KTX2Level *levels, uint32_t count) {
+  for (uint32_t i = 0; i < count; ++i) {
+    free(levels[i].packed);
+  }
+}
+
+} // end anon namespace
+
+EXTERN_C Image_ImageHeader *Image_LoadKTX2(VFile_Handle handle) {
+  return Image_LoadKTX2Range(handle, 0, ~0u);
+}
+
+EXTERN_C Image_ImageHeader *Image_LoadKTX2Range(VFile_Handle handle, uint32_t firstMip, uint32_t mipCount) {
+  using namespace Image;
+
+  VFile::File *file = VFile::File::FromHandle(handle);
+  KTX2Info info;
+  if (!ReadKTX2Info(file, &info)) {
+    return nullptr;
+  }
+  KTX2Header const &header = info.header;
+  Image_Format const format = info.format;
+  uint32_t const width = info.width;
+  uint32_t const height = info.height;
+  uint32_t const depth = info.depth;
+  uint32_t const slices = info.slices;
+  uint32_t const fileLevelCount = info.levelCount;
+
+  KTX2LevelIndex index[KTX2_MAX_LEVELS];
+  if (file->Read(index, sizeof(KTX2LevelIndex) * fileLevelCount) != sizeof(KTX2LevelIndex) * fileLevelCount) {
+    LOGERROR("KTX2 file is smaller than its header says");
+    return nullptr;
+  }
+  if (!CheckKTX2DFD(file, header)) {
+    return nullptr;
+  }
+
+  uint32_t const levelCount = UsableMipCount(format, width, height, depth, fileLevelCount, &DDSLevelByteCount);
+  if (!ClampRange(firstMip, &mipCount, levelCount)) {
+    LOGERROR("Requested KTX2 mip levels aren't in the file");
+    return nullptr;
+  }
+
+  KTX2Level levels[KTX2_MAX_LEVELS];
+  memset(levels, 0, sizeof(levels));
+  Image_ImageHeader *image = nullptr;
+  Image_ImageHeader *prev = nullptr;
+  for (uint32_t i = 0; i < mipCount; ++i) {
+    uint32_t const level = firstMip + i;
+    Image_ImageHeader *levelImage = Image_CreateNoClear(MipDim(width, level),
+                                                        MipDim(height, level),
+                                                        MipDim(depth, level),
+                                                        slices,
+                                                        format);
+    if (!levelImage) {
+      if (image) { Image_Destroy(image); }
+      return nullptr;
+    }
+    AppendMip(&image, &prev, levelImage);
+    levels[i].image = levelImage;
+    if (index[level].uncompressedByteLength != Image_ByteCountOf(levelImage)) {
+      LOGERROR("KTX2 level size doesn't match its format");
+      Image_Destroy(image);
+      return nullptr;
+    }
+  }
+
+  // the smallest level is first in the file, so read backwards to keep the
+  // reads going forward. Only the reads are serial
+  bool const compressed = header.supercompressionScheme != KTX2_SUPERCOMPRESSION_NONE;
+  bool ok = true;
+  for (uint32_t i = mipCount; i-- > 0 && ok;) {
+    KTX2LevelIndex const &entry = index[firstMip + i];
+    KTX2Level &level = levels[i];
+    void *dst = Image_RawDataPtr(level.image);
+    if (compressed) {
+      level.packedSize = (size_t) entry.byteLength;
+      level.packed = (uint8_t *) malloc(level.packedSize);
+      dst = level.packed;
+    } else if (entry.byteLength != entry.uncompressedByteLength) {
+      ok = false;
+      break;
+    }
+    ok = dst &&
+        file->Seek((int64_t) entry.byteOffset, VFile_SD_Begin) &&
+        file->Read(dst, (size_t) entry.byteLength) == entry.byteLength;
+  }
+
+  if (ok && compressed) {
+    KTX2DecompressJob job = {levels, header.supercompressionScheme};
+    Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &KTX2DecompressLevel, &job, mipCount);
+    for (uint32_t i = 0; i < mipCount; ++i) {
+      ok = ok && levels[i].ok;
+    }
+  }
+  KTX2FreeLevels(levels, mipCount);
+
+  if (!ok) {
+    LOGERROR("KTX2 level data is truncated or corrupt");
+    Image_Destroy(image);
+    return nullptr;
+  }
+
+  if (header.faceCount == 6) {
+    image->flags |= Image_Flag_Cubemap;
+  }
   return image;
 }
 
@@ -377,11 +927,14 @@ EXTERN_C Image_ImageHeader *Image_LoadLDR(VFile_Handle handle) {
   };
 
   int w = 0, h = 0, cmp = 0, requiredCmp = 0;
+  int64_t const start = VFile_Tell(handle);
   stbi_info_from_callbacks(&callbacks, handle, &w, &h, &cmp);
 
   if (w == 0 || h == 0 || cmp == 0) {
     return nullptr;
   }
+  // info consumes the header, the load needs to see it again
+  VFile_Seek(handle, start, VFile_SD_Begin);
 
   requiredCmp = cmp;
   if (cmp == 3) {
@@ -425,11 +978,14 @@ EXTERN_C Image_ImageHeader *Image_LoadHDR(VFile_Handle handle) {
   };
 
   int w = 0, h = 0, cmp = 0, requiredCmp = 0;
+  int64_t const start = VFile_Tell(handle);
   stbi_info_from_callbacks(&callbacks, handle, &w, &h, &cmp);
 
   if (w == 0 || h == 0 || cmp == 0) {
     return nullptr;
   }
+  // info consumes the header, the load needs to see it again
+  VFile_Seek(handle, start, VFile_SD_Begin);
 
   requiredCmp = cmp;
 
@@ -461,8 +1017,85 @@ EXTERN_C Image_ImageHeader *Image_LoadHDR(VFile_Handle handle) {
   return image;
 }
 
+namespace {
+
+// the format Image_LoadEXR decodes to given the pixel types of the R, G, B
+// and A channels (-1 for a missing channel). Present channels are packed
+Image_Format EXRFormatOf(int const rgbaPixelTypes[4]) {
+  static Image_Format const floatFormats[] = {
+      Image_Format_R32_SFLOAT, Image_Format_R32G32_SFLOAT,
+      Image_Format_R32G32B32_SFLOAT, Image_Format_R32G32B32A32_SFLOAT
+  };
+  static Image_Format const halfFormats[] = {
+      Image_Format_R16_SFLOAT, Image_Format_R16G16_SFLOAT,
+      Image_Format_R16G16B16_SFLOAT, Image_Format_R16G16B16A16_SFLOAT
+  };
+
+  // all support homogenous image (all formats the same)
+  int pixelType = -1;
+  uint32_t channelCount = 0;
+  for (int i = 0; i < 4; ++i) {
+    if (rgbaPixelTypes[i] < 0) { continue; }
+    if (channelCount > 0 && rgbaPixelTypes[i] != pixelType) {
+      LOGERROR("EXR image not homogenous");
+      return Image_Format_UNDEFINED;
+    }
+    pixelType = rgbaPixelTypes[i];
+    channelCount++;
+  }
+
+  if (channelCount == 0) {
+    LOGERROR("EXR image has no R, G, B or A channels");
+    return Image_Format_UNDEFINED;
+  }
+  if (pixelType == TINYEXR_PIXELTYPE_FLOAT) {
+    return floatFormats[channelCount - 1];
+  }
+  if (pixelType == TINYEXR_PIXELTYPE_HALF) {
+    return halfFormats[channelCount - 1];
+  }
+  LOGERROR("EXR unsupported pixel type");
+  return Image_Format_UNDEFINED;
+}
+
+// picks the R, G, B and A channels, working out the format they decode to
+// and the slot of each file channel with them interleaved in RGBA order.
+// Channels we don't use get a slot of -1 and are skipped
+bool SelectEXRChannels(tinyexr::EXRHeader const &header,
+                       Image_Format *format,
+                       tinystl::vector<int> &slots) {
+  int idxRGBA[4] = {-1, -1, -1, -1};
+  for (int c = 0; c < header.num_channels; c++) {
+    char const *name = header.channels[c].name;
+    if (name[0] != 0 && name[1] == 0) {
+      char const *rgba = strchr("RGBA", name[0]);
+      if (rgba) { idxRGBA[rgba - "RGBA"] = c; }
+    }
+  }
+
+  int rgbaPixelTypes[4];
+  for (int i = 0; i < 4; ++i) {
+    rgbaPixelTypes[i] = idxRGBA[i] != -1 ? header.pixel_types[idxRGBA[i]] : -1;
+  }
+  *format = EXRFormatOf(rgbaPixelTypes);
+  if (*format == Image_Format_UNDEFINED) {
+    return false;
+  }
+
+  slots.resize(header.num_channels);
+  for (int c = 0; c < header.num_channels; c++) { slots[c] = -1; }
+  int slot = 0;
+  for (int i = 0; i < 4; ++i) {
+    if (idxRGBA[i] != -1) { slots[idxRGBA[i]] = slot++; }
+  }
+  return true;
+}
+
+} // end anon namespace
+
 EXTERN_C Image_ImageHeader *Image_LoadEXR(VFile_Handle handle) {
   VFile::File *file = VFile::File::FromHandle(handle);
+  int64_t const start = file->Tell();
 
   using namespace tinyexr;
   EXRVersion version;
@@ -475,154 +1108,349 @@ EXTERN_C Image_ImageHeader *Image_LoadEXR(VFile_Handle handle) {
     return nullptr;
   }
 
-  file->Seek(0, VFile_SD_Begin);
+  file->Seek(start, VFile_SD_Begin);
   ret = ParseEXRHeader(&header, &version, handle);
   if (ret != 0) {
     LOGERRORF("Parse EXR error");
     return nullptr;
   }
 
-  // all support homogenous image (all formats the same)
-  int firstPixelType;
-  for (int i = 0; i < Math_MinI32(header.num_channels,4); i++) {
-    if(i == 0) {
-      firstPixelType = header.pixel_types[0];
-    } else {
-      if(header.pixel_types[i] != firstPixelType) {
-        LOGERROR("EXR image not homogenous");
-        return nullptr;
-      }
-    }
+  if (header.tiled) {
+    LOGERROR("Tiled EXR files aren't supported");
+    FreeEXRHeader(&header);
+    return nullptr;
+  }
+
+  Image_Format format;
+  tinystl::vector<int> slots;
+  if (!SelectEXRChannels(header, &format, slots)) {
+    FreeEXRHeader(&header);
+    return nullptr;
   }
 
+  Image_ImageHeader *image = Image_CreateNoClear(header.data_window[2] - header.data_window[0] + 1,
+                                                 header.data_window[3] - header.data_window[1] + 1,
+                                                 1, 1, format);
+  if (!image) {
+    FreeEXRHeader(&header);
+    return nullptr;
+  }
+
+  // decode straight into the image
+  header.requested_interleaved = (unsigned char *) Image_RawDataPtr(image);
+  header.requested_channel_slots = slots.data();
+  header.requested_pixel_stride = (int) Image_Format_ChannelCount(format);
+
   EXRImage exrImage;
   InitEXRImage(&exrImage);
 
+  file->Seek(start, VFile_SD_Begin);
   ret = LoadEXRImage(&exrImage, &header, handle);
+  FreeEXRImage(&exrImage);
+  FreeEXRHeader(&header);
   if (ret != 0) {
-    LOGERRORF("Load EXR error\n");
+    LOGERROR("Load EXR error");
+    Image_Destroy(image);
     return nullptr;
   }
 
-  // RGBA
-  int idxR = -1;
-  int idxG = -1;
-  int idxB = -1;
-  int idxA = -1;
-  int numChannels = 0;
-  for (int c = 0; c < header.num_channels; c++) {
-    if (strcmp(header.channels[c].name, "R") == 0) {
-      idxR = c;
-      numChannels++;
-    } else if (strcmp(header.channels[c].name, "G") == 0) {
-      idxG = c;
-      numChannels++;
-    } else if (strcmp(header.channels[c].name, "B") == 0) {
-      idxB = c;
-      numChannels++;
-    } else if (strcmp(header.channels[c].name, "A") == 0) {
-      idxA = c;
-      numChannels++;
-    }
+  return image;
+}
+
+EXTERN_C Image_ImageHeader *Image_LoadEXRRegion(VFile_Handle handle,
+                                                uint32_t x, uint32_t y,
+                                                uint32_t width, uint32_t height,
+                                                uint32_t level) {
+  VFile::File *file = VFile::File::FromHandle(handle);
+  if (width == 0 || height == 0 || width > (uint32_t) INT32_MAX - x || height > (uint32_t) INT32_MAX - y) {
+    LOGERROR("EXR region is empty or too large");
+    return nullptr;
   }
 
-  int idxChannels[] = {-1, -1, -1, -1};
-  int idxCur = 0;
-  if (idxR != -1) {
-    idxChannels[idxCur++] = idxR;
+  using namespace tinyexr;
+  EXRVersion version;
+  EXRHeader header;
+  InitEXRHeader(&header);
+  int64_t const start = file->Tell();
+  int ret = ParseEXRVersion(&version, handle);
+  if (ret != 0) {
+    LOGERRORF("Parse EXR error");
+    return nullptr;
   }
-  if (idxG != -1) {
-    idxChannels[idxCur++] = idxG;
+
+  file->Seek(start, VFile_SD_Begin);
+  ret = ParseEXRHeader(&header, &version, handle);
+  if (ret != 0) {
+    LOGERRORF("Parse EXR error");
+    return nullptr;
   }
-  if (idxB != -1) {
-    idxChannels[idxCur++] = idxB;
+
+  Image_Format format;
+  tinystl::vector<int> slots;
+  if (!SelectEXRChannels(header, &format, slots)) {
+    FreeEXRHeader(&header);
+    return nullptr;
   }
-  if (idxA != -1) {
-    idxChannels[idxCur++] = idxA;
+
+  Image_ImageHeader *image = Image_CreateNoClear(width, height, 1, 1, format);
+  if (!image) {
+    FreeEXRHeader(&header);
+    return nullptr;
   }
 
-  Image_Format format = Image_Format_UNDEFINED;
+  header.requested_interleaved = (unsigned char *) Image_RawDataPtr(image);
+  header.requested_channel_slots = slots.data();
+  header.requested_pixel_stride = (int) Image_Format_ChannelCount(format);
 
-  if(firstPixelType == TINYEXR_PIXELTYPE_FLOAT) {
-    switch (numChannels) {
-      case 1: format = Image_Format_R32_SFLOAT;
-        break;
-      case 2: format = Image_Format_R32G32_SFLOAT;
-        break;
-      case 3:format = Image_Format_R32G32B32_SFLOAT;
-        break;
-      case 4: format = Image_Format_R32G32B32A32_SFLOAT;
-        break;
-    }
-  } else if(firstPixelType == TINYEXR_PIXELTYPE_HALF) {
-    switch (numChannels) {
-      case 1: format = Image_Format_R16_SFLOAT;
-        break;
-      case 2: format = Image_Format_R16G16_SFLOAT;
-        break;
-      case 3:format = Image_Format_R16G16B16_SFLOAT;
-        break;
-      case 4: format = Image_Format_R16G16B16A16_SFLOAT;
-        break;
-    }
-  } else {
-    LOGERROR("EXR unsupported pixel type");
+  // the region is checked against the level size by tinyexr
+  int const region[4] = {
+      (int) x, (int) y,
+      (int) (x + width - 1), (int) (y + height - 1)
+  };
+  file->Seek(start, VFile_SD_Begin);
+  ret = LoadEXRImageRegion(&header, handle, region, (int) level, (int) level);
+  FreeEXRHeader(&header);
+  if (ret != 0) {
+    LOGERROR("Load EXR region error");
+    Image_Destroy(image);
     return nullptr;
   }
 
-  // Create and extract the pixel data
-  Image_ImageHeader *image = Image_Create(exrImage.width, exrImage.height, 1, 1, format);
+  return image;
+}
 
-  if(firstPixelType == TINYEXR_PIXELTYPE_FLOAT) {
-    float* out = (float*)Image_RawDataPtr(image);
+namespace {
+
+enum class FileType {
+  Unknown,
+  DDS,
+  PVR,
+  KTX2,
+  EXR,
+  HDR,
+  LDR,
+};
+
+// identifies the file from its first bytes, leaving the file where it was.
+// TGA has no magic so anything not recognised is left to stb
+FileType SniffFileType(VFile::File *file) {
+  uint8_t magic[12];
+  memset(magic, 0, sizeof(magic));
+  int64_t const start = file->Tell();
+  size_t const size = file->Read(magic, sizeof(magic));
+  file->Seek(start, VFile_SD_Begin);
+  if (size < 4) { return FileType::Unknown; }
+
+  uint32_t const magic32 = magic[0] | (magic[1] << 8) | (magic[2] << 16) | ((uint32_t) magic[3] << 24);
+  if (magic32 == MAKE_CHAR4('D', 'D', 'S', ' ')) { return FileType::DDS; }
+  if (magic32 == gPvrtexV3HeaderVersion) { return FileType::PVR; }
+  if (magic32 == 0x01312F76) { return FileType::EXR; }
+  if (size == sizeof(magic) && memcmp(magic, Image::KTX2Identifier, sizeof(magic)) == 0) {
+    return FileType::KTX2;
+  }
+  if (magic[0] == '#' && magic[1] == '?') { return FileType::HDR; }
+  if ((magic[0] == 0x89 && magic[1] == 'P' && magic[2] == 'N' && magic[3] == 'G') ||
+      (magic[0] == 0xFF && magic[1] == 0xD8) ||
+      (magic[0] == 'B' && magic[1] == 'M') ||
+      (magic[0] == 'G' && magic[1] == 'I' && magic[2] == 'F') ||
+      (magic[0] == '8' && magic[1] == 'B' && magic[2] == 'P' && magic[3] == 'S') ||
+      (magic32 == 0x34F68053) ||
+      (magic[0] == 'P' && (magic[1] == '5' || magic[1] == '6'))) {
+    return FileType::LDR;
+  }
+  return FileType::Unknown;
+}
 
-    for (uint32_t i = 0; i < image->width * image->height; i++) {
-      for (int chn = 0; chn < numChannels; chn++) {
-        out[i * numChannels + chn] = ((float**) exrImage.images)[idxChannels[chn]][i];
+// reads a null terminated EXR attribute name or type
+bool ReadEXRString(VFile::File *file, char *str, size_t maxSize) {
+  for (size_t i = 0; i < maxSize; ++i) {
+    if (file->Read(str + i, 1) != 1) { return false; }
+    if (str[i] == 0) { return true; }
+  }
+  return false;
+}
+
+// walks the EXR header attributes, stopping as soon as the data window and
+// channel list have been seen. Everything else is skipped over
+bool ReadEXRInfo(VFile::File *file, uint32_t *width, uint32_t *height, Image_Format *format) {
+  uint8_t version[8];
+  if (file->Read(version, sizeof(version)) != sizeof(version) ||
+      version[0] != 0x76 || version[1] != 0x2F || version[2] != 0x31 || version[3] != 0x01) {
+    LOGERROR("Not an EXR file");
+    return false;
+  }
+  // tiled, deep and multi part files aren't supported by Image_LoadEXR
+  if (version[5] & (0x2 | 0x8 | 0x10)) {
+    LOGERROR("Tiled, deep and multi part EXR files aren't supported");
+    return false;
+  }
+
+  bool gotDataWindow = false;
+  bool gotChannels = false;
+  int rgbaPixelTypes[4] = {-1, -1, -1, -1};
+  while (!gotDataWindow || !gotChannels) {
+    char name[256];
+    char type[256];
+    int32_t size;
+    if (!ReadEXRString(file, name, sizeof(name)) || name[0] == 0 ||
+        !ReadEXRString(file, type, sizeof(type)) ||
+        file->Read(&size, sizeof(size)) != sizeof(size) || size < 0) {
+      LOGERROR("EXR header is missing its data window or channels");
+      return false;
+    }
+
+    if (strcmp(name, "dataWindow") == 0 && size == 16) {
+      int32_t window[4];
+      if (file->Read(window, sizeof(window)) != sizeof(window)) { return false; }
+      *width = (uint32_t) (window[2] - window[0] + 1);
+      *height = (uint32_t) (window[3] - window[1] + 1);
+      gotDataWindow = true;
+    } else if (strcmp(name, "channels") == 0) {
+      tinystl::vector<char> channels(size + 1, 0);
+      if (file->Read(channels.data(), size) != (size_t) size) { return false; }
+      // name, then pixel type, linear + 3 reserved bytes, x and y sampling
+      char const *p = channels.data();
+      char const *end = p + size;
+      while (p < end && *p) {
+        size_t const nameLen = strlen(p);
+        if (p + nameLen + 1 + 16 > end) { return false; }
+        int32_t pixelType;
+        memcpy(&pixelType, p + nameLen + 1, sizeof(pixelType));
+        if (nameLen == 1) {
+          char const *rgba = strchr("RGBA", p[0]);
+          if (rgba) { rgbaPixelTypes[rgba - "RGBA"] = pixelType; }
+        }
+        p += nameLen + 1 + 16;
       }
+      gotChannels = true;
+    } else {
+      file->Seek(size, VFile_SD_Current);
     }
-  } else if(firstPixelType == TINYEXR_PIXELTYPE_HALF) {
-    uint16_t* out = (uint16_t*)Image_RawDataPtr(image);
+  }
+
+  *format = EXRFormatOf(rgbaPixelTypes);
+  return *format != Image_Format_UNDEFINED;
+}
+
+// fills what is available without decoding, through stb for the formats it
+// handles
+bool ReadStbInfo(VFile_Handle handle, bool hdr, uint32_t *width, uint32_t *height, Image_Format *format) {
+  stbi_io_callbacks callbacks{
+      &stbIoCallbackRead,
+      &stbIoCallbackSkip,
+      &stbIoCallbackEof
+  };
 
-    for (uint32_t i = 0; i < image->width * image->height; i++) {
-      for (int chn = 0; chn < numChannels; chn++) {
-        out[i * numChannels + chn] = ((uint16_t**) exrImage.images)[idxChannels[chn]][i];
+  int w = 0, h = 0, cmp = 0;
+  if (!stbi_info_from_callbacks(&callbacks, handle, &w, &h, &cmp) || w == 0 || h == 0 || cmp == 0) {
+    return false;
+  }
+
+  static Image_Format const ldrFormats[] = {
+      Image_Format_R8_UNORM, Image_Format_R8G8_UNORM,
+      Image_Format_R8G8B8A8_UNORM, Image_Format_R8G8B8A8_UNORM
+  };
+  static Image_Format const hdrFormats[] = {
+      Image_Format_R32_SFLOAT, Image_Format_R32G32_SFLOAT,
+      Image_Format_R32G32B32_SFLOAT, Image_Format_R32G32B32A32_SFLOAT
+  };
+  *width = (uint32_t) w;
+  *height = (uint32_t) h;
+  // matches Image_LoadLDR expanding RGB to RGBA
+  *format = hdr ? hdrFormats[cmp - 1] : ldrFormats[cmp - 1];
+  return true;
+}
+
+} // end anon namespace
+
+EXTERN_C bool Image_LoadHeader(VFile_Handle handle, Image_ImageHeader *out, uint32_t *mipCount) {
+  ASSERT(out);
+  VFile::File *file = VFile::File::FromHandle(handle);
+  int64_t const start = file->Tell();
+
+  uint32_t width = 0;
+  uint32_t height = 1;
+  uint32_t depth = 1;
+  uint32_t slices = 1;
+  uint32_t mips = 1;
+  Image_Format format = Image_Format_UNDEFINED;
+  bool cubemap = false;
+  bool ok = false;
+
+  switch (SniffFileType(file)) {
+    case FileType::DDS: {
+      DDSInfo info;
+      ok = ReadDDSInfo(file, &info);
+      if (ok) {
+        width = info.width;
+        height = info.height;
+        depth = info.depth;
+        slices = info.slices;
+        format = info.format;
+        cubemap = info.cubemap;
+        mips = UsableMipCount(format, width, height, depth, info.mipMapCount, &DDSLevelByteCount);
       }
+      break;
+    }
+    case FileType::PVR: {
+      PVRInfo info;
+      ok = ReadPVRInfo(file, &info);
+      if (ok) {
+        width = info.width;
+        height = info.height;
+        depth = info.depth;
+        slices = info.slices;
+        format = info.format;
+        mips = UsableMipCount(format, width, height, depth, info.mipMapCount, &PVRLevelByteCount);
+      }
+      break;
+    }
+    case FileType::KTX2: {
+      KTX2Info info;
+      ok = ReadKTX2Info(file, &info);
+      if (ok) {
+        width = info.width;
+        height = info.height;
+        depth = info.depth;
+        slices = info.slices;
+        format = info.format;
+        cubemap = info.header.faceCount == 6;
+        mips = UsableMipCount(format, width, height, depth, info.levelCount, &DDSLevelByteCount);
+      }
+      break;
     }
+    case FileType::EXR: ok = ReadEXRInfo(file, &width, &height, &format);
+      break;
+    case FileType::HDR: ok = ReadStbInfo(handle, true, &width, &height, &format);
+      break;
+    case FileType::LDR:
+    case FileType::Unknown: ok = ReadStbInfo(handle, false, &width, &height, &format);
+      break;
   }
 
-  return image;
+  // leave the file ready to be loaded
+  file->Seek(start, VFile_SD_Begin);
+  if (!ok || width == 0 || mips == 0) {
+    return false;
+  }
+
+  Image_FillHeader(width, height, depth, slices, format, out);
+  out->flags = Image_Flag_HeaderOnly | (cubemap ? Image_Flag_Cubemap : 0);
+  if (mipCount) { *mipCount = mips; }
+  return true;
 }
 
 EXTERN_C Image_ImageHeader *Image_Load(VFile_Handle handle) {
   VFile::File *file = VFile::File::FromHandle(handle);
-  tinystl::string_view name = file->GetName();
-
-  if( auto pos = name.rfind('.') != tinystl::string_view::npos ) {
-    tinystl::string_view ext(name.data()+pos+1, name.size()-pos );
-    switch(Core::QuickHash(ext) ) {
-      case ".dds"_hash:
-        return Image_LoadDDS(handle);
-      case ".pvr"_hash:
-        return Image_LoadPVR(handle);
-      case ".exr"_hash:
-        return Image_LoadEXR(handle);
-      case ".hdr"_hash:
-        return Image_LoadHDR(handle);
-      case ".jpg"_hash:
-      case ".jpeg"_hash:
-      case ".png"_hash:
-      case ".tga"_hash:
-      case ".bmp"_hash:
-      case ".psd"_hash:
-      case ".gif"_hash:
-      case ".pic"_hash:
-      case ".pnm"_hash:
-        return Image_LoadLDR(handle);
-      default:
-        return nullptr;
-    }
-  } else {
-    return nullptr;
+
+  switch (SniffFileType(file)) {
+    case FileType::DDS: return Image_LoadDDS(handle);
+    case FileType::PVR: return Image_LoadPVR(handle);
+    case FileType::KTX2: return Image_LoadKTX2(handle);
+    case FileType::EXR: return Image_LoadEXR(handle);
+    case FileType::HDR: return Image_LoadHDR(handle);
+    case FileType::LDR:
+    case FileType::Unknown: return Image_LoadLDR(handle);
   }
+  return nullptr;
 }
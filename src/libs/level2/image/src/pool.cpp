@@ -0,0 +1,140 @@
+#include "core/core.h"
+#include "core/logger.h"
+#include "os/thread.hpp"
+#include "os/atomics.h"
+#include "image/image.h"
+#include "allocator.hpp"
+#include <new>
+
+namespace {
+
+// cached allocation, the link lives in the freed memory itself
+struct FreeBlock {
+  FreeBlock *next;
+  size_t size;
+};
+
+} // end anon namespace
+
+struct Image_Pool_t {
+  Os::Mutex mutex;
+  Image_Allocator allocator;
+  Image_Allocator backing;
+  FreeBlock *freeList;
+  size_t cachedBytes;
+  size_t maxCachedBytes;
+  uint32_t outstanding;
+};
+
+namespace {
+
+void *PoolAllocate(void *user, size_t size, size_t alignment) {
+  auto *pool = (Image_Pool_t *) user;
+  {
+    Os::MutexLock lock(pool->mutex);
+    pool->outstanding++;
+    FreeBlock **prev = &pool->freeList;
+    while (*prev) {
+      FreeBlock *block = *prev;
+      if (block->size == size) {
+        *prev = block->next;
+        pool->cachedBytes -= size;
+        return block;
+      }
+      prev = &block->next;
+    }
+  }
+  void *ptr = pool->backing.allocate(pool->backing.user, size, alignment);
+  if (!ptr) {
+    Os::MutexLock lock(pool->mutex);
+    pool->outstanding--;
+  }
+  return ptr;
+}
+
+void PoolFree(void *user, void *ptr, size_t size) {
+  auto *pool = (Image_Pool_t *) user;
+  {
+    Os::MutexLock lock(pool->mutex);
+    ASSERT(pool->outstanding > 0);
+    pool->outstanding--;
+    if (pool->cachedBytes + size <= pool->maxCachedBytes) {
+      auto *block = (FreeBlock *) ptr;
+      block->size = size;
+      block->next = pool->freeList;
+      pool->freeList = block;
+      pool->cachedBytes += size;
+      return;
+    }
+  }
+  pool->backing.free(pool->backing.user, ptr, size);
+}
+
+} // end anon namespace
+
+EXTERN_C Image_PoolHandle Image_PoolCreate(size_t maxCachedBytes) {
+  auto *pool = (Image_Pool_t *) malloc(sizeof(Image_Pool_t));
+  if (!pool) { return nullptr; }
+  new(&pool->mutex) Os::Mutex();
+  pool->allocator.allocate = &PoolAllocate;
+  pool->allocator.free = &PoolFree;
+  pool->allocator.user = pool;
+  pool->backing = *Image_GetAllocator();
+  pool->freeList = nullptr;
+  pool->cachedBytes = 0;
+  pool->maxCachedBytes = maxCachedBytes;
+  pool->outstanding = 0;
+  return pool;
+}
+
+EXTERN_C void Image_PoolDestroy(Image_PoolHandle pool) {
+  if (!pool) { return; }
+  if (pool->outstanding != 0) {
+    LOGERRORF("Image pool destroyed with %u images still in use", pool->outstanding);
+  }
+  Image_PoolTrim(pool);
+  pool->mutex.~Mutex();
+  free(pool);
+}
+
+EXTERN_C Image_ImageHeader *Image_PoolAcquire(Image_PoolHandle pool,
+                                              uint32_t width,
+                                              uint32_t height,
+                                              uint32_t depth,
+                                              uint32_t slices,
+                                              enum Image_Format format) {
+  ASSERT(pool);
+  return Image::CreateNoClearWith(&pool->allocator, width, height, depth, slices, format);
+}
+
+EXTERN_C void Image_PoolTrim(Image_PoolHandle pool) {
+  ASSERT(pool);
+  FreeBlock *block;
+  {
+    Os::MutexLock lock(pool->mutex);
+    block = pool->freeList;
+    pool->freeList = nullptr;
+    pool->cachedBytes = 0;
+  }
+  while (block) {
+    FreeBlock *next = block->next;
+    pool->backing.free(pool->backing.user, block, block->size);
+    block = next;
+  }
+}
+
+EXTERN_C Image_PoolHandle Image_PoolGlobal(void) {
+  static void *volatile global = nullptr;
+
+  void *pool = global;
+  if (pool != nullptr) { return (Image_PoolHandle) pool; }
+
+  // caps how much a long running tool holds on to between uses
+  Image_PoolHandle newPool = Image_PoolCreate(256 * 1024 * 1024);
+  pool = Os_AtomicCompareAndSwapPtr(&global, newPool, nullptr);
+  if (pool != nullptr) {
+    Image_PoolDestroy(newPool);
+    return (Image_PoolHandle) pool;
+  }
+  return newPool;
+}
@@ -0,0 +1,184 @@
+#include "core/core.h"
+#include "core/logger.h"
+#include "os/atomics.h"
+#include "os/threadpool.h"
+#include "image/format.h"
+#include "image/format_cracker.h"
+#include "image/image.h"
+#include "image/resize.h"
+#include "stb/stb_image_resize.h"
+
+namespace {
+
+// output rows per job, the resizer filters each band independently and only
+// reads the source rows that band needs
+#define RESIZE_BAND_ROWS 32
+
+struct ResizeKernel {
+  stbir_datatype type;
+  int channels;
+  int alphaChannel; // -1 if none
+  stbir_colorspace space;
+};
+
+bool ResizeKernelOf(Image_Format format, ResizeKernel *kernel) {
+  kernel->alphaChannel = -1;
+  kernel->space = STBIR_COLORSPACE_LINEAR;
+  switch (format) {
+    case Image_Format_R8_SRGB:
+    case Image_Format_R8G8_SRGB:
+    case Image_Format_R8G8B8_SRGB:
+    case Image_Format_B8G8R8_SRGB:
+    case Image_Format_R8G8B8A8_SRGB:
+    case Image_Format_B8G8R8A8_SRGB:
+    case Image_Format_A8B8G8R8_SRGB_PACK32: kernel->space = STBIR_COLORSPACE_SRGB;
+      break;
+    default: break;
+  }
+
+  switch (format) {
+    case Image_Format_R8_UNORM:
+    case Image_Format_R8_SRGB: kernel->type = STBIR_TYPE_UINT8;
+      kernel->channels = 1;
+      return true;
+    case Image_Format_R8G8_UNORM:
+    case Image_Format_R8G8_SRGB: kernel->type = STBIR_TYPE_UINT8;
+      kernel->channels = 2;
+      return true;
+    case Image_Format_R8G8B8_UNORM:
+    case Image_Format_R8G8B8_SRGB:
+    case Image_Format_B8G8R8_UNORM:
+    case Image_Format_B8G8R8_SRGB: kernel->type = STBIR_TYPE_UINT8;
+      kernel->channels = 3;
+      return true;
+    case Image_Format_R8G8B8A8_UNORM:
+    case Image_Format_R8G8B8A8_SRGB:
+    case Image_Format_B8G8R8A8_UNORM:
+    case Image_Format_B8G8R8A8_SRGB:
+    case Image_Format_A8B8G8R8_UNORM_PACK32:
+    case Image_Format_A8B8G8R8_SRGB_PACK32: kernel->type = STBIR_TYPE_UINT8;
+      kernel->channels = 4;
+      kernel->alphaChannel = 3;
+      return true;
+    case Image_Format_R16_UNORM: kernel->type = STBIR_TYPE_UINT16;
+      kernel->channels = 1;
+      return true;
+    case Image_Format_R16G16_UNORM: kernel->type = STBIR_TYPE_UINT16;
+      kernel->channels = 2;
+      return true;
+    case Image_Format_R16G16B16_UNORM: kernel->type = STBIR_TYPE_UINT16;
+      kernel->channels = 3;
+      return true;
+    case Image_Format_R16G16B16A16_UNORM: kernel->type = STBIR_TYPE_UINT16;
+      kernel->channels = 4;
+      kernel->alphaChannel = 3;
+      return true;
+    case Image_Format_R32_SFLOAT: kernel->type = STBIR_TYPE_FLOAT;
+      kernel->channels = 1;
+      return true;
+    case Image_Format_R32G32_SFLOAT: kernel->type = STBIR_TYPE_FLOAT;
+      kernel->channels = 2;
+      return true;
+    case Image_Format_R32G32B32_SFLOAT: kernel->type = STBIR_TYPE_FLOAT;
+      kernel->channels = 3;
+      return true;
+    case Image_Format_R32G32B32A32_SFLOAT: kernel->type = STBIR_TYPE_FLOAT;
+      kernel->channels = 4;
+      kernel->alphaChannel = 3;
+      return true;
+    default: return false;
+  }
+}
+
+struct ResizeJob {
+  Image_ImageHeader const *src;
+  Image_ImageHeader *dst;
+  ResizeKernel kernel;
+  int stbFlags;
+  stbir_edge edge;
+  stbir_filter filter;
+  uint32_t bandCount;
+  Os_atomic32_t failures;
+};
+
+void ResizeBand(void *data, uint32_t index) {
+  ResizeJob *job = (ResizeJob *) data;
+  Image_ImageHeader const *src = job->src;
+  Image_ImageHeader *dst = job->dst;
+
+  uint32_t const page = index / job->bandCount;
+  uint32_t const y = (index % job->bandCount) * RESIZE_BAND_ROWS;
+  uint32_t const rows = (dst->height - y) < RESIZE_BAND_ROWS ? (dst->height - y) : RESIZE_BAND_ROWS;
+  size_t const srcRowBytes = Image_ByteCountPerRowOf(src);
+  size_t const dstRowBytes = Image_ByteCountPerRowOf(dst);
+
+  uint8_t const *srcPage = (uint8_t const *) Image_RawDataPtr(src) + page * Image_ByteCountPerPageOf(src);
+  uint8_t *dstRows = (uint8_t *) Image_RawDataPtr(dst) + page * Image_ByteCountPerPageOf(dst) + y * dstRowBytes;
+
+  // the same scale as the whole image, shifted to this band's first row so
+  // the bands join seamlessly
+  float const xScale = (float) dst->width / (float) src->width;
+  float const yScale = (float) dst->height / (float) src->height;
+  int const ok = stbir_resize_subpixel(srcPage, (int) src->width, (int) src->height, (int) srcRowBytes,
+                                       dstRows, (int) dst->width, (int) rows, (int) dstRowBytes,
+                                       job->kernel.type, job->kernel.channels, job->kernel.alphaChannel,
+                                       job->stbFlags, job->edge, job->edge, job->filter, job->filter,
+                                       job->kernel.space, nullptr,
+                                       xScale, yScale, 0.0f, (float) y);
+  if (!ok) {
+    Os_AtomicAdd32_relaxed(&job->failures, 1);
+  }
+}
+
+} // end anon namespace
+
+EXTERN_C bool Image_ResizeIsSupported(Image_Format format) {
+  ResizeKernel kernel;
+  return ResizeKernelOf(format, &kernel);
+}
+
+EXTERN_C Image_ImageHeader *Image_Resize(Image_ImageHeader const *src,
+                                         uint32_t width,
+                                         uint32_t height,
+                                         Image_ResizeFilter filter,
+                                         Image_ResizeFlags flags) {
+  ASSERT(src);
+
+  ResizeJob job;
+  if (!ResizeKernelOf(src->format, &job.kernel)) {
+    LOGERRORF("Resize doesn't support %s", Image_Format_Name(src->format));
+    return nullptr;
+  }
+  if (Image_IsTiled(src)) {
+    LOGERROR("Resize needs a linear image");
+    return nullptr;
+  }
+  if (width == 0 || height == 0 || src->width == 0 || src->height == 0) {
+    LOGERROR("Can't resize to or from an empty image");
+    return nullptr;
+  }
+
+  if (flags & Image_RF_Flag_NoAlpha) { job.kernel.alphaChannel = -1; }
+  if (flags & Image_RF_Flag_IgnoreSRGB) { job.kernel.space = STBIR_COLORSPACE_LINEAR; }
+  job.stbFlags = (flags & Image_RF_Flag_AlphaPremultiplied) ? STBIR_FLAG_ALPHA_PREMULTIPLIED : 0;
+  job.edge = (flags & Image_RF_Flag_Wrap) ? STBIR_EDGE_WRAP : STBIR_EDGE_CLAMP;
+  // Image_ResizeFilter follows stbir_filter
+  job.filter = (stbir_filter) filter;
+
+  Image_ImageHeader *dst = Image_CreateNoClear(width, height, src->depth, src->slices, src->format);
+  if (!dst) { return nullptr; }
+  dst->flags |= src->flags & Image_Flag_Cubemap;
+
+  job.src = src;
+  job.dst = dst;
+  job.bandCount = (height + RESIZE_BAND_ROWS - 1) / RESIZE_BAND_ROWS;
+  job.failures = 0;
+  Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &ResizeBand, &job,
+                           job.bandCount * src->depth * src->slices);
+
+  if (job.failures) {
+    Image_Destroy(dst);
+    return nullptr;
+  }
+  return dst;
+}
@@ -7,8 +7,14 @@
 #include "image/format.h"
 #include "image/format_cracker.h"
 #include "image/image.h"
+#include "image/view.h"
+#include "image/io.h"
+#include "os/threadpool.h"
 #include "syoyo/tiny_exr.hpp"
 #include "dds.hpp"
+#include "ktx2.hpp"
+#include "miniz/miniz.h"
+#include "lz4/lz4.h"
 #include <float.h>
 
 EXTERN_C bool Image_SaveDDS(Image_ImageHeader *image, VFile_Handle handle) {
@@ -17,6 +23,10 @@ EXTERN_C bool Image_SaveDDS(Image_ImageHeader *image, VFile_Handle handle) {
   if (!handle) {
     return false;
   }
+  if (Image_IsTiled(image)) {
+    LOGERROR("DDS files are linear, convert tiled images before saving");
+    return false;
+  }
 
   DDSHeader header;
   DDSHeaderDX10 headerDX10;
@@ -39,7 +49,49 @@ EXTERN_C bool Image_SaveDDS(Image_ImageHeader *image, VFile_Handle handle) {
 
   int nChannels = Image_Format_ChannelCount(image->format);
 
-  if (Image_Format_BitWidth(image->format) <= 32) {
+  if (Image_Format_IsCompressed(image->format)) {
+    // the legacy FourCCs where the format has one, otherwise DX10
+    header.mPixelFormat.mDWFlags = DDPF_FOURCC;
+    switch (image->format) {
+      case Image_Format_BC1_RGBA_UNORM_BLOCK: header.mPixelFormat.mDWFourCC = MAKE_CHAR4('D', 'X', 'T', '1');
+        break;
+      case Image_Format_BC2_UNORM_BLOCK: header.mPixelFormat.mDWFourCC = MAKE_CHAR4('D', 'X', 'T', '3');
+        break;
+      case Image_Format_BC3_UNORM_BLOCK: header.mPixelFormat.mDWFourCC = MAKE_CHAR4('D', 'X', 'T', '5');
+        break;
+      case Image_Format_BC4_UNORM_BLOCK: header.mPixelFormat.mDWFourCC = MAKE_CHAR4('A', 'T', 'I', '1');
+        break;
+      case Image_Format_BC5_UNORM_BLOCK: header.mPixelFormat.mDWFourCC = MAKE_CHAR4('A', 'T', 'I', '2');
+        break;
+      default: header.mPixelFormat.mDWFourCC = MAKE_CHAR4('D', 'X', '1', '0');
+        switch (image->format) {
+          case Image_Format_BC1_RGB_UNORM_BLOCK: headerDX10.mDXGIFormat = DDS_DXGI_FORMAT_BC1_UNORM;
+            break;
+          case Image_Format_BC1_RGB_SRGB_BLOCK:
+          case Image_Format_BC1_RGBA_SRGB_BLOCK: headerDX10.mDXGIFormat = DDS_DXGI_FORMAT_BC1_UNORM_SRGB;
+            break;
+          case Image_Format_BC2_SRGB_BLOCK: headerDX10.mDXGIFormat = DDS_DXGI_FORMAT_BC2_UNORM_SRGB;
+            break;
+          case Image_Format_BC3_SRGB_BLOCK: headerDX10.mDXGIFormat = DDS_DXGI_FORMAT_BC3_UNORM_SRGB;
+            break;
+          case Image_Format_BC4_SNORM_BLOCK: headerDX10.mDXGIFormat = DDS_DXGI_FORMAT_BC4_SNORM;
+            break;
+          case Image_Format_BC5_SNORM_BLOCK: headerDX10.mDXGIFormat = DDS_DXGI_FORMAT_BC5_SNORM;
+            break;
+          case Image_Format_BC6H_UFLOAT_BLOCK: headerDX10.mDXGIFormat = DDS_DXGI_FORMAT_BC6H_UF16;
+            break;
+          case Image_Format_BC6H_SFLOAT_BLOCK: headerDX10.mDXGIFormat = DDS_DXGI_FORMAT_BC6H_SF16;
+            break;
+          case Image_Format_BC7_UNORM_BLOCK: headerDX10.mDXGIFormat = DDS_DXGI_FORMAT_BC7_UNORM;
+            break;
+          case Image_Format_BC7_SRGB_BLOCK: headerDX10.mDXGIFormat = DDS_DXGI_FORMAT_BC7_UNORM_SRGB;
+            break;
+          default:
+            LOGERRORF("%s can't be saved as DDS", Image_Format_Name(image->format));
+            return false;
+        }
+    }
+  } else if (Image_Format_BitWidth(image->format) <= 32) {
     if (Image_Format_IsHomogenous(image->format)) {
       switch (Image_Format_ChannelBitWidth(image->format, 0)) {
         case 4:
@@ -129,27 +181,7 @@ EXTERN_C bool Image_SaveDDS(Image_ImageHeader *image, VFile_Handle handle) {
         break;
       case Image_Format_R32G32B32A32_SFLOAT: header.mPixelFormat.mDWFourCC = 116;
         break;
-      case Image_Format_BC1_RGBA_UNORM_BLOCK: header.mPixelFormat.mDWFourCC = MAKE_CHAR4('D', 'X', 'T', '1');
-        break;
-      case Image_Format_BC2_UNORM_BLOCK: header.mPixelFormat.mDWFourCC = MAKE_CHAR4('D', 'X', 'T', '3');
-        break;
-      case Image_Format_BC3_UNORM_BLOCK: header.mPixelFormat.mDWFourCC = MAKE_CHAR4('D', 'X', 'T', '5');
-        break;
-      case Image_Format_BC4_UNORM_BLOCK: header.mPixelFormat.mDWFourCC = MAKE_CHAR4('A', 'T', 'I', '1');
-        break;
-      case Image_Format_BC5_UNORM_BLOCK: header.mPixelFormat.mDWFourCC = MAKE_CHAR4('A', 'T', 'I', '2');
-        break;
       default:header.mPixelFormat.mDWFourCC = MAKE_CHAR4('D', 'X', '1', '0');
-        headerDX10.mArraySize = 1;
-        headerDX10.mDXGIFormat = Image_IsCubemap(image) ? D3D10_RESOURCE_MISC_TEXTURECUBE : 0;
-        if (Image_Is1D(image)) {
-          headerDX10.mResourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE1D;
-        } else if (Image_Is2D(image)) {
-          headerDX10.mResourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D;
-        } else if (Image_Is3D(image)) {
-          headerDX10.mResourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE3D;
-        }
-
         switch (image->format) {
           case Image_Format_R32G32B32A32_SFLOAT: headerDX10.mDXGIFormat = 6;
             break;
@@ -161,7 +193,17 @@ EXTERN_C bool Image_SaveDDS(Image_ImageHeader *image, VFile_Handle handle) {
         }
     }
   }
-  // header.
+  if (headerDX10.mDXGIFormat) {
+    headerDX10.mMiscFlag = Image_IsCubemap(image) ? D3D10_RESOURCE_MISC_TEXTURECUBE : 0;
+    headerDX10.mArraySize = 1;
+    if (Image_Is1D(image)) {
+      headerDX10.mResourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE1D;
+    } else if (Image_Is2D(image)) {
+      headerDX10.mResourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D;
+    } else if (Image_Is3D(image)) {
+      headerDX10.mResourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE3D;
+    }
+  }
 
   header.mCaps.mDWCaps1 =
       DDSCAPS_TEXTURE | (Image_LinkedImageCountOf(image) > 1 ? DDSCAPS_MIPMAP | DDSCAPS_COMPLEX : 0) |
@@ -186,12 +228,15 @@ EXTERN_C bool Image_SaveDDS(Image_ImageHeader *image, VFile_Handle handle) {
 //    swapPixelChannels(pData, size / nChannels, nChannels, 0, 2);
 //  }
 
-  for (uint32_t mipMapLevel = 0; mipMapLevel < header.mDWMipMapCount; mipMapLevel++) {
-    Image_ImageHeader const *face = Image_LinkedImageOf(image, mipMapLevel);
+  // DDS stores the whole mip chain of each slice/face in turn
+  for (uint32_t slice = 0; slice < image->slices; ++slice) {
+    for (uint32_t mipMapLevel = 0; mipMapLevel < header.mDWMipMapCount; mipMapLevel++) {
+      Image_ImageHeader const *face = Image_LinkedImageOf(image, mipMapLevel);
 
-    size_t faceSize = Image_ByteCountOf(face);
-    void *src = Image_RawDataPtr(face);
-    file->Write(src, faceSize);
+      size_t faceSize = Image_ByteCountPerSliceOf(face);
+      uint8_t const *src = ((uint8_t const *) Image_RawDataPtr(face)) + slice * faceSize;
+      file->Write(src, faceSize);
+    }
   }
 
   file->Close();
@@ -203,6 +248,351 @@ EXTERN_C bool Image_SaveDDS(Image_ImageHeader *image, VFile_Handle handle) {
 
   return true;
 }
+namespace {
+
+struct KTX2PackedLevel {
+  uint8_t const *src;
+  size_t srcSize;
+  uint8_t *packed;
+  size_t packedSize;
+};
+
+struct KTX2CompressJob {
+  KTX2PackedLevel *levels;
+  Image_KTX2Supercompression supercompression;
+};
+
+// a failed level is left with no packed data
+void KTX2CompressLevel(void *data, uint32_t index) {
+  KTX2CompressJob const *job = (KTX2CompressJob const *) data;
+  KTX2PackedLevel *level = job->levels + index;
+
+  if (job->supercompression == Image_KTX2_Deflate) {
+    mz_ulong packedSize = mz_compressBound((mz_ulong) level->srcSize);
+    level->packed = (uint8_t *) malloc(packedSize);
+    if (level->packed &&
+        mz_compress2(level->packed, &packedSize, level->src, (mz_ulong) level->srcSize,
+                     MZ_DEFAULT_COMPRESSION) == MZ_OK) {
+      level->packedSize = packedSize;
+    }
+  } else if (level->srcSize <= LZ4_MAX_INPUT_SIZE) {
+    int const bound = LZ4_compressBound((int) level->srcSize);
+    level->packed = (uint8_t *) malloc(bound);
+    if (level->packed) {
+      level->packedSize = (size_t) LZ4_compress_default((char const *) level->src, (char *) level->packed,
+                                                        (int) level->srcSize, bound);
+    }
+  }
+}
+
+// bytes KTX2 uses for the element size in endian conversion
+uint32_t KTX2TypeSizeOf(Image_Format format) {
+  if (Image_Format_IsCompressed(format)) { return 1; }
+  if (Image_Format_IsHomogenous(format) && Image_Format_ChannelBitWidth(format, 0) >= 8) {
+    return Image_Format_ChannelBitWidth(format, 0) / 8;
+  }
+  // packed formats swap as a whole
+  return Image_Format_BitWidth(format) / 8;
+}
+
+uint32_t KTX2ColourModelOf(Image_Format format) {
+  switch (format) {
+    case Image_Format_BC1_RGB_UNORM_BLOCK:
+    case Image_Format_BC1_RGB_SRGB_BLOCK:
+    case Image_Format_BC1_RGBA_UNORM_BLOCK:
+    case Image_Format_BC1_RGBA_SRGB_BLOCK: return 128;
+    case Image_Format_BC2_UNORM_BLOCK:
+    case Image_Format_BC2_SRGB_BLOCK: return 129;
+    case Image_Format_BC3_UNORM_BLOCK:
+    case Image_Format_BC3_SRGB_BLOCK: return 130;
+    case Image_Format_BC4_UNORM_BLOCK:
+    case Image_Format_BC4_SNORM_BLOCK: return 131;
+    case Image_Format_BC5_UNORM_BLOCK:
+    case Image_Format_BC5_SNORM_BLOCK: return 132;
+    case Image_Format_BC6H_UFLOAT_BLOCK:
+    case Image_Format_BC6H_SFLOAT_BLOCK: return 133;
+    case Image_Format_BC7_UNORM_BLOCK:
+    case Image_Format_BC7_SRGB_BLOCK: return 134;
+    default: return Image_Format_IsPVR(format) ? 164 : 1; // PVRTC or RGBSDA
+  }
+}
+
+uint32_t *KTX2AddSample(uint32_t *sample,
+                        uint32_t bitOffset,
+                        uint32_t bitLength,
+                        uint32_t channelType,
+                        uint32_t lower,
+                        uint32_t upper) {
+  sample[0] = bitOffset | ((bitLength - 1) << 16) | (channelType << 24);
+  sample[1] = 0; // sample position is the block origin
+  sample[2] = lower;
+  sample[3] = upper;
+  return sample + 4;
+}
+
+// block compressed formats have a sample per independently coded part of
+// the block, using the compressed colour model's channel ids
+uint32_t KTX2CompressedSamples(Image_Format format, uint32_t *samples) {
+  uint32_t const qualifiers = Image_Format_IsSigned(format) ? KTX2_DFD_SIGNED : 0;
+  uint32_t const lower = qualifiers ? 0x80000000u : 0;
+  uint32_t const upper = qualifiers ? 0x7FFFFFFFu : 0xFFFFFFFFu;
+  uint32_t *sample = samples;
+  switch (format) {
+    case Image_Format_BC1_RGBA_UNORM_BLOCK:
+    case Image_Format_BC1_RGBA_SRGB_BLOCK:
+      sample = KTX2AddSample(sample, 0, 64, 1, lower, upper);
+      break;
+    case Image_Format_BC2_UNORM_BLOCK:
+    case Image_Format_BC2_SRGB_BLOCK:
+    case Image_Format_BC3_UNORM_BLOCK:
+    case Image_Format_BC3_SRGB_BLOCK:
+      sample = KTX2AddSample(sample, 0, 64, 15 | KTX2_DFD_LINEAR, lower, upper);
+      sample = KTX2AddSample(sample, 64, 64, 0, lower, upper);
+      break;
+    case Image_Format_BC5_UNORM_BLOCK:
+    case Image_Format_BC5_SNORM_BLOCK:
+      sample = KTX2AddSample(sample, 0, 64, qualifiers, lower, upper);
+      sample = KTX2AddSample(sample, 64, 64, 1 | qualifiers, lower, upper);
+      break;
+    case Image_Format_BC6H_UFLOAT_BLOCK:
+    case Image_Format_BC6H_SFLOAT_BLOCK:
+      sample = KTX2AddSample(sample, 0, 128, KTX2_DFD_FLOAT | qualifiers,
+                             qualifiers ? 0xBF800000u : 0, 0x3F800000u);
+      break;
+    case Image_Format_BC7_UNORM_BLOCK:
+    case Image_Format_BC7_SRGB_BLOCK:
+      sample = KTX2AddSample(sample, 0, 128, 0, lower, upper);
+      break;
+    default: // BC1 RGB, BC4 and PVRTC are a single 64 bit sample
+      sample = KTX2AddSample(sample, 0, 64, qualifiers, lower, upper);
+      break;
+  }
+  return (uint32_t) (sample - samples) / 4;
+}
+
+struct KTX2Channel {
+  char name;
+  uint32_t bitOffset;
+  uint32_t bitLength;
+  char const *type;
+};
+
+uint32_t KTX2ChannelIdOf(char name) {
+  switch (name) {
+    case 'R': return 0;
+    case 'G': return 1;
+    case 'B': return 2;
+    case 'S': return 13;
+    case 'D': return 14;
+    default: return 15; // alpha
+  }
+}
+
+// uncompressed format names are Vulkan's, channel groups each followed by
+// their type (D24_UNORM_S8_UINT). Byte formats are in memory order, packed
+// formats list their channels from the most significant bit down
+uint32_t KTX2UncompressedSamples(Image_Format format, uint32_t *samples) {
+  char const *name = Image_Format_Name(format);
+  bool const packed = strstr(name, "_PACK") != nullptr;
+  KTX2Channel channels[KTX2_DFD_MAX_SAMPLES];
+  uint32_t channelCount = 0;
+  uint32_t totalBits = 0;
+  while (*name) {
+    uint32_t const first = channelCount;
+    while (name[0] >= 'A' && name[0] <= 'Z' && name[1] >= '0' && name[1] <= '9' &&
+        channelCount < KTX2_DFD_MAX_SAMPLES) {
+      KTX2Channel &channel = channels[channelCount++];
+      channel.name = *name++;
+      channel.bitLength = 0;
+      while (*name >= '0' && *name <= '9') {
+        channel.bitLength = channel.bitLength * 10 + (uint32_t) (*name++ - '0');
+      }
+      channel.bitOffset = totalBits;
+      totalBits += channel.bitLength;
+    }
+    if (*name == '_') { name++; }
+    char const *type = name;
+    while (*name && *name != '_') { name++; }
+    if (*name == '_') { name++; }
+    for (uint32_t i = first; i < channelCount; ++i) {
+      channels[i].type = type;
+    }
+  }
+  if (packed) {
+    for (uint32_t i = 0; i < channelCount; ++i) {
+      channels[i].bitOffset = totalBits - channels[i].bitOffset - channels[i].bitLength;
+    }
+  }
+
+  // samples go in bit order
+  uint32_t *sample = samples;
+  for (uint32_t bit = 0; bit < totalBits; ++bit) {
+    for (uint32_t i = 0; i < channelCount; ++i) {
+      KTX2Channel const &channel = channels[i];
+      if (channel.bitOffset != bit || channel.name == 'X') { continue; }
+
+      uint32_t const id = KTX2ChannelIdOf(channel.name);
+      uint32_t const max = (uint32_t) ((1ull << channel.bitLength) - 1);
+      uint32_t const signedMax = (uint32_t) ((1ull << (channel.bitLength - 1)) - 1);
+      if (strncmp(channel.type, "SNORM", 5) == 0) {
+        sample = KTX2AddSample(sample, bit, channel.bitLength, id | KTX2_DFD_SIGNED, 0u - signedMax, signedMax);
+      } else if (strncmp(channel.type, "SINT", 4) == 0 || strncmp(channel.type, "SSCALED", 7) == 0) {
+        sample = KTX2AddSample(sample, bit, channel.bitLength, id | KTX2_DFD_SIGNED, 0xFFFFFFFFu, 1);
+      } else if (strncmp(channel.type, "UINT", 4) == 0 || strncmp(channel.type, "USCALED", 7) == 0) {
+        sample = KTX2AddSample(sample, bit, channel.bitLength, id, 0, 1);
+      } else if (strncmp(channel.type, "SFLOAT", 6) == 0) {
+        sample = KTX2AddSample(sample, bit, channel.bitLength, id | KTX2_DFD_FLOAT | KTX2_DFD_SIGNED,
+                               0xBF800000u, 0x3F800000u);
+      } else if (strncmp(channel.type, "UFLOAT", 6) == 0) {
+        sample = KTX2AddSample(sample, bit, channel.bitLength, id | KTX2_DFD_FLOAT, 0, 0x3F800000u);
+      } else {
+        // UNORM and SRGB, whose alpha stays linear
+        uint32_t const linear = (id == 15 && Image_Format_IsSRGB(format)) ? KTX2_DFD_LINEAR : 0;
+        sample = KTX2AddSample(sample, bit, channel.bitLength, id | linear, 0, max);
+      }
+    }
+  }
+  return (uint32_t) (sample - samples) / 4;
+}
+
+uint32_t GreatestCommonDivisor(uint32_t a, uint32_t b) {
+  while (b) {
+    uint32_t const t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+} // end anon namespace
+
+EXTERN_C bool Image_SaveKTX2(Image_ImageHeader *image,
+                             VFile_Handle handle,
+                             Image_KTX2Supercompression supercompression) {
+  using namespace Image;
+
+  if (!handle) {
+    return false;
+  }
+  if (Image_IsTiled(image)) {
+    LOGERROR("KTX2 files are linear, convert tiled images before saving");
+    return false;
+  }
+  uint32_t const vkFormat = KTX2VkFormatOf(image->format);
+  if (vkFormat == 0 || Image_Format_BitWidth(image->format) == 0) {
+    LOGERRORF("%s can't be saved as KTX2", Image_Format_Name(image->format));
+    return false;
+  }
+
+  uint32_t const levelCount = (uint32_t) Image_LinkedImageCountOf(image);
+  uint32_t const faceCount = Image_IsCubemap(image) ? 6 : 1;
+  bool const isCompressed = Image_Format_IsCompressed(image->format);
+  uint32_t const bw = isCompressed ? Image_Format_WidthOfBlock(image->format) : 1;
+  uint32_t const bh = isCompressed ? Image_Format_HeightOfBlock(image->format) : 1;
+  uint32_t const blockBytes = (Image_Format_BitWidth(image->format) * bw * bh) / 8;
+
+  KTX2Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.identifier, KTX2Identifier, sizeof(KTX2Identifier));
+  header.vkFormat = vkFormat;
+  header.typeSize = KTX2TypeSizeOf(image->format);
+  header.pixelWidth = image->width;
+  header.pixelHeight = Image_Is1D(image) ? 0 : image->height;
+  header.pixelDepth = Image_Is3D(image) ? image->depth : 0;
+  header.layerCount = (image->slices / faceCount) > 1 ? image->slices / faceCount : 0;
+  header.faceCount = faceCount;
+  header.levelCount = levelCount;
+  switch (supercompression) {
+    case Image_KTX2_Deflate: header.supercompressionScheme = KTX2_SUPERCOMPRESSION_ZLIB;
+      break;
+    case Image_KTX2_LZ4: header.supercompressionScheme = KTX2_SUPERCOMPRESSION_WYRD_LZ4;
+      break;
+    default: header.supercompressionScheme = KTX2_SUPERCOMPRESSION_NONE;
+      break;
+  }
+
+  // a basic data format descriptor, the total size then one block
+  // describing how the channels sit in a texel block
+  uint32_t dfd[1 + (KTX2_DFD_BASIC_BLOCK_SIZE + KTX2_DFD_SAMPLE_SIZE * KTX2_DFD_MAX_SAMPLES) / 4];
+  uint32_t const sampleCount = isCompressed ? KTX2CompressedSamples(image->format, dfd + 7) :
+                               KTX2UncompressedSamples(image->format, dfd + 7);
+  uint32_t const blockSize = KTX2_DFD_BASIC_BLOCK_SIZE + KTX2_DFD_SAMPLE_SIZE * sampleCount;
+  dfd[0] = 4 + blockSize;
+  dfd[1] = 0; // vendor and descriptor type 0 (Khronos basic)
+  dfd[2] = 2 | (blockSize << 16); // version 2
+  dfd[3] = KTX2ColourModelOf(image->format) |
+      (1 << 8) | // BT709 primaries
+      ((Image_Format_IsSRGB(image->format) ? 2 : 1) << 16);
+  dfd[4] = (bw - 1) | ((bh - 1) << 8);
+  dfd[5] = (supercompression == Image_KTX2_None) ? blockBytes : 0;
+  dfd[6] = 0;
+
+  header.dfdByteOffset = sizeof(KTX2Header) + sizeof(KTX2LevelIndex) * levelCount;
+  header.dfdByteLength = dfd[0];
+
+  KTX2PackedLevel levels[32];
+  ASSERT(levelCount <= 32);
+  for (uint32_t i = 0; i < levelCount; ++i) {
+    Image_ImageHeader const *level = Image_LinkedImageOf(image, i);
+    levels[i].src = (uint8_t const *) Image_RawDataPtr(level);
+    levels[i].srcSize = Image_ByteCountOf(level);
+    levels[i].packed = nullptr;
+    levels[i].packedSize = 0;
+  }
+
+  bool ok = true;
+  if (supercompression != Image_KTX2_None) {
+    KTX2CompressJob job = {levels, supercompression};
+    Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &KTX2CompressLevel, &job, levelCount);
+    for (uint32_t i = 0; i < levelCount; ++i) {
+      ok = ok && levels[i].packedSize != 0;
+    }
+    if (!ok) {
+      LOGERROR("KTX2 supercompression failed");
+    }
+  }
+
+  if (ok) {
+    // levels are stored smallest first so streaming can start with a
+    // complete low res chain. Uncompressed levels are aligned to
+    // lcm(texel block size, 4)
+    uint32_t const alignment = (supercompression == Image_KTX2_None) ?
+                               (blockBytes * 4) / GreatestCommonDivisor(blockBytes, 4) : 1;
+    KTX2LevelIndex index[32];
+    uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+    for (uint32_t i = levelCount; i-- > 0;) {
+      offset = ((offset + alignment - 1) / alignment) * alignment;
+      index[i].byteOffset = offset;
+      index[i].byteLength = levels[i].packed ? levels[i].packedSize : levels[i].srcSize;
+      index[i].uncompressedByteLength = levels[i].srcSize;
+      offset += index[i].byteLength;
+    }
+
+    VFile::File *file = VFile::File::FromHandle(handle);
+    file->Write(&header, sizeof(header));
+    file->Write(index, sizeof(KTX2LevelIndex) * levelCount);
+    file->Write(dfd, header.dfdByteLength);
+
+    uint64_t written = header.dfdByteOffset + header.dfdByteLength;
+    uint8_t const padding[16] = {0};
+    for (uint32_t i = levelCount; i-- > 0;) {
+      while (written < index[i].byteOffset) {
+        size_t const padSize = (size_t) (index[i].byteOffset - written) < sizeof(padding) ?
+                               (size_t) (index[i].byteOffset - written) : sizeof(padding);
+        file->Write(padding, padSize);
+        written += padSize;
+      }
+      file->Write(levels[i].packed ? levels[i].packed : levels[i].src, (size_t) index[i].byteLength);
+      written += index[i].byteLength;
+    }
+  }
+
+  for (uint32_t i = 0; i < levelCount; ++i) {
+    free(levels[i].packed);
+  }
+  return ok;
+}
+
 /*
 bool convertAndSaveImage(const Image& image, bool (Image::*saverFunction)(const char *), const char *fileName) {
   bool bSaveImageSuccess = false;
@@ -222,15 +612,11 @@ static void stbIoCallbackWrite(void *user, void *data, int size) {
   VFile_Write(handle, data, size);
 }
 
-EXTERN_C bool Image_SaveTGA(Image_ImageHeader *image, VFile_Handle handle) {
-  using namespace Image;
-
-  if (!handle) {
-    return false;
-  }
-  void *src = Image_RawDataPtr(image);
+namespace {
 
-  switch (image->format) {
+// channel count of 8 bit formats stb can write as is, 0 if not
+int StbLDRChannelCountOf(Image_Format format) {
+  switch (format) {
     case Image_Format_R8_UINT:
     case Image_Format_R8_SINT:
     case Image_Format_R8_UNORM:
@@ -238,8 +624,7 @@ EXTERN_C bool Image_SaveTGA(Image_ImageHeader *image, VFile_Handle handle) {
     case Image_Format_R8_USCALED:
     case Image_Format_R8_SSCALED:
     case Image_Format_R8_SRGB:
-      return 0 != stbi_write_tga_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 1, src);
+      return 1;
     case Image_Format_R8G8_UINT:
     case Image_Format_R8G8_SINT:
     case Image_Format_R8G8_UNORM:
@@ -247,8 +632,7 @@ EXTERN_C bool Image_SaveTGA(Image_ImageHeader *image, VFile_Handle handle) {
     case Image_Format_R8G8_USCALED:
     case Image_Format_R8G8_SSCALED:
     case Image_Format_R8G8_SRGB:
-      return 0 != stbi_write_tga_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 2, src);
+      return 2;
     case Image_Format_R8G8B8_UINT:
     case Image_Format_R8G8B8_SINT:
     case Image_Format_R8G8B8_UNORM:
@@ -256,8 +640,7 @@ EXTERN_C bool Image_SaveTGA(Image_ImageHeader *image, VFile_Handle handle) {
     case Image_Format_R8G8B8_USCALED:
     case Image_Format_R8G8B8_SSCALED:
     case Image_Format_R8G8B8_SRGB:
-      return 0 != stbi_write_tga_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 3, src);
+      return 3;
     case Image_Format_R8G8B8A8_UINT:
     case Image_Format_R8G8B8A8_SINT:
     case Image_Format_R8G8B8A8_UNORM:
@@ -265,200 +648,424 @@ EXTERN_C bool Image_SaveTGA(Image_ImageHeader *image, VFile_Handle handle) {
     case Image_Format_R8G8B8A8_USCALED:
     case Image_Format_R8G8B8A8_SSCALED:
     case Image_Format_R8G8B8A8_SRGB:
-      return 0 != stbi_write_tga_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 4, src);
-    default: {
-      // uncompress/convert and try again
-      //return convertAndSaveImage(*this, &Image::iSaveTGA, fileName);
-      return false;
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+int StbHDRChannelCountOf(Image_Format format) {
+  switch (format) {
+    case Image_Format_R32_SFLOAT: return 1;
+    case Image_Format_R32G32_SFLOAT: return 2;
+    case Image_Format_R32G32B32_SFLOAT: return 3;
+    case Image_Format_R32G32B32A32_SFLOAT: return 4;
+    default: return 0;
+  }
+}
+
+// most stb writers want tightly packed rows, so copy the first page of a
+// strided view out if needed
+struct PackedPage {
+  explicit PackedPage(Image_View const *view) {
+    size_t const rowBytes = Image_ViewByteCountPerRowOf(view);
+    if (view->rowStride == rowBytes) {
+      data = view->data;
+      return;
+    }
+    owned = (uint8_t *) malloc(rowBytes * view->height);
+    if (!owned) { return; }
+    for (uint32_t y = 0; y < view->height; ++y) {
+      memcpy(owned + y * rowBytes, view->data + y * view->rowStride, rowBytes);
     }
+    data = owned;
   }
+  ~PackedPage() { free(owned); }
+
+  uint8_t const *data = nullptr;
+  uint8_t *owned = nullptr;
+};
+
+bool FirstPageOf(Image_ImageHeader const *image, Image_View *view) {
+  return Image_ViewOfRegion(image, 0, 0, 0, 0, image->width, image->height, 1, view);
 }
 
-EXTERN_C bool Image_SaveBMP(Image_ImageHeader *image, VFile_Handle handle) {
-  using namespace Image;
+// filtered bytes per deflate stripe. Each stripe is deflated on its own by a
+// worker so can't reference the stripe before it, larger stripes lose less
+#define PNG_STRIPE_BYTES (256 * 1024)
 
-  if (!handle) {
-    return false;
+struct PNGStripe {
+  uint32_t firstRow;
+  uint32_t rowCount;
+  // IDAT data, the first stripe has the zlib header in front
+  uint8_t *data;
+  size_t dataSize;
+  // of the IDAT type and data
+  uint32_t crc;
+  // of the filtered rows
+  uint32_t adler;
+  size_t filteredSize;
+};
+
+struct PNGEncodeJob {
+  Image_View const *view;
+  uint32_t bpp;
+  int level;
+  Image_PNGFilter filter;
+  PNGStripe *stripes;
+  uint32_t stripeCount;
+};
+
+int PNGPaeth(int a, int b, int c) {
+  int const p = a + b - c;
+  int const pa = abs(p - a);
+  int const pb = abs(p - b);
+  int const pc = abs(p - c);
+  if (pa <= pb && pa <= pc) { return a; }
+  return (pb <= pc) ? b : c;
+}
+
+// writes the filter type then the row filtered by it. prev is null for the
+// first row of the image
+void PNGFilterRow(uint8_t const *row, uint8_t const *prev, size_t rowBytes, uint32_t bpp,
+                  uint8_t type, uint8_t *out) {
+  *out++ = type;
+  switch (type) {
+    case 0: memcpy(out, row, rowBytes);
+      break;
+    case 1:
+      for (size_t i = 0; i < rowBytes; ++i) {
+        out[i] = (uint8_t) (row[i] - (i >= bpp ? row[i - bpp] : 0));
+      }
+      break;
+    case 2:
+      for (size_t i = 0; i < rowBytes; ++i) {
+        out[i] = (uint8_t) (row[i] - (prev ? prev[i] : 0));
+      }
+      break;
+    case 3:
+      for (size_t i = 0; i < rowBytes; ++i) {
+        int const a = i >= bpp ? row[i - bpp] : 0;
+        int const b = prev ? prev[i] : 0;
+        out[i] = (uint8_t) (row[i] - ((a + b) >> 1));
+      }
+      break;
+    case 4:
+      for (size_t i = 0; i < rowBytes; ++i) {
+        int const a = i >= bpp ? row[i - bpp] : 0;
+        int const b = prev ? prev[i] : 0;
+        int const c = (prev && i >= bpp) ? prev[i - bpp] : 0;
+        out[i] = (uint8_t) (row[i] - PNGPaeth(a, b, c));
+      }
+      break;
+    default: ASSERT(false);
   }
-  void *src = Image_RawDataPtr(image);
+}
 
-  switch (image->format) {
-    case Image_Format_R8_UINT:
-    case Image_Format_R8_SINT:
-    case Image_Format_R8_UNORM:
-    case Image_Format_R8_SNORM:
-    case Image_Format_R8_USCALED:
-    case Image_Format_R8_SSCALED:
-    case Image_Format_R8_SRGB:
-      return 0 != stbi_write_bmp_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 1, src);
-    case Image_Format_R8G8_UINT:
-    case Image_Format_R8G8_SINT:
-    case Image_Format_R8G8_UNORM:
-    case Image_Format_R8G8_SNORM:
-    case Image_Format_R8G8_USCALED:
-    case Image_Format_R8G8_SSCALED:
-    case Image_Format_R8G8_SRGB:
-      return 0 != stbi_write_bmp_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 2, src);
-    case Image_Format_R8G8B8_UINT:
-    case Image_Format_R8G8B8_SINT:
-    case Image_Format_R8G8B8_UNORM:
-    case Image_Format_R8G8B8_SNORM:
-    case Image_Format_R8G8B8_USCALED:
-    case Image_Format_R8G8B8_SSCALED:
-    case Image_Format_R8G8B8_SRGB:
-      return 0 != stbi_write_bmp_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 3, src);
-    case Image_Format_R8G8B8A8_UINT:
-    case Image_Format_R8G8B8A8_SINT:
-    case Image_Format_R8G8B8A8_UNORM:
-    case Image_Format_R8G8B8A8_SNORM:
-    case Image_Format_R8G8B8A8_USCALED:
-    case Image_Format_R8G8B8A8_SSCALED:
-    case Image_Format_R8G8B8A8_SRGB:
-      return 0 != stbi_write_bmp_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 4, src);
-    default: {
-      // uncompress/convert and try again
-      //return convertAndSaveImage(*this, &Image::iSaveTGA, fileName);
-      return false;
+// the usual heuristic, smallest sum of the filtered bytes as signed values
+uint32_t PNGFilterCost(uint8_t const *filtered, size_t rowBytes) {
+  uint32_t cost = 0;
+  for (size_t i = 1; i <= rowBytes; ++i) {
+    cost += (uint32_t) abs((int) (int8_t) filtered[i]);
+  }
+  return cost;
+}
+
+// filters and deflates one stripe of rows, a failed stripe has no data
+void PNGEncodeStripe(void *data, uint32_t index) {
+  PNGEncodeJob const *job = (PNGEncodeJob const *) data;
+  PNGStripe *stripe = job->stripes + index;
+  Image_View const *view = job->view;
+
+  size_t const rowBytes = view->width * job->bpp;
+  stripe->filteredSize = stripe->rowCount * (rowBytes + 1);
+  uint8_t *filtered = (uint8_t *) malloc(stripe->filteredSize);
+  uint8_t *trial = (uint8_t *) malloc(rowBytes + 1);
+  if (!filtered || !trial) {
+    free(filtered);
+    free(trial);
+    return;
+  }
+
+  for (uint32_t i = 0; i < stripe->rowCount; ++i) {
+    uint32_t const y = stripe->firstRow + i;
+    uint8_t const *row = view->data + y * view->rowStride;
+    uint8_t const *prev = y ? row - view->rowStride : nullptr;
+    uint8_t *out = filtered + i * (rowBytes + 1);
+    if (job->filter != Image_PNGFilter_Adaptive) {
+      PNGFilterRow(row, prev, rowBytes, job->bpp, (uint8_t) (job->filter - Image_PNGFilter_None), out);
+      continue;
+    }
+    PNGFilterRow(row, prev, rowBytes, job->bpp, 0, out);
+    uint32_t bestCost = PNGFilterCost(out, rowBytes);
+    for (uint8_t type = 1; type < 5; ++type) {
+      PNGFilterRow(row, prev, rowBytes, job->bpp, type, trial);
+      uint32_t const cost = PNGFilterCost(trial, rowBytes);
+      if (cost < bestCost) {
+        bestCost = cost;
+        memcpy(out, trial, rowBytes + 1);
+      }
     }
   }
+  free(trial);
+  stripe->adler = (uint32_t) mz_adler32(MZ_ADLER32_INIT, filtered, stripe->filteredSize);
+
+  // raw deflate, all but the last stripe end on a sync flush so they are
+  // byte aligned and the streams can simply be joined
+  bool const first = index == 0;
+  bool const last = index == job->stripeCount - 1;
+  mz_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (mz_deflateInit2(&stream, job->level, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 9, MZ_DEFAULT_STRATEGY) != MZ_OK) {
+    free(filtered);
+    return;
+  }
+  size_t const headerSize = first ? 2 : 0;
+  size_t const bound = headerSize + mz_deflateBound(&stream, (mz_ulong) stripe->filteredSize) + 64;
+  uint8_t *out = (uint8_t *) malloc(bound);
+  if (out) {
+    if (first) {
+      // zlib header, 32K window and the level hint
+      static uint8_t const levelFlags[4] = {0x01, 0x5E, 0x9C, 0xDA};
+      out[0] = 0x78;
+      out[1] = levelFlags[job->level < 2 ? 0 : job->level < 6 ? 1 : job->level == 6 ? 2 : 3];
+    }
+    stream.next_in = filtered;
+    stream.avail_in = (unsigned int) stripe->filteredSize;
+    stream.next_out = out + headerSize;
+    stream.avail_out = (unsigned int) (bound - headerSize);
+    int const status = mz_deflate(&stream, last ? MZ_FINISH : MZ_SYNC_FLUSH);
+    if ((last && status == MZ_STREAM_END) || (!last && status == MZ_OK && stream.avail_in == 0)) {
+      stripe->data = out;
+      stripe->dataSize = headerSize + stream.total_out;
+      stripe->crc = (uint32_t) mz_crc32(MZ_CRC32_INIT, (uint8_t const *) "IDAT", 4);
+      stripe->crc = (uint32_t) mz_crc32(stripe->crc, out, stripe->dataSize);
+    } else {
+      free(out);
+    }
+  }
+  mz_deflateEnd(&stream);
+  free(filtered);
 }
 
-EXTERN_C bool Image_SavePNG(Image_ImageHeader *image, VFile_Handle handle) {
-  using namespace Image;
+// adler32 of two joined blocks from the adler32 of each, as zlib does it
+uint32_t PNGAdler32Combine(uint32_t adler1, uint32_t adler2, size_t len2) {
+  uint32_t const base = 65521;
+  uint32_t const rem = (uint32_t) (len2 % base);
+  uint32_t sum1 = adler1 & 0xFFFF;
+  uint32_t sum2 = (uint32_t) (((uint64_t) rem * sum1) % base);
+  sum1 += (adler2 & 0xFFFF) + base - 1;
+  sum2 += (adler1 >> 16) + (adler2 >> 16) + base - rem;
+  if (sum1 >= base) { sum1 -= base; }
+  if (sum1 >= base) { sum1 -= base; }
+  if (sum2 >= (base << 1)) { sum2 -= (base << 1); }
+  if (sum2 >= base) { sum2 -= base; }
+  return sum1 | (sum2 << 16);
+}
 
-  if (!handle) {
+void PNGPutU32(uint8_t *out, uint32_t v) {
+  out[0] = (uint8_t) (v >> 24);
+  out[1] = (uint8_t) (v >> 16);
+  out[2] = (uint8_t) (v >> 8);
+  out[3] = (uint8_t) v;
+}
+
+void PNGWriteChunk(VFile_Handle handle, char const type[4], uint8_t const *data, uint32_t size) {
+  uint8_t header[8];
+  PNGPutU32(header, size);
+  memcpy(header + 4, type, 4);
+  uint8_t crc[4];
+  PNGPutU32(crc, (uint32_t) mz_crc32(mz_crc32(MZ_CRC32_INIT, header + 4, 4), data, size));
+  VFile_Write(handle, header, sizeof(header));
+  if (size) { VFile_Write(handle, data, size); }
+  VFile_Write(handle, crc, sizeof(crc));
+}
+
+bool PNGWrite(Image_View const *view, VFile_Handle handle, uint32_t channels, Image_PNGSaveOptions const *options) {
+  PNGEncodeJob job;
+  job.view = view;
+  job.bpp = channels;
+  job.level = Math_ClampI32(options->compressionLevel, 0, 9);
+  job.filter = options->filter;
+  if (job.filter < Image_PNGFilter_Adaptive || job.filter > Image_PNGFilter_Paeth) {
+    LOGERROR("Unknown PNG filter");
     return false;
   }
-  void *src = Image_RawDataPtr(image);
 
-  switch (image->format) {
-    case Image_Format_R8_UINT:
-    case Image_Format_R8_SINT:
-    case Image_Format_R8_UNORM:
-    case Image_Format_R8_SNORM:
-    case Image_Format_R8_USCALED:
-    case Image_Format_R8_SSCALED:
-    case Image_Format_R8_SRGB:
-      return 0 != stbi_write_png_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 1, src, 0);
-    case Image_Format_R8G8_UINT:
-    case Image_Format_R8G8_SINT:
-    case Image_Format_R8G8_UNORM:
-    case Image_Format_R8G8_SNORM:
-    case Image_Format_R8G8_USCALED:
-    case Image_Format_R8G8_SSCALED:
-    case Image_Format_R8G8_SRGB:
-      return 0 != stbi_write_png_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 2, src, 0);
-    case Image_Format_R8G8B8_UINT:
-    case Image_Format_R8G8B8_SINT:
-    case Image_Format_R8G8B8_UNORM:
-    case Image_Format_R8G8B8_SNORM:
-    case Image_Format_R8G8B8_USCALED:
-    case Image_Format_R8G8B8_SSCALED:
-    case Image_Format_R8G8B8_SRGB:
-      return 0 != stbi_write_png_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 3, src, 0);
-    case Image_Format_R8G8B8A8_UINT:
-    case Image_Format_R8G8B8A8_SINT:
-    case Image_Format_R8G8B8A8_UNORM:
-    case Image_Format_R8G8B8A8_SNORM:
-    case Image_Format_R8G8B8A8_USCALED:
-    case Image_Format_R8G8B8A8_SSCALED:
-    case Image_Format_R8G8B8A8_SRGB:
-      return 0 != stbi_write_png_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 4, src, 0);
-    default: {
-      // uncompress/convert and try again
-      //return convertAndSaveImage(*this, &Image::iSaveTGA, fileName);
-      return false;
+  size_t const rowBytes = view->width * channels;
+  uint32_t const stripeRows = (uint32_t) Math_MaxU64(1, PNG_STRIPE_BYTES / (rowBytes + 1));
+  job.stripeCount = (view->height + stripeRows - 1) / stripeRows;
+  job.stripes = (PNGStripe *) calloc(job.stripeCount, sizeof(PNGStripe));
+  if (!job.stripes) { return false; }
+  for (uint32_t i = 0; i < job.stripeCount; ++i) {
+    job.stripes[i].firstRow = i * stripeRows;
+    job.stripes[i].rowCount = Math_MinU32(stripeRows, view->height - i * stripeRows);
+  }
+  Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &PNGEncodeStripe, &job, job.stripeCount);
+
+  bool ok = true;
+  for (uint32_t i = 0; i < job.stripeCount; ++i) {
+    ok = ok && job.stripes[i].data;
+  }
+
+  if (ok) {
+    static uint8_t const signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    static uint8_t const colourTypes[5] = {0, 0, 4, 2, 6};
+    VFile_Write(handle, signature, sizeof(signature));
+
+    uint8_t ihdr[13];
+    PNGPutU32(ihdr, view->width);
+    PNGPutU32(ihdr + 4, view->height);
+    ihdr[8] = 8;
+    ihdr[9] = colourTypes[channels];
+    ihdr[10] = 0; // deflate
+    ihdr[11] = 0; // adaptive filtering
+    ihdr[12] = 0; // not interlaced
+    PNGWriteChunk(handle, "IHDR", ihdr, sizeof(ihdr));
+
+    // a IDAT per stripe, the zlib adler32 goes on the end of the last one
+    uint32_t adler = MZ_ADLER32_INIT;
+    for (uint32_t i = 0; i < job.stripeCount; ++i) {
+      PNGStripe const *stripe = job.stripes + i;
+      adler = PNGAdler32Combine(adler, stripe->adler, stripe->filteredSize);
+      bool const last = i == job.stripeCount - 1;
+
+      uint8_t header[8];
+      PNGPutU32(header, (uint32_t) (stripe->dataSize + (last ? 4 : 0)));
+      memcpy(header + 4, "IDAT", 4);
+      VFile_Write(handle, header, sizeof(header));
+      VFile_Write(handle, stripe->data, stripe->dataSize);
+      uint32_t crc = stripe->crc;
+      if (last) {
+        uint8_t trailer[4];
+        PNGPutU32(trailer, adler);
+        VFile_Write(handle, trailer, sizeof(trailer));
+        crc = (uint32_t) mz_crc32(crc, trailer, sizeof(trailer));
+      }
+      uint8_t crcBytes[4];
+      PNGPutU32(crcBytes, crc);
+      VFile_Write(handle, crcBytes, sizeof(crcBytes));
     }
+    PNGWriteChunk(handle, "IEND", nullptr, 0);
   }
+
+  for (uint32_t i = 0; i < job.stripeCount; ++i) {
+    free(job.stripes[i].data);
+  }
+  free(job.stripes);
+  return ok;
+}
+
+} // end anon namespace
+
+EXTERN_C bool Image_SaveTGA(Image_ImageHeader *image, VFile_Handle handle) {
+  Image_View view;
+  return FirstPageOf(image, &view) && Image_SaveViewTGA(&view, handle);
+}
+
+EXTERN_C bool Image_SaveBMP(Image_ImageHeader *image, VFile_Handle handle) {
+  Image_View view;
+  return FirstPageOf(image, &view) && Image_SaveViewBMP(&view, handle);
+}
+
+EXTERN_C bool Image_SavePNG(Image_ImageHeader *image, VFile_Handle handle) {
+  Image_View view;
+  return FirstPageOf(image, &view) && Image_SaveViewPNG(&view, handle);
+}
+
+EXTERN_C bool Image_SavePNGWithOptions(Image_ImageHeader *image,
+                                       VFile_Handle handle,
+                                       Image_PNGSaveOptions const *options) {
+  Image_View view;
+  return FirstPageOf(image, &view) && Image_SaveViewPNGWithOptions(&view, handle, options);
 }
 
 EXTERN_C bool Image_SaveJPG(Image_ImageHeader *image, VFile_Handle handle) {
-  using namespace Image;
+  Image_View view;
+  return FirstPageOf(image, &view) && Image_SaveViewJPG(&view, handle);
+}
 
+EXTERN_C bool Image_SaveHDR(Image_ImageHeader *image, VFile_Handle handle) {
+  Image_View view;
+  return FirstPageOf(image, &view) && Image_SaveViewHDR(&view, handle);
+}
+
+EXTERN_C bool Image_SaveViewTGA(Image_View const *view, VFile_Handle handle) {
   if (!handle) {
     return false;
   }
-  void *src = Image_RawDataPtr(image);
+  int const channels = StbLDRChannelCountOf(view->format);
+  if (channels == 0) {
+    // uncompress/convert and try again
+    return false;
+  }
+  PackedPage page(view);
+  if (!page.data) { return false; }
+  return 0 != stbi_write_tga_to_func(&stbIoCallbackWrite, handle,
+                                     view->width, view->height, channels, page.data);
+}
 
-  switch (image->format) {
-    case Image_Format_R8_UINT:
-    case Image_Format_R8_SINT:
-    case Image_Format_R8_UNORM:
-    case Image_Format_R8_SNORM:
-    case Image_Format_R8_USCALED:
-    case Image_Format_R8_SSCALED:
-    case Image_Format_R8_SRGB:
-      return 0 != stbi_write_jpg_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 1, src, 0);
-    case Image_Format_R8G8_UINT:
-    case Image_Format_R8G8_SINT:
-    case Image_Format_R8G8_UNORM:
-    case Image_Format_R8G8_SNORM:
-    case Image_Format_R8G8_USCALED:
-    case Image_Format_R8G8_SSCALED:
-    case Image_Format_R8G8_SRGB:
-      return 0 != stbi_write_jpg_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 2, src, 0);
-    case Image_Format_R8G8B8_UINT:
-    case Image_Format_R8G8B8_SINT:
-    case Image_Format_R8G8B8_UNORM:
-    case Image_Format_R8G8B8_SNORM:
-    case Image_Format_R8G8B8_USCALED:
-    case Image_Format_R8G8B8_SSCALED:
-    case Image_Format_R8G8B8_SRGB:
-      return 0 != stbi_write_jpg_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 3, src, 0);
-    case Image_Format_R8G8B8A8_UINT:
-    case Image_Format_R8G8B8A8_SINT:
-    case Image_Format_R8G8B8A8_UNORM:
-    case Image_Format_R8G8B8A8_SNORM:
-    case Image_Format_R8G8B8A8_USCALED:
-    case Image_Format_R8G8B8A8_SSCALED:
-    case Image_Format_R8G8B8A8_SRGB:
-      return 0 != stbi_write_jpg_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 4, src, 0);
-    default: {
-      // uncompress/convert and try again
-      //return convertAndSaveImage(*this, &Image::iSaveTGA, fileName);
-      return false;
-    }
+EXTERN_C bool Image_SaveViewBMP(Image_View const *view, VFile_Handle handle) {
+  if (!handle) {
+    return false;
   }
+  int const channels = StbLDRChannelCountOf(view->format);
+  if (channels == 0) {
+    return false;
+  }
+  PackedPage page(view);
+  if (!page.data) { return false; }
+  return 0 != stbi_write_bmp_to_func(&stbIoCallbackWrite, handle,
+                                     view->width, view->height, channels, page.data);
 }
 
-EXTERN_C bool Image_SaveHDR(Image_ImageHeader *image, VFile_Handle handle) {
-  using namespace Image;
+EXTERN_C bool Image_SaveViewPNG(Image_View const *view, VFile_Handle handle) {
+  return Image_SaveViewPNGWithOptions(view, handle, nullptr);
+}
 
+EXTERN_C bool Image_SaveViewPNGWithOptions(Image_View const *view,
+                                           VFile_Handle handle,
+                                           Image_PNGSaveOptions const *options) {
   if (!handle) {
     return false;
   }
-  float const *src = (float const*) Image_RawDataPtr(image);
-
-  switch (image->format) {
-    case Image_Format_R32_SFLOAT:
-      return 0 != stbi_write_hdr_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 1, src);
-    case Image_Format_R32G32_SFLOAT:
-      return 0 != stbi_write_hdr_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 2, src);
-    case Image_Format_R32G32B32_SFLOAT:
-      return 0 != stbi_write_hdr_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 3, src);
-    case Image_Format_R32G32B32A32_SFLOAT:
-      return 0 != stbi_write_hdr_to_func(&stbIoCallbackWrite, handle,
-                                         image->width, image->height, 4, src);
-    default: {
-      // uncompress/convert and try again
-      //return convertAndSaveImage(*this, &Image::iSaveTGA, fileName);
-      return false;
-    }
+  int const channels = StbLDRChannelCountOf(view->format);
+  if (channels == 0) {
+    return false;
+  }
+  if (view->width == 0 || view->height == 0) {
+    LOGERROR("Can't save an empty PNG");
+    return false;
+  }
+  Image_PNGSaveOptions const defaultOptions = {IMAGE_PNG_DEFAULT_COMPRESSION, Image_PNGFilter_Adaptive};
+  // rows are read through the stride so never need packing
+  return PNGWrite(view, handle, (uint32_t) channels, options ? options : &defaultOptions);
+}
+
+EXTERN_C bool Image_SaveViewJPG(Image_View const *view, VFile_Handle handle) {
+  if (!handle) {
+    return false;
   }
-}
\ No newline at end of file
+  int const channels = StbLDRChannelCountOf(view->format);
+  if (channels == 0) {
+    return false;
+  }
+  PackedPage page(view);
+  if (!page.data) { return false; }
+  return 0 != stbi_write_jpg_to_func(&stbIoCallbackWrite, handle,
+                                     view->width, view->height, channels, page.data, 0);
+}
+
+EXTERN_C bool Image_SaveViewHDR(Image_View const *view, VFile_Handle handle) {
+  if (!handle) {
+    return false;
+  }
+  int const channels = StbHDRChannelCountOf(view->format);
+  if (channels == 0) {
+    return false;
+  }
+  PackedPage page(view);
+  if (!page.data) { return false; }
+  return 0 != stbi_write_hdr_to_func(&stbIoCallbackWrite, handle,
+                                     view->width, view->height, channels, (float const *) page.data);
+}
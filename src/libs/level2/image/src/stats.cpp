@@ -0,0 +1,730 @@
+#include "core/core.h"
+#include "core/logger.h"
+#include "math/math.h"
+#include "os/threadpool.h"
+#include "image/format.h"
+#include "image/format_cracker.h"
+#include "image/image.h"
+#include "image/utils.h"
+#include "image/view.h"
+#include <cfloat>
+
+#if CPU_FAMILY == CPU_X64
+#include <emmintrin.h>
+#define IMAGE_STATS_SSE 1
+#else
+#define IMAGE_STATS_SSE 0
+#endif
+
+namespace {
+
+// rows are handed out in a few chunks per thread, enough to balance
+// without the partial results getting large
+uint32_t ChunkCountFor(size_t rowCount) {
+  uint32_t const threads = Os_ThreadPoolWorkerCount(Os_ThreadPoolGlobal()) + 1;
+  size_t const chunks = threads * 4;
+  return (uint32_t) (rowCount < chunks ? rowCount : chunks);
+}
+
+// formats we can read/write a row of directly as floats, all of these have
+// R first and no swizzle so the channels are stored in rgba order
+enum class RowKind {
+  Generic,
+  UNorm8,
+  UNorm16,
+  Float16,
+  Float32,
+};
+
+RowKind RowKindOf(Image_Format format) {
+  switch (format) {
+    case Image_Format_R8_UNORM:
+    case Image_Format_R8G8_UNORM:
+    case Image_Format_R8G8B8_UNORM:
+    case Image_Format_R8G8B8A8_UNORM: return RowKind::UNorm8;
+    case Image_Format_R16_UNORM:
+    case Image_Format_R16G16_UNORM:
+    case Image_Format_R16G16B16_UNORM:
+    case Image_Format_R16G16B16A16_UNORM: return RowKind::UNorm16;
+    case Image_Format_R16_SFLOAT:
+    case Image_Format_R16G16_SFLOAT:
+    case Image_Format_R16G16B16_SFLOAT:
+    case Image_Format_R16G16B16A16_SFLOAT: return RowKind::Float16;
+    case Image_Format_R32_SFLOAT:
+    case Image_Format_R32G32_SFLOAT:
+    case Image_Format_R32G32B32_SFLOAT:
+    case Image_Format_R32G32B32A32_SFLOAT: return RowKind::Float32;
+    default: return RowKind::Generic;
+  }
+}
+
+// expands a row of native pixels to 4 floats per pixel, missing channels are 0
+void FetchRowRGBA(RowKind kind, uint32_t channelCount, void const *src, uint32_t width, float *dst) {
+  memset(dst, 0, sizeof(float) * 4 * width);
+  switch (kind) {
+    case RowKind::UNorm8: {
+      uint8_t const *s = (uint8_t const *) src;
+      for (uint32_t x = 0; x < width; ++x, s += channelCount) {
+        for (uint32_t c = 0; c < channelCount; ++c) {
+          dst[x * 4 + c] = (float) s[c] * (1.0f / 255.0f);
+        }
+      }
+      break;
+    }
+    case RowKind::UNorm16: {
+      uint16_t const *s = (uint16_t const *) src;
+      for (uint32_t x = 0; x < width; ++x, s += channelCount) {
+        for (uint32_t c = 0; c < channelCount; ++c) {
+          dst[x * 4 + c] = (float) s[c] * (1.0f / 65535.0f);
+        }
+      }
+      break;
+    }
+    case RowKind::Float16: {
+      uint16_t const *s = (uint16_t const *) src;
+      for (uint32_t x = 0; x < width; ++x, s += channelCount) {
+        for (uint32_t c = 0; c < channelCount; ++c) {
+          dst[x * 4 + c] = Math_Half2Float(s[c]);
+        }
+      }
+      break;
+    }
+    case RowKind::Float32: {
+      float const *s = (float const *) src;
+      if (channelCount == 4) {
+        memcpy(dst, s, sizeof(float) * 4 * width);
+      } else {
+        for (uint32_t x = 0; x < width; ++x, s += channelCount) {
+          for (uint32_t c = 0; c < channelCount; ++c) {
+            dst[x * 4 + c] = s[c];
+          }
+        }
+      }
+      break;
+    }
+    default: ASSERT(false);
+  }
+}
+
+void StoreRowRGBA(RowKind kind, uint32_t channelCount, float const *src, uint32_t width, void *dst) {
+  switch (kind) {
+    case RowKind::UNorm8: {
+      uint8_t *d = (uint8_t *) dst;
+      for (uint32_t x = 0; x < width; ++x, d += channelCount) {
+        for (uint32_t c = 0; c < channelCount; ++c) {
+          float const v = Math_ClampF(src[x * 4 + c], 0.0f, 1.0f);
+          d[c] = (uint8_t) (v * 255.0f + 0.5f);
+        }
+      }
+      break;
+    }
+    case RowKind::UNorm16: {
+      uint16_t *d = (uint16_t *) dst;
+      for (uint32_t x = 0; x < width; ++x, d += channelCount) {
+        for (uint32_t c = 0; c < channelCount; ++c) {
+          float const v = Math_ClampF(src[x * 4 + c], 0.0f, 1.0f);
+          d[c] = (uint16_t) (v * 65535.0f + 0.5f);
+        }
+      }
+      break;
+    }
+    case RowKind::Float16: {
+      uint16_t *d = (uint16_t *) dst;
+      for (uint32_t x = 0; x < width; ++x, d += channelCount) {
+        for (uint32_t c = 0; c < channelCount; ++c) {
+          d[c] = Math_Float2Half(src[x * 4 + c]);
+        }
+      }
+      break;
+    }
+    case RowKind::Float32: {
+      float *d = (float *) dst;
+      for (uint32_t x = 0; x < width; ++x, d += channelCount) {
+        for (uint32_t c = 0; c < channelCount; ++c) {
+          d[c] = src[x * 4 + c];
+        }
+      }
+      break;
+    }
+    default: ASSERT(false);
+  }
+}
+
+// running statistics of part of an image, merged with Chan et al's
+// parallel variance update so each row can be reduced independently
+struct Partial {
+  uint64_t count;
+  double min[4];
+  double max[4];
+  double mean[4];
+  double m2[4];
+};
+
+void PartialInit(Partial *p) {
+  p->count = 0;
+  for (int i = 0; i < 4; ++i) {
+    p->min[i] = DBL_MAX;
+    p->max[i] = -DBL_MAX;
+    p->mean[i] = 0.0;
+    p->m2[i] = 0.0;
+  }
+}
+
+void PartialMerge(Partial *a, Partial const *b) {
+  if (b->count == 0) { return; }
+  if (a->count == 0) {
+    *a = *b;
+    return;
+  }
+  double const n = (double) (a->count + b->count);
+  double const na = (double) a->count;
+  double const nb = (double) b->count;
+  for (int i = 0; i < 4; ++i) {
+    double const delta = b->mean[i] - a->mean[i];
+    a->mean[i] += delta * (nb / n);
+    a->m2[i] += b->m2[i] + delta * delta * (na * nb / n);
+    a->min[i] = b->min[i] < a->min[i] ? b->min[i] : a->min[i];
+    a->max[i] = b->max[i] > a->max[i] ? b->max[i] : a->max[i];
+  }
+  a->count += b->count;
+}
+
+struct HistogramSetup {
+  uint64_t *bins; // 4 * binCount, only channels with user bins are counted
+  uint32_t binCount;
+  bool channelWanted[4];
+  double rangeMin;
+  double binScale;
+};
+
+inline void HistogramAdd(HistogramSetup const *h, int channel, double v) {
+  double const f = (v - h->rangeMin) * h->binScale;
+  uint32_t bin;
+  if (!(f > 0.0)) { bin = 0; } // catches nan as well
+  else if (f >= (double) h->binCount) { bin = h->binCount - 1; }
+  else { bin = (uint32_t) f; }
+  h->bins[channel * h->binCount + bin]++;
+}
+
+// two passes over a row that is already in cache, the second pass gives a
+// well conditioned sum of squares around the rows own mean
+void ReduceRowF(float const *row, uint32_t width, HistogramSetup const *hist, Partial *out) {
+#if IMAGE_STATS_SSE
+  __m128 mn = _mm_set1_ps(FLT_MAX);
+  __m128 mx = _mm_set1_ps(-FLT_MAX);
+  __m128d sumLo = _mm_setzero_pd();
+  __m128d sumHi = _mm_setzero_pd();
+  for (uint32_t x = 0; x < width; ++x) {
+    __m128 const v = _mm_loadu_ps(row + x * 4);
+    mn = _mm_min_ps(mn, v);
+    mx = _mm_max_ps(mx, v);
+    sumLo = _mm_add_pd(sumLo, _mm_cvtps_pd(v));
+    sumHi = _mm_add_pd(sumHi, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+  }
+  __m128d const invN = _mm_set1_pd(1.0 / (double) width);
+  __m128d const meanLo = _mm_mul_pd(sumLo, invN);
+  __m128d const meanHi = _mm_mul_pd(sumHi, invN);
+  __m128d m2Lo = _mm_setzero_pd();
+  __m128d m2Hi = _mm_setzero_pd();
+  for (uint32_t x = 0; x < width; ++x) {
+    __m128 const v = _mm_loadu_ps(row + x * 4);
+    __m128d const dLo = _mm_sub_pd(_mm_cvtps_pd(v), meanLo);
+    __m128d const dHi = _mm_sub_pd(_mm_cvtps_pd(_mm_movehl_ps(v, v)), meanHi);
+    m2Lo = _mm_add_pd(m2Lo, _mm_mul_pd(dLo, dLo));
+    m2Hi = _mm_add_pd(m2Hi, _mm_mul_pd(dHi, dHi));
+  }
+  float fmn[4], fmx[4];
+  _mm_storeu_ps(fmn, mn);
+  _mm_storeu_ps(fmx, mx);
+  Partial part;
+  part.count = width;
+  _mm_storeu_pd(part.mean + 0, meanLo);
+  _mm_storeu_pd(part.mean + 2, meanHi);
+  _mm_storeu_pd(part.m2 + 0, m2Lo);
+  _mm_storeu_pd(part.m2 + 2, m2Hi);
+  for (int i = 0; i < 4; ++i) {
+    part.min[i] = fmn[i];
+    part.max[i] = fmx[i];
+  }
+#else
+  Partial part;
+  PartialInit(&part);
+  part.count = width;
+  double sum[4] = {0, 0, 0, 0};
+  for (uint32_t x = 0; x < width; ++x) {
+    for (int i = 0; i < 4; ++i) {
+      double const v = row[x * 4 + i];
+      part.min[i] = v < part.min[i] ? v : part.min[i];
+      part.max[i] = v > part.max[i] ? v : part.max[i];
+      sum[i] += v;
+    }
+  }
+  for (int i = 0; i < 4; ++i) { part.mean[i] = sum[i] / (double) width; }
+  for (uint32_t x = 0; x < width; ++x) {
+    for (int i = 0; i < 4; ++i) {
+      double const d = row[x * 4 + i] - part.mean[i];
+      part.m2[i] += d * d;
+    }
+  }
+#endif
+  if (hist) {
+    for (uint32_t x = 0; x < width; ++x) {
+      for (int i = 0; i < 4; ++i) {
+        if (hist->channelWanted[i]) { HistogramAdd(hist, i, row[x * 4 + i]); }
+      }
+    }
+  }
+  PartialMerge(out, &part);
+}
+
+// fallback for formats without a native row path (packed, srgb, 64 bit etc.)
+// these are already slow per pixel fetches so a welford update costs little
+void ReduceRowD(Image_View const *view, uint32_t y, uint32_t z,
+                HistogramSetup const *hist, Partial *out) {
+  Partial part;
+  PartialInit(&part);
+  for (uint32_t x = 0; x < view->width; ++x) {
+    Image_PixelD pixel = {0, 0, 0, 0};
+    Image_ViewGetPixelAt(view, &pixel, x, y, z);
+    double const *v = &pixel.r;
+    part.count++;
+    for (int i = 0; i < 4; ++i) {
+      part.min[i] = v[i] < part.min[i] ? v[i] : part.min[i];
+      part.max[i] = v[i] > part.max[i] ? v[i] : part.max[i];
+      double const delta = v[i] - part.mean[i];
+      part.mean[i] += delta / (double) part.count;
+      part.m2[i] += delta * (v[i] - part.mean[i]);
+      if (hist && hist->channelWanted[i]) { HistogramAdd(hist, i, v[i]); }
+    }
+  }
+  PartialMerge(out, &part);
+}
+
+struct StatsJob {
+  Image_View const *view;
+  RowKind kind;
+  uint32_t channelCount;
+  size_t rowCount;
+  uint32_t chunkCount;
+  Partial *partials;
+  HistogramSetup *hists; // NULL if no histogram
+  float *rows;           // 4 floats per pixel, a row per chunk, NULL for Generic
+};
+
+void StatsChunk(void *data, uint32_t chunk) {
+  StatsJob const *job = (StatsJob const *) data;
+  Image_View const *view = job->view;
+  size_t const rowBegin = (job->rowCount * chunk) / job->chunkCount;
+  size_t const rowEnd = (job->rowCount * (chunk + 1)) / job->chunkCount;
+  Partial *partial = job->partials + chunk;
+  HistogramSetup const *hist = job->hists ? job->hists + chunk : nullptr;
+  PartialInit(partial);
+
+  if (job->kind == RowKind::Generic) {
+    for (size_t r = rowBegin; r < rowEnd; ++r) {
+      ReduceRowD(view, (uint32_t) (r % view->height), (uint32_t) (r / view->height), hist, partial);
+    }
+    return;
+  }
+
+  float *row = job->rows + (size_t) chunk * 4 * view->width;
+  for (size_t r = rowBegin; r < rowEnd; ++r) {
+    uint8_t const *src = Image_ViewPixelPtr(view, 0, (uint32_t) (r % view->height), (uint32_t) (r / view->height));
+    FetchRowRGBA(job->kind, job->channelCount, src, view->width, row);
+    ReduceRowF(row, view->width, hist, partial);
+  }
+}
+
+// row buffers for every chunk are allocated before going wide so running
+// out of memory fails the call instead of a chunk quietly skipping its rows
+float *AllocChunkRows(uint32_t chunkCount, uint32_t width) {
+  float *rows = (float *) malloc(sizeof(float) * 4 * (size_t) width * chunkCount);
+  if (!rows) {
+    LOGERROR("Out of memory for image row buffers");
+  }
+  return rows;
+}
+
+bool CalculateStatistics(Image_View const *view, Partial *result,
+                         Image_Histogram const *histogram, double rangeMin, double rangeMax) {
+  size_t const rowCount = (size_t) view->height * view->depth;
+  PartialInit(result);
+  if (rowCount == 0 || view->width == 0) { return true; }
+
+  StatsJob job;
+  job.view = view;
+  job.kind = RowKindOf(view->format);
+  job.channelCount = Image_Format_ChannelCount(view->format);
+  job.rowCount = rowCount;
+  job.chunkCount = ChunkCountFor(rowCount);
+  job.partials = (Partial *) malloc(sizeof(Partial) * job.chunkCount);
+  job.hists = nullptr;
+  job.rows = (job.kind == RowKind::Generic) ? nullptr : AllocChunkRows(job.chunkCount, view->width);
+  if (!job.partials || (!job.rows && job.kind != RowKind::Generic)) {
+    free(job.rows);
+    free(job.partials);
+    return false;
+  }
+
+  uint64_t *binStore = nullptr;
+  if (histogram) {
+    size_t const binsPerChunk = 4 * (size_t) histogram->binCount;
+    binStore = (uint64_t *) calloc(binsPerChunk * job.chunkCount, sizeof(uint64_t));
+    job.hists = (HistogramSetup *) malloc(sizeof(HistogramSetup) * job.chunkCount);
+    if (!binStore || !job.hists) {
+      free(binStore);
+      free(job.hists);
+      free(job.rows);
+      free(job.partials);
+      return false;
+    }
+    for (uint32_t i = 0; i < job.chunkCount; ++i) {
+      HistogramSetup *h = job.hists + i;
+      h->bins = binStore + binsPerChunk * i;
+      h->binCount = histogram->binCount;
+      for (uint32_t c = 0; c < 4; ++c) {
+        h->channelWanted[c] = histogram->bins[c] != nullptr && c < job.channelCount;
+      }
+      h->rangeMin = rangeMin;
+      h->binScale = (double) histogram->binCount / (rangeMax - rangeMin);
+    }
+  }
+
+  Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &StatsChunk, &job, job.chunkCount);
+
+  for (uint32_t i = 0; i < job.chunkCount; ++i) {
+    PartialMerge(result, job.partials + i);
+  }
+
+  if (histogram) {
+    for (uint32_t c = 0; c < 4; ++c) {
+      if (!job.hists[0].channelWanted[c]) { continue; }
+      uint64_t *dst = histogram->bins[c];
+      memset(dst, 0, sizeof(uint64_t) * histogram->binCount);
+      for (uint32_t i = 0; i < job.chunkCount; ++i) {
+        uint64_t const *src = job.hists[i].bins + c * histogram->binCount;
+        for (uint32_t b = 0; b < histogram->binCount; ++b) {
+          dst[b] += src[b];
+        }
+      }
+    }
+    free(job.hists);
+    free(binStore);
+  }
+
+  free(job.rows);
+  free(job.partials);
+  return true;
+}
+
+struct ScaleJob {
+  Image_View const *view;
+  RowKind kind;
+  uint32_t channelCount;
+  size_t rowCount;
+  uint32_t chunkCount;
+  double scale[4];
+  double bias[4];
+  float *rows; // as StatsJob, NULL for Generic and UNorm8
+};
+
+void ScaleChunk(void *data, uint32_t chunk) {
+  ScaleJob const *job = (ScaleJob const *) data;
+  Image_View const *view = job->view;
+  size_t const rowBegin = (job->rowCount * chunk) / job->chunkCount;
+  size_t const rowEnd = (job->rowCount * (chunk + 1)) / job->chunkCount;
+
+  if (job->kind == RowKind::Generic) {
+    for (size_t r = rowBegin; r < rowEnd; ++r) {
+      uint32_t const y = (uint32_t) (r % view->height);
+      uint32_t const z = (uint32_t) (r / view->height);
+      for (uint32_t x = 0; x < view->width; ++x) {
+        Image_PixelD pixel;
+        Image_ViewGetPixelAt(view, &pixel, x, y, z);
+        pixel.r = pixel.r * job->scale[0] + job->bias[0];
+        pixel.g = pixel.g * job->scale[1] + job->bias[1];
+        pixel.b = pixel.b * job->scale[2] + job->bias[2];
+        pixel.a = pixel.a * job->scale[3] + job->bias[3];
+        Image_ViewSetPixelAt(view, &pixel, x, y, z);
+      }
+    }
+    return;
+  }
+
+  // 8 bit unorm has so few values a per channel table beats any arithmetic
+  if (job->kind == RowKind::UNorm8) {
+    uint8_t table[4][256];
+    for (uint32_t c = 0; c < job->channelCount; ++c) {
+      for (uint32_t v = 0; v < 256; ++v) {
+        double const d = ((double) v / 255.0) * job->scale[c] + job->bias[c];
+        table[c][v] = (uint8_t) (Math_ClampD(d, 0.0, 1.0) * 255.0 + 0.5);
+      }
+    }
+    for (size_t r = rowBegin; r < rowEnd; ++r) {
+      uint8_t *p = Image_ViewPixelPtr(view, 0, (uint32_t) (r % view->height), (uint32_t) (r / view->height));
+      for (uint32_t x = 0; x < view->width; ++x) {
+        for (uint32_t c = 0; c < job->channelCount; ++c) {
+          p[c] = table[c][p[c]];
+        }
+        p += job->channelCount;
+      }
+    }
+    return;
+  }
+
+  float *row = job->rows + (size_t) chunk * 4 * view->width;
+#if IMAGE_STATS_SSE
+  __m128 const s = _mm_setr_ps((float) job->scale[0], (float) job->scale[1],
+                               (float) job->scale[2], (float) job->scale[3]);
+  __m128 const b = _mm_setr_ps((float) job->bias[0], (float) job->bias[1],
+                               (float) job->bias[2], (float) job->bias[3]);
+#endif
+  for (size_t r = rowBegin; r < rowEnd; ++r) {
+    uint8_t *p = Image_ViewPixelPtr(view, 0, (uint32_t) (r % view->height), (uint32_t) (r / view->height));
+    FetchRowRGBA(job->kind, job->channelCount, p, view->width, row);
+#if IMAGE_STATS_SSE
+    for (uint32_t x = 0; x < view->width; ++x) {
+      __m128 const v = _mm_loadu_ps(row + x * 4);
+      _mm_storeu_ps(row + x * 4, _mm_add_ps(_mm_mul_ps(v, s), b));
+    }
+#else
+    for (uint32_t x = 0; x < view->width; ++x) {
+      for (int c = 0; c < 4; ++c) {
+        row[x * 4 + c] = (float) (row[x * 4 + c] * job->scale[c] + job->bias[c]);
+      }
+    }
+#endif
+    StoreRowRGBA(job->kind, job->channelCount, row, view->width, p);
+  }
+}
+
+bool ScaleAndBias(Image_View const *view, double const scale[4], double const bias[4]) {
+  if (Image_Format_IsCompressed(view->format)) {
+    LOGERRORF("%s is compressed and can't be rescaled in place", Image_Format_Name(view->format));
+    return false;
+  }
+  size_t const rowCount = (size_t) view->height * view->depth;
+  if (rowCount == 0 || view->width == 0) { return true; }
+
+  ScaleJob job;
+  job.view = view;
+  job.kind = RowKindOf(view->format);
+  job.channelCount = Image_Format_ChannelCount(view->format);
+  job.rowCount = rowCount;
+  job.chunkCount = ChunkCountFor(rowCount);
+  for (int i = 0; i < 4; ++i) {
+    job.scale[i] = scale[i];
+    job.bias[i] = bias[i];
+  }
+  bool const needsRows = job.kind != RowKind::Generic && job.kind != RowKind::UNorm8;
+  job.rows = needsRows ? AllocChunkRows(job.chunkCount, view->width) : nullptr;
+  if (needsRows && !job.rows) { return false; }
+  Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &ScaleChunk, &job, job.chunkCount);
+  free(job.rows);
+  return true;
+}
+
+// statistics and scaling don't care about pixel order, so a tiled image is
+// walked as one long row per page (which is also tile by tile)
+void AllPixelsViewOf(Image_ImageHeader const *image, Image_View *view) {
+  if (!Image_IsTiled(image)) {
+    Image_ViewOf(image, view);
+    return;
+  }
+  view->data = (uint8_t *) Image_RawDataPtr(image);
+  view->rowStride = Image_ByteCountPerPageOf(image);
+  view->pageStride = Image_ByteCountPerPageOf(image);
+  view->width = (uint32_t) Image_PixelCountPerPageOf(image);
+  view->height = 1;
+  view->depth = image->depth * image->slices;
+  view->format = image->format;
+}
+
+bool ScaleAndBias(Image_ImageHeader const *image, double const scale[4], double const bias[4]) {
+  Image_View view;
+  AllPixelsViewOf(image, &view);
+  return ScaleAndBias(&view, scale, bias);
+}
+
+// scale and bias that maps [min, max] to [0, 1], a flat channel maps to 0
+void NormaliseScaleBias(double min, double max, double *scale, double *bias) {
+  if (max > min) {
+    *scale = 1.0 / (max - min);
+    *bias = -min * *scale;
+  } else {
+    *scale = 0.0;
+    *bias = 0.0;
+  }
+}
+
+} // end anon namespace
+
+EXTERN_C bool Image_CalculateStatisticsOfView(Image_View const *view,
+                                              Image_Statistics *stats,
+                                              Image_Histogram *histogram) {
+  ASSERT(view);
+  ASSERT(stats);
+
+  if (Image_Format_IsCompressed(view->format)) {
+    LOGERRORF("Statistics of compressed format %s not supported", Image_Format_Name(view->format));
+    return false;
+  }
+  if (histogram && (histogram->binCount == 0)) {
+    LOGERROR("Histogram requested with no bins");
+    return false;
+  }
+
+  double rangeMin = 0.0;
+  double rangeMax = 0.0;
+  Partial result;
+  if (histogram && !(histogram->rangeMin < histogram->rangeMax)) {
+    // no range provided so we need the real range first
+    if (!CalculateStatistics(view, &result, nullptr, 0.0, 0.0)) { return false; }
+    uint32_t const channelCount = Image_Format_ChannelCount(view->format);
+    rangeMin = DBL_MAX;
+    rangeMax = -DBL_MAX;
+    for (uint32_t i = 0; i < channelCount; ++i) {
+      if (histogram->bins[i] == nullptr) { continue; }
+      rangeMin = result.min[i] < rangeMin ? result.min[i] : rangeMin;
+      rangeMax = result.max[i] > rangeMax ? result.max[i] : rangeMax;
+    }
+    if (!(rangeMin < rangeMax)) {
+      // a flat image, everything will land in the first bin
+      rangeMax = rangeMin + 1.0;
+    }
+    histogram->rangeMin = rangeMin;
+    histogram->rangeMax = rangeMax;
+  } else if (histogram) {
+    rangeMin = histogram->rangeMin;
+    rangeMax = histogram->rangeMax;
+  }
+
+  if (!CalculateStatistics(view, &result, histogram, rangeMin, rangeMax)) {
+    return false;
+  }
+
+  uint32_t const channelCount = Image_Format_ChannelCount(view->format);
+  double *omin = &stats->min.r;
+  double *omax = &stats->max.r;
+  double *omean = &stats->mean.r;
+  double *ovar = &stats->variance.r;
+  for (uint32_t i = 0; i < 4; ++i) {
+    bool const valid = i < channelCount && result.count > 0;
+    omin[i] = valid ? result.min[i] : 0.0;
+    omax[i] = valid ? result.max[i] : 0.0;
+    omean[i] = valid ? result.mean[i] : 0.0;
+    ovar[i] = valid ? result.m2[i] / (double) result.count : 0.0;
+  }
+  stats->pixelCount = result.count;
+  return true;
+}
+
+EXTERN_C bool Image_CalculateStatisticsOf(Image_ImageHeader const *image,
+                                          Image_Statistics *stats,
+                                          Image_Histogram *histogram) {
+  ASSERT(image);
+  Image_View view;
+  AllPixelsViewOf(image, &view);
+  return Image_CalculateStatisticsOfView(&view, stats, histogram);
+}
+
+EXTERN_C bool Image_ScaleAndBiasOfView(Image_View const *view,
+                                       Image_PixelD const *scale,
+                                       Image_PixelD const *bias) {
+  ASSERT(view);
+  ASSERT(scale);
+  ASSERT(bias);
+  return ScaleAndBias(view, &scale->r, &bias->r);
+}
+
+EXTERN_C bool Image_ScaleAndBiasOf(Image_ImageHeader const *image,
+                                   Image_PixelD const *scale,
+                                   Image_PixelD const *bias) {
+  ASSERT(image);
+  ASSERT(scale);
+  ASSERT(bias);
+  return ScaleAndBias(image, &scale->r, &bias->r);
+}
+
+EXTERN_C bool Image_GetColorRangeOf(Image_ImageHeader const *src, Image_PixelD *omin, Image_PixelD *omax) {
+  ASSERT(src);
+  ASSERT(omin);
+  ASSERT(omax);
+
+  Image_Statistics stats;
+  if (!Image_CalculateStatisticsOf(src, &stats, nullptr)) {
+    return false;
+  }
+  *omin = stats.min;
+  *omax = stats.max;
+  return true;
+}
+
+EXTERN_C bool Image_GetColorRangeOfD(Image_ImageHeader const *src, double *omin, double *omax) {
+
+  Image_PixelD pixelMin;
+  Image_PixelD pixelMax;
+
+  ASSERT(src);
+  ASSERT(omin);
+  ASSERT(omax);
+
+  if (Image_GetColorRangeOf(src, &pixelMin, &pixelMax)) {
+    double *dmin = &pixelMin.r;
+    double *dmax = &pixelMax.r;
+
+    for (uint32_t i = 1u; i < Image_Format_ChannelCount(src->format); ++i) {
+      if (dmin[i] < dmin[0]) {
+        dmin[0] = dmin[i];
+      }
+      if (dmax[i] > dmax[0]) {
+        dmax[0] = dmax[i];
+      }
+    }
+
+    *omin = dmin[0];
+    *omax = dmax[0];
+    return true;
+  }
+
+  return false;
+}
+
+EXTERN_C bool Image_GetColorRangeOfF(Image_ImageHeader const *src, float *omin, float *omax) {
+
+  double dmin, dmax;
+  if (Image_GetColorRangeOfD(src, &dmin, &dmax)) {
+    *omin = (float) dmin;
+    *omax = (float) dmax;
+    return true;
+  }
+  return false;
+}
+
+EXTERN_C bool Image_NormalizeEachChannelOf(Image_ImageHeader const *src) {
+  Image_PixelD pmin, pmax;
+  if (!Image_GetColorRangeOf(src, &pmin, &pmax)) {
+    return false;
+  }
+
+  double scale[4];
+  double bias[4];
+  NormaliseScaleBias(pmin.r, pmax.r, &scale[0], &bias[0]);
+  NormaliseScaleBias(pmin.g, pmax.g, &scale[1], &bias[1]);
+  NormaliseScaleBias(pmin.b, pmax.b, &scale[2], &bias[2]);
+  NormaliseScaleBias(pmin.a, pmax.a, &scale[3], &bias[3]);
+  return ScaleAndBias(src, scale, bias);
+}
+
+EXTERN_C bool Image_NormalizeAcrossChannelsOf(Image_ImageHeader const *src) {
+  double dmin, dmax;
+  if (!Image_GetColorRangeOfD(src, &dmin, &dmax)) {
+    return false;
+  }
+
+  double s, b;
+  NormaliseScaleBias(dmin, dmax, &s, &b);
+  double const scale[4] = {s, s, s, s};
+  double const bias[4] = {b, b, b, b};
+  return ScaleAndBias(src, scale, bias);
+}
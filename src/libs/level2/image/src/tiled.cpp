@@ -0,0 +1,97 @@
+#include "core/core.h"
+#include "core/logger.h"
+#include "os/threadpool.h"
+#include "image/format.h"
+#include "image/format_cracker.h"
+#include "image/image.h"
+
+namespace {
+
+struct RelayoutJob {
+  Image_ImageHeader const *image;
+  uint8_t const *src;
+  uint8_t *dst;
+  bool toTiled;
+};
+
+// moves one band of tiles (IMAGE_TILE_DIM pixel rows of a page) between
+// linear and tiled. Each row of a tile is contiguous in both layouts so this
+// is just memcpys of tile width runs
+void RelayoutTileRow(void *data, uint32_t index) {
+  RelayoutJob const *job = (RelayoutJob const *) data;
+  Image_ImageHeader const *image = job->image;
+
+  uint32_t const tileRows = Image_TileCountYOf(image);
+  uint32_t const page = index / tileRows;
+  uint32_t const ty = (index % tileRows) * IMAGE_TILE_DIM;
+  uint32_t const tileHeight = (image->height - ty) < IMAGE_TILE_DIM ? (image->height - ty) : IMAGE_TILE_DIM;
+  size_t const pixelSize = Image_Format_BitWidth(image->format) / 8;
+  size_t const rowBytes = Image_ByteCountPerRowOf(image);
+  size_t const bandOffset = page * Image_ByteCountPerPageOf(image) + ty * rowBytes;
+
+  for (uint32_t tx = 0; tx < image->width; tx += IMAGE_TILE_DIM) {
+    uint32_t const tileWidth = (image->width - tx) < IMAGE_TILE_DIM ? (image->width - tx) : IMAGE_TILE_DIM;
+    size_t const tileBytes = tileWidth * pixelSize;
+    size_t const tileOffset = bandOffset + tx * tileHeight * pixelSize;
+    for (uint32_t y = 0; y < tileHeight; ++y) {
+      size_t const linear = bandOffset + y * rowBytes + tx * pixelSize;
+      size_t const tiled = tileOffset + y * tileBytes;
+      if (job->toTiled) {
+        memcpy(job->dst + tiled, job->src + linear, tileBytes);
+      } else {
+        memcpy(job->dst + linear, job->src + tiled, tileBytes);
+      }
+    }
+  }
+}
+
+bool Relayout(Image_ImageHeader *image, bool toTiled) {
+  ASSERT(image);
+  if (Image_IsTiled(image) == toTiled) { return true; }
+
+  if (Image_Format_IsCompressed(image->format)) {
+    LOGERRORF("%s is block compressed and can't be tiled", Image_Format_Name(image->format));
+    return false;
+  }
+  // pixels smaller than a byte would need bit shuffling
+  if (Image_Format_BitWidth(image->format) < 8) {
+    LOGERRORF("%s is too small to tile", Image_Format_Name(image->format));
+    return false;
+  }
+
+  // a single tile image is laid out the same either way
+  if (image->width > IMAGE_TILE_DIM || image->height > IMAGE_TILE_DIM) {
+    Image_ImageHeader *scratch = Image_PoolAcquire(Image_PoolGlobal(),
+                                                   image->width, image->height,
+                                                   image->depth, image->slices,
+                                                   image->format);
+    if (!scratch) { return false; }
+    memcpy(Image_RawDataPtr(scratch), Image_RawDataPtr(image), Image_ByteCountOf(image));
+
+    RelayoutJob job;
+    job.image = image;
+    job.src = (uint8_t const *) Image_RawDataPtr(scratch);
+    job.dst = (uint8_t *) Image_RawDataPtr(image);
+    job.toTiled = toTiled;
+    Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &RelayoutTileRow, &job,
+                             Image_TileCountYOf(image) * image->depth * image->slices);
+    Image_Destroy(scratch);
+  }
+
+  if (toTiled) {
+    image->flags |= Image_Flag_Tiled;
+  } else {
+    image->flags &= ~Image_Flag_Tiled;
+  }
+  return true;
+}
+
+} // end anon namespace
+
+EXTERN_C bool Image_ConvertToTiled(Image_ImageHeader *image) {
+  return Relayout(image, true);
+}
+
+EXTERN_C bool Image_ConvertToLinear(Image_ImageHeader *image) {
+  return Relayout(image, false);
+}
@@ -1,154 +1,179 @@
 #include "core/core.h"
+#include "core/logger.h"
+#include "os/threadpool.h"
 #include "image/format.h"
 #include "image/format_cracker.h"
 #include "image/image.h"
 #include "image/utils.h"
+#include "image/view.h"
 #include "hq_resample.hpp"
 
-EXTERN_C bool Image_GetColorRangeOf(Image_ImageHeader const *src, Image_PixelD *omin, Image_PixelD *omax) {
-  ASSERT(src);
-  ASSERT(omin);
-  ASSERT(omax);
-
-  double *minData = &omin->r;
-  double *maxData = &omax->r;
-  for (uint32_t i = 0u; i < Image_Format_ChannelCount(src->format); ++i) {
-    minData[i] = Image_Format_Max(src->format, i);
-    maxData[i] = Image_Format_Min(src->format, i);
-  };
-
-  for (auto w = 0u; w < src->slices; ++w) {
-    for (auto z = 0u; z < src->depth; ++z) {
-      for (auto y = 0u; y < src->height; ++y) {
-        for (auto x = 0u; x < src->width; ++x) {
-          size_t const index = Image_CalculateIndex(src, x, y, z, w);
-          Image_PixelD pixel;
-          Image_GetPixelAt(src, &pixel, index);
-
-          double *data = &pixel.r;
-          for (uint32_t i = 0u; i < Image_Format_ChannelCount(src->format); ++i) {
-            if (data[i] < minData[i]) {
-              minData[i] = data[i];
-            }
-            if (data[i] > maxData[i]) {
-              maxData[i] = data[i];
-            }
-          }
-        }
-      }
+namespace {
+
+// float copy of the image the mips are resampled from
+Image_ImageHeader *AcquireMipSource(Image_ImageHeader const *image) {
+  Image_Format dblFmt = Image_Format_R32G32B32A32_SFLOAT;
+  switch (Image_Format_ChannelCount(image->format)) {
+    case 1:dblFmt = Image_Format_R32_SFLOAT;
+      break;
+    case 2:dblFmt = Image_Format_R32G32_SFLOAT;
+      break;
+    case 3:dblFmt = Image_Format_R32G32B32_SFLOAT;
+      break;
+    case 4:dblFmt = Image_Format_R32G32B32A32_SFLOAT;
+      break;
+    default:
+    case 0: {
+      ASSERT(false);
     }
   }
-
-  return true;
+  // transient float copies come from the scratch pool so repeated mip
+  // generation of similar sized images doesn't keep hitting the allocator
+  Image_ImageHeader *doubleImage = Image_PoolAcquire(Image_PoolGlobal(),
+                                                     image->width, image->height,
+                                                     image->depth, image->slices,
+                                                     dblFmt);
+  // tiled sources stay tiled so the mips can be made a tile at a time
+  doubleImage->flags |= image->flags & Image_Flag_Tiled;
+  Image_CopyImage(doubleImage, image);
+  return doubleImage;
 }
 
-EXTERN_C bool Image_GetColorRangeOfD(Image_ImageHeader const *src, double *omin, double *omax) {
-
-  Image_PixelD pixelMin;
-  Image_PixelD pixelMax;
-
-  ASSERT(src);
-  ASSERT(omin);
-  ASSERT(omax);
-
-  if (Image_GetColorRangeOf(src, &pixelMin, &pixelMax)) {
-    double *dmin = &pixelMin.r;
-    double *dmax = &pixelMax.r;
-
-    for (uint32_t i = 1u; i < Image_Format_ChannelCount(src->format); ++i) {
-      if (dmin[i] < dmin[0]) {
-        dmin[0] = dmin[i];
+struct TiledMipJob {
+  Image_ImageHeader const *src; // float and tiled
+  Image_ImageHeader const *mip; // tiled
+  uint32_t numChans;
+  uint32_t bandCount;           // rows of mip tiles in all slices
+  uint32_t chunkCount;
+  size_t scratchFloats;         // per chunk, the source window then the mip tile
+  float *scratch;
+};
+
+// each mip tile is resampled from just the source tiles its filter taps
+// reach, gathered into a small window, so the filter stays in cache however
+// wide the image is
+void GenerateMipTileChunk(void *data, uint32_t chunk) {
+  using namespace Image;
+  TiledMipJob const *job = (TiledMipJob const *) data;
+  Image_ImageHeader const *src = job->src;
+  Image_ImageHeader const *mip = job->mip;
+  uint32_t const numChans = job->numChans;
+  uint32_t const tileRows = Image_TileCountYOf(mip);
+  float *const window = job->scratch + job->scratchFloats * chunk;
+  float *const tile = window + job->scratchFloats - IMAGE_TILE_DIM * IMAGE_TILE_DIM * numChans;
+
+  uint32_t const bandBegin = (uint32_t) (((uint64_t) job->bandCount * chunk) / job->chunkCount);
+  uint32_t const bandEnd = (uint32_t) (((uint64_t) job->bandCount * (chunk + 1)) / job->chunkCount);
+  for (uint32_t band = bandBegin; band < bandEnd; ++band) {
+    uint32_t const slice = band / tileRows;
+    uint32_t const tileY = band % tileRows;
+    uint32_t const dy = tileY * IMAGE_TILE_DIM;
+    uint32_t const dh = (mip->height - dy) < IMAGE_TILE_DIM ? (mip->height - dy) : IMAGE_TILE_DIM;
+    uint32_t sy0, sy1;
+    hq_resample_window<float>(dy, dh, src->height, mip->height, &sy0, &sy1);
+
+    for (uint32_t tileX = 0; tileX < Image_TileCountXOf(mip); ++tileX) {
+      uint32_t const dx = tileX * IMAGE_TILE_DIM;
+      uint32_t const dw = (mip->width - dx) < IMAGE_TILE_DIM ? (mip->width - dx) : IMAGE_TILE_DIM;
+      uint32_t sx0, sx1;
+      hq_resample_window<float>(dx, dw, src->width, mip->width, &sx0, &sx1);
+      uint32_t const windowWidth = sx1 - sx0 + 1;
+
+      // source rows are contiguous within each tile they cross
+      for (uint32_t sy = sy0; sy <= sy1; ++sy) {
+        float *dst = window + (size_t) (sy - sy0) * windowWidth * numChans;
+        for (uint32_t sx = sx0; sx <= sx1;) {
+          uint32_t const tileEnd = (sx & ~(IMAGE_TILE_DIM - 1)) + IMAGE_TILE_DIM;
+          uint32_t const run = (tileEnd <= sx1 ? tileEnd : sx1 + 1) - sx;
+          float const *from = (float const *) Image_RawDataPtr(src) +
+              Image_CalculateIndex(src, sx, sy, 0, slice) * numChans;
+          memcpy(dst, from, sizeof(float) * run * numChans);
+          dst += run * numChans;
+          sx += run;
+        }
       }
-      if (dmax[i] > dmax[0]) {
-        dmax[i] = dmax[i];
+
+      hq_resample_region<float>(numChans, window, sx0, sy0, windowWidth, src->width, src->height,
+                                tile, dx, dy, dw, dh, mip->width, mip->height);
+
+      Image_View tileView;
+      Image_View floatView;
+      Image_ViewOfTile(mip, tileX, tileY, 0, slice, &tileView);
+      floatView.data = (uint8_t *) tile;
+      floatView.width = dw;
+      floatView.height = dh;
+      floatView.depth = 1;
+      floatView.format = src->format;
+      floatView.rowStride = Image_ViewByteCountPerRowOf(&floatView);
+      floatView.pageStride = floatView.rowStride * dh;
+      for (uint32_t y = 0; y < dh; ++y) {
+        for (uint32_t x = 0; x < dw; ++x) {
+          Image_PixelD pixel = {0, 0, 0, 1};
+          Image_ViewGetPixelAt(&floatView, &pixel, x, y, 0);
+          Image_ViewSetPixelAt(&tileView, &pixel, x, y, 0);
+        }
       }
     }
-
-    *omin = dmin[0];
-    *omax = dmax[0];
-    return true;
   }
-
-  return false;
 }
 
-EXTERN_C bool Image_GetColorRangeOfF(Image_ImageHeader const *src, float *omin, float *omax) {
+void GenerateTiledMip(Image_ImageHeader const *doubleImage, Image_ImageHeader *mip) {
+  uint32_t const numChans = Image_Format_ChannelCount(doubleImage->format);
+  // the widest window a tile's taps can reach
+  uint32_t windowDims[2];
+  uint32_t const srcDims[2] = {doubleImage->width, doubleImage->height};
+  uint32_t const mipDims[2] = {mip->width, mip->height};
+  for (int i = 0; i < 2; ++i) {
+    uint32_t const scale = (srcDims[i] + mipDims[i] - 1) / mipDims[i];
+    windowDims[i] = IMAGE_TILE_DIM * scale + 4;
+    windowDims[i] = windowDims[i] < srcDims[i] ? windowDims[i] : srcDims[i];
+  }
 
-  double dmin, dmax;
-  if (Image_GetColorRangeOfD(src, &dmin, &dmax)) {
-    *omin = (float) dmin;
-    *omax = (float) dmax;
-    return true;
+  TiledMipJob job;
+  job.src = doubleImage;
+  job.mip = mip;
+  job.numChans = numChans;
+  job.bandCount = Image_TileCountYOf(mip) * mip->slices;
+  uint32_t const chunks = 4 * (Os_ThreadPoolWorkerCount(Os_ThreadPoolGlobal()) + 1);
+  job.chunkCount = job.bandCount < chunks ? job.bandCount : chunks;
+  job.scratchFloats = ((size_t) windowDims[0] * windowDims[1] + IMAGE_TILE_DIM * IMAGE_TILE_DIM) * numChans;
+  job.scratch = (float *) malloc(sizeof(float) * job.scratchFloats * job.chunkCount);
+  if (!job.scratch) {
+    LOGERROR("Out of memory generating tiled mip map");
+    memset(Image_RawDataPtr(mip), 0, Image_ByteCountOf(mip));
+    return;
   }
-  return false;
+  Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &GenerateMipTileChunk, &job, job.chunkCount);
+  free(job.scratch);
 }
 
-EXTERN_C bool Image_NormalizeEachChannel(Image_ImageHeader const *src) {
-  Image_PixelD pmin, pmax;
-  if (!Image_GetColorRangeOf(src, &pmin, &pmax)) {
-    return false;
+void GenerateMip(Image_ImageHeader const *doubleImage, Image_ImageHeader *mip) {
+  using namespace Image;
+  if (Image_IsTiled(doubleImage) && Image_IsTiled(mip)) {
+    GenerateTiledMip(doubleImage, mip);
+    return;
   }
 
-  Image_PixelD const s{
-      1.0 / (pmax.r - pmin.r),
-      1.0 / (pmax.g - pmin.g),
-      1.0 / (pmax.b - pmin.b),
-      1.0 / (pmax.a - pmin.a),
-  };
+  uint32_t const numChans = Image_Format_ChannelCount(doubleImage->format);
+  Image_ImageHeader *scratchImage =
+      Image_PoolAcquire(Image_PoolGlobal(), mip->width, mip->height, 1, 1, doubleImage->format);
+  float *const scratch = (float *const) Image_RawDataPtr(scratchImage);
 
-  Image_PixelD const b{
-      -pmin.r * s.r,
-      -pmin.g * s.g,
-      -pmin.b * s.b,
-      -pmin.a * s.a,
-  };
+  for (auto w = 0u; w < doubleImage->slices; ++w) {
+    float const *origSlice = (float const *)
+        (((uint8_t *) Image_RawDataPtr(doubleImage)) + w * Image_ByteCountPerSliceOf(doubleImage));
 
-  for (auto w = 0u; w < src->slices; ++w) {
-    for (auto z = 0u; z < src->depth; ++z) {
-      for (auto y = 0u; y < src->height; ++y) {
-        for (auto x = 0u; x < src->width; ++x) {
-          size_t const index = Image_CalculateIndex(src, x, y, z, w);
-          Image_PixelD pixel;
-          Image_GetPixelAt(src, &pixel, index);
-          pixel.r = pixel.r * s.r + b.r;
-          pixel.g = pixel.g * s.g + b.g;
-          pixel.b = pixel.b * s.b + b.b;
-          pixel.a = pixel.a * s.a + b.a;
-          Image_SetPixelAt(src, &pixel, index);
-        }
-      }
-    }
-  }
-  return true;
-}
+    hq_resample<float>(numChans,
+                       origSlice, doubleImage->width, doubleImage->height,
+                       scratch, mip->width, mip->height);
 
-EXTERN_C bool Image_NormalizeAcrossChannels(Image_ImageHeader const *src) {
-  double dmin, dmax;
-  if (!Image_GetColorRangeOfD(src, &dmin, &dmax)) {
-    return false;
+    Image_CopySlice(mip, w, scratchImage, 0);
   }
+  Image_Destroy(scratchImage);
+}
 
-  double const s = 1.0 / (dmax - dmin);
-  double const b = -dmin * s;
+} // end anon namespace
 
-  for (auto w = 0u; w < src->slices; ++w) {
-    for (auto z = 0u; z < src->depth; ++z) {
-      for (auto y = 0u; y < src->height; ++y) {
-        for (auto x = 0u; x < src->width; ++x) {
-          size_t const index = Image_CalculateIndex(src, x, y, z, w);
-          Image_PixelD pixel;
-          Image_GetPixelAt(src, &pixel, index);
-          pixel.r = pixel.r * s + b;
-          pixel.g = pixel.g * s + b;
-          pixel.b = pixel.b * s + b;
-          pixel.a = pixel.a * s + b;
-          Image_SetPixelAt(src, &pixel, index);
-        }
-      }
-    }
-  }
-  return true;
-}
 // TODO optimise or have option for faster mipmap chain generation
 EXTERN_C void Image_CreateMipMapChain(Image_ImageHeader *image, bool generateFromImage) {
   // start from the image provided and create successive mip images
@@ -159,61 +184,22 @@ EXTERN_C void Image_CreateMipMapChain(Image_ImageHeader *image, bool generateFro
   // need to think about mip mapped volume textures...
   ASSERT(image->depth == 1);
 
-  using namespace Image;
-
   Image_ImageHeader *curImage = image;
   uint32_t curWidth = image->width;
   uint32_t curHeight = image->height;
-  if (curWidth <= 1 || curHeight <= 1) { return; }
-
-  Image_ImageHeader *doubleImage = nullptr;
-  Image_ImageHeader *scratchImage = nullptr;
-
-  uint32_t const numChans = Image_Format_ChannelCount(image->format);
-  if (generateFromImage) {
-    Image_Format dblFmt = Image_Format_R32G32B32A32_SFLOAT;
-    switch (numChans) {
-      case 1:dblFmt = Image_Format_R32_SFLOAT;
-        break;
-      case 2:dblFmt = Image_Format_R32G32_SFLOAT;
-        break;
-      case 3:dblFmt = Image_Format_R32G32B32_SFLOAT;
-        break;
-      case 4:dblFmt = Image_Format_R32G32B32A32_SFLOAT;
-        break;
-      default:
-      case 0: {
-        ASSERT(false);
-      }
-    }
-    doubleImage = Image_Create(image->width, image->height,
-                               image->depth, image->slices,
-                               dblFmt);
-    Image_CopyImage(doubleImage, image);
+  if (curWidth <= 1 && curHeight <= 1) { return; }
 
-    scratchImage = Image_Create(image->width / 2, image->height / 2,
-                                1, 1, dblFmt);
-  }
+  Image_ImageHeader *doubleImage = generateFromImage ? AcquireMipSource(image) : nullptr;
 
   do {
-    curWidth = curWidth / 2;
-    curHeight = curHeight / 2;
+    curWidth = curWidth > 1 ? curWidth / 2 : 1;
+    curHeight = curHeight > 1 ? curHeight / 2 : 1;
 
     Image_ImageHeader *newImage = Image_Create(curWidth, curHeight, 1, image->slices, image->format);
+    newImage->flags |= image->flags & Image_Flag_Tiled;
 
     if (generateFromImage) {
-      float *const scratch = (float *const) Image_RawDataPtr(scratchImage);
-
-      for (auto w = 0u; w < image->slices; ++w) {
-        float const *origSlice = (float const *)
-            (((uint8_t *) Image_RawDataPtr(image)) + w * Image_ByteCountPerSliceOf(image));
-
-        hq_resample<float>(numChans,
-                           origSlice, image->width, image->height,
-                           scratch, curWidth, curHeight);
-
-        Image_CopySlice(newImage, w, scratchImage, 0);
-      }
+      GenerateMip(doubleImage, newImage);
     }
 
     curImage->nextImage = newImage;
@@ -224,9 +210,39 @@ EXTERN_C void Image_CreateMipMapChain(Image_ImageHeader *image, bool generateFro
   if (doubleImage) {
     Image_Destroy(doubleImage);
   }
-  if (scratchImage) {
-    Image_Destroy(scratchImage);
+}
+
+EXTERN_C Image_ImageHeader *Image_CreatePackedMipMapChain(Image_ImageHeader const *image,
+                                                          bool generateFromImage,
+                                                          uint32_t alignment) {
+  ASSERT(image->nextType == Image_IT_None);
+  ASSERT(Math_IsPowerOf2U32(image->width));
+  ASSERT(Math_IsPowerOf2U32(image->height));
+  ASSERT(image->depth == 1);
+
+  Image_ImageHeader *packed = Image_CreatePackedMipMaps(image->width, image->height, 1,
+                                                        image->slices, image->format,
+                                                        0, alignment);
+  if (!packed) { return nullptr; }
+  memcpy(Image_RawDataPtr(packed), Image_RawDataPtr(image), Image_ByteCountOf(image));
+
+  // packed levels are uninitialised, without generation they are cleared
+  // like Image_CreateMipMapChain's are
+  Image_ImageHeader *doubleImage = generateFromImage ? AcquireMipSource(image) : nullptr;
+  for (Image_ImageHeader *mip = packed->nextImage; mip; mip = mip->nextImage) {
+    mip->flags |= image->flags & Image_Flag_Tiled;
+    if (doubleImage) {
+      GenerateMip(doubleImage, mip);
+    } else {
+      memset(Image_RawDataPtr(mip), 0, Image_ByteCountOf(mip));
+    }
+  }
+  packed->flags |= image->flags & (Image_Flag_Tiled | Image_Flag_Cubemap);
+
+  if (doubleImage) {
+    Image_Destroy(doubleImage);
   }
+  return packed;
 }
 
 EXTERN_C void Image_CopyImageChain(Image_ImageHeader const *dst,
@@ -250,10 +266,9 @@ EXTERN_C void Image_CopyImage(Image_ImageHeader const *dst,
     for (auto z = 0u; z < src->depth; ++z) {
       for (auto y = 0u; y < src->height; ++y) {
         for (auto x = 0u; x < src->width; ++x) {
-          size_t const index = Image_CalculateIndex(src, x, y, z, w);
           Image_PixelD pixel;
-          Image_GetPixelAt(src, &pixel, index);
-          Image_SetPixelAt(dst, &pixel, index);
+          Image_GetPixelAt(src, &pixel, Image_CalculateIndex(src, x, y, z, w));
+          Image_SetPixelAt(dst, &pixel, Image_CalculateIndex(dst, x, y, z, w));
         }
       }
     }
@@ -275,7 +290,7 @@ EXTERN_C void Image_CopySlice(Image_ImageHeader const *dst,
     for (auto y = 0u; y < src->height; ++y) {
       for (auto x = 0u; x < src->width; ++x) {
         size_t const srcIndex = Image_CalculateIndex(src, x, y, z, sw);
-        size_t const dstIndex = Image_CalculateIndex(src, x, y, z, dw);
+        size_t const dstIndex = Image_CalculateIndex(dst, x, y, z, dw);
         Image_PixelD pixel;
         Image_GetPixelAt(src, &pixel, srcIndex);
         Image_SetPixelAt(dst, &pixel, dstIndex);
@@ -297,7 +312,7 @@ EXTERN_C void Image_CopyPage(Image_ImageHeader const *dst,
   for (auto y = 0u; y < src->height; ++y) {
     for (auto x = 0u; x < src->width; ++x) {
       size_t const srcIndex = Image_CalculateIndex(src, x, y, sz, sw);
-      size_t const dstIndex = Image_CalculateIndex(src, x, y, dz, dw);
+      size_t const dstIndex = Image_CalculateIndex(dst, x, y, dz, dw);
       Image_PixelD pixel;
       Image_GetPixelAt(src, &pixel, srcIndex);
       Image_SetPixelAt(dst, &pixel, dstIndex);
@@ -316,7 +331,7 @@ EXTERN_C void Image_CopyRow(Image_ImageHeader *dst,
 
   for (auto x = 0u; x < src->width; ++x) {
     size_t const srcIndex = Image_CalculateIndex(src, x, sy, sz, sw);
-    size_t const dstIndex = Image_CalculateIndex(src, x, dy, dz, dw);
+    size_t const dstIndex = Image_CalculateIndex(dst, x, dy, dz, dw);
     Image_PixelD pixel;
     Image_GetPixelAt(src, &pixel, srcIndex);
     Image_SetPixelAt(dst, &pixel, dstIndex);
@@ -328,7 +343,7 @@ EXTERN_C void Image_CopyPixel(Image_ImageHeader *dst,
                               Image_ImageHeader const *src,
                               uint32_t sx, uint32_t sy, uint32_t sz, uint32_t sw) {
   size_t const srcIndex = Image_CalculateIndex(src, sx, sy, sz, sw);
-  size_t const dstIndex = Image_CalculateIndex(src, dx, dy, dz, dw);
+  size_t const dstIndex = Image_CalculateIndex(dst, dx, dy, dz, dw);
   Image_PixelD pixel;
   Image_GetPixelAt(src, &pixel, srcIndex);
   Image_SetPixelAt(dst, &pixel, dstIndex);
@@ -337,6 +352,7 @@ EXTERN_C void Image_CopyPixel(Image_ImageHeader *dst,
 EXTERN_C Image_ImageHeader *Image_Clone(Image_ImageHeader *image) {
   Image_ImageHeader *dst = Image_Create(image->width, image->height, image->depth, image->slices, image->format);
   if (dst == nullptr) { return nullptr; }
+  dst->flags |= image->flags & Image_Flag_Tiled;
   Image_CopyImage(dst, image);
   if (image->nextType != Image_IT_None) {
     dst->nextImage = Image_Clone(image->nextImage);
@@ -348,6 +364,7 @@ EXTERN_C Image_ImageHeader *Image_Clone(Image_ImageHeader *image) {
 EXTERN_C Image_ImageHeader *Image_CloneStructure(Image_ImageHeader *image) {
   Image_ImageHeader *dst = Image_Create(image->width, image->height, image->depth, image->slices, image->format);
   if (dst == nullptr) { return nullptr; }
+  dst->flags |= image->flags & Image_Flag_Tiled;
   if (image->nextType != Image_IT_None) {
     dst->nextImage = Image_CloneStructure(image->nextImage);
     dst->nextType = image->nextType;
@@ -355,8 +372,9 @@ EXTERN_C Image_ImageHeader *Image_CloneStructure(Image_ImageHeader *image) {
   return dst;
 }
 EXTERN_C Image_ImageHeader *Image_PreciseConvert(Image_ImageHeader *image, Image_Format const newFormat) {
-  Image_ImageHeader *dst = Image_Create(image->width, image->height, image->depth, image->slices, image->format);
+  Image_ImageHeader *dst = Image_Create(image->width, image->height, image->depth, image->slices, newFormat);
   if (dst == nullptr) { return nullptr; }
+  dst->flags |= image->flags & Image_Flag_Tiled;
   Image_CopyImage(dst, image);
   if (image->nextType != Image_IT_None) {
     dst->nextImage = Image_PreciseConvert(image->nextImage, newFormat);
@@ -0,0 +1,315 @@
+#include "core/core.h"
+#include "core/logger.h"
+#include "os/threadpool.h"
+#include "image/format.h"
+#include "image/format_cracker.h"
+#include "image/image.h"
+#include "image/view.h"
+#include "hq_resample.hpp"
+#include <cmath>
+
+namespace {
+
+bool CheckLinear(Image_ImageHeader const *image) {
+  if (Image_IsTiled(image)) {
+    LOGERROR("Tiled images only support views of a tile");
+    return false;
+  }
+  return true;
+}
+
+bool CheckBlockAligned(Image_ImageHeader const *image,
+                       uint32_t x, uint32_t y,
+                       uint32_t width, uint32_t height) {
+  if (!Image_Format_IsCompressed(image->format)) { return true; }
+
+  // partial blocks are only allowed where they run into the image edge
+  uint32_t const bw = Image_Format_WidthOfBlock(image->format);
+  uint32_t const bh = Image_Format_HeightOfBlock(image->format);
+  bool const xOk = (x % bw) == 0 && ((width % bw) == 0 || x + width == image->width);
+  bool const yOk = (y % bh) == 0 && ((height % bh) == 0 || y + height == image->height);
+  if (!xOk || !yOk) {
+    LOGERRORF("View of %s must be block aligned", Image_Format_Name(image->format));
+    return false;
+  }
+  return true;
+}
+
+// bytes of one row of pixels or blocks for the full image width
+size_t RowStrideOf(Image_ImageHeader const *image) {
+  if (Image_Format_IsCompressed(image->format)) {
+    return Image_ByteCountPerRowOf(image) * Image_Format_HeightOfBlock(image->format);
+  }
+  return Image_ByteCountPerRowOf(image);
+}
+
+size_t OffsetOf(Image_ImageHeader const *image, uint32_t x, uint32_t y) {
+  size_t const bitWidth = Image_Format_BitWidth(image->format);
+  if (Image_Format_IsCompressed(image->format)) {
+    uint32_t const bh = Image_Format_HeightOfBlock(image->format);
+    return (y / bh) * RowStrideOf(image) + (x * bitWidth * bh) / 8;
+  }
+  return y * RowStrideOf(image) + (x * bitWidth) / 8;
+}
+
+struct CopyJob {
+  Image_View const *dst;
+  Image_View const *src;
+};
+
+void CopyRow(void *data, uint32_t index) {
+  CopyJob const *job = (CopyJob const *) data;
+  uint32_t const y = index % job->src->height;
+  uint32_t const z = index / job->src->height;
+
+  if (job->dst->format == job->src->format) {
+    memcpy(Image_ViewPixelPtr(job->dst, 0, y, z),
+           Image_ViewPixelPtr(job->src, 0, y, z),
+           Image_ViewByteCountPerRowOf(job->src));
+    return;
+  }
+
+  for (uint32_t x = 0; x < job->src->width; ++x) {
+    Image_PixelD pixel = {0, 0, 0, 1};
+    Image_ViewGetPixelAt(job->src, &pixel, x, y, z);
+    Image_ViewSetPixelAt(job->dst, &pixel, x, y, z);
+  }
+}
+
+void ResampleClampOf(Image_Format format, float *low, float *high) {
+  // float formats shouldn't be clamped, the resampler treats NaN as no clamp
+  if (Image_Format_IsFloat(format)) {
+    *low = NAN;
+    *high = NAN;
+    return;
+  }
+  uint32_t const channelCount = Image_Format_ChannelCount(format);
+  double lo = Image_Format_Min(format, 0);
+  double hi = Image_Format_Max(format, 0);
+  for (uint32_t i = 1; i < channelCount; ++i) {
+    lo = Image_Format_Min(format, i) < lo ? Image_Format_Min(format, i) : lo;
+    hi = Image_Format_Max(format, i) > hi ? Image_Format_Max(format, i) : hi;
+  }
+  *low = (float) lo;
+  *high = (float) hi;
+}
+
+} // end anon namespace
+
+EXTERN_C bool Image_ViewOf(Image_ImageHeader const *image, Image_View *view) {
+  ASSERT(image);
+  ASSERT(view);
+  if (!CheckLinear(image)) { return false; }
+
+  // slices are contiguous so can be treated as more pages
+  view->data = (uint8_t *) Image_RawDataPtr(image);
+  view->rowStride = RowStrideOf(image);
+  view->pageStride = Image_ByteCountPerPageOf(image);
+  view->width = image->width;
+  view->height = image->height;
+  view->depth = image->depth * image->slices;
+  view->format = image->format;
+  return true;
+}
+
+EXTERN_C bool Image_ViewOfSlice(Image_ImageHeader const *image, uint32_t slice, Image_View *view) {
+  ASSERT(image);
+  return Image_ViewOfRegion(image, 0, 0, 0, slice, image->width, image->height, image->depth, view);
+}
+
+EXTERN_C bool Image_ViewOfMipLevel(Image_ImageHeader const *image, uint32_t level, uint32_t slice, Image_View *view) {
+  ASSERT(image);
+  if (level > 0 && image->nextType != Image_IT_MipMaps) {
+    LOGERROR("Image has no mipmaps");
+    return false;
+  }
+  Image_ImageHeader const *mip = Image_LinkedImageOf(image, level);
+  if (!mip) {
+    LOGERRORF("Mip level %u doesn't exist", level);
+    return false;
+  }
+  return Image_ViewOfSlice(mip, slice, view);
+}
+
+EXTERN_C bool Image_ViewOfRegion(Image_ImageHeader const *image,
+                                 uint32_t x, uint32_t y, uint32_t z, uint32_t slice,
+                                 uint32_t width, uint32_t height, uint32_t depth,
+                                 Image_View *view) {
+  ASSERT(image);
+  ASSERT(view);
+  if (!CheckLinear(image)) { return false; }
+
+  if (slice >= image->slices ||
+      x + width > image->width ||
+      y + height > image->height ||
+      z + depth > image->depth) {
+    LOGERROR("View region is outside the image");
+    return false;
+  }
+  if (!CheckBlockAligned(image, x, y, width, height)) {
+    return false;
+  }
+
+  view->data = ((uint8_t *) Image_RawDataPtr(image)) +
+      slice * Image_ByteCountPerSliceOf(image) +
+      z * Image_ByteCountPerPageOf(image) +
+      OffsetOf(image, x, y);
+  view->rowStride = RowStrideOf(image);
+  view->pageStride = Image_ByteCountPerPageOf(image);
+  view->width = width;
+  view->height = height;
+  view->depth = depth;
+  view->format = image->format;
+  return true;
+}
+
+EXTERN_C bool Image_ViewOfTile(Image_ImageHeader const *image,
+                               uint32_t tileX, uint32_t tileY, uint32_t z, uint32_t slice,
+                               Image_View *view) {
+  ASSERT(image);
+  ASSERT(view);
+
+  if (!Image_IsTiled(image)) {
+    LOGERROR("Image isn't tiled");
+    return false;
+  }
+  if (tileX >= Image_TileCountXOf(image) ||
+      tileY >= Image_TileCountYOf(image) ||
+      z >= image->depth ||
+      slice >= image->slices) {
+    LOGERROR("Tile is outside the image");
+    return false;
+  }
+
+  uint32_t const x = tileX * IMAGE_TILE_DIM;
+  uint32_t const y = tileY * IMAGE_TILE_DIM;
+  view->width = (image->width - x) < IMAGE_TILE_DIM ? (image->width - x) : IMAGE_TILE_DIM;
+  view->height = (image->height - y) < IMAGE_TILE_DIM ? (image->height - y) : IMAGE_TILE_DIM;
+  view->depth = 1;
+  view->format = image->format;
+  view->rowStride = Image_ViewByteCountPerRowOf(view);
+  view->pageStride = view->rowStride * view->height;
+  view->data = ((uint8_t *) Image_RawDataPtr(image)) +
+      (Image_CalculateIndex(image, x, y, z, slice) * Image_Format_BitWidth(image->format)) / 8;
+  return true;
+}
+
+EXTERN_C bool Image_SubView(Image_View const *src,
+                            uint32_t x, uint32_t y, uint32_t z,
+                            uint32_t width, uint32_t height, uint32_t depth,
+                            Image_View *view) {
+  ASSERT(src);
+  ASSERT(view);
+
+  if (x + width > src->width ||
+      y + height > src->height ||
+      z + depth > src->depth) {
+    LOGERROR("Sub view region is outside the view");
+    return false;
+  }
+  if (Image_Format_IsCompressed(src->format)) {
+    uint32_t const bw = Image_Format_WidthOfBlock(src->format);
+    uint32_t const bh = Image_Format_HeightOfBlock(src->format);
+    if ((x % bw) != 0 || (y % bh) != 0 ||
+        ((width % bw) != 0 && x + width != src->width) ||
+        ((height % bh) != 0 && y + height != src->height)) {
+      LOGERRORF("View of %s must be block aligned", Image_Format_Name(src->format));
+      return false;
+    }
+    *view = *src;
+    view->data += z * src->pageStride + (y / bh) * src->rowStride +
+        (x * Image_Format_BitWidth(src->format) * bh) / 8;
+  } else {
+    *view = *src;
+    view->data = Image_ViewPixelPtr(src, x, y, z);
+  }
+  view->width = width;
+  view->height = height;
+  view->depth = depth;
+  return true;
+}
+
+EXTERN_C bool Image_ViewCopy(Image_View const *dst, Image_View const *src) {
+  ASSERT(dst);
+  ASSERT(src);
+
+  if (dst->width != src->width || dst->height != src->height || dst->depth != src->depth) {
+    LOGERROR("View copy extents must match");
+    return false;
+  }
+  if (Image_Format_IsCompressed(dst->format) || Image_Format_IsCompressed(src->format)) {
+    LOGERROR("View copy doesn't support block compressed formats");
+    return false;
+  }
+
+  CopyJob job = {dst, src};
+  Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &CopyRow, &job, src->height * src->depth);
+  return true;
+}
+
+EXTERN_C bool Image_ViewResample(Image_View const *dst, Image_View const *src) {
+  ASSERT(dst);
+  ASSERT(src);
+
+  if (dst->depth != src->depth) {
+    LOGERROR("View resample depths must match");
+    return false;
+  }
+  if (Image_Format_IsCompressed(dst->format) || Image_Format_IsCompressed(src->format)) {
+    LOGERROR("View resample doesn't support block compressed formats");
+    return false;
+  }
+  if (dst->width == 0 || dst->height == 0 || src->width == 0 || src->height == 0) {
+    return true;
+  }
+
+  // the resampler works on packed float pages, pages are staged through
+  // pooled float images so the source and dest can be any format/stride
+  Image_Format floatFormat;
+  switch (Image_Format_ChannelCount(src->format)) {
+    case 1: floatFormat = Image_Format_R32_SFLOAT;
+      break;
+    case 2: floatFormat = Image_Format_R32G32_SFLOAT;
+      break;
+    case 3: floatFormat = Image_Format_R32G32B32_SFLOAT;
+      break;
+    default: floatFormat = Image_Format_R32G32B32A32_SFLOAT;
+      break;
+  }
+  uint32_t const channelCount = Image_Format_ChannelCount(floatFormat);
+
+  Image_ImageHeader *srcPage = Image_PoolAcquire(Image_PoolGlobal(), src->width, src->height, 1, 1, floatFormat);
+  Image_ImageHeader *dstPage = Image_PoolAcquire(Image_PoolGlobal(), dst->width, dst->height, 1, 1, floatFormat);
+  if (!srcPage || !dstPage) {
+    if (srcPage) { Image_Destroy(srcPage); }
+    if (dstPage) { Image_Destroy(dstPage); }
+    return false;
+  }
+
+  float low, high;
+  ResampleClampOf(dst->format, &low, &high);
+
+  Image_View srcPageView;
+  Image_View dstPageView;
+  Image_ViewOf(srcPage, &srcPageView);
+  Image_ViewOf(dstPage, &dstPageView);
+
+  bool ok = true;
+  for (uint32_t z = 0; z < src->depth && ok; ++z) {
+    Image_View srcSlab;
+    Image_View dstSlab;
+    Image_SubView(src, 0, 0, z, src->width, src->height, 1, &srcSlab);
+    Image_SubView(dst, 0, 0, z, dst->width, dst->height, 1, &dstSlab);
+
+    ok = Image_ViewCopy(&srcPageView, &srcSlab);
+    Image::hq_resample<float>(channelCount,
+                              (float const *) Image_RawDataPtr(srcPage), src->width, src->height,
+                              (float *) Image_RawDataPtr(dstPage), dst->width, dst->height,
+                              1.0f / 3.0f, 1.0f / 3.0f, low, high);
+    ok = ok && Image_ViewCopy(&dstSlab, &dstPageView);
+  }
+
+  Image_Destroy(dstPage);
+  Image_Destroy(srcPage);
+  return ok;
+}
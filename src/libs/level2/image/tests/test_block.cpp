@@ -0,0 +1,257 @@
+#include "core/core.h"
+#include "catch/catch.hpp"
+#include "math/math.h"
+#include "image/format.h"
+#include "image/block.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// smooth gradients with a few hard edges, fairly typical texture content
+void MakeRGBA8TestImage(uint8_t *dest, int width, int height) {
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      uint8_t *p = dest + (y * width + x) * 4;
+      p[0] = (uint8_t) (x * 255 / (width - 1));
+      p[1] = (uint8_t) (y * 255 / (height - 1));
+      p[2] = (uint8_t) (((x / 8) + (y / 8)) & 1 ? 200 : 40);
+      p[3] = (uint8_t) (255 - (x + y) * 255 / (width + height - 2));
+    }
+  }
+}
+
+double PSNR(uint8_t const *a, uint8_t const *b, size_t count) {
+  double err = 0.0;
+  for (size_t i = 0; i < count; ++i) {
+    double const d = (double) a[i] - (double) b[i];
+    err += d * d;
+  }
+  if (err == 0.0) { return 100.0; }
+  return 10.0 * std::log10((255.0 * 255.0) / (err / (double) count));
+}
+
+}
+
+TEST_CASE("Block BC7 decode reserved mode (C)", "[Image Block]") {
+  uint8_t const block[16] = {0};
+  uint8_t out[16 * 4];
+  memset(out, 0xAA, sizeof(out));
+  Image_BlockDecodeBC7(out, block);
+  for (uint8_t v : out) {
+    REQUIRE(v == 0);
+  }
+}
+
+TEST_CASE("Block BC7 decode mode 1 (C)", "[Image Block]") {
+  uint8_t const block[16] = {
+      0x0E, 0x83, 0x0B, 0x73, 0xEC, 0xF5, 0x4B, 0x4A, 0x74, 0x35, 0xE7, 0xF1, 0x06, 0x41, 0xC8, 0x6B,
+  };
+  uint8_t const expected[16 * 4] = {
+      38, 167, 46, 255, 163, 106, 66, 255, 87, 143, 54, 255, 148, 150, 71, 255,
+      187, 94, 70, 255, 163, 106, 66, 255, 195, 255, 94, 255, 148, 150, 71, 255,
+      14, 179, 42, 255, 114, 130, 58, 255, 195, 255, 94, 255, 172, 204, 83, 255,
+      163, 106, 66, 255, 161, 179, 77, 255, 137, 125, 65, 255, 184, 230, 88, 255,
+  };
+  uint8_t out[16 * 4];
+  Image_BlockDecodeBC7(out, block);
+  for (int i = 0; i < 16 * 4; ++i) {
+    REQUIRE(out[i] == expected[i]);
+  }
+}
+
+TEST_CASE("Block BC6H decode mode 2 (C)", "[Image Block]") {
+  uint8_t const block[16] = {
+      0xA9, 0xDF, 0x0C, 0x3D, 0xE6, 0x4C, 0x48, 0xA1, 0xDB, 0xD4, 0x68, 0x78, 0xDC, 0x58, 0x4E, 0xEA,
+  };
+  uint16_t const expected[16 * 3] = {
+      0x5E55, 0x193F, 0x1E17, 0x2653, 0x1A5E, 0x1F36, 0x7994, 0x18B4, 0x1D8C, 0x63D7, 0x3083, 0x1502,
+      0x50B5, 0x1985, 0x1E5D, 0x4192, 0x19D2, 0x1EAA, 0x6589, 0x2F3D, 0x27A8, 0x6589, 0x2F3D, 0x27A8,
+      0x4192, 0x19D2, 0x1EAA, 0x6463, 0x301A, 0x1B01, 0x64EE, 0x2FB2, 0x20FF, 0x6589, 0x2F3D, 0x27A8,
+      0x6615, 0x2ED5, 0x2DA7, 0x6615, 0x2ED5, 0x2DA7, 0x6463, 0x301A, 0x1B01, 0x6589, 0x2F3D, 0x27A8,
+  };
+  uint16_t out[16 * 3];
+  Image_BlockDecodeBC6H(out, block, false);
+  for (int i = 0; i < 16 * 3; ++i) {
+    REQUIRE(out[i] == expected[i]);
+  }
+}
+
+TEST_CASE("Block BC7 encode decode solid colour (C)", "[Image Block]") {
+  uint8_t src[16 * 4];
+  for (int i = 0; i < 16; ++i) {
+    src[i * 4 + 0] = 10;
+    src[i * 4 + 1] = 128;
+    src[i * 4 + 2] = 201;
+    src[i * 4 + 3] = 255;
+  }
+
+  for (int q = Image_BEQ_Fast; q <= Image_BEQ_Slow; ++q) {
+    uint8_t block[16];
+    uint8_t out[16 * 4];
+    Image_BlockEncodeBC7(block, src, (Image_BlockEncodeQuality) q);
+    Image_BlockDecodeBC7(out, block);
+    for (int i = 0; i < 16 * 4; ++i) {
+      REQUIRE(std::abs((int) out[i] - (int) src[i]) <= 1);
+    }
+  }
+}
+
+TEST_CASE("Block BC7 whole image round trip (C)", "[Image Block]") {
+  // not a multiple of 4 to cover partial edge blocks
+  int const width = 37;
+  int const height = 22;
+  size_t const pixelBytes = width * height * 4;
+  size_t const blockBytes = ((width + 3) / 4) * ((height + 3) / 4) * 16;
+
+  uint8_t *src = (uint8_t *) malloc(pixelBytes);
+  uint8_t *dst = (uint8_t *) malloc(pixelBytes);
+  uint8_t *blocks = (uint8_t *) malloc(blockBytes);
+  MakeRGBA8TestImage(src, width, height);
+
+  REQUIRE(Image_BlockDecodeIsSupported(Image_Format_BC7_UNORM_BLOCK));
+  REQUIRE(Image_BlockEncodeIsSupported(Image_Format_BC7_UNORM_BLOCK));
+
+  double lastPsnr = 0.0;
+  for (int q = Image_BEQ_Fast; q <= Image_BEQ_Slow; ++q) {
+    Image_BlockEncodeCompressedData(blocks, src, width, height,
+                                    Image_Format_BC7_UNORM_BLOCK, (Image_BlockEncodeQuality) q);
+    Image_BlockDecodeCompressedData(dst, blocks, width, height, Image_Format_BC7_UNORM_BLOCK);
+    double const psnr = PSNR(src, dst, pixelBytes);
+    REQUIRE(psnr > 35.0);
+    // deeper searches should never be worse
+    REQUIRE(psnr >= lastPsnr - 0.01);
+    lastPsnr = psnr;
+  }
+
+  free(blocks);
+  free(dst);
+  free(src);
+}
+
+TEST_CASE("Block BC6H whole image round trip (C)", "[Image Block]") {
+  int const width = 16;
+  int const height = 16;
+  size_t const count = width * height * 3;
+  uint16_t *src = (uint16_t *) malloc(count * sizeof(uint16_t));
+  uint16_t *dst = (uint16_t *) malloc(count * sizeof(uint16_t));
+  uint8_t blocks[16 * 16];
+
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      uint16_t *p = src + (y * width + x) * 3;
+      // hdr ramp with correlated channels, like a sky gradient
+      float const t = (float) (x + y) / (float) (width + height - 2);
+      p[0] = Math_Float2Half(0.5f + 40.0f * t * t);
+      p[1] = Math_Float2Half(0.25f + 20.0f * t * t);
+      p[2] = Math_Float2Half(0.01f + 2.0f * t);
+    }
+  }
+
+  for (int s = 0; s < 2; ++s) {
+    Image_Format const fmt = s ? Image_Format_BC6H_SFLOAT_BLOCK : Image_Format_BC6H_UFLOAT_BLOCK;
+    Image_BlockEncodeCompressedData(blocks, (uint8_t const *) src, width, height, fmt, Image_BEQ_Normal);
+    Image_BlockDecodeCompressedData((uint8_t *) dst, blocks, width, height, fmt);
+    for (size_t i = 0; i < count; ++i) {
+      float const a = Math_Half2Float(src[i]);
+      float const b = Math_Half2Float(dst[i]);
+      // bc6h interpolates in the half bit pattern, so low values in a bright block suffer
+      REQUIRE(std::fabs(a - b) <= 0.3f * a + 0.05f);
+    }
+  }
+
+  free(dst);
+  free(src);
+}
+
+TEST_CASE("Block BC1-5 whole image round trip (C)", "[Image Block]") {
+  int const width = 16;
+  int const height = 16;
+  uint8_t rgba[16 * 16 * 4];
+  MakeRGBA8TestImage(rgba, width, height);
+
+  Image_Format const formats[] = {
+      Image_Format_BC1_RGBA_UNORM_BLOCK,
+      Image_Format_BC2_UNORM_BLOCK,
+      Image_Format_BC3_UNORM_BLOCK,
+  };
+  for (Image_Format fmt : formats) {
+    uint8_t blocks[16 * 16];
+    uint8_t out[16 * 16 * 4];
+    Image_BlockEncodeCompressedData(blocks, rgba, width, height, fmt, Image_BEQ_Normal);
+    Image_BlockDecodeCompressedData(out, blocks, width, height, fmt);
+    // BC1 alpha is 1 bit, transparent pixels decode as transparent black
+    uint8_t expected[16 * 16 * 4];
+    memcpy(expected, rgba, sizeof(expected));
+    if (fmt == Image_Format_BC1_RGBA_UNORM_BLOCK) {
+      for (int i = 0; i < width * height; ++i) {
+        bool const opaque = rgba[i * 4 + 3] >= 128;
+        REQUIRE(out[i * 4 + 3] == (opaque ? 255 : 0));
+        if (!opaque) {
+          memset(expected + i * 4, 0, 4);
+        } else {
+          expected[i * 4 + 3] = 255;
+        }
+      }
+    }
+    // the test image is a poor fit for 4 colour blocks, this just catches gross errors
+    REQUIRE(PSNR(expected, out, sizeof(out)) > 25.0);
+  }
+}
+
+TEST_CASE("Block BC4 BC5 unsigned and signed round trip (C)", "[Image Block]") {
+  // 15x13 so the right and bottom blocks are partial
+  int const width = 15;
+  int const height = 13;
+  uint8_t src[15 * 13 * 2];
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      src[(y * width + x) * 2 + 0] = (uint8_t) (x * 255 / (width - 1));
+      src[(y * width + x) * 2 + 1] = (uint8_t) (255 - y * 255 / (height - 1));
+    }
+  }
+
+  struct {
+    Image_Format format;
+    int channels;
+    bool isSigned;
+  } const formats[] = {
+      {Image_Format_BC4_UNORM_BLOCK, 1, false},
+      {Image_Format_BC4_SNORM_BLOCK, 1, true},
+      {Image_Format_BC5_UNORM_BLOCK, 2, false},
+      {Image_Format_BC5_SNORM_BLOCK, 2, true},
+  };
+  for (auto const& f : formats) {
+    uint8_t in[15 * 13 * 2];
+    for (int i = 0; i < width * height; ++i) {
+      for (int c = 0; c < f.channels; ++c) {
+        // signed covers -127 to 127 so a block straddling 0 has to keep its sign
+        uint8_t const v = src[i * 2 + c];
+        in[i * f.channels + c] = f.isSigned ? (uint8_t) (int8_t) ((v * 254) / 255 - 127) : v;
+      }
+    }
+    uint8_t blocks[4 * 4 * 16];
+    uint8_t out[15 * 13 * 2];
+    Image_BlockEncodeCompressedData(blocks, in, width, height, f.format, Image_BEQ_Normal);
+    Image_BlockDecodeCompressedData(out, blocks, width, height, f.format);
+
+    int worst = 0;
+    for (int i = 0; i < width * height * f.channels; ++i) {
+      int const a = f.isSigned ? (int) (int8_t) in[i] : (int) in[i];
+      int const b = f.isSigned ? (int) (int8_t) out[i] : (int) out[i];
+      worst = std::max(worst, std::abs(a - b));
+    }
+    // a 4 pixel ramp spans under 80 steps, 8 interpolated values cover it to within 6
+    REQUIRE(worst <= 6);
+  }
+
+  // the 6 value signed mode ends in -1 and +1
+  uint8_t const sixValue[8] = {0x10, 0x20, 0x3E, 0, 0, 0, 0, 0};
+  int8_t out[16];
+  Image_BlockDecodeCompressedData((uint8_t *) out, sixValue, 4, 4, Image_Format_BC4_SNORM_BLOCK);
+  REQUIRE(out[0] == -127);
+  REQUIRE(out[1] == 127);
+  REQUIRE(out[2] == 0x10);
+}
@@ -11,6 +11,7 @@ int Main(int argc, char const *argv[]) {
 #include "image/image.h"
 #include "image/format_cracker.h"
 #include "image/create.h"
+#include "image/utils.h"
 
 TEST_CASE("Image create/destroy 1D (C)", "[Image]") {
   Image_ImageHeader *image0 = Image_Create1D(256, Image_Format_A8B8G8R8_UNORM_PACK32);
@@ -155,7 +156,7 @@ TEST_CASE("Image create/destroy 3D (C)", "[Image]") {
   REQUIRE(image2->height == 256);
   REQUIRE(image2->depth == 256);
   REQUIRE(image2->slices == 20);
-  REQUIRE(image2->dataSize == (256 * 256 * 256 * 20 * Image_Format_BitWidth(image2->format)) / 8);
+  REQUIRE(image2->dataSize == (256ull * 256 * 256 * 20 * Image_Format_BitWidth(image2->format)) / 8);
   REQUIRE(image2->nextImage == nullptr);
   REQUIRE(image2->nextType == Image_IT_None);
   REQUIRE(image2->flags == 0);
@@ -182,7 +183,7 @@ TEST_CASE("Image create/destroy 3D (C)", "[Image]") {
   REQUIRE(image4->height == 1024);
   REQUIRE(image4->depth == 16);
   REQUIRE(image4->slices == 10);
-  REQUIRE(image4->dataSize == (1024 * 1024 * 16 * 100 * Image_Format_BitWidth(image4->format)) / 8);
+  REQUIRE(image4->dataSize == (1024ull * 1024 * 16 * 10 * Image_Format_BitWidth(image4->format)) / 8);
   REQUIRE(image4->nextImage == nullptr);
   REQUIRE(image4->nextType == Image_IT_None);
   REQUIRE(image4->flags == 0);
@@ -281,6 +282,190 @@ TEST_CASE("Calculate Index (C)", "[Image]") {
   Image_Destroy(image);
 }
 
+namespace {
+// counts then forwards to the default allocator
+struct CountingAllocator {
+  Image_Allocator backing;
+  int allocs;
+  int frees;
+  size_t liveBytes;
+};
+
+void *CountingAllocate(void *user, size_t size, size_t alignment) {
+  auto *counter = (CountingAllocator *) user;
+  counter->allocs++;
+  counter->liveBytes += size;
+  return counter->backing.allocate(counter->backing.user, size, alignment);
+}
+
+void CountingFree(void *user, void *ptr, size_t size) {
+  auto *counter = (CountingAllocator *) user;
+  counter->frees++;
+  counter->liveBytes -= size;
+  counter->backing.free(counter->backing.user, ptr, size);
+}
+}
+
+TEST_CASE("Image data alignment (C)", "[Image]") {
+  for (uint32_t w = 1; w < 20; ++w) {
+    Image_ImageHeader *image = Image_Create2D(w, 3, Image_Format_R8G8B8_UNORM);
+    REQUIRE(image);
+    REQUIRE(((uintptr_t) Image_RawDataPtr(image) & (IMAGE_DATA_ALIGNMENT - 1)) == 0);
+    Image_Destroy(image);
+  }
+}
+
+TEST_CASE("Image allocator (C)", "[Image]") {
+  CountingAllocator counter = {*Image_GetAllocator(), 0, 0, 0};
+  Image_Allocator const allocator = {&CountingAllocate, &CountingFree, &counter};
+  Image_SetAllocator(&allocator);
+  Image_ImageHeader *image = Image_Create2D(16, 16, Image_Format_R32_SFLOAT);
+  // images remember their allocator, so this can be changed while they are alive
+  Image_SetAllocator(nullptr);
+  REQUIRE(image);
+  REQUIRE(counter.allocs == 1);
+  REQUIRE(counter.liveBytes >= 16 * 16 * 4);
+  Image_Destroy(image);
+  REQUIRE(counter.frees == 1);
+  REQUIRE(counter.liveBytes == 0);
+}
+
+TEST_CASE("Image pool (C)", "[Image]") {
+  Image_PoolHandle pool = Image_PoolCreate(1024 * 1024);
+  REQUIRE(pool);
+
+  Image_ImageHeader *image0 = Image_PoolAcquire(pool, 64, 64, 1, 1, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image0);
+  REQUIRE(((uintptr_t) Image_RawDataPtr(image0) & (IMAGE_DATA_ALIGNMENT - 1)) == 0);
+  void *data0 = Image_RawDataPtr(image0);
+  Image_Destroy(image0);
+
+  // same byte size, different shape should get the same memory back
+  Image_ImageHeader *image1 = Image_PoolAcquire(pool, 32, 128, 1, 1, Image_Format_R32_SFLOAT);
+  REQUIRE(image1);
+  REQUIRE(Image_RawDataPtr(image1) == data0);
+  REQUIRE(image1->width == 32);
+  REQUIRE(image1->format == Image_Format_R32_SFLOAT);
+  REQUIRE(image1->nextImage == nullptr);
+
+  Image_ImageHeader *image2 = Image_PoolAcquire(pool, 64, 64, 1, 1, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image2);
+  REQUIRE(Image_RawDataPtr(image2) != data0);
+  Image_Destroy(image2);
+  Image_Destroy(image1);
+
+  // bigger than the cache, goes straight back to the allocator
+  Image_ImageHeader *image3 = Image_PoolAcquire(pool, 1024, 1024, 1, 1, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image3);
+  Image_Destroy(image3);
+
+  Image_PoolTrim(pool);
+  Image_PoolDestroy(pool);
+}
+
+TEST_CASE("Image mipmap chain (C)", "[Image]") {
+  Image_ImageHeader *image = Image_Create2DArray(16, 8, 2, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image);
+  for (size_t i = 0; i < Image_PixelCountOf(image); ++i) {
+    Image_PixelD const pixel = {0.5, 0.25, 1.0, 1.0};
+    Image_SetPixelAt(image, &pixel, i);
+  }
+  Image_CreateMipMapChain(image, true);
+  REQUIRE(Image_LinkedImageCountOf(image) == 5);
+
+  Image_ImageHeader const *level = image->nextImage;
+  uint32_t expectedWidth = 8;
+  while (level) {
+    REQUIRE(level->width == expectedWidth);
+    REQUIRE(level->slices == 2);
+    Image_PixelD pixel;
+    Image_GetPixelAt(level, &pixel, Image_PixelCountOf(level) - 1);
+    REQUIRE(pixel.r == Approx(0.5).margin(0.01));
+    REQUIRE(pixel.g == Approx(0.25).margin(0.01));
+    expectedWidth /= 2;
+    level = level->nextImage;
+  }
+  Image_Destroy(image);
+}
+
+TEST_CASE("Image packed chain (C)", "[Image]") {
+  CountingAllocator counter = {*Image_GetAllocator(), 0, 0, 0};
+  Image_Allocator const allocator = {&CountingAllocate, &CountingFree, &counter};
+  Image_SetAllocator(&allocator);
+  Image_ImageHeader *packed = Image_CreatePackedMipMaps(32, 16, 1, 3, Image_Format_R8G8B8A8_UNORM, 0, 512);
+  Image_SetAllocator(nullptr);
+  REQUIRE(packed);
+  REQUIRE(counter.allocs == 1);
+  REQUIRE(Image_LinkedImageCountOf(packed) == 6);
+
+  Image_PackedChain const *chain = Image_PackedChainOf(packed);
+  REQUIRE(chain);
+  REQUIRE(chain->levelCount == 6);
+  REQUIRE(chain->alignment == 512);
+  REQUIRE(((uintptr_t) chain->blob & 511) == 0);
+  for (uint32_t i = 0; i < chain->levelCount; ++i) {
+    Image_ImageHeader const *level = Image_LinkedImageOf(packed, i);
+    REQUIRE(Image_PackedChainOf(level) == chain);
+    REQUIRE(level->slices == 3);
+    REQUIRE(level->width == (32u >> i ? 32u >> i : 1));
+    REQUIRE((chain->levelOffsets[i] & 511) == 0);
+    REQUIRE((uint8_t *) Image_RawDataPtr(level) == chain->blob + chain->levelOffsets[i]);
+    REQUIRE(chain->levelOffsets[i] + Image_ByteCountOf(level) <= chain->blobSize);
+    memset(Image_RawDataPtr(level), (int) i + 1, Image_ByteCountOf(level));
+  }
+  REQUIRE(chain->levelOffsets[5] + 4 * 3 == chain->blobSize);
+
+  // unpacked chains aren't packed and packing copies every level
+  Image_ImageHeader *image = Image_Create2D(8, 8, Image_Format_R8_UNORM);
+  REQUIRE(image);
+  REQUIRE(Image_PackedChainOf(image) == nullptr);
+  Image_CreateMipMapChain(image, false);
+  memset(Image_RawDataPtr(image->nextImage), 7, Image_ByteCountOf(image->nextImage));
+  Image_ImageHeader *repacked = Image_PackChain(image, 0);
+  REQUIRE(repacked);
+  REQUIRE(Image_PackedChainOf(repacked)->levelCount == 4);
+  REQUIRE(Image_PackedChainOf(repacked)->alignment == IMAGE_DATA_ALIGNMENT);
+  REQUIRE(repacked->nextType == Image_IT_MipMaps);
+  REQUIRE(repacked->nextImage->nextImage->nextImage->nextImage == nullptr);
+  REQUIRE(((uint8_t const *) Image_RawDataPtr(repacked->nextImage))[3] == 7);
+  Image_Destroy(repacked);
+  Image_Destroy(image);
+
+  // too many levels or block compressed levels below 4x4
+  REQUIRE(Image_CreatePackedMipMaps(4, 4, 1, 1, Image_Format_R8_UNORM, 4, 0) == nullptr);
+  REQUIRE(Image_CreatePackedMipMaps(16, 16, 1, 1, Image_Format_BC1_RGB_UNORM_BLOCK, 0, 0) == nullptr);
+  Image_ImageHeader *bc = Image_CreatePackedMipMaps(16, 16, 1, 1, Image_Format_BC1_RGB_UNORM_BLOCK, 3, 0);
+  REQUIRE(bc);
+  Image_Destroy(bc);
+
+  Image_Destroy(packed);
+  REQUIRE(counter.frees == 1);
+  REQUIRE(counter.liveBytes == 0);
+}
+
+TEST_CASE("Image packed mipmap chain (C)", "[Image]") {
+  Image_ImageHeader *image = Image_Create2DArray(16, 8, 2, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image);
+  for (size_t i = 0; i < Image_PixelCountOf(image); ++i) {
+    Image_PixelD const pixel = {0.5, 0.25, 1.0, 1.0};
+    Image_SetPixelAt(image, &pixel, i);
+  }
+  Image_ImageHeader *packed = Image_CreatePackedMipMapChain(image, true, 0);
+  REQUIRE(packed);
+  REQUIRE(image->nextImage == nullptr);
+  REQUIRE(Image_LinkedImageCountOf(packed) == 5);
+  REQUIRE(memcmp(Image_RawDataPtr(packed), Image_RawDataPtr(image), Image_ByteCountOf(image)) == 0);
+
+  for (Image_ImageHeader const *level = packed->nextImage; level; level = level->nextImage) {
+    Image_PixelD pixel;
+    Image_GetPixelAt(level, &pixel, Image_PixelCountOf(level) - 1);
+    REQUIRE(pixel.r == Approx(0.5).margin(0.01));
+    REQUIRE(pixel.g == Approx(0.25).margin(0.01));
+  }
+  Image_Destroy(packed);
+  Image_Destroy(image);
+}
+
 void ImageTester(uint32_t w_, uint32_t h_, uint32_t d_, uint32_t s_, enum Image_Format fmt_, bool doLog_) {
   using namespace Catch::literals;
   if (fmt_ == Image_Format_UNDEFINED) { return; }
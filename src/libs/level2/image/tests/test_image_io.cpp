@@ -1,11 +1,18 @@
 #include "core/core.h"
+#include "core/logger.h"
 #include "catch/catch.hpp"
 #include "image/image.h"
 #include "image/format_cracker.h"
 #include "image/io.h"
+#include "image/create.h"
+#include "image/utils.h"
 #include "os/filesystem.h"
 #include "vfile/vfile.hpp"
 #include "syoyo/tiny_exr.h"
+#include "miniz/miniz.h"
+#include <algorithm>
+#include <string>
+#include <vector>
 
 // path to https://github.com/openexr/openexr-images
 static const char *gBasePath = "test_data/exr/";
@@ -71,4 +78,856 @@ TEST_CASE("Image io EXR Scanlines (C)", "[Image]") {
   }
 
   RESTORE_EXR_PATH();
-}
\ No newline at end of file
+}
+
+TEST_CASE("Image io EXR interleaved decode (C)", "[Image]") {
+  // channels are stored sorted by name, Z isn't a colour channel so is skipped
+  char const *names[] = {"A", "B", "G", "R", "Z"};
+  uint32_t const width = 37;
+  uint32_t const height = 70;
+  std::vector<float> planes[5];
+  for (auto &plane : planes) { plane.resize(width * height); }
+  for (uint32_t y = 0; y < height; ++y) {
+    for (uint32_t x = 0; x < width; ++x) {
+      uint32_t const i = y * width + x;
+      planes[0][i] = 0.5f;
+      planes[1][i] = (float) (x + y);
+      planes[2][i] = (float) y;
+      planes[3][i] = (float) x;
+      planes[4][i] = -1.0f;
+    }
+  }
+
+  int const compressions[] = {
+      TINYEXR_COMPRESSIONTYPE_NONE,
+      TINYEXR_COMPRESSIONTYPE_RLE,
+      TINYEXR_COMPRESSIONTYPE_ZIPS,
+      TINYEXR_COMPRESSIONTYPE_ZIP
+  };
+  for (int compression : compressions) {
+    TinyExr_EXRChannelInfo channels[5];
+    int pixelTypes[5];
+    unsigned char *images[5];
+    memset(channels, 0, sizeof(channels));
+    for (int c = 0; c < 5; ++c) {
+      strcpy(channels[c].name, names[c]);
+      channels[c].pixel_type = TINYEXR_PIXELTYPE_FLOAT;
+      pixelTypes[c] = TINYEXR_PIXELTYPE_FLOAT;
+      images[c] = (unsigned char *) planes[c].data();
+    }
+
+    TinyExr_EXRHeader header;
+    TinyExr_InitEXRHeader(&header);
+    header.num_channels = 5;
+    header.channels = channels;
+    header.pixel_types = pixelTypes;
+    header.requested_pixel_types = pixelTypes;
+    header.compression_type = compression;
+
+    TinyExr_EXRImage exrImage;
+    TinyExr_InitEXRImage(&exrImage);
+    exrImage.num_channels = 5;
+    exrImage.images = images;
+    exrImage.width = width;
+    exrImage.height = height;
+
+    VFile_Handle out = VFile_FromFile("test_data/interleave.exr", Os_FM_WriteBinary);
+    REQUIRE(out);
+    REQUIRE(TinyExr_SaveEXRImage(&exrImage, &header, out) == TINYEXR_SUCCESS);
+
+    VFile_Handle in = VFile_FromFile("test_data/interleave.exr", Os_FM_ReadBinary);
+    REQUIRE(in);
+    Image_ImageHeader *image = Image_LoadEXR(in);
+    VFile_Close(in);
+    REQUIRE(image);
+    REQUIRE(image->format == Image_Format_R32G32B32A32_SFLOAT);
+    REQUIRE(image->width == width);
+    REQUIRE(image->height == height);
+    float const *pixels = (float const *) Image_RawDataPtr(image);
+    for (uint32_t y = 0; y < height; ++y) {
+      for (uint32_t x = 0; x < width; ++x) {
+        float const *pixel = pixels + (y * width + x) * 4;
+        REQUIRE(pixel[0] == (float) x);
+        REQUIRE(pixel[1] == (float) y);
+        REQUIRE(pixel[2] == (float) (x + y));
+        REQUIRE(pixel[3] == 0.5f);
+      }
+    }
+    Image_Destroy(image);
+  }
+  Os_FileDelete("test_data/interleave.exr");
+}
+
+TEST_CASE("Image io EXR region (C)", "[Image]") {
+  // tall enough for many 16 line ZIP blocks
+  char const *names[] = {"B", "G", "R"};
+  uint32_t const width = 45;
+  uint32_t const height = 123;
+  std::vector<float> planes[3];
+  for (auto &plane : planes) { plane.resize(width * height); }
+  for (uint32_t y = 0; y < height; ++y) {
+    for (uint32_t x = 0; x < width; ++x) {
+      uint32_t const i = y * width + x;
+      planes[0][i] = (float) (x * y);
+      planes[1][i] = (float) y;
+      planes[2][i] = (float) x;
+    }
+  }
+
+  int const compressions[] = {
+      TINYEXR_COMPRESSIONTYPE_NONE,
+      TINYEXR_COMPRESSIONTYPE_ZIP
+  };
+  for (int compression : compressions) {
+    TinyExr_EXRChannelInfo channels[3];
+    int pixelTypes[3];
+    unsigned char *images[3];
+    memset(channels, 0, sizeof(channels));
+    for (int c = 0; c < 3; ++c) {
+      strcpy(channels[c].name, names[c]);
+      channels[c].pixel_type = TINYEXR_PIXELTYPE_FLOAT;
+      pixelTypes[c] = TINYEXR_PIXELTYPE_FLOAT;
+      images[c] = (unsigned char *) planes[c].data();
+    }
+
+    TinyExr_EXRHeader header;
+    TinyExr_InitEXRHeader(&header);
+    header.num_channels = 3;
+    header.channels = channels;
+    header.pixel_types = pixelTypes;
+    header.requested_pixel_types = pixelTypes;
+    header.compression_type = compression;
+
+    TinyExr_EXRImage exrImage;
+    TinyExr_InitEXRImage(&exrImage);
+    exrImage.num_channels = 3;
+    exrImage.images = images;
+    exrImage.width = width;
+    exrImage.height = height;
+
+    VFile_Handle out = VFile_FromFile("test_data/region.exr", Os_FM_WriteBinary);
+    REQUIRE(out);
+    REQUIRE(TinyExr_SaveEXRImage(&exrImage, &header, out) == TINYEXR_SUCCESS);
+
+    // x, y, width, height. Straddling blocks, a single row and everything
+    uint32_t const regions[][4] = {
+        {3, 10, 30, 70},
+        {0, 47, width, 1},
+        {0, 0, width, height},
+    };
+    for (auto const &region : regions) {
+      VFile_Handle in = VFile_FromFile("test_data/region.exr", Os_FM_ReadBinary);
+      REQUIRE(in);
+      Image_ImageHeader *image = Image_LoadEXRRegion(in, region[0], region[1], region[2], region[3], 0);
+      VFile_Close(in);
+      REQUIRE(image);
+      REQUIRE(image->format == Image_Format_R32G32B32_SFLOAT);
+      REQUIRE(image->width == region[2]);
+      REQUIRE(image->height == region[3]);
+      float const *pixels = (float const *) Image_RawDataPtr(image);
+      for (uint32_t y = 0; y < region[3]; ++y) {
+        for (uint32_t x = 0; x < region[2]; ++x) {
+          float const *pixel = pixels + (y * region[2] + x) * 3;
+          uint32_t const fx = region[0] + x;
+          uint32_t const fy = region[1] + y;
+          REQUIRE(pixel[0] == (float) fx);
+          REQUIRE(pixel[1] == (float) fy);
+          REQUIRE(pixel[2] == (float) (fx * fy));
+        }
+      }
+      Image_Destroy(image);
+    }
+
+    // outside the data window, and levels a scanline file doesn't have
+    VFile_Handle in = VFile_FromFile("test_data/region.exr", Os_FM_ReadBinary);
+    REQUIRE(in);
+    REQUIRE(Image_LoadEXRRegion(in, 40, 0, 10, 10, 0) == nullptr);
+    VFile_Seek(in, 0, VFile_SD_Begin);
+    REQUIRE(Image_LoadEXRRegion(in, 0, 120, 10, 10, 0) == nullptr);
+    VFile_Seek(in, 0, VFile_SD_Begin);
+    REQUIRE(Image_LoadEXRRegion(in, 0, 0, 10, 10, 1) == nullptr);
+    VFile_Close(in);
+  }
+  Os_FileDelete("test_data/region.exr");
+}
+
+// TinyExr can't save tiled files, so they're built by hand: uncompressed
+// float B, G, R channels in tiles of tileSize, single level or round down
+// mip mapped. R is x + 1000 * level, G is y and B the level. prefix bytes
+// of junk go before the EXR, tileOffsets gets the offset of every tile
+static std::vector<uint8_t> MakeTiledEXR(uint32_t width, uint32_t height, uint32_t tileSize, bool mipmapped,
+                                         size_t prefix, std::vector<uint64_t> *tileOffsets) {
+  std::vector<uint8_t> exr(prefix, 0xCD);
+  auto append = [&exr](void const *data, size_t size) {
+    exr.insert(exr.end(), (uint8_t const *) data, (uint8_t const *) data + size);
+  };
+  auto append32 = [&append](uint32_t value) { append(&value, sizeof(value)); };
+  auto attribute = [&](char const *name, char const *type, uint32_t size) {
+    append(name, strlen(name) + 1);
+    append(type, strlen(type) + 1);
+    append32(size);
+  };
+
+  uint8_t const magic[8] = {0x76, 0x2F, 0x31, 0x01, 2, 0x02, 0, 0};
+  append(magic, sizeof(magic));
+  attribute("channels", "chlist", 3 * 18 + 1);
+  for (char const *name : {"B", "G", "R"}) {
+    append(name, 2);
+    append32(TINYEXR_PIXELTYPE_FLOAT);
+    append32(0);
+    append32(1);
+    append32(1);
+  }
+  exr.push_back(0);
+  attribute("compression", "compression", 1);
+  exr.push_back(TINYEXR_COMPRESSIONTYPE_NONE);
+  uint32_t const window[4] = {0, 0, width - 1, height - 1};
+  attribute("dataWindow", "box2i", 16);
+  append(window, sizeof(window));
+  attribute("displayWindow", "box2i", 16);
+  append(window, sizeof(window));
+  attribute("lineOrder", "lineOrder", 1);
+  exr.push_back(0);
+  float const one = 1.0f;
+  float const zero[2] = {0.0f, 0.0f};
+  attribute("pixelAspectRatio", "float", 4);
+  append(&one, sizeof(one));
+  attribute("screenWindowCenter", "v2f", 8);
+  append(zero, sizeof(zero));
+  attribute("screenWindowWidth", "float", 4);
+  append(&one, sizeof(one));
+  attribute("tiles", "tiledesc", 9);
+  append32(tileSize);
+  append32(tileSize);
+  exr.push_back(mipmapped ? TINYEXR_TILE_MIPMAP_LEVELS : TINYEXR_TILE_ONE_LEVEL);
+  exr.push_back(0);
+
+  uint32_t levels = 1;
+  while (mipmapped && (std::max(width, height) >> levels) > 0) { levels++; }
+  size_t numTiles = 0;
+  for (uint32_t level = 0; level < levels; ++level) {
+    uint32_t const w = std::max(width >> level, 1u);
+    uint32_t const h = std::max(height >> level, 1u);
+    numTiles += ((w + tileSize - 1) / tileSize) * ((h + tileSize - 1) / tileSize);
+  }
+  size_t const table = exr.size();
+  exr.resize(table + numTiles * 8);
+
+  tileOffsets->clear();
+  for (uint32_t level = 0; level < levels; ++level) {
+    uint32_t const w = std::max(width >> level, 1u);
+    uint32_t const h = std::max(height >> level, 1u);
+    for (uint32_t ty = 0; ty < (h + tileSize - 1) / tileSize; ++ty) {
+      for (uint32_t tx = 0; tx < (w + tileSize - 1) / tileSize; ++tx) {
+        uint64_t const offset = exr.size() - prefix;
+        memcpy(&exr[table + tileOffsets->size() * 8], &offset, sizeof(offset));
+        tileOffsets->push_back(offset);
+        uint32_t const tw = std::min(tileSize, w - tx * tileSize);
+        uint32_t const th = std::min(tileSize, h - ty * tileSize);
+        append32(tx);
+        append32(ty);
+        append32(level);
+        append32(level);
+        append32(tw * th * 3 * sizeof(float));
+        for (uint32_t y = ty * tileSize; y < ty * tileSize + th; ++y) {
+          for (int c = 0; c < 3; ++c) {
+            for (uint32_t x = tx * tileSize; x < tx * tileSize + tw; ++x) {
+              float const value = c == 0 ? (float) level : c == 1 ? (float) y : (float) (x + 1000 * level);
+              append(&value, sizeof(value));
+            }
+          }
+        }
+      }
+    }
+  }
+  return exr;
+}
+
+static void CheckTiledRegion(char const *fileName, size_t prefix, uint32_t level, uint32_t const region[4]) {
+  VFile_Handle in = VFile_FromFile(fileName, Os_FM_ReadBinary);
+  REQUIRE(in);
+  VFile_Seek(in, (int64_t) prefix, VFile_SD_Begin);
+  Image_ImageHeader *image = Image_LoadEXRRegion(in, region[0], region[1], region[2], region[3], level);
+  VFile_Close(in);
+  REQUIRE(image);
+  REQUIRE(image->width == region[2]);
+  REQUIRE(image->height == region[3]);
+  float const *pixels = (float const *) Image_RawDataPtr(image);
+  for (uint32_t y = 0; y < region[3]; ++y) {
+    for (uint32_t x = 0; x < region[2]; ++x) {
+      float const *pixel = pixels + (y * region[2] + x) * 3;
+      REQUIRE(pixel[0] == (float) (region[0] + x + 1000 * level));
+      REQUIRE(pixel[1] == (float) (region[1] + y));
+      REQUIRE(pixel[2] == (float) level);
+    }
+  }
+  Image_Destroy(image);
+}
+
+static void WriteBytes(char const *fileName, std::vector<uint8_t> const &data) {
+  VFile_Handle out = VFile_FromFile(fileName, Os_FM_WriteBinary);
+  REQUIRE(out);
+  REQUIRE(VFile_Write(out, data.data(), data.size()) == data.size());
+  VFile_Close(out);
+}
+
+TEST_CASE("Image io EXR tiled region (C)", "[Image]") {
+  uint32_t const width = 37;
+  uint32_t const height = 29;
+  std::vector<uint64_t> tileOffsets;
+
+  // single level, regions straddling tiles, in the last partial tile and everything
+  WriteBytes("test_data/tiled.exr", MakeTiledEXR(width, height, 8, false, 0, &tileOffsets));
+  uint32_t const regions[][4] = {
+      {3, 5, 20, 17},
+      {36, 28, 1, 1},
+      {0, 0, width, height},
+  };
+  for (auto const &region : regions) {
+    CheckTiledRegion("test_data/tiled.exr", 0, 0, region);
+  }
+  VFile_Handle in = VFile_FromFile("test_data/tiled.exr", Os_FM_ReadBinary);
+  REQUIRE(in);
+  REQUIRE(Image_LoadEXRRegion(in, 0, 0, 4, 4, 1) == nullptr);
+  VFile_Close(in);
+
+  // every mip level, after some bytes that aren't part of the EXR
+  size_t const prefix = 100;
+  WriteBytes("test_data/tiled.exr", MakeTiledEXR(width, height, 8, true, prefix, &tileOffsets));
+  for (uint32_t level = 0; level < 6; ++level) {
+    uint32_t const w = std::max(width >> level, 1u);
+    uint32_t const h = std::max(height >> level, 1u);
+    uint32_t const whole[4] = {0, 0, w, h};
+    uint32_t const corner[4] = {w / 2, h / 2, w - w / 2, h - h / 2};
+    CheckTiledRegion("test_data/tiled.exr", prefix, level, whole);
+    CheckTiledRegion("test_data/tiled.exr", prefix, level, corner);
+  }
+  in = VFile_FromFile("test_data/tiled.exr", Os_FM_ReadBinary);
+  REQUIRE(in);
+  VFile_Seek(in, (int64_t) prefix, VFile_SD_Begin);
+  REQUIRE(Image_LoadEXRRegion(in, 0, 0, 1, 1, 6) == nullptr);
+  VFile_Close(in);
+
+  // a tile claiming the wrong level or position is rejected. Level 1 is
+  // 18x14, its first tile follows the 5x4 of level 0
+  for (int field = 0; field < 4; ++field) {
+    std::vector<uint8_t> exr = MakeTiledEXR(width, height, 8, true, prefix, &tileOffsets);
+    uint32_t const wrong = 3;
+    memcpy(&exr[prefix + tileOffsets[20] + field * 4], &wrong, sizeof(wrong));
+    WriteBytes("test_data/tiled.exr", exr);
+    in = VFile_FromFile("test_data/tiled.exr", Os_FM_ReadBinary);
+    REQUIRE(in);
+    VFile_Seek(in, (int64_t) prefix, VFile_SD_Begin);
+    REQUIRE(Image_LoadEXRRegion(in, 0, 0, 4, 4, 1) == nullptr);
+    VFile_Seek(in, (int64_t) prefix, VFile_SD_Begin);
+    Image_ImageHeader *image = Image_LoadEXRRegion(in, 8, 8, 4, 4, 1);
+    REQUIRE(image);
+    Image_Destroy(image);
+    VFile_Close(in);
+  }
+  Os_FileDelete("test_data/tiled.exr");
+}
+
+TEST_CASE("Image io DDS mapped (C)", "[Image]") {
+  Image_ImageHeader *image = Image_Create2D(64, 32, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image);
+  Image_CreateMipMapChain(image, false);
+  for (size_t level = 0; level < Image_LinkedImageCountOf(image); ++level) {
+    Image_ImageHeader const *mip = Image_LinkedImageOf(image, level);
+    memset(Image_RawDataPtr(mip), (int) (level + 1), Image_ByteCountOf(mip));
+  }
+  VFile_Handle out = VFile_FromFile("test_data/mapped.dds", Os_FM_WriteBinary);
+  REQUIRE(out);
+  // SaveDDS closes the file
+  REQUIRE(Image_SaveDDS(image, out));
+
+  Image_ImageHeader *mapped = Image_LoadDDSMapped("test_data/mapped.dds");
+  REQUIRE(mapped);
+  REQUIRE(mapped->width == 64);
+  REQUIRE(mapped->height == 32);
+  REQUIRE(mapped->format == Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(Image_LinkedImageCountOf(mapped) == Image_LinkedImageCountOf(image));
+  for (size_t level = 0; level < Image_LinkedImageCountOf(mapped); ++level) {
+    Image_ImageHeader const *mip = Image_LinkedImageOf(mapped, level);
+    Image_ImageHeader const *expected = Image_LinkedImageOf(image, level);
+    REQUIRE((mip->flags & Image_Flag_ExternalData) != 0);
+    REQUIRE(mip->width == expected->width);
+    REQUIRE(mip->height == expected->height);
+    REQUIRE(memcmp(Image_RawDataPtr(mip), Image_RawDataPtr(expected), Image_ByteCountOf(mip)) == 0);
+  }
+
+  // a level keeps the mapping alive after the rest of the chain has gone
+  Image_ImageHeader *level2 = mapped->nextImage->nextImage;
+  mapped->nextImage->nextType = Image_IT_None;
+  mapped->nextImage->nextImage = nullptr;
+  Image_Destroy(mapped);
+  REQUIRE(((uint8_t const *) Image_RawDataPtr(level2))[0] == 3);
+  Image_Destroy(level2);
+  Image_Destroy(image);
+  Os_FileDelete("test_data/mapped.dds");
+
+  REQUIRE(Image_LoadDDSMapped("test_data/does_not_exist.dds") == nullptr);
+}
+
+TEST_CASE("Image io DDS mapped cubemap (C)", "[Image]") {
+  Image_ImageHeader *image = Image_CreateCubemap(16, 16, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image);
+  Image_CreateMipMapChain(image, false);
+  for (size_t level = 0; level < Image_LinkedImageCountOf(image); ++level) {
+    Image_ImageHeader const *mip = Image_LinkedImageOf(image, level);
+    for (uint32_t face = 0; face < 6; ++face) {
+      memset(((uint8_t *) Image_RawDataPtr(mip)) + face * Image_ByteCountPerSliceOf(mip),
+             (int) (level * 16 + face),
+             Image_ByteCountPerSliceOf(mip));
+    }
+  }
+  VFile_Handle out = VFile_FromFile("test_data/mapped_cube.dds", Os_FM_WriteBinary);
+  REQUIRE(out);
+  REQUIRE(Image_SaveDDS(image, out));
+
+  // several faces and levels have to be copied out of the mapping
+  Image_ImageHeader *mapped = Image_LoadDDSMapped("test_data/mapped_cube.dds");
+  REQUIRE(mapped);
+  REQUIRE(mapped->slices == 6);
+  REQUIRE(Image_IsCubemap(mapped));
+  REQUIRE(Image_LinkedImageCountOf(mapped) == 5);
+  Image_ImageHeader const *mip = Image_LinkedImageOf(mapped, 2);
+  REQUIRE((mip->flags & Image_Flag_ExternalData) == 0);
+  REQUIRE(Image_PackedChainOf(mip) == Image_PackedChainOf(mapped));
+  uint8_t const *data = (uint8_t const *) Image_RawDataPtr(mip);
+  REQUIRE(data[0] == 2 * 16);
+  REQUIRE(data[3 * Image_ByteCountPerSliceOf(mip)] == 2 * 16 + 3);
+
+  Image_Destroy(mapped);
+  Image_Destroy(image);
+  Os_FileDelete("test_data/mapped_cube.dds");
+}
+
+TEST_CASE("Image io DDS range (C)", "[Image]") {
+  Image_ImageHeader *image = Image_CreateCubemap(16, 16, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image);
+  Image_CreateMipMapChain(image, false);
+  for (size_t level = 0; level < Image_LinkedImageCountOf(image); ++level) {
+    Image_ImageHeader const *mip = Image_LinkedImageOf(image, level);
+    for (uint32_t face = 0; face < 6; ++face) {
+      memset(((uint8_t *) Image_RawDataPtr(mip)) + face * Image_ByteCountPerSliceOf(mip),
+             (int) (level * 16 + face),
+             Image_ByteCountPerSliceOf(mip));
+    }
+  }
+  VFile_Handle out = VFile_FromFile("test_data/range.dds", Os_FM_WriteBinary);
+  REQUIRE(out);
+  REQUIRE(Image_SaveDDS(image, out));
+
+  VFile_Handle file = VFile_FromFile("test_data/range.dds", Os_FM_ReadBinary);
+  REQUIRE(file);
+  Image_ImageHeader *range = Image_LoadDDSRange(file, 2, ~0u, 3, 2);
+  REQUIRE(range);
+  REQUIRE(range->width == 4);
+  REQUIRE(range->slices == 2);
+  REQUIRE(!Image_IsCubemap(range));
+  REQUIRE(Image_LinkedImageCountOf(range) == 3);
+  for (size_t level = 0; level < 3; ++level) {
+    Image_ImageHeader const *mip = Image_LinkedImageOf(range, level);
+    uint8_t const *data = (uint8_t const *) Image_RawDataPtr(mip);
+    REQUIRE(data[0] == (level + 2) * 16 + 3);
+    REQUIRE(data[Image_ByteCountOf(mip) - 1] == (level + 2) * 16 + 4);
+  }
+  Image_Destroy(range);
+
+  VFile_Seek(file, 0, VFile_SD_Begin);
+  REQUIRE(Image_LoadDDSRange(file, 5, 1, 0, 1) == nullptr);
+
+  VFile_Seek(file, 0, VFile_SD_Begin);
+  Image_ImageHeader *whole = Image_LoadDDS(file);
+  REQUIRE(whole);
+  REQUIRE(Image_IsCubemap(whole));
+  REQUIRE(Image_LinkedImageCountOf(whole) == 5);
+  Image_ImageHeader const *last = Image_LinkedImageOf(whole, 4);
+  REQUIRE(((uint8_t const *) Image_RawDataPtr(last))[5 * 4] == 4 * 16 + 5);
+  Image_Destroy(whole);
+
+  VFile_Close(file);
+  Image_Destroy(image);
+  Os_FileDelete("test_data/range.dds");
+}
+
+TEST_CASE("Image io DDS block compressed (C)", "[Image]") {
+  // FourCC or DXGI format each block format is saved with
+  struct {
+    Image_Format format;
+    char const *fourCC;
+    uint32_t dxgiFormat;
+  } const cases[] = {
+      {Image_Format_BC1_RGBA_UNORM_BLOCK, "DXT1", 0},
+      {Image_Format_BC2_UNORM_BLOCK, "DXT3", 0},
+      {Image_Format_BC3_UNORM_BLOCK, "DXT5", 0},
+      {Image_Format_BC4_UNORM_BLOCK, "ATI1", 0},
+      {Image_Format_BC5_UNORM_BLOCK, "ATI2", 0},
+      {Image_Format_BC1_RGB_UNORM_BLOCK, "DX10", 71},
+      {Image_Format_BC1_RGBA_SRGB_BLOCK, "DX10", 72},
+      {Image_Format_BC3_SRGB_BLOCK, "DX10", 78},
+      {Image_Format_BC4_SNORM_BLOCK, "DX10", 81},
+      {Image_Format_BC5_SNORM_BLOCK, "DX10", 84},
+      {Image_Format_BC6H_UFLOAT_BLOCK, "DX10", 95},
+      {Image_Format_BC6H_SFLOAT_BLOCK, "DX10", 96},
+      {Image_Format_BC7_UNORM_BLOCK, "DX10", 98},
+      {Image_Format_BC7_SRGB_BLOCK, "DX10", 99},
+  };
+
+  for (auto const &c : cases) {
+    // mip generation doesn't work on blocks so link the levels by hand
+    Image_ImageHeader *image = Image_Create(16, 8, 1, 1, c.format);
+    REQUIRE(image);
+    image->nextType = Image_IT_MipMaps;
+    image->nextImage = Image_Create(8, 4, 1, 1, c.format);
+    REQUIRE(image->nextImage);
+    for (size_t level = 0; level < Image_LinkedImageCountOf(image); ++level) {
+      Image_ImageHeader const *mip = Image_LinkedImageOf(image, level);
+      uint8_t *data = (uint8_t *) Image_RawDataPtr(mip);
+      for (size_t i = 0; i < Image_ByteCountOf(mip); ++i) {
+        data[i] = (uint8_t) (level * 64 + i * 7);
+      }
+    }
+
+    // SaveDDS closes the file
+    std::vector<uint8_t> buffer(4 * 1024);
+    REQUIRE(Image_SaveDDS(image, VFile_FromMemory(buffer.data(), buffer.size(), false)));
+    uint32_t const *header = (uint32_t const *) buffer.data();
+    REQUIRE(memcmp(buffer.data() + 84, c.fourCC, 4) == 0);
+    if (c.dxgiFormat) {
+      REQUIRE(header[32] == c.dxgiFormat);
+      REQUIRE(header[33] == 3); // 2D
+    }
+
+    VFile_Handle handle = VFile_FromMemory(buffer.data(), buffer.size(), false);
+    Image_ImageHeader *loaded = Image_LoadDDS(handle);
+    REQUIRE(loaded);
+    REQUIRE(loaded->format == c.format);
+    REQUIRE(loaded->width == 16);
+    REQUIRE(Image_LinkedImageCountOf(loaded) == Image_LinkedImageCountOf(image));
+    for (size_t level = 0; level < Image_LinkedImageCountOf(image); ++level) {
+      Image_ImageHeader const *a = Image_LinkedImageOf(image, level);
+      Image_ImageHeader const *b = Image_LinkedImageOf(loaded, level);
+      REQUIRE(Image_ByteCountOf(a) == Image_ByteCountOf(b));
+      REQUIRE(memcmp(Image_RawDataPtr(a), Image_RawDataPtr(b), Image_ByteCountOf(a)) == 0);
+    }
+    Image_Destroy(loaded);
+    VFile_Close(handle);
+    Image_Destroy(image);
+  }
+}
+
+static std::string gLastError;
+static void CaptureError(char const *file, int line, char const *function, char const *msg) {
+  gLastError = msg;
+}
+
+TEST_CASE("Image io DDS partial blocks (C)", "[Image]") {
+  Image_ImageHeader *image = Image_Create(8, 8, 1, 1, Image_Format_BC1_RGBA_UNORM_BLOCK);
+  REQUIRE(image);
+  std::vector<uint8_t> buffer(1024);
+  REQUIRE(Image_SaveDDS(image, VFile_FromMemory(buffer.data(), buffer.size(), false)));
+  Image_Destroy(image);
+
+  // 6x6 needs 2x2 padded blocks which aren't loadable, patch the size after
+  // the "DDS " magic
+  uint32_t *header = (uint32_t *) buffer.data();
+  header[3] = 6; // height
+  header[4] = 6; // width
+
+  Core_Logger const saved = Core_Log;
+  Core_Log.errorMsg = &CaptureError;
+  gLastError.clear();
+  VFile_Handle handle = VFile_FromMemory(buffer.data(), buffer.size(), false);
+  Image_ImageHeader *loaded = Image_LoadDDS(handle);
+  VFile_Close(handle);
+  Core_Log = saved;
+
+  REQUIRE(loaded == nullptr);
+  REQUIRE(gLastError.find("6x6") != std::string::npos);
+  REQUIRE(gLastError.find("blocks") != std::string::npos);
+}
+
+TEST_CASE("Image io KTX2 (C)", "[Image]") {
+  Image_ImageHeader *image = Image_CreateCubemap(16, 16, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image);
+  Image_CreateMipMapChain(image, false);
+  for (size_t level = 0; level < Image_LinkedImageCountOf(image); ++level) {
+    Image_ImageHeader const *mip = Image_LinkedImageOf(image, level);
+    uint8_t *data = (uint8_t *) Image_RawDataPtr(mip);
+    for (size_t i = 0; i < Image_ByteCountOf(mip); ++i) {
+      data[i] = (uint8_t) (level * 16 + (i / 64));
+    }
+  }
+
+  Image_KTX2Supercompression const schemes[] = {Image_KTX2_None, Image_KTX2_Deflate, Image_KTX2_LZ4};
+  for (auto scheme : schemes) {
+    std::vector<uint8_t> buffer(64 * 1024);
+    VFile_Handle handle = VFile_FromMemory(buffer.data(), buffer.size(), false);
+    REQUIRE(Image_SaveKTX2(image, handle, scheme));
+    REQUIRE(buffer[1] == 'K');
+
+    // smallest level first
+    uint64_t const *index = (uint64_t const *) (buffer.data() + 80);
+    REQUIRE(index[4 * 3] < index[0]);
+    if (scheme != Image_KTX2_None) {
+      REQUIRE(index[1] < index[2]);
+    }
+
+    VFile_Seek(handle, 0, VFile_SD_Begin);
+    Image_ImageHeader *loaded = Image_LoadKTX2(handle);
+    REQUIRE(loaded);
+    REQUIRE(loaded->format == Image_Format_R8G8B8A8_UNORM);
+    REQUIRE(loaded->slices == 6);
+    REQUIRE(Image_IsCubemap(loaded));
+    REQUIRE(Image_LinkedImageCountOf(loaded) == 5);
+    for (size_t level = 0; level < 5; ++level) {
+      Image_ImageHeader const *a = Image_LinkedImageOf(image, level);
+      Image_ImageHeader const *b = Image_LinkedImageOf(loaded, level);
+      REQUIRE(memcmp(Image_RawDataPtr(a), Image_RawDataPtr(b), Image_ByteCountOf(a)) == 0);
+    }
+    Image_Destroy(loaded);
+
+    VFile_Seek(handle, 0, VFile_SD_Begin);
+    Image_ImageHeader *range = Image_LoadKTX2Range(handle, 3, ~0u);
+    REQUIRE(range);
+    REQUIRE(range->width == 2);
+    REQUIRE(Image_LinkedImageCountOf(range) == 2);
+    REQUIRE(memcmp(Image_RawDataPtr(range),
+                   Image_RawDataPtr(Image_LinkedImageOf(image, 3)),
+                   Image_ByteCountOf(range)) == 0);
+    Image_Destroy(range);
+
+    VFile_Seek(handle, 0, VFile_SD_Begin);
+    REQUIRE(Image_LoadKTX2Range(handle, 5, 1) == nullptr);
+    VFile_Close(handle);
+  }
+  Image_Destroy(image);
+}
+
+// a texel block's data format descriptor samples, {bitOffset, bitLength,
+// channel type} per sample
+static std::vector<uint32_t> KTX2SamplesOf(Image_Format format) {
+  Image_ImageHeader *image = Image_Create(8, 8, 1, 1, format);
+  REQUIRE(image);
+  std::vector<uint8_t> buffer(4 * 1024);
+  VFile_Handle handle = VFile_FromMemory(buffer.data(), buffer.size(), false);
+  REQUIRE(Image_SaveKTX2(image, handle, Image_KTX2_None));
+
+  // the saved file has to load back with its descriptor checked
+  VFile_Seek(handle, 0, VFile_SD_Begin);
+  Image_ImageHeader *loaded = Image_LoadKTX2(handle);
+  REQUIRE(loaded);
+  REQUIRE(loaded->format == format);
+  Image_Destroy(loaded);
+  VFile_Close(handle);
+  Image_Destroy(image);
+
+  uint32_t const *header = (uint32_t const *) buffer.data();
+  uint32_t const *dfd = (uint32_t const *) (buffer.data() + header[12]);
+  REQUIRE(dfd[0] == header[13]);
+  uint32_t const blockSize = dfd[2] >> 16;
+  REQUIRE(dfd[0] == 4 + blockSize);
+  REQUIRE((blockSize - 24) % 16 == 0);
+  REQUIRE(dfd[5] == Image_Format_BitWidth(format) *
+      (Image_Format_IsCompressed(format) ? 16 : 1) / 8);
+
+  std::vector<uint32_t> samples;
+  for (uint32_t i = 0; i < (blockSize - 24) / 16; ++i) {
+    uint32_t const *sample = dfd + 7 + i * 4;
+    samples.push_back(sample[0] & 0xFFFF);
+    samples.push_back(((sample[0] >> 16) & 0xFF) + 1);
+    samples.push_back(sample[0] >> 24);
+  }
+  return samples;
+}
+
+TEST_CASE("Image io KTX2 data format descriptor (C)", "[Image]") {
+  // R, G, B and A are channel ids 0, 1, 2 and 15, 0x10 linear, 0x40 signed
+  // and 0x80 float
+  REQUIRE(KTX2SamplesOf(Image_Format_R8G8B8A8_SRGB) ==
+      std::vector<uint32_t>({0, 8, 0, 8, 8, 1, 16, 8, 2, 24, 8, 15 | 0x10}));
+  REQUIRE(KTX2SamplesOf(Image_Format_B8G8R8A8_UNORM) ==
+      std::vector<uint32_t>({0, 8, 2, 8, 8, 1, 16, 8, 0, 24, 8, 15}));
+  REQUIRE(KTX2SamplesOf(Image_Format_R16G16_SFLOAT) ==
+      std::vector<uint32_t>({0, 16, 0xC0, 16, 16, 0xC1}));
+  REQUIRE(KTX2SamplesOf(Image_Format_A2R10G10B10_UNORM_PACK32) ==
+      std::vector<uint32_t>({0, 10, 2, 10, 10, 1, 20, 10, 0, 30, 2, 15}));
+  REQUIRE(KTX2SamplesOf(Image_Format_R5G6B5_UNORM_PACK16) ==
+      std::vector<uint32_t>({0, 5, 2, 5, 6, 1, 11, 5, 0}));
+  REQUIRE(KTX2SamplesOf(Image_Format_D24_UNORM_S8_UINT) ==
+      std::vector<uint32_t>({0, 24, 14, 24, 8, 13}));
+
+  // compressed blocks have a sample per coded part
+  REQUIRE(KTX2SamplesOf(Image_Format_BC1_RGBA_UNORM_BLOCK) == std::vector<uint32_t>({0, 64, 1}));
+  REQUIRE(KTX2SamplesOf(Image_Format_BC3_UNORM_BLOCK) ==
+      std::vector<uint32_t>({0, 64, 15 | 0x10, 64, 64, 0}));
+  REQUIRE(KTX2SamplesOf(Image_Format_BC5_SNORM_BLOCK) ==
+      std::vector<uint32_t>({0, 64, 0x40, 64, 64, 0x41}));
+  REQUIRE(KTX2SamplesOf(Image_Format_BC6H_UFLOAT_BLOCK) == std::vector<uint32_t>({0, 128, 0x80}));
+  REQUIRE(KTX2SamplesOf(Image_Format_BC7_SRGB_BLOCK) == std::vector<uint32_t>({0, 128, 0}));
+
+  // a sample past the end of the texel block is rejected
+  Image_ImageHeader *image = Image_Create(4, 4, 1, 1, Image_Format_R8G8B8A8_UNORM);
+  std::vector<uint8_t> buffer(4 * 1024);
+  VFile_Handle handle = VFile_FromMemory(buffer.data(), buffer.size(), false);
+  REQUIRE(Image_SaveKTX2(image, handle, Image_KTX2_None));
+  uint32_t const *header = (uint32_t const *) buffer.data();
+  uint32_t *dfd = (uint32_t *) (buffer.data() + header[12]);
+  dfd[7 + 3 * 4] += 8;
+  VFile_Seek(handle, 0, VFile_SD_Begin);
+  REQUIRE(Image_LoadKTX2(handle) == nullptr);
+  VFile_Close(handle);
+  Image_Destroy(image);
+}
+
+TEST_CASE("Image io PVR range (C)", "[Image]") {
+  // PVRTC 4bpp 32x32, 2 surfaces, 4 levels (the last is padded and skipped)
+  uint32_t const header[13] = {
+      0x03525650, 0, 2, 0, 0, 0, 32, 32, 1, 2, 1, 4, 4
+  };
+  size_t const levelBytes[4] = {512, 128, 32, 32};
+  std::vector<uint8_t> file((uint8_t const *) header, (uint8_t const *) header + sizeof(header));
+  file.insert(file.end(), 4, 0xFF);
+  for (uint32_t level = 0; level < 4; ++level) {
+    for (uint32_t surface = 0; surface < 2; ++surface) {
+      file.insert(file.end(), levelBytes[level], (uint8_t) (level * 16 + surface));
+    }
+  }
+
+  VFile_Handle handle = VFile_FromMemory(file.data(), file.size(), false);
+  Image_ImageHeader *range = Image_LoadPVRRange(handle, 1, ~0u, 1, 1);
+  REQUIRE(range);
+  REQUIRE(range->format == Image_Format_PVR_4BPP_BLOCK);
+  REQUIRE(range->width == 16);
+  REQUIRE(range->slices == 1);
+  REQUIRE(Image_LinkedImageCountOf(range) == 2);
+  REQUIRE(((uint8_t const *) Image_RawDataPtr(range))[0] == 16 + 1);
+  REQUIRE(((uint8_t const *) Image_RawDataPtr(range->nextImage))[31] == 32 + 1);
+  Image_Destroy(range);
+
+  VFile_Seek(handle, 0, VFile_SD_Begin);
+  Image_ImageHeader *whole = Image_LoadPVR(handle);
+  REQUIRE(whole);
+  REQUIRE(whole->slices == 2);
+  REQUIRE(Image_LinkedImageCountOf(whole) == 3);
+  REQUIRE(((uint8_t const *) Image_RawDataPtr(whole))[512] == 1);
+  Image_Destroy(whole);
+  VFile_Close(handle);
+}
+
+TEST_CASE("Image io header probe (C)", "[Image]") {
+  Image_ImageHeader *image = Image_CreateCubemap(16, 16, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image);
+  Image_CreateMipMapChain(image, false);
+
+  // probing leaves the file where it was so it can be loaded straight after
+  std::vector<uint8_t> buffer(64 * 1024);
+  VFile_Handle handle = VFile_FromMemory(buffer.data(), buffer.size(), false);
+  REQUIRE(Image_SaveKTX2(image, handle, Image_KTX2_LZ4));
+  VFile_Seek(handle, 0, VFile_SD_Begin);
+  Image_ImageHeader header;
+  uint32_t mipCount = 0;
+  REQUIRE(Image_LoadHeader(handle, &header, &mipCount));
+  REQUIRE(VFile_Tell(handle) == 0);
+  REQUIRE(header.width == 16);
+  REQUIRE(header.height == 16);
+  REQUIRE(header.slices == 6);
+  REQUIRE(header.format == Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(Image_IsCubemap(&header));
+  REQUIRE((header.flags & Image_Flag_HeaderOnly) != 0);
+  REQUIRE(mipCount == 5);
+
+  // memory files have no name, the format comes from the magic
+  Image_ImageHeader *loaded = Image_Load(handle);
+  REQUIRE(loaded);
+  REQUIRE(Image_LinkedImageCountOf(loaded) == 5);
+  Image_Destroy(loaded);
+  VFile_Close(handle);
+
+  std::fill(buffer.begin(), buffer.end(), 0);
+  handle = VFile_FromMemory(buffer.data(), buffer.size(), false);
+  REQUIRE(Image_SavePNG((Image_ImageHeader *) Image_LinkedImageOf(image, 1), handle));
+  VFile_Seek(handle, 0, VFile_SD_Begin);
+  REQUIRE(Image_LoadHeader(handle, &header, nullptr));
+  REQUIRE(header.width == 8);
+  REQUIRE(header.height == 8);
+  REQUIRE(header.format == Image_Format_R8G8B8A8_UNORM);
+  VFile_Close(handle);
+  Image_Destroy(image);
+
+  // PVRTC 4bpp 32x32 with 4 levels, the last is padded so isn't counted
+  uint32_t const pvr[13] = {
+      0x03525650, 0, 2, 0, 0, 0, 32, 32, 1, 2, 1, 4, 0
+  };
+  handle = VFile_FromMemory((void *) pvr, sizeof(pvr), false);
+  REQUIRE(Image_LoadHeader(handle, &header, &mipCount));
+  REQUIRE(header.format == Image_Format_PVR_4BPP_BLOCK);
+  REQUIRE(header.slices == 2);
+  REQUIRE(mipCount == 3);
+  VFile_Close(handle);
+
+  uint8_t garbage[16] = {0};
+  handle = VFile_FromMemory(garbage, sizeof(garbage), false);
+  REQUIRE(Image_LoadHeader(handle, &header, &mipCount) == false);
+  VFile_Close(handle);
+}
+
+static uint32_t ReadPNGU32(uint8_t const *p) {
+  return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+TEST_CASE("Image io PNG options (C)", "[Image]") {
+  // tall enough to be split into several deflate stripes
+  Image_ImageHeader *image = Image_Create2D(300, 700, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image);
+  uint8_t *pixels = (uint8_t *) Image_RawDataPtr(image);
+  for (size_t i = 0; i < Image_ByteCountOf(image); ++i) {
+    pixels[i] = (uint8_t) ((i / 4) % 300 + (i / 1200) * 3 + (i & 3) * 50);
+  }
+
+  Image_PNGFilter const filters[] = {
+      Image_PNGFilter_Adaptive, Image_PNGFilter_None, Image_PNGFilter_Sub,
+      Image_PNGFilter_Up, Image_PNGFilter_Average, Image_PNGFilter_Paeth
+  };
+  for (auto filter : filters) {
+    for (int32_t level = 0; level <= 9; level += 3) {
+      Image_PNGSaveOptions const options = {level, filter};
+      std::vector<uint8_t> buffer(Image_ByteCountOf(image) * 2);
+      VFile_Handle handle = VFile_FromMemory(buffer.data(), buffer.size(), false);
+      REQUIRE(Image_SavePNGWithOptions(image, handle, &options));
+      size_t const size = (size_t) VFile_Tell(handle);
+
+      // every chunk crc must check out and the joined IDATs must be one
+      // zlib stream, mz_uncompress checks the adler32
+      std::vector<uint8_t> zlib;
+      size_t idatCount = 0;
+      for (size_t offset = 8; offset < size;) {
+        uint32_t const length = ReadPNGU32(&buffer[offset]);
+        uint8_t const *type = &buffer[offset + 4];
+        REQUIRE(ReadPNGU32(type + 4 + length) == mz_crc32(MZ_CRC32_INIT, type, 4 + length));
+        if (memcmp(type, "IDAT", 4) == 0) {
+          zlib.insert(zlib.end(), type + 4, type + 4 + length);
+          ++idatCount;
+        }
+        offset += 12 + length;
+      }
+      REQUIRE(idatCount > 1);
+      mz_ulong filteredSize = 700 * (300 * 4 + 1);
+      std::vector<uint8_t> filtered(filteredSize);
+      REQUIRE(mz_uncompress(filtered.data(), &filteredSize, zlib.data(), (mz_ulong) zlib.size()) == MZ_OK);
+      REQUIRE(filteredSize == filtered.size());
+
+      VFile_Seek(handle, 0, VFile_SD_Begin);
+      Image_ImageHeader *loaded = Image_LoadLDR(handle);
+      REQUIRE(loaded);
+      REQUIRE(loaded->width == 300);
+      REQUIRE(loaded->height == 700);
+      REQUIRE(memcmp(Image_RawDataPtr(loaded), pixels, Image_ByteCountOf(image)) == 0);
+      Image_Destroy(loaded);
+      VFile_Close(handle);
+    }
+  }
+  Image_Destroy(image);
+}
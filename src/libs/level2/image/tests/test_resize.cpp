@@ -0,0 +1,119 @@
+#include "core/core.h"
+#include "catch/catch.hpp"
+#include "image/image.h"
+#include "image/format_cracker.h"
+#include "image/create.h"
+#include "image/resize.h"
+#include "stb/stb_image_resize.h"
+#include <vector>
+
+TEST_CASE("Image resize constant (C)", "[Image Resize]") {
+  Image_ImageHeader *image = Image_Create2DArray(37, 21, 2, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image);
+  uint8_t *data = (uint8_t *) Image_RawDataPtr(image);
+  for (size_t i = 0; i < Image_ByteCountOf(image); ++i) {
+    data[i] = (uint8_t) (40 + (i & 3) * 50);
+  }
+
+  Image_ResizeFilter const filters[] = {
+      Image_RF_Default, Image_RF_Box, Image_RF_Triangle,
+      Image_RF_CubicBSpline, Image_RF_CatmullRom, Image_RF_Mitchell
+  };
+  for (auto filter : filters) {
+    Image_ImageHeader *resized = Image_Resize(image, 90, 11, filter, 0);
+    REQUIRE(resized);
+    REQUIRE(resized->width == 90);
+    REQUIRE(resized->height == 11);
+    REQUIRE(resized->slices == 2);
+    REQUIRE(resized->format == Image_Format_R8G8B8A8_UNORM);
+    uint8_t const *out = (uint8_t const *) Image_RawDataPtr(resized);
+    for (size_t i = 0; i < Image_ByteCountOf(resized); ++i) {
+      REQUIRE(out[i] == (uint8_t) (40 + (i & 3) * 50));
+    }
+    Image_Destroy(resized);
+  }
+  Image_Destroy(image);
+}
+
+TEST_CASE("Image resize bands match a single resize (C)", "[Image Resize]") {
+  // tall enough for several bands, banded output must be identical to one
+  // resize of the whole image
+  uint32_t const w = 50;
+  uint32_t const h = 300;
+  Image_ImageHeader *image = Image_Create2D(w, h, Image_Format_R32G32B32A32_SFLOAT);
+  REQUIRE(image);
+  float *data = (float *) Image_RawDataPtr(image);
+  for (size_t i = 0; i < Image_PixelCountOf(image) * 4; ++i) {
+    data[i] = (float) ((i * 7919) % 1000) / 1000.0f;
+  }
+
+  uint32_t const sizes[][2] = {{23, 117}, {80, 451}};
+  for (auto size : sizes) {
+    Image_ImageHeader *resized = Image_Resize(image, size[0], size[1], Image_RF_Mitchell, 0);
+    REQUIRE(resized);
+    std::vector<float> expected(size[0] * size[1] * 4);
+    REQUIRE(stbir_resize(data, w, h, 0, expected.data(), size[0], size[1], 0,
+                         STBIR_TYPE_FLOAT, 4, 3, 0, STBIR_EDGE_CLAMP, STBIR_EDGE_CLAMP,
+                         STBIR_FILTER_MITCHELL, STBIR_FILTER_MITCHELL, STBIR_COLORSPACE_LINEAR, nullptr));
+    float const *out = (float const *) Image_RawDataPtr(resized);
+    for (size_t i = 0; i < expected.size(); ++i) {
+      REQUIRE(out[i] == Approx(expected[i]).margin(1e-5));
+    }
+    Image_Destroy(resized);
+  }
+  Image_Destroy(image);
+}
+
+TEST_CASE("Image resize sRGB and alpha (C)", "[Image Resize]") {
+  // a black and white pair box filtered to one pixel is mid grey in linear
+  // light, which is ~188 in sRGB
+  Image_ImageHeader *image = Image_Create2D(2, 1, Image_Format_R8G8B8A8_SRGB);
+  REQUIRE(image);
+  uint8_t *data = (uint8_t *) Image_RawDataPtr(image);
+  uint8_t const pixels[8] = {0, 0, 0, 255, 255, 255, 255, 255};
+  memcpy(data, pixels, sizeof(pixels));
+
+  Image_ImageHeader *resized = Image_Resize(image, 1, 1, Image_RF_Box, 0);
+  REQUIRE(resized);
+  uint8_t const *out = (uint8_t const *) Image_RawDataPtr(resized);
+  REQUIRE(out[0] >= 186);
+  REQUIRE(out[0] <= 190);
+  REQUIRE(out[3] == 255);
+  Image_Destroy(resized);
+
+  resized = Image_Resize(image, 1, 1, Image_RF_Box, Image_RF_Flag_IgnoreSRGB);
+  REQUIRE(resized);
+  out = (uint8_t const *) Image_RawDataPtr(resized);
+  REQUIRE(out[0] >= 127);
+  REQUIRE(out[0] <= 128);
+  Image_Destroy(resized);
+  Image_Destroy(image);
+
+  // the transparent green mustn't bleed into the opaque red
+  image = Image_Create2D(2, 1, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image);
+  uint8_t const redAndClear[8] = {255, 0, 0, 255, 0, 255, 0, 0};
+  memcpy(Image_RawDataPtr(image), redAndClear, sizeof(redAndClear));
+  resized = Image_Resize(image, 1, 1, Image_RF_Box, 0);
+  REQUIRE(resized);
+  out = (uint8_t const *) Image_RawDataPtr(resized);
+  REQUIRE(out[0] == 255);
+  REQUIRE(out[1] == 0);
+  REQUIRE(out[3] >= 127);
+  REQUIRE(out[3] <= 128);
+  Image_Destroy(resized);
+
+  resized = Image_Resize(image, 1, 1, Image_RF_Box, Image_RF_Flag_AlphaPremultiplied);
+  REQUIRE(resized);
+  out = (uint8_t const *) Image_RawDataPtr(resized);
+  REQUIRE(out[1] >= 127);
+  REQUIRE(out[1] <= 128);
+  Image_Destroy(resized);
+  Image_Destroy(image);
+
+  image = Image_Create2D(4, 4, Image_Format_R16G16B16A16_SFLOAT);
+  REQUIRE(image);
+  REQUIRE(Image_ResizeIsSupported(image->format) == false);
+  REQUIRE(Image_Resize(image, 2, 2, Image_RF_Default, 0) == nullptr);
+  Image_Destroy(image);
+}
@@ -0,0 +1,137 @@
+#include "core/core.h"
+#include "catch/catch.hpp"
+#include "image/image.h"
+#include "image/format_cracker.h"
+#include "image/create.h"
+#include "image/utils.h"
+
+TEST_CASE("Image statistics float (C)", "[Image Stats]") {
+  // big offset so a naive sum of squares would lose the variance
+  Image_ImageHeader *image = Image_Create2D(333, 97, Image_Format_R32G32_SFLOAT);
+  REQUIRE(image);
+  float *data = (float *) Image_RawDataPtr(image);
+  size_t const count = Image_PixelCountOf(image);
+  double sum = 0.0;
+  for (size_t i = 0; i < count; ++i) {
+    data[i * 2 + 0] = 10000.0f + (float) (i % 7);
+    data[i * 2 + 1] = -(float) i;
+    sum += (double) (i % 7);
+  }
+  double const mean = sum / (double) count;
+  double var = 0.0;
+  for (size_t i = 0; i < count; ++i) {
+    double const d = (double) (i % 7) - mean;
+    var += d * d;
+  }
+  var /= (double) count;
+
+  Image_Statistics stats;
+  REQUIRE(Image_CalculateStatisticsOf(image, &stats, nullptr));
+  REQUIRE(stats.pixelCount == count);
+  REQUIRE(stats.min.r == Approx(10000.0));
+  REQUIRE(stats.max.r == Approx(10006.0));
+  REQUIRE(stats.mean.r == Approx(10000.0 + mean));
+  REQUIRE(stats.variance.r == Approx(var));
+  REQUIRE(stats.min.g == Approx(-(double) (count - 1)));
+  REQUIRE(stats.max.g == Approx(0.0));
+  REQUIRE(stats.mean.g == Approx(-(double) (count - 1) * 0.5));
+  REQUIRE(stats.min.b == 0.0);
+  REQUIRE(stats.variance.a == 0.0);
+
+  Image_Destroy(image);
+}
+
+TEST_CASE("Image statistics histogram (C)", "[Image Stats]") {
+  Image_ImageHeader *image = Image_Create2D(256, 16, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image);
+  uint8_t *data = (uint8_t *) Image_RawDataPtr(image);
+  for (size_t i = 0; i < Image_PixelCountOf(image); ++i) {
+    data[i * 4 + 0] = (uint8_t) (i & 0xFF);
+    data[i * 4 + 1] = 0;
+    data[i * 4 + 2] = 255;
+    data[i * 4 + 3] = 128;
+  }
+
+  uint64_t red[4];
+  uint64_t blue[4];
+  Image_Histogram histogram = {4, 0.0, 1.0, {red, nullptr, blue, nullptr}};
+  Image_Statistics stats;
+  REQUIRE(Image_CalculateStatisticsOf(image, &stats, &histogram));
+  for (uint64_t r : red) {
+    REQUIRE(r == 64 * 16);
+  }
+  REQUIRE(blue[0] == 0);
+  REQUIRE(blue[3] == 256 * 16);
+  REQUIRE(stats.mean.r == Approx(0.5));
+  REQUIRE(stats.max.a == Approx(128.0 / 255.0));
+
+  // no range given, use the images own
+  Image_Histogram autoRange = {2, 0.0, 0.0, {red, nullptr, nullptr, nullptr}};
+  REQUIRE(Image_CalculateStatisticsOf(image, &stats, &autoRange));
+  REQUIRE(autoRange.rangeMin == 0.0);
+  REQUIRE(autoRange.rangeMax == Approx(1.0));
+  REQUIRE(red[0] == 128 * 16);
+  REQUIRE(red[1] == 128 * 16);
+
+  Image_Destroy(image);
+}
+
+TEST_CASE("Image statistics generic format (C)", "[Image Stats]") {
+  Image_ImageHeader *image = Image_Create2D(17, 5, Image_Format_B8G8R8A8_UNORM);
+  REQUIRE(image);
+  for (size_t i = 0; i < Image_PixelCountOf(image); ++i) {
+    Image_PixelD pixel = {(double) (i % 2), 0.5, 0.25, 1.0};
+    Image_SetPixelAt(image, &pixel, i);
+  }
+  Image_PixelD pmin, pmax;
+  REQUIRE(Image_GetColorRangeOf(image, &pmin, &pmax));
+  REQUIRE(pmin.r == 0.0);
+  REQUIRE(pmax.r == 1.0);
+  REQUIRE(pmin.g == Approx(0.5).margin(0.005));
+  REQUIRE(pmax.b == Approx(0.25).margin(0.005));
+
+  double dmin, dmax;
+  REQUIRE(Image_GetColorRangeOfD(image, &dmin, &dmax));
+  REQUIRE(dmin == 0.0);
+  REQUIRE(dmax == 1.0);
+  Image_Destroy(image);
+}
+
+TEST_CASE("Image normalize (C)", "[Image Stats]") {
+  Image_ImageHeader *image = Image_Create2D(64, 64, Image_Format_R32G32_SFLOAT);
+  REQUIRE(image);
+  float *data = (float *) Image_RawDataPtr(image);
+  for (size_t i = 0; i < Image_PixelCountOf(image); ++i) {
+    data[i * 2 + 0] = -100.0f + (float) i;
+    data[i * 2 + 1] = 3.0f;
+  }
+  REQUIRE(Image_NormalizeEachChannelOf(image));
+  float fmin, fmax;
+  Image_PixelD pmin, pmax;
+  REQUIRE(Image_GetColorRangeOf(image, &pmin, &pmax));
+  REQUIRE(pmin.r == Approx(0.0).margin(1e-6));
+  REQUIRE(pmax.r == Approx(1.0));
+  // flat channels end up at 0
+  REQUIRE(pmax.g == 0.0);
+
+  for (size_t i = 0; i < Image_PixelCountOf(image); ++i) {
+    data[i * 2 + 0] = 2.0f;
+    data[i * 2 + 1] = 6.0f + (float) (i & 1);
+  }
+  REQUIRE(Image_NormalizeAcrossChannelsOf(image));
+  REQUIRE(Image_GetColorRangeOfF(image, &fmin, &fmax));
+  REQUIRE(fmin == Approx(0.0f).margin(1e-6));
+  REQUIRE(fmax == Approx(1.0f));
+  REQUIRE(data[1] == Approx(0.8f));
+  Image_Destroy(image);
+
+  Image_ImageHeader *image8 = Image_Create2D(16, 16, Image_Format_R8_UNORM);
+  uint8_t *data8 = (uint8_t *) Image_RawDataPtr(image8);
+  for (size_t i = 0; i < Image_PixelCountOf(image8); ++i) {
+    data8[i] = (uint8_t) (64 + (i & 63));
+  }
+  REQUIRE(Image_NormalizeEachChannelOf(image8));
+  REQUIRE(data8[0] == 0);
+  REQUIRE(data8[63] == 255);
+  Image_Destroy(image8);
+}
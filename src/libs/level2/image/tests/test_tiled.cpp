@@ -0,0 +1,180 @@
+#include "core/core.h"
+#include "catch/catch.hpp"
+#include "image/image.h"
+#include "image/format_cracker.h"
+#include "image/create.h"
+#include "image/view.h"
+#include "image/utils.h"
+#include "image/block.h"
+#include <vector>
+
+namespace {
+void FillXYS(Image_ImageHeader *image) {
+  for (uint32_t s = 0; s < image->slices; ++s) {
+    for (uint32_t y = 0; y < image->height; ++y) {
+      for (uint32_t x = 0; x < image->width; ++x) {
+        Image_PixelD pixel = {x / 255.0, y / 255.0, s / 255.0, 1.0};
+        Image_SetPixelAt(image, &pixel, Image_CalculateIndex(image, x, y, 0, s));
+      }
+    }
+  }
+}
+}
+
+TEST_CASE("Image tiled index (C)", "[Image Tiled]") {
+  Image_ImageHeader header;
+  Image_FillHeader(130, 70, 1, 2, Image_Format_R8G8B8A8_UNORM, &header);
+  header.flags |= Image_Flag_Tiled;
+  REQUIRE(Image_TileCountXOf(&header) == 3);
+  REQUIRE(Image_TileCountYOf(&header) == 2);
+
+  // every pixel lands somewhere different and inside the image
+  std::vector<bool> used(Image_PixelCountOf(&header), false);
+  for (uint32_t s = 0; s < header.slices; ++s) {
+    for (uint32_t y = 0; y < header.height; ++y) {
+      for (uint32_t x = 0; x < header.width; ++x) {
+        size_t const index = Image_CalculateIndex(&header, x, y, 0, s);
+        REQUIRE(index < used.size());
+        REQUIRE(!used[index]);
+        used[index] = true;
+      }
+    }
+  }
+  // tile rows are contiguous
+  REQUIRE(Image_CalculateIndex(&header, 65, 3, 0, 0) == Image_CalculateIndex(&header, 64, 3, 0, 0) + 1);
+  REQUIRE(Image_CalculateIndex(&header, 64, 0, 0, 0) == 64 * 64);
+  REQUIRE(Image_CalculateIndex(&header, 0, 64, 0, 0) == 130 * 64);
+  REQUIRE(Image_CalculateIndex(&header, 129, 69, 0, 0) == 130 * 70 - 1);
+}
+
+TEST_CASE("Image tiled convert (C)", "[Image Tiled]") {
+  Image_ImageHeader *image = Image_Create2DArray(130, 70, 2, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image);
+  FillXYS(image);
+  Image_ImageHeader *linear = Image_Clone(image);
+
+  REQUIRE(Image_ConvertToTiled(image));
+  REQUIRE(Image_IsTiled(image));
+  // already tiled is fine
+  REQUIRE(Image_ConvertToTiled(image));
+
+  Image_PixelD pixel;
+  Image_GetPixelAt(image, &pixel, Image_CalculateIndex(image, 100, 67, 0, 1));
+  REQUIRE(pixel.r == Approx(100.0 / 255.0));
+  REQUIRE(pixel.g == Approx(67.0 / 255.0));
+  REQUIRE(pixel.b == Approx(1.0 / 255.0));
+
+  // clone keeps the layout, copies convert between layouts
+  Image_ImageHeader *clone = Image_Clone(image);
+  REQUIRE(Image_IsTiled(clone));
+  REQUIRE(memcmp(Image_RawDataPtr(clone), Image_RawDataPtr(image), Image_ByteCountOf(image)) == 0);
+  Image_ImageHeader *copy = Image_Create2DArray(130, 70, 2, Image_Format_R8G8B8A8_UNORM);
+  Image_CopyImage(copy, image);
+  REQUIRE(memcmp(Image_RawDataPtr(copy), Image_RawDataPtr(linear), Image_ByteCountOf(linear)) == 0);
+
+  // order doesn't matter for statistics
+  Image_Statistics tiledStats, linearStats;
+  REQUIRE(Image_CalculateStatisticsOf(image, &tiledStats, nullptr));
+  REQUIRE(Image_CalculateStatisticsOf(linear, &linearStats, nullptr));
+  REQUIRE(tiledStats.pixelCount == linearStats.pixelCount);
+  REQUIRE(tiledStats.mean.r == Approx(linearStats.mean.r));
+  REQUIRE(tiledStats.max.g == linearStats.max.g);
+
+  REQUIRE(Image_ConvertToLinear(image));
+  REQUIRE(!Image_IsTiled(image));
+  REQUIRE(memcmp(Image_RawDataPtr(image), Image_RawDataPtr(linear), Image_ByteCountOf(linear)) == 0);
+
+  Image_Destroy(copy);
+  Image_Destroy(clone);
+  Image_Destroy(linear);
+  Image_Destroy(image);
+
+  Image_ImageHeader *compressed = Image_Create2D(64, 64, Image_Format_BC1_RGBA_UNORM_BLOCK);
+  REQUIRE(!Image_ConvertToTiled(compressed));
+  Image_Destroy(compressed);
+}
+
+TEST_CASE("Image tiled views (C)", "[Image Tiled]") {
+  Image_ImageHeader *image = Image_Create2D(130, 70, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image);
+  FillXYS(image);
+  REQUIRE(Image_ConvertToTiled(image));
+
+  Image_View view;
+  REQUIRE(!Image_ViewOf(image, &view));
+  REQUIRE(!Image_ViewOfTile(image, 3, 0, 0, 0, &view));
+
+  REQUIRE(Image_ViewOfTile(image, 2, 1, 0, 0, &view));
+  REQUIRE(view.width == 2);
+  REQUIRE(view.height == 6);
+  REQUIRE(Image_ViewIsContiguous(&view));
+  Image_PixelD pixel;
+  Image_ViewGetPixelAt(&view, &pixel, 1, 5, 0);
+  REQUIRE(pixel.r == Approx(129.0 / 255.0));
+  REQUIRE(pixel.g == Approx(69.0 / 255.0));
+
+  REQUIRE(Image_ViewOfTile(image, 1, 0, 0, 0, &view));
+  REQUIRE(view.width == 64);
+  REQUIRE(view.height == 64);
+  Image_ViewGetPixelAt(&view, &pixel, 3, 10, 0);
+  REQUIRE(pixel.r == Approx(67.0 / 255.0));
+  REQUIRE(pixel.g == Approx(10.0 / 255.0));
+
+  Image_Destroy(image);
+}
+
+TEST_CASE("Image tiled mipmaps (C)", "[Image Tiled]") {
+  // several tiles across in the first few levels and more than one slice
+  Image_ImageHeader *linear = Image_Create2DArray(512, 256, 2, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(linear);
+  FillXYS(linear);
+  Image_ImageHeader *tiled = Image_Clone(linear);
+  REQUIRE(Image_ConvertToTiled(tiled));
+
+  Image_ImageHeader *packed = Image_CreatePackedMipMapChain(tiled, true, 0);
+  REQUIRE(packed);
+  Image_CreateMipMapChain(linear, true);
+  Image_CreateMipMapChain(tiled, true);
+  REQUIRE(Image_LinkedImageCountOf(tiled) == Image_LinkedImageCountOf(linear));
+
+  // made a tile at a time the mips still match the linear ones exactly
+  for (size_t level = 1; level < Image_LinkedImageCountOf(linear); ++level) {
+    Image_ImageHeader const *expected = Image_LinkedImageOf(linear, level);
+    Image_ImageHeader *mip = (Image_ImageHeader *) Image_LinkedImageOf(tiled, level);
+    REQUIRE(Image_IsTiled(mip));
+    REQUIRE(Image_ConvertToLinear(mip));
+    REQUIRE(memcmp(Image_RawDataPtr(mip), Image_RawDataPtr(expected), Image_ByteCountOf(expected)) == 0);
+    Image_ImageHeader *packedMip = (Image_ImageHeader *) Image_LinkedImageOf(packed, level);
+    REQUIRE(Image_IsTiled(packedMip));
+    REQUIRE(Image_ConvertToLinear(packedMip));
+    REQUIRE(memcmp(Image_RawDataPtr(packedMip), Image_RawDataPtr(expected), Image_ByteCountOf(expected)) == 0);
+  }
+
+  Image_Destroy(packed);
+  Image_Destroy(tiled);
+  Image_Destroy(linear);
+}
+
+TEST_CASE("Image tiled block encode (C)", "[Image Tiled]") {
+  // partial tiles and partial blocks on the right and bottom
+  Image_ImageHeader *linear = Image_Create2D(150, 70, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(linear);
+  FillXYS(linear);
+  Image_ImageHeader *tiled = Image_Clone(linear);
+  REQUIRE(Image_ConvertToTiled(tiled));
+
+  Image_Format const formats[] = {Image_Format_BC3_UNORM_BLOCK, Image_Format_BC7_UNORM_BLOCK};
+  for (Image_Format format : formats) {
+    size_t const size = ((150 + 3) / 4) * ((70 + 3) / 4) * (Image_Format_BitWidth(format) * 16 / 8);
+    std::vector<uint8_t> fromLinear(size);
+    std::vector<uint8_t> fromTiled(size);
+    Image_BlockEncodeCompressedData(fromLinear.data(), (uint8_t const *) Image_RawDataPtr(linear),
+                                    150, 70, format, Image_BEQ_Fast);
+    Image_BlockEncodeTiledCompressedData(fromTiled.data(), (uint8_t const *) Image_RawDataPtr(tiled),
+                                         150, 70, format, Image_BEQ_Fast);
+    REQUIRE(fromTiled == fromLinear);
+  }
+
+  Image_Destroy(tiled);
+  Image_Destroy(linear);
+}
@@ -0,0 +1,170 @@
+#include "core/core.h"
+#include "catch/catch.hpp"
+#include "image/image.h"
+#include "image/format_cracker.h"
+#include "image/create.h"
+#include "image/view.h"
+#include "image/utils.h"
+#include "image/io.h"
+
+namespace {
+void FillXY(Image_ImageHeader *image) {
+  uint8_t *data = (uint8_t *) Image_RawDataPtr(image);
+  for (uint32_t s = 0; s < image->slices; ++s) {
+    for (uint32_t y = 0; y < image->height; ++y) {
+      for (uint32_t x = 0; x < image->width; ++x) {
+        uint8_t *p = data + Image_CalculateIndex(image, x, y, 0, s) * 4;
+        p[0] = (uint8_t) x;
+        p[1] = (uint8_t) y;
+        p[2] = (uint8_t) s;
+        p[3] = 255;
+      }
+    }
+  }
+}
+}
+
+TEST_CASE("Image view of region (C)", "[Image View]") {
+  Image_ImageHeader *image = Image_Create2DArray(32, 16, 3, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image);
+  FillXY(image);
+
+  Image_View view;
+  REQUIRE(Image_ViewOfRegion(image, 4, 5, 0, 2, 8, 6, 1, &view));
+  REQUIRE(view.width == 8);
+  REQUIRE(view.height == 6);
+  REQUIRE(view.rowStride == 32 * 4);
+  REQUIRE(!Image_ViewIsContiguous(&view));
+  uint8_t const *p = Image_ViewPixelPtr(&view, 1, 2, 0);
+  REQUIRE(p[0] == 5);
+  REQUIRE(p[1] == 7);
+  REQUIRE(p[2] == 2);
+
+  Image_View sub;
+  REQUIRE(Image_SubView(&view, 2, 1, 0, 3, 3, 1, &sub));
+  Image_PixelD pixel;
+  Image_ViewGetPixelAt(&sub, &pixel, 0, 0, 0);
+  REQUIRE(pixel.r == Approx(6.0 / 255.0));
+  REQUIRE(pixel.g == Approx(6.0 / 255.0));
+
+  // out of bounds
+  REQUIRE(!Image_ViewOfRegion(image, 30, 0, 0, 0, 8, 1, 1, &view));
+  REQUIRE(!Image_ViewOfSlice(image, 3, &view));
+
+  REQUIRE(Image_ViewOf(image, &view));
+  REQUIRE(view.depth == 3);
+  REQUIRE(Image_ViewIsContiguous(&view));
+
+  Image_Destroy(image);
+}
+
+TEST_CASE("Image view of mip level (C)", "[Image View]") {
+  Image_ImageHeader *image = Image_Create2D(8, 8, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image);
+  Image_CreateMipMapChain(image, false);
+
+  Image_View view;
+  REQUIRE(Image_ViewOfMipLevel(image, 0, 0, &view));
+  REQUIRE(view.width == 8);
+  REQUIRE(Image_ViewOfMipLevel(image, 2, 0, &view));
+  REQUIRE(view.width == 2);
+  REQUIRE(view.data == (uint8_t *) Image_RawDataPtr(image->nextImage->nextImage));
+  REQUIRE(!Image_ViewOfMipLevel(image, 4, 0, &view));
+  Image_Destroy(image);
+}
+
+TEST_CASE("Image view copy into atlas (C)", "[Image View]") {
+  Image_ImageHeader *tile = Image_Create2D(4, 4, Image_Format_R32G32B32A32_SFLOAT);
+  Image_ImageHeader *atlas = Image_Create2D(16, 16, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(tile);
+  REQUIRE(atlas);
+  float *data = (float *) Image_RawDataPtr(tile);
+  for (size_t i = 0; i < Image_PixelCountOf(tile); ++i) {
+    data[i * 4 + 0] = 1.0f;
+    data[i * 4 + 1] = 0.5f;
+    data[i * 4 + 2] = 0.0f;
+    data[i * 4 + 3] = 1.0f;
+  }
+
+  Image_View src, dst;
+  REQUIRE(Image_ViewOf(tile, &src));
+  REQUIRE(Image_ViewOfRegion(atlas, 8, 4, 0, 0, 4, 4, 1, &dst));
+  REQUIRE(Image_ViewCopy(&dst, &src));
+
+  uint8_t const *pixels = (uint8_t const *) Image_RawDataPtr(atlas);
+  REQUIRE(pixels[(4 * 16 + 8) * 4 + 0] == 255);
+  REQUIRE(pixels[(7 * 16 + 11) * 4 + 1] == 127);
+  // outside the region is untouched
+  REQUIRE(pixels[(4 * 16 + 7) * 4 + 0] == 0);
+  REQUIRE(pixels[(8 * 16 + 8) * 4 + 0] == 0);
+
+  // statistics of just the region
+  Image_Statistics stats;
+  REQUIRE(Image_CalculateStatisticsOfView(&dst, &stats, nullptr));
+  REQUIRE(stats.pixelCount == 16);
+  REQUIRE(stats.min.r == 1.0);
+  REQUIRE(stats.variance.r == 0.0);
+
+  Image_View wrongSize;
+  REQUIRE(Image_ViewOfRegion(atlas, 0, 0, 0, 0, 3, 3, 1, &wrongSize));
+  REQUIRE(!Image_ViewCopy(&wrongSize, &src));
+
+  Image_Destroy(atlas);
+  Image_Destroy(tile);
+}
+
+TEST_CASE("Image view resample (C)", "[Image View]") {
+  Image_ImageHeader *image = Image_Create2D(32, 32, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image);
+  uint8_t *data = (uint8_t *) Image_RawDataPtr(image);
+  for (size_t i = 0; i < Image_PixelCountOf(image); ++i) {
+    data[i * 4 + 0] = 200;
+    data[i * 4 + 1] = 100;
+    data[i * 4 + 2] = 50;
+    data[i * 4 + 3] = 255;
+  }
+
+  // shrink the top left quarter into the bottom right of a float image
+  Image_ImageHeader *dstImage = Image_Create2D(16, 16, Image_Format_R32G32B32A32_SFLOAT);
+  Image_View src, dst;
+  REQUIRE(Image_ViewOfRegion(image, 0, 0, 0, 0, 16, 16, 1, &src));
+  REQUIRE(Image_ViewOfRegion(dstImage, 8, 8, 0, 0, 8, 8, 1, &dst));
+  REQUIRE(Image_ViewResample(&dst, &src));
+
+  Image_PixelD pixel;
+  Image_ViewGetPixelAt(&dst, &pixel, 3, 5, 0);
+  REQUIRE(pixel.r == Approx(200.0 / 255.0).margin(0.01));
+  REQUIRE(pixel.b == Approx(50.0 / 255.0).margin(0.01));
+  Image_GetPixelAt(dstImage, &pixel, 0);
+  REQUIRE(pixel.r == 0.0);
+
+  Image_Destroy(dstImage);
+  Image_Destroy(image);
+}
+
+TEST_CASE("Image view save PNG (C)", "[Image View]") {
+  Image_ImageHeader *image = Image_Create2D(32, 16, Image_Format_R8G8B8A8_UNORM);
+  REQUIRE(image);
+  FillXY(image);
+
+  Image_View view;
+  REQUIRE(Image_ViewOfRegion(image, 10, 3, 0, 0, 7, 5, 1, &view));
+
+  VFile_Handle file = VFile_ToBuffer(1024);
+  REQUIRE(file);
+  REQUIRE(Image_SaveViewPNG(&view, file));
+  VFile_Seek(file, 0, VFile_SD_Begin);
+  Image_ImageHeader *loaded = Image_LoadLDR(file);
+  VFile_Close(file);
+  REQUIRE(loaded);
+  REQUIRE(loaded->width == 7);
+  REQUIRE(loaded->height == 5);
+  uint8_t const *p = (uint8_t const *) Image_RawDataPtr(loaded);
+  REQUIRE(p[0] == 10);
+  REQUIRE(p[1] == 3);
+  REQUIRE(p[(4 * 7 + 6) * 4 + 0] == 16);
+  REQUIRE(p[(4 * 7 + 6) * 4 + 1] == 7);
+
+  Image_Destroy(loaded);
+  Image_Destroy(image);
+}
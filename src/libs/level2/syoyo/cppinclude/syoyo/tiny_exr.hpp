@@ -46,6 +46,11 @@ inline int LoadEXRImage(EXRImage *image, const EXRHeader *header,VFile_Handle ha
   return TinyExr_LoadEXRImage(image, header, handle);
 }
 
+inline int LoadEXRImageRegion(const EXRHeader *header, VFile_Handle handle,
+                              const int region[4], int level_x, int level_y) {
+  return TinyExr_LoadEXRImageRegion(header, handle, region, level_x, level_y);
+}
+
 inline int LoadEXRMultipartImage(EXRImage *images,
                                   const EXRHeader **headers,
                                   unsigned int num_parts,
@@ -4,6 +4,9 @@
 #ifndef WYRD_SYOYO_TINY_XPD_HPP
 #define WYRD_SYOYO_TINY_XPD_HPP
 
+#include "core/core.h"
+#include "os/thread.h"
+#include "vfile/vfile.h"
 #include "tinystl/unordered_map.h"
 #include "tinystl/string.h"
 #include "tinystl/vector.h"
@@ -140,6 +143,98 @@ bool ParseXPDHeaderFromMemory(const uint8_t *binary, const size_t binary_length,
 ///
 bool SerializeToXPD(XPDHeaderInput &input, tinystl::vector<uint8_t> &prim_data, tinystl::vector<uint8_t> *xpd_binary, tinystl::string *err);
 
+///
+/// Swap the byte order of `count` 32 or 64 bit values in place, several at a
+/// time with SIMD where available.
+///
+void SwapEndian32(void *data, size_t count);
+void SwapEndian64(void *data, size_t count);
+
+///
+/// Typed view of data owned by someone else.
+///
+template <typename T>
+struct XPDSpan {
+  const T *data;
+  size_t size;
+
+  XPDSpan() : data(nullptr), size(0) {}
+  XPDSpan(const T *d, size_t s) : data(d), size(s) {}
+
+  const T &operator[](size_t i) const { return data[i]; }
+  const T *begin() const { return data; }
+  const T *end() const { return data + size; }
+  bool empty() const { return size == 0; }
+};
+
+///
+/// Streaming XPD reader for large groom files.
+///
+/// Only the header is parsed when opening, prim data is touched one block
+/// of one face at a time. Mapped files and memory VFiles are used in place,
+/// any other VFile has just the requested block read from it. Endian
+/// swapping (when `swap_endian` is set) is done in bulk as blocks are asked
+/// for, the header is swapped when it is parsed.
+///
+class XPDReader {
+ public:
+  typedef void (*FaceFunction)(void *user, uint32_t face);
+
+  XPDReader();
+  ~XPDReader();
+
+  ///
+  /// Map `filename` read only and parse its header.
+  ///
+  bool OpenMapped(const char *filename, bool swap_endian, tinystl::string *err);
+
+  ///
+  /// Parse the header of a VFile positioned at the start of the XPD data.
+  /// The reader doesn't own `handle`, it must stay open until `Close`.
+  ///
+  bool Open(VFile_Handle handle, bool swap_endian, tinystl::string *err);
+
+  void Close();
+
+  const XPDHeader &header() const { return header_; }
+  uint32_t numFaces() const { return header_.numFaces; }
+  uint32_t numBlocks() const { return uint32_t(header_.block.size()); }
+  uint32_t numPrims(uint32_t face) const { return header_.numPrims[face]; }
+
+  ///
+  /// Index of the block called `name`, -1 if there isn't one.
+  ///
+  int blockIndex(const char *name) const;
+
+  ///
+  /// Prim data of one block of a face, `numPrims(face) * primSize[block]`
+  /// floats. Points straight into the file data when it is in memory, float
+  /// aligned and doesn't need swapping, otherwise the block is read and/or
+  /// swapped into `scratch` which the span then points at. Returns an empty
+  /// span for faces without prims and on error. Safe to call from several
+  /// threads, each with its own `scratch`.
+  ///
+  XPDSpan<float> Block(uint32_t face, uint32_t block,
+                       tinystl::vector<float> *scratch) const;
+
+  ///
+  /// Calls `fn` for every face across the global thread pool.
+  ///
+  void ForEachFaceParallel(FaceFunction fn, void *user) const;
+
+ private:
+  XPDReader(const XPDReader &);
+  XPDReader &operator=(const XPDReader &);
+
+  XPDHeader header_;
+  const uint8_t *memory_;  // whole file when mapped or in memory
+  size_t size_;
+  bool mapped_;
+  bool swap_endian_;
+  VFile_Handle handle_;    // ranged reads when not in memory
+  mutable Os_Mutex_t mutex_;
+};
+
 }  // namespace tiny_xpd
 
 #if defined(TINY_XPD_IMPLEMENTATION)
@@ -149,6 +244,21 @@ bool SerializeToXPD(XPDHeaderInput &input, tinystl::vector<uint8_t> &prim_data,
 #include <fstream>
 #include <sstream>
 #include <iostream>  // dbg
+#include "os/file.h"
+#include "os/threadpool.h"
+#include "vfile/memory.h"
+
+// XPDReader::Open rejects headers claiming to be larger than this
+#ifndef TINY_XPD_MAX_HEADER_SIZE
+#define TINY_XPD_MAX_HEADER_SIZE (256 * 1024 * 1024)
+#endif
+
+#if CPU_FAMILY == CPU_X64
+#include <emmintrin.h>
+#define TINY_XPD_SSE 1
+#else
+#define TINY_XPD_SSE 0
+#endif
 
 namespace tiny_xpd {
 
@@ -615,8 +725,8 @@ static bool ParseXPDHeader(StreamReader *sr, XPDHeader *xpd, tinystl::string *er
 
     tinystl::vector<char> blockNames(blockSize);
 
-    if (!sr->read(blockSize, blockSize,
-                  reinterpret_cast<uint8_t *>(blockNames.data()))) {
+    if (sr->read(blockSize, blockSize,
+                  reinterpret_cast<uint8_t *>(blockNames.data())) != blockSize) {
       if (err) {
         (*err) += "Failed to read `blockNames'.";
       }
@@ -684,8 +794,8 @@ static bool ParseXPDHeader(StreamReader *sr, XPDHeader *xpd, tinystl::string *er
     if (keySize > 0) {
       tinystl::vector<char> keyNames(keySize);
 
-      if (!sr->read(keySize, keySize,
-                    reinterpret_cast<uint8_t *>(keyNames.data()))) {
+      if (sr->read(keySize, keySize,
+                    reinterpret_cast<uint8_t *>(keyNames.data())) != keySize) {
         if (err) {
           (*err) += "Failed to read `keyNames'.";
         }
@@ -721,12 +831,31 @@ static bool ParseXPDHeader(StreamReader *sr, XPDHeader *xpd, tinystl::string *er
     return false;
   }
 
+  if (xpd->numBlocks != xpd->block.size()) {
+    if (err) {
+      (*err) += "`numBlocks` doesn't match the block names.";
+    }
+    return false;
+  }
+
+  // faceid, numPrims and blockPosition must fit in what is left
+  const uint64_t tableSize =
+      uint64_t(xpd->numFaces) * (sizeof(int32_t) + sizeof(uint32_t) +
+                                 sizeof(uint64_t) * xpd->numBlocks);
+  if (tableSize > sr->size() - sr->tell()) {
+    if (err) {
+      (*err) += "Face tables are larger than the data.";
+    }
+    return false;
+  }
+
   // faceid. length = numFaces.
   xpd->faceid.resize(xpd->numFaces);
 
-  if (!sr->read(sizeof(int32_t) * xpd->numFaces,
-                sizeof(int32_t) * xpd->numFaces,
-                reinterpret_cast<uint8_t *>(xpd->faceid.data()))) {
+  if (sr->read(sizeof(int32_t) * xpd->numFaces,
+               sizeof(int32_t) * xpd->numFaces,
+               reinterpret_cast<uint8_t *>(xpd->faceid.data())) !=
+      sizeof(int32_t) * xpd->numFaces) {
     if (err) {
       (*err) += "Failed to parse `faceid`.";
     }
@@ -735,9 +864,10 @@ static bool ParseXPDHeader(StreamReader *sr, XPDHeader *xpd, tinystl::string *er
 
   // numPrims. length = numFaces.
   xpd->numPrims.resize(xpd->numFaces);
-  if (!sr->read(sizeof(uint32_t) * xpd->numFaces,
-                sizeof(uint32_t) * xpd->numFaces,
-                reinterpret_cast<uint8_t *>(xpd->numPrims.data()))) {
+  if (sr->read(sizeof(uint32_t) * xpd->numFaces,
+               sizeof(uint32_t) * xpd->numFaces,
+               reinterpret_cast<uint8_t *>(xpd->numPrims.data())) !=
+      sizeof(uint32_t) * xpd->numFaces) {
     if (err) {
       (*err) += "Failed to parse `numPrims`.";
     }
@@ -745,19 +875,56 @@ static bool ParseXPDHeader(StreamReader *sr, XPDHeader *xpd, tinystl::string *er
   }
 
   // blockPosition. length = numFaces * numBlocks.
-  xpd->blockPosition.resize(xpd->numFaces * xpd->numBlocks);
-  if (!sr->read(sizeof(uint64_t) * xpd->blockPosition.size(),
-                sizeof(uint64_t) * xpd->blockPosition.size(),
-                reinterpret_cast<uint8_t *>(xpd->blockPosition.data()))) {
+  xpd->blockPosition.resize(size_t(xpd->numFaces) * xpd->numBlocks);
+  if (sr->read(sizeof(uint64_t) * xpd->blockPosition.size(),
+               sizeof(uint64_t) * xpd->blockPosition.size(),
+               reinterpret_cast<uint8_t *>(xpd->blockPosition.data())) !=
+      sizeof(uint64_t) * xpd->blockPosition.size()) {
     if (err) {
       (*err) += "Failed to parse `blockPosition`.";
     }
     return false;
   }
 
+  if (sr->swap_endian()) {
+    SwapEndian32(xpd->faceid.data(), xpd->faceid.size());
+    SwapEndian32(xpd->numPrims.data(), xpd->numPrims.size());
+    SwapEndian64(xpd->blockPosition.data(), xpd->blockPosition.size());
+  }
+
   return true;
 }
 
+///
+/// Bytes the header at the start of `sr` takes, as far as can be told from
+/// the data there. Until numFaces has been read this is just the bytes
+/// needed to get further, so call again with at least that many.
+///
+static uint64_t XPDHeaderBytes(StreamReader *sr) {
+  // magic, fileVersion, primType, primVersion, time, numCVs, coordSpace
+  uint64_t needed = 4 + 1 + 4 + 1 + 4 + 4 + 4;
+  uint32_t numBlocks = 0;
+  uint32_t blockSize = 0;
+  uint32_t keySize = 0;
+  uint32_t numFaces = 0;
+
+  needed += 8;
+  if (!sr->seek_set(needed - 8) || !sr->read4(&numBlocks) || !sr->read4(&blockSize)) {
+    return needed;
+  }
+  // names, primSize, numKeys and keySize
+  needed += uint64_t(blockSize) + sizeof(uint32_t) * uint64_t(numBlocks) + 8;
+  if (!sr->seek_set(needed - 4) || !sr->read4(&keySize)) {
+    return needed;
+  }
+  needed += uint64_t(keySize) + 4;
+  if (!sr->seek_set(needed - 4) || !sr->read4(&numFaces)) {
+    return needed;
+  }
+  return needed + uint64_t(numFaces) * (sizeof(int32_t) + sizeof(uint32_t) +
+                                        sizeof(uint64_t) * numBlocks);
+}
+
 #if 0
 bool ParseXPDFromFile(const tinystl::string &filename, XPDHeader *xpd_header,
                       tinystl::vector<uint8_t> *binary, tinystl::string *err) {
@@ -862,6 +1029,252 @@ bool ParseXPDHeaderFromMemory(const uint8_t *binary, const size_t binary_length,
   return true;
 }
 
+void SwapEndian32(void *data, size_t count) {
+  uint8_t *p = reinterpret_cast<uint8_t *>(data);
+  size_t i = 0;
+#if TINY_XPD_SSE
+  // swap the 16 bit halves then the bytes within them
+  for (; i + 4 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i * 4));
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p + i * 4), v);
+  }
+#endif
+  for (; i < count; i++) {
+    uint8_t *v = p + i * 4;
+    uint8_t t0 = v[0], t1 = v[1];
+    v[0] = v[3];
+    v[1] = v[2];
+    v[2] = t1;
+    v[3] = t0;
+  }
+}
+
+void SwapEndian64(void *data, size_t count) {
+  uint8_t *p = reinterpret_cast<uint8_t *>(data);
+  size_t i = 0;
+#if TINY_XPD_SSE
+  // reverse the 16 bit quarters then the bytes within them
+  for (; i + 2 <= count; i += 2) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i * 8));
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p + i * 8), v);
+  }
+#endif
+  for (; i < count; i++) {
+    uint8_t *v = p + i * 8;
+    for (int b = 0; b < 4; b++) {
+      uint8_t t = v[b];
+      v[b] = v[7 - b];
+      v[7 - b] = t;
+    }
+  }
+}
+
+XPDReader::XPDReader()
+    : memory_(nullptr),
+      size_(0),
+      mapped_(false),
+      swap_endian_(false),
+      handle_(nullptr) {
+  Os_MutexCreate(&mutex_);
+}
+
+XPDReader::~XPDReader() {
+  Close();
+  Os_MutexDestroy(&mutex_);
+}
+
+void XPDReader::Close() {
+  if (mapped_) {
+    Os_FileUnmap(memory_, size_);
+  }
+  memory_ = nullptr;
+  size_ = 0;
+  mapped_ = false;
+  handle_ = nullptr;
+  header_ = XPDHeader();
+}
+
+bool XPDReader::OpenMapped(const char *filename, bool swap_endian,
+                           tinystl::string *err) {
+  Close();
+  size_t size = 0;
+  const void *memory = Os_FileMapReadOnly(filename, &size);
+  if (!memory) {
+    if (err) {
+      (*err) = "Failed to map a file.\n";
+    }
+    return false;
+  }
+
+  memory_ = reinterpret_cast<const uint8_t *>(memory);
+  size_ = size;
+  mapped_ = true;
+  swap_endian_ = swap_endian;
+
+  StreamReader sr(memory_, size_, swap_endian);
+  if (size_ < 16 || !ParseXPDHeader(&sr, &header_, err)) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+bool XPDReader::Open(VFile_Handle handle, bool swap_endian,
+                     tinystl::string *err) {
+  Close();
+  if (!handle) {
+    if (err) {
+      (*err) = "`handle` argument is null.\n";
+    }
+    return false;
+  }
+
+  swap_endian_ = swap_endian;
+  const int64_t start = VFile_Tell(handle);
+  const size_t size = VFile_Size(handle) - size_t(start);
+  if (size < 16) {
+    if (err) {
+      (*err) = "Data too short. It looks its not a XPD data\n";
+    }
+    return false;
+  }
+
+  if (VFile_GetType(handle) == VFile_Type_Memory) {
+    VFile_MemFile_t *memFile = (VFile_MemFile_t *) VFile_GetTypeSpecificData(handle);
+    memory_ = reinterpret_cast<const uint8_t *>(memFile->memory) + memFile->offset;
+    size_ = size;
+    StreamReader sr(memory_, size_, swap_endian);
+    if (!ParseXPDHeader(&sr, &header_, err)) {
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  // the header size isn't stored, read a prefix then as much more as its
+  // fields say the header needs. That can't be more than the data or
+  // TINY_XPD_MAX_HEADER_SIZE, so a corrupt count fails rather than reading
+  // the whole file
+  tinystl::vector<uint8_t> prefix;
+  size_t prefixSize = size < 64 * 1024 ? size : 64 * 1024;
+  size_t readSize = 0;
+  for (;;) {
+    prefix.resize(prefixSize);
+    if (!VFile_Seek(handle, start + int64_t(readSize), VFile_SD_Begin) ||
+        VFile_Read(handle, prefix.data() + readSize, prefixSize - readSize) != prefixSize - readSize) {
+      if (err) {
+        (*err) = "Failed to read the XPD header.\n";
+      }
+      return false;
+    }
+    readSize = prefixSize;
+
+    StreamReader sizer(prefix.data(), prefixSize, swap_endian);
+    const uint64_t needed = XPDHeaderBytes(&sizer);
+    if (needed <= prefixSize) {
+      break;
+    }
+    if (needed > size || needed > TINY_XPD_MAX_HEADER_SIZE) {
+      if (err) {
+        (*err) = "XPD header is larger than the data.\n";
+      }
+      return false;
+    }
+    prefixSize = size_t(needed);
+  }
+
+  StreamReader sr(prefix.data(), prefixSize, swap_endian);
+  if (!ParseXPDHeader(&sr, &header_, err)) {
+    header_ = XPDHeader();
+    return false;
+  }
+
+  // block positions are absolute from the start of the XPD data
+  for (size_t i = 0; i < header_.blockPosition.size(); i++) {
+    header_.blockPosition[i] += uint64_t(start);
+  }
+  handle_ = handle;
+  size_ = size + size_t(start);
+  return true;
+}
+
+int XPDReader::blockIndex(const char *name) const {
+  for (size_t i = 0; i < header_.block.size(); i++) {
+    if (strcmp(header_.block[i].c_str(), name) == 0) {
+      return int(i);
+    }
+  }
+  return -1;
+}
+
+XPDSpan<float> XPDReader::Block(uint32_t face, uint32_t block,
+                                tinystl::vector<float> *scratch) const {
+  if (face >= header_.numFaces || block >= header_.block.size() || !scratch) {
+    return XPDSpan<float>();
+  }
+
+  const uint64_t count =
+      uint64_t(header_.numPrims[face]) * header_.primSize[block];
+  const uint64_t position =
+      header_.blockPosition[size_t(face) * header_.block.size() + block];
+  if (count == 0 || position > size_ ||
+      count > (size_ - position) / sizeof(float)) {
+    return XPDSpan<float>();
+  }
+
+  if (memory_) {
+    const uint8_t *src = memory_ + position;
+    if (!swap_endian_ && (uintptr_t(src) % alignof(float)) == 0) {
+      return XPDSpan<float>(reinterpret_cast<const float *>(src), size_t(count));
+    }
+    scratch->resize(size_t(count));
+    memcpy(scratch->data(), src, size_t(count) * sizeof(float));
+  } else {
+    scratch->resize(size_t(count));
+    Os_MutexAcquire(&mutex_);
+    VFile_Seek(handle_, int64_t(position), VFile_SD_Begin);
+    const size_t read = VFile_Read(handle_, scratch->data(), size_t(count) * sizeof(float));
+    Os_MutexRelease(&mutex_);
+    if (read != size_t(count) * sizeof(float)) {
+      return XPDSpan<float>();
+    }
+  }
+
+  if (swap_endian_) {
+    SwapEndian32(scratch->data(), size_t(count));
+  }
+  return XPDSpan<float>(scratch->data(), size_t(count));
+}
+
+namespace {
+
+struct FaceJob {
+  XPDReader::FaceFunction fn;
+  void *user;
+};
+
+void FaceJobTask(void *data, uint32_t index) {
+  const FaceJob *job = reinterpret_cast<const FaceJob *>(data);
+  job->fn(job->user, index);
+}
+
+}  // namespace
+
+void XPDReader::ForEachFaceParallel(FaceFunction fn, void *user) const {
+  if (!fn || header_.numFaces == 0) {
+    return;
+  }
+  FaceJob job = {fn, user};
+  Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &FaceJobTask, &job,
+                           header_.numFaces);
+}
+
 #if 0
 bool SerializeToXPD(XPDHeaderInput &input, tinystl::vector<uint8_t> &prim_data, tinystl::vector<uint8_t> *xpd_binary, tinystl::string *err) {
 
@@ -121,11 +121,22 @@ typedef struct _TinyExr_EXRHeader {
   int num_channels;
 
   int compression_type;        // compression type(TINYEXR_COMPRESSIONTYPE_*)
+  int compression_level;       // ZIP/ZIPS level when saving, 1 (fastest) to 9
+  // (smallest), 0 for the zlib default
   int *requested_pixel_types;  // Filled initially by
   // ParseEXRHeaderFrom(Meomory|File), then users
   // can edit it(only valid for HALF pixel type
   // channel)
 
+  // Optional and owned by the caller, scanline images only. When set pixels
+  // are decoded straight into `requested_interleaved` rather than `images`.
+  // `requested_channel_slots[c]` is the element index of channel c within a
+  // pixel (-1 skips the channel) and pixels are `requested_pixel_stride`
+  // elements apart. Rows are data window width * `requested_pixel_stride`
+  unsigned char *requested_interleaved;
+  int *requested_channel_slots;
+  int requested_pixel_stride;
+
 } TinyExr_EXRHeader;
 
 typedef struct _TinyExr_EXRMultiPartHeader {
@@ -211,6 +222,22 @@ EXTERN_C int TinyExr_LoadEXRMultipartImage(TinyExr_EXRImage *images,
                                            unsigned int num_parts,
                                            VFile_Handle handle);
 
+// Decodes just the region (min x, min y, max x, max y inclusive, relative to
+// the data window origin) of one level of a scanline or tiled image, for
+// tiled images in that level's pixels. The handle must be at the start of
+// the EXR, which may be part way into the file. Only the offset table
+// entries and chunks overlapping the region are read, a batch of chunks at
+// a time decoded on the thread pool. The header's requested_interleaved, requested_channel_slots and
+// requested_pixel_stride must be set, requested_interleaved receives the
+// region with rows region width * requested_pixel_stride elements apart.
+// level_x and level_y must be 0 for scanline and single level images and
+// equal for mip maps. Rows are in file order even for decreasing Y images
+EXTERN_C int TinyExr_LoadEXRImageRegion(const TinyExr_EXRHeader *header,
+                                        VFile_Handle handle,
+                                        const int region[4],
+                                        int level_x,
+                                        int level_y);
+
 // Saves multi-channel, single-frame OpenEXR image to a file.
 // Returns negative value and may set error string in `err` when there's an
 // error
@@ -0,0 +1,50 @@
+#pragma once
+#ifndef WYRD_SYOYO_TINY_OBJCACHE_H
+#define WYRD_SYOYO_TINY_OBJCACHE_H
+
+#include "core/core.h"
+#include "syoyo/tiny_objloader.h"
+
+/* A binary cache of a parsed .obj. The attrib arrays, shapes and materials
+ * are written into one relocatable blob (arrays and strings are offsets from
+ * the start) tagged with the size, modification time and content hash of the
+ * source .obj. A new cache is written beside the old one and renamed over
+ * it once complete. A hit maps the blob and the attrib arrays point straight into
+ * the mapping, nothing is parsed or copied. Only the shape and material
+ * tables are fixed up into a small allocation held by the cache handle.
+ * The key only covers the .obj, a changed .mtl needs the cache deleting */
+typedef struct tinyobj_cache_t *tinyobj_cache_handle;
+
+/* Loads obj_filename via cache_filename. The cache is valid if the source
+ * size and modification time match, without reading the .obj. If only the
+ * time differs the .obj is hashed and a matching content hash is still a
+ * hit (the stored time isn't updated, so those loads keep hashing until the
+ * cache is next written). On a miss the .obj is parsed with flags (as tinyobj_parse_obj) and the cache
+ * rewritten.
+ * The outputs belong to *cache_out and are freed by tinyobj_cache_free */
+EXTERN_C int tinyobj_parse_obj_cached(tinyobj_attrib_t *attrib,
+                                      tinyobj_shape_t const **shapes,
+                                      size_t *num_shapes,
+                                      tinyobj_material_t const **materials,
+                                      size_t *num_materials,
+                                      const char *obj_filename,
+                                      const char *cache_filename,
+                                      unsigned int flags,
+                                      tinyobj_cache_handle *cache_out);
+
+/* writes an already parsed .obj to cache_filename, keyed by obj_filename */
+EXTERN_C int tinyobj_cache_save(const char *cache_filename,
+                                const char *obj_filename,
+                                unsigned int flags,
+                                tinyobj_attrib_t const *attrib,
+                                tinyobj_shape_t const *shapes,
+                                size_t num_shapes,
+                                tinyobj_material_t const *materials,
+                                size_t num_materials);
+
+/* true if the data came from the cache rather than a parse */
+EXTERN_C int tinyobj_cache_was_hit(tinyobj_cache_handle cache);
+
+EXTERN_C void tinyobj_cache_free(tinyobj_cache_handle cache);
+
+#endif //WYRD_SYOYO_TINY_OBJCACHE_H
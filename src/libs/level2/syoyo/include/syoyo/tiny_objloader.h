@@ -6,6 +6,8 @@
 
 /* @todo { Remove stddef dependency. size_t? } */
 #include <stddef.h>
+#include "core/core.h"
+#include "vfile/vfile.h"
 
 typedef struct {
   char *name;
@@ -59,6 +61,9 @@ typedef struct {
 
 
 #define TINYOBJ_FLAG_TRIANGULATE (1 << 0)
+/* split large buffers at line boundaries and parse the pieces on the os
+ * thread pool, the results are identical to a serial parse */
+#define TINYOBJ_FLAG_PARALLEL (1 << 1)
 
 #define TINYOBJ_INVALID_INDEX (0x80000000)
 
@@ -66,11 +71,14 @@ typedef struct {
 #define TINYOBJ_ERROR_EMPTY (-1)
 #define TINYOBJ_ERROR_INVALID_PARAMETER (-2)
 #define TINYOBJ_ERROR_FILE_OPERATION (-3)
+#define TINYOBJ_ERROR_OUT_OF_MEMORY (-4)
 
 /* Parse wavefront .obj(.obj string data is expanded to linear char array `buf')
  * flags are combination of TINYOBJ_FLAG_***
  * Returns TINYOBJ_SUCCESS if things goes well.
  * Returns TINYOBJ_ERR_*** when there is an error.
+ * A zero length buffer is TINYOBJ_ERROR_INVALID_PARAMETER, a buffer with
+ * no statements (blank lines and comments) succeeds with no shapes.
  */
 EXTERN_C int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
                              size_t *num_shapes, tinyobj_material_t **materials,
@@ -80,6 +88,24 @@ EXTERN_C int tinyobj_parse_mtl_file(tinyobj_material_t **materials_out,
                                   size_t *num_materials_out,
                                   const char *filename);
 
+/* Parse .obj from a VFile a window of window_size bytes (0 for a 4MB
+ * default) at a time, so the whole file is never in memory. Each window is
+ * parsed while the next is read and lines may straddle windows. The results
+ * are identical to tinyobj_parse_obj of the whole file.
+ * The output sizes aren't known until the end, so the output arrays grow by
+ * doubling and can take up to twice their final size (more while one is
+ * being reallocated) on top of the two windows, they are trimmed to size
+ * before returning.
+ */
+EXTERN_C int tinyobj_parse_obj_vfile(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
+                                     size_t *num_shapes, tinyobj_material_t **materials,
+                                     size_t *num_materials, VFile_Handle handle,
+                                     size_t window_size, unsigned int flags);
+/* Parse .mtl from a VFile, reading it a window at a time */
+EXTERN_C int tinyobj_parse_mtl_vfile(tinyobj_material_t **materials_out,
+                                     size_t *num_materials_out,
+                                     VFile_Handle handle);
+
 EXTERN_C void tinyobj_attrib_init(tinyobj_attrib_t *attrib);
 EXTERN_C void tinyobj_attrib_free(tinyobj_attrib_t *attrib);
 EXTERN_C void tinyobj_shapes_free(tinyobj_shape_t *shapes, size_t num_shapes);
@@ -0,0 +1,71 @@
+#pragma once
+#ifndef WYRD_SYOYO_TINY_OBJMESH_H
+#define WYRD_SYOYO_TINY_OBJMESH_H
+
+#include "core/core.h"
+#include "syoyo/tiny_objloader.h"
+
+/* Turns the separate position/texcoord/normal index streams of a parsed .obj
+ * into a single interleaved vertex buffer and an index buffer ready for the
+ * GPU. Identical index triples are shared, triangles are grouped by material
+ * and then reordered (Tipsify) for the post transform vertex cache and
+ * vertices renumbered in first use order for fetch locality */
+
+/* vertex layout, position (3 floats) is always first */
+#define TINYOBJ_MESH_NORMAL (1 << 0)   /* 3 floats */
+#define TINYOBJ_MESH_TEXCOORD (1 << 1) /* 2 floats */
+
+/* build flags */
+#define TINYOBJ_MESH_FLAG_NO_OPTIMISE (1 << 0)   /* keep the .obj triangle order */
+#define TINYOBJ_MESH_FLAG_32BIT_INDICES (1 << 1) /* even if 16 bit would do */
+
+/* the cache size the triangle order is optimised for and ACMR measured with */
+#define TINYOBJ_MESH_CACHE_SIZE (16)
+
+typedef struct {
+  int material_id; /* -1 for faces without a material */
+  unsigned int index_offset;
+  unsigned int index_count;
+} tinyobj_submesh_t;
+
+typedef struct {
+  unsigned int num_vertices;
+  unsigned int num_indices;
+  unsigned int num_submeshes;
+  unsigned int vertex_format; /* TINYOBJ_MESH_NORMAL | TINYOBJ_MESH_TEXCOORD */
+  unsigned int vertex_stride; /* in floats */
+  unsigned int index_size;    /* 2 or 4 bytes */
+
+  /* average cache miss ratio (vertex shader runs per triangle) of the
+   * de-duplicated .obj order and of the final order */
+  float acmr_before;
+  float acmr_after;
+
+  float *vertices;
+  void *indices;
+  tinyobj_submesh_t *submeshes; /* sorted by material id */
+} tinyobj_mesh_t;
+
+/* Builds a mesh from num_faces entries of attrib->face_num_verts starting
+ * at face_offset (0 and num_face_num_verts for everything). Polygons are
+ * fanned into triangles, indices outside the attrib arrays read as zero.
+ * A shape's face_offset and length count .obj face lines, they only index
+ * face_num_verts when the file was parsed without TINYOBJ_FLAG_TRIANGULATE
+ * (which splits a polygon into several entries), so parse without it to
+ * build per shape. Returns TINYOBJ_SUCCESS or TINYOBJ_ERROR_*, free the
+ * mesh with tinyobj_mesh_free */
+EXTERN_C int tinyobj_mesh_build(tinyobj_mesh_t *mesh,
+                                tinyobj_attrib_t const *attrib,
+                                unsigned int face_offset,
+                                unsigned int num_faces,
+                                unsigned int flags);
+
+EXTERN_C void tinyobj_mesh_free(tinyobj_mesh_t *mesh);
+
+/* average cache miss ratio of a triangle list through a FIFO cache */
+EXTERN_C float tinyobj_mesh_acmr(void const *indices,
+                                 unsigned int index_size,
+                                 unsigned int num_indices,
+                                 unsigned int cache_size);
+
+#endif //WYRD_SYOYO_TINY_OBJMESH_H
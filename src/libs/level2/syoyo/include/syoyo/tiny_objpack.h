@@ -0,0 +1,64 @@
+#pragma once
+#ifndef WYRD_SYOYO_TINY_OBJPACK_H
+#define WYRD_SYOYO_TINY_OBJPACK_H
+
+#include "core/core.h"
+#include "syoyo/tiny_objmesh.h"
+
+/* Quantised vertices for a tinyobj_mesh_t. Positions are 16 bit unorm within
+ * the mesh bounds, normals octahedral encoded into 2 snorm components and
+ * texcoords half floats, which takes the usual 32 byte vertex to 16.
+ * The index buffer and submeshes of the source mesh are used unchanged */
+
+/* attribute semantics */
+#define TINYOBJ_PACK_POSITION (0)
+#define TINYOBJ_PACK_NORMAL (1)
+#define TINYOBJ_PACK_TEXCOORD (2)
+
+/* attribute formats, named as the matching GPU vertex formats */
+#define TINYOBJ_PACK_R16G16B16A16_UNORM (0) /* position = offset + xyz * scale */
+#define TINYOBJ_PACK_R16G16_SNORM (1)       /* octahedral */
+#define TINYOBJ_PACK_R8G8_SNORM (2)         /* octahedral */
+#define TINYOBJ_PACK_R16G16_SFLOAT (3)
+
+/* pack flags */
+#define TINYOBJ_PACK_FLAG_NORMAL_8BIT (1 << 0) /* 2x8 bit rather than 2x16 bit */
+
+typedef struct {
+  unsigned int semantic;
+  unsigned int format;
+  unsigned int offset; /* in bytes from the start of the vertex */
+} tinyobj_packed_attribute_t;
+
+typedef struct {
+  unsigned int num_vertices;
+  unsigned int vertex_format; /* TINYOBJ_MESH_* of the source mesh */
+  unsigned int stride;        /* in bytes, every attribute is 4 byte aligned */
+  unsigned int num_attributes;
+  tinyobj_packed_attribute_t attributes[3];
+
+  /* dequantise positions with offset + unorm * scale, unorm being the
+   * 0..1 value a GPU fetch of the format returns (q / 65535), so scale
+   * is the bounding box extent */
+  float position_offset[3];
+  float position_scale[3];
+
+  void *vertices;
+} tinyobj_packed_mesh_t;
+
+EXTERN_C int tinyobj_mesh_pack(tinyobj_packed_mesh_t *packed,
+                               tinyobj_mesh_t const *mesh,
+                               unsigned int flags);
+
+EXTERN_C void tinyobj_packed_mesh_free(tinyobj_packed_mesh_t *packed);
+
+/* decodes back to the float layout of the source mesh (vertex_format),
+ * vertices_out needs num_vertices * mesh vertex_stride floats */
+EXTERN_C int tinyobj_packed_mesh_decode(tinyobj_packed_mesh_t const *packed, float *vertices_out);
+
+/* octahedral mapping of a unit vector to [-1,1]^2 and back, also for
+ * tangents or any other direction a tool wants to pack */
+EXTERN_C void tinyobj_oct_encode(float const dir[3], float oct_out[2]);
+EXTERN_C void tinyobj_oct_decode(float const oct[2], float dir_out[3]);
+
+#endif //WYRD_SYOYO_TINY_OBJPACK_H
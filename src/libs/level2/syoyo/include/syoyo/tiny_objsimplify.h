@@ -0,0 +1,82 @@
+#pragma once
+#ifndef WYRD_SYOYO_TINY_OBJSIMPLIFY_H
+#define WYRD_SYOYO_TINY_OBJSIMPLIFY_H
+
+#include "core/core.h"
+#include "syoyo/tiny_objmesh.h"
+
+/* Level of detail chains for a tinyobj_mesh_t by edge collapse (Garland and
+ * Heckbert quadric error metrics). Normals and texcoords are part of the
+ * cost (Hoppe 1999 attribute quadrics) so collapses keep shading and
+ * texture mapping where possible. Each level carries on collapsing from the
+ * one before it, its indices refer to the source mesh's vertex buffer so
+ * every level shares one set of vertices.
+ * Vertices split by a UV seam or normal crease, or shared between
+ * submeshes, never move so seams and material boundaries don't tear */
+
+/* simplify flags */
+#define TINYOBJ_SIMPLIFY_FLAG_LOCK_BORDER (1 << 0) /* open edges keep every vertex */
+#define TINYOBJ_SIMPLIFY_FLAG_PARALLEL (1 << 1)    /* tinyobj_mesh_simplify_many on the thread pool */
+
+typedef struct {
+  unsigned int num_levels; /* levels wanted after the source mesh */
+
+  /* level n aims for source triangles * triangle_ratio^n, 0 to simplify by
+   * error alone */
+  float triangle_ratio;
+
+  /* level 1 stops before a collapse costing more than target_error, later
+   * levels allow error_growth times the level before. Errors are distances
+   * relative to the mesh's largest extent */
+  float target_error;
+  float error_growth;
+
+  /* attribute cost relative to position cost, 0 ignores the attribute */
+  float normal_weight;
+  float texcoord_weight;
+
+  unsigned int flags;
+} tinyobj_simplify_options_t;
+
+typedef struct {
+  unsigned int num_indices;
+  unsigned int num_submeshes;
+  unsigned int index_size; /* as the source mesh */
+  float error;             /* largest collapse error so far, relative */
+
+  void *indices; /* into the source mesh's vertices */
+  tinyobj_submesh_t *submeshes; /* source submeshes with triangles left */
+} tinyobj_mesh_lod_t;
+
+/* one mesh of tinyobj_mesh_simplify_many */
+typedef struct {
+  tinyobj_mesh_t const *mesh;
+  tinyobj_mesh_lod_t *lods; /* options num_levels entries */
+  unsigned int num_lods;    /* out */
+  int result;               /* out, TINYOBJ_SUCCESS or TINYOBJ_ERROR_* */
+} tinyobj_simplify_job_t;
+
+/* 4 levels each half the triangles of the one before within 1% error of
+ * the mesh size, doubling each level, borders may slide along themselves */
+EXTERN_C void tinyobj_simplify_options_init(tinyobj_simplify_options_t *options);
+
+/* Fills lods[0, *num_lods) with progressively simpler levels of mesh. A level
+ * is only made if it has fewer triangles than the one before, so *num_lods
+ * can be less than options->num_levels when the error limit or locked
+ * vertices stop the collapses. Returns TINYOBJ_SUCCESS or TINYOBJ_ERROR_*,
+ * free each level with tinyobj_mesh_lod_free */
+EXTERN_C int tinyobj_mesh_simplify(tinyobj_mesh_lod_t *lods,
+                                   unsigned int *num_lods,
+                                   tinyobj_mesh_t const *mesh,
+                                   tinyobj_simplify_options_t const *options);
+
+/* tinyobj_mesh_simplify for independent meshes, one per thread pool task
+ * with TINYOBJ_SIMPLIFY_FLAG_PARALLEL. Returns TINYOBJ_SUCCESS if every job
+ * succeeded, each job has its own result */
+EXTERN_C int tinyobj_mesh_simplify_many(tinyobj_simplify_job_t *jobs,
+                                        unsigned int num_jobs,
+                                        tinyobj_simplify_options_t const *options);
+
+EXTERN_C void tinyobj_mesh_lod_free(tinyobj_mesh_lod_t *lod);
+
+#endif //WYRD_SYOYO_TINY_OBJSIMPLIFY_H
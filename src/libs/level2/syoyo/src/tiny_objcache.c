@@ -0,0 +1,450 @@
+#include "core/core.h"
+#include "core/logger.h"
+#include "os/file.h"
+#include "os/filesystem.h"
+#include "vfile/vfile.h"
+#include "lz4/xxhash.h"
+#include "syoyo/tiny_objloader.h"
+#include "syoyo/tiny_objcache.h"
+#include <stdlib.h>
+
+#define TINYOBJ_CACHE_MAGIC (0x43424f54u) /* 'TOBC' */
+#define TINYOBJ_CACHE_VERSION (1)
+/* only flags that change the parse result are part of the key */
+#define TINYOBJ_CACHE_FLAG_MASK (TINYOBJ_FLAG_TRIANGULATE)
+
+/* the blob starts with this, every array is 8 byte aligned and strings are
+ * at the end. Offsets are from the start of the blob, 0 is NULL */
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t source_size;
+  uint64_t source_mtime;
+  uint64_t source_hash;
+  uint32_t flags;
+  uint32_t num_shapes;
+  uint32_t num_materials;
+  uint32_t num_vertices;
+  uint32_t num_normals;
+  uint32_t num_texcoords;
+  uint32_t num_faces;
+  uint32_t num_face_num_verts;
+
+  uint64_t vertices;
+  uint64_t normals;
+  uint64_t texcoords;
+  uint64_t faces;
+  uint64_t face_num_verts;
+  uint64_t material_ids;
+  uint64_t shapes;    /* tinyobj_shape_t with offsets for pointers */
+  uint64_t materials; /* tinyobj_material_t with offsets for pointers */
+  uint64_t size;
+} CacheHeader;
+
+typedef struct {
+  uint64_t size;
+  uint64_t mtime;
+  uint64_t hash;
+  int hashed;
+  int pad0;
+} SourceKey;
+
+struct tinyobj_cache_t {
+  void const *mapping;
+  size_t mapping_size;
+  int hit;
+  int pad0;
+
+  /* on a miss the handle owns the parse results instead */
+  tinyobj_attrib_t attrib;
+  tinyobj_shape_t *shapes;
+  size_t num_shapes;
+  tinyobj_material_t *materials;
+  size_t num_materials;
+};
+
+static uint64_t align8(uint64_t value) {
+  return (value + 7) & ~((uint64_t) 7);
+}
+
+static int read_source_key(const char *obj_filename, SourceKey *key) {
+  Os_FileHandle file = Os_FileOpen(obj_filename, Os_FM_ReadBinary);
+  if (!file) return 0;
+  key->size = Os_FileSize(file);
+  Os_FileClose(file);
+  key->mtime = Os_GetLastModifiedTime(obj_filename);
+  key->hash = 0;
+  key->hashed = 0;
+  return 1;
+}
+
+static void hash_source(const void *data, SourceKey *key) {
+  if (key->hashed) return;
+  key->hash = XXH64(data, (size_t) key->size, 0);
+  key->hashed = 1;
+}
+
+static int hash_source_file(const char *obj_filename, SourceKey *key) {
+  size_t size = 0;
+  void const *data;
+  if (key->hashed) return 1;
+  data = Os_FileMapReadOnly(obj_filename, &size);
+  if (!data) return 0;
+  key->size = size;
+  hash_source(data, key);
+  Os_FileUnmap(data, size);
+  return 1;
+}
+
+static int array_fits(uint64_t offset, uint64_t count, uint64_t element_size, uint64_t size) {
+  if (count == 0) return 1;
+  return offset >= sizeof(CacheHeader) && offset <= size && count * element_size <= size - offset;
+}
+
+static int header_is_valid(CacheHeader const *header, size_t size, unsigned int flags) {
+  if (size < sizeof(CacheHeader)) return 0;
+  if (header->magic != TINYOBJ_CACHE_MAGIC || header->version != TINYOBJ_CACHE_VERSION) return 0;
+  if (header->size != size) return 0;
+  if (header->flags != (flags & TINYOBJ_CACHE_FLAG_MASK)) return 0;
+  return array_fits(header->vertices, header->num_vertices, 3 * sizeof(float), size) &&
+      array_fits(header->normals, header->num_normals, 3 * sizeof(float), size) &&
+      array_fits(header->texcoords, header->num_texcoords, 2 * sizeof(float), size) &&
+      array_fits(header->faces, header->num_faces, sizeof(tinyobj_vertex_index_t), size) &&
+      array_fits(header->face_num_verts, header->num_face_num_verts, sizeof(int), size) &&
+      array_fits(header->material_ids, header->num_face_num_verts, sizeof(int), size) &&
+      array_fits(header->shapes, header->num_shapes, sizeof(tinyobj_shape_t), size) &&
+      array_fits(header->materials, header->num_materials, sizeof(tinyobj_material_t), size);
+}
+
+/* a string has to end inside the mapping, *valid is cleared if it doesn't */
+static char *string_at(uint8_t const *base, size_t size, char *offset, int *valid) {
+  uint64_t const o = (uint64_t) (uintptr_t) offset;
+  if (o == 0) return NULL;
+  if (o < sizeof(CacheHeader) || o >= size || memchr(base + o, 0, (size_t) (size - o)) == NULL) {
+    *valid = 0;
+    return NULL;
+  }
+  return (char *) (base + o);
+}
+
+/* the shape and material tables are the only things that need pointers
+ * fixing, they go in the handles allocation. Everything else is used as is */
+static tinyobj_cache_handle use_mapping(void const *mapping, size_t size) {
+  uint8_t const *base = (uint8_t const *) mapping;
+  CacheHeader const *header = (CacheHeader const *) mapping;
+  size_t const shapes_size = sizeof(tinyobj_shape_t) * header->num_shapes;
+  size_t const materials_size = sizeof(tinyobj_material_t) * header->num_materials;
+  tinyobj_cache_handle cache;
+  int valid = 1;
+  uint32_t i;
+
+  cache = (tinyobj_cache_handle) calloc(1, sizeof(struct tinyobj_cache_t) + shapes_size + materials_size);
+  if (!cache) return NULL;
+  cache->mapping = mapping;
+  cache->mapping_size = size;
+  cache->hit = 1;
+
+  cache->attrib.num_vertices = header->num_vertices;
+  cache->attrib.num_normals = header->num_normals;
+  cache->attrib.num_texcoords = header->num_texcoords;
+  cache->attrib.num_faces = header->num_faces;
+  cache->attrib.num_face_num_verts = header->num_face_num_verts;
+  cache->attrib.vertices = (float *) (base + header->vertices);
+  cache->attrib.normals = (float *) (base + header->normals);
+  cache->attrib.texcoords = (float *) (base + header->texcoords);
+  cache->attrib.faces = (tinyobj_vertex_index_t *) (base + header->faces);
+  cache->attrib.face_num_verts = (int *) (base + header->face_num_verts);
+  cache->attrib.material_ids = (int *) (base + header->material_ids);
+
+  cache->shapes = (tinyobj_shape_t *) (cache + 1);
+  cache->num_shapes = header->num_shapes;
+  memcpy(cache->shapes, base + header->shapes, shapes_size);
+  for (i = 0; i < header->num_shapes; i++) {
+    cache->shapes[i].name = string_at(base, size, cache->shapes[i].name, &valid);
+  }
+
+  cache->materials = (tinyobj_material_t *) (((uint8_t *) cache->shapes) + shapes_size);
+  cache->num_materials = header->num_materials;
+  memcpy(cache->materials, base + header->materials, materials_size);
+  for (i = 0; i < header->num_materials; i++) {
+    tinyobj_material_t *material = &cache->materials[i];
+    material->name = string_at(base, size, material->name, &valid);
+    material->ambient_texname = string_at(base, size, material->ambient_texname, &valid);
+    material->diffuse_texname = string_at(base, size, material->diffuse_texname, &valid);
+    material->specular_texname = string_at(base, size, material->specular_texname, &valid);
+    material->specular_highlight_texname = string_at(base, size, material->specular_highlight_texname, &valid);
+    material->bump_texname = string_at(base, size, material->bump_texname, &valid);
+    material->displacement_texname = string_at(base, size, material->displacement_texname, &valid);
+    material->alpha_texname = string_at(base, size, material->alpha_texname, &valid);
+  }
+  if (!valid) {
+    free(cache);
+    return NULL;
+  }
+  return cache;
+}
+
+/* appends a string to the string table, returns its offset as a pointer */
+static char *add_string(const char *str, uint64_t *strings_end) {
+  uint64_t const offset = *strings_end;
+  if (str == NULL) return NULL;
+  *strings_end += strlen(str) + 1;
+  return (char *) (uintptr_t) offset;
+}
+
+static int write_padded(VFile_Handle file, const void *data, uint64_t size, uint64_t *pos) {
+  static const uint8_t zeros[8] = {0};
+  uint64_t const padding = align8(*pos) - *pos;
+  if (padding && VFile_Write(file, zeros, (size_t) padding) != padding) return 0;
+  if (size && VFile_Write(file, data, (size_t) size) != size) return 0;
+  *pos += padding + size;
+  return 1;
+}
+
+static int write_string(VFile_Handle file, const char *str, uint64_t *pos) {
+  size_t const len = str ? strlen(str) + 1 : 0;
+  if (len && VFile_Write(file, str, len) != len) return 0;
+  *pos += len;
+  return 1;
+}
+
+/* caches are written to <cache>.tmp and renamed over the cache once
+ * complete, so readers only ever map a whole cache */
+static char *temp_filename(const char *cache_filename) {
+  size_t const len = strlen(cache_filename);
+  char *name = (char *) malloc(len + 5);
+  if (!name) return NULL;
+  memcpy(name, cache_filename, len);
+  memcpy(name + len, ".tmp", 5);
+  return name;
+}
+
+static int publish_temp(VFile_Handle file, int ok, char *temp, const char *cache_filename) {
+  VFile_Close(file);
+  ok = ok && Os_FileRename(temp, cache_filename);
+  if (!ok) Os_FileDelete(temp);
+  free(temp);
+  return ok;
+}
+
+static int save_with_key(const char *cache_filename,
+                         SourceKey const *key,
+                         unsigned int flags,
+                         tinyobj_attrib_t const *attrib,
+                         tinyobj_shape_t const *shapes,
+                         size_t num_shapes,
+                         tinyobj_material_t const *materials,
+                         size_t num_materials) {
+  CacheHeader header;
+  tinyobj_shape_t *shape_table;
+  tinyobj_material_t *material_table;
+  VFile_Handle file;
+  char *temp;
+  uint64_t pos = 0;
+  uint64_t strings_end;
+  size_t i;
+  int ok = 1;
+
+  memset(&header, 0, sizeof(header));
+  header.magic = TINYOBJ_CACHE_MAGIC;
+  header.version = TINYOBJ_CACHE_VERSION;
+  header.source_size = key->size;
+  header.source_mtime = key->mtime;
+  header.source_hash = key->hash;
+  header.flags = flags & TINYOBJ_CACHE_FLAG_MASK;
+  header.num_shapes = (uint32_t) num_shapes;
+  header.num_materials = (uint32_t) num_materials;
+  header.num_vertices = attrib->num_vertices;
+  header.num_normals = attrib->num_normals;
+  header.num_texcoords = attrib->num_texcoords;
+  header.num_faces = attrib->num_faces;
+  header.num_face_num_verts = attrib->num_face_num_verts;
+
+  header.vertices = align8(sizeof(CacheHeader));
+  header.normals = align8(header.vertices + sizeof(float) * 3 * attrib->num_vertices);
+  header.texcoords = align8(header.normals + sizeof(float) * 3 * attrib->num_normals);
+  header.faces = align8(header.texcoords + sizeof(float) * 2 * attrib->num_texcoords);
+  header.face_num_verts = align8(header.faces + sizeof(tinyobj_vertex_index_t) * attrib->num_faces);
+  header.material_ids = align8(header.face_num_verts + sizeof(int) * attrib->num_face_num_verts);
+  header.shapes = align8(header.material_ids + sizeof(int) * attrib->num_face_num_verts);
+  header.materials = align8(header.shapes + sizeof(tinyobj_shape_t) * num_shapes);
+  strings_end = header.materials + sizeof(tinyobj_material_t) * num_materials;
+
+  /* copies of the tables with the strings swapped for their offsets */
+  shape_table = (tinyobj_shape_t *) malloc(sizeof(tinyobj_shape_t) * (num_shapes + 1));
+  material_table = (tinyobj_material_t *) malloc(sizeof(tinyobj_material_t) * (num_materials + 1));
+  if (!shape_table || !material_table) {
+    free(shape_table);
+    free(material_table);
+    return TINYOBJ_ERROR_FILE_OPERATION;
+  }
+  for (i = 0; i < num_shapes; i++) {
+    shape_table[i] = shapes[i];
+    shape_table[i].name = add_string(shapes[i].name, &strings_end);
+  }
+  for (i = 0; i < num_materials; i++) {
+    tinyobj_material_t *material = &material_table[i];
+    *material = materials[i];
+    material->name = add_string(materials[i].name, &strings_end);
+    material->ambient_texname = add_string(materials[i].ambient_texname, &strings_end);
+    material->diffuse_texname = add_string(materials[i].diffuse_texname, &strings_end);
+    material->specular_texname = add_string(materials[i].specular_texname, &strings_end);
+    material->specular_highlight_texname = add_string(materials[i].specular_highlight_texname, &strings_end);
+    material->bump_texname = add_string(materials[i].bump_texname, &strings_end);
+    material->displacement_texname = add_string(materials[i].displacement_texname, &strings_end);
+    material->alpha_texname = add_string(materials[i].alpha_texname, &strings_end);
+  }
+  header.size = strings_end;
+
+  temp = temp_filename(cache_filename);
+  file = temp ? VFile_FromFile(temp, Os_FM_WriteBinary) : NULL;
+  if (!file) {
+    free(temp);
+    free(shape_table);
+    free(material_table);
+    return TINYOBJ_ERROR_FILE_OPERATION;
+  }
+
+  ok = ok && write_padded(file, &header, sizeof(header), &pos);
+  ok = ok && write_padded(file, attrib->vertices, sizeof(float) * 3 * attrib->num_vertices, &pos);
+  ok = ok && write_padded(file, attrib->normals, sizeof(float) * 3 * attrib->num_normals, &pos);
+  ok = ok && write_padded(file, attrib->texcoords, sizeof(float) * 2 * attrib->num_texcoords, &pos);
+  ok = ok && write_padded(file, attrib->faces, sizeof(tinyobj_vertex_index_t) * attrib->num_faces, &pos);
+  ok = ok && write_padded(file, attrib->face_num_verts, sizeof(int) * attrib->num_face_num_verts, &pos);
+  ok = ok && write_padded(file, attrib->material_ids, sizeof(int) * attrib->num_face_num_verts, &pos);
+  ok = ok && write_padded(file, shape_table, sizeof(tinyobj_shape_t) * num_shapes, &pos);
+  ok = ok && write_padded(file, material_table, sizeof(tinyobj_material_t) * num_materials, &pos);
+  for (i = 0; i < num_shapes && ok; i++) {
+    ok = write_string(file, shapes[i].name, &pos);
+  }
+  for (i = 0; i < num_materials && ok; i++) {
+    ok = write_string(file, materials[i].name, &pos) &&
+        write_string(file, materials[i].ambient_texname, &pos) &&
+        write_string(file, materials[i].diffuse_texname, &pos) &&
+        write_string(file, materials[i].specular_texname, &pos) &&
+        write_string(file, materials[i].specular_highlight_texname, &pos) &&
+        write_string(file, materials[i].bump_texname, &pos) &&
+        write_string(file, materials[i].displacement_texname, &pos) &&
+        write_string(file, materials[i].alpha_texname, &pos);
+  }
+  ASSERT(!ok || pos == header.size);
+
+  free(shape_table);
+  free(material_table);
+  if (!publish_temp(file, ok, temp, cache_filename)) {
+    LOGERRORF("TINYOBJ: Failed writing cache '%s'", cache_filename);
+    return TINYOBJ_ERROR_FILE_OPERATION;
+  }
+  return TINYOBJ_SUCCESS;
+}
+
+int tinyobj_cache_save(const char *cache_filename,
+                       const char *obj_filename,
+                       unsigned int flags,
+                       tinyobj_attrib_t const *attrib,
+                       tinyobj_shape_t const *shapes,
+                       size_t num_shapes,
+                       tinyobj_material_t const *materials,
+                       size_t num_materials) {
+  SourceKey key;
+  if (cache_filename == NULL || obj_filename == NULL || attrib == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (!read_source_key(obj_filename, &key) || !hash_source_file(obj_filename, &key)) {
+    return TINYOBJ_ERROR_FILE_OPERATION;
+  }
+  return save_with_key(cache_filename, &key, flags, attrib, shapes, num_shapes, materials, num_materials);
+}
+
+int tinyobj_parse_obj_cached(tinyobj_attrib_t *attrib,
+                             tinyobj_shape_t const **shapes,
+                             size_t *num_shapes,
+                             tinyobj_material_t const **materials,
+                             size_t *num_materials,
+                             const char *obj_filename,
+                             const char *cache_filename,
+                             unsigned int flags,
+                             tinyobj_cache_handle *cache_out) {
+  tinyobj_cache_handle cache = NULL;
+  SourceKey key;
+  void const *mapping;
+  size_t size = 0;
+  int ret;
+
+  if (attrib == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (shapes == NULL || num_shapes == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (materials == NULL || num_materials == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (obj_filename == NULL || cache_filename == NULL || cache_out == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  *cache_out = NULL;
+
+  if (!read_source_key(obj_filename, &key)) {
+    return TINYOBJ_ERROR_FILE_OPERATION;
+  }
+
+  mapping = Os_FileMapReadOnly(cache_filename, &size);
+  if (mapping) {
+    CacheHeader const *header = (CacheHeader const *) mapping;
+    /* same size and time is a hit without reading the .obj, a touched
+     * source is only a hit if its content hash still matches */
+    int const hit = header_is_valid(header, size, flags) && header->source_size == key.size &&
+        (header->source_mtime == key.mtime ||
+            (hash_source_file(obj_filename, &key) && header->source_hash == key.hash));
+    if (hit) {
+      cache = use_mapping(mapping, size);
+    }
+    if (!cache) {
+      Os_FileUnmap(mapping, size);
+    }
+  }
+
+  if (!cache) {
+    const char *data = (const char *) Os_FileMapReadOnly(obj_filename, &size);
+    if (!data) {
+      return TINYOBJ_ERROR_FILE_OPERATION;
+    }
+    cache = (tinyobj_cache_handle) calloc(1, sizeof(struct tinyobj_cache_t));
+    if (!cache) {
+      Os_FileUnmap(data, size);
+      return TINYOBJ_ERROR_FILE_OPERATION;
+    }
+    ret = tinyobj_parse_obj(&cache->attrib, &cache->shapes, &cache->num_shapes,
+                            &cache->materials, &cache->num_materials, data, size, flags);
+    if (ret != TINYOBJ_SUCCESS) {
+      Os_FileUnmap(data, size);
+      free(cache);
+      return ret;
+    }
+    key.size = size;
+    hash_source(data, &key);
+    Os_FileUnmap(data, size);
+
+    /* not being able to write the cache isn't fatal, next time is a miss */
+    if (save_with_key(cache_filename, &key, flags, &cache->attrib,
+                      cache->shapes, cache->num_shapes,
+                      cache->materials, cache->num_materials) != TINYOBJ_SUCCESS) {
+      LOGWARNINGF("TINYOBJ: Unable to write cache '%s'", cache_filename);
+    }
+  }
+
+  *attrib = cache->attrib;
+  *shapes = cache->shapes;
+  *num_shapes = cache->num_shapes;
+  *materials = cache->materials;
+  *num_materials = cache->num_materials;
+  *cache_out = cache;
+  return TINYOBJ_SUCCESS;
+}
+
+int tinyobj_cache_was_hit(tinyobj_cache_handle cache) {
+  return cache ? cache->hit : 0;
+}
+
+void tinyobj_cache_free(tinyobj_cache_handle cache) {
+  if (cache == NULL) return;
+  if (cache->mapping) {
+    Os_FileUnmap(cache->mapping, cache->mapping_size);
+  } else {
+    tinyobj_attrib_free(&cache->attrib);
+    tinyobj_shapes_free(cache->shapes, cache->num_shapes);
+    tinyobj_materials_free(cache->materials, cache->num_materials);
+  }
+  free(cache);
+}
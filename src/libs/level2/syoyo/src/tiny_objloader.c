@@ -1,7 +1,9 @@
 #include "core/core.h"
 #include "core/logger.h"
+#include "core/parse_number.h"
 #include "vfile/vfile.h"
 #include "vfile/utils.h"
+#include "os/threadpool.h"
 #include "syoyo/tiny_objloader.h"
 #include <stdio.h> // for sscanf
 
@@ -23,6 +25,12 @@
 
 #define TINYOBJ_MAX_FACES_PER_F_LINE (16)
 
+/* default window for tinyobj_parse_obj_vfile */
+#define TINYOBJ_STREAM_WINDOW_SIZE (4 * 1024 * 1024)
+
+/* mtl files are small, a window this size nearly always reads them whole */
+#define TINYOBJ_MTL_WINDOW_SIZE (64 * 1024)
+
 #define IS_SPACE(x) (((x) == ' ') || ((x) == '\t'))
 #define IS_DIGIT(x) ((unsigned int)((x) - '0') < (unsigned int)(10))
 #define IS_NEW_LINE(x) (((x) == '\r') || ((x) == '\n') || ((x) == '\0'))
@@ -77,21 +85,11 @@ static size_t length_until_line_feed(const char *token, size_t n) {
   return len;
 }
 
-/* http://stackoverflow.com/questions/5710091/how-does-atoi-function-in-c-work
-*/
-static int my_atoi(const char *c) {
-  int value = 0;
-  int sign = 1;
-  if (*c == '+' || *c == '-') {
-    if (*c == '-') sign = -1;
-    c++;
-  }
-  while (((*c) >= '0') && ((*c) <= '9')) { /* isdigit(*c) */
-    value *= 10;
-    value += (int)(*c - '0');
-    c++;
-  }
-  return value * sign;
+/* 0 when there isn't a number, like atoi */
+static int my_atoi(const char *c, const char *end) {
+  int32_t value = 0;
+  Core_ParseInt32(c, end, &value);
+  return value;
 }
 
 /* Make index zero-base, and also support relative index. */
@@ -102,14 +100,14 @@ static int fixIndex(int idx, size_t n) {
 }
 
 /* Parse raw triples: i, i/j/k, i//k, i/j */
-static tinyobj_vertex_index_t parseRawTriple(const char **token) {
+static tinyobj_vertex_index_t parseRawTriple(const char **token, const char *end) {
   tinyobj_vertex_index_t vi;
   /* 0x80000000 = -2147483648 = invalid */
   vi.v_idx = (int)(0x80000000);
   vi.vn_idx = (int)(0x80000000);
   vi.vt_idx = (int)(0x80000000);
 
-  vi.v_idx = my_atoi((*token));
+  vi.v_idx = my_atoi((*token), end);
   while ((*token)[0] != '\0' && (*token)[0] != '/' && (*token)[0] != ' ' &&
          (*token)[0] != '\t' && (*token)[0] != '\r') {
     (*token)++;
@@ -122,7 +120,7 @@ static tinyobj_vertex_index_t parseRawTriple(const char **token) {
   /* i//k */
   if ((*token)[0] == '/') {
     (*token)++;
-    vi.vn_idx = my_atoi((*token));
+    vi.vn_idx = my_atoi((*token), end);
     while ((*token)[0] != '\0' && (*token)[0] != '/' && (*token)[0] != ' ' &&
            (*token)[0] != '\t' && (*token)[0] != '\r') {
       (*token)++;
@@ -131,7 +129,7 @@ static tinyobj_vertex_index_t parseRawTriple(const char **token) {
   }
 
   /* i/j/k or i/j */
-  vi.vt_idx = my_atoi((*token));
+  vi.vt_idx = my_atoi((*token), end);
   while ((*token)[0] != '\0' && (*token)[0] != '/' && (*token)[0] != ' ' &&
          (*token)[0] != '\t' && (*token)[0] != '\r') {
     (*token)++;
@@ -142,7 +140,7 @@ static tinyobj_vertex_index_t parseRawTriple(const char **token) {
 
   /* i/j/k */
   (*token)++; /* skip '/' */
-  vi.vn_idx = my_atoi((*token));
+  vi.vn_idx = my_atoi((*token), end);
   while ((*token)[0] != '\0' && (*token)[0] != '/' && (*token)[0] != ' ' &&
          (*token)[0] != '\t' && (*token)[0] != '\r') {
     (*token)++;
@@ -150,200 +148,35 @@ static tinyobj_vertex_index_t parseRawTriple(const char **token) {
   return vi;
 }
 
-static int parseInt(const char **token) {
+static int parseInt(const char **token, const char *end) {
   int i = 0;
   skip_space(token);
-  i = my_atoi((*token));
+  i = my_atoi((*token), end);
   (*token) += until_space((*token));
   return i;
 }
 
-/*
- * Tries to parse a floating point number located at s.
- *
- * s_end should be a location in the string where reading should absolutely
- * stop. For example at the end of the string, to prevent buffer overflows.
- *
- * Parses the following EBNF grammar:
- *   sign    = "+" | "-" ;
- *   END     = ? anything not in digit ?
- *   digit   = "0" | "1" | "2" | "3" | "4" | "5" | "6" | "7" | "8" | "9" ;
- *   integer = [sign] , digit , {digit} ;
- *   decimal = integer , ["." , integer] ;
- *   float   = ( decimal , END ) | ( decimal , ("E" | "e") , integer , END ) ;
- *
- *  Valid strings are for example:
- *   -0  +3.1417e+2  -0.0E-3  1.0324  -1.41   11e2
- *
- * If the parsing is a success, result is set to the parsed value and true
- * is returned.
- *
- * The function is greedy and will parse until any of the following happens:
- *  - a non-conforming character is encountered.
- *  - s_end is reached.
- *
- * The following situations triggers a failure:
- *  - s >= s_end.
- *  - parse failure.
- */
-static int tryParseDouble(const char *s, const char *s_end, double *result) {
-  double mantissa = 0.0;
-  /* This exponent is base 2 rather than 10.
-   * However the exponent we parse is supposed to be one of ten,
-   * thus we must take care to convert the exponent/and or the
-   * mantissa to a * 2^E, where a is the mantissa and E is the
-   * exponent.
-   * To get the final double we will use ldexp, it requires the
-   * exponent to be in base 2.
-   */
-  int exponent = 0;
-
-  /* NOTE: THESE MUST BE DECLARED HERE SINCE WE ARE NOT ALLOWED
-   * TO JUMP OVER DEFINITIONS.
-   */
-  char sign = '+';
-  char exp_sign = '+';
-  char const *curr = s;
-
-  /* How many characters were read in a loop. */
-  int read = 0;
-  /* Tells whether a loop terminated due to reaching s_end. */
-  int end_not_reached = 0;
-
-  /*
-     BEGIN PARSING.
-     */
-
-  if (s >= s_end) {
-    return 0; /* fail */
-  }
-
-  /* Find out what sign we've got. */
-  if (*curr == '+' || *curr == '-') {
-    sign = *curr;
-    curr++;
-  } else if (IS_DIGIT(*curr)) { /* Pass through. */
-  } else {
-    goto fail;
-  }
-
-  /* Read the integer part. */
-  end_not_reached = (curr != s_end);
-  while (end_not_reached && IS_DIGIT(*curr)) {
-    mantissa *= 10;
-    mantissa += (int)(*curr - 0x30);
-    curr++;
-    read++;
-    end_not_reached = (curr != s_end);
-  }
-
-  /* We must make sure we actually got something. */
-  if (read == 0) goto fail;
-  /* We allow numbers of form "#", "###" etc. */
-  if (!end_not_reached) goto assemble;
-
-  /* Read the decimal part. */
-  if (*curr == '.') {
-    curr++;
-    read = 1;
-    end_not_reached = (curr != s_end);
-    while (end_not_reached && IS_DIGIT(*curr)) {
-      /* pow(10.0, -read) */
-      double frac_value = 1.0;
-      int f;
-      for (f = 0; f < read; f++) {
-        frac_value *= 0.1;
-      }
-      mantissa += (int)(*curr - 0x30) * frac_value;
-      read++;
-      curr++;
-      end_not_reached = (curr != s_end);
-    }
-  } else if (*curr == 'e' || *curr == 'E') {
-  } else {
-    goto assemble;
-  }
-
-  if (!end_not_reached) goto assemble;
-
-  /* Read the exponent part. */
-  if (*curr == 'e' || *curr == 'E') {
-    curr++;
-    /* Figure out if a sign is present and if it is. */
-    end_not_reached = (curr != s_end);
-    if (end_not_reached && (*curr == '+' || *curr == '-')) {
-      exp_sign = *curr;
-      curr++;
-    } else if (IS_DIGIT(*curr)) { /* Pass through. */
-    } else {
-      /* Empty E is not allowed. */
-      goto fail;
-    }
-
-    read = 0;
-    end_not_reached = (curr != s_end);
-    while (end_not_reached && IS_DIGIT(*curr)) {
-      exponent *= 10;
-      exponent += (int)(*curr - 0x30);
-      curr++;
-      read++;
-      end_not_reached = (curr != s_end);
-    }
-    if (read == 0) goto fail;
-  }
-
-assemble :
-
-  {
-    double a = 1.0; /* = pow(5.0, exponent); */
-    double b  = 1.0; /* = 2.0^exponent */
-    int i;
-    for (i = 0; i < exponent; i++) {
-      a = a * 5.0;
-    }
-
-    for (i = 0; i < exponent; i++) {
-      b = b * 2.0;
-    }
-
-    if (exp_sign == '-') {
-      a = 1.0 / a;
-      b = 1.0 / b;
-    }
-
-    *result =
-      /* (sign == '+' ? 1 : -1) * ldexp(mantissa * pow(5.0, exponent),
-         exponent); */
-      (sign == '+' ? 1 : -1) * (mantissa * a * b);
-  }
-
-  return 1;
-fail:
-  return 0;
-}
-
-static float parseFloat(const char **token) {
-  const char *end;
-  double val = 0.0;
+/* Correctly rounded straight to float, 0 when there isn't a number. end is
+ * the end of the line rather than the token so the digit scan can run 16
+ * characters at a time */
+static float parseFloat(const char **token, const char *end) {
+  const char *p;
   float f = 0.0f;
   skip_space(token);
-  end = (*token) + until_space((*token));
-  val = 0.0;
-  tryParseDouble((*token), end, &val);
-  f = (float)(val);
-  (*token) = end;
+  p = Core_ParseFloat((*token), end, &f);
+  (*token) = p + until_space(p);
   return f;
 }
 
-static void parseFloat2(float *x, float *y, const char **token) {
-  (*x) = parseFloat(token);
-  (*y) = parseFloat(token);
+static void parseFloat2(float *x, float *y, const char **token, const char *end) {
+  (*x) = parseFloat(token, end);
+  (*y) = parseFloat(token, end);
 }
 
-static void parseFloat3(float *x, float *y, float *z, const char **token) {
-  (*x) = parseFloat(token);
-  (*y) = parseFloat(token);
-  (*z) = parseFloat(token);
+static void parseFloat3(float *x, float *y, float *z, const char **token, const char *end) {
+  (*x) = parseFloat(token, end);
+  (*y) = parseFloat(token, end);
+  (*z) = parseFloat(token, end);
 }
 
 static char *my_strdup(const char *s, size_t max_length) {
@@ -372,7 +205,11 @@ static char *my_strndup(const char *s, size_t len) {
   if (len == 0) return NULL;
 
   d = (char *)TINYOBJ_MALLOC(len + 1); /* + '\0' */
-  slen = strlen(s);
+  /* s may be a name in a buffer with no '\0' after it */
+  {
+    const char *end = (const char *) memchr(s, '\0', len);
+    slen = end ? (size_t) (end - s) : len;
+  }
   if (slen < len) {
     memcpy(d, s, slen);
     d[slen] = '\0';
@@ -384,29 +221,73 @@ static char *my_strndup(const char *s, size_t len) {
   return d;
 }
 
-bool dynamic_fgets(char **buf, size_t *size, VFile_Handle handle) {
-  char *offset;
-  size_t ret;
-  size_t old_size;
+/* Reads a VFile a window at a time and hands out whole lines. A line that
+ * straddles two windows is moved to the front of the buffer before the next
+ * read, so memory is a window plus the longest line */
+typedef struct {
+  VFile_Handle handle;
+  char *buf;
+  size_t capacity;
+  size_t window_size;
+  size_t len; /* bytes in buf */
+  size_t pos; /* start of the next line */
+  int eof;
+  int pad0;
+} LineReader;
 
-  if (!(ret = VFile_ReadString(handle, *buf, (int)*size))) {
-    return false;
-  }
+static void line_reader_init(LineReader *reader, VFile_Handle handle, size_t window_size) {
+  memset(reader, 0, sizeof(LineReader));
+  reader->handle = handle;
+  reader->window_size = window_size;
+}
 
-  if (NULL != strchr(*buf, '\n')) {
-    return false;
-  }
+static void line_reader_free(LineReader *reader) {
+  TINYOBJ_FREE(reader->buf);
+  reader->buf = NULL;
+}
 
-  do {
-    old_size = *size;
-    *size *= 2;
-    *buf = (char*)TINYOBJ_REALLOC(*buf, *size);
-    offset = &((*buf)[old_size - 1]);
+/* Returns the next line null terminated without its line ending, NULL at the
+ * end of the file */
+static char *line_reader_next(LineReader *reader) {
+  for (;;) {
+    size_t i;
+    size_t read;
+    for (i = reader->pos; i < reader->len; i++) {
+      if (reader->buf[i] == '\n') {
+        char *line = reader->buf + reader->pos;
+        reader->buf[i] = '\0';
+        if (i > reader->pos && reader->buf[i - 1] == '\r') reader->buf[i - 1] = '\0';
+        reader->pos = i + 1;
+        return line;
+      }
+    }
 
-    ret = VFile_ReadString(handle, offset, (int)(old_size + 1));
-  } while(ret && (NULL == strchr(*buf, '\n')));
+    if (reader->eof) {
+      char *line = reader->buf + reader->pos;
+      if (reader->pos >= reader->len) return NULL;
+      reader->buf[reader->len] = '\0'; /* capacity always has room for this */
+      reader->pos = reader->len;
+      return line;
+    }
 
-  return ret;
+    /* move the partial line to the front and read the next window after it */
+    memmove(reader->buf, reader->buf + reader->pos, reader->len - reader->pos);
+    reader->len -= reader->pos;
+    reader->pos = 0;
+    if (reader->len + reader->window_size + 1 > reader->capacity) {
+      char *buf;
+      reader->capacity = reader->len + reader->window_size + 1;
+      buf = (char *) TINYOBJ_REALLOC(reader->buf, reader->capacity);
+      if (buf == NULL) {
+        LOGERROR("TINYOBJ: Out of memory reading lines");
+        return NULL;
+      }
+      reader->buf = buf;
+    }
+    read = VFile_Read(reader->handle, reader->buf + reader->len, reader->window_size);
+    if (read < reader->window_size) reader->eof = 1;
+    reader->len += read;
+  }
 }
 
 static void initMaterial(tinyobj_material_t *material) {
@@ -612,14 +493,13 @@ static tinyobj_material_t *tinyobj_material_add(tinyobj_material_t *prev,
   return dst;
 }
 
-static int tinyobj_parse_and_index_mtl_file(tinyobj_material_t **materials_out,
-                                            size_t *num_materials_out,
-                                            const char *filename,
-                                            hash_table_t* material_table) {
+static int tinyobj_parse_and_index_mtl_vfile(tinyobj_material_t **materials_out,
+                                             size_t *num_materials_out,
+                                             VFile_Handle fileHandle,
+                                             hash_table_t* material_table) {
   tinyobj_material_t material;
-  size_t buffer_size = 128;
+  LineReader reader;
   char *linebuf;
-  VFile_Handle fileHandle;
   size_t num_materials = 0;
   tinyobj_material_t *materials = NULL;
   int has_previous_material = 0;
@@ -636,18 +516,15 @@ static int tinyobj_parse_and_index_mtl_file(tinyobj_material_t **materials_out,
   (*materials_out) = NULL;
   (*num_materials_out) = 0;
 
-  // try absolute load
-  fileHandle = VFile_FromFile(filename, Os_FM_Read);
-  if (!fileHandle) {
-    LOGWARNINGF("TINYOBJ: Error reading file '%s'", filename);
-    return TINYOBJ_ERROR_FILE_OPERATION;
+  if (fileHandle == NULL) {
+    return TINYOBJ_ERROR_INVALID_PARAMETER;
   }
 
   /* Create a default material */
   initMaterial(&material);
 
-  linebuf = (char*)TINYOBJ_MALLOC(buffer_size);
-  while (dynamic_fgets(&linebuf, &buffer_size, fileHandle)) {
+  line_reader_init(&reader, fileHandle, TINYOBJ_MTL_WINDOW_SIZE);
+  while ((linebuf = line_reader_next(&reader)) != NULL) {
     const char *token = linebuf;
 
     line_end = token + strlen(token);
@@ -695,7 +572,7 @@ static int tinyobj_parse_and_index_mtl_file(tinyobj_material_t **materials_out,
     if (token[0] == 'K' && token[1] == 'a' && IS_SPACE((token[2]))) {
       float r, g, b;
       token += 2;
-      parseFloat3(&r, &g, &b, &token);
+      parseFloat3(&r, &g, &b, &token, line_end);
       material.ambient[0] = r;
       material.ambient[1] = g;
       material.ambient[2] = b;
@@ -706,7 +583,7 @@ static int tinyobj_parse_and_index_mtl_file(tinyobj_material_t **materials_out,
     if (token[0] == 'K' && token[1] == 'd' && IS_SPACE((token[2]))) {
       float r, g, b;
       token += 2;
-      parseFloat3(&r, &g, &b, &token);
+      parseFloat3(&r, &g, &b, &token, line_end);
       material.diffuse[0] = r;
       material.diffuse[1] = g;
       material.diffuse[2] = b;
@@ -717,7 +594,7 @@ static int tinyobj_parse_and_index_mtl_file(tinyobj_material_t **materials_out,
     if (token[0] == 'K' && token[1] == 's' && IS_SPACE((token[2]))) {
       float r, g, b;
       token += 2;
-      parseFloat3(&r, &g, &b, &token);
+      parseFloat3(&r, &g, &b, &token, line_end);
       material.specular[0] = r;
       material.specular[1] = g;
       material.specular[2] = b;
@@ -728,7 +605,7 @@ static int tinyobj_parse_and_index_mtl_file(tinyobj_material_t **materials_out,
     if (token[0] == 'K' && token[1] == 't' && IS_SPACE((token[2]))) {
       float r, g, b;
       token += 2;
-      parseFloat3(&r, &g, &b, &token);
+      parseFloat3(&r, &g, &b, &token, line_end);
       material.transmittance[0] = r;
       material.transmittance[1] = g;
       material.transmittance[2] = b;
@@ -738,7 +615,7 @@ static int tinyobj_parse_and_index_mtl_file(tinyobj_material_t **materials_out,
     /* ior(index of refraction) */
     if (token[0] == 'N' && token[1] == 'i' && IS_SPACE((token[2]))) {
       token += 2;
-      material.ior = parseFloat(&token);
+      material.ior = parseFloat(&token, line_end);
       continue;
     }
 
@@ -746,7 +623,7 @@ static int tinyobj_parse_and_index_mtl_file(tinyobj_material_t **materials_out,
     if (token[0] == 'K' && token[1] == 'e' && IS_SPACE(token[2])) {
       float r, g, b;
       token += 2;
-      parseFloat3(&r, &g, &b, &token);
+      parseFloat3(&r, &g, &b, &token, line_end);
       material.emission[0] = r;
       material.emission[1] = g;
       material.emission[2] = b;
@@ -756,27 +633,27 @@ static int tinyobj_parse_and_index_mtl_file(tinyobj_material_t **materials_out,
     /* shininess */
     if (token[0] == 'N' && token[1] == 's' && IS_SPACE(token[2])) {
       token += 2;
-      material.shininess = parseFloat(&token);
+      material.shininess = parseFloat(&token, line_end);
       continue;
     }
 
     /* illum model */
     if (0 == strncmp(token, "illum", 5) && IS_SPACE(token[5])) {
       token += 6;
-      material.illum = parseInt(&token);
+      material.illum = parseInt(&token, line_end);
       continue;
     }
 
     /* dissolve */
     if ((token[0] == 'd' && IS_SPACE(token[1]))) {
       token += 1;
-      material.dissolve = parseFloat(&token);
+      material.dissolve = parseFloat(&token, line_end);
       continue;
     }
     if (token[0] == 'T' && token[1] == 'r' && IS_SPACE(token[2])) {
       token += 2;
       /* Invert value of Tr(assume Tr is in range [0, 1]) */
-      material.dissolve = 1.0f - parseFloat(&token);
+      material.dissolve = 1.0f - parseFloat(&token, line_end);
       continue;
     }
 
@@ -848,13 +725,39 @@ static int tinyobj_parse_and_index_mtl_file(tinyobj_material_t **materials_out,
   (*num_materials_out) = num_materials;
   (*materials_out) = materials;
 
-  if (linebuf) {
-    TINYOBJ_FREE(linebuf);
+  line_reader_free(&reader);
+
+  return TINYOBJ_SUCCESS;
+}
+
+static int tinyobj_parse_and_index_mtl_file(tinyobj_material_t **materials_out,
+                                            size_t *num_materials_out,
+                                            const char *filename,
+                                            hash_table_t* material_table) {
+  VFile_Handle fileHandle;
+  int ret;
+
+  if (materials_out == NULL) {
+    return TINYOBJ_ERROR_INVALID_PARAMETER;
   }
 
-  VFile_Close(fileHandle);
+  if (num_materials_out == NULL) {
+    return TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
 
-  return TINYOBJ_SUCCESS;
+  (*materials_out) = NULL;
+  (*num_materials_out) = 0;
+
+  // try absolute load
+  fileHandle = VFile_FromFile(filename, Os_FM_Read);
+  if (!fileHandle) {
+    LOGWARNINGF("TINYOBJ: Error reading file '%s'", filename);
+    return TINYOBJ_ERROR_FILE_OPERATION;
+  }
+
+  ret = tinyobj_parse_and_index_mtl_vfile(materials_out, num_materials_out, fileHandle, material_table);
+  VFile_Close(fileHandle);
+  return ret;
 }
 
 int tinyobj_parse_mtl_file(tinyobj_material_t **materials_out,
@@ -863,6 +766,12 @@ int tinyobj_parse_mtl_file(tinyobj_material_t **materials_out,
   return tinyobj_parse_and_index_mtl_file(materials_out, num_materials_out, filename, NULL);
 }
 
+int tinyobj_parse_mtl_vfile(tinyobj_material_t **materials_out,
+                            size_t *num_materials_out,
+                            VFile_Handle handle) {
+  return tinyobj_parse_and_index_mtl_vfile(materials_out, num_materials_out, handle, NULL);
+}
+
 
 typedef enum {
   COMMAND_EMPTY,
@@ -911,6 +820,7 @@ static int parseLine(Command *command, const char *p, size_t p_len,
                      int triangulate) {
   char linebuf[4096];
   const char *token;
+  const char *line_end = linebuf + p_len;
   ASSERT(p_len < 4095);
 
   memcpy(linebuf, p, p_len);
@@ -936,7 +846,7 @@ static int parseLine(Command *command, const char *p, size_t p_len,
   if (token[0] == 'v' && IS_SPACE((token[1]))) {
     float x, y, z;
     token += 2;
-    parseFloat3(&x, &y, &z, &token);
+    parseFloat3(&x, &y, &z, &token, line_end);
     command->vx = x;
     command->vy = y;
     command->vz = z;
@@ -948,7 +858,7 @@ static int parseLine(Command *command, const char *p, size_t p_len,
   if (token[0] == 'v' && token[1] == 'n' && IS_SPACE((token[2]))) {
     float x, y, z;
     token += 3;
-    parseFloat3(&x, &y, &z, &token);
+    parseFloat3(&x, &y, &z, &token, line_end);
     command->nx = x;
     command->ny = y;
     command->nz = z;
@@ -960,7 +870,7 @@ static int parseLine(Command *command, const char *p, size_t p_len,
   if (token[0] == 'v' && token[1] == 't' && IS_SPACE((token[2]))) {
     float x, y;
     token += 3;
-    parseFloat2(&x, &y, &token);
+    parseFloat2(&x, &y, &token, line_end);
     command->tx = x;
     command->ty = y;
     command->type = COMMAND_VT;
@@ -976,7 +886,7 @@ static int parseLine(Command *command, const char *p, size_t p_len,
     skip_space(&token);
 
     while (!IS_NEW_LINE(token[0])) {
-      tinyobj_vertex_index_t vi = parseRawTriple(&token);
+      tinyobj_vertex_index_t vi = parseRawTriple(&token, line_end);
       skip_space_and_cr(&token);
 
       f[num_f] = vi;
@@ -1082,11 +992,6 @@ static int parseLine(Command *command, const char *p, size_t p_len,
   return 0;
 }
 
-typedef struct {
-  size_t pos;
-  size_t len;
-} LineInfo;
-
 static int is_line_ending(const char *p, size_t i, size_t end_i) {
   if (p[i] == '\0') return 1;
   if (p[i] == '\n') return 1; /* this includes \r\n */
@@ -1098,13 +1003,302 @@ static int is_line_ending(const char *p, size_t i, size_t end_i) {
   return 0;
 }
 
+/* A run of whole lines of the buffer that is parsed on its own into its own
+ * commands, so chunks can be parsed on different threads. Counts are for the
+ * chunk alone, the bases are where its data starts in the output arrays */
+typedef struct {
+  size_t start;
+  size_t end;
+
+  Command *commands; /* only lines that produced a command */
+  size_t num_commands;
+
+  size_t num_v;
+  size_t num_vn;
+  size_t num_vt;
+  size_t num_f;
+  size_t num_faces;
+
+  size_t base_v;
+  size_t base_vn;
+  size_t base_vt;
+  size_t base_f;
+  size_t base_faces;
+
+  int mtllib_index;  /* last mtllib command in the chunk or -1 */
+  int usemtl_index;  /* last usemtl command in the chunk or -1 */
+  int material_id;   /* material in use at the start of the chunk */
+  int pad0;
+} ObjChunk;
+
+typedef struct {
+  const char *buf;
+  size_t len;
+  unsigned int flags;
+  int pad0;
+  ObjChunk *chunks;
+  tinyobj_attrib_t *attrib;
+  hash_table_t *material_table;
+} ObjParseJob;
+
+/* chunks smaller than this aren't worth a task of their own */
+#define TINYOBJ_MIN_CHUNK_SIZE (1024 * 1024)
+
+/* null terminated copy of a usemtl command's material name, without the
+ * \r of a \r\n line ending or trailing space */
+static char *material_name_dup(const Command *command) {
+  size_t len = command->material_name_len;
+  char *material_name_null_term = (char *) TINYOBJ_MALLOC(len + 1);
+  memcpy((void *) material_name_null_term, (const void *) command->material_name, len);
+  while (len > 0 && (IS_SPACE(material_name_null_term[len - 1]) || material_name_null_term[len - 1] == '\r')) {
+    len--;
+  }
+  material_name_null_term[len] = 0;
+  return material_name_null_term;
+}
+
+static int lookup_material_id(const Command *command, hash_table_t *material_table, int material_id) {
+  if (command->material_name &&
+      command->material_name_len > 0) {
+    /* Create a null terminated string */
+    char *material_name_null_term = material_name_dup(command);
+
+    if (hash_table_exists(material_name_null_term, material_table))
+      material_id = (int) hash_table_get(material_name_null_term, material_table);
+    else
+      material_id = -1;
+
+    TINYOBJ_FREE(material_name_null_term);
+  }
+  return material_id;
+}
+
+/* Split the buffer into chunks of whole lines, a few per thread so uneven
+ * chunks balance out */
+static ObjChunk *split_chunks(const char *buf, size_t len, unsigned int flags, size_t *num_chunks_out) {
+  ObjChunk *chunks;
+  size_t num_chunks = 1;
+  size_t c;
+  size_t start = 0;
+
+  if (flags & TINYOBJ_FLAG_PARALLEL) {
+    size_t const max_chunks = 4 * ((size_t) Os_ThreadPoolWorkerCount(Os_ThreadPoolGlobal()) + 1);
+    num_chunks = len / TINYOBJ_MIN_CHUNK_SIZE;
+    if (num_chunks > max_chunks) num_chunks = max_chunks;
+    if (num_chunks < 1) num_chunks = 1;
+  }
+  chunks = (ObjChunk *) TINYOBJ_CALLOC(num_chunks, sizeof(ObjChunk));
+  for (c = 0; c < num_chunks; c++) {
+    size_t end = len;
+    if (c + 1 < num_chunks) {
+      end = (len / num_chunks) * (c + 1);
+      if (end < start) end = start;
+      while (end < len && !is_line_ending(buf, end, len)) {
+        end++;
+      }
+      if (end < len) end++; /* keep the line ending in this chunk */
+    }
+    chunks[c].start = start;
+    chunks[c].end = end;
+    chunks[c].mtllib_index = -1;
+    chunks[c].usemtl_index = -1;
+    start = end;
+  }
+
+  *num_chunks_out = num_chunks;
+  return chunks;
+}
+
+/* An 'o' or 'g' command and the number of 'f' lines before it */
+typedef struct {
+  const char *name;
+  unsigned int name_len;
+  unsigned int face_count;
+} ShapeEvent;
+
+/* 4. Construct shape information from the 'o' and 'g' commands */
+static size_t build_shapes(tinyobj_shape_t **shapes, const ShapeEvent *events, size_t num_events,
+                           unsigned int face_count) {
+  size_t e;
+  size_t shape_idx = 0;
+
+  const char *prev_shape_name = NULL;
+  unsigned int prev_shape_name_len = 0;
+  unsigned int prev_shape_face_offset = 0;
+  unsigned int prev_face_offset = 0;
+  tinyobj_shape_t prev_shape = {NULL, 0, 0};
+
+  /* Allocate array of shapes with maximum possible size(+1 for unnamed
+   * group/object).
+   * Actual # of shapes found in .obj is determined in the later */
+  (*shapes) = (tinyobj_shape_t*)TINYOBJ_MALLOC(sizeof(tinyobj_shape_t) * (num_events + 1));
+
+  for (e = 0; e < num_events; e++) {
+    const char *shape_name = events[e].name;
+    unsigned int shape_name_len = events[e].name_len;
+    unsigned int event_face_count = events[e].face_count;
+
+    if (event_face_count == 0) {
+      /* 'o' or 'g' appears before any 'f' */
+      prev_shape_name = shape_name;
+      prev_shape_name_len = shape_name_len;
+      prev_shape_face_offset = event_face_count;
+      prev_face_offset = event_face_count;
+    } else {
+      if (shape_idx == 0) {
+        /* 'o' or 'g' after some 'v' lines. */
+        (*shapes)[shape_idx].name = my_strndup(
+                                               prev_shape_name, prev_shape_name_len); /* may be NULL */
+        (*shapes)[shape_idx].face_offset = prev_shape.face_offset;
+        (*shapes)[shape_idx].length = event_face_count - prev_face_offset;
+        shape_idx++;
+
+        prev_face_offset = event_face_count;
+
+      } else {
+        if ((event_face_count - prev_face_offset) > 0) {
+          (*shapes)[shape_idx].name =
+            my_strndup(prev_shape_name, prev_shape_name_len);
+          (*shapes)[shape_idx].face_offset = prev_face_offset;
+          (*shapes)[shape_idx].length = event_face_count - prev_face_offset;
+          shape_idx++;
+          prev_face_offset = event_face_count;
+        }
+      }
+
+      /* Record shape info for succeeding 'o' or 'g' command. */
+      prev_shape_name = shape_name;
+      prev_shape_name_len = shape_name_len;
+      prev_shape_face_offset = event_face_count;
+    }
+  }
+
+  if ((face_count - prev_face_offset) > 0) {
+    size_t length = face_count - prev_shape_face_offset;
+    if (length > 0) {
+      (*shapes)[shape_idx].name =
+        my_strndup(prev_shape_name, prev_shape_name_len);
+      (*shapes)[shape_idx].face_offset = prev_face_offset;
+      (*shapes)[shape_idx].length = face_count - prev_face_offset;
+      shape_idx++;
+    }
+  } else {
+    /* Guess no 'v' line occurrence after 'o' or 'g', so discards current
+     * shape information. */
+  }
+
+  return shape_idx;
+}
+
+/* 1. Find the lines of a chunk and parse each into a command */
+static void parse_chunk(void *data, uint32_t index) {
+  ObjParseJob *job = (ObjParseJob *) data;
+  ObjChunk *chunk = &job->chunks[index];
+  size_t num_lines = 0;
+  size_t prev_pos = chunk->start;
+  size_t i;
+
+  for (i = chunk->start; i < chunk->end; i++) {
+    if (is_line_ending(job->buf, i, job->len)) {
+      num_lines++;
+    }
+  }
+  /* The last char may not be a line ending */
+  num_lines++;
+
+  chunk->commands = (Command *) TINYOBJ_MALLOC(sizeof(Command) * num_lines);
+
+  for (i = chunk->start; i <= chunk->end; i++) {
+    Command *command;
+    if (i < chunk->end && !is_line_ending(job->buf, i, job->len)) {
+      continue;
+    }
+    if (i == prev_pos) {
+      prev_pos = i + 1;
+      continue;
+    }
+
+    command = &chunk->commands[chunk->num_commands];
+    if (parseLine(command, &job->buf[prev_pos], i - prev_pos, job->flags & TINYOBJ_FLAG_TRIANGULATE)) {
+      if (command->type == COMMAND_V) {
+        chunk->num_v++;
+      } else if (command->type == COMMAND_VN) {
+        chunk->num_vn++;
+      } else if (command->type == COMMAND_VT) {
+        chunk->num_vt++;
+      } else if (command->type == COMMAND_F) {
+        chunk->num_f += command->num_f;
+        chunk->num_faces += command->num_f_num_verts;
+      } else if (command->type == COMMAND_MTLLIB) {
+        chunk->mtllib_index = (int) chunk->num_commands;
+      } else if (command->type == COMMAND_USEMTL) {
+        chunk->usemtl_index = (int) chunk->num_commands;
+      }
+      chunk->num_commands++;
+    }
+    prev_pos = i + 1;
+  }
+}
+
+/* 3. Copy a chunks commands into its place in the attributes */
+static void fill_chunk(void *data, uint32_t index) {
+  ObjParseJob *job = (ObjParseJob *) data;
+  ObjChunk const *chunk = &job->chunks[index];
+  tinyobj_attrib_t *attrib = job->attrib;
+  size_t v_count = chunk->base_v;
+  size_t n_count = chunk->base_vn;
+  size_t t_count = chunk->base_vt;
+  size_t f_count = chunk->base_f;
+  size_t face_count = chunk->base_faces;
+  int material_id = chunk->material_id;
+  size_t i;
+
+  for (i = 0; i < chunk->num_commands; i++) {
+    Command const *command = &chunk->commands[i];
+    if (command->type == COMMAND_USEMTL) {
+      material_id = lookup_material_id(command, job->material_table, material_id);
+    } else if (command->type == COMMAND_V) {
+      attrib->vertices[3 * v_count + 0] = command->vx;
+      attrib->vertices[3 * v_count + 1] = command->vy;
+      attrib->vertices[3 * v_count + 2] = command->vz;
+      v_count++;
+    } else if (command->type == COMMAND_VN) {
+      attrib->normals[3 * n_count + 0] = command->nx;
+      attrib->normals[3 * n_count + 1] = command->ny;
+      attrib->normals[3 * n_count + 2] = command->nz;
+      n_count++;
+    } else if (command->type == COMMAND_VT) {
+      attrib->texcoords[2 * t_count + 0] = command->tx;
+      attrib->texcoords[2 * t_count + 1] = command->ty;
+      t_count++;
+    } else if (command->type == COMMAND_F) {
+      size_t k = 0;
+      /* relative indices are against the counts so far in the whole file */
+      for (k = 0; k < command->num_f; k++) {
+        tinyobj_vertex_index_t vi = command->f[k];
+        attrib->faces[f_count + k].v_idx = fixIndex(vi.v_idx, v_count);
+        attrib->faces[f_count + k].vn_idx = fixIndex(vi.vn_idx, n_count);
+        attrib->faces[f_count + k].vt_idx = fixIndex(vi.vt_idx, t_count);
+      }
+
+      for (k = 0; k < command->num_f_num_verts; k++) {
+        attrib->material_ids[face_count + k] = material_id;
+        attrib->face_num_verts[face_count + k] = command->f_num_verts[k];
+      }
+
+      f_count += command->num_f;
+      face_count += command->num_f_num_verts;
+    }
+  }
+}
+
 int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
                       size_t *num_shapes, tinyobj_material_t **materials_out,
                       size_t *num_materials_out, const char *buf, size_t len,
                       unsigned int flags) {
-  LineInfo *line_infos = NULL;
-  Command *commands = NULL;
-  size_t num_lines = 0;
+  ObjChunk *chunks = NULL;
+  size_t num_chunks = 1;
+  ObjParseJob job;
 
   size_t num_v = 0;
   size_t num_vn = 0;
@@ -1112,8 +1306,6 @@ int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
   size_t num_f = 0;
   size_t num_faces = 0;
 
-  int mtllib_line_index = -1;
-
   tinyobj_material_t *materials = NULL;
   size_t num_materials = 0;
 
@@ -1128,296 +1320,527 @@ int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
   if (num_materials_out == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
 
   tinyobj_attrib_init(attrib);
-   /* 1. Find '\n' and create line data. */
+
+  chunks = split_chunks(buf, len, flags, &num_chunks);
+  job.buf = buf;
+  job.len = len;
+  job.flags = flags;
+  job.chunks = chunks;
+  job.attrib = attrib;
+  job.material_table = &material_table;
+
+  /* 1. parse each line */
+  if (num_chunks > 1) {
+    Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &parse_chunk, &job, (uint32_t) num_chunks);
+  } else {
+    parse_chunk(&job, 0);
+  }
+
+  /* 2. Place each chunk in the output arrays */
   {
-    size_t i;
-    size_t end_idx = len;
-    size_t prev_pos = 0;
-    size_t line_no = 0;
-    size_t last_line_ending = 0;
-
-    /* Count # of lines. */
-    for (i = 0; i < end_idx; i++) {
-      if (is_line_ending(buf, i, end_idx)) {
-        num_lines++;
-        last_line_ending = i;
-      }
+    size_t c;
+    for (c = 0; c < num_chunks; c++) {
+      chunks[c].base_v = num_v;
+      chunks[c].base_vn = num_vn;
+      chunks[c].base_vt = num_vt;
+      chunks[c].base_f = num_f;
+      chunks[c].base_faces = num_faces;
+      num_v += chunks[c].num_v;
+      num_vn += chunks[c].num_vn;
+      num_vt += chunks[c].num_vt;
+      num_f += chunks[c].num_f;
+      num_faces += chunks[c].num_faces;
     }
-    /* The last char from the input may not be a line
-     * ending character so add an extra line if there
-     * are more characters after the last line ending
-     * that was found. */
-    if (end_idx - last_line_ending > 0) {
-        num_lines++;
+  }
+
+  create_hash_table(HASH_TABLE_DEFAULT_SIZE, &material_table);
+
+  /* Load material(if exits), the last mtllib wins */
+  {
+    Command const *mtllib = NULL;
+    size_t c;
+    for (c = 0; c < num_chunks; c++) {
+      if (chunks[c].mtllib_index >= 0) {
+        mtllib = &chunks[c].commands[chunks[c].mtllib_index];
+      }
     }
 
-    if (num_lines == 0) return TINYOBJ_ERROR_EMPTY;
+    if (mtllib && mtllib->mtllib_name && mtllib->mtllib_name_len > 0) {
+      char *filename = my_strndup(mtllib->mtllib_name, mtllib->mtllib_name_len);
 
-    line_infos = (LineInfo *)TINYOBJ_MALLOC(sizeof(LineInfo) * num_lines);
+      int ret = tinyobj_parse_and_index_mtl_file(&materials, &num_materials, filename, &material_table);
 
-    /* Fill line infos. */
-    for (i = 0; i < end_idx; i++) {
-      if (is_line_ending(buf, i, end_idx)) {
-        line_infos[line_no].pos = prev_pos;
-        line_infos[line_no].len = i - prev_pos;
-        prev_pos = i + 1;
-        line_no++;
+      if (ret != TINYOBJ_SUCCESS) {
+        /* warning. */
+        LOGWARNINGF("TINYOBJ: Failed to parse material file '%s': %d\n", filename, ret);
       }
-    }
-    if (end_idx - last_line_ending > 0) {
-      line_infos[line_no].pos = prev_pos;
-      line_infos[line_no].len = end_idx - 1 - last_line_ending;
+
+      TINYOBJ_FREE(filename);
     }
   }
 
-  commands = (Command *)TINYOBJ_MALLOC(sizeof(Command) * num_lines);
+  /* the material at the start of a chunk is from the last usemtl before it */
+  {
+    int material_id = -1; /* -1 = default unknown material. */
+    size_t c;
+    for (c = 0; c < num_chunks; c++) {
+      chunks[c].material_id = material_id;
+      if (chunks[c].usemtl_index >= 0) {
+        material_id = lookup_material_id(&chunks[c].commands[chunks[c].usemtl_index],
+                                         &material_table, material_id);
+      }
+    }
+  }
 
-  create_hash_table(HASH_TABLE_DEFAULT_SIZE, &material_table);
+  /* 3. Construct attributes */
+  attrib->vertices = (float *)TINYOBJ_MALLOC(sizeof(float) * num_v * 3);
+  attrib->num_vertices = (unsigned int)num_v;
+  attrib->normals = (float *)TINYOBJ_MALLOC(sizeof(float) * num_vn * 3);
+  attrib->num_normals = (unsigned int)num_vn;
+  attrib->texcoords = (float *)TINYOBJ_MALLOC(sizeof(float) * num_vt * 2);
+  attrib->num_texcoords = (unsigned int)num_vt;
+  attrib->faces = (tinyobj_vertex_index_t *)TINYOBJ_MALLOC(
+                                                   sizeof(tinyobj_vertex_index_t) * num_f);
+  attrib->num_faces = (unsigned int)num_f;
+  attrib->face_num_verts = (int *)TINYOBJ_MALLOC(sizeof(int) * num_faces);
+  attrib->material_ids = (int *)TINYOBJ_MALLOC(sizeof(int) * num_faces);
+  attrib->num_face_num_verts = (unsigned int)num_faces;
+
+  if (num_chunks > 1) {
+    Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &fill_chunk, &job, (uint32_t) num_chunks);
+  } else {
+    fill_chunk(&job, 0);
+  }
 
-  /* 2. parse each line */
+  /* 4. Construct shape information. */
   {
-    size_t i = 0;
-    for (i = 0; i < num_lines; i++) {
-      int ret = parseLine(&commands[i], &buf[line_infos[i].pos],
-                          line_infos[i].len, flags & TINYOBJ_FLAG_TRIANGULATE);
-      if (ret) {
-        if (commands[i].type == COMMAND_V) {
-          num_v++;
-        } else if (commands[i].type == COMMAND_VN) {
-          num_vn++;
-        } else if (commands[i].type == COMMAND_VT) {
-          num_vt++;
-        } else if (commands[i].type == COMMAND_F) {
-          num_f += commands[i].num_f;
-          num_faces += commands[i].num_f_num_verts;
+    ShapeEvent *events = NULL;
+    size_t num_events = 0;
+    unsigned int face_count = 0;
+    size_t c;
+    size_t i;
+
+    /* Find the number of shapes in .obj */
+    for (c = 0; c < num_chunks; c++) {
+      for (i = 0; i < chunks[c].num_commands; i++) {
+        if (chunks[c].commands[i].type == COMMAND_O || chunks[c].commands[i].type == COMMAND_G) {
+          num_events++;
         }
+      }
+    }
 
-        if (commands[i].type == COMMAND_MTLLIB) {
-          mtllib_line_index = (int)i;
+    events = (ShapeEvent *) TINYOBJ_MALLOC(sizeof(ShapeEvent) * (num_events + 1));
+    num_events = 0;
+    for (c = 0; c < num_chunks; c++) {
+      for (i = 0; i < chunks[c].num_commands; i++) {
+        Command const *command = &chunks[c].commands[i];
+        if (command->type == COMMAND_O) {
+          events[num_events].name = command->object_name;
+          events[num_events].name_len = command->object_name_len;
+          events[num_events++].face_count = face_count;
+        } else if (command->type == COMMAND_G) {
+          events[num_events].name = command->group_name;
+          events[num_events].name_len = command->group_name_len;
+          events[num_events++].face_count = face_count;
+        } else if (command->type == COMMAND_F) {
+          face_count++;
         }
       }
     }
+
+    (*num_shapes) = build_shapes(shapes, events, num_events, face_count);
+    TINYOBJ_FREE(events);
   }
 
-  /* line_infos are not used anymore. Release memory. */
-  if (line_infos) {
-    TINYOBJ_FREE(line_infos);
+  {
+    size_t c;
+    for (c = 0; c < num_chunks; c++) {
+      if (chunks[c].commands) {
+        TINYOBJ_FREE(chunks[c].commands);
+      }
+    }
+    TINYOBJ_FREE(chunks);
   }
 
-  /* Load material(if exits) */
-  if (mtllib_line_index >= 0 && commands[mtllib_line_index].mtllib_name &&
-      commands[mtllib_line_index].mtllib_name_len > 0) {
-    char *filename = my_strndup(commands[mtllib_line_index].mtllib_name,
-                                commands[mtllib_line_index].mtllib_name_len);
+  destroy_hash_table(&material_table);
 
-    int ret = tinyobj_parse_and_index_mtl_file(&materials, &num_materials, filename, &material_table);
+  (*materials_out) = materials;
+  (*num_materials_out) = num_materials;
 
-    if (ret != TINYOBJ_SUCCESS) {
-      /* warning. */
-      LOGWARNINGF("TINYOBJ: Failed to parse material file '%s': %d\n", filename, ret);
-    }
+  return TINYOBJ_SUCCESS;
+}
+
+/* State of a streamed parse. Each window of whole lines is parsed while the
+ * next window is read, the outputs grow as windows are added */
+typedef struct {
+  VFile_Handle handle;
+  unsigned int flags;
+  int material_id; /* usemtl name index in use after the last window */
+
+  /* read side, the partial line left over is copied to the front */
+  char *read_buf;
+  const char *tail_src;
+  size_t tail;
+  size_t window_size;
+  size_t read_len;
+
+  /* parse side, names may run up to buf_end (the partial line and a '\0') */
+  const char *parse_buf;
+  size_t parse_len;
+  const char *buf_end;
+
+  tinyobj_attrib_t *attrib;
+  size_t num_v, num_vn, num_vt, num_f, num_faces;
+  size_t cap_v, cap_vn, cap_vt, cap_f, cap_face_num_verts, cap_material_ids;
+  unsigned int num_f_lines; /* 'f' commands, shapes count these */
+  int out_of_memory;
+
+  /* material_ids hold usemtl name indices until the mtl file is loaded */
+  hash_table_t name_table;
+  char **names;
+  size_t num_names;
+
+  ShapeEvent *events;
+  size_t num_events;
+  size_t cap_events;
+
+  char *mtllib_name; /* the last mtllib wins */
+  unsigned int mtllib_name_len;
+  int pad0;
+} ObjStream;
+
+static int grow_array(void **array, size_t *capacity, size_t needed, size_t element_size) {
+  void *grown;
+  size_t new_capacity;
+  if (needed <= *capacity) return 1;
+  new_capacity = *capacity ? *capacity : 1024;
+  while (new_capacity < needed) new_capacity *= 2;
+  grown = TINYOBJ_REALLOC(*array, new_capacity * element_size);
+  if (grown == NULL) return 0;
+  *array = grown;
+  *capacity = new_capacity;
+  return 1;
+}
 
-    TINYOBJ_FREE(filename);
+/* gives back the slack grow_array leaves, keeping the array if that fails */
+static void shrink_array(void **array, size_t count, size_t element_size) {
+  void *shrunk;
+  if (*array == NULL || count == 0) return;
+  shrunk = TINYOBJ_REALLOC(*array, count * element_size);
+  if (shrunk) *array = shrunk;
+}
 
+/* copy of a name in the window, names are only valid while the window is */
+static char *window_name_dup(const char *name, unsigned int len, const char *buf_end) {
+  size_t const avail = (size_t) (buf_end - name);
+  size_t const n = len < avail ? len : avail;
+  char *d = (char *) TINYOBJ_MALLOC((size_t) len + 1);
+  memcpy(d, name, n);
+  memset(d + n, 0, (size_t) len + 1 - n);
+  return d;
+}
+
+/* the end of the last whole line in the buffer, 0 if there isn't one */
+static size_t last_line_end(const char *buf, size_t len) {
+  size_t i = len;
+  while (i > 0) {
+    i--;
+    if (buf[i] == '\n') return i + 1;
+    /* a lone \r ends a line, a \r at the end may be followed by a \n */
+    if (buf[i] == '\r' && i + 1 < len && buf[i + 1] != '\n') return i + 1;
   }
+  return 0;
+}
 
-  /* Construct attributes */
+static void stream_parse_window(ObjStream *stream) {
+  ObjParseJob job;
+  ObjChunk *chunks;
+  size_t num_chunks = 1;
+  size_t c;
+  size_t i;
+  tinyobj_attrib_t *attrib = stream->attrib;
+
+  chunks = split_chunks(stream->parse_buf, stream->parse_len, stream->flags, &num_chunks);
+  job.buf = stream->parse_buf;
+  job.len = stream->parse_len;
+  job.flags = stream->flags;
+  job.chunks = chunks;
+  job.attrib = attrib;
+  job.material_table = &stream->name_table;
+
+  /* 1. parse each line */
+  if (num_chunks > 1) {
+    Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &parse_chunk, &job, (uint32_t) num_chunks);
+  } else {
+    parse_chunk(&job, 0);
+  }
 
-  {
-    size_t v_count = 0;
-    size_t n_count = 0;
-    size_t t_count = 0;
-    size_t f_count = 0;
-    size_t face_count = 0;
-    int material_id = -1; /* -1 = default unknown material. */
-    size_t i = 0;
-
-    attrib->vertices = (float *)TINYOBJ_MALLOC(sizeof(float) * num_v * 3);
-    attrib->num_vertices = (unsigned int)num_v;
-    attrib->normals = (float *)TINYOBJ_MALLOC(sizeof(float) * num_vn * 3);
-    attrib->num_normals = (unsigned int)num_vn;
-    attrib->texcoords = (float *)TINYOBJ_MALLOC(sizeof(float) * num_vt * 2);
-    attrib->num_texcoords = (unsigned int)num_vt;
-    attrib->faces = (tinyobj_vertex_index_t *)TINYOBJ_MALLOC(
-                                                     sizeof(tinyobj_vertex_index_t) * num_f);
-    attrib->num_faces = (unsigned int)num_f;
-    attrib->face_num_verts = (int *)TINYOBJ_MALLOC(sizeof(int) * num_faces);
-    attrib->material_ids = (int *)TINYOBJ_MALLOC(sizeof(int) * num_faces);
-    attrib->num_face_num_verts = (unsigned int)num_faces;
-
-    for (i = 0; i < num_lines; i++) {
-      if (commands[i].type == COMMAND_EMPTY) {
-        continue;
-      } else if (commands[i].type == COMMAND_USEMTL) {
-        /* @todo
-           if (commands[t][i].material_name &&
-           commands[t][i].material_name_len > 0) {
-           std::string material_name(commands[t][i].material_name,
-           commands[t][i].material_name_len);
-
-           if (material_map.find(material_name) != material_map.end()) {
-           material_id = material_map[material_name];
-           } else {
-        // Assign invalid material ID
-        material_id = -1;
-        }
-        }
-        */
-        if (commands[i].material_name &&
-           commands[i].material_name_len >0)
-        {
-          /* Create a null terminated string */
-          char* material_name_null_term = (char*) TINYOBJ_MALLOC(commands[i].material_name_len + 1);
-          memcpy((void*) material_name_null_term, (const void*) commands[i].material_name, commands[i].material_name_len);
-          material_name_null_term[commands[i].material_name_len - 1] = 0;
-
-          if (hash_table_exists(material_name_null_term, &material_table))
-            material_id = (int)hash_table_get(material_name_null_term, &material_table);
-          else
-            material_id = -1;
-
-          TINYOBJ_FREE(material_name_null_term);
+  /* keep what is needed after the window has gone */
+  for (c = 0; c < num_chunks; c++) {
+    for (i = 0; i < chunks[c].num_commands; i++) {
+      Command const *command = &chunks[c].commands[i];
+      if (command->type == COMMAND_USEMTL && command->material_name && command->material_name_len > 0) {
+        char *name = material_name_dup(command);
+        if (!hash_table_exists(name, &stream->name_table)) {
+          hash_table_set(name, stream->num_names, &stream->name_table);
+          stream->names = (char **) TINYOBJ_REALLOC(stream->names, sizeof(char *) * (stream->num_names + 1));
+          stream->names[stream->num_names++] = name;
+        } else {
+          TINYOBJ_FREE(name);
         }
-      } else if (commands[i].type == COMMAND_V) {
-        attrib->vertices[3 * v_count + 0] = commands[i].vx;
-        attrib->vertices[3 * v_count + 1] = commands[i].vy;
-        attrib->vertices[3 * v_count + 2] = commands[i].vz;
-        v_count++;
-      } else if (commands[i].type == COMMAND_VN) {
-        attrib->normals[3 * n_count + 0] = commands[i].nx;
-        attrib->normals[3 * n_count + 1] = commands[i].ny;
-        attrib->normals[3 * n_count + 2] = commands[i].nz;
-        n_count++;
-      } else if (commands[i].type == COMMAND_VT) {
-        attrib->texcoords[2 * t_count + 0] = commands[i].tx;
-        attrib->texcoords[2 * t_count + 1] = commands[i].ty;
-        t_count++;
-      } else if (commands[i].type == COMMAND_F) {
-        size_t k = 0;
-        for (k = 0; k < commands[i].num_f; k++) {
-          tinyobj_vertex_index_t vi = commands[i].f[k];
-          int v_idx = fixIndex(vi.v_idx, v_count);
-          int vn_idx = fixIndex(vi.vn_idx, n_count);
-          int vt_idx = fixIndex(vi.vt_idx, t_count);
-          attrib->faces[f_count + k].v_idx = v_idx;
-          attrib->faces[f_count + k].vn_idx = vn_idx;
-          attrib->faces[f_count + k].vt_idx = vt_idx;
+      } else if (command->type == COMMAND_MTLLIB && command->mtllib_name) {
+        TINYOBJ_FREE(stream->mtllib_name);
+        stream->mtllib_name = window_name_dup(command->mtllib_name, command->mtllib_name_len, stream->buf_end);
+        stream->mtllib_name_len = command->mtllib_name_len;
+      } else if (command->type == COMMAND_O || command->type == COMMAND_G) {
+        ShapeEvent *event;
+        if (!grow_array((void **) &stream->events, &stream->cap_events, stream->num_events + 1, sizeof(ShapeEvent))) {
+          stream->out_of_memory = 1;
+          continue;
         }
-
-        for (k = 0; k < commands[i].num_f_num_verts; k++) {
-          attrib->material_ids[face_count + k] = material_id;
-          attrib->face_num_verts[face_count + k] = commands[i].f_num_verts[k];
+        event = &stream->events[stream->num_events++];
+        if (command->type == COMMAND_O) {
+          event->name = window_name_dup(command->object_name, command->object_name_len, stream->buf_end);
+          event->name_len = command->object_name_len;
+        } else {
+          event->name = window_name_dup(command->group_name, command->group_name_len, stream->buf_end);
+          event->name_len = command->group_name_len;
         }
-
-        f_count += commands[i].num_f;
-        face_count += commands[i].num_f_num_verts;
+        event->face_count = stream->num_f_lines;
+      } else if (command->type == COMMAND_F) {
+        stream->num_f_lines++;
       }
     }
   }
 
-  /* 5. Construct shape information. */
-  {
-    unsigned int face_count = 0;
-    size_t i = 0;
-    size_t n = 0;
-    size_t shape_idx = 0;
-
-    const char *shape_name = NULL;
-    unsigned int shape_name_len = 0;
-    const char *prev_shape_name = NULL;
-    unsigned int prev_shape_name_len = 0;
-    unsigned int prev_shape_face_offset = 0;
-    unsigned int prev_face_offset = 0;
-    tinyobj_shape_t prev_shape = {NULL, 0, 0};
+  /* 2. Place each chunk after the data so far */
+  for (c = 0; c < num_chunks; c++) {
+    chunks[c].base_v = stream->num_v;
+    chunks[c].base_vn = stream->num_vn;
+    chunks[c].base_vt = stream->num_vt;
+    chunks[c].base_f = stream->num_f;
+    chunks[c].base_faces = stream->num_faces;
+    stream->num_v += chunks[c].num_v;
+    stream->num_vn += chunks[c].num_vn;
+    stream->num_vt += chunks[c].num_vt;
+    stream->num_f += chunks[c].num_f;
+    stream->num_faces += chunks[c].num_faces;
+
+    chunks[c].material_id = stream->material_id;
+    if (chunks[c].usemtl_index >= 0) {
+      stream->material_id = lookup_material_id(&chunks[c].commands[chunks[c].usemtl_index],
+                                               &stream->name_table, stream->material_id);
+    }
+  }
 
-    /* Find the number of shapes in .obj */
-    for (i = 0; i < num_lines; i++) {
-      if (commands[i].type == COMMAND_O || commands[i].type == COMMAND_G) {
-        n++;
-      }
+  if (!grow_array((void **) &attrib->vertices, &stream->cap_v, stream->num_v * 3, sizeof(float)) ||
+      !grow_array((void **) &attrib->normals, &stream->cap_vn, stream->num_vn * 3, sizeof(float)) ||
+      !grow_array((void **) &attrib->texcoords, &stream->cap_vt, stream->num_vt * 2, sizeof(float)) ||
+      !grow_array((void **) &attrib->faces, &stream->cap_f, stream->num_f, sizeof(tinyobj_vertex_index_t)) ||
+      !grow_array((void **) &attrib->face_num_verts, &stream->cap_face_num_verts, stream->num_faces, sizeof(int)) ||
+      !grow_array((void **) &attrib->material_ids, &stream->cap_material_ids, stream->num_faces, sizeof(int))) {
+    stream->out_of_memory = 1;
+  } else if (num_chunks > 1) {
+    /* 3. Copy the commands into the attributes */
+    Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &fill_chunk, &job, (uint32_t) num_chunks);
+  } else {
+    fill_chunk(&job, 0);
+  }
+
+  for (c = 0; c < num_chunks; c++) {
+    if (chunks[c].commands) {
+      TINYOBJ_FREE(chunks[c].commands);
     }
+  }
+  TINYOBJ_FREE(chunks);
+}
 
-    /* Allocate array of shapes with maximum possible size(+1 for unnamed
-     * group/object).
-     * Actual # of shapes found in .obj is determined in the later */
-    (*shapes) = (tinyobj_shape_t*)TINYOBJ_MALLOC(sizeof(tinyobj_shape_t) * (n + 1));
+static void stream_read_window(ObjStream *stream) {
+  memcpy(stream->read_buf, stream->tail_src, stream->tail);
+  stream->read_len = VFile_Read(stream->handle, stream->read_buf + stream->tail, stream->window_size);
+}
 
-    for (i = 0; i < num_lines; i++) {
-      if (commands[i].type == COMMAND_O || commands[i].type == COMMAND_G) {
-        if (commands[i].type == COMMAND_O) {
-          shape_name = commands[i].object_name;
-          shape_name_len = commands[i].object_name_len;
-        } else {
-          shape_name = commands[i].group_name;
-          shape_name_len = commands[i].group_name_len;
-        }
+/* reading the next window and parsing this one run side by side */
+static void stream_step(void *data, uint32_t index) {
+  ObjStream *stream = (ObjStream *) data;
+  if (index == 0) {
+    stream_read_window(stream);
+  } else {
+    stream_parse_window(stream);
+  }
+}
 
-        if (face_count == 0) {
-          /* 'o' or 'g' appears before any 'f' */
-          prev_shape_name = shape_name;
-          prev_shape_name_len = shape_name_len;
-          prev_shape_face_offset = face_count;
-          prev_face_offset = face_count;
-        } else {
-          if (shape_idx == 0) {
-            /* 'o' or 'g' after some 'v' lines. */
-            (*shapes)[shape_idx].name = my_strndup(
-                                                   prev_shape_name, prev_shape_name_len); /* may be NULL */
-            (*shapes)[shape_idx].face_offset = prev_shape.face_offset;
-            (*shapes)[shape_idx].length = face_count - prev_face_offset;
-            shape_idx++;
-
-            prev_face_offset = face_count;
-
-          } else {
-            if ((face_count - prev_face_offset) > 0) {
-              (*shapes)[shape_idx].name =
-                my_strndup(prev_shape_name, prev_shape_name_len);
-              (*shapes)[shape_idx].face_offset = prev_face_offset;
-              (*shapes)[shape_idx].length = face_count - prev_face_offset;
-              shape_idx++;
-              prev_face_offset = face_count;
-            }
-          }
-
-          /* Record shape info for succeeding 'o' or 'g' command. */
-          prev_shape_name = shape_name;
-          prev_shape_name_len = shape_name_len;
-          prev_shape_face_offset = face_count;
+/* buffers hold a window after the carried partial line, plus a '\0' */
+static int reserve_window(char **buf, size_t *capacity, size_t needed) {
+  char *grown;
+  if (needed + 1 <= *capacity) return 1;
+  grown = (char *) TINYOBJ_REALLOC(*buf, needed + 1);
+  if (grown == NULL) return 0;
+  *buf = grown;
+  *capacity = needed + 1;
+  return 1;
+}
+
+int tinyobj_parse_obj_vfile(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
+                            size_t *num_shapes, tinyobj_material_t **materials_out,
+                            size_t *num_materials_out, VFile_Handle handle,
+                            size_t window_size, unsigned int flags) {
+  ObjStream stream;
+  char *buffers[2] = {NULL, NULL};
+  size_t capacity[2] = {0, 0};
+  int cur = 0;
+  size_t cur_len = 0;
+  int eof = 0;
+  int ret = TINYOBJ_SUCCESS;
+  size_t i;
+
+  tinyobj_material_t *materials = NULL;
+  size_t num_materials = 0;
+
+  hash_table_t material_table;
+
+  if (attrib == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (shapes == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (num_shapes == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (handle == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (materials_out == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (num_materials_out == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+
+  if (window_size == 0) window_size = TINYOBJ_STREAM_WINDOW_SIZE;
+
+  tinyobj_attrib_init(attrib);
+  memset(&stream, 0, sizeof(ObjStream));
+  stream.handle = handle;
+  stream.flags = flags;
+  stream.material_id = -1; /* -1 = default unknown material. */
+  stream.window_size = window_size;
+  stream.attrib = attrib;
+  create_hash_table(HASH_TABLE_DEFAULT_SIZE, &stream.name_table);
+
+  if (!reserve_window(&buffers[0], &capacity[0], window_size)) {
+    stream.out_of_memory = 1;
+  } else {
+    cur_len = VFile_Read(handle, buffers[0], window_size);
+    eof = cur_len < window_size;
+    if (cur_len == 0) ret = TINYOBJ_ERROR_EMPTY;
+  }
+
+  while (cur_len > 0 && !stream.out_of_memory) {
+    int const next = 1 - cur;
+    size_t split = cur_len;
+
+    buffers[cur][cur_len] = '\0';
+    if (!eof) {
+      split = last_line_end(buffers[cur], cur_len);
+      if (split == 0) {
+        /* a line longer than the window, read more of it */
+        size_t read;
+        if (!reserve_window(&buffers[cur], &capacity[cur], cur_len + window_size)) {
+          stream.out_of_memory = 1;
+          break;
         }
+        read = VFile_Read(handle, buffers[cur] + cur_len, window_size);
+        eof = read < window_size;
+        cur_len += read;
+        continue;
       }
-      if (commands[i].type == COMMAND_F) {
-        face_count++;
+    }
+
+    stream.parse_buf = buffers[cur];
+    stream.parse_len = split;
+    stream.buf_end = buffers[cur] + cur_len + 1;
+    stream.tail_src = buffers[cur] + split;
+    stream.tail = cur_len - split;
+    if (eof) {
+      stream_parse_window(&stream);
+      break;
+    }
+
+    if (!reserve_window(&buffers[next], &capacity[next], stream.tail + window_size)) {
+      stream.out_of_memory = 1;
+      break;
+    }
+    stream.read_buf = buffers[next];
+    Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &stream_step, &stream, 2);
+    eof = stream.read_len < window_size;
+    cur_len = stream.tail + stream.read_len;
+    cur = next;
+  }
+
+  TINYOBJ_FREE(buffers[0]);
+  TINYOBJ_FREE(buffers[1]);
+
+  if (stream.out_of_memory) {
+    LOGERROR("TINYOBJ: Out of memory streaming obj");
+    tinyobj_attrib_free(attrib);
+    ret = TINYOBJ_ERROR_OUT_OF_MEMORY;
+  }
+
+  if (ret == TINYOBJ_SUCCESS) {
+    shrink_array((void **) &attrib->vertices, stream.num_v * 3, sizeof(float));
+    shrink_array((void **) &attrib->normals, stream.num_vn * 3, sizeof(float));
+    shrink_array((void **) &attrib->texcoords, stream.num_vt * 2, sizeof(float));
+    shrink_array((void **) &attrib->faces, stream.num_f, sizeof(tinyobj_vertex_index_t));
+    shrink_array((void **) &attrib->face_num_verts, stream.num_faces, sizeof(int));
+    shrink_array((void **) &attrib->material_ids, stream.num_faces, sizeof(int));
+    attrib->num_vertices = (unsigned int) stream.num_v;
+    attrib->num_normals = (unsigned int) stream.num_vn;
+    attrib->num_texcoords = (unsigned int) stream.num_vt;
+    attrib->num_faces = (unsigned int) stream.num_f;
+    attrib->num_face_num_verts = (unsigned int) stream.num_faces;
+
+    create_hash_table(HASH_TABLE_DEFAULT_SIZE, &material_table);
+
+    /* Load material(if exits) */
+    if (stream.mtllib_name && stream.mtllib_name_len > 0) {
+      char *filename = my_strndup(stream.mtllib_name, stream.mtllib_name_len);
+
+      int mtl_ret = tinyobj_parse_and_index_mtl_file(&materials, &num_materials, filename, &material_table);
+
+      if (mtl_ret != TINYOBJ_SUCCESS) {
+        /* warning. */
+        LOGWARNINGF("TINYOBJ: Failed to parse material file '%s': %d\n", filename, mtl_ret);
       }
+
+      TINYOBJ_FREE(filename);
     }
 
-    if ((face_count - prev_face_offset) > 0) {
-      size_t length = face_count - prev_shape_face_offset;
-      if (length > 0) {
-        (*shapes)[shape_idx].name =
-          my_strndup(prev_shape_name, prev_shape_name_len);
-        (*shapes)[shape_idx].face_offset = prev_face_offset;
-        (*shapes)[shape_idx].length = face_count - prev_face_offset;
-        shape_idx++;
+    /* usemtl name indices to material ids */
+    if (stream.num_names > 0) {
+      int *ids = (int *) TINYOBJ_MALLOC(sizeof(int) * stream.num_names);
+      for (i = 0; i < stream.num_names; i++) {
+        ids[i] = hash_table_exists(stream.names[i], &material_table) ?
+                 (int) hash_table_get(stream.names[i], &material_table) : -1;
       }
-    } else {
-      /* Guess no 'v' line occurrence after 'o' or 'g', so discards current
-       * shape information. */
+      for (i = 0; i < stream.num_faces; i++) {
+        if (attrib->material_ids[i] >= 0) {
+          attrib->material_ids[i] = ids[attrib->material_ids[i]];
+        }
+      }
+      TINYOBJ_FREE(ids);
     }
 
-    (*num_shapes) = shape_idx;
-  }
+    /* 4. Construct shape information. */
+    (*num_shapes) = build_shapes(shapes, stream.events, stream.num_events, stream.num_f_lines);
 
-  if (commands) {
-    TINYOBJ_FREE(commands);
+    destroy_hash_table(&material_table);
   }
 
-  destroy_hash_table(&material_table);
+  for (i = 0; i < stream.num_names; i++) {
+    TINYOBJ_FREE(stream.names[i]);
+  }
+  TINYOBJ_FREE(stream.names);
+  for (i = 0; i < stream.num_events; i++) {
+    TINYOBJ_FREE((void *) stream.events[i].name);
+  }
+  TINYOBJ_FREE(stream.events);
+  TINYOBJ_FREE(stream.mtllib_name);
+  destroy_hash_table(&stream.name_table);
 
   (*materials_out) = materials;
   (*num_materials_out) = num_materials;
 
-  return TINYOBJ_SUCCESS;
+  return ret;
 }
 
 void tinyobj_attrib_init(tinyobj_attrib_t *attrib) {
@@ -0,0 +1,440 @@
+#include "core/core.h"
+#include "core/logger.h"
+#include "syoyo/tiny_objloader.h"
+#include "syoyo/tiny_objmesh.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MESH_NONE (0xFFFFFFFFu)
+
+typedef struct { int v, vt, vn; } MeshKey;
+
+/* scratch for Tipsify, sized for the whole mesh and reused per submesh */
+typedef struct {
+  uint32_t *local;     /* mesh vertex to submesh vertex, MESH_NONE if unused */
+  uint32_t *globals;   /* submesh vertex to mesh vertex */
+  uint32_t *live;      /* triangles not yet emitted per vertex */
+  uint32_t *offsets;   /* start of each vertex's triangles in adjacency */
+  uint32_t *adjacency;
+  uint32_t *stamps;    /* time each vertex last entered the cache */
+  uint32_t *dead_end;  /* stack of recently used vertices */
+  uint32_t *out;
+  uint8_t *emitted;
+} Tipsify;
+
+static int attrib_index(int idx, unsigned int count) {
+  return (idx >= 0 && (unsigned int) idx < count) ? idx : -1;
+}
+
+static MeshKey key_of(tinyobj_attrib_t const *attrib, unsigned int corner) {
+  MeshKey key;
+  tinyobj_vertex_index_t const *vi = &attrib->faces[corner];
+  key.v = attrib_index(vi->v_idx, attrib->num_vertices);
+  key.vt = attrib->num_texcoords ? attrib_index(vi->vt_idx, attrib->num_texcoords) : -1;
+  key.vn = attrib->num_normals ? attrib_index(vi->vn_idx, attrib->num_normals) : -1;
+  return key;
+}
+
+static uint32_t hash_key(MeshKey const *key) {
+  uint32_t h = (uint32_t) key->v * 0x9E3779B1u;
+  h = (h ^ (h >> 15)) + (uint32_t) key->vt * 0x85EBCA77u;
+  h = (h ^ (h >> 13)) + (uint32_t) key->vn * 0xC2B2AE3Du;
+  return h ^ (h >> 16);
+}
+
+/* one vertex per unique key via an open addressed table, returns the number
+ * of vertices or MESH_NONE if out of memory */
+static uint32_t dedup_keys(MeshKey const *keys, uint32_t num_keys, MeshKey *unique, uint32_t *indices) {
+  uint32_t capacity = 16;
+  uint32_t mask;
+  uint32_t count = 0;
+  uint32_t i;
+  uint32_t *table;
+
+  while (capacity < num_keys * 2) capacity *= 2;
+  mask = capacity - 1;
+
+  table = (uint32_t *) malloc(capacity * sizeof(uint32_t));
+  if (!table) return MESH_NONE;
+  memset(table, 0xFF, capacity * sizeof(uint32_t));
+
+  for (i = 0; i < num_keys; i++) {
+    MeshKey const *key = &keys[i];
+    uint32_t slot = hash_key(key) & mask;
+    while (table[slot] != MESH_NONE) {
+      MeshKey const *other = &unique[table[slot]];
+      if (other->v == key->v && other->vt == key->vt && other->vn == key->vn) break;
+      slot = (slot + 1) & mask;
+    }
+    if (table[slot] == MESH_NONE) {
+      table[slot] = count;
+      unique[count++] = *key;
+    }
+    indices[i] = table[slot];
+  }
+
+  free(table);
+  return count;
+}
+
+/* Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality
+ * and Reduced Overdraw". Fans around the vertex that will still be in the
+ * cache, falling back to recently used vertices then the next live one */
+static void tipsify(Tipsify *ts, uint32_t *indices, uint32_t num_tris, uint32_t cache_size) {
+  uint32_t const num_indices = num_tris * 3;
+  uint32_t num_verts = 0;
+  uint32_t time = cache_size + 1;
+  uint32_t dead_top = 0;
+  uint32_t cursor = 0;
+  uint32_t out_count = 0;
+  uint32_t fanning = 0;
+  uint32_t i;
+
+  /* work in submesh local vertices so the scratch only needs clearing for
+   * the vertices this submesh touches */
+  for (i = 0; i < num_indices; i++) {
+    uint32_t g = indices[i];
+    if (ts->local[g] == MESH_NONE) {
+      ts->local[g] = num_verts;
+      ts->globals[num_verts++] = g;
+    }
+    indices[i] = ts->local[g];
+  }
+
+  memset(ts->live, 0, num_verts * sizeof(uint32_t));
+  for (i = 0; i < num_indices; i++) ts->live[indices[i]]++;
+
+  ts->offsets[0] = 0;
+  for (i = 0; i < num_verts; i++) {
+    ts->offsets[i + 1] = ts->offsets[i] + ts->live[i];
+    ts->stamps[i] = ts->offsets[i];
+  }
+  for (i = 0; i < num_indices; i++) ts->adjacency[ts->stamps[indices[i]]++] = i / 3;
+
+  memset(ts->stamps, 0, num_verts * sizeof(uint32_t));
+  memset(ts->emitted, 0, num_tris);
+
+  while (fanning != MESH_NONE) {
+    uint32_t const candidates = dead_top;
+    uint32_t best = MESH_NONE;
+    int best_priority = -1;
+    uint32_t a;
+
+    for (a = ts->offsets[fanning]; a < ts->offsets[fanning + 1]; a++) {
+      uint32_t t = ts->adjacency[a];
+      uint32_t c;
+      if (ts->emitted[t]) continue;
+      for (c = 0; c < 3; c++) {
+        uint32_t v = indices[t * 3 + c];
+        ts->out[out_count++] = v;
+        ts->dead_end[dead_top++] = v;
+        ts->live[v]--;
+        if (time - ts->stamps[v] > cache_size) ts->stamps[v] = time++;
+      }
+      ts->emitted[t] = 1;
+    }
+
+    /* prefer a vertex whose remaining triangles fit before it is evicted */
+    for (a = candidates; a < dead_top; a++) {
+      uint32_t v = ts->dead_end[a];
+      if (ts->live[v] > 0) {
+        int priority = 0;
+        if (time - ts->stamps[v] + 2 * ts->live[v] <= cache_size) priority = (int) (time - ts->stamps[v]);
+        if (priority > best_priority) {
+          best_priority = priority;
+          best = v;
+        }
+      }
+    }
+
+    if (best == MESH_NONE) {
+      while (dead_top > 0) {
+        uint32_t v = ts->dead_end[--dead_top];
+        if (ts->live[v] > 0) {
+          best = v;
+          break;
+        }
+      }
+    }
+    if (best == MESH_NONE) {
+      while (cursor < num_verts && ts->live[cursor] == 0) cursor++;
+      if (cursor < num_verts) best = cursor;
+    }
+    fanning = best;
+  }
+
+  ASSERT(out_count == num_indices);
+  for (i = 0; i < num_indices; i++) indices[i] = ts->globals[ts->out[i]];
+  for (i = 0; i < num_verts; i++) ts->local[ts->globals[i]] = MESH_NONE;
+}
+
+static int optimise_submeshes(tinyobj_mesh_t const *mesh, uint32_t *indices) {
+  uint32_t const num_tris = mesh->num_indices / 3;
+  Tipsify ts;
+  unsigned int s;
+  int ok;
+
+  ts.local = (uint32_t *) malloc(mesh->num_vertices * sizeof(uint32_t));
+  ts.globals = (uint32_t *) malloc(mesh->num_vertices * sizeof(uint32_t));
+  ts.live = (uint32_t *) malloc(mesh->num_vertices * sizeof(uint32_t));
+  ts.offsets = (uint32_t *) malloc((mesh->num_vertices + 1) * sizeof(uint32_t));
+  ts.stamps = (uint32_t *) malloc(mesh->num_vertices * sizeof(uint32_t));
+  ts.adjacency = (uint32_t *) malloc(mesh->num_indices * sizeof(uint32_t));
+  ts.dead_end = (uint32_t *) malloc(mesh->num_indices * sizeof(uint32_t));
+  ts.out = (uint32_t *) malloc(mesh->num_indices * sizeof(uint32_t));
+  ts.emitted = (uint8_t *) malloc(num_tris);
+
+  ok = ts.local && ts.globals && ts.live && ts.offsets && ts.stamps &&
+      ts.adjacency && ts.dead_end && ts.out && ts.emitted;
+  if (ok) {
+    memset(ts.local, 0xFF, mesh->num_vertices * sizeof(uint32_t));
+    for (s = 0; s < mesh->num_submeshes; s++) {
+      tinyobj_submesh_t const *submesh = &mesh->submeshes[s];
+      tipsify(&ts, indices + submesh->index_offset, submesh->index_count / 3, TINYOBJ_MESH_CACHE_SIZE);
+    }
+  }
+
+  free(ts.local);
+  free(ts.globals);
+  free(ts.live);
+  free(ts.offsets);
+  free(ts.stamps);
+  free(ts.adjacency);
+  free(ts.dead_end);
+  free(ts.out);
+  free(ts.emitted);
+  return ok;
+}
+
+static void write_vertex(float *dst, tinyobj_attrib_t const *attrib, unsigned int format, MeshKey const *key) {
+  memset(dst, 0, 3 * sizeof(float));
+  if (key->v >= 0) memcpy(dst, &attrib->vertices[key->v * 3], 3 * sizeof(float));
+  dst += 3;
+  if (format & TINYOBJ_MESH_NORMAL) {
+    memset(dst, 0, 3 * sizeof(float));
+    if (key->vn >= 0) memcpy(dst, &attrib->normals[key->vn * 3], 3 * sizeof(float));
+    dst += 3;
+  }
+  if (format & TINYOBJ_MESH_TEXCOORD) {
+    memset(dst, 0, 2 * sizeof(float));
+    if (key->vt >= 0) memcpy(dst, &attrib->texcoords[key->vt * 2], 2 * sizeof(float));
+  }
+}
+
+/* fan the faces into triangle keys grouped by material, keeping the .obj
+ * order within each material */
+static MeshKey *gather_triangles(tinyobj_mesh_t *mesh,
+                                 tinyobj_attrib_t const *attrib,
+                                 unsigned int face_offset,
+                                 unsigned int num_faces,
+                                 uint32_t num_tris) {
+  unsigned int corner = 0;
+  unsigned int f;
+  int min_material = 0;
+  int max_material = -1;
+  uint32_t num_buckets;
+  uint32_t *buckets;
+  MeshKey *keys;
+  uint32_t b;
+
+  for (f = 0; f < face_offset; f++) corner += (unsigned int) attrib->face_num_verts[f];
+
+  for (f = face_offset; f < face_offset + num_faces; f++) {
+    int m = attrib->material_ids ? attrib->material_ids[f] : -1;
+    if (m < 0) m = -1;
+    if (max_material < min_material) min_material = max_material = m;
+    if (m < min_material) min_material = m;
+    if (m > max_material) max_material = m;
+  }
+  num_buckets = (uint32_t) (max_material - min_material + 1);
+
+  buckets = (uint32_t *) calloc(num_buckets + 1, sizeof(uint32_t));
+  keys = (MeshKey *) malloc(num_tris * 3 * sizeof(MeshKey));
+  if (!buckets || !keys) {
+    free(buckets);
+    free(keys);
+    return NULL;
+  }
+
+  for (f = face_offset; f < face_offset + num_faces; f++) {
+    int n = attrib->face_num_verts[f];
+    int m = attrib->material_ids ? attrib->material_ids[f] : -1;
+    if (m < 0) m = -1;
+    if (n >= 3) buckets[m - min_material + 1] += (uint32_t) (n - 2) * 3;
+  }
+  mesh->num_submeshes = 0;
+  for (b = 0; b < num_buckets; b++) {
+    if (buckets[b + 1]) mesh->num_submeshes++;
+    buckets[b + 1] += buckets[b];
+  }
+
+  mesh->submeshes = (tinyobj_submesh_t *) malloc(mesh->num_submeshes * sizeof(tinyobj_submesh_t));
+  if (!mesh->submeshes) {
+    free(buckets);
+    free(keys);
+    return NULL;
+  }
+  mesh->num_submeshes = 0;
+  for (b = 0; b < num_buckets; b++) {
+    if (buckets[b + 1] == buckets[b]) continue;
+    mesh->submeshes[mesh->num_submeshes].material_id = (int) b + min_material;
+    mesh->submeshes[mesh->num_submeshes].index_offset = buckets[b];
+    mesh->submeshes[mesh->num_submeshes].index_count = buckets[b + 1] - buckets[b];
+    mesh->num_submeshes++;
+  }
+
+  for (f = face_offset; f < face_offset + num_faces; f++) {
+    int n = attrib->face_num_verts[f];
+    int m = attrib->material_ids ? attrib->material_ids[f] : -1;
+    int k;
+    uint32_t *dst;
+    if (m < 0) m = -1;
+    dst = &buckets[m - min_material];
+    for (k = 1; k + 1 < n; k++) {
+      keys[(*dst)++] = key_of(attrib, corner);
+      keys[(*dst)++] = key_of(attrib, corner + k);
+      keys[(*dst)++] = key_of(attrib, corner + k + 1);
+    }
+    corner += (unsigned int) (n > 0 ? n : 0);
+  }
+
+  free(buckets);
+  return keys;
+}
+
+int tinyobj_mesh_build(tinyobj_mesh_t *mesh,
+                       tinyobj_attrib_t const *attrib,
+                       unsigned int face_offset,
+                       unsigned int num_faces,
+                       unsigned int flags) {
+  uint32_t num_tris = 0;
+  uint32_t *indices = NULL;
+  uint32_t *remap = NULL;
+  MeshKey *keys = NULL;
+  MeshKey *unique = NULL;
+  unsigned int f;
+  uint32_t i;
+  uint32_t next;
+
+  if (mesh == NULL || attrib == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  memset(mesh, 0, sizeof(tinyobj_mesh_t));
+  if (face_offset > attrib->num_face_num_verts || num_faces > attrib->num_face_num_verts - face_offset) {
+    return TINYOBJ_ERROR_INVALID_PARAMETER;
+  }
+
+  for (f = face_offset; f < face_offset + num_faces; f++) {
+    if (attrib->face_num_verts[f] >= 3) num_tris += (uint32_t) attrib->face_num_verts[f] - 2;
+  }
+  if (num_tris == 0) return TINYOBJ_ERROR_EMPTY;
+
+  mesh->num_indices = num_tris * 3;
+  mesh->vertex_format = (attrib->num_normals ? TINYOBJ_MESH_NORMAL : 0) |
+      (attrib->num_texcoords ? TINYOBJ_MESH_TEXCOORD : 0);
+  mesh->vertex_stride = 3 +
+      ((mesh->vertex_format & TINYOBJ_MESH_NORMAL) ? 3 : 0) +
+      ((mesh->vertex_format & TINYOBJ_MESH_TEXCOORD) ? 2 : 0);
+
+  keys = gather_triangles(mesh, attrib, face_offset, num_faces, num_tris);
+  unique = (MeshKey *) malloc(mesh->num_indices * sizeof(MeshKey));
+  indices = (uint32_t *) malloc(mesh->num_indices * sizeof(uint32_t));
+  if (!keys || !unique || !indices) goto out_of_memory;
+
+  mesh->num_vertices = dedup_keys(keys, mesh->num_indices, unique, indices);
+  free(keys);
+  keys = NULL;
+  if (mesh->num_vertices == MESH_NONE) goto out_of_memory;
+
+  mesh->acmr_before = tinyobj_mesh_acmr(indices, 4, mesh->num_indices, TINYOBJ_MESH_CACHE_SIZE);
+
+  if (!(flags & TINYOBJ_MESH_FLAG_NO_OPTIMISE)) {
+    if (!optimise_submeshes(mesh, indices)) goto out_of_memory;
+  }
+
+  /* renumber vertices in the order the GPU will first fetch them */
+  remap = (uint32_t *) malloc(mesh->num_vertices * sizeof(uint32_t));
+  mesh->vertices = (float *) malloc((size_t) mesh->num_vertices * mesh->vertex_stride * sizeof(float));
+  if (!remap || !mesh->vertices) goto out_of_memory;
+  memset(remap, 0xFF, mesh->num_vertices * sizeof(uint32_t));
+
+  next = 0;
+  for (i = 0; i < mesh->num_indices; i++) {
+    uint32_t v = indices[i];
+    if (remap[v] == MESH_NONE) {
+      remap[v] = next++;
+      write_vertex(&mesh->vertices[(size_t) remap[v] * mesh->vertex_stride], attrib, mesh->vertex_format, &unique[v]);
+    }
+    indices[i] = remap[v];
+  }
+  ASSERT(next == mesh->num_vertices);
+  free(remap);
+  free(unique);
+
+  mesh->acmr_after = tinyobj_mesh_acmr(indices, 4, mesh->num_indices, TINYOBJ_MESH_CACHE_SIZE);
+
+  if (mesh->num_vertices <= 0xFFFF && !(flags & TINYOBJ_MESH_FLAG_32BIT_INDICES)) {
+    uint16_t *small = (uint16_t *) malloc(mesh->num_indices * sizeof(uint16_t));
+    if (!small) {
+      free(indices);
+      tinyobj_mesh_free(mesh);
+      LOGERROR("TINYOBJ: Out of memory building mesh");
+      return TINYOBJ_ERROR_OUT_OF_MEMORY;
+    }
+    for (i = 0; i < mesh->num_indices; i++) small[i] = (uint16_t) indices[i];
+    free(indices);
+    mesh->indices = small;
+    mesh->index_size = 2;
+  } else {
+    mesh->indices = indices;
+    mesh->index_size = 4;
+  }
+  return TINYOBJ_SUCCESS;
+
+out_of_memory:
+  free(keys);
+  free(unique);
+  free(indices);
+  free(remap);
+  tinyobj_mesh_free(mesh);
+  LOGERROR("TINYOBJ: Out of memory building mesh");
+  return TINYOBJ_ERROR_OUT_OF_MEMORY;
+}
+
+void tinyobj_mesh_free(tinyobj_mesh_t *mesh) {
+  if (mesh == NULL) return;
+  free(mesh->vertices);
+  free(mesh->indices);
+  free(mesh->submeshes);
+  memset(mesh, 0, sizeof(tinyobj_mesh_t));
+}
+
+float tinyobj_mesh_acmr(void const *indices,
+                        unsigned int index_size,
+                        unsigned int num_indices,
+                        unsigned int cache_size) {
+  uint16_t const *indices16 = (uint16_t const *) indices;
+  uint32_t const *indices32 = (uint32_t const *) indices;
+  uint32_t max_index = 0;
+  uint32_t misses = 0;
+  uint32_t *entered;
+  unsigned int i;
+
+  if (indices == NULL || num_indices < 3 || cache_size == 0) return 0.0f;
+  if (index_size != 2 && index_size != 4) return 0.0f;
+
+  for (i = 0; i < num_indices; i++) {
+    uint32_t v = index_size == 2 ? indices16[i] : indices32[i];
+    if (v > max_index) max_index = v;
+  }
+
+  /* a vertex is still in the FIFO while fewer than cache_size misses have
+   * happened since it went in, 0 is never */
+  entered = (uint32_t *) calloc((size_t) max_index + 1, sizeof(uint32_t));
+  if (!entered) return 0.0f;
+  for (i = 0; i < num_indices; i++) {
+    uint32_t v = index_size == 2 ? indices16[i] : indices32[i];
+    if (entered[v] == 0 || misses - entered[v] >= cache_size) entered[v] = ++misses;
+  }
+  free(entered);
+
+  return (float) misses / (float) (num_indices / 3);
+}
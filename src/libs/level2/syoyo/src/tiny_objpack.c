@@ -0,0 +1,239 @@
+#include "core/core.h"
+#include "core/logger.h"
+#include "math/math.h"
+#include "syoyo/tiny_objmesh.h"
+#include "syoyo/tiny_objpack.h"
+#include <stdlib.h>
+#include <string.h>
+
+static float sign_not_zero(float v) {
+  return (v >= 0.0f) ? 1.0f : -1.0f;
+}
+
+void tinyobj_oct_encode(float const dir[3], float oct_out[2]) {
+  float const l1 = fabsf(dir[0]) + fabsf(dir[1]) + fabsf(dir[2]);
+  float x, y;
+  if (l1 == 0.0f) {
+    oct_out[0] = oct_out[1] = 0.0f;
+    return;
+  }
+  x = dir[0] / l1;
+  y = dir[1] / l1;
+  if (dir[2] < 0.0f) {
+    float const fx = (1.0f - fabsf(y)) * sign_not_zero(x);
+    float const fy = (1.0f - fabsf(x)) * sign_not_zero(y);
+    x = fx;
+    y = fy;
+  }
+  oct_out[0] = x;
+  oct_out[1] = y;
+}
+
+void tinyobj_oct_decode(float const oct[2], float dir_out[3]) {
+  float x = oct[0];
+  float y = oct[1];
+  float const z = 1.0f - fabsf(x) - fabsf(y);
+  float len;
+  if (z < 0.0f) {
+    float const fx = (1.0f - fabsf(y)) * sign_not_zero(x);
+    float const fy = (1.0f - fabsf(x)) * sign_not_zero(y);
+    x = fx;
+    y = fy;
+  }
+  len = sqrtf(x * x + y * y + z * z);
+  dir_out[0] = x / len;
+  dir_out[1] = y / len;
+  dir_out[2] = z / len;
+}
+
+/* rounding each component on its own isn't the closest direction, so try
+ * the 4 neighbouring grid points and keep the best (Cigolle et al. 2014) */
+static void oct_quantise(float const dir[3], float max_value, int q_out[2]) {
+  float oct[2];
+  float len = sqrtf(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+  float best_dot = -2.0f;
+  int i;
+
+  tinyobj_oct_encode(dir, oct);
+  q_out[0] = (int) floorf(oct[0] * max_value + 0.5f);
+  q_out[1] = (int) floorf(oct[1] * max_value + 0.5f);
+  if (len == 0.0f) return;
+
+  for (i = 0; i < 4; i++) {
+    int const qx = (int) floorf(oct[0] * max_value) + (i & 1);
+    int const qy = (int) floorf(oct[1] * max_value) + (i >> 1);
+    float candidate[2];
+    float decoded[3];
+    float dot;
+    if (qx < -max_value || qx > max_value || qy < -max_value || qy > max_value) continue;
+    candidate[0] = (float) qx / max_value;
+    candidate[1] = (float) qy / max_value;
+    tinyobj_oct_decode(candidate, decoded);
+    dot = (decoded[0] * dir[0] + decoded[1] * dir[1] + decoded[2] * dir[2]) / len;
+    if (dot > best_dot) {
+      best_dot = dot;
+      q_out[0] = qx;
+      q_out[1] = qy;
+    }
+  }
+}
+
+static void oct_dequantise(int qx, int qy, float max_value, float dir_out[3]) {
+  float oct[2];
+  oct[0] = fmaxf((float) qx / max_value, -1.0f);
+  oct[1] = fmaxf((float) qy / max_value, -1.0f);
+  tinyobj_oct_decode(oct, dir_out);
+}
+
+static void add_attribute(tinyobj_packed_mesh_t *packed, unsigned int semantic, unsigned int format,
+                          unsigned int size) {
+  tinyobj_packed_attribute_t *attribute = &packed->attributes[packed->num_attributes++];
+  attribute->semantic = semantic;
+  attribute->format = format;
+  attribute->offset = packed->stride;
+  packed->stride += (size + 3) & ~3u;
+}
+
+int tinyobj_mesh_pack(tinyobj_packed_mesh_t *packed,
+                      tinyobj_mesh_t const *mesh,
+                      unsigned int flags) {
+  float const normal_max = (flags & TINYOBJ_PACK_FLAG_NORMAL_8BIT) ? 127.0f : 32767.0f;
+  float bounds_min[3] = {0.0f, 0.0f, 0.0f};
+  float bounds_max[3] = {0.0f, 0.0f, 0.0f};
+  unsigned int normal_offset = 0;
+  unsigned int texcoord_offset = 0;
+  unsigned int v;
+  int c;
+
+  if (packed == NULL || mesh == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  memset(packed, 0, sizeof(tinyobj_packed_mesh_t));
+  if (mesh->num_vertices == 0 || mesh->vertices == NULL) return TINYOBJ_ERROR_EMPTY;
+
+  packed->num_vertices = mesh->num_vertices;
+  packed->vertex_format = mesh->vertex_format;
+  add_attribute(packed, TINYOBJ_PACK_POSITION, TINYOBJ_PACK_R16G16B16A16_UNORM, 4 * sizeof(uint16_t));
+  if (mesh->vertex_format & TINYOBJ_MESH_NORMAL) {
+    normal_offset = packed->stride;
+    if (flags & TINYOBJ_PACK_FLAG_NORMAL_8BIT) {
+      add_attribute(packed, TINYOBJ_PACK_NORMAL, TINYOBJ_PACK_R8G8_SNORM, 2 * sizeof(int8_t));
+    } else {
+      add_attribute(packed, TINYOBJ_PACK_NORMAL, TINYOBJ_PACK_R16G16_SNORM, 2 * sizeof(int16_t));
+    }
+  }
+  if (mesh->vertex_format & TINYOBJ_MESH_TEXCOORD) {
+    texcoord_offset = packed->stride;
+    add_attribute(packed, TINYOBJ_PACK_TEXCOORD, TINYOBJ_PACK_R16G16_SFLOAT, 2 * sizeof(uint16_t));
+  }
+
+  packed->vertices = calloc(mesh->num_vertices, packed->stride);
+  if (!packed->vertices) {
+    LOGERROR("TINYOBJ: Out of memory packing mesh");
+    return TINYOBJ_ERROR_OUT_OF_MEMORY;
+  }
+
+  for (c = 0; c < 3; c++) bounds_min[c] = bounds_max[c] = mesh->vertices[c];
+  for (v = 1; v < mesh->num_vertices; v++) {
+    float const *src = &mesh->vertices[(size_t) v * mesh->vertex_stride];
+    for (c = 0; c < 3; c++) {
+      bounds_min[c] = fminf(bounds_min[c], src[c]);
+      bounds_max[c] = fmaxf(bounds_max[c], src[c]);
+    }
+  }
+  for (c = 0; c < 3; c++) {
+    packed->position_offset[c] = bounds_min[c];
+    packed->position_scale[c] = bounds_max[c] - bounds_min[c];
+  }
+
+  for (v = 0; v < mesh->num_vertices; v++) {
+    float const *src = &mesh->vertices[(size_t) v * mesh->vertex_stride];
+    uint8_t *dst = (uint8_t *) packed->vertices + (size_t) v * packed->stride;
+    uint16_t *position = (uint16_t *) dst;
+
+    for (c = 0; c < 3; c++) {
+      float const extent = bounds_max[c] - bounds_min[c];
+      float const t = extent > 0.0f ? (src[c] - bounds_min[c]) / extent : 0.0f;
+      position[c] = (uint16_t) fminf(fmaxf(floorf(t * 65535.0f + 0.5f), 0.0f), 65535.0f);
+    }
+    src += 3;
+
+    if (mesh->vertex_format & TINYOBJ_MESH_NORMAL) {
+      int q[2];
+      oct_quantise(src, normal_max, q);
+      if (flags & TINYOBJ_PACK_FLAG_NORMAL_8BIT) {
+        int8_t *normal = (int8_t *) (dst + normal_offset);
+        normal[0] = (int8_t) q[0];
+        normal[1] = (int8_t) q[1];
+      } else {
+        int16_t *normal = (int16_t *) (dst + normal_offset);
+        normal[0] = (int16_t) q[0];
+        normal[1] = (int16_t) q[1];
+      }
+      src += 3;
+    }
+
+    if (mesh->vertex_format & TINYOBJ_MESH_TEXCOORD) {
+      uint16_t *texcoord = (uint16_t *) (dst + texcoord_offset);
+      texcoord[0] = Math_Float2Half(src[0]);
+      texcoord[1] = Math_Float2Half(src[1]);
+    }
+  }
+
+  return TINYOBJ_SUCCESS;
+}
+
+void tinyobj_packed_mesh_free(tinyobj_packed_mesh_t *packed) {
+  if (packed == NULL) return;
+  free(packed->vertices);
+  memset(packed, 0, sizeof(tinyobj_packed_mesh_t));
+}
+
+int tinyobj_packed_mesh_decode(tinyobj_packed_mesh_t const *packed, float *vertices_out) {
+  unsigned int v;
+  unsigned int a;
+  int c;
+
+  if (packed == NULL || vertices_out == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (packed->vertices == NULL) return TINYOBJ_ERROR_EMPTY;
+
+  for (v = 0; v < packed->num_vertices; v++) {
+    uint8_t const *src = (uint8_t const *) packed->vertices + (size_t) v * packed->stride;
+
+    /* attributes are in the mesh layout order, so can be written in turn */
+    for (a = 0; a < packed->num_attributes; a++) {
+      tinyobj_packed_attribute_t const *attribute = &packed->attributes[a];
+      void const *data = src + attribute->offset;
+
+      switch (attribute->format) {
+        case TINYOBJ_PACK_R16G16B16A16_UNORM: {
+          uint16_t const *position = (uint16_t const *) data;
+          for (c = 0; c < 3; c++) {
+            *vertices_out++ = packed->position_offset[c] + ((float) position[c] / 65535.0f) * packed->position_scale[c];
+          }
+          break;
+        }
+        case TINYOBJ_PACK_R16G16_SNORM: {
+          int16_t const *normal = (int16_t const *) data;
+          oct_dequantise(normal[0], normal[1], 32767.0f, vertices_out);
+          vertices_out += 3;
+          break;
+        }
+        case TINYOBJ_PACK_R8G8_SNORM: {
+          int8_t const *normal = (int8_t const *) data;
+          oct_dequantise(normal[0], normal[1], 127.0f, vertices_out);
+          vertices_out += 3;
+          break;
+        }
+        case TINYOBJ_PACK_R16G16_SFLOAT: {
+          uint16_t const *texcoord = (uint16_t const *) data;
+          *vertices_out++ = Math_Half2Float(texcoord[0]);
+          *vertices_out++ = Math_Half2Float(texcoord[1]);
+          break;
+        }
+        default:
+          LOGERRORF("TINYOBJ: Unknown packed attribute format %u", attribute->format);
+          return TINYOBJ_ERROR_INVALID_PARAMETER;
+      }
+    }
+  }
+  return TINYOBJ_SUCCESS;
+}
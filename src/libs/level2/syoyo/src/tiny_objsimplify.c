@@ -0,0 +1,893 @@
+#include "core/core.h"
+#include "core/logger.h"
+#include "os/threadpool.h"
+#include "syoyo/tiny_objloader.h"
+#include "syoyo/tiny_objmesh.h"
+#include "syoyo/tiny_objsimplify.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIMPLIFY_NONE (0xFFFFFFFFu)
+#define SIMPLIFY_MAX_ATTRIBUTES (5)
+
+/* open edges also get a plane through them at right angles to the surface so
+ * border vertices sliding along the border keep its shape. The plane has no
+ * area to weight it by so uses the edge length squared, scaled up */
+#define SIMPLIFY_BORDER_WEIGHT (10.0f)
+
+/* what a vertex (all vertices at its position) may do */
+enum {
+  KIND_MANIFOLD = 0, /* collapse onto any neighbour */
+  KIND_BORDER = 1,   /* collapse along the border only */
+  KIND_LOCKED = 2    /* seam, crease, submesh boundary or non manifold */
+};
+
+/* symmetric 3x3 A, b and c of x'Ax + 2b'x + c and the total weight */
+typedef struct {
+  float a00, a11, a22;
+  float a10, a20, a21;
+  float b0, b1, b2;
+  float c;
+  float w;
+} Quadric;
+
+/* weighted gradient and offset of one attribute over the triangles summed in */
+typedef struct {
+  float gx, gy, gz, gw;
+} QuadricGrad;
+
+typedef struct {
+  uint32_t v0; /* moves onto v1 */
+  uint32_t v1;
+  float error; /* squared, relative */
+} Collapse;
+
+typedef struct {
+  tinyobj_simplify_options_t const *options;
+  uint32_t num_vertices;
+  uint32_t num_attributes;
+  uint32_t num_indices;
+  float error; /* largest collapse so far, squared */
+
+  float *positions;  /* scaled into the unit cube */
+  float *attributes; /* weighted, num_attributes per vertex */
+  uint32_t *remap;   /* vertex to the first vertex at the same position */
+  uint8_t *kind;     /* per position */
+  uint32_t *border_next; /* per position, the open edges leaving and */
+  uint32_t *border_prev; /* arriving at a border vertex */
+  Quadric *vertex_quadrics; /* per position */
+  Quadric *attribute_quadrics; /* per vertex */
+  QuadricGrad *attribute_gradients; /* num_attributes per vertex */
+
+  uint32_t *indices;
+  uint32_t *triangle_submesh;
+
+  /* scratch for each pass */
+  Collapse *collapses;
+  uint32_t *collapse_order;
+  uint32_t *collapse_scratch;
+  uint32_t *collapse_remap;
+  uint8_t *collapse_locked; /* per position */
+  uint32_t *adjacency_offsets; /* vertex to the triangles using it */
+  uint32_t *adjacency;
+} Simplifier;
+
+static void cross3(float *out, float const *a, float const *b) {
+  out[0] = a[1] * b[2] - a[2] * b[1];
+  out[1] = a[2] * b[0] - a[0] * b[2];
+  out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static float dot3(float const *a, float const *b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void sub3(float *out, float const *a, float const *b) {
+  out[0] = a[0] - b[0];
+  out[1] = a[1] - b[1];
+  out[2] = a[2] - b[2];
+}
+
+static void quadric_from_plane(Quadric *q, float const *n, float d, float w) {
+  q->a00 = w * n[0] * n[0];
+  q->a11 = w * n[1] * n[1];
+  q->a22 = w * n[2] * n[2];
+  q->a10 = w * n[1] * n[0];
+  q->a20 = w * n[2] * n[0];
+  q->a21 = w * n[2] * n[1];
+  q->b0 = w * n[0] * d;
+  q->b1 = w * n[1] * d;
+  q->b2 = w * n[2] * d;
+  q->c = w * d * d;
+  q->w = w;
+}
+
+static void quadric_add(Quadric *q, Quadric const *r) {
+  q->a00 += r->a00;
+  q->a11 += r->a11;
+  q->a22 += r->a22;
+  q->a10 += r->a10;
+  q->a20 += r->a20;
+  q->a21 += r->a21;
+  q->b0 += r->b0;
+  q->b1 += r->b1;
+  q->b2 += r->b2;
+  q->c += r->c;
+  q->w += r->w;
+}
+
+static float quadric_eval(Quadric const *q, float const *p) {
+  float const x = p[0], y = p[1], z = p[2];
+  return q->a00 * x * x + q->a11 * y * y + q->a22 * z * z +
+      2.0f * (q->a10 * x * y + q->a20 * x * z + q->a21 * y * z) +
+      2.0f * (q->b0 * x + q->b1 * y + q->b2 * z) + q->c;
+}
+
+/* weighted mean squared distance from the planes summed into q */
+static float quadric_error(Quadric const *q, float const *p) {
+  return q->w > 0.0f ? fabsf(quadric_eval(q, p)) / q->w : 0.0f;
+}
+
+/* weighted mean squared difference between the attributes a at p and the
+ * attributes the summed triangles interpolate to at p */
+static float attribute_error(Quadric const *q, QuadricGrad const *g, uint32_t num_attributes,
+                             float const *p, float const *a) {
+  float e = quadric_eval(q, p);
+  uint32_t k;
+  for (k = 0; k < num_attributes; k++) {
+    e += a[k] * a[k] * q->w - 2.0f * a[k] * (g[k].gx * p[0] + g[k].gy * p[1] + g[k].gz * p[2] + g[k].gw);
+  }
+  return q->w > 0.0f ? fabsf(e) / q->w : 0.0f;
+}
+
+static uint32_t hash_position(float const *p) {
+  uint32_t bits[3];
+  uint32_t h;
+  memcpy(bits, p, sizeof(bits));
+  h = bits[0] * 0x9E3779B1u;
+  h = (h ^ (h >> 15)) + bits[1] * 0x85EBCA77u;
+  h = (h ^ (h >> 13)) + bits[2] * 0xC2B2AE3Du;
+  return h ^ (h >> 16);
+}
+
+/* vertices with bitwise equal positions map to the first of them */
+static int build_position_remap(Simplifier *s) {
+  uint32_t capacity = 16;
+  uint32_t mask;
+  uint32_t *table;
+  uint32_t v;
+
+  while (capacity < s->num_vertices * 2) capacity *= 2;
+  mask = capacity - 1;
+  table = (uint32_t *) malloc(capacity * sizeof(uint32_t));
+  if (!table) return 0;
+  memset(table, 0xFF, capacity * sizeof(uint32_t));
+
+  for (v = 0; v < s->num_vertices; v++) {
+    float const *p = &s->positions[v * 3];
+    uint32_t slot = hash_position(p) & mask;
+    while (table[slot] != SIMPLIFY_NONE && memcmp(&s->positions[table[slot] * 3], p, 3 * sizeof(float)) != 0) {
+      slot = (slot + 1) & mask;
+    }
+    if (table[slot] == SIMPLIFY_NONE) table[slot] = v;
+    s->remap[v] = table[slot];
+  }
+
+  free(table);
+  return 1;
+}
+
+/* Finds the open edges from position level half edges (an edge without its
+ * opposite) and locks anything a collapse could tear */
+static int classify_vertices(Simplifier *s) {
+  uint32_t const n = s->num_vertices;
+  uint32_t const num_indices = s->num_indices;
+  int const lock_border = (s->options->flags & TINYOBJ_SIMPLIFY_FLAG_LOCK_BORDER) != 0;
+  uint32_t *offsets = (uint32_t *) calloc(n + 1, sizeof(uint32_t));
+  uint32_t *cursor = (uint32_t *) malloc(n * sizeof(uint32_t));
+  uint32_t *targets = (uint32_t *) malloc(num_indices * sizeof(uint32_t));
+  uint32_t *open_out = (uint32_t *) calloc(n, sizeof(uint32_t));
+  uint32_t *open_in = (uint32_t *) calloc(n, sizeof(uint32_t));
+  uint32_t i;
+  uint32_t a;
+
+  if (!offsets || !cursor || !targets || !open_out || !open_in) {
+    free(offsets);
+    free(cursor);
+    free(targets);
+    free(open_out);
+    free(open_in);
+    return 0;
+  }
+
+  memset(s->kind, KIND_MANIFOLD, n);
+  memset(s->border_next, 0xFF, n * sizeof(uint32_t));
+  memset(s->border_prev, 0xFF, n * sizeof(uint32_t));
+
+  /* more than one vertex at a position is a UV seam or normal crease */
+  for (i = 0; i < n; i++) {
+    if (s->remap[i] != i) s->kind[s->remap[i]] = KIND_LOCKED;
+  }
+
+  /* a position used by more than one submesh is on a material boundary */
+  memset(cursor, 0xFF, n * sizeof(uint32_t));
+  for (i = 0; i < num_indices; i++) {
+    uint32_t const r = s->remap[s->indices[i]];
+    uint32_t const submesh = s->triangle_submesh[i / 3];
+    if (cursor[r] == SIMPLIFY_NONE) cursor[r] = submesh;
+    if (cursor[r] != submesh) s->kind[r] = KIND_LOCKED;
+  }
+
+  for (i = 0; i < num_indices; i++) offsets[s->remap[s->indices[i]] + 1]++;
+  for (i = 0; i < n; i++) {
+    offsets[i + 1] += offsets[i];
+    cursor[i] = offsets[i];
+  }
+  for (i = 0; i < num_indices; i++) {
+    uint32_t const next = (i % 3 == 2) ? i - 2 : i + 1;
+    uint32_t const r = s->remap[s->indices[i]];
+    targets[cursor[r]++] = s->remap[s->indices[next]];
+  }
+
+  for (a = 0; a < n; a++) {
+    uint32_t j;
+    for (j = offsets[a]; j < offsets[a + 1]; j++) {
+      uint32_t const b = targets[j];
+      uint32_t k;
+      int opposite = 0;
+      for (k = offsets[a]; k < j; k++) {
+        if (targets[k] == b) {
+          /* the same half edge twice is non manifold or flipped winding */
+          s->kind[a] = KIND_LOCKED;
+          s->kind[b] = KIND_LOCKED;
+        }
+      }
+      for (k = offsets[b]; k < offsets[b + 1]; k++) {
+        if (targets[k] == a) {
+          opposite = 1;
+          break;
+        }
+      }
+      if (!opposite) {
+        open_out[a]++;
+        open_in[b]++;
+        s->border_next[a] = b;
+        s->border_prev[b] = a;
+      }
+    }
+  }
+
+  for (a = 0; a < n; a++) {
+    if (open_out[a] == 0 && open_in[a] == 0) continue;
+    if (open_out[a] == 1 && open_in[a] == 1 && s->kind[a] != KIND_LOCKED && !lock_border) {
+      s->kind[a] = KIND_BORDER;
+    } else {
+      s->kind[a] = KIND_LOCKED;
+    }
+  }
+
+  free(offsets);
+  free(cursor);
+  free(targets);
+  free(open_out);
+  free(open_in);
+  return 1;
+}
+
+/* Hoppe, "New Quadric Metric for Simplifying Meshes with Appearance
+ * Attributes". Each attribute is linear over the triangle, a(p) = g.p + gw,
+ * and the quadric sums (g.p + gw - a)^2 weighted by area */
+static void add_attribute_quadrics(Simplifier *s, uint32_t const *tri, float area) {
+  uint32_t const na = s->num_attributes;
+  float const *p0 = &s->positions[tri[0] * 3];
+  float p10[3], p20[3], gx1[3], gx2[3];
+  float d00, d01, d11, denom;
+  Quadric q;
+  QuadricGrad grads[SIMPLIFY_MAX_ATTRIBUTES];
+  uint32_t k;
+  int c;
+
+  sub3(p10, &s->positions[tri[1] * 3], p0);
+  sub3(p20, &s->positions[tri[2] * 3], p0);
+  d00 = dot3(p10, p10);
+  d01 = dot3(p10, p20);
+  d11 = dot3(p20, p20);
+  denom = d00 * d11 - d01 * d01;
+  if (denom == 0.0f) return;
+  denom = 1.0f / denom;
+  for (c = 0; c < 3; c++) {
+    gx1[c] = (d11 * p10[c] - d01 * p20[c]) * denom;
+    gx2[c] = (d00 * p20[c] - d01 * p10[c]) * denom;
+  }
+
+  memset(&q, 0, sizeof(Quadric));
+  q.w = area;
+  for (k = 0; k < na; k++) {
+    float const a0 = s->attributes[tri[0] * na + k];
+    float const a1 = s->attributes[tri[1] * na + k];
+    float const a2 = s->attributes[tri[2] * na + k];
+    float g[3];
+    float gw;
+    for (c = 0; c < 3; c++) g[c] = gx1[c] * (a1 - a0) + gx2[c] * (a2 - a0);
+    gw = a0 - dot3(p0, g);
+
+    q.a00 += area * g[0] * g[0];
+    q.a11 += area * g[1] * g[1];
+    q.a22 += area * g[2] * g[2];
+    q.a10 += area * g[1] * g[0];
+    q.a20 += area * g[2] * g[0];
+    q.a21 += area * g[2] * g[1];
+    q.b0 += area * g[0] * gw;
+    q.b1 += area * g[1] * gw;
+    q.b2 += area * g[2] * gw;
+    q.c += area * gw * gw;
+
+    grads[k].gx = area * g[0];
+    grads[k].gy = area * g[1];
+    grads[k].gz = area * g[2];
+    grads[k].gw = area * gw;
+  }
+
+  for (c = 0; c < 3; c++) {
+    QuadricGrad *dst = &s->attribute_gradients[tri[c] * na];
+    quadric_add(&s->attribute_quadrics[tri[c]], &q);
+    for (k = 0; k < na; k++) {
+      dst[k].gx += grads[k].gx;
+      dst[k].gy += grads[k].gy;
+      dst[k].gz += grads[k].gz;
+      dst[k].gw += grads[k].gw;
+    }
+  }
+}
+
+static void compute_quadrics(Simplifier *s) {
+  uint32_t t;
+  memset(s->vertex_quadrics, 0, s->num_vertices * sizeof(Quadric));
+  memset(s->attribute_quadrics, 0, s->num_vertices * sizeof(Quadric));
+  memset(s->attribute_gradients, 0, (size_t) s->num_vertices * s->num_attributes * sizeof(QuadricGrad));
+
+  for (t = 0; t < s->num_indices; t += 3) {
+    uint32_t const *tri = &s->indices[t];
+    float const *p0 = &s->positions[tri[0] * 3];
+    float p10[3], p20[3], normal[3];
+    float length;
+    Quadric q;
+    int c;
+
+    sub3(p10, &s->positions[tri[1] * 3], p0);
+    sub3(p20, &s->positions[tri[2] * 3], p0);
+    cross3(normal, p10, p20);
+    length = sqrtf(dot3(normal, normal));
+    if (length == 0.0f) continue;
+    normal[0] /= length;
+    normal[1] /= length;
+    normal[2] /= length;
+
+    quadric_from_plane(&q, normal, -dot3(normal, p0), length * 0.5f);
+    for (c = 0; c < 3; c++) quadric_add(&s->vertex_quadrics[s->remap[tri[c]]], &q);
+
+    for (c = 0; c < 3; c++) {
+      uint32_t const ra = s->remap[tri[c]];
+      uint32_t const rb = s->remap[tri[(c + 1) % 3]];
+      if (s->border_next[ra] == rb) {
+        float const *pa = &s->positions[ra * 3];
+        float edge[3], plane[3];
+        float edge_length;
+        sub3(edge, &s->positions[rb * 3], pa);
+        cross3(plane, edge, normal);
+        edge_length = sqrtf(dot3(plane, plane));
+        if (edge_length == 0.0f) continue;
+        plane[0] /= edge_length;
+        plane[1] /= edge_length;
+        plane[2] /= edge_length;
+        quadric_from_plane(&q, plane, -dot3(plane, pa), edge_length * edge_length * SIMPLIFY_BORDER_WEIGHT);
+        quadric_add(&s->vertex_quadrics[ra], &q);
+        quadric_add(&s->vertex_quadrics[rb], &q);
+      }
+    }
+
+    if (s->num_attributes) add_attribute_quadrics(s, tri, length * 0.5f);
+  }
+}
+
+static uint32_t mesh_index(tinyobj_mesh_t const *mesh, uint32_t i) {
+  return mesh->index_size == 2 ? ((uint16_t const *) mesh->indices)[i] : ((uint32_t const *) mesh->indices)[i];
+}
+
+static void simplifier_free(Simplifier *s) {
+  free(s->positions);
+  free(s->attributes);
+  free(s->remap);
+  free(s->kind);
+  free(s->border_next);
+  free(s->border_prev);
+  free(s->vertex_quadrics);
+  free(s->attribute_quadrics);
+  free(s->attribute_gradients);
+  free(s->indices);
+  free(s->triangle_submesh);
+  free(s->collapses);
+  free(s->collapse_order);
+  free(s->collapse_scratch);
+  free(s->collapse_remap);
+  free(s->collapse_locked);
+  free(s->adjacency_offsets);
+  free(s->adjacency);
+}
+
+static int simplifier_init(Simplifier *s, tinyobj_mesh_t const *mesh, tinyobj_simplify_options_t const *options) {
+  uint32_t const n = mesh->num_vertices;
+  uint32_t const max_indices = mesh->num_indices;
+  uint32_t const normal_offset = 3;
+  uint32_t const texcoord_offset = 3 + ((mesh->vertex_format & TINYOBJ_MESH_NORMAL) ? 3 : 0);
+  int const use_normals = (mesh->vertex_format & TINYOBJ_MESH_NORMAL) && options->normal_weight > 0.0f;
+  int const use_texcoords = (mesh->vertex_format & TINYOBJ_MESH_TEXCOORD) && options->texcoord_weight > 0.0f;
+  float bounds_min[3], bounds_max[3];
+  float extent = 0.0f;
+  unsigned int sm;
+  uint32_t v;
+  int c;
+
+  memset(s, 0, sizeof(Simplifier));
+  s->options = options;
+  s->num_vertices = n;
+  s->num_attributes = (use_normals ? 3 : 0) + (use_texcoords ? 2 : 0);
+
+  s->positions = (float *) malloc((size_t) n * 3 * sizeof(float));
+  s->attributes = (float *) malloc((size_t) n * (s->num_attributes + 1) * sizeof(float));
+  s->remap = (uint32_t *) malloc(n * sizeof(uint32_t));
+  s->kind = (uint8_t *) malloc(n);
+  s->border_next = (uint32_t *) malloc(n * sizeof(uint32_t));
+  s->border_prev = (uint32_t *) malloc(n * sizeof(uint32_t));
+  s->vertex_quadrics = (Quadric *) malloc(n * sizeof(Quadric));
+  s->attribute_quadrics = (Quadric *) malloc(n * sizeof(Quadric));
+  s->attribute_gradients = (QuadricGrad *) malloc((size_t) n * (s->num_attributes + 1) * sizeof(QuadricGrad));
+  s->indices = (uint32_t *) malloc(max_indices * sizeof(uint32_t));
+  s->triangle_submesh = (uint32_t *) malloc((max_indices / 3) * sizeof(uint32_t) + 1);
+  s->collapses = (Collapse *) malloc((size_t) max_indices * 2 * sizeof(Collapse));
+  s->collapse_order = (uint32_t *) malloc((size_t) max_indices * 2 * sizeof(uint32_t));
+  s->collapse_scratch = (uint32_t *) malloc((size_t) max_indices * 2 * sizeof(uint32_t));
+  s->collapse_remap = (uint32_t *) malloc(n * sizeof(uint32_t));
+  s->collapse_locked = (uint8_t *) malloc(n);
+  s->adjacency_offsets = (uint32_t *) malloc((n + 1) * sizeof(uint32_t));
+  s->adjacency = (uint32_t *) malloc(max_indices * sizeof(uint32_t));
+  if (!s->positions || !s->attributes || !s->remap || !s->kind || !s->border_next || !s->border_prev ||
+      !s->vertex_quadrics || !s->attribute_quadrics || !s->attribute_gradients || !s->indices ||
+      !s->triangle_submesh || !s->collapses || !s->collapse_order || !s->collapse_scratch ||
+      !s->collapse_remap || !s->collapse_locked || !s->adjacency_offsets || !s->adjacency) {
+    return 0;
+  }
+
+  /* errors are relative to the largest extent */
+  for (c = 0; c < 3; c++) bounds_min[c] = bounds_max[c] = mesh->vertices[c];
+  for (v = 1; v < n; v++) {
+    float const *src = &mesh->vertices[(size_t) v * mesh->vertex_stride];
+    for (c = 0; c < 3; c++) {
+      bounds_min[c] = fminf(bounds_min[c], src[c]);
+      bounds_max[c] = fmaxf(bounds_max[c], src[c]);
+    }
+  }
+  for (c = 0; c < 3; c++) extent = fmaxf(extent, bounds_max[c] - bounds_min[c]);
+  extent = extent > 0.0f ? 1.0f / extent : 0.0f;
+
+  for (v = 0; v < n; v++) {
+    float const *src = &mesh->vertices[(size_t) v * mesh->vertex_stride];
+    float *dst = &s->attributes[v * s->num_attributes];
+    for (c = 0; c < 3; c++) s->positions[v * 3 + c] = (src[c] - bounds_min[c]) * extent;
+    if (use_normals) {
+      for (c = 0; c < 3; c++) *dst++ = src[normal_offset + c] * options->normal_weight;
+    }
+    if (use_texcoords) {
+      for (c = 0; c < 2; c++) *dst++ = src[texcoord_offset + c] * options->texcoord_weight;
+    }
+  }
+
+  if (!build_position_remap(s)) return 0;
+
+  /* triangles out of range or with two corners at one position can't be
+   * seen and would only confuse the topology */
+  for (sm = 0; sm < mesh->num_submeshes; sm++) {
+    tinyobj_submesh_t const *submesh = &mesh->submeshes[sm];
+    uint32_t i;
+    for (i = submesh->index_offset; i + 2 < submesh->index_offset + submesh->index_count; i += 3) {
+      uint32_t const i0 = mesh_index(mesh, i), i1 = mesh_index(mesh, i + 1), i2 = mesh_index(mesh, i + 2);
+      if (i0 >= n || i1 >= n || i2 >= n) continue;
+      if (s->remap[i0] == s->remap[i1] || s->remap[i1] == s->remap[i2] || s->remap[i0] == s->remap[i2]) continue;
+      s->triangle_submesh[s->num_indices / 3] = sm;
+      s->indices[s->num_indices++] = i0;
+      s->indices[s->num_indices++] = i1;
+      s->indices[s->num_indices++] = i2;
+    }
+  }
+
+  if (!classify_vertices(s)) return 0;
+  compute_quadrics(s);
+  return 1;
+}
+
+static float collapse_error(Simplifier const *s, uint32_t v0, uint32_t v1) {
+  float const *p = &s->positions[v1 * 3];
+  float error = quadric_error(&s->vertex_quadrics[s->remap[v0]], p);
+  if (s->num_attributes) {
+    error += attribute_error(&s->attribute_quadrics[v0], &s->attribute_gradients[v0 * s->num_attributes],
+                             s->num_attributes, p, &s->attributes[v1 * s->num_attributes]);
+  }
+  return error;
+}
+
+static int can_collapse(Simplifier const *s, uint32_t v, int along_border) {
+  uint8_t const kind = s->kind[s->remap[v]];
+  return kind == KIND_MANIFOLD || (kind == KIND_BORDER && along_border);
+}
+
+/* every edge both ways, border vertices only along the border. Interior edges
+ * are seen once from each side so each direction comes from the triangle
+ * where it's the half edge, open edges are only seen once so give both */
+static uint32_t gather_collapses(Simplifier *s) {
+  uint32_t count = 0;
+  uint32_t i;
+  for (i = 0; i < s->num_indices; i++) {
+    uint32_t const v0 = s->indices[i];
+    uint32_t const v1 = s->indices[(i % 3 == 2) ? i - 2 : i + 1];
+    uint32_t const r0 = s->remap[v0];
+    uint32_t const r1 = s->remap[v1];
+    int const border = s->border_next[r0] == r1;
+
+    if (can_collapse(s, v0, border)) {
+      s->collapses[count].v0 = v0;
+      s->collapses[count].v1 = v1;
+      s->collapses[count].error = collapse_error(s, v0, v1);
+      count++;
+    }
+    if (border && can_collapse(s, v1, 1)) {
+      s->collapses[count].v0 = v1;
+      s->collapses[count].v1 = v0;
+      s->collapses[count].error = collapse_error(s, v1, v0);
+      count++;
+    }
+  }
+  return count;
+}
+
+/* cheapest first, by the top 22 bits of the (non negative) float errors in
+ * two 11 bit radix passes */
+static void sort_collapses(Simplifier *s, uint32_t count) {
+  uint32_t histogram[2048];
+  uint32_t *src = s->collapse_order;
+  uint32_t *dst = s->collapse_scratch;
+  int pass;
+  uint32_t i;
+
+  for (i = 0; i < count; i++) src[i] = i;
+  for (pass = 0; pass < 2; pass++) {
+    int const shift = 10 + pass * 11;
+    uint32_t sum = 0;
+    uint32_t *swap;
+    memset(histogram, 0, sizeof(histogram));
+    for (i = 0; i < count; i++) {
+      uint32_t bits;
+      memcpy(&bits, &s->collapses[src[i]].error, sizeof(uint32_t));
+      histogram[(bits >> shift) & 2047]++;
+    }
+    for (i = 0; i < 2048; i++) {
+      uint32_t const h = histogram[i];
+      histogram[i] = sum;
+      sum += h;
+    }
+    for (i = 0; i < count; i++) {
+      uint32_t bits;
+      memcpy(&bits, &s->collapses[src[i]].error, sizeof(uint32_t));
+      dst[histogram[(bits >> shift) & 2047]++] = src[i];
+    }
+    swap = src;
+    src = dst;
+    dst = swap;
+  }
+  ASSERT(src == s->collapse_order);
+}
+
+static void build_adjacency(Simplifier *s) {
+  uint32_t i;
+  memset(s->adjacency_offsets, 0, (s->num_vertices + 1) * sizeof(uint32_t));
+  for (i = 0; i < s->num_indices; i++) s->adjacency_offsets[s->indices[i] + 1]++;
+  for (i = 0; i < s->num_vertices; i++) s->adjacency_offsets[i + 1] += s->adjacency_offsets[i];
+  for (i = 0; i < s->num_indices; i++) s->adjacency[s->adjacency_offsets[s->indices[i]]++] = i / 3;
+  /* filling moved each offset to the next vertex's start */
+  for (i = s->num_vertices; i > 0; i--) s->adjacency_offsets[i] = s->adjacency_offsets[i - 1];
+  s->adjacency_offsets[0] = 0;
+}
+
+/* would moving v0 onto v1 turn any of v0's remaining triangles over */
+static int has_triangle_flips(Simplifier const *s, uint32_t v0, uint32_t v1) {
+  float const *p0 = &s->positions[v0 * 3];
+  float const *p1 = &s->positions[v1 * 3];
+  uint32_t const r1 = s->remap[v1];
+  uint32_t a;
+
+  for (a = s->adjacency_offsets[v0]; a < s->adjacency_offsets[v0 + 1]; a++) {
+    uint32_t const *tri = &s->indices[s->adjacency[a] * 3];
+    uint32_t const corner = tri[0] == v0 ? 0 : (tri[1] == v0 ? 1 : 2);
+    uint32_t const b = tri[(corner + 1) % 3];
+    uint32_t const c = tri[(corner + 2) % 3];
+    float const *pb = &s->positions[b * 3];
+    float const *pc = &s->positions[c * 3];
+    float eb[3], ec[3], before[3], after[3];
+
+    /* the triangles on the edge itself go */
+    if (s->remap[b] == r1 || s->remap[c] == r1) continue;
+
+    sub3(eb, pb, p0);
+    sub3(ec, pc, p0);
+    cross3(before, eb, ec);
+    sub3(eb, pb, p1);
+    sub3(ec, pc, p1);
+    cross3(after, eb, ec);
+    if (dot3(before, after) <= 0.0f) return 1;
+  }
+  return 0;
+}
+
+/* Takes collapses cheapest first until enough triangles have gone or the
+ * error goal is passed. Each one locks the positions of v0's triangles so
+ * no triangle changes twice in a pass and the flip test stays valid */
+static uint32_t perform_collapses(Simplifier *s, uint32_t count, uint32_t triangle_goal, float error_goal) {
+  uint32_t const na = s->num_attributes;
+  uint32_t collapsed = 0;
+  uint32_t triangles = 0;
+  uint32_t i;
+
+  for (i = 0; i < s->num_vertices; i++) s->collapse_remap[i] = i;
+  memset(s->collapse_locked, 0, s->num_vertices);
+
+  for (i = 0; i < count && triangles < triangle_goal; i++) {
+    Collapse const *collapse = &s->collapses[s->collapse_order[i]];
+    uint32_t const v0 = collapse->v0;
+    uint32_t const v1 = collapse->v1;
+    uint32_t const r0 = s->remap[v0];
+    uint32_t const r1 = s->remap[v1];
+    uint32_t a;
+    uint32_t k;
+
+    if (collapse->error > error_goal) break;
+    if (s->collapse_locked[r0] || s->collapse_locked[r1]) continue;
+    if (has_triangle_flips(s, v0, v1)) continue;
+
+    for (a = s->adjacency_offsets[v0]; a < s->adjacency_offsets[v0 + 1]; a++) {
+      uint32_t const *tri = &s->indices[s->adjacency[a] * 3];
+      s->collapse_locked[s->remap[tri[0]]] = 1;
+      s->collapse_locked[s->remap[tri[1]]] = 1;
+      s->collapse_locked[s->remap[tri[2]]] = 1;
+    }
+
+    s->collapse_remap[v0] = v1;
+    quadric_add(&s->vertex_quadrics[r1], &s->vertex_quadrics[r0]);
+    if (na) {
+      quadric_add(&s->attribute_quadrics[v1], &s->attribute_quadrics[v0]);
+      for (k = 0; k < na; k++) {
+        QuadricGrad *dst = &s->attribute_gradients[v1 * na + k];
+        QuadricGrad const *src = &s->attribute_gradients[v0 * na + k];
+        dst->gx += src->gx;
+        dst->gy += src->gy;
+        dst->gz += src->gz;
+        dst->gw += src->gw;
+      }
+    }
+
+    if (s->kind[r0] == KIND_BORDER) {
+      /* v0 leaves the border, its neighbours join up through v1 */
+      if (s->border_next[r0] == r1) {
+        uint32_t const prev = s->border_prev[r0];
+        s->border_next[prev] = r1;
+        s->border_prev[r1] = prev;
+      } else {
+        uint32_t const next = s->border_next[r0];
+        s->border_prev[next] = r1;
+        s->border_next[r1] = next;
+      }
+      triangles += 1;
+    } else {
+      triangles += 2;
+    }
+
+    if (collapse->error > s->error) s->error = collapse->error;
+    collapsed++;
+  }
+  return collapsed;
+}
+
+static void remove_degenerates(Simplifier *s) {
+  uint32_t write = 0;
+  uint32_t t;
+  for (t = 0; t < s->num_indices; t += 3) {
+    uint32_t const i0 = s->collapse_remap[s->indices[t]];
+    uint32_t const i1 = s->collapse_remap[s->indices[t + 1]];
+    uint32_t const i2 = s->collapse_remap[s->indices[t + 2]];
+    if (s->remap[i0] == s->remap[i1] || s->remap[i1] == s->remap[i2] || s->remap[i0] == s->remap[i2]) continue;
+    s->triangle_submesh[write / 3] = s->triangle_submesh[t / 3];
+    s->indices[write++] = i0;
+    s->indices[write++] = i1;
+    s->indices[write++] = i2;
+  }
+  s->num_indices = write;
+}
+
+/* Garland and Heckbert's greedy collapses done a pass at a time as
+ * meshoptimizer does. A pass aims for half the remaining triangle goal in
+ * edges, and to keep the order close to a priority queue stops at 1.5x the
+ * error of the edge that would get there */
+static void simplify_to(Simplifier *s, uint32_t target_triangles, float error_limit) {
+  float const limit = error_limit * error_limit;
+
+  while (s->num_indices / 3 > target_triangles) {
+    uint32_t const goal = s->num_indices / 3 - target_triangles;
+    uint32_t const edge_goal = goal / 2;
+    uint32_t const count = gather_collapses(s);
+    float error_goal = limit;
+
+    if (count == 0) break;
+    sort_collapses(s, count);
+    if (edge_goal < count) {
+      float const e = 1.5f * s->collapses[s->collapse_order[edge_goal]].error;
+      if (e < error_goal) error_goal = e;
+    }
+
+    build_adjacency(s);
+    if (perform_collapses(s, count, goal, error_goal) == 0) break;
+    remove_degenerates(s);
+  }
+}
+
+/* the triangles left keep the source submesh order, so each submesh is
+ * still one run */
+static int emit_lod(tinyobj_mesh_lod_t *lod, Simplifier const *s, tinyobj_mesh_t const *mesh) {
+  uint32_t const num_tris = s->num_indices / 3;
+  uint32_t t;
+  uint32_t i;
+
+  memset(lod, 0, sizeof(tinyobj_mesh_lod_t));
+  lod->num_indices = s->num_indices;
+  lod->index_size = mesh->index_size;
+  lod->error = sqrtf(s->error);
+
+  for (t = 0; t < num_tris; t++) {
+    if (t == 0 || s->triangle_submesh[t] != s->triangle_submesh[t - 1]) lod->num_submeshes++;
+  }
+  lod->indices = malloc((size_t) s->num_indices * lod->index_size + 1);
+  lod->submeshes = (tinyobj_submesh_t *) malloc(lod->num_submeshes * sizeof(tinyobj_submesh_t) + 1);
+  if (!lod->indices || !lod->submeshes) {
+    tinyobj_mesh_lod_free(lod);
+    return 0;
+  }
+
+  if (lod->index_size == 2) {
+    uint16_t *dst = (uint16_t *) lod->indices;
+    for (i = 0; i < s->num_indices; i++) dst[i] = (uint16_t) s->indices[i];
+  } else {
+    memcpy(lod->indices, s->indices, s->num_indices * sizeof(uint32_t));
+  }
+
+  lod->num_submeshes = 0;
+  for (t = 0; t < num_tris; t++) {
+    tinyobj_submesh_t *submesh;
+    if (t > 0 && s->triangle_submesh[t] == s->triangle_submesh[t - 1]) {
+      lod->submeshes[lod->num_submeshes - 1].index_count += 3;
+      continue;
+    }
+    submesh = &lod->submeshes[lod->num_submeshes++];
+    submesh->material_id = mesh->submeshes[s->triangle_submesh[t]].material_id;
+    submesh->index_offset = t * 3;
+    submesh->index_count = 3;
+  }
+  return 1;
+}
+
+void tinyobj_simplify_options_init(tinyobj_simplify_options_t *options) {
+  if (options == NULL) return;
+  options->num_levels = 4;
+  options->triangle_ratio = 0.5f;
+  options->target_error = 0.01f;
+  options->error_growth = 2.0f;
+  options->normal_weight = 0.1f;
+  options->texcoord_weight = 0.5f;
+  options->flags = 0;
+}
+
+int tinyobj_mesh_simplify(tinyobj_mesh_lod_t *lods,
+                          unsigned int *num_lods,
+                          tinyobj_mesh_t const *mesh,
+                          tinyobj_simplify_options_t const *options) {
+  tinyobj_simplify_options_t defaults;
+  Simplifier s;
+  uint32_t const source_triangles = mesh ? mesh->num_indices / 3 : 0;
+  uint32_t previous;
+  float ratio = 1.0f;
+  float limit;
+  unsigned int level;
+
+  if (lods == NULL || num_lods == NULL || mesh == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  *num_lods = 0;
+  if (options == NULL) {
+    tinyobj_simplify_options_init(&defaults);
+    options = &defaults;
+  }
+  if (mesh->index_size != 2 && mesh->index_size != 4) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (mesh->vertex_stride < 3) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (source_triangles == 0 || mesh->num_vertices == 0 || mesh->vertices == NULL || mesh->indices == NULL) {
+    return TINYOBJ_ERROR_EMPTY;
+  }
+
+  if (!simplifier_init(&s, mesh, options)) {
+    simplifier_free(&s);
+    LOGERROR("TINYOBJ: Out of memory simplifying mesh");
+    return TINYOBJ_ERROR_OUT_OF_MEMORY;
+  }
+
+  previous = source_triangles;
+  limit = options->target_error;
+  for (level = 0; level < options->num_levels; level++) {
+    uint32_t target = 0;
+    ratio *= options->triangle_ratio;
+    if (options->triangle_ratio > 0.0f) target = (uint32_t) ((float) source_triangles * ratio);
+
+    simplify_to(&s, target, limit);
+    if (s.num_indices / 3 >= previous) break;
+    if (!emit_lod(&lods[*num_lods], &s, mesh)) {
+      simplifier_free(&s);
+      LOGERROR("TINYOBJ: Out of memory simplifying mesh");
+      return TINYOBJ_ERROR_OUT_OF_MEMORY;
+    }
+    (*num_lods)++;
+    previous = s.num_indices / 3;
+    limit *= options->error_growth;
+  }
+
+  simplifier_free(&s);
+  return TINYOBJ_SUCCESS;
+}
+
+typedef struct {
+  tinyobj_simplify_job_t *jobs;
+  tinyobj_simplify_options_t const *options;
+} SimplifyMany;
+
+static void simplify_job(void *data, uint32_t index) {
+  SimplifyMany const *many = (SimplifyMany const *) data;
+  tinyobj_simplify_job_t *job = &many->jobs[index];
+  job->result = tinyobj_mesh_simplify(job->lods, &job->num_lods, job->mesh, many->options);
+}
+
+int tinyobj_mesh_simplify_many(tinyobj_simplify_job_t *jobs,
+                               unsigned int num_jobs,
+                               tinyobj_simplify_options_t const *options) {
+  tinyobj_simplify_options_t defaults;
+  SimplifyMany many;
+  unsigned int i;
+
+  if (jobs == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (options == NULL) {
+    tinyobj_simplify_options_init(&defaults);
+    options = &defaults;
+  }
+
+  many.jobs = jobs;
+  many.options = options;
+  if (options->flags & TINYOBJ_SIMPLIFY_FLAG_PARALLEL) {
+    Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &simplify_job, &many, num_jobs);
+  } else {
+    for (i = 0; i < num_jobs; i++) simplify_job(&many, i);
+  }
+
+  for (i = 0; i < num_jobs; i++) {
+    if (jobs[i].result != TINYOBJ_SUCCESS) return jobs[i].result;
+  }
+  return TINYOBJ_SUCCESS;
+}
+
+void tinyobj_mesh_lod_free(tinyobj_mesh_lod_t *lod) {
+  if (lod == NULL) return;
+  free(lod->indices);
+  free(lod->submeshes);
+  memset(lod, 0, sizeof(tinyobj_mesh_lod_t));
+}
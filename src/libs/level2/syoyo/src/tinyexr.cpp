@@ -4,6 +4,8 @@
 #include "syoyo/tiny_exr.hpp"
 #include "tinyexr.hpp"
 #include "miniz/miniz.h"
+#include "os/atomics.h"
+#include "os/threadpool.h"
 
 #include <algorithm>
 #include <stdio.h>
@@ -18,10 +20,6 @@
 #include <cstdint>
 #endif  // __cplusplus > 199711L
 
-#ifdef _OPENMP
-#include <omp.h>
-#endif
-
 #include "miniz/miniz.h"
 
 // Disable PIZ comporession when applying cpplint.
@@ -529,9 +527,11 @@ static void WriteChannelInfo(tinystl::vector<uint8_t>& data,
   (*p) = '\0';
 }
 
+// level is 1 (fastest) to 9 (smallest), 0 for the zlib default
 static void CompressZip(unsigned char *dst,
                         tinyexr::tinyexr_uint64& compressedSize,
-                        const unsigned char *src, unsigned long src_size) {
+                        const unsigned char *src, unsigned long src_size,
+                        int level) {
   tinystl::vector<uint8_t> tmpBuf(src_size);
 
   //
@@ -588,17 +588,17 @@ static void CompressZip(unsigned char *dst,
   //
 
   miniz::mz_ulong outSize = miniz::mz_compressBound(src_size);
-  int ret = miniz::mz_compress(
+  int ret = miniz::mz_compress2(
       dst, &outSize, static_cast<const unsigned char *>(&tmpBuf.at(0)),
-      src_size);
+      src_size, (level > 0) ? level : miniz::MZ_DEFAULT_COMPRESSION);
   assert(ret == miniz::MZ_OK);
   (void)ret;
 
   compressedSize = outSize;
 #else
   uLong outSize = compressBound(static_cast<uLong>(src_size));
-  int ret = compress(dst, &outSize, static_cast<const Bytef *>(tmpBuf.data()),
-                     src_size);
+  int ret = compress2(dst, &outSize, static_cast<const Bytef *>(tmpBuf.data()),
+                      src_size, (level > 0) ? level : Z_DEFAULT_COMPRESSION);
   assert(ret == Z_OK);
 
   compressedSize = outSize;
@@ -2714,7 +2714,8 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
                                       const int *requested_pixel_types,
                                       const unsigned char *data_ptr, size_t data_len,
                                       int compression_type, int line_order, int width,
-                                      int height, int x_stride, int y, int line_no,
+                                      int height, int x_stride, int pixel_stride,
+                                      int y, int line_no,
                                       int num_lines, size_t pixel_data_size,
                                       size_t num_attributes,
                                       const EXRAttribute *attributes, size_t num_channels,
@@ -2751,6 +2752,7 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
     //   pixel sample data for channel n for scanline 1
     //   ...
     for (size_t c = 0; c < static_cast<size_t>(num_channels); c++) {
+      if (out_images[c] == nullptr) { continue; }
       if (channels[c].pixel_type == TINYEXR_PIXELTYPE_HALF) {
         for (size_t v = 0; v < static_cast<size_t>(num_lines); v++) {
           const unsigned short *line_ptr = reinterpret_cast<unsigned short *>(
@@ -2772,12 +2774,12 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
               if (line_order == 0) {
                 image += (static_cast<size_t>(line_no) + v) *
                     static_cast<size_t>(x_stride) +
-                    u;
+                    u * static_cast<size_t>(pixel_stride);
               } else {
                 image += static_cast<size_t>(
                     (height - 1 - (line_no + static_cast<int>(v)))) *
                     static_cast<size_t>(x_stride) +
-                    u;
+                    u * static_cast<size_t>(pixel_stride);
               }
               *image = hf.u;
             } else {  // HALF -> FLOAT
@@ -2787,12 +2789,12 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
               if (line_order == 0) {
                 offset = (static_cast<size_t>(line_no) + v) *
                     static_cast<size_t>(x_stride) +
-                    u;
+                    u * static_cast<size_t>(pixel_stride);
               } else {
                 offset = static_cast<size_t>(
                     (height - 1 - (line_no + static_cast<int>(v)))) *
                     static_cast<size_t>(x_stride) +
-                    u;
+                    u * static_cast<size_t>(pixel_stride);
               }
               image += offset;
               *image = f32.f;
@@ -2818,12 +2820,12 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
             if (line_order == 0) {
               image += (static_cast<size_t>(line_no) + v) *
                   static_cast<size_t>(x_stride) +
-                  u;
+                  u * static_cast<size_t>(pixel_stride);
             } else {
               image += static_cast<size_t>(
                   (height - 1 - (line_no + static_cast<int>(v)))) *
                   static_cast<size_t>(x_stride) +
-                  u;
+                  u * static_cast<size_t>(pixel_stride);
             }
             *image = val;
           }
@@ -2832,8 +2834,8 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
         assert(requested_pixel_types[c] == TINYEXR_PIXELTYPE_FLOAT);
         for (size_t v = 0; v < static_cast<size_t>(num_lines); v++) {
           const float *line_ptr = reinterpret_cast<float *>(&outBuf.at(
-              v * pixel_data_size * static_cast<size_t>(x_stride) +
-                  channel_offset_list[c] * static_cast<size_t>(x_stride)));
+              v * pixel_data_size * static_cast<size_t>(width) +
+                  channel_offset_list[c] * static_cast<size_t>(width)));
           for (size_t u = 0; u < static_cast<size_t>(width); u++) {
             float val;
             // val = line_ptr[u];
@@ -2845,12 +2847,12 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
             if (line_order == 0) {
               image += (static_cast<size_t>(line_no) + v) *
                   static_cast<size_t>(x_stride) +
-                  u;
+                  u * static_cast<size_t>(pixel_stride);
             } else {
               image += static_cast<size_t>(
                   (height - 1 - (line_no + static_cast<int>(v)))) *
                   static_cast<size_t>(x_stride) +
-                  u;
+                  u * static_cast<size_t>(pixel_stride);
             }
             *image = val;
           }
@@ -2890,6 +2892,7 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
     //   pixel sample data for channel n for scanline 1
     //   ...
     for (size_t c = 0; c < static_cast<size_t>(num_channels); c++) {
+      if (out_images[c] == nullptr) { continue; }
       if (channels[c].pixel_type == TINYEXR_PIXELTYPE_HALF) {
         for (size_t v = 0; v < static_cast<size_t>(num_lines); v++) {
           const unsigned short *line_ptr = reinterpret_cast<unsigned short *>(
@@ -2910,12 +2913,12 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
               if (line_order == 0) {
                 image += (static_cast<size_t>(line_no) + v) *
                     static_cast<size_t>(x_stride) +
-                    u;
+                    u * static_cast<size_t>(pixel_stride);
               } else {
                 image += (static_cast<size_t>(height) - 1U -
                     (static_cast<size_t>(line_no) + v)) *
                     static_cast<size_t>(x_stride) +
-                    u;
+                    u * static_cast<size_t>(pixel_stride);
               }
               *image = hf.u;
             } else {  // HALF -> FLOAT
@@ -2925,12 +2928,12 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
               if (line_order == 0) {
                 offset = (static_cast<size_t>(line_no) + v) *
                     static_cast<size_t>(x_stride) +
-                    u;
+                    u * static_cast<size_t>(pixel_stride);
               } else {
                 offset = (static_cast<size_t>(height) - 1U -
                     (static_cast<size_t>(line_no) + v)) *
                     static_cast<size_t>(x_stride) +
-                    u;
+                    u * static_cast<size_t>(pixel_stride);
               }
               image += offset;
 
@@ -2957,12 +2960,12 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
             if (line_order == 0) {
               image += (static_cast<size_t>(line_no) + v) *
                   static_cast<size_t>(x_stride) +
-                  u;
+                  u * static_cast<size_t>(pixel_stride);
             } else {
               image += (static_cast<size_t>(height) - 1U -
                   (static_cast<size_t>(line_no) + v)) *
                   static_cast<size_t>(x_stride) +
-                  u;
+                  u * static_cast<size_t>(pixel_stride);
             }
             *image = val;
           }
@@ -2984,12 +2987,12 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
             if (line_order == 0) {
               image += (static_cast<size_t>(line_no) + v) *
                   static_cast<size_t>(x_stride) +
-                  u;
+                  u * static_cast<size_t>(pixel_stride);
             } else {
               image += (static_cast<size_t>(height) - 1U -
                   (static_cast<size_t>(line_no) + v)) *
                   static_cast<size_t>(x_stride) +
-                  u;
+                  u * static_cast<size_t>(pixel_stride);
             }
             *image = val;
           }
@@ -3027,6 +3030,7 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
     //   pixel sample data for channel n for scanline 1
     //   ...
     for (size_t c = 0; c < static_cast<size_t>(num_channels); c++) {
+      if (out_images[c] == nullptr) { continue; }
       if (channels[c].pixel_type == TINYEXR_PIXELTYPE_HALF) {
         for (size_t v = 0; v < static_cast<size_t>(num_lines); v++) {
           const unsigned short *line_ptr = reinterpret_cast<unsigned short *>(
@@ -3047,12 +3051,12 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
               if (line_order == 0) {
                 image += (static_cast<size_t>(line_no) + v) *
                     static_cast<size_t>(x_stride) +
-                    u;
+                    u * static_cast<size_t>(pixel_stride);
               } else {
                 image += (static_cast<size_t>(height) - 1U -
                     (static_cast<size_t>(line_no) + v)) *
                     static_cast<size_t>(x_stride) +
-                    u;
+                    u * static_cast<size_t>(pixel_stride);
               }
               *image = hf.u;
             } else {  // HALF -> FLOAT
@@ -3061,12 +3065,12 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
               if (line_order == 0) {
                 image += (static_cast<size_t>(line_no) + v) *
                     static_cast<size_t>(x_stride) +
-                    u;
+                    u * static_cast<size_t>(pixel_stride);
               } else {
                 image += (static_cast<size_t>(height) - 1U -
                     (static_cast<size_t>(line_no) + v)) *
                     static_cast<size_t>(x_stride) +
-                    u;
+                    u * static_cast<size_t>(pixel_stride);
               }
               *image = f32.f;
             }
@@ -3091,12 +3095,12 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
             if (line_order == 0) {
               image += (static_cast<size_t>(line_no) + v) *
                   static_cast<size_t>(x_stride) +
-                  u;
+                  u * static_cast<size_t>(pixel_stride);
             } else {
               image += (static_cast<size_t>(height) - 1U -
                   (static_cast<size_t>(line_no) + v)) *
                   static_cast<size_t>(x_stride) +
-                  u;
+                  u * static_cast<size_t>(pixel_stride);
             }
             *image = val;
           }
@@ -3118,12 +3122,12 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
             if (line_order == 0) {
               image += (static_cast<size_t>(line_no) + v) *
                   static_cast<size_t>(x_stride) +
-                  u;
+                  u * static_cast<size_t>(pixel_stride);
             } else {
               image += (static_cast<size_t>(height) - 1U -
                   (static_cast<size_t>(line_no) + v)) *
                   static_cast<size_t>(x_stride) +
-                  u;
+                  u * static_cast<size_t>(pixel_stride);
             }
             *image = val;
           }
@@ -3165,6 +3169,7 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
     //   pixel sample data for channel n for scanline 1
     //   ...
     for (size_t c = 0; c < static_cast<size_t>(num_channels); c++) {
+      if (out_images[c] == nullptr) { continue; }
       assert(channels[c].pixel_type == TINYEXR_PIXELTYPE_FLOAT);
       if (channels[c].pixel_type == TINYEXR_PIXELTYPE_FLOAT) {
         assert(requested_pixel_types[c] == TINYEXR_PIXELTYPE_FLOAT);
@@ -3182,12 +3187,12 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
             if (line_order == 0) {
               image += (static_cast<size_t>(line_no) + v) *
                            static_cast<size_t>(x_stride) +
-                       u;
+                       u * static_cast<size_t>(pixel_stride);
             } else {
               image += (static_cast<size_t>(height) - 1U -
                         (static_cast<size_t>(line_no) + v)) *
                            static_cast<size_t>(x_stride) +
-                       u;
+                       u * static_cast<size_t>(pixel_stride);
             }
             *image = val;
           }
@@ -3206,6 +3211,7 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
 #endif
   } else if (compression_type == TINYEXR_COMPRESSIONTYPE_NONE) {
     for (size_t c = 0; c < num_channels; c++) {
+      if (out_images[c] == nullptr) { continue; }
       for (size_t v = 0; v < static_cast<size_t>(num_lines); v++) {
         if (channels[c].pixel_type == TINYEXR_PIXELTYPE_HALF) {
           const unsigned short *line_ptr =
@@ -3231,7 +3237,7 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
 
               tinyexr::swap2(reinterpret_cast<unsigned short *>(&hf.u));
 
-              outLine[u] = hf.u;
+              outLine[u * pixel_stride] = hf.u;
             }
           } else if (requested_pixel_types[c] == TINYEXR_PIXELTYPE_FLOAT) {
             float *outLine = reinterpret_cast<float *>(out_images[c]);
@@ -3259,7 +3265,7 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
 
               tinyexr::FP32 f32 = half_to_float(hf);
 
-              outLine[u] = f32.f;
+              outLine[u * pixel_stride] = f32.f;
             }
           } else {
             assert(0);
@@ -3290,7 +3296,7 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
 
             tinyexr::swap4(reinterpret_cast<unsigned int *>(&val));
 
-            outLine[u] = val;
+            outLine[u * pixel_stride] = val;
           }
         } else if (channels[c].pixel_type == TINYEXR_PIXELTYPE_UINT) {
           const unsigned int *line_ptr = reinterpret_cast<const unsigned int *>(
@@ -3318,7 +3324,7 @@ static bool DecodePixelData(/* out */ unsigned char **out_images,
 
             tinyexr::swap4(reinterpret_cast<unsigned int *>(&val));
 
-            outLine[u] = val;
+            outLine[u * pixel_stride] = val;
           }
         }
       }
@@ -3356,7 +3362,7 @@ static void DecodeTiledPixelData(
   // Image size = tile size.
   DecodePixelData(out_images, requested_pixel_types, data_ptr, data_len,
                   compression_type, line_order, (*width), tile_size_y,
-      /* stride */ tile_size_x, /* y */ 0, /* line_no */ 0,
+      /* stride */ tile_size_x, /* pixel stride */ 1, /* y */ 0, /* line_no */ 0,
                   (*height), pixel_data_size, num_attributes, attributes,
                   num_channels, channels, channel_offset_list);
 }
@@ -3806,6 +3812,97 @@ static void ConvertHeader(EXRHeader *exr_header, const HeaderInfo& info) {
   exr_header->header_len = info.header_len;
 }
 
+struct ScanlineDecodeJob {
+  const EXRHeader *exr_header;
+  const tinystl::vector<uint64_t> *offsets;
+  const unsigned char *head;
+  size_t size;
+  unsigned char **out_images;
+  int data_width;
+  int data_height;
+  int x_stride;
+  int pixel_stride;
+  int num_scanline_blocks;
+  size_t pixel_data_size;
+  const tinystl::vector<size_t> *channel_offset_list;
+  volatile uint32_t invalid_data;
+};
+
+static void DecodeScanlineBlock(void *data, uint32_t index) {
+  ScanlineDecodeJob *job = static_cast<ScanlineDecodeJob *>(data);
+  int y = static_cast<int>(index);
+  size_t y_idx = static_cast<size_t>(y);
+
+  if ((*job->offsets)[y_idx] + sizeof(int) * 2 > job->size) {
+    Os_AtomicAdd32_relaxed(&job->invalid_data, 1);
+  } else {
+    // 4 byte: scan line
+    // 4 byte: data size
+    // ~     : pixel data(uncompressed or compressed)
+    size_t data_size = size_t(job->size - ((*job->offsets)[y_idx] + sizeof(int) * 2));
+    const unsigned char *data_ptr =
+        reinterpret_cast<const unsigned char *>(job->head + (*job->offsets)[y_idx]);
+
+    int line_no;
+    memcpy(&line_no, data_ptr, sizeof(int));
+    int data_len;
+    memcpy(&data_len, data_ptr + 4, sizeof(int));
+    tinyexr::swap4(reinterpret_cast<unsigned int *>(&line_no));
+    tinyexr::swap4(reinterpret_cast<unsigned int *>(&data_len));
+
+    if (size_t(data_len) > data_size) {
+      Os_AtomicAdd32_relaxed(&job->invalid_data, 1);
+    } else if (data_len == 0) {
+      // TODO(syoyo): May be ok to raise the threshold for example `data_len
+      // < 4`
+      Os_AtomicAdd32_relaxed(&job->invalid_data, 1);
+    } else {
+      // line_no may be negative.
+      int end_line_no = (std::min)(line_no + job->num_scanline_blocks,
+                                   (job->exr_header->data_window[3] + 1));
+
+      int num_lines = end_line_no - line_no;
+
+      if (num_lines <= 0) {
+        Os_AtomicAdd32_relaxed(&job->invalid_data, 1);
+      } else {
+        // Move to data addr: 8 = 4 + 4;
+        data_ptr += 8;
+
+        // Adjust line_no with data_window.bmin.y
+
+        // overflow check
+        tinyexr_int64
+            lno = static_cast<tinyexr_int64>(line_no) - static_cast<tinyexr_int64>(job->exr_header->data_window[1]);
+        if (lno > std::numeric_limits<int>::max()) {
+          line_no = -1; // invalid
+        } else if (lno < -std::numeric_limits<int>::max()) {
+          line_no = -1; // invalid
+        } else {
+          line_no -= job->exr_header->data_window[1];
+        }
+
+        if (line_no < 0) {
+          Os_AtomicAdd32_relaxed(&job->invalid_data, 1);
+        } else {
+          if (!tinyexr::DecodePixelData(
+              job->out_images, job->exr_header->requested_pixel_types,
+              data_ptr, static_cast<size_t>(data_len),
+              job->exr_header->compression_type, job->exr_header->line_order,
+              job->data_width, job->data_height, job->x_stride, job->pixel_stride, y, line_no,
+              num_lines, job->pixel_data_size,
+              static_cast<size_t>(job->exr_header->num_custom_attributes),
+              job->exr_header->custom_attributes,
+              static_cast<size_t>(job->exr_header->num_channels),
+              job->exr_header->channels, *job->channel_offset_list)) {
+            Os_AtomicAdd32_relaxed(&job->invalid_data, 1);
+          }
+        }
+      }
+    }
+  }
+}
+
 static int DecodeChunk(EXRImage *exr_image, const EXRHeader *exr_header,
                        const tinystl::vector<uint64_t>& offsets,
                        const unsigned char *head, const size_t size) {
@@ -3853,6 +3950,10 @@ static int DecodeChunk(EXRImage *exr_image, const EXRHeader *exr_header,
   bool invalid_data = false;  // TODO(LTE): Use atomic lock for MT safety.
 
   if (exr_header->tiled) {
+    if (exr_header->requested_interleaved) {
+      LOGERROR("Interleaved decoding of tiled images isn't supported.");
+      return TINYEXR_ERROR_UNSUPPORTED_FEATURE;
+    }
     // value check
     if (exr_header->tile_size_x < 0) {
       LOGERRORF("Invalid tile size x : %i", exr_header->tile_size_x);
@@ -3948,85 +4049,47 @@ static int DecodeChunk(EXRImage *exr_image, const EXRHeader *exr_header,
       return TINYEXR_ERROR_INVALID_DATA;
     }
 
-    exr_image->images = tinyexr::AllocateImage(
-        num_channels, exr_header->channels, exr_header->requested_pixel_types,
-        data_width, data_height);
-
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-    for (int y = 0; y < static_cast<int>(num_blocks); y++) {
-      size_t y_idx = static_cast<size_t>(y);
-
-      if (offsets[y_idx] + sizeof(int) * 2 > size) {
-        invalid_data = true;
-      } else {
-        // 4 byte: scan line
-        // 4 byte: data size
-        // ~     : pixel data(uncompressed or compressed)
-        size_t data_size = size_t(size - (offsets[y_idx] + sizeof(int) * 2));
-        const unsigned char *data_ptr =
-            reinterpret_cast<const unsigned char *>(head + offsets[y_idx]);
-
-        int line_no;
-        memcpy(&line_no, data_ptr, sizeof(int));
-        int data_len;
-        memcpy(&data_len, data_ptr + 4, sizeof(int));
-        tinyexr::swap4(reinterpret_cast<unsigned int *>(&line_no));
-        tinyexr::swap4(reinterpret_cast<unsigned int *>(&data_len));
-
-        if (size_t(data_len) > data_size) {
-          invalid_data = true;
-        } else if (data_len == 0) {
-          // TODO(syoyo): May be ok to raise the threshold for example `data_len
-          // < 4`
-          invalid_data = true;
-        } else {
-          // line_no may be negative.
-          int end_line_no = (std::min)(line_no + num_scanline_blocks,
-                                       (exr_header->data_window[3] + 1));
-
-          int num_lines = end_line_no - line_no;
-
-          if (num_lines <= 0) {
-            invalid_data = true;
-          } else {
-            // Move to data addr: 8 = 4 + 4;
-            data_ptr += 8;
-
-            // Adjust line_no with data_window.bmin.y
-
-            // overflow check
-            tinyexr_int64
-                lno = static_cast<tinyexr_int64>(line_no) - static_cast<tinyexr_int64>(exr_header->data_window[1]);
-            if (lno > std::numeric_limits<int>::max()) {
-              line_no = -1; // invalid
-            } else if (lno < -std::numeric_limits<int>::max()) {
-              line_no = -1; // invalid
-            } else {
-              line_no -= exr_header->data_window[1];
-            }
-
-            if (line_no < 0) {
-              invalid_data = true;
-            } else {
-              if (!tinyexr::DecodePixelData(
-                  exr_image->images, exr_header->requested_pixel_types,
-                  data_ptr, static_cast<size_t>(data_len),
-                  exr_header->compression_type, exr_header->line_order,
-                  data_width, data_height, data_width, y, line_no,
-                  num_lines, static_cast<size_t>(pixel_data_size),
-                  static_cast<size_t>(exr_header->num_custom_attributes),
-                  exr_header->custom_attributes,
-                  static_cast<size_t>(exr_header->num_channels),
-                  exr_header->channels, channel_offset_list)) {
-                invalid_data = true;
-              }
-            }
-          }
-        }
+    ScanlineDecodeJob job;
+    job.exr_header = exr_header;
+    job.offsets = &offsets;
+    job.head = head;
+    job.size = size;
+    job.data_width = data_width;
+    job.data_height = data_height;
+    job.num_scanline_blocks = num_scanline_blocks;
+    job.pixel_data_size = static_cast<size_t>(pixel_data_size);
+    job.channel_offset_list = &channel_offset_list;
+    job.invalid_data = 0;
+
+    tinystl::vector<unsigned char *> interleaved_images;
+    if (exr_header->requested_interleaved) {
+      // each channel points at its slot in the first pixel, the decoder then
+      // steps whole pixels and rows
+      interleaved_images.resize(static_cast<size_t>(num_channels));
+      for (size_t c = 0; c < static_cast<size_t>(num_channels); c++) {
+        int const slot = exr_header->requested_channel_slots[c];
+        size_t const type_size =
+            (exr_header->requested_pixel_types[c] == TINYEXR_PIXELTYPE_HALF) ? sizeof(unsigned short) : sizeof(float);
+        interleaved_images[c] = (slot < 0) ? nullptr :
+                                exr_header->requested_interleaved + static_cast<size_t>(slot) * type_size;
       }
-    }  // omp parallel
+      job.out_images = interleaved_images.data();
+      job.x_stride = data_width * exr_header->requested_pixel_stride;
+      job.pixel_stride = exr_header->requested_pixel_stride;
+    } else {
+      exr_image->images = tinyexr::AllocateImage(
+          num_channels, exr_header->channels, exr_header->requested_pixel_types,
+          data_width, data_height);
+      job.out_images = exr_image->images;
+      job.x_stride = data_width;
+      job.pixel_stride = 1;
+    }
+
+    // blocks are independent, so each is decompressed and unpacked on the
+    // thread pool
+    Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &DecodeScanlineBlock, &job,
+                             static_cast<uint32_t>(num_blocks));
+    invalid_data = job.invalid_data != 0;
   }
 
   if (invalid_data) {
@@ -4438,6 +4501,314 @@ int LoadEXRImageFromMemory(EXRImage *exr_image,
   return tinyexr::DecodeEXRImage(exr_image, exr_header, head, marker, size);
 }
 
+// number of levels and the size of a level for tiled mip and rip maps
+static int EXRLevelCount(int size, int rounding_mode) {
+  int levels = 1;
+  int s = size;
+  while (s > 1) {
+    if (rounding_mode == TINYEXR_TILE_ROUND_UP && (s & 1)) {
+      s = s / 2 + 1;
+    } else {
+      s = s / 2;
+    }
+    levels++;
+  }
+  return levels;
+}
+
+static int EXRLevelSize(int size, int level, int rounding_mode) {
+  int s = size >> level;
+  if (rounding_mode == TINYEXR_TILE_ROUND_UP && (s << level) < size) {
+    s++;
+  }
+  return (std::max)(s, 1);
+}
+
+static int EXRTileCount(int size, int tile_size) {
+  return (size + tile_size - 1) / tile_size;
+}
+
+struct RegionChunk {
+  int x;  // top left in level pixels
+  int y;
+  int width;
+  int height;
+  size_t data_offset;  // into the read chunk data
+  int data_len;
+};
+
+struct RegionDecodeJob {
+  const EXRHeader *exr_header;
+  const RegionChunk *chunks;
+  const unsigned char *data;
+  int region[4];
+  size_t element_size;
+  size_t pixel_data_size;
+  const tinystl::vector<size_t> *channel_offset_list;
+  volatile uint32_t invalid_data;
+};
+
+// decodes a whole chunk into scratch then copies out the part in the region
+static void DecodeRegionChunk(void *data, uint32_t index) {
+  RegionDecodeJob *job = static_cast<RegionDecodeJob *>(data);
+  const EXRHeader *exr_header = job->exr_header;
+  const RegionChunk &chunk = job->chunks[index];
+  size_t const pixel_size =
+      static_cast<size_t>(exr_header->requested_pixel_stride) * job->element_size;
+
+  tinystl::vector<unsigned char> scratch(
+      static_cast<size_t>(chunk.width) * static_cast<size_t>(chunk.height) * pixel_size);
+  tinystl::vector<unsigned char *> images(static_cast<size_t>(exr_header->num_channels));
+  for (size_t c = 0; c < static_cast<size_t>(exr_header->num_channels); c++) {
+    int const slot = exr_header->requested_channel_slots[c];
+    images[c] = (slot < 0) ? nullptr : scratch.data() + static_cast<size_t>(slot) * job->element_size;
+  }
+
+  // chunks are decoded top down whatever the line order
+  if (!DecodePixelData(images.data(), exr_header->requested_pixel_types,
+                       job->data + chunk.data_offset, static_cast<size_t>(chunk.data_len),
+                       exr_header->compression_type, 0, chunk.width, chunk.height,
+                       chunk.width * exr_header->requested_pixel_stride,
+                       exr_header->requested_pixel_stride, 0, 0, chunk.height,
+                       job->pixel_data_size,
+                       static_cast<size_t>(exr_header->num_custom_attributes),
+                       exr_header->custom_attributes,
+                       static_cast<size_t>(exr_header->num_channels),
+                       exr_header->channels, *job->channel_offset_list)) {
+    Os_AtomicAdd32_relaxed(&job->invalid_data, 1);
+    return;
+  }
+
+  int const x0 = (std::max)(job->region[0], chunk.x);
+  int const x1 = (std::min)(job->region[2], chunk.x + chunk.width - 1);
+  int const y0 = (std::max)(job->region[1], chunk.y);
+  int const y1 = (std::min)(job->region[3], chunk.y + chunk.height - 1);
+  size_t const region_width = static_cast<size_t>(job->region[2] - job->region[0] + 1);
+  for (int y = y0; y <= y1; y++) {
+    unsigned char *dst = exr_header->requested_interleaved +
+        (static_cast<size_t>(y - job->region[1]) * region_width + static_cast<size_t>(x0 - job->region[0])) *
+            pixel_size;
+    const unsigned char *src = scratch.data() +
+        (static_cast<size_t>(y - chunk.y) * static_cast<size_t>(chunk.width) + static_cast<size_t>(x0 - chunk.x)) *
+            pixel_size;
+    memcpy(dst, src, static_cast<size_t>(x1 - x0 + 1) * pixel_size);
+  }
+}
+
+int LoadEXRImageRegionFromHandle(const EXRHeader *exr_header, VFile_Handle handle,
+                                 const int region[4], int level_x, int level_y) {
+  if (exr_header == NULL || handle == NULL || region == NULL) {
+    LOGERROR("Invalid argument for LoadEXRImageRegionFromHandle");
+    return TINYEXR_ERROR_INVALID_ARGUMENT;
+  }
+  if (exr_header->header_len == 0) {
+    LOGERROR("EXRHeader variable is not initialized.");
+    return TINYEXR_ERROR_INVALID_ARGUMENT;
+  }
+  if (exr_header->requested_interleaved == NULL || exr_header->requested_channel_slots == NULL ||
+      exr_header->requested_pixel_stride <= 0) {
+    LOGERROR("Region loads decode into requested_interleaved, which isn't set");
+    return TINYEXR_ERROR_INVALID_ARGUMENT;
+  }
+
+  // the interleaved pixels are all one element type
+  size_t element_size = 0;
+  for (int c = 0; c < exr_header->num_channels; c++) {
+    if (exr_header->requested_channel_slots[c] < 0) { continue; }
+    size_t const size =
+        (exr_header->requested_pixel_types[c] == TINYEXR_PIXELTYPE_HALF) ? sizeof(unsigned short) : sizeof(float);
+    if (element_size != 0 && size != element_size) {
+      LOGERROR("Interleaved channels must all be the same size");
+      return TINYEXR_ERROR_INVALID_ARGUMENT;
+    }
+    element_size = size;
+  }
+  if (element_size == 0) {
+    LOGERROR("No channels requested");
+    return TINYEXR_ERROR_INVALID_ARGUMENT;
+  }
+
+  tinystl::vector<size_t> channel_offset_list;
+  int pixel_data_size = 0;
+  size_t channel_offset = 0;
+  if (!tinyexr::ComputeChannelLayout(&channel_offset_list, &pixel_data_size,
+                                     &channel_offset, exr_header->num_channels,
+                                     exr_header->channels)) {
+    LOGERROR("Failed to compute channel layout.");
+    return TINYEXR_ERROR_INVALID_DATA;
+  }
+
+  int const data_width = exr_header->data_window[2] - exr_header->data_window[0] + 1;
+  int const data_height = exr_header->data_window[3] - exr_header->data_window[1] + 1;
+  if (data_width <= 0 || data_height <= 0) {
+    LOGERROR("Invalid data window");
+    return TINYEXR_ERROR_INVALID_DATA;
+  }
+
+  // chunk grid of the level, chunks are stored row by row from first_chunk
+  int level_width = data_width;
+  int level_height = data_height;
+  int chunk_width = data_width;
+  int chunk_height = 1;
+  size_t first_chunk = 0;
+  if (exr_header->tiled) {
+    int const rounding = exr_header->tile_rounding_mode;
+    if (exr_header->tile_size_x <= 0 || exr_header->tile_size_y <= 0) {
+      LOGERROR("Invalid tile size");
+      return TINYEXR_ERROR_INVALID_HEADER;
+    }
+    chunk_width = exr_header->tile_size_x;
+    chunk_height = exr_header->tile_size_y;
+
+    int num_x_levels = 1;
+    int num_y_levels = 1;
+    if (exr_header->tile_level_mode == TINYEXR_TILE_MIPMAP_LEVELS) {
+      num_x_levels = num_y_levels = EXRLevelCount((std::max)(data_width, data_height), rounding);
+    } else if (exr_header->tile_level_mode == TINYEXR_TILE_RIPMAP_LEVELS) {
+      num_x_levels = EXRLevelCount(data_width, rounding);
+      num_y_levels = EXRLevelCount(data_height, rounding);
+    }
+    if (level_x < 0 || level_y < 0 || level_x >= num_x_levels || level_y >= num_y_levels ||
+        (exr_header->tile_level_mode != TINYEXR_TILE_RIPMAP_LEVELS && level_x != level_y)) {
+      LOGERRORF("Tile level %i, %i isn't in the file", level_x, level_y);
+      return TINYEXR_ERROR_INVALID_ARGUMENT;
+    }
+
+    // mip levels are stored in order, rip levels x fastest
+    if (exr_header->tile_level_mode == TINYEXR_TILE_MIPMAP_LEVELS) {
+      for (int l = 0; l < level_x; l++) {
+        first_chunk += static_cast<size_t>(EXRTileCount(EXRLevelSize(data_width, l, rounding), chunk_width)) *
+            static_cast<size_t>(EXRTileCount(EXRLevelSize(data_height, l, rounding), chunk_height));
+      }
+    } else if (exr_header->tile_level_mode == TINYEXR_TILE_RIPMAP_LEVELS) {
+      for (int ly = 0; ly <= level_y; ly++) {
+        for (int lx = 0; lx < num_x_levels; lx++) {
+          if (ly == level_y && lx == level_x) { break; }
+          first_chunk += static_cast<size_t>(EXRTileCount(EXRLevelSize(data_width, lx, rounding), chunk_width)) *
+              static_cast<size_t>(EXRTileCount(EXRLevelSize(data_height, ly, rounding), chunk_height));
+        }
+      }
+    }
+    level_width = EXRLevelSize(data_width, level_x, rounding);
+    level_height = EXRLevelSize(data_height, level_y, rounding);
+  } else {
+    if (level_x != 0 || level_y != 0) {
+      LOGERROR("Scanline images only have level 0");
+      return TINYEXR_ERROR_INVALID_ARGUMENT;
+    }
+    if (exr_header->compression_type == TINYEXR_COMPRESSIONTYPE_ZIP) {
+      chunk_height = 16;
+    } else if (exr_header->compression_type == TINYEXR_COMPRESSIONTYPE_PIZ) {
+      chunk_height = 32;
+    } else if (exr_header->compression_type == TINYEXR_COMPRESSIONTYPE_ZFP) {
+      chunk_height = 16;
+    }
+  }
+
+  if (region[0] < 0 || region[1] < 0 || region[2] >= level_width || region[3] >= level_height ||
+      region[0] > region[2] || region[1] > region[3]) {
+    LOGERRORF("Region %i,%i - %i,%i is outside the %ix%i level", region[0], region[1], region[2], region[3],
+              level_width, level_height);
+    return TINYEXR_ERROR_INVALID_ARGUMENT;
+  }
+
+  int const chunks_per_row = EXRTileCount(level_width, chunk_width);
+  int const cx0 = region[0] / chunk_width;
+  int const cx1 = region[2] / chunk_width;
+  int const cy0 = region[1] / chunk_height;
+  int const cy1 = region[3] / chunk_height;
+
+  // the EXR starts where the handle is, it may be inside a bigger file
+  int64_t const start = VFile_Tell(handle);
+  size_t const handle_size = VFile_Size(handle);
+  if (start < 0 || static_cast<size_t>(start) > handle_size) {
+    LOGERROR("Invalid file position in LoadEXRImageRegionFromHandle.");
+    return TINYEXR_ERROR_INVALID_DATA;
+  }
+  size_t const file_size = handle_size - static_cast<size_t>(start);
+  size_t const table_start = exr_header->header_len + kEXRVersionSize;
+
+  RegionDecodeJob job;
+  job.exr_header = exr_header;
+  memcpy(job.region, region, sizeof(job.region));
+  job.element_size = element_size;
+  job.pixel_data_size = static_cast<size_t>(pixel_data_size);
+  job.channel_offset_list = &channel_offset_list;
+  job.invalid_data = 0;
+
+  // chunks are read and decoded a batch at a time, a chunk per thread, so
+  // besides the region only a batch of chunks is held in memory
+  size_t const batch_size = static_cast<size_t>(Os_ThreadPoolWorkerCount(Os_ThreadPoolGlobal())) + 1;
+  tinystl::vector<RegionChunk> chunks;
+  tinystl::vector<unsigned char> chunk_data;
+  tinystl::vector<tinyexr_uint64> offsets(static_cast<size_t>(cx1 - cx0 + 1));
+  for (int cy = cy0; cy <= cy1; cy++) {
+    size_t const row_start = first_chunk + static_cast<size_t>(cy) * static_cast<size_t>(chunks_per_row);
+    if (!VFile_Seek(handle, start + static_cast<int64_t>(table_start + (row_start + static_cast<size_t>(cx0)) * 8),
+                    VFile_SD_Begin) ||
+        VFile_Read(handle, offsets.data(), offsets.size() * 8) != offsets.size() * 8) {
+      LOGERROR("Insufficient data size in offset table.");
+      return TINYEXR_ERROR_INVALID_DATA;
+    }
+
+    for (int cx = cx0; cx <= cx1; cx++) {
+      tinyexr_uint64 offset = offsets[static_cast<size_t>(cx - cx0)];
+      tinyexr::swap8(&offset);
+
+      // scanline: 4 byte line, 4 byte size. tile: 16 byte tile coordinates, 4 byte size
+      int chunk_header[5];
+      size_t const header_size = exr_header->tiled ? sizeof(int) * 5 : sizeof(int) * 2;
+      if (offset == 0 || offset > file_size || header_size > file_size - offset ||
+          !VFile_Seek(handle, start + static_cast<int64_t>(offset), VFile_SD_Begin) ||
+          VFile_Read(handle, chunk_header, header_size) != header_size) {
+        LOGERROR("Invalid offset value in LoadEXRImageRegionFromHandle.");
+        return TINYEXR_ERROR_INVALID_DATA;
+      }
+      for (size_t i = 0; i < header_size / sizeof(int); i++) {
+        tinyexr::swap4(reinterpret_cast<unsigned int *>(&chunk_header[i]));
+      }
+
+      RegionChunk chunk;
+      chunk.x = cx * chunk_width;
+      chunk.y = cy * chunk_height;
+      chunk.width = (std::min)(chunk_width, level_width - chunk.x);
+      chunk.height = (std::min)(chunk_height, level_height - chunk.y);
+      chunk.data_len = chunk_header[exr_header->tiled ? 4 : 1];
+      bool const matches = exr_header->tiled ?
+                           (chunk_header[0] == cx && chunk_header[1] == cy &&
+                               chunk_header[2] == level_x && chunk_header[3] == level_y) :
+                           (chunk_header[0] == chunk.y + exr_header->data_window[1]);
+      if (!matches || chunk.data_len <= 0 || size_t(chunk.data_len) > file_size - offset - header_size) {
+        LOGERROR("Invalid chunk in LoadEXRImageRegionFromHandle.");
+        return TINYEXR_ERROR_INVALID_DATA;
+      }
+
+      chunk.data_offset = chunk_data.size();
+      chunk_data.resize(chunk_data.size() + static_cast<size_t>(chunk.data_len));
+      if (VFile_Read(handle, chunk_data.data() + chunk.data_offset, static_cast<size_t>(chunk.data_len)) !=
+          static_cast<size_t>(chunk.data_len)) {
+        LOGERROR("Insufficient data size.");
+        return TINYEXR_ERROR_INVALID_DATA;
+      }
+      chunks.push_back(chunk);
+
+      if (chunks.size() == batch_size || (cy == cy1 && cx == cx1)) {
+        job.chunks = chunks.data();
+        job.data = chunk_data.data();
+        Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &DecodeRegionChunk, &job,
+                                 static_cast<uint32_t>(chunks.size()));
+        if (job.invalid_data != 0) {
+          LOGERROR("Invalid data found when decoding pixels.");
+          return TINYEXR_ERROR_INVALID_DATA;
+        }
+        chunks.clear();
+        chunk_data.clear();
+      }
+    }
+  }
+  return TINYEXR_SUCCESS;
+}
+
 int ParseEXRMultipartHeaderFromMemory(
     EXRHeader ***exr_headers,
     int *num_headers,
@@ -4508,6 +4879,281 @@ int ParseEXRMultipartHeaderFromMemory(
   return TINYEXR_SUCCESS;
 }
 
+struct ScanlineEncodeJob {
+  const EXRImage *exr_image;
+  const EXRHeader *exr_header;
+  const tinystl::vector<tinyexr::ChannelInfo> *channels;
+  const tinystl::vector<size_t> *channel_offset_list;
+  tinystl::vector<tinystl::vector<unsigned char> > *data_list;
+  int num_scanlines;
+  int pixel_data_size;
+  int compression_level;
+#if TINYEXR_USE_ZFP
+  tinyexr::ZFPCompressionParam zfp_compression_param;
+#endif
+};
+
+static void EncodeScanlineBlock(void *data, uint32_t index) {
+  ScanlineEncodeJob *job = static_cast<ScanlineEncodeJob *>(data);
+  const EXRImage *exr_image = job->exr_image;
+  const EXRHeader *exr_header = job->exr_header;
+  const tinystl::vector<tinyexr::ChannelInfo> &channels = *job->channels;
+  const tinystl::vector<size_t> &channel_offset_list = *job->channel_offset_list;
+  tinystl::vector<tinystl::vector<unsigned char> > &data_list = *job->data_list;
+  int const num_scanlines = job->num_scanlines;
+  int const pixel_data_size = job->pixel_data_size;
+  int i = static_cast<int>(index);
+  size_t ii = static_cast<size_t>(i);
+  int start_y = num_scanlines * i;
+  int endY = (std::min)(num_scanlines * (i + 1), exr_image->height);
+  int h = endY - start_y;
+
+  tinystl::vector<unsigned char> buf(
+      static_cast<size_t>(exr_image->width * h * pixel_data_size));
+
+  for (size_t c = 0; c < static_cast<size_t>(exr_header->num_channels); c++) {
+    if (exr_header->pixel_types[c] == TINYEXR_PIXELTYPE_HALF) {
+      if (exr_header->requested_pixel_types[c] == TINYEXR_PIXELTYPE_FLOAT) {
+        for (int y = 0; y < h; y++) {
+          // Assume increasing Y
+          float *line_ptr = reinterpret_cast<float *>(&buf.at(
+              static_cast<size_t>(pixel_data_size * y * exr_image->width) +
+                  channel_offset_list[c] *
+                      static_cast<size_t>(exr_image->width)));
+          for (int x = 0; x < exr_image->width; x++) {
+            tinyexr::FP16 h16;
+            h16.u = reinterpret_cast<unsigned short **>(
+                exr_image->images)[c][(y + start_y) * exr_image->width + x];
+
+            tinyexr::FP32 f32 = half_to_float(h16);
+
+            tinyexr::swap4(reinterpret_cast<unsigned int *>(&f32.f));
+
+            // line_ptr[x] = f32.f;
+            tinyexr::cpy4(line_ptr + x, &(f32.f));
+          }
+        }
+      } else if (exr_header->requested_pixel_types[c] ==
+          TINYEXR_PIXELTYPE_HALF) {
+        for (int y = 0; y < h; y++) {
+          // Assume increasing Y
+          unsigned short *line_ptr = reinterpret_cast<unsigned short *>(
+              &buf.at(static_cast<size_t>(pixel_data_size * y *
+                  exr_image->width) +
+                  channel_offset_list[c] *
+                      static_cast<size_t>(exr_image->width)));
+          for (int x = 0; x < exr_image->width; x++) {
+            unsigned short val = reinterpret_cast<unsigned short **>(
+                exr_image->images)[c][(y + start_y) * exr_image->width + x];
+
+            tinyexr::swap2(&val);
+
+            // line_ptr[x] = val;
+            tinyexr::cpy2(line_ptr + x, &val);
+          }
+        }
+      } else {
+        assert(0);
+      }
+
+    } else if (exr_header->pixel_types[c] == TINYEXR_PIXELTYPE_FLOAT) {
+      if (exr_header->requested_pixel_types[c] == TINYEXR_PIXELTYPE_HALF) {
+        for (int y = 0; y < h; y++) {
+          // Assume increasing Y
+          unsigned short *line_ptr = reinterpret_cast<unsigned short *>(
+              &buf.at(static_cast<size_t>(pixel_data_size * y *
+                  exr_image->width) +
+                  channel_offset_list[c] *
+                      static_cast<size_t>(exr_image->width)));
+          for (int x = 0; x < exr_image->width; x++) {
+            tinyexr::FP32 f32;
+            f32.f = reinterpret_cast<float **>(
+                exr_image->images)[c][(y + start_y) * exr_image->width + x];
+
+            tinyexr::FP16 h16;
+            h16 = float_to_half_full(f32);
+
+            tinyexr::swap2(reinterpret_cast<unsigned short *>(&h16.u));
+
+            // line_ptr[x] = h16.u;
+            tinyexr::cpy2(line_ptr + x, &(h16.u));
+          }
+        }
+      } else if (exr_header->requested_pixel_types[c] ==
+          TINYEXR_PIXELTYPE_FLOAT) {
+        for (int y = 0; y < h; y++) {
+          // Assume increasing Y
+          float *line_ptr = reinterpret_cast<float *>(&buf.at(
+              static_cast<size_t>(pixel_data_size * y * exr_image->width) +
+                  channel_offset_list[c] *
+                      static_cast<size_t>(exr_image->width)));
+          for (int x = 0; x < exr_image->width; x++) {
+            float val = reinterpret_cast<float **>(
+                exr_image->images)[c][(y + start_y) * exr_image->width + x];
+
+            tinyexr::swap4(reinterpret_cast<unsigned int *>(&val));
+
+            // line_ptr[x] = val;
+            tinyexr::cpy4(line_ptr + x, &val);
+          }
+        }
+      } else {
+        assert(0);
+      }
+    } else if (exr_header->pixel_types[c] == TINYEXR_PIXELTYPE_UINT) {
+      for (int y = 0; y < h; y++) {
+        // Assume increasing Y
+        unsigned int *line_ptr = reinterpret_cast<unsigned int *>(&buf.at(
+            static_cast<size_t>(pixel_data_size * y * exr_image->width) +
+                channel_offset_list[c] * static_cast<size_t>(exr_image->width)));
+        for (int x = 0; x < exr_image->width; x++) {
+          unsigned int val = reinterpret_cast<unsigned int **>(
+              exr_image->images)[c][(y + start_y) * exr_image->width + x];
+
+          tinyexr::swap4(&val);
+
+          // line_ptr[x] = val;
+          tinyexr::cpy4(line_ptr + x, &val);
+        }
+      }
+    }
+  }
+
+  if (exr_header->compression_type == TINYEXR_COMPRESSIONTYPE_NONE) {
+    // 4 byte: scan line
+    // 4 byte: data size
+    // ~     : pixel data(uncompressed)
+    tinystl::vector<unsigned char> header(8);
+    unsigned int data_len = static_cast<unsigned int>(buf.size());
+    memcpy(&header.at(0), &start_y, sizeof(int));
+    memcpy(&header.at(4), &data_len, sizeof(unsigned int));
+
+    tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(0)));
+    tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(4)));
+
+    data_list[ii].insert(data_list[ii].end(), header.begin(), header.end());
+    data_list[ii].insert(data_list[ii].end(), buf.begin(),
+                         buf.begin() + data_len);
+
+  } else if ((exr_header->compression_type == TINYEXR_COMPRESSIONTYPE_ZIPS) ||
+      (exr_header->compression_type == TINYEXR_COMPRESSIONTYPE_ZIP)) {
+#if TINYEXR_USE_MINIZ
+    tinystl::vector<unsigned char> block(tinyexr::miniz::mz_compressBound(
+        static_cast<unsigned long>(buf.size())));
+#else
+    tinystl::vector<unsigned char> block(
+        compressBound(static_cast<uLong>(buf.size())));
+#endif
+    tinyexr::tinyexr_uint64 outSize = block.size();
+
+    tinyexr::CompressZip(&block.at(0), outSize,
+                         reinterpret_cast<const unsigned char *>(&buf.at(0)),
+                         static_cast<unsigned long>(buf.size()),
+                         job->compression_level);
+
+    // 4 byte: scan line
+    // 4 byte: data size
+    // ~     : pixel data(compressed)
+    tinystl::vector<unsigned char> header(8);
+    unsigned int data_len = static_cast<unsigned int>(outSize);  // truncate
+    memcpy(&header.at(0), &start_y, sizeof(int));
+    memcpy(&header.at(4), &data_len, sizeof(unsigned int));
+
+    tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(0)));
+    tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(4)));
+
+    data_list[ii].insert(data_list[ii].end(), header.begin(), header.end());
+    data_list[ii].insert(data_list[ii].end(), block.begin(),
+                         block.begin() + data_len);
+
+  } else if (exr_header->compression_type == TINYEXR_COMPRESSIONTYPE_RLE) {
+    // (buf.size() * 3) / 2 would be enough.
+    tinystl::vector<unsigned char> block((buf.size() * 3) / 2);
+
+    tinyexr::tinyexr_uint64 outSize = block.size();
+
+    tinyexr::CompressRle(&block.at(0), outSize,
+                         reinterpret_cast<const unsigned char *>(&buf.at(0)),
+                         static_cast<unsigned long>(buf.size()));
+
+    // 4 byte: scan line
+    // 4 byte: data size
+    // ~     : pixel data(compressed)
+    tinystl::vector<unsigned char> header(8);
+    unsigned int data_len = static_cast<unsigned int>(outSize);  // truncate
+    memcpy(&header.at(0), &start_y, sizeof(int));
+    memcpy(&header.at(4), &data_len, sizeof(unsigned int));
+
+    tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(0)));
+    tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(4)));
+
+    data_list[ii].insert(data_list[ii].end(), header.begin(), header.end());
+    data_list[ii].insert(data_list[ii].end(), block.begin(),
+                         block.begin() + data_len);
+
+  } else if (exr_header->compression_type == TINYEXR_COMPRESSIONTYPE_PIZ) {
+#if TINYEXR_USE_PIZ
+    unsigned int bufLen =
+        8192 + static_cast<unsigned int>(
+            2 * static_cast<unsigned int>(
+                buf.size()));  // @fixme { compute good bound. }
+    tinystl::vector<unsigned char> block(bufLen);
+    unsigned int outSize = static_cast<unsigned int>(block.size());
+
+    CompressPiz(&block.at(0), &outSize,
+                reinterpret_cast<const unsigned char *>(&buf.at(0)),
+                buf.size(), channels, exr_image->width, h);
+
+    // 4 byte: scan line
+    // 4 byte: data size
+    // ~     : pixel data(compressed)
+    tinystl::vector<unsigned char> header(8);
+    unsigned int data_len = outSize;
+    memcpy(&header.at(0), &start_y, sizeof(int));
+    memcpy(&header.at(4), &data_len, sizeof(unsigned int));
+
+    tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(0)));
+    tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(4)));
+
+    data_list[ii].insert(data_list[ii].end(), header.begin(), header.end());
+    data_list[ii].insert(data_list[ii].end(), block.begin(),
+                         block.begin() + data_len);
+
+#else
+    assert(0);
+#endif
+  } else if (exr_header->compression_type == TINYEXR_COMPRESSIONTYPE_ZFP) {
+#if TINYEXR_USE_ZFP
+    tinystl::vector<unsigned char> block;
+    unsigned int outSize;
+
+    tinyexr::CompressZfp(
+        &block, &outSize, reinterpret_cast<const float *>(&buf.at(0)),
+        exr_image->width, h, exr_header->num_channels, job->zfp_compression_param);
+
+    // 4 byte: scan line
+    // 4 byte: data size
+    // ~     : pixel data(compressed)
+    tinystl::vector<unsigned char> header(8);
+    unsigned int data_len = outSize;
+    memcpy(&header.at(0), &start_y, sizeof(int));
+    memcpy(&header.at(4), &data_len, sizeof(unsigned int));
+
+    tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(0)));
+    tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(4)));
+
+    data_list[ii].insert(data_list[ii].end(), header.begin(), header.end());
+    data_list[ii].insert(data_list[ii].end(), block.begin(),
+                         block.begin() + data_len);
+
+#else
+    assert(0);
+#endif
+  } else {
+    assert(0);
+  }
+}
+
 size_t SaveEXRImageToMemory(const EXRImage *exr_image,
                             const EXRHeader *exr_header,
                             unsigned char **memory_out) {
@@ -4724,261 +5370,23 @@ size_t SaveEXRImageToMemory(const EXRImage *exr_image,
   }
 #endif
 
-// Use signed int since some OpenMP compiler doesn't allow unsigned type for
-// `parallel for`
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-  for (int i = 0; i < num_blocks; i++) {
-    size_t ii = static_cast<size_t>(i);
-    int start_y = num_scanlines * i;
-    int endY = (std::min)(num_scanlines * (i + 1), exr_image->height);
-    int h = endY - start_y;
-
-    tinystl::vector<unsigned char> buf(
-        static_cast<size_t>(exr_image->width * h * pixel_data_size));
-
-    for (size_t c = 0; c < static_cast<size_t>(exr_header->num_channels); c++) {
-      if (exr_header->pixel_types[c] == TINYEXR_PIXELTYPE_HALF) {
-        if (exr_header->requested_pixel_types[c] == TINYEXR_PIXELTYPE_FLOAT) {
-          for (int y = 0; y < h; y++) {
-            // Assume increasing Y
-            float *line_ptr = reinterpret_cast<float *>(&buf.at(
-                static_cast<size_t>(pixel_data_size * y * exr_image->width) +
-                    channel_offset_list[c] *
-                        static_cast<size_t>(exr_image->width)));
-            for (int x = 0; x < exr_image->width; x++) {
-              tinyexr::FP16 h16;
-              h16.u = reinterpret_cast<unsigned short **>(
-                  exr_image->images)[c][(y + start_y) * exr_image->width + x];
-
-              tinyexr::FP32 f32 = half_to_float(h16);
-
-              tinyexr::swap4(reinterpret_cast<unsigned int *>(&f32.f));
-
-              // line_ptr[x] = f32.f;
-              tinyexr::cpy4(line_ptr + x, &(f32.f));
-            }
-          }
-        } else if (exr_header->requested_pixel_types[c] ==
-            TINYEXR_PIXELTYPE_HALF) {
-          for (int y = 0; y < h; y++) {
-            // Assume increasing Y
-            unsigned short *line_ptr = reinterpret_cast<unsigned short *>(
-                &buf.at(static_cast<size_t>(pixel_data_size * y *
-                    exr_image->width) +
-                    channel_offset_list[c] *
-                        static_cast<size_t>(exr_image->width)));
-            for (int x = 0; x < exr_image->width; x++) {
-              unsigned short val = reinterpret_cast<unsigned short **>(
-                  exr_image->images)[c][(y + start_y) * exr_image->width + x];
-
-              tinyexr::swap2(&val);
-
-              // line_ptr[x] = val;
-              tinyexr::cpy2(line_ptr + x, &val);
-            }
-          }
-        } else {
-          assert(0);
-        }
-
-      } else if (exr_header->pixel_types[c] == TINYEXR_PIXELTYPE_FLOAT) {
-        if (exr_header->requested_pixel_types[c] == TINYEXR_PIXELTYPE_HALF) {
-          for (int y = 0; y < h; y++) {
-            // Assume increasing Y
-            unsigned short *line_ptr = reinterpret_cast<unsigned short *>(
-                &buf.at(static_cast<size_t>(pixel_data_size * y *
-                    exr_image->width) +
-                    channel_offset_list[c] *
-                        static_cast<size_t>(exr_image->width)));
-            for (int x = 0; x < exr_image->width; x++) {
-              tinyexr::FP32 f32;
-              f32.f = reinterpret_cast<float **>(
-                  exr_image->images)[c][(y + start_y) * exr_image->width + x];
-
-              tinyexr::FP16 h16;
-              h16 = float_to_half_full(f32);
-
-              tinyexr::swap2(reinterpret_cast<unsigned short *>(&h16.u));
-
-              // line_ptr[x] = h16.u;
-              tinyexr::cpy2(line_ptr + x, &(h16.u));
-            }
-          }
-        } else if (exr_header->requested_pixel_types[c] ==
-            TINYEXR_PIXELTYPE_FLOAT) {
-          for (int y = 0; y < h; y++) {
-            // Assume increasing Y
-            float *line_ptr = reinterpret_cast<float *>(&buf.at(
-                static_cast<size_t>(pixel_data_size * y * exr_image->width) +
-                    channel_offset_list[c] *
-                        static_cast<size_t>(exr_image->width)));
-            for (int x = 0; x < exr_image->width; x++) {
-              float val = reinterpret_cast<float **>(
-                  exr_image->images)[c][(y + start_y) * exr_image->width + x];
-
-              tinyexr::swap4(reinterpret_cast<unsigned int *>(&val));
-
-              // line_ptr[x] = val;
-              tinyexr::cpy4(line_ptr + x, &val);
-            }
-          }
-        } else {
-          assert(0);
-        }
-      } else if (exr_header->pixel_types[c] == TINYEXR_PIXELTYPE_UINT) {
-        for (int y = 0; y < h; y++) {
-          // Assume increasing Y
-          unsigned int *line_ptr = reinterpret_cast<unsigned int *>(&buf.at(
-              static_cast<size_t>(pixel_data_size * y * exr_image->width) +
-                  channel_offset_list[c] * static_cast<size_t>(exr_image->width)));
-          for (int x = 0; x < exr_image->width; x++) {
-            unsigned int val = reinterpret_cast<unsigned int **>(
-                exr_image->images)[c][(y + start_y) * exr_image->width + x];
-
-            tinyexr::swap4(&val);
-
-            // line_ptr[x] = val;
-            tinyexr::cpy4(line_ptr + x, &val);
-          }
-        }
-      }
-    }
-
-    if (exr_header->compression_type == TINYEXR_COMPRESSIONTYPE_NONE) {
-      // 4 byte: scan line
-      // 4 byte: data size
-      // ~     : pixel data(uncompressed)
-      tinystl::vector<unsigned char> header(8);
-      unsigned int data_len = static_cast<unsigned int>(buf.size());
-      memcpy(&header.at(0), &start_y, sizeof(int));
-      memcpy(&header.at(4), &data_len, sizeof(unsigned int));
-
-      tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(0)));
-      tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(4)));
-
-      data_list[ii].insert(data_list[ii].end(), header.begin(), header.end());
-      data_list[ii].insert(data_list[ii].end(), buf.begin(),
-                           buf.begin() + data_len);
-
-    } else if ((exr_header->compression_type == TINYEXR_COMPRESSIONTYPE_ZIPS) ||
-        (exr_header->compression_type == TINYEXR_COMPRESSIONTYPE_ZIP)) {
-#if TINYEXR_USE_MINIZ
-      tinystl::vector<unsigned char> block(tinyexr::miniz::mz_compressBound(
-          static_cast<unsigned long>(buf.size())));
-#else
-      tinystl::vector<unsigned char> block(
-          compressBound(static_cast<uLong>(buf.size())));
-#endif
-      tinyexr::tinyexr_uint64 outSize = block.size();
-
-      tinyexr::CompressZip(&block.at(0), outSize,
-                           reinterpret_cast<const unsigned char *>(&buf.at(0)),
-                           static_cast<unsigned long>(buf.size()));
-
-      // 4 byte: scan line
-      // 4 byte: data size
-      // ~     : pixel data(compressed)
-      tinystl::vector<unsigned char> header(8);
-      unsigned int data_len = static_cast<unsigned int>(outSize);  // truncate
-      memcpy(&header.at(0), &start_y, sizeof(int));
-      memcpy(&header.at(4), &data_len, sizeof(unsigned int));
-
-      tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(0)));
-      tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(4)));
-
-      data_list[ii].insert(data_list[ii].end(), header.begin(), header.end());
-      data_list[ii].insert(data_list[ii].end(), block.begin(),
-                           block.begin() + data_len);
-
-    } else if (exr_header->compression_type == TINYEXR_COMPRESSIONTYPE_RLE) {
-      // (buf.size() * 3) / 2 would be enough.
-      tinystl::vector<unsigned char> block((buf.size() * 3) / 2);
-
-      tinyexr::tinyexr_uint64 outSize = block.size();
-
-      tinyexr::CompressRle(&block.at(0), outSize,
-                           reinterpret_cast<const unsigned char *>(&buf.at(0)),
-                           static_cast<unsigned long>(buf.size()));
-
-      // 4 byte: scan line
-      // 4 byte: data size
-      // ~     : pixel data(compressed)
-      tinystl::vector<unsigned char> header(8);
-      unsigned int data_len = static_cast<unsigned int>(outSize);  // truncate
-      memcpy(&header.at(0), &start_y, sizeof(int));
-      memcpy(&header.at(4), &data_len, sizeof(unsigned int));
-
-      tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(0)));
-      tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(4)));
-
-      data_list[ii].insert(data_list[ii].end(), header.begin(), header.end());
-      data_list[ii].insert(data_list[ii].end(), block.begin(),
-                           block.begin() + data_len);
-
-    } else if (exr_header->compression_type == TINYEXR_COMPRESSIONTYPE_PIZ) {
-#if TINYEXR_USE_PIZ
-      unsigned int bufLen =
-          8192 + static_cast<unsigned int>(
-              2 * static_cast<unsigned int>(
-                  buf.size()));  // @fixme { compute good bound. }
-      tinystl::vector<unsigned char> block(bufLen);
-      unsigned int outSize = static_cast<unsigned int>(block.size());
-
-      CompressPiz(&block.at(0), &outSize,
-                  reinterpret_cast<const unsigned char *>(&buf.at(0)),
-                  buf.size(), channels, exr_image->width, h);
-
-      // 4 byte: scan line
-      // 4 byte: data size
-      // ~     : pixel data(compressed)
-      tinystl::vector<unsigned char> header(8);
-      unsigned int data_len = outSize;
-      memcpy(&header.at(0), &start_y, sizeof(int));
-      memcpy(&header.at(4), &data_len, sizeof(unsigned int));
-
-      tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(0)));
-      tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(4)));
-
-      data_list[ii].insert(data_list[ii].end(), header.begin(), header.end());
-      data_list[ii].insert(data_list[ii].end(), block.begin(),
-                           block.begin() + data_len);
-
-#else
-      assert(0);
-#endif
-    } else if (exr_header->compression_type == TINYEXR_COMPRESSIONTYPE_ZFP) {
+  ScanlineEncodeJob job;
+  job.exr_image = exr_image;
+  job.exr_header = exr_header;
+  job.channels = &channels;
+  job.channel_offset_list = &channel_offset_list;
+  job.data_list = &data_list;
+  job.num_scanlines = num_scanlines;
+  job.pixel_data_size = pixel_data_size;
+  job.compression_level = exr_header->compression_level;
 #if TINYEXR_USE_ZFP
-      tinystl::vector<unsigned char> block;
-      unsigned int outSize;
-
-      tinyexr::CompressZfp(
-          &block, &outSize, reinterpret_cast<const float *>(&buf.at(0)),
-          exr_image->width, h, exr_header->num_channels, zfp_compression_param);
-
-      // 4 byte: scan line
-      // 4 byte: data size
-      // ~     : pixel data(compressed)
-      tinystl::vector<unsigned char> header(8);
-      unsigned int data_len = outSize;
-      memcpy(&header.at(0), &start_y, sizeof(int));
-      memcpy(&header.at(4), &data_len, sizeof(unsigned int));
-
-      tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(0)));
-      tinyexr::swap4(reinterpret_cast<unsigned int *>(&header.at(4)));
-
-      data_list[ii].insert(data_list[ii].end(), header.begin(), header.end());
-      data_list[ii].insert(data_list[ii].end(), block.begin(),
-                           block.begin() + data_len);
-
-#else
-      assert(0);
+  job.zfp_compression_param = zfp_compression_param;
 #endif
-    } else {
-      assert(0);
-    }
-  }  // omp parallel
+
+  // blocks are independent, so each is converted and compressed on the
+  // thread pool and the offset table is built once they are all done
+  Os_ThreadPoolParallelFor(Os_ThreadPoolGlobal(), &EncodeScanlineBlock, &job,
+                           static_cast<uint32_t>(num_blocks));
 
   for (size_t i = 0; i < static_cast<size_t>(num_blocks); i++) {
     offsets[i] = offset;
@@ -5067,6 +5475,56 @@ int ParseEXRVersionFromMemory(EXRVersion *version,
   return TINYEXR_SUCCESS;
 }
 
+static bool ReadEXRHeaderString(VFile_Handle handle, char str[256]) {
+  for (int i = 0; i < 256; i++) {
+    if (VFile_Read(handle, &str[i], 1) != 1) {
+      return false;
+    }
+    if (str[i] == '\0') {
+      return true;
+    }
+  }
+  return false;
+}
+
+// walks the attributes of a single part header from the version onwards
+// without keeping them, returns the bytes up to and including the header
+// terminator or 0 if the header is malformed
+size_t ReadEXRHeaderSize(VFile_Handle handle) {
+  int64_t const start = VFile_Tell(handle);
+  int64_t const filesize = (int64_t) VFile_Size(handle);
+  size_t size = 0;
+  VFile_Seek(handle, kEXRVersionSize, VFile_SD_Current);
+
+  for (int nattr = 0; nattr < TINYEXR_MAX_HEADER_ATTRIBUTES; nattr++) {
+    // attribute name then type, both null terminated and under 256 chars
+    char name[256];
+    char type[256];
+    if (!ReadEXRHeaderString(handle, name)) {
+      break;
+    }
+    if (name[0] == '\0') {
+      // an empty name is the end of the header
+      size = (size_t) (VFile_Tell(handle) - start);
+      break;
+    }
+
+    uint32_t data_len;
+    if (!ReadEXRHeaderString(handle, type) ||
+        VFile_Read(handle, &data_len, sizeof(uint32_t)) != sizeof(uint32_t)) {
+      break;
+    }
+    tinyexr::swap4(&data_len);
+    if (VFile_Tell(handle) + (int64_t) data_len > filesize) {
+      break;
+    }
+    VFile_Seek(handle, data_len, VFile_SD_Current);
+  }
+
+  VFile_Seek(handle, start, VFile_SD_Begin);
+  return size;
+}
+
 int ParseEXRHeaderFromMemory(EXRHeader *exr_header, const EXRVersion *version,
                              const unsigned char *memory, size_t size) {
   if (memory == NULL || exr_header == NULL) {
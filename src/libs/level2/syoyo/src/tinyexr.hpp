@@ -14,6 +14,8 @@ int ParseEXRVersionFromMemory(EXRVersion *version,
 int ParseEXRHeaderFromMemory(EXRHeader *exr_header,
                              const EXRVersion *version,
                              const unsigned char *memory, size_t size);
+// leaves the file where it was
+size_t ReadEXRHeaderSize(VFile_Handle handle);
 int ParseEXRMultipartHeaderFromMemory(EXRHeader ***exr_headers,
                                       int *num_headers,
                                       const EXRVersion *exr_version,
@@ -25,6 +27,9 @@ int LoadEXRImageFromMemory(EXRImage *exr_image, const EXRHeader *exr_header,
 int LoadEXRMultipartImageFromMemory(EXRImage *exr_images, const EXRHeader **exr_headers, unsigned int num_parts,
                                     const unsigned char *memory, const size_t size);
 
+int LoadEXRImageRegionFromHandle(const EXRHeader *exr_header, VFile_Handle handle,
+                                 const int region[4], int level_x, int level_y);
+
 size_t SaveEXRImageToMemory(const EXRImage *exr_image, const EXRHeader *exr_header, unsigned char **memory_out);
 
 }
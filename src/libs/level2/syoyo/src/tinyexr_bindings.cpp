@@ -149,18 +149,25 @@ EXTERN_C int TinyExr_ParseEXRHeader(TinyExr_EXRHeader *header,
   }
 
   uint8_t* buf = nullptr;
+  size_t size = filesize;
   // if a memory vfile we can short and save memory
   if(VFile_GetType(handle) == VFile_Type_Memory) {
     VFile_MemFile_t* memFile = (VFile_MemFile_t*) VFile_GetTypeSpecificData(handle);
     buf = ((uint8_t*) memFile->memory) + memFile->offset;
   } else {
-    buf = (uint8_t * )malloc(filesize);
+    // only read the header, the pixel data may be much larger
+    size = ReadEXRHeaderSize(handle);
+    if (size == 0) {
+      LOGERRORF("Invalid EXR header %s", VFile_GetName(handle));
+      return TINYEXR_ERROR_INVALID_HEADER;
+    }
+    buf = (uint8_t * )malloc(size);
     size_t ret;
-    ret = VFile_Read(handle, buf, filesize);
-    ASSERT(ret <= filesize);
+    ret = VFile_Read(handle, buf, size);
+    ASSERT(ret <= size);
   }
 
-  int rete = ParseEXRHeaderFromMemory(header, version, buf, filesize);
+  int rete = ParseEXRHeaderFromMemory(header, version, buf, size);
 
   if(VFile_GetType(handle) != VFile_Type_Memory) {
     free(buf);
@@ -249,6 +256,24 @@ EXTERN_C int TinyExr_LoadEXRImage(TinyExr_EXRImage *exr_image,
   return rete;
 }
 
+EXTERN_C int TinyExr_LoadEXRImageRegion(const TinyExr_EXRHeader *exr_header,
+                                        VFile_Handle handle,
+                                        const int region[4],
+                                        int level_x,
+                                        int level_y) {
+  if (exr_header == NULL || region == NULL) {
+    LOGERROR("Invalid argument for LoadEXRImageRegion");
+    return TINYEXR_ERROR_INVALID_ARGUMENT;
+  }
+
+  if (!handle) {
+    LOGERROR("Cannot read a NULL file");
+    return TINYEXR_ERROR_CANT_OPEN_FILE;
+  }
+
+  return tinyexr::LoadEXRImageRegionFromHandle(exr_header, handle, region, level_x, level_y);
+}
+
 EXTERN_C int TinyExr_LoadEXRMultipartImage(
     TinyExr_EXRImage *exr_images,
     const TinyExr_EXRHeader **exr_headers,
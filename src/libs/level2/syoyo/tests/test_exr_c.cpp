@@ -184,4 +184,77 @@ TEST_CASE("Tiles/Ocean.exr", "[Load]") {
   SET_PATH();
   TestExr("Tiles/Ocean.exr", true);
   RESTORE_PATH();
-}
\ No newline at end of file
+}
+TEST_CASE("Save ZIP levels", "[Save]") {
+  // enough rows for many 16 line ZIP blocks
+  int const width = 97;
+  int const height = 301;
+  float *channels[3];
+  for (int c = 0; c < 3; ++c) {
+    channels[c] = (float *) malloc(sizeof(float) * width * height);
+    for (int i = 0; i < width * height; ++i) {
+      channels[c][i] = (float) ((i * (c + 3)) % 1021) / 256.0f;
+    }
+  }
+
+  TinyExr_EXRImage image;
+  TinyExr_InitEXRImage(&image);
+  image.num_channels = 3;
+  image.images = (unsigned char **) channels;
+  image.width = width;
+  image.height = height;
+
+  TinyExr_EXRChannelInfo infos[3];
+  memset(infos, 0, sizeof(infos));
+  strcpy(infos[0].name, "B");
+  strcpy(infos[1].name, "G");
+  strcpy(infos[2].name, "R");
+  int pixelTypes[3] = {TINYEXR_PIXELTYPE_FLOAT, TINYEXR_PIXELTYPE_FLOAT, TINYEXR_PIXELTYPE_FLOAT};
+
+  TinyExr_EXRHeader header;
+  TinyExr_InitEXRHeader(&header);
+  header.num_channels = 3;
+  header.channels = infos;
+  header.pixel_types = pixelTypes;
+  header.requested_pixel_types = pixelTypes;
+  header.compression_type = TINYEXR_COMPRESSIONTYPE_ZIP;
+
+  size_t sizes[2];
+  int const levels[2] = {1, 9};
+  for (int l = 0; l < 2; ++l) {
+    header.compression_level = levels[l];
+    VFile_Handle out = VFile_FromFile("save_zip_levels.exr", Os_FM_WriteBinary);
+    REQUIRE(out);
+    REQUIRE(TinyExr_SaveEXRImage(&image, &header, out) == TINYEXR_SUCCESS);
+
+    VFile::ScopedFile file = VFile::File::FromFile("save_zip_levels.exr", Os_FM_ReadBinary);
+    REQUIRE(file);
+    sizes[l] = file->Size();
+
+    TinyExr_EXRVersion version;
+    TinyExr_EXRHeader loadedHeader;
+    TinyExr_EXRImage loaded;
+    TinyExr_InitEXRHeader(&loadedHeader);
+    TinyExr_InitEXRImage(&loaded);
+    REQUIRE(TinyExr_ParseEXRVersion(&version, file) == TINYEXR_SUCCESS);
+    file->Seek(0, VFile_SD_Begin);
+    REQUIRE(TinyExr_ParseEXRHeader(&loadedHeader, &version, file) == TINYEXR_SUCCESS);
+    REQUIRE(loadedHeader.compression_type == TINYEXR_COMPRESSIONTYPE_ZIP);
+    file->Seek(0, VFile_SD_Begin);
+    REQUIRE(TinyExr_LoadEXRImage(&loaded, &loadedHeader, file) == TINYEXR_SUCCESS);
+    REQUIRE(loaded.width == width);
+    REQUIRE(loaded.height == height);
+    REQUIRE(loaded.num_channels == 3);
+    for (int c = 0; c < 3; ++c) {
+      REQUIRE(memcmp(loaded.images[c], channels[c], sizeof(float) * width * height) == 0);
+    }
+    TinyExr_FreeEXRHeader(&loadedHeader);
+    TinyExr_FreeEXRImage(&loaded);
+  }
+  REQUIRE(sizes[1] <= sizes[0]);
+
+  Os_FileDelete("save_zip_levels.exr");
+  for (int c = 0; c < 3; ++c) {
+    free(channels[c]);
+  }
+}
@@ -4,12 +4,20 @@
 #include "catch/catch.hpp"
 
 #include "syoyo/tiny_objloader.h"
+#include "syoyo/tiny_objcache.h"
+#include "syoyo/tiny_objmesh.h"
+#include "syoyo/tiny_objpack.h"
+#include "syoyo/tiny_objsimplify.h"
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
 
 static const char *gBasePath = "test_data/models/";
 
@@ -493,4 +501,816 @@ TEST_CASE("tr_and_d", "[Issue43]") {
     tinyobj_materials_free(materials, num_materials);
     tinyobj_shapes_free(shapes, num_shapes);
 }
- */
\ No newline at end of file
+ */
+TEST_CASE("parallel_parse", "[Loader]") {
+  // big enough to be split into several chunks, relative indices, groups and
+  // \r\n endings that straddle the chunk boundaries
+  std::string obj;
+  char line[256];
+  for (int g = 0; g < 64; ++g) {
+    snprintf(line, sizeof(line), "g group%d\r\nusemtl mat%d\n", g, g);
+    obj += line;
+    for (int i = 0; i < 1000; ++i) {
+      snprintf(line, sizeof(line), "v %d.5 %d.25 -%d\nvn 0 1 0\nvt 0.%d 0.5\n", i, g, i, i);
+      obj += line;
+      if (i >= 3) {
+        obj += (i & 1) ? "f -1/-1/-1 -2/-2/-2 -3/-3/-3 -4/-4/-4\n" : "f 1/1/1 2/2/2 3/3/3\r\n";
+      }
+    }
+  }
+  REQUIRE(obj.size() > 2 * 1024 * 1024);
+
+  tinyobj_attrib_t attrib[2];
+  tinyobj_shape_t *shapes[2] = {NULL, NULL};
+  size_t num_shapes[2];
+  tinyobj_material_t *materials[2] = {NULL, NULL};
+  size_t num_materials[2];
+  unsigned int const flags[2] = {TINYOBJ_FLAG_TRIANGULATE, TINYOBJ_FLAG_TRIANGULATE | TINYOBJ_FLAG_PARALLEL};
+  for (int i = 0; i < 2; ++i) {
+    REQUIRE(tinyobj_parse_obj(&attrib[i], &shapes[i], &num_shapes[i], &materials[i], &num_materials[i],
+                              obj.data(), obj.size(), flags[i]) == TINYOBJ_SUCCESS);
+  }
+
+  REQUIRE(attrib[0].num_vertices == 64000);
+  REQUIRE(attrib[0].num_face_num_verts == 64 * (499 * 2 + 498));
+  REQUIRE(attrib[1].num_vertices == attrib[0].num_vertices);
+  REQUIRE(attrib[1].num_normals == attrib[0].num_normals);
+  REQUIRE(attrib[1].num_texcoords == attrib[0].num_texcoords);
+  REQUIRE(attrib[1].num_faces == attrib[0].num_faces);
+  REQUIRE(attrib[1].num_face_num_verts == attrib[0].num_face_num_verts);
+  REQUIRE(memcmp(attrib[1].vertices, attrib[0].vertices, attrib[0].num_vertices * 3 * sizeof(float)) == 0);
+  REQUIRE(memcmp(attrib[1].normals, attrib[0].normals, attrib[0].num_normals * 3 * sizeof(float)) == 0);
+  REQUIRE(memcmp(attrib[1].texcoords, attrib[0].texcoords, attrib[0].num_texcoords * 2 * sizeof(float)) == 0);
+  REQUIRE(memcmp(attrib[1].faces, attrib[0].faces, attrib[0].num_faces * sizeof(tinyobj_vertex_index_t)) == 0);
+  REQUIRE(memcmp(attrib[1].face_num_verts, attrib[0].face_num_verts,
+                 attrib[0].num_face_num_verts * sizeof(int)) == 0);
+  REQUIRE(memcmp(attrib[1].material_ids, attrib[0].material_ids,
+                 attrib[0].num_face_num_verts * sizeof(int)) == 0);
+
+  // the last face of the first group used the 3 vertices before it
+  REQUIRE(attrib[0].faces[3 * 1494 + 0].v_idx == 999);
+  REQUIRE(attrib[0].faces[3 * 1494 + 2].v_idx == 997);
+  REQUIRE(attrib[0].faces[3 * 1494 + 2].vt_idx == 997);
+
+  REQUIRE(num_shapes[0] == 64);
+  REQUIRE(num_shapes[1] == num_shapes[0]);
+  for (size_t i = 0; i < num_shapes[0]; ++i) {
+    REQUIRE(strcmp(shapes[1][i].name, shapes[0][i].name) == 0);
+    REQUIRE(shapes[1][i].face_offset == shapes[0][i].face_offset);
+    REQUIRE(shapes[1][i].length == shapes[0][i].length);
+  }
+
+  for (int i = 0; i < 2; ++i) {
+    tinyobj_attrib_free(&attrib[i]);
+    tinyobj_materials_free(materials[i], num_materials[i]);
+    tinyobj_shapes_free(shapes[i], num_shapes[i]);
+  }
+}
+
+TEST_CASE("empty_parse", "[Loader]") {
+  tinyobj_attrib_t attrib;
+  tinyobj_shape_t *shapes = NULL;
+  size_t num_shapes = 0;
+  tinyobj_material_t *materials = NULL;
+  size_t num_materials = 0;
+  unsigned int const flags[2] = {TINYOBJ_FLAG_TRIANGULATE, TINYOBJ_FLAG_TRIANGULATE | TINYOBJ_FLAG_PARALLEL};
+  for (auto flag : flags) {
+    char const blank[] = "\n\r\n# nothing here\n  \n";
+    REQUIRE(tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials, &num_materials,
+                              blank, 0, flag) == TINYOBJ_ERROR_INVALID_PARAMETER);
+    REQUIRE(tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials, &num_materials,
+                              blank, sizeof(blank) - 1, flag) == TINYOBJ_SUCCESS);
+    REQUIRE(num_shapes == 0);
+    REQUIRE(attrib.num_vertices == 0);
+    REQUIRE(attrib.num_face_num_verts == 0);
+    tinyobj_attrib_free(&attrib);
+    tinyobj_shapes_free(shapes, num_shapes);
+    tinyobj_materials_free(materials, num_materials);
+  }
+}
+
+TEST_CASE("stream_parse", "[Loader]") {
+  // groups, materials, relative indices, \r\n endings and a line longer
+  // than the smallest window
+  char const mtl[] = "newmtl mat0\nKd 1 0 0\r\nnewmtl mat2\nKd 0 0 1\nmap_Kd blue.png";
+  VFile_Handle mtlFile = VFile_FromFile("stream_parse.mtl", Os_FM_Write);
+  REQUIRE(mtlFile);
+  VFile_Write(mtlFile, mtl, sizeof(mtl) - 1);
+  VFile_Close(mtlFile);
+
+  std::string obj = "mtllib stream_parse.mtl\n";
+  for (int g = 0; g < 8; ++g) {
+    obj += "g group" + std::to_string(g) + (g == 5 ? std::string(300, 'x') : std::string()) +
+        "\r\nusemtl mat" + std::to_string(g % 3) + "\n";
+    for (int i = 0; i < 200; ++i) {
+      std::string const n = std::to_string(i);
+      obj += "v " + n + ".5 " + std::to_string(g) + ".25 -" + n + "\nvn 0 1 0\nvt 0." + n + " 0.5\n";
+      if (i >= 3) {
+        obj += (i & 1) ? "f -1/-1/-1 -2/-2/-2 -3/-3/-3 -4/-4/-4\n" : "f 1/1/1 2/2/2 3/3/3\r\n";
+      }
+    }
+  }
+  VFile_Handle objFile = VFile_FromFile("stream_parse.obj", Os_FM_Write);
+  REQUIRE(objFile);
+  VFile_Write(objFile, obj.data(), obj.size());
+  VFile_Close(objFile);
+
+  tinyobj_attrib_t attrib;
+  tinyobj_shape_t *shapes = NULL;
+  size_t num_shapes;
+  tinyobj_material_t *materials = NULL;
+  size_t num_materials;
+  REQUIRE(tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials, &num_materials,
+                            obj.data(), obj.size(), TINYOBJ_FLAG_TRIANGULATE) == TINYOBJ_SUCCESS);
+  REQUIRE(num_materials == 2);
+  REQUIRE(num_shapes == 8);
+  // the long group name arrives whole
+  REQUIRE(strncmp(shapes[5].name, ("group5" + std::string(300, 'x')).c_str(), 6 + 300) == 0);
+  // 296 triangles a group, mat1 isn't in the mtl
+  REQUIRE(attrib.num_face_num_verts == 8 * 296);
+  REQUIRE(attrib.material_ids[0] == 0);
+  REQUIRE(attrib.material_ids[2 * 296] == 1);
+  REQUIRE(attrib.material_ids[296] == -1);
+
+  size_t const windows[] = {0, 4096, 100};
+  for (size_t window : windows) {
+    tinyobj_attrib_t streamed;
+    tinyobj_shape_t *streamedShapes = NULL;
+    size_t numStreamedShapes;
+    tinyobj_material_t *streamedMaterials = NULL;
+    size_t numStreamedMaterials;
+
+    VFile::ScopedFile file = VFile::File::FromFile("stream_parse.obj", Os_FM_ReadBinary);
+    REQUIRE(file);
+    REQUIRE(tinyobj_parse_obj_vfile(&streamed, &streamedShapes, &numStreamedShapes,
+                                    &streamedMaterials, &numStreamedMaterials, file, window,
+                                    TINYOBJ_FLAG_TRIANGULATE | TINYOBJ_FLAG_PARALLEL) == TINYOBJ_SUCCESS);
+
+    REQUIRE(streamed.num_vertices == attrib.num_vertices);
+    REQUIRE(streamed.num_normals == attrib.num_normals);
+    REQUIRE(streamed.num_texcoords == attrib.num_texcoords);
+    REQUIRE(streamed.num_faces == attrib.num_faces);
+    REQUIRE(streamed.num_face_num_verts == attrib.num_face_num_verts);
+    REQUIRE(memcmp(streamed.vertices, attrib.vertices, attrib.num_vertices * 3 * sizeof(float)) == 0);
+    REQUIRE(memcmp(streamed.normals, attrib.normals, attrib.num_normals * 3 * sizeof(float)) == 0);
+    REQUIRE(memcmp(streamed.texcoords, attrib.texcoords, attrib.num_texcoords * 2 * sizeof(float)) == 0);
+    REQUIRE(memcmp(streamed.faces, attrib.faces, attrib.num_faces * sizeof(tinyobj_vertex_index_t)) == 0);
+    REQUIRE(memcmp(streamed.face_num_verts, attrib.face_num_verts,
+                   attrib.num_face_num_verts * sizeof(int)) == 0);
+    REQUIRE(memcmp(streamed.material_ids, attrib.material_ids,
+                   attrib.num_face_num_verts * sizeof(int)) == 0);
+
+    REQUIRE(numStreamedShapes == num_shapes);
+    for (size_t i = 0; i < num_shapes; ++i) {
+      REQUIRE(strcmp(streamedShapes[i].name, shapes[i].name) == 0);
+      REQUIRE(streamedShapes[i].face_offset == shapes[i].face_offset);
+      REQUIRE(streamedShapes[i].length == shapes[i].length);
+    }
+    REQUIRE(numStreamedMaterials == num_materials);
+
+    tinyobj_attrib_free(&streamed);
+    tinyobj_materials_free(streamedMaterials, numStreamedMaterials);
+    tinyobj_shapes_free(streamedShapes, numStreamedShapes);
+  }
+
+  // mtl from memory, the last line has no line ending
+  VFile_Handle memory = VFile_FromMemory((void *) mtl, sizeof(mtl) - 1, false);
+  tinyobj_material_t *memoryMaterials = NULL;
+  size_t numMemoryMaterials = 0;
+  REQUIRE(tinyobj_parse_mtl_vfile(&memoryMaterials, &numMemoryMaterials, memory) == TINYOBJ_SUCCESS);
+  VFile_Close(memory);
+  REQUIRE(numMemoryMaterials == 2);
+  REQUIRE(strcmp(memoryMaterials[0].name, "mat0") == 0);
+  REQUIRE(memoryMaterials[0].diffuse[0] == 1.0f);
+  REQUIRE(strcmp(memoryMaterials[1].name, "mat2") == 0);
+  REQUIRE(memoryMaterials[1].diffuse[2] == 1.0f);
+  REQUIRE(strcmp(memoryMaterials[1].diffuse_texname, "blue.png") == 0);
+  tinyobj_materials_free(memoryMaterials, numMemoryMaterials);
+
+  tinyobj_attrib_free(&attrib);
+  tinyobj_materials_free(materials, num_materials);
+  tinyobj_shapes_free(shapes, num_shapes);
+  Os_FileDelete("stream_parse.obj");
+  Os_FileDelete("stream_parse.mtl");
+}
+
+TEST_CASE("number_parse", "[Loader]") {
+  // values the old double based parse rounded wrongly, long mantissas and
+  // exponents, all must match strtof bit for bit
+  char const *const values[] = {"0.1", "-1.000000059604644775390625", "16777217", "3.4028235e38",
+                                "1.17549435e-38", "7.038531e-26", "-0.0", ".5", "123456.789012345678901",
+                                "2.5e-3", "1E2", "0.3333333333333333333333333333333333333333"};
+  size_t const numValues = sizeof(values) / sizeof(values[0]);
+  std::string obj;
+  for (size_t i = 0; i < numValues; ++i) {
+    obj += std::string("v ") + values[i] + " " + values[(i + 1) % numValues] + " " + values[(i + 2) % numValues] + "\n";
+  }
+  obj += "f 1 +2 -1\n";
+
+  tinyobj_attrib_t attrib;
+  tinyobj_shape_t *shapes = NULL;
+  size_t num_shapes;
+  tinyobj_material_t *materials = NULL;
+  size_t num_materials;
+  REQUIRE(tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials, &num_materials,
+                            obj.data(), obj.size(), TINYOBJ_FLAG_TRIANGULATE) == TINYOBJ_SUCCESS);
+  REQUIRE(attrib.num_vertices == numValues);
+  for (size_t i = 0; i < numValues * 3; ++i) {
+    float const expected = strtof(values[(i / 3 + i % 3) % numValues], NULL);
+    REQUIRE(memcmp(&attrib.vertices[i], &expected, sizeof(float)) == 0);
+  }
+  REQUIRE(attrib.num_faces == 3);
+  REQUIRE(attrib.faces[0].v_idx == 0);
+  REQUIRE(attrib.faces[1].v_idx == 1);
+  REQUIRE(attrib.faces[2].v_idx == (int) numValues - 1);
+
+  tinyobj_attrib_free(&attrib);
+  tinyobj_materials_free(materials, num_materials);
+  tinyobj_shapes_free(shapes, num_shapes);
+}
+
+TEST_CASE("obj_cache", "[Loader]") {
+  char existCurDir[1024];
+  Os_GetCurrentDir(existCurDir, sizeof(existCurDir));
+  char path[2048];
+  strcpy(path, existCurDir);
+  strcat(path, gBasePath);
+  REQUIRE(Os_SetCurrentDir(path));
+  Os_FileDelete("cube.objcache");
+
+  VFile::ScopedFile file = VFile::File::FromFile("cube.obj", Os_FM_ReadBinary);
+  REQUIRE(file);
+  std::string source(file->Size(), '\0');
+  file->Read(&source[0], source.size());
+
+  tinyobj_attrib_t expected;
+  tinyobj_shape_t *expectedShapes = NULL;
+  size_t numExpectedShapes;
+  tinyobj_material_t *expectedMaterials = NULL;
+  size_t numExpectedMaterials;
+  REQUIRE(tinyobj_parse_obj(&expected, &expectedShapes, &numExpectedShapes,
+                            &expectedMaterials, &numExpectedMaterials,
+                            source.data(), source.size(), TINYOBJ_FLAG_TRIANGULATE) == TINYOBJ_SUCCESS);
+
+  // first a miss that writes the cache, then a hit out of it
+  for (int pass = 0; pass < 2; ++pass) {
+    tinyobj_attrib_t attrib;
+    tinyobj_shape_t const *shapes = NULL;
+    size_t numShapes;
+    tinyobj_material_t const *materials = NULL;
+    size_t numMaterials;
+    tinyobj_cache_handle cache = NULL;
+    REQUIRE(tinyobj_parse_obj_cached(&attrib, &shapes, &numShapes, &materials, &numMaterials,
+                                     "cube.obj", "cube.objcache",
+                                     TINYOBJ_FLAG_TRIANGULATE, &cache) == TINYOBJ_SUCCESS);
+    REQUIRE(cache);
+    REQUIRE(tinyobj_cache_was_hit(cache) == pass);
+
+    REQUIRE(attrib.num_vertices == expected.num_vertices);
+    REQUIRE(attrib.num_faces == expected.num_faces);
+    REQUIRE(attrib.num_face_num_verts == expected.num_face_num_verts);
+    REQUIRE(memcmp(attrib.vertices, expected.vertices, expected.num_vertices * 3 * sizeof(float)) == 0);
+    REQUIRE(memcmp(attrib.faces, expected.faces, expected.num_faces * sizeof(tinyobj_vertex_index_t)) == 0);
+    REQUIRE(memcmp(attrib.material_ids, expected.material_ids, expected.num_face_num_verts * sizeof(int)) == 0);
+    REQUIRE(numShapes == numExpectedShapes);
+    for (size_t i = 0; i < numShapes; ++i) {
+      REQUIRE(strcmp(shapes[i].name, expectedShapes[i].name) == 0);
+      REQUIRE(shapes[i].length == expectedShapes[i].length);
+    }
+    REQUIRE(numMaterials == numExpectedMaterials);
+    for (size_t i = 0; i < numMaterials; ++i) {
+      REQUIRE(strcmp(materials[i].name, expectedMaterials[i].name) == 0);
+      REQUIRE(materials[i].diffuse[1] == expectedMaterials[i].diffuse[1]);
+      REQUIRE((materials[i].diffuse_texname == NULL) == (expectedMaterials[i].diffuse_texname == NULL));
+    }
+    tinyobj_cache_free(cache);
+  }
+
+  // different parse flags are a miss
+  {
+    tinyobj_attrib_t attrib;
+    tinyobj_shape_t const *shapes = NULL;
+    size_t numShapes;
+    tinyobj_material_t const *materials = NULL;
+    size_t numMaterials;
+    tinyobj_cache_handle cache = NULL;
+    REQUIRE(tinyobj_parse_obj_cached(&attrib, &shapes, &numShapes, &materials, &numMaterials,
+                                     "cube.obj", "cube.objcache", 0, &cache) == TINYOBJ_SUCCESS);
+    REQUIRE(tinyobj_cache_was_hit(cache) == 0);
+    REQUIRE(attrib.num_face_num_verts < expected.num_face_num_verts);
+    tinyobj_cache_free(cache);
+  }
+
+  // an explicit save keyed on the same source is a hit, strings included
+  {
+    tinyobj_material_t material;
+    memset(&material, 0, sizeof(material));
+    material.name = (char *) "red";
+    material.diffuse[0] = 1.0f;
+    material.diffuse_texname = (char *) "red.png";
+    REQUIRE(tinyobj_cache_save("cube.objcache", "cube.obj", TINYOBJ_FLAG_TRIANGULATE,
+                               &expected, expectedShapes, numExpectedShapes, &material, 1) == TINYOBJ_SUCCESS);
+
+    tinyobj_attrib_t attrib;
+    tinyobj_shape_t const *shapes = NULL;
+    size_t numShapes;
+    tinyobj_material_t const *materials = NULL;
+    size_t numMaterials;
+    tinyobj_cache_handle cache = NULL;
+    REQUIRE(tinyobj_parse_obj_cached(&attrib, &shapes, &numShapes, &materials, &numMaterials,
+                                     "cube.obj", "cube.objcache",
+                                     TINYOBJ_FLAG_TRIANGULATE, &cache) == TINYOBJ_SUCCESS);
+    REQUIRE(tinyobj_cache_was_hit(cache));
+    REQUIRE(attrib.num_faces == expected.num_faces);
+    REQUIRE(numMaterials == 1);
+    REQUIRE(strcmp(materials[0].name, "red") == 0);
+    REQUIRE(strcmp(materials[0].diffuse_texname, "red.png") == 0);
+    REQUIRE(materials[0].ambient_texname == NULL);
+    REQUIRE(materials[0].diffuse[0] == 1.0f);
+    tinyobj_cache_free(cache);
+  }
+
+  // caches are renamed into place, nothing is left beside them
+  REQUIRE(!Os_FileExists("cube.objcache.tmp"));
+
+  tinyobj_attrib_free(&expected);
+  tinyobj_materials_free(expectedMaterials, numExpectedMaterials);
+  tinyobj_shapes_free(expectedShapes, numExpectedShapes);
+  Os_FileDelete("cube.objcache");
+  Os_SetCurrentDir(existCurDir);
+}
+
+static std::string ReadWholeFile(char const *name) {
+  VFile::ScopedFile file = VFile::File::FromFile(name, Os_FM_ReadBinary);
+  REQUIRE(file);
+  std::string data(file->Size(), '\0');
+  file->Read(&data[0], data.size());
+  return data;
+}
+
+static void WriteWholeFile(char const *name, std::string const &data) {
+  VFile::ScopedFile file = VFile::File::FromFile(name, Os_FM_WriteBinary);
+  REQUIRE(file);
+  file->Write(data.data(), data.size());
+}
+
+// returns whether the load came from the cache
+static bool LoadCached(char const *obj, char const *objcache, unsigned int *numVertices = nullptr) {
+  tinyobj_attrib_t attrib;
+  tinyobj_shape_t const *shapes = NULL;
+  size_t numShapes;
+  tinyobj_material_t const *materials = NULL;
+  size_t numMaterials;
+  tinyobj_cache_handle cache = NULL;
+  REQUIRE(tinyobj_parse_obj_cached(&attrib, &shapes, &numShapes, &materials, &numMaterials,
+                                   obj, objcache, TINYOBJ_FLAG_TRIANGULATE, &cache) == TINYOBJ_SUCCESS);
+  bool const hit = tinyobj_cache_was_hit(cache) != 0;
+  if (numVertices) { *numVertices = attrib.num_vertices; }
+  tinyobj_cache_free(cache);
+  return hit;
+}
+
+TEST_CASE("obj_cache_key", "[Loader]") {
+  char existCurDir[1024];
+  Os_GetCurrentDir(existCurDir, sizeof(existCurDir));
+  char path[2048];
+  strcpy(path, existCurDir);
+  strcat(path, gBasePath);
+  REQUIRE(Os_SetCurrentDir(path));
+  Os_FileDelete("edit.objcache");
+
+  WriteWholeFile("edit.obj", "g a\nv 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n");
+  REQUIRE(!LoadCached("edit.obj", "edit.objcache"));
+  REQUIRE(LoadCached("edit.obj", "edit.objcache"));
+
+  // a matching size and time is a hit without hashing the .obj, even if
+  // the stored hash is wrong
+  std::string cache = ReadWholeFile("edit.objcache");
+  uint64_t const wrongHash = 0x1234;
+  memcpy(&cache[24], &wrongHash, sizeof(wrongHash));
+  WriteWholeFile("edit.objcache", cache);
+  REQUIRE(LoadCached("edit.obj", "edit.objcache"));
+
+  // with a different time the hash decides, the wrong hash is a miss
+  uint64_t const staleTime = 1;
+  memcpy(&cache[16], &staleTime, sizeof(staleTime));
+  WriteWholeFile("edit.objcache", cache);
+  REQUIRE(!LoadCached("edit.obj", "edit.objcache"));
+  REQUIRE(LoadCached("edit.obj", "edit.objcache"));
+
+  // a stale time with the right content is a hit, the cache isn't rewritten
+  cache = ReadWholeFile("edit.objcache");
+  memcpy(&cache[16], &staleTime, sizeof(staleTime));
+  WriteWholeFile("edit.objcache", cache);
+  REQUIRE(LoadCached("edit.obj", "edit.objcache"));
+  REQUIRE(ReadWholeFile("edit.objcache") == cache);
+
+  // same size, different content, the time differs from the cache's
+  WriteWholeFile("edit.obj", "g b\nv 0 0 0\nv 2 0 0\nv 0 2 0\nf 1 2 3\n");
+  unsigned int numVertices = 0;
+  REQUIRE(!LoadCached("edit.obj", "edit.objcache", &numVertices));
+  REQUIRE(numVertices == 3);
+  REQUIRE(LoadCached("edit.obj", "edit.objcache"));
+  cache = ReadWholeFile("edit.objcache");
+
+  // the last string ends the file, without its terminator it's a miss
+  REQUIRE(cache.back() == '\0');
+  cache.back() = 'x';
+  WriteWholeFile("edit.objcache", cache);
+  REQUIRE(!LoadCached("edit.obj", "edit.objcache"));
+  REQUIRE(LoadCached("edit.obj", "edit.objcache"));
+  REQUIRE(!Os_FileExists("edit.objcache.tmp"));
+
+  Os_FileDelete("edit.objcache");
+  Os_FileDelete("edit.obj");
+  Os_SetCurrentDir(existCurDir);
+}
+
+TEST_CASE("mesh_build", "[Mesh]") {
+  // a 32x32 grid of quads written in a scrambled order
+  int const N = 32;
+  std::string obj;
+  char line[256];
+  for (int y = 0; y <= N; ++y) {
+    for (int x = 0; x <= N; ++x) {
+      snprintf(line, sizeof(line), "v %d %d 0\nvt %f %f\n", x, y, x / (float) N, y / (float) N);
+      obj += line;
+    }
+  }
+  for (int q = 0; q < N * N; ++q) {
+    int const s = (q * 577) % (N * N);
+    int const i = (s / N) * (N + 1) + (s % N) + 1;
+    snprintf(line, sizeof(line), "f %d/%d %d/%d %d/%d %d/%d\n",
+             i, i, i + 1, i + 1, i + N + 2, i + N + 2, i + N + 1, i + N + 1);
+    obj += line;
+  }
+
+  tinyobj_attrib_t attrib;
+  tinyobj_shape_t *shapes = NULL;
+  size_t numShapes;
+  tinyobj_material_t *materials = NULL;
+  size_t numMaterials;
+  REQUIRE(tinyobj_parse_obj(&attrib, &shapes, &numShapes, &materials, &numMaterials,
+                            obj.data(), obj.size(), 0) == TINYOBJ_SUCCESS);
+  REQUIRE(attrib.num_face_num_verts == N * N);
+
+  // triangles as sorted grid vertex ids, which must survive any reordering
+  auto triangles = [](tinyobj_mesh_t const& mesh) {
+    std::vector<uint32_t> tris;
+    for (unsigned int i = 0; i < mesh.num_indices; i += 3) {
+      uint32_t ids[3];
+      for (int c = 0; c < 3; ++c) {
+        uint32_t index = mesh.index_size == 2 ? ((uint16_t const *) mesh.indices)[i + c]
+                                              : ((uint32_t const *) mesh.indices)[i + c];
+        float const *v = &mesh.vertices[index * mesh.vertex_stride];
+        REQUIRE(v[3] == v[0] / 32.0f);
+        ids[c] = (uint32_t) v[1] * 33 + (uint32_t) v[0];
+      }
+      std::sort(ids, ids + 3);
+      tris.push_back((ids[0] << 20) | (ids[1] << 10) | ids[2]);
+    }
+    std::sort(tris.begin(), tris.end());
+    return tris;
+  };
+
+  tinyobj_mesh_t plain;
+  REQUIRE(tinyobj_mesh_build(&plain, &attrib, 0, attrib.num_face_num_verts,
+                             TINYOBJ_MESH_FLAG_NO_OPTIMISE | TINYOBJ_MESH_FLAG_32BIT_INDICES) == TINYOBJ_SUCCESS);
+  REQUIRE(plain.index_size == 4);
+  REQUIRE(plain.acmr_after == plain.acmr_before);
+
+  tinyobj_mesh_t mesh;
+  REQUIRE(tinyobj_mesh_build(&mesh, &attrib, 0, attrib.num_face_num_verts, 0) == TINYOBJ_SUCCESS);
+  REQUIRE(mesh.num_vertices == (N + 1) * (N + 1));
+  REQUIRE(mesh.num_indices == N * N * 6);
+  REQUIRE(mesh.index_size == 2);
+  REQUIRE(mesh.vertex_format == TINYOBJ_MESH_TEXCOORD);
+  REQUIRE(mesh.vertex_stride == 5);
+  REQUIRE(mesh.num_submeshes == 1);
+  REQUIRE(mesh.submeshes[0].material_id == -1);
+  REQUIRE(mesh.submeshes[0].index_count == mesh.num_indices);
+  REQUIRE(mesh.acmr_before == plain.acmr_before);
+  REQUIRE(mesh.acmr_after < 0.8f);
+  REQUIRE(mesh.acmr_after < mesh.acmr_before * 0.5f);
+  REQUIRE(mesh.acmr_after == tinyobj_mesh_acmr(mesh.indices, 2, mesh.num_indices, TINYOBJ_MESH_CACHE_SIZE));
+  REQUIRE(triangles(mesh) == triangles(plain));
+
+  // vertices are in first use order
+  uint16_t const *indices = (uint16_t const *) mesh.indices;
+  uint32_t next = 0;
+  for (unsigned int i = 0; i < mesh.num_indices; ++i) {
+    REQUIRE(indices[i] <= next);
+    if (indices[i] == next) { next++; }
+  }
+  REQUIRE(next == mesh.num_vertices);
+
+  // a shape sized range
+  tinyobj_mesh_t part;
+  REQUIRE(tinyobj_mesh_build(&part, &attrib, 10, 1, 0) == TINYOBJ_SUCCESS);
+  REQUIRE(part.num_vertices == 4);
+  REQUIRE(part.num_indices == 6);
+  tinyobj_mesh_free(&part);
+  REQUIRE(tinyobj_mesh_build(&part, &attrib, N * N, 1, 0) == TINYOBJ_ERROR_INVALID_PARAMETER);
+
+  uint32_t const quad[] = {0, 1, 2, 0, 2, 3};
+  REQUIRE(tinyobj_mesh_acmr(quad, 4, 6, TINYOBJ_MESH_CACHE_SIZE) == 2.0f);
+  REQUIRE(tinyobj_mesh_acmr(quad, 4, 6, 1) == 3.0f);
+
+  tinyobj_mesh_free(&part);
+  tinyobj_mesh_free(&mesh);
+  tinyobj_mesh_free(&plain);
+  tinyobj_attrib_free(&attrib);
+  tinyobj_materials_free(materials, numMaterials);
+  tinyobj_shapes_free(shapes, numShapes);
+}
+
+TEST_CASE("mesh_submeshes", "[Mesh]") {
+  // a row of quads, quad q spans x = q..q+1
+  int const N = 6;
+  std::string obj;
+  for (int x = 0; x <= N; ++x) {
+    obj += "v " + std::to_string(x) + " 0 0\nv " + std::to_string(x) + " 1 0\n";
+  }
+  for (int q = 0; q < N; ++q) {
+    int const i = 2 * q + 1;
+    obj += "f " + std::to_string(i) + " " + std::to_string(i + 2) + " " +
+        std::to_string(i + 3) + " " + std::to_string(i + 1) + "\n";
+  }
+
+  tinyobj_attrib_t attrib;
+  tinyobj_shape_t *shapes = NULL;
+  size_t numShapes;
+  tinyobj_material_t *materials = NULL;
+  size_t numMaterials;
+  REQUIRE(tinyobj_parse_obj(&attrib, &shapes, &numShapes, &materials, &numMaterials,
+                            obj.data(), obj.size(), 0) == TINYOBJ_SUCCESS);
+  REQUIRE(attrib.num_face_num_verts == N);
+  int const materialOf[N] = {1, 0, -1, 1, 0, 1};
+  for (int q = 0; q < N; ++q) { attrib.material_ids[q] = materialOf[q]; }
+
+  for (unsigned int flags : {(unsigned int) TINYOBJ_MESH_FLAG_NO_OPTIMISE, 0u}) {
+    tinyobj_mesh_t mesh;
+    REQUIRE(tinyobj_mesh_build(&mesh, &attrib, 0, attrib.num_face_num_verts, flags) == TINYOBJ_SUCCESS);
+    REQUIRE(mesh.num_indices == N * 6);
+    REQUIRE(mesh.num_submeshes == 3);
+
+    // sorted by material id and covering the index buffer in order
+    unsigned int const expectedCounts[3] = {6, 12, 18};
+    unsigned int offset = 0;
+    for (unsigned int s = 0; s < mesh.num_submeshes; ++s) {
+      tinyobj_submesh_t const &submesh = mesh.submeshes[s];
+      REQUIRE(submesh.material_id == (int) s - 1);
+      REQUIRE(submesh.index_offset == offset);
+      REQUIRE(submesh.index_count == expectedCounts[s]);
+      offset += submesh.index_count;
+
+      // every triangle comes from a quad with the submesh's material
+      for (unsigned int i = submesh.index_offset; i < submesh.index_offset + submesh.index_count; i += 3) {
+        float minX = (float) N;
+        for (int c = 0; c < 3; ++c) {
+          uint16_t const index = ((uint16_t const *) mesh.indices)[i + c];
+          minX = std::min(minX, mesh.vertices[index * mesh.vertex_stride]);
+        }
+        REQUIRE(materialOf[(int) minX] == submesh.material_id);
+      }
+    }
+    REQUIRE(offset == mesh.num_indices);
+    tinyobj_mesh_free(&mesh);
+  }
+
+  tinyobj_attrib_free(&attrib);
+  tinyobj_materials_free(materials, numMaterials);
+  tinyobj_shapes_free(shapes, numShapes);
+}
+
+TEST_CASE("mesh_pack", "[Mesh]") {
+  // a bumpy sphere, so normals cover every octant and positions aren't on a grid
+  int const N = 24;
+  std::string obj;
+  char line[256];
+  for (int y = 0; y <= N; ++y) {
+    for (int x = 0; x <= N; ++x) {
+      float const theta = 3.14159265f * y / N;
+      float const phi = 2.0f * 3.14159265f * x / N;
+      float const n[3] = {sinf(theta) * cosf(phi), sinf(theta) * sinf(phi), cosf(theta)};
+      float const r = 10.0f + 0.37f * sinf(x * 1.3f + y * 0.7f);
+      snprintf(line, sizeof(line), "v %f %f %f\nvn %f %f %f\nvt %f %f\n",
+               n[0] * r - 3.0f, n[1] * r + 40.0f, n[2] * r, n[0], n[1], n[2], x / (float) N, y / (float) N);
+      obj += line;
+    }
+  }
+  for (int y = 0; y < N; ++y) {
+    for (int x = 0; x < N; ++x) {
+      int const i = y * (N + 1) + x + 1;
+      snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\n",
+               i, i, i, i + 1, i + 1, i + 1, i + N + 2, i + N + 2, i + N + 2);
+      obj += line;
+    }
+  }
+
+  tinyobj_attrib_t attrib;
+  tinyobj_shape_t *shapes = NULL;
+  size_t numShapes;
+  tinyobj_material_t *materials = NULL;
+  size_t numMaterials;
+  REQUIRE(tinyobj_parse_obj(&attrib, &shapes, &numShapes, &materials, &numMaterials,
+                            obj.data(), obj.size(), 0) == TINYOBJ_SUCCESS);
+  tinyobj_mesh_t mesh;
+  REQUIRE(tinyobj_mesh_build(&mesh, &attrib, 0, attrib.num_face_num_verts, 0) == TINYOBJ_SUCCESS);
+  REQUIRE(mesh.vertex_stride * sizeof(float) == 32);
+
+  float const minDot[2] = {0.99999f, 0.999f};
+  unsigned int const flags[2] = {0, TINYOBJ_PACK_FLAG_NORMAL_8BIT};
+  for (int pass = 0; pass < 2; ++pass) {
+    tinyobj_packed_mesh_t packed;
+    REQUIRE(tinyobj_mesh_pack(&packed, &mesh, flags[pass]) == TINYOBJ_SUCCESS);
+    REQUIRE(packed.stride == 16);
+    REQUIRE(packed.num_attributes == 3);
+    REQUIRE(packed.attributes[0].semantic == TINYOBJ_PACK_POSITION);
+    REQUIRE(packed.attributes[0].format == TINYOBJ_PACK_R16G16B16A16_UNORM);
+    REQUIRE(packed.attributes[1].semantic == TINYOBJ_PACK_NORMAL);
+    REQUIRE(packed.attributes[1].format ==
+        (pass ? TINYOBJ_PACK_R8G8_SNORM : TINYOBJ_PACK_R16G16_SNORM));
+    REQUIRE(packed.attributes[1].offset == 8);
+    REQUIRE(packed.attributes[2].semantic == TINYOBJ_PACK_TEXCOORD);
+    REQUIRE(packed.attributes[2].offset == 12);
+
+    std::vector<float> decoded(mesh.num_vertices * mesh.vertex_stride);
+    REQUIRE(tinyobj_packed_mesh_decode(&packed, decoded.data()) == TINYOBJ_SUCCESS);
+    float worstDot = 1.0f;
+    for (unsigned int v = 0; v < mesh.num_vertices; ++v) {
+      float const *src = &mesh.vertices[v * mesh.vertex_stride];
+      float const *dst = &decoded[v * mesh.vertex_stride];
+      uint16_t const *position = (uint16_t const *) ((uint8_t const *) packed.vertices + v * packed.stride);
+      for (int c = 0; c < 3; ++c) {
+        // what a shader gets from offset + the UNORM fetch * scale
+        float const unorm = position[c] / 65535.0f;
+        float const shader = packed.position_offset[c] + unorm * packed.position_scale[c];
+        REQUIRE(fabsf(shader - src[c]) <= packed.position_scale[c] / 65535.0f);
+        REQUIRE(fabsf(dst[c] - shader) <= 1e-6f * (1.0f + fabsf(shader)));
+      }
+      worstDot = std::min(worstDot, src[3] * dst[3] + src[4] * dst[4] + src[5] * dst[5]);
+      REQUIRE(fabsf(dst[6] - src[6]) < 1e-3f);
+      REQUIRE(fabsf(dst[7] - src[7]) < 1e-3f);
+    }
+    REQUIRE(worstDot > minDot[pass]);
+    tinyobj_packed_mesh_free(&packed);
+  }
+
+  float const down[3] = {0.0f, 0.0f, -1.0f};
+  float oct[2];
+  float dir[3];
+  tinyobj_oct_encode(down, oct);
+  tinyobj_oct_decode(oct, dir);
+  REQUIRE(dir[2] == -1.0f);
+
+  tinyobj_mesh_free(&mesh);
+  tinyobj_attrib_free(&attrib);
+  tinyobj_materials_free(materials, numMaterials);
+  tinyobj_shapes_free(shapes, numShapes);
+}
+
+TEST_CASE("mesh_simplify", "[Mesh]") {
+  // a gently rolling open 48x48 grid and a sphere with a texcoord seam
+  int const N = 48;
+  std::string grid;
+  std::string sphere;
+  char line[256];
+  for (int y = 0; y <= N; ++y) {
+    for (int x = 0; x <= N; ++x) {
+      float const h = 0.8f * sinf(x * 0.21f) * cosf(y * 0.17f);
+      snprintf(line, sizeof(line), "v %d %d %f\nvt %f %f\n", x, y, h, x / (float) N, y / (float) N);
+      grid += line;
+      float const theta = 3.14159265f * y / N;
+      float const phi = 2.0f * 3.14159265f * (x % N) / N;
+      float const n[3] = {sinf(theta) * cosf(phi), sinf(theta) * sinf(phi), cosf(theta)};
+      snprintf(line, sizeof(line), "v %f %f %f\nvn %f %f %f\nvt %f %f\n",
+               n[0] * 5.0f, n[1] * 5.0f, n[2] * 5.0f, n[0], n[1], n[2], x / (float) N, y / (float) N);
+      sphere += line;
+    }
+  }
+  for (int y = 0; y < N; ++y) {
+    for (int x = 0; x < N; ++x) {
+      int const i = y * (N + 1) + x + 1;
+      snprintf(line, sizeof(line), "f %d/%d %d/%d %d/%d %d/%d\n",
+               i, i, i + 1, i + 1, i + N + 2, i + N + 2, i + N + 1, i + N + 1);
+      grid += line;
+      snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n",
+               i, i, i, i + 1, i + 1, i + 1, i + N + 2, i + N + 2, i + N + 2, i + N + 1, i + N + 1, i + N + 1);
+      sphere += line;
+    }
+  }
+
+  tinyobj_mesh_t meshes[2];
+  for (int m = 0; m < 2; ++m) {
+    std::string const& obj = m ? sphere : grid;
+    tinyobj_attrib_t attrib;
+    tinyobj_shape_t *shapes = NULL;
+    size_t numShapes;
+    tinyobj_material_t *materials = NULL;
+    size_t numMaterials;
+    REQUIRE(tinyobj_parse_obj(&attrib, &shapes, &numShapes, &materials, &numMaterials,
+                              obj.data(), obj.size(), 0) == TINYOBJ_SUCCESS);
+    REQUIRE(tinyobj_mesh_build(&meshes[m], &attrib, 0, attrib.num_face_num_verts, 0) == TINYOBJ_SUCCESS);
+    tinyobj_attrib_free(&attrib);
+    tinyobj_materials_free(materials, numMaterials);
+    tinyobj_shapes_free(shapes, numShapes);
+  }
+
+  auto index = [](void const *indices, unsigned int size, unsigned int i) {
+    return size == 2 ? (uint32_t) ((uint16_t const *) indices)[i] : ((uint32_t const *) indices)[i];
+  };
+  auto checkLods = [&](tinyobj_mesh_t const& mesh, tinyobj_mesh_lod_t const *lods, unsigned int numLods) {
+    unsigned int previous = mesh.num_indices;
+    float error = 0.0f;
+    for (unsigned int l = 0; l < numLods; ++l) {
+      tinyobj_mesh_lod_t const& lod = lods[l];
+      REQUIRE(lod.num_indices % 3 == 0);
+      REQUIRE(lod.num_indices < previous);
+      REQUIRE(lod.error >= error);
+      REQUIRE(lod.index_size == mesh.index_size);
+      REQUIRE(lod.num_submeshes == 1);
+      REQUIRE(lod.submeshes[0].material_id == -1);
+      REQUIRE(lod.submeshes[0].index_offset == 0);
+      REQUIRE(lod.submeshes[0].index_count == lod.num_indices);
+      for (unsigned int i = 0; i < lod.num_indices; ++i) {
+        REQUIRE(index(lod.indices, lod.index_size, i) < mesh.num_vertices);
+      }
+      previous = lod.num_indices;
+      error = lod.error;
+    }
+  };
+  // is a source vertex at this position still used by the level
+  auto usesPosition = [&](tinyobj_mesh_t const& mesh, tinyobj_mesh_lod_t const& lod, float const *p) {
+    for (unsigned int i = 0; i < lod.num_indices; ++i) {
+      float const *v = &mesh.vertices[index(lod.indices, lod.index_size, i) * mesh.vertex_stride];
+      if (v[0] == p[0] && v[1] == p[1] && v[2] == p[2]) { return true; }
+    }
+    return false;
+  };
+
+  tinyobj_simplify_options_t options;
+  tinyobj_simplify_options_init(&options);
+  REQUIRE(options.num_levels == 4);
+  tinyobj_mesh_lod_t lods[2][4];
+  unsigned int numLods[2];
+  for (int m = 0; m < 2; ++m) {
+    REQUIRE(tinyobj_mesh_simplify(lods[m], &numLods[m], &meshes[m], &options) == TINYOBJ_SUCCESS);
+    REQUIRE(numLods[m] >= 2);
+    checkLods(meshes[m], lods[m], numLods[m]);
+  }
+  REQUIRE(lods[0][0].num_indices <= meshes[0].num_indices / 2 + 3);
+  REQUIRE(lods[0][0].error <= options.target_error);
+
+  // seam vertices stay put as moving them would tear the texture mapping
+  tinyobj_mesh_t const& ball = meshes[1];
+  for (unsigned int v = 0; v < ball.num_vertices; ++v) {
+    float const *p = &ball.vertices[v * ball.vertex_stride];
+    if (p[6] != 0.0f || p[7] <= 0.0f || p[7] >= 1.0f) { continue; }
+    for (unsigned int l = 0; l < numLods[1]; ++l) {
+      REQUIRE(usesPosition(ball, lods[1][l], p));
+    }
+  }
+
+  // the same jobs across the thread pool give the same levels
+  tinyobj_mesh_lod_t manyLods[2][4];
+  tinyobj_simplify_job_t jobs[2];
+  for (int m = 0; m < 2; ++m) {
+    jobs[m].mesh = &meshes[m];
+    jobs[m].lods = manyLods[m];
+  }
+  options.flags = TINYOBJ_SIMPLIFY_FLAG_PARALLEL;
+  REQUIRE(tinyobj_mesh_simplify_many(jobs, 2, &options) == TINYOBJ_SUCCESS);
+  for (int m = 0; m < 2; ++m) {
+    REQUIRE(jobs[m].result == TINYOBJ_SUCCESS);
+    REQUIRE(jobs[m].num_lods == numLods[m]);
+    for (unsigned int l = 0; l < numLods[m]; ++l) {
+      REQUIRE(manyLods[m][l].num_indices == lods[m][l].num_indices);
+      REQUIRE(manyLods[m][l].error == lods[m][l].error);
+      REQUIRE(memcmp(manyLods[m][l].indices, lods[m][l].indices,
+                     lods[m][l].num_indices * lods[m][l].index_size) == 0);
+      tinyobj_mesh_lod_free(&manyLods[m][l]);
+      tinyobj_mesh_lod_free(&lods[m][l]);
+    }
+  }
+
+  // locked borders keep every grid edge vertex
+  options.flags = TINYOBJ_SIMPLIFY_FLAG_LOCK_BORDER;
+  REQUIRE(tinyobj_mesh_simplify(lods[0], &numLods[0], &meshes[0], &options) == TINYOBJ_SUCCESS);
+  REQUIRE(numLods[0] >= 1);
+  checkLods(meshes[0], lods[0], numLods[0]);
+  for (unsigned int v = 0; v < meshes[0].num_vertices; ++v) {
+    float const *p = &meshes[0].vertices[v * meshes[0].vertex_stride];
+    if (p[0] != 0.0f && p[1] != 0.0f && p[0] != (float) N && p[1] != (float) N) { continue; }
+    for (unsigned int l = 0; l < numLods[0]; ++l) {
+      REQUIRE(usesPosition(meshes[0], lods[0][l], p));
+    }
+  }
+  for (unsigned int l = 0; l < numLods[0]; ++l) {
+    tinyobj_mesh_lod_free(&lods[0][l]);
+  }
+
+  REQUIRE(tinyobj_mesh_simplify(lods[0], &numLods[0], NULL, &options) == TINYOBJ_ERROR_INVALID_PARAMETER);
+  tinyobj_mesh_free(&meshes[0]);
+  tinyobj_mesh_free(&meshes[1]);
+}
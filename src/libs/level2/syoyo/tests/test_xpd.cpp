@@ -0,0 +1,316 @@
+#include "core/core.h"
+#include "os/atomics.h"
+#include "os/filesystem.h"
+#include "vfile/vfile.hpp"
+#include "vfile/interface.h"
+#include "syoyo/tiny_xpd.hpp"
+#include "catch/catch.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// little XPD writer, values are stored in the other byte order when swap is set
+struct XPDWriter {
+  std::vector<uint8_t> bytes;
+  bool swap;
+
+  void Raw(void const *data, size_t size) {
+    uint8_t const *p = (uint8_t const *) data;
+    bytes.insert(bytes.end(), p, p + size);
+  }
+  void Byte(uint8_t v) { bytes.push_back(v); }
+  template<typename T> void Value(T v) {
+    uint8_t b[sizeof(T)];
+    memcpy(b, &v, sizeof(T));
+    if (swap) {
+      for (size_t i = 0; i < sizeof(T) / 2; ++i) {
+        uint8_t const t = b[i];
+        b[i] = b[sizeof(T) - 1 - i];
+        b[sizeof(T) - 1 - i] = t;
+      }
+    }
+    Raw(b, sizeof(T));
+  }
+};
+
+uint32_t const numFaces = 5;
+uint32_t const primSizes[] = {4, 3};
+
+float PrimValue(uint32_t face, uint32_t block, uint32_t i) {
+  return (float) (face * 1000 + block * 100) + (float) i * 0.25f;
+}
+
+uint32_t PrimCount(uint32_t face) { return face == 3 ? 0 : face * 7 + 1; }
+
+// faces of 2 blocks, "Primitive" of 4 floats per prim and "Color" of 3
+std::vector<uint8_t> MakeXPD(bool swap) {
+  XPDWriter w{{}, swap};
+  w.Raw("XPD3", 4);
+  w.Byte(3);
+  w.Value<uint32_t>(tiny_xpd::Xpd::Spline);
+  w.Byte(1);
+  w.Value<float>(1.5f);
+  w.Value<uint32_t>(4);
+  w.Value<uint32_t>(tiny_xpd::Xpd::Object);
+  w.Value<uint32_t>(2);
+  char const names[] = "Primitive\0Color";
+  w.Value<uint32_t>(sizeof(names));
+  w.Raw(names, sizeof(names));
+  w.Value<uint32_t>(primSizes[0]);
+  w.Value<uint32_t>(primSizes[1]);
+  w.Value<uint32_t>(0);
+  w.Value<uint32_t>(0);
+  w.Value<uint32_t>(numFaces);
+  for (uint32_t f = 0; f < numFaces; ++f) { w.Value<int32_t>((int32_t) f + 10); }
+  for (uint32_t f = 0; f < numFaces; ++f) { w.Value<uint32_t>(PrimCount(f)); }
+
+  // the header is an odd size, pad unswapped data so it is float aligned
+  size_t const tableEnd = w.bytes.size() + sizeof(uint64_t) * numFaces * 2;
+  size_t const pad = swap ? 0 : (4 - tableEnd % 4) % 4;
+  uint64_t position = tableEnd + pad;
+  for (uint32_t f = 0; f < numFaces; ++f) {
+    for (uint32_t b = 0; b < 2; ++b) {
+      w.Value<uint64_t>(position);
+      position += sizeof(float) * PrimCount(f) * primSizes[b];
+    }
+  }
+  for (size_t i = 0; i < pad; ++i) { w.Byte(0); }
+  for (uint32_t f = 0; f < numFaces; ++f) {
+    for (uint32_t b = 0; b < 2; ++b) {
+      for (uint32_t i = 0; i < PrimCount(f) * primSizes[b]; ++i) {
+        w.Value<float>(PrimValue(f, b, i));
+      }
+    }
+  }
+  return w.bytes;
+}
+
+// inPlace is the data the blocks should point into, if any
+void CheckReader(tiny_xpd::XPDReader const &reader, std::vector<uint8_t> const *inPlace) {
+  REQUIRE(reader.numFaces() == numFaces);
+  REQUIRE(reader.numBlocks() == 2);
+  REQUIRE(reader.header().primType == tiny_xpd::Xpd::Spline);
+  REQUIRE(reader.header().time == 1.5f);
+  REQUIRE(reader.blockIndex("Color") == 1);
+  REQUIRE(reader.blockIndex("Width") == -1);
+
+  tinystl::vector<float> scratch;
+  for (uint32_t f = 0; f < numFaces; ++f) {
+    REQUIRE(reader.header().faceid[f] == (int) f + 10);
+    REQUIRE(reader.numPrims(f) == PrimCount(f));
+    for (uint32_t b = 0; b < 2; ++b) {
+      tiny_xpd::XPDSpan<float> const span = reader.Block(f, b, &scratch);
+      REQUIRE(span.size == PrimCount(f) * primSizes[b]);
+      if (inPlace && span.size) {
+        REQUIRE((uint8_t const *) span.data >= inPlace->data());
+        REQUIRE((uint8_t const *) span.data < inPlace->data() + inPlace->size());
+      }
+      for (uint32_t i = 0; i < span.size; ++i) {
+        REQUIRE(span[i] == PrimValue(f, b, i));
+      }
+    }
+  }
+  REQUIRE(reader.Block(numFaces, 0, &scratch).empty());
+  REQUIRE(reader.Block(0, 2, &scratch).empty());
+}
+
+struct ParallelCheck {
+  tiny_xpd::XPDReader const *reader;
+  uint32_t faceSeen[numFaces];
+  uint32_t failures;
+};
+
+void ParallelFace(void *user, uint32_t face) {
+  ParallelCheck *check = (ParallelCheck *) user;
+  tinystl::vector<float> scratch;
+  tiny_xpd::XPDSpan<float> const span = check->reader->Block(face, 0, &scratch);
+  for (uint32_t i = 0; i < span.size; ++i) {
+    if (span[i] != PrimValue(face, 0, i)) {
+      Os_AtomicAdd32_relaxed(&check->failures, 1);
+    }
+  }
+  check->faceSeen[face] = 1;
+}
+
+// a header larger than the first read, faces of one "Width" block holding
+// one prim each, the face's number
+std::vector<uint8_t> MakeBigHeaderXPD(uint32_t faces) {
+  XPDWriter w{{}, false};
+  w.Raw("XPD3", 4);
+  w.Byte(3);
+  w.Value<uint32_t>(tiny_xpd::Xpd::Spline);
+  w.Byte(1);
+  w.Value<float>(0.0f);
+  w.Value<uint32_t>(1);
+  w.Value<uint32_t>(tiny_xpd::Xpd::Object);
+  w.Value<uint32_t>(1);
+  w.Value<uint32_t>(6);
+  w.Raw("Width", 6);
+  w.Value<uint32_t>(1);
+  w.Value<uint32_t>(0);
+  w.Value<uint32_t>(0);
+  w.Value<uint32_t>(faces);
+  for (uint32_t f = 0; f < faces; ++f) { w.Value<int32_t>((int32_t) f); }
+  for (uint32_t f = 0; f < faces; ++f) { w.Value<uint32_t>(1); }
+  uint64_t const data = w.bytes.size() + sizeof(uint64_t) * faces;
+  for (uint32_t f = 0; f < faces; ++f) { w.Value<uint64_t>(data + sizeof(float) * f); }
+  for (uint32_t f = 0; f < faces; ++f) { w.Value<float>((float) f); }
+  return w.bytes;
+}
+
+// a VFile over memory that isn't a memory VFile, counting the bytes read
+struct CountingFile {
+  VFile_Interface_t header;
+  uint8_t const *data;
+  size_t size;
+  size_t offset;
+  size_t bytesRead;
+};
+
+void CountingClose(VFile_Interface_t *) {}
+void CountingFlush(VFile_Interface_t *) {}
+size_t CountingRead(VFile_Interface_t *vif, void *buffer, size_t byteCount) {
+  CountingFile *file = (CountingFile *) vif;
+  size_t const count = std::min(byteCount, file->size - file->offset);
+  memcpy(buffer, file->data + file->offset, count);
+  file->offset += count;
+  file->bytesRead += count;
+  return count;
+}
+size_t CountingWrite(VFile_Interface_t *, void const *, size_t) { return 0; }
+bool CountingSeek(VFile_Interface_t *vif, int64_t offset, enum VFile_SeekDir origin) {
+  CountingFile *file = (CountingFile *) vif;
+  int64_t const base = origin == VFile_SD_Begin ? 0 :
+                       origin == VFile_SD_Current ? (int64_t) file->offset : (int64_t) file->size;
+  if (base + offset < 0 || base + offset > (int64_t) file->size) { return false; }
+  file->offset = (size_t) (base + offset);
+  return true;
+}
+int64_t CountingTell(VFile_Interface_t *vif) { return (int64_t) ((CountingFile *) vif)->offset; }
+size_t CountingSize(VFile_Interface_t *vif) { return ((CountingFile *) vif)->size; }
+char const *CountingName(VFile_Interface_t *) { return "counting"; }
+bool CountingIsEOF(VFile_Interface_t *vif) {
+  CountingFile *file = (CountingFile *) vif;
+  return file->offset == file->size;
+}
+
+CountingFile MakeCountingFile(std::vector<uint8_t> const &bytes) {
+  CountingFile file;
+  memset(&file, 0, sizeof(file));
+  file.header.magic = InterfaceMagic;
+  file.header.type = VFile_Type_OsFile;
+  file.header.closeFunc = &CountingClose;
+  file.header.flushFunc = &CountingFlush;
+  file.header.readFunc = &CountingRead;
+  file.header.writeFunc = &CountingWrite;
+  file.header.seekFunc = &CountingSeek;
+  file.header.tellFunc = &CountingTell;
+  file.header.sizeFunc = &CountingSize;
+  file.header.nameFunc = &CountingName;
+  file.header.isEofFunc = &CountingIsEOF;
+  file.data = bytes.data();
+  file.size = bytes.size();
+  return file;
+}
+
+} // end anon namespace
+
+TEST_CASE("Swap endian", "[XPD]") {
+  uint32_t values32[7];
+  uint64_t values64[5];
+  for (uint32_t i = 0; i < 7; ++i) { values32[i] = 0x01020304u + i; }
+  for (uint32_t i = 0; i < 5; ++i) { values64[i] = 0x0102030405060708ull + i; }
+  tiny_xpd::SwapEndian32(values32, 7);
+  tiny_xpd::SwapEndian64(values64, 5);
+  for (uint32_t i = 0; i < 7; ++i) { REQUIRE(values32[i] == (0x04030201u + (i << 24))); }
+  for (uint32_t i = 0; i < 5; ++i) { REQUIRE(values64[i] == (0x0807060504030201ull + ((uint64_t) i << 56))); }
+}
+
+TEST_CASE("Reader", "[XPD]") {
+  for (int swap = 0; swap < 2; ++swap) {
+    std::vector<uint8_t> const bytes = MakeXPD(swap != 0);
+    VFile_Handle out = VFile_FromFile("test_reader.xpd", Os_FM_WriteBinary);
+    REQUIRE(out);
+    REQUIRE(VFile_Write(out, bytes.data(), bytes.size()) == bytes.size());
+    VFile_Close(out);
+
+    tinystl::string err;
+    {
+      // mapped, data can be used in place when not swapped
+      tiny_xpd::XPDReader reader;
+      REQUIRE(reader.OpenMapped("test_reader.xpd", swap != 0, &err));
+      CheckReader(reader, nullptr);
+
+      ParallelCheck check;
+      memset(&check, 0, sizeof(check));
+      check.reader = &reader;
+      reader.ForEachFaceParallel(&ParallelFace, &check);
+      REQUIRE(check.failures == 0);
+      for (uint32_t f = 0; f < numFaces; ++f) { REQUIRE(check.faceSeen[f] == 1); }
+    }
+    {
+      // ranged reads from a file
+      VFile::ScopedFile file = VFile::File::FromFile("test_reader.xpd", Os_FM_ReadBinary);
+      REQUIRE(file);
+      tiny_xpd::XPDReader reader;
+      REQUIRE(reader.Open(file, swap != 0, &err));
+      CheckReader(reader, nullptr);
+    }
+    {
+      // memory files are used in place
+      VFile_Handle memory = VFile_FromMemory((void *) bytes.data(), bytes.size(), false);
+      REQUIRE(memory);
+      tiny_xpd::XPDReader reader;
+      REQUIRE(reader.Open(memory, swap != 0, &err));
+      CheckReader(reader, swap ? nullptr : &bytes);
+      VFile_Close(memory);
+    }
+  }
+
+  // truncated face tables are rejected
+  std::vector<uint8_t> const bytes = MakeXPD(false);
+  VFile_Handle memory = VFile_FromMemory((void *) bytes.data(), 60, false);
+  tinystl::string err;
+  tiny_xpd::XPDReader reader;
+  REQUIRE(!reader.Open(memory, false, &err));
+  REQUIRE(!err.empty());
+  VFile_Close(memory);
+
+  Os_FileDelete("test_reader.xpd");
+}
+
+TEST_CASE("Reader large header", "[XPD]") {
+  // 16 bytes of face tables per face, well over the first 64KB read
+  uint32_t const faces = 10000;
+  std::vector<uint8_t> bytes = MakeBigHeaderXPD(faces);
+  size_t const dataSize = sizeof(float) * faces;
+  REQUIRE(bytes.size() - dataSize > 64 * 1024);
+
+  {
+    // the header and nothing else is read when opening
+    CountingFile file = MakeCountingFile(bytes);
+    tinystl::string err;
+    tiny_xpd::XPDReader reader;
+    REQUIRE(reader.Open(&file, false, &err));
+    REQUIRE(file.bytesRead == bytes.size() - dataSize);
+    REQUIRE(reader.numFaces() == faces);
+    tinystl::vector<float> scratch;
+    for (uint32_t f = 0; f < faces; f += 997) {
+      REQUIRE(reader.header().faceid[f] == (int) f);
+      tiny_xpd::XPDSpan<float> const span = reader.Block(f, 0, &scratch);
+      REQUIRE(span.size == 1);
+      REQUIRE(span[0] == (float) f);
+    }
+  }
+
+  // a face count claiming more than the data fails after the first read
+  uint32_t const corruptFaces = 0x7FFFFFFF;
+  memcpy(&bytes[4 + 1 + 4 + 1 + 4 + 4 + 4 + 4 + 4 + 6 + 4 + 4 + 4], &corruptFaces, sizeof(corruptFaces));
+  CountingFile file = MakeCountingFile(bytes);
+  tinystl::string err;
+  tiny_xpd::XPDReader reader;
+  REQUIRE(!reader.Open(&file, false, &err));
+  REQUIRE(!err.empty());
+  REQUIRE(file.bytesRead == 64 * 1024);
+}